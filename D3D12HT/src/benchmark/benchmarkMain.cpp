@@ -0,0 +1,71 @@
+//The entry point of D3D12HTBenchmark. It runs the frame loop on the null backend (no window, no GPU), so it builds and runs anywhere,
+//including the Linux build machines. The results are written as JSON to stdout, or to the --output file.
+#include <fstream>
+#include <iostream>
+
+#include <benchmark/headlessBenchmark.h>
+
+int main(int argc, char** argv)
+{
+	HT::BenchmarkConfig config;
+	std::string outputPath;
+	std::string error;
+
+	if (!HT::ParseBenchmarkArguments(argc, argv, config, outputPath, error))
+	{
+		std::cerr << error << "\n";
+		std::cerr << "Usage: D3D12HTBenchmark [--frames N] [--warmup N] [--draws N] [--draws-per-chunk N] [--max-chunks N] [--pipelines N]\n"
+		          << "                        [--root-signatures 1-64] [--materials N] [--no-sort]\n"
+		          << "                        [--groups N] [--spinning-groups N] [--moving-percent 0-100]\n"
+		          << "                        [--cull] [--occluders N] [--cull-level scalar|sse|avx2] [--no-gpu-profile] [--trace trace.json]\n"
+		          << "                        [--capture frames.htcap] [--replay frames.htcap]\n"
+		          << "                        [--passes N] [--resources N] [--compute N] [--threads N] [--scaling N] [--frames-in-flight 1-4] [--low-latency] [--seed N]\n"
+		          << "                        [--heaps N] [--heap-mb N] [--heaps-per-frame N] [--budget-mb N]\n"
+		          << "                        [--textures dir] [--stream-budget-kb N] [--stream-upload-mb N]\n"
+		          << "                        [--model-gpu-us N] [--max-latency 1-16] [--output file.json]\n";
+		return 1;
+	}
+
+	std::ofstream file;
+	if (!outputPath.empty())
+	{
+		file.open(outputPath);
+		if (!file)
+		{
+			std::cerr << "Can't open " << outputPath << "\n";
+			return 1;
+		}
+	}
+
+	std::ostream& stream = outputPath.empty() ? std::cout : file;
+
+	//A replay runs the frames of the capture instead of ours
+	if (!config.ReplayPath.empty())
+	{
+		HT::CaptureReplayResult replay = HT::RunCaptureReplay(config);
+		HT::WriteCaptureReplayJSON(replay, stream);
+
+		if (!replay.Replayed)
+			std::cerr << replay.Error << "\n";
+
+		return replay.Replayed ? 0 : 1;
+	}
+
+	//A scaling run measures the same frames with 1 to N threads
+	if (config.ScalingThreads > 0)
+	{
+		HT::WriteBenchmarkScalingJSON(HT::RunBenchmarkScaling(config), stream);
+		return 0;
+	}
+
+	HT::BenchmarkResult result = HT::RunHeadlessBenchmark(config);
+	HT::WriteBenchmarkJSON(result, stream);
+
+	if (!config.CapturePath.empty() && !result.Captured)
+	{
+		std::cerr << result.CaptureError << "\n";
+		return 1;
+	}
+
+	return 0;
+}
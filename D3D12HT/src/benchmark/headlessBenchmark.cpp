@@ -0,0 +1,1631 @@
+#include "headlessBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <core/cpuProfiler.h>
+#include <core/jobSystem.h>
+#include <renderer/descriptorAllocator.h>
+#include <renderer/resourceStateTracker.h>
+#include <renderer/null/nullCaptureRecorder.h>
+#include <renderer/null/nullCommandList.h>
+#include <renderer/null/nullTimestampBackend.h>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	//The same numbers as main.cpp
+	static const uint32_t s_MaxFramesInFlight = 4;
+	static const uint32_t s_BackBufferCount = 3;
+
+	//One constant buffer per draw, D3D12 wants them 256 bytes aligned
+	static const uint64_t s_ConstantsStride = 256;
+
+	//The resources are made up numbers. They are the same every run, so the barriers (and the checksum) are too.
+	static const ResourceId s_BackBufferIdBase = 0x1000;
+	static const ResourceId s_TransientIdBase  = 0x100000;
+	static const uint64_t s_PassPipelineBase  = 0x9000;
+	static const uint64_t s_DrawPipelineBase  = 0x5000;
+	static const uint64_t s_RootSignatureBase = 0x7000;
+	static const uint64_t s_MaterialTableBase = 0x200000;
+	static const uint64_t s_MaterialTableStride = 64;
+
+	//The draws of the pass 1 are transparent
+	static const uint32_t s_TransparentPass = 1;
+
+	//xorshift32, we want the same sequence on every platform (std::rand and the std distributions are implementation defined)
+	class BenchmarkRandom
+	{
+	public:
+		explicit BenchmarkRandom(uint32_t seed) : m_State(seed ? seed : 0x9e3779b9u) {}
+
+		inline uint32_t Next()
+		{
+			m_State ^= m_State << 13;
+			m_State ^= m_State >> 17;
+			m_State ^= m_State << 5;
+			return m_State;
+		}
+
+		inline uint32_t Range(uint32_t begin, uint32_t end) { return begin + Next() % (end - begin); }
+		inline float Unit() { return (float)(Next() >> 8) * (1.0f / 16777216.0f); }
+
+	private:
+		uint32_t m_State;
+	};
+
+	struct SyntheticDraw
+	{
+		uint32_t Pass;
+		uint32_t RootSignature;
+		uint32_t Pipeline;
+		uint32_t Material;
+		uint32_t VertexCount;
+		uint32_t InstanceCount;
+		float Position[3];
+		float Speed;
+		float Extent;
+	};
+
+	struct DrawConstants
+	{
+		float World[16];
+	};
+
+	//The component of the scene entities that are draws
+	struct SceneDrawComponent
+	{
+		uint32_t Draw;
+	};
+
+	//The Render of main.cpp, step by step, but with the null backend and made up passes and draws.
+	//The globals of main.cpp are members here, so a benchmark can create as many as it wants.
+	class HeadlessRenderer
+	{
+	public:
+		HeadlessRenderer(const BenchmarkConfig& config, FrameStats& frameStats);
+		~HeadlessRenderer();
+
+		HeadlessRenderer(const HeadlessRenderer&) = delete;
+		HeadlessRenderer& operator=(const HeadlessRenderer&) = delete;
+
+		void Update();
+		void Render();
+		void Flush();
+
+		void FillResult(BenchmarkResult& result) const;
+
+		//Stops the capture and writes it
+		void SaveCapture(BenchmarkResult& result);
+
+	private:
+		void BuildFrameGraph(NullCommandList* commandList);
+		uint32_t RecordDraws(const UploadAllocation& constants);
+		void Cull();
+		void BuildDrawList(const UploadAllocation& constants);
+		void MarkResidentHeaps(uint32_t chunk, uint32_t chunkCount);
+		void LoadTextures();
+		void CollectGPUTimings();
+		QueueSyncPoint SubmitAsyncCompute();
+
+	private:
+		BenchmarkConfig m_Config;
+		FrameStats& m_FrameStats;
+
+		JobSystem m_JobSystem;
+
+		//The backends go before everything that uses them, so they are destroyed last
+		NullQueueBackend m_QueueBackend;
+		NullCommandPoolBackend m_CommandPoolBackend;
+		CPUDescriptorHeapBackend m_DescriptorHeapBackend;
+		CPUResidencyBackend m_ResidencyBackend;
+
+		//With a capture, everything goes through the capture backend (the fences too). Without one, it isn't in the way at all.
+		NullCaptureListSource m_CaptureListSource;
+		CaptureQueueBackend m_CaptureQueueBackend;
+		std::unique_ptr<CommandCaptureWriter> m_CaptureWriter;
+		ICommandQueueBackend* m_Queues;
+
+		QueueScheduler m_QueueScheduler;
+		CommandPool m_DirectCommandPool;
+		CommandPool m_ComputeCommandPool;
+		FrameRing<s_MaxFramesInFlight> m_FrameRing;
+
+		//Null when GPUProfiling is off
+		std::unique_ptr<NullTimestampBackend> m_TimestampBackend;
+		std::unique_ptr<GPUProfiler> m_GPUProfiler;
+		std::vector<BenchmarkResult::GPUScopeSummary> m_GPUScopes;
+		uint32_t m_GPUFrames = 0;
+		double m_GPUFrameMs = 0.0;
+		double m_GPUStartDelayMs = 0.0;
+
+		std::unique_ptr<CPUUploadMemory> m_UploadMemory;
+		std::unique_ptr<UploadRing> m_UploadRing;
+		DescriptorManager m_DescriptorManager;
+
+		ResourceStateRegistry m_ResourceStates;
+		ResourceStateTracker m_CommandListStates;
+		FrameGraph m_FrameGraph;
+
+		DescriptorRange m_BackBufferRTVs;
+		uint32_t m_CurrentBackBufferIndex = 0;
+
+		//Every transient resource has a SRV and a RTV. The passes copy the SRVs of what they read into a table and clear the targets that alias.
+		std::vector<DescriptorRange> m_TransientSRVs;
+		std::vector<DescriptorRange> m_TransientRTVs;
+		std::vector<FrameGraphResourceDesc> m_TransientDescs;
+		std::vector<std::string> m_PassNames;
+		std::vector<std::string> m_ResourceNames;
+
+		std::vector<SyntheticDraw> m_Draws;
+		std::vector<DrawConstants> m_DrawConstants;
+
+		SceneStore m_Scene;
+		ComponentId m_SceneDrawComponent;
+		std::vector<EntityHandle> m_SceneGroups;
+		std::vector<EntityHandle> m_MovingDraws;
+		SceneUpdateStats m_SceneStats;
+		uint32_t m_SceneFrames = 0;
+
+		VisibilityCuller m_Culler;
+		CullingStats m_CullingStats;
+		uint32_t m_CulledFrames = 0;
+
+		DrawList m_DrawList;
+		DrawRecordStats m_DrawRecordStats;
+		uint64_t m_DrawEncodeNs = 0;
+		uint64_t m_DrawSortNs = 0;
+		uint32_t m_DrawListFrames = 0;
+
+		//[chunk]
+		std::vector<PooledCommandList> m_ChunkCommandLists;
+		std::vector<DrawRecordStats> m_ChunkRecordStats;
+		std::vector<void*> m_SubmitList;
+
+		std::unique_ptr<ResidencyManager> m_ResidencyManager;
+		std::vector<void*> m_Heaps;
+		std::vector<ResidencyHandle> m_HeapResidency;
+
+		//The streamer goes after its sink and its memory, it is destroyed (and its I/O thread stopped) first
+		CPUTextureUploadSink m_TextureSink;
+		std::unique_ptr<CPUUploadMemory> m_StreamingMemory;
+		std::unique_ptr<TextureStreamer> m_TextureStreamer;
+		std::vector<TextureHandle> m_Textures;
+		uint32_t m_TextureLoadErrors = 0;
+	};
+
+	HeadlessRenderer::HeadlessRenderer(const BenchmarkConfig& config, FrameStats& frameStats)
+		: m_Config(config)
+		, m_FrameStats(frameStats)
+		, m_JobSystem(config.ThreadCount ? config.ThreadCount - 1 : JobSystem::s_AutoWorkerCount)
+		, m_CaptureQueueBackend(&m_QueueBackend, &m_CaptureListSource)
+		, m_Queues(config.CapturePath.empty() ? (ICommandQueueBackend*)&m_QueueBackend : &m_CaptureQueueBackend)
+		, m_QueueScheduler(m_Queues)
+		, m_DirectCommandPool(&m_CommandPoolBackend, CommandQueueType::Direct, m_Queues->GetFence(CommandQueueType::Direct))
+		, m_ComputeCommandPool(&m_CommandPoolBackend, CommandQueueType::Compute, m_Queues->GetFence(CommandQueueType::Compute))
+		, m_FrameRing(m_Queues->GetFence(CommandQueueType::Direct), HTUtils::HTMin(HTUtils::HTMax(config.FramesInFlight, 1u), s_MaxFramesInFlight), config.PacingMode)
+		, m_DescriptorManager(&m_DescriptorHeapBackend)
+	{
+		//Big enough for the constants of every frame we can have in flight, so the ring never overflows
+		uint64_t constantsPerFrame = HTUtils::HTMax<uint64_t>((uint64_t)config.DrawCount * s_ConstantsStride, s_ConstantsStride);
+		m_UploadMemory = std::make_unique<CPUUploadMemory>(constantsPerFrame * (s_MaxFramesInFlight + 1));
+		m_UploadRing = std::make_unique<UploadRing>(m_UploadMemory->GetMemory());
+
+		//A slot more than the frames in flight, the frame ring has always waited for the frame that used the slot before
+		if (config.GPUProfiling)
+		{
+			GPUProfilerConfig profilerConfig;
+			profilerConfig.FrameSlots = s_MaxFramesInFlight + 1;
+
+			m_TimestampBackend = std::make_unique<NullTimestampBackend>(GPUProfiler::GetQueryCount(profilerConfig));
+			m_GPUProfiler = std::make_unique<GPUProfiler>(m_TimestampBackend.get(), m_Queues->GetFence(CommandQueueType::Direct), profilerConfig);
+		}
+
+		m_BackBufferRTVs = m_DescriptorManager.GetAllocator(DescriptorHeapType::RTV).Allocate(s_BackBufferCount);
+
+		BenchmarkRandom random(config.Seed);
+
+		//The transient resources have sizes between 1 and 16MB, like render targets of a few resolutions and formats
+		uint32_t transientCount = config.PassCount * config.ResourcesPerPass;
+		for (uint32_t i = 0; i < transientCount; i++)
+		{
+			FrameGraphResourceDesc desc;
+			desc.Size = (uint64_t)(1u << random.Range(0, 5)) * 1024 * 1024;
+			m_TransientDescs.push_back(desc);
+
+			m_TransientSRVs.push_back(m_DescriptorManager.GetAllocator(DescriptorHeapType::CBV_SRV_UAV).Allocate(1));
+			m_TransientRTVs.push_back(m_DescriptorManager.GetAllocator(DescriptorHeapType::RTV).Allocate(1));
+			m_ResourceNames.push_back("Transient" + std::to_string(i));
+		}
+
+		for (uint32_t i = 0; i < config.PassCount; i++)
+			m_PassNames.push_back("Pass" + std::to_string(i));
+
+		//Neighbour draws often share a pipeline, like objects of the same kind that were loaded together, but not a material.
+		//Each pipeline belongs to a root signature. The ids have to fit in the sort key.
+		uint32_t pipelineCount = HTUtils::HTMin(HTUtils::HTMax(config.PipelineCount, 1u), 1u << DrawSortKey::PipelineBits);
+		uint32_t rootSignatureCount = HTUtils::HTMin(HTUtils::HTMax(config.RootSignatureCount, 1u), 1u << DrawSortKey::RootSignatureBits);
+		uint32_t materialCount = HTUtils::HTMin(HTUtils::HTMax(config.MaterialCount, 1u), 1u << DrawSortKey::MaterialBits);
+
+		uint32_t pipeline = 0;
+		m_Draws.resize(config.DrawCount);
+		for (uint32_t i = 0; i < config.DrawCount; i++)
+		{
+			SyntheticDraw& draw = m_Draws[i];
+
+			if (random.Range(0, 8) == 0)
+				pipeline = random.Range(0, pipelineCount);
+
+			draw.Pass = (i % 8 == 7) ? s_TransparentPass : 0;
+			draw.RootSignature = pipeline % rootSignatureCount;
+			draw.Pipeline = pipeline;
+			draw.Material = random.Range(0, materialCount);
+			draw.VertexCount = random.Range(36, 4096);
+			draw.InstanceCount = random.Range(0, 16) == 0 ? random.Range(2, 64) : 1;
+			draw.Position[0] = random.Unit() * 200.0f - 100.0f;
+			draw.Position[1] = random.Unit() * 20.0f;
+			draw.Position[2] = random.Unit() * 200.0f - 100.0f;
+			draw.Speed = random.Unit() * 4.0f;
+			draw.Extent = 0.25f + random.Unit() * 1.5f;
+		}
+
+		//Walls of 20 x 16 in the same area as the draws, half of them along x and half along z
+		if (config.Culling)
+		{
+			m_Culler.Resize(config.DrawCount);
+
+			for (uint32_t i = 0; i < config.OccluderCount; i++)
+			{
+				HTUtils::HTVec3 center = { random.Unit() * 160.0f - 80.0f, 8.0f, random.Unit() * 160.0f - 80.0f };
+				m_Culler.AddOccluder(center, (i & 1) ? HTUtils::HTVec3{ 10.0f, 8.0f, 0.5f } : HTUtils::HTVec3{ 0.5f, 8.0f, 10.0f });
+			}
+		}
+
+		m_DrawConstants.resize(config.DrawCount);
+
+		//The groups are at the origin, so a group that turns takes its draws around it
+		m_SceneDrawComponent = m_Scene.RegisterComponent<SceneDrawComponent>("Draw");
+		EntityHandle sceneRoot = m_Scene.Create();
+
+		for (uint32_t i = 0; i < HTUtils::HTMax(config.SceneGroups, 1u); i++)
+			m_SceneGroups.push_back(m_Scene.Create(sceneRoot));
+
+		for (uint32_t i = 0; i < config.DrawCount; i++)
+		{
+			const SyntheticDraw& draw = m_Draws[i];
+
+			SceneTransform local;
+			local.Position = { draw.Position[0], draw.Position[1], draw.Position[2] };
+
+			EntityHandle entity = m_Scene.Create(m_SceneGroups[i % m_SceneGroups.size()], local);
+			m_Scene.AddComponent<SceneDrawComponent>(entity, m_SceneDrawComponent, { i });
+
+			if (random.Range(0, 100) < config.MovingDrawPercent)
+				m_MovingDraws.push_back(entity);
+		}
+
+		m_DrawList.SetPassOrder(s_TransparentPass, DrawSortOrder::BackToFront);
+
+		m_ChunkCommandLists.resize(HTUtils::HTMax(config.MaxChunks, 1u));
+		m_ChunkRecordStats.resize(m_ChunkCommandLists.size());
+
+		for (uint32_t i = 0; i < s_BackBufferCount; i++)
+			m_ResourceStates.Register(s_BackBufferIdBase + i, ResourceState::Present);
+
+		if (config.ResidencyHeapCount > 0)
+		{
+			m_ResidencyBackend.SetBudget(MemorySegment::Local, (uint64_t)config.ResidencyBudgetMB << 20);
+			m_ResidencyManager = std::make_unique<ResidencyManager>(&m_ResidencyBackend, &m_ResidencyBackend, m_Queues->GetFence(CommandQueueType::Direct));
+
+			uint64_t heapSize = (uint64_t)config.ResidencyHeapMB << 20;
+			for (uint32_t i = 0; i < config.ResidencyHeapCount; i++)
+			{
+				m_Heaps.push_back(m_ResidencyBackend.CreateHeap(heapSize, MemorySegment::Local));
+				m_HeapResidency.push_back(m_ResidencyManager->Register(m_Heaps.back(), heapSize, MemorySegment::Local));
+			}
+		}
+
+		if (!config.TextureDirectory.empty())
+			LoadTextures();
+
+		//The ids that have a name in the renderer have it in the capture too
+		if (!config.CapturePath.empty())
+		{
+			m_CaptureWriter = std::make_unique<CommandCaptureWriter>();
+
+			for (uint32_t i = 0; i < s_BackBufferCount; i++)
+				m_CaptureWriter->NameHandle(CaptureHandleKind::Resource, s_BackBufferIdBase + i, ("BackBuffer" + std::to_string(i)).c_str());
+
+			for (uint32_t i = 0; i < (uint32_t)m_ResourceNames.size(); i++)
+				m_CaptureWriter->NameHandle(CaptureHandleKind::Resource, s_TransientIdBase + i, m_ResourceNames[i].c_str());
+
+			for (uint32_t i = 0; i <= config.PassCount; i++)
+				m_CaptureWriter->NameHandle(CaptureHandleKind::Pipeline, s_PassPipelineBase + i, i < config.PassCount ? m_PassNames[i].c_str() : "Composite");
+
+			m_CaptureQueueBackend.SetWriter(m_CaptureWriter.get());
+		}
+	}
+
+	void HeadlessRenderer::LoadTextures()
+	{
+		m_StreamingMemory = std::make_unique<CPUUploadMemory>((uint64_t)HTUtils::HTMax(m_Config.StreamUploadMB, 1u) << 20);
+
+		TextureStreamerConfig streamerConfig;
+		streamerConfig.FrameByteBudget = (uint64_t)m_Config.StreamBudgetKB << 10;
+		m_TextureStreamer = std::make_unique<TextureStreamer>(&m_TextureSink, m_StreamingMemory->GetMemory(), streamerConfig);
+
+		//Sorted, so the textures are in the same place on every run
+		std::vector<std::string> paths;
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_Config.TextureDirectory, error))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".dds")
+				paths.push_back(entry.path().string());
+		}
+
+		std::sort(paths.begin(), paths.end());
+
+		for (const std::string& path : paths)
+		{
+			std::string loadError;
+			TextureHandle texture = m_TextureStreamer->RegisterTexture(path, loadError);
+
+			if (texture == g_InvalidTexture)
+			{
+				std::cerr << loadError << "\n";
+				m_TextureLoadErrors++;
+				continue;
+			}
+
+			m_Textures.push_back(texture);
+		}
+	}
+
+	HeadlessRenderer::~HeadlessRenderer()
+	{
+		Flush();
+		m_TextureStreamer.reset();
+
+		for (uint32_t i = 0; i < (uint32_t)m_Heaps.size(); i++)
+		{
+			m_ResidencyManager->Unregister(m_HeapResidency[i]);
+			m_ResidencyBackend.DestroyHeap(m_Heaps[i]);
+		}
+	}
+
+	void HeadlessRenderer::Flush()
+	{
+		m_QueueScheduler.Flush();
+	}
+
+	void HeadlessRenderer::SaveCapture(BenchmarkResult& result)
+	{
+		if (!m_CaptureWriter)
+			return;
+
+		m_CaptureQueueBackend.SetWriter(nullptr);
+
+		result.Captured = m_CaptureWriter->Save(m_Config.CapturePath, result.CaptureError);
+		result.Capture = m_CaptureWriter->GetStats();
+		m_CaptureWriter.reset();
+	}
+
+	void HeadlessRenderer::Update()
+	{
+		HT_PROFILE_FUNCTION();
+
+		//The simulation of the scene, the time is the frame index so every run computes the same transforms
+		float time = (float)m_FrameRing.GetFrameIndex() * (1.0f / 60.0f);
+		const HTUtils::HTVec3 up = { 0.0f, 1.0f, 0.0f };
+
+		for (uint32_t i = 0; i < HTUtils::HTMin(m_Config.SpinningGroups, (uint32_t)m_SceneGroups.size()); i++)
+		{
+			SceneTransform local;
+			local.Rotation = HTUtils::HTQuatFromAxisAngle(up, time * 0.25f * (float)(i + 1));
+			m_Scene.SetLocalTransform(m_SceneGroups[i], local);
+		}
+
+		for (EntityHandle entity : m_MovingDraws)
+		{
+			const SyntheticDraw& draw = m_Draws[m_Scene.GetComponent<SceneDrawComponent>(entity, m_SceneDrawComponent)->Draw];
+
+			SceneTransform local;
+			local.Position = { draw.Position[0], draw.Position[1], draw.Position[2] };
+			local.Rotation = HTUtils::HTQuatFromAxisAngle(up, time * draw.Speed);
+			m_Scene.SetLocalTransform(entity, local);
+		}
+
+		m_Scene.UpdateTransforms(&m_JobSystem);
+
+		const SceneUpdateStats& sceneStats = m_Scene.GetUpdateStats();
+		m_SceneStats.LocalDirty += sceneStats.LocalDirty;
+		m_SceneStats.WorldChanged += sceneStats.WorldChanged;
+		m_SceneStats.ReorderNs += sceneStats.ReorderNs;
+		m_SceneStats.UpdateNs += sceneStats.UpdateNs;
+		m_SceneStats.Transforms = sceneStats.Transforms;
+		m_SceneStats.Levels = sceneStats.Levels;
+		m_SceneStats.Reordered = sceneStats.Reordered;
+		m_SceneFrames++;
+
+		//Only what changed is copied to the constants (and the bounds). The draws only turn around y, their box stays a cube.
+		const std::vector<EntityHandle>& changed = m_Scene.GetChangedEntities();
+		CullingBoundsSoA bounds = m_Culler.GetBounds();
+		bool culling = m_Config.Culling;
+
+		m_JobSystem.ParallelFor((uint32_t)changed.size(), 1024, [this, &changed, bounds, culling](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const SceneDrawComponent* component = m_Scene.GetComponent<SceneDrawComponent>(changed[i], m_SceneDrawComponent);
+				if (!component)
+					continue;
+
+				uint32_t index = component->Draw;
+				const HTUtils::HTMat4& world = m_Scene.GetWorldMatrix(changed[i]);
+				memcpy(m_DrawConstants[index].World, world.m, sizeof(world.m));
+
+				if (culling)
+				{
+					float extent = m_Draws[index].Extent;
+					bounds.CenterX[index] = world.m[3][0]; bounds.CenterY[index] = world.m[3][1]; bounds.CenterZ[index] = world.m[3][2];
+					bounds.ExtentX[index] = extent; bounds.ExtentY[index] = extent; bounds.ExtentZ[index] = extent;
+				}
+			}
+		});
+
+		//The camera goes from one end of the line of textures to the other during the run. The textures are 10 units apart and a texture
+		//at 1 unit covers 2048 pixels, so only the ones close to the camera want their biggest mips.
+		if (m_TextureStreamer && !m_Textures.empty())
+		{
+			float lineLength = 10.0f * (float)m_Textures.size();
+			float progress = (float)m_FrameRing.GetFrameIndex() / (float)HTUtils::HTMax(m_Config.WarmupFrames + m_Config.FrameCount, 1u);
+			float camera = progress * lineLength;
+
+			for (uint32_t i = 0; i < (uint32_t)m_Textures.size(); i++)
+			{
+				float distance = HTUtils::HTMax(std::fabs(camera - 10.0f * (float)i), 1.0f);
+				m_TextureStreamer->SetScreenSize(m_Textures[i], 2048.0f / distance);
+			}
+		}
+	}
+
+	void HeadlessRenderer::Render()
+	{
+		HT_PROFILE_FUNCTION();
+
+		m_FrameStats.BeginFrame(HTUtils::HTNowNanoseconds());
+
+		if (m_CaptureWriter)
+			m_CaptureQueueBackend.BeginFrame();
+
+		auto& frameSlot = m_FrameRing.BeginFrame();
+		m_FrameStats.AddPhaseDuration(FramePhase::FenceWait, frameSlot.LastStallNs);
+
+		uint64_t completedFenceValue = m_FrameRing.GetFence()->GetCompletedValue();
+		m_UploadRing->BeginFrame(completedFenceValue);
+		m_DescriptorManager.BeginFrame(completedFenceValue);
+
+		if (m_ResidencyManager)
+			m_ResidencyManager->BeginFrame();
+
+		if (m_TextureStreamer)
+			m_TextureStreamer->BeginFrame(completedFenceValue);
+
+		if (m_GPUProfiler)
+		{
+			m_GPUProfiler->BeginFrame();
+			CollectGPUTimings();
+		}
+
+		if (m_Config.Culling)
+		{
+			m_FrameStats.BeginPhase(FramePhase::Cull, HTUtils::HTNowNanoseconds());
+			Cull();
+			m_FrameStats.EndPhase(FramePhase::Cull, HTUtils::HTNowNanoseconds());
+		}
+
+		m_FrameStats.BeginPhase(FramePhase::Record, HTUtils::HTNowNanoseconds());
+
+		PooledCommandList frameCommandList = m_DirectCommandPool.Acquire();
+		NullCommandList* commandList = ToNullCommandList(frameCommandList);
+
+		commandList->SetDescriptorHeaps(m_DescriptorManager.GetTransientRing(DescriptorHeapType::CBV_SRV_UAV).GetHeap().Start.GPU,
+			m_DescriptorManager.GetTransientRing(DescriptorHeapType::Sampler).GetHeap().Start.GPU);
+
+		if (m_GPUProfiler)
+			m_GPUProfiler->BeginScope(commandList, "Frame");
+
+		m_CommandListStates.Reset(&m_ResourceStates);
+		BuildFrameGraph(commandList);
+
+		//The copies of the mips that are ready go in this frame (the CPU sink does them right away)
+		if (m_TextureStreamer)
+			m_TextureStreamer->Update();
+
+		//The constants of all draws in one allocation, the chunks write their part of it
+		UploadAllocation constants = m_UploadRing->Allocate(HTUtils::HTMax<uint64_t>(m_Draws.size() * s_ConstantsStride, s_ConstantsStride), s_ConstantsStride);
+		D3D_ASSERT(constants.IsValid(), "The upload ring of the benchmark is too small!");
+
+		BuildDrawList(constants);
+
+		//The chunks run after this list, so the scope of the draws begins at its end and ends at the end of the last chunk
+		if (m_GPUProfiler)
+			m_GPUProfiler->BeginScope(commandList, "Draws");
+
+		uint32_t chunkCount = RecordDraws(constants);
+
+		//Without draws there is no chunk to mark the heaps
+		if (chunkCount == 0)
+			MarkResidentHeaps(0, 1);
+
+		//The transition to present goes at the end of the last list
+		ResourceId backBuffer = s_BackBufferIdBase + m_CurrentBackBufferIndex;
+		NullCommandList* lastCommandList = chunkCount ? ToNullCommandList(m_ChunkCommandLists[chunkCount - 1]) : commandList;
+
+		m_CommandListStates.Transition(backBuffer, ResourceState::Present);
+		m_CommandListStates.Close();
+
+		if (m_GPUProfiler)
+			m_GPUProfiler->EndScope(lastCommandList);
+
+		const std::vector<ResourceBarrier>& presentBarriers = m_CommandListStates.FlushBarriers();
+		lastCommandList->ResourceBarriers(presentBarriers.data(), (uint32_t)presentBarriers.size());
+
+		if (m_GPUProfiler)
+		{
+			m_GPUProfiler->EndScope(lastCommandList);
+			m_GPUProfiler->ResolveFrame(lastCommandList);
+		}
+
+		commandList->Close();
+
+		m_SubmitList.clear();
+		m_SubmitList.push_back(commandList);
+
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			ToNullCommandList(m_ChunkCommandLists[i])->Close();
+			m_SubmitList.push_back(m_ChunkCommandLists[i].NativeCommandList);
+		}
+
+		if (m_ResidencyManager)
+			m_ResidencyManager->Commit();
+
+		m_FrameStats.EndPhase(FramePhase::Record, HTUtils::HTNowNanoseconds());
+
+		m_FrameStats.BeginPhase(FramePhase::Execute, HTUtils::HTNowNanoseconds());
+
+		{
+			HT_PROFILE_SCOPE("Submit");
+
+			QueueSyncPoint computeDone = SubmitAsyncCompute();
+			m_QueueScheduler.Submit(CommandQueueType::Direct, m_SubmitList.data(), (uint32_t)m_SubmitList.size(), &computeDone, computeDone.IsValid() ? 1 : 0);
+		}
+
+		m_FrameStats.EndPhase(FramePhase::Execute, HTUtils::HTNowNanoseconds());
+
+		m_CommandListStates.CommitFinalStates(m_ResourceStates);
+
+		//There is no swap chain, the present phase is left empty and we just flip the back buffers. The capture still has the present, where main.cpp does it.
+		if (m_CaptureWriter)
+			m_CaptureQueueBackend.Present(0, 0);
+
+		uint64_t frameFenceValue = m_FrameRing.EndFrame();
+		m_UploadRing->EndFrame(frameFenceValue);
+		m_DescriptorManager.EndFrame(frameFenceValue);
+
+		if (m_ResidencyManager)
+			m_ResidencyManager->EndFrame(frameFenceValue);
+
+		if (m_TextureStreamer)
+			m_TextureStreamer->EndFrame(frameFenceValue);
+
+		if (m_GPUProfiler)
+			m_GPUProfiler->EndFrame(frameFenceValue);
+
+		m_DirectCommandPool.Release(frameCommandList, frameFenceValue);
+		for (uint32_t i = 0; i < chunkCount; i++)
+			m_DirectCommandPool.Release(m_ChunkCommandLists[i], frameFenceValue);
+
+		m_QueueScheduler.Signal(CommandQueueType::Compute);
+		m_QueueScheduler.Signal(CommandQueueType::Copy);
+
+		m_CurrentBackBufferIndex = (m_CurrentBackBufferIndex + 1) % s_BackBufferCount;
+
+		if (m_CaptureWriter)
+			m_CaptureQueueBackend.EndFrame();
+
+		m_FrameStats.EndFrame(HTUtils::HTNowNanoseconds());
+	}
+
+	void HeadlessRenderer::CollectGPUTimings()
+	{
+		HT_PROFILE_FUNCTION();
+
+		for (uint32_t i = 0; i < m_GPUProfiler->GetResolvedFrameCount(); i++)
+		{
+			const GPUProfilerFrame& frame = m_GPUProfiler->GetResolvedFrame(i);
+			if (frame.Scopes.empty())
+				continue;
+
+			m_GPUFrames++;
+			m_GPUFrameMs += frame.GetGPUMs();
+
+			//The null GPU runs when the CPU waits for it, so it begins the frame a few frames after the CPU did
+			if (frame.Scopes[0].BeginNs > frame.CPUBeginNs)
+				m_GPUStartDelayMs += HTUtils::HTNanosecondsToMilliseconds(frame.Scopes[0].BeginNs - frame.CPUBeginNs);
+
+			for (const GPUProfilerScope& scope : frame.Scopes)
+			{
+				HT_PROFILE_GPU_SCOPE(scope.Name, scope.BeginNs, scope.EndNs);
+
+				auto summary = std::find_if(m_GPUScopes.begin(), m_GPUScopes.end(), [&scope](const BenchmarkResult::GPUScopeSummary& other) { return other.Name == scope.Name; });
+
+				if (summary == m_GPUScopes.end())
+				{
+					m_GPUScopes.emplace_back();
+					summary = m_GPUScopes.end() - 1;
+					summary->Name = scope.Name;
+					summary->Depth = scope.Depth;
+				}
+
+				summary->Count++;
+				summary->TotalMs += scope.GetDurationMs();
+			}
+		}
+	}
+
+	void HeadlessRenderer::BuildFrameGraph(NullCommandList* commandList)
+	{
+		HT_PROFILE_FUNCTION();
+
+		m_FrameGraph.Reset();
+
+		ResourceId backBuffer = s_BackBufferIdBase + m_CurrentBackBufferIndex;
+		FrameGraphHandle backBufferHandle = m_FrameGraph.Import("BackBuffer", backBuffer, ResourceState::Present);
+
+		//A chain of passes, each one reads everything the previous one wrote. The last one writes the back buffer.
+		std::vector<FrameGraphHandle> transients(m_TransientDescs.size());
+		const uint32_t resourcesPerPass = m_Config.ResourcesPerPass;
+
+		for (uint32_t pass = 0; pass <= m_Config.PassCount; pass++)
+		{
+			bool lastPass = pass == m_Config.PassCount;
+			uint32_t firstRead = pass > 0 ? (pass - 1) * resourcesPerPass : 0;
+			uint32_t readCount = pass > 0 ? resourcesPerPass : 0;
+
+			m_FrameGraph.AddPass(lastPass ? "Composite" : m_PassNames[pass].c_str(),
+				[this, &transients, &backBufferHandle, pass, lastPass, firstRead, readCount, resourcesPerPass](FrameGraph::PassBuilder& builder)
+				{
+					for (uint32_t i = firstRead; i < firstRead + readCount; i++)
+						builder.Read(transients[i], ResourceState::PixelShaderResource);
+
+					if (lastPass)
+					{
+						backBufferHandle = builder.Write(backBufferHandle, ResourceState::RenderTarget);
+						return;
+					}
+
+					for (uint32_t i = pass * resourcesPerPass; i < (pass + 1) * resourcesPerPass; i++)
+					{
+						transients[i] = builder.CreateTransient(m_ResourceNames[i].c_str(), m_TransientDescs[i]);
+						transients[i] = builder.Write(transients[i], ResourceState::RenderTarget);
+					}
+				},
+				[this, commandList, &transients, pass, lastPass, firstRead, readCount, resourcesPerPass](FrameGraphPassContext& context)
+				{
+					GPUProfileScope scope(m_GPUProfiler.get(), commandList, lastPass ? "Composite" : m_PassNames[pass].c_str());
+
+					commandList->SetPipelineState(s_PassPipelineBase + pass);
+
+					//The targets placed over the memory of older ones start with garbage
+					const float transientClearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					for (uint32_t i = pass * resourcesPerPass; !lastPass && i < (pass + 1) * resourcesPerPass; i++)
+					{
+						if (context.NeedsInitialization(transients[i]))
+							commandList->ClearRenderTarget(m_TransientRTVs[i].Base.CPU, transientClearColor);
+					}
+
+					if (readCount > 0)
+					{
+						DescriptorRange table = m_DescriptorManager.GetTransientRing(DescriptorHeapType::CBV_SRV_UAV).CopyToTable(&m_TransientSRVs[firstRead], readCount);
+						commandList->SetDescriptorTable(0, table.Base.GPU);
+					}
+
+					if (lastPass)
+					{
+						const float clearColor[] = { 0.5f, 0.0f, 0.0f, 1.0f };
+						commandList->ClearRenderTarget(m_BackBufferRTVs.At(m_CurrentBackBufferIndex).CPU, clearColor);
+						commandList->SetRenderTarget(m_BackBufferRTVs.At(m_CurrentBackBufferIndex).CPU);
+					}
+
+					//A full screen triangle
+					commandList->Draw(3, 1, 0, 0);
+				});
+		}
+
+		m_FrameGraph.MarkOutput(backBufferHandle);
+		m_FrameGraph.Compile();
+
+		//The placed resources would be created here. The ids don't change between frames, so the registry doesn't grow.
+		for (uint32_t i = 0; i < (uint32_t)transients.size(); i++)
+			m_FrameGraph.SetPhysical(transients[i], s_TransientIdBase + i);
+
+		m_FrameGraph.Execute(m_CommandListStates, [commandList](const std::vector<ResourceBarrier>& barriers)
+		{
+			if (!barriers.empty())
+				commandList->ResourceBarriers(barriers.data(), (uint32_t)barriers.size());
+		});
+	}
+
+	void HeadlessRenderer::Cull()
+	{
+		HT_PROFILE_FUNCTION();
+
+		//The camera stands in the middle, a bit above the ground, and turns around once every ~25 seconds
+		float yaw = (float)m_FrameRing.GetFrameIndex() * (0.25f / 60.0f);
+		HTUtils::HTVec3 eye = { 0.0f, 3.0f, 0.0f };
+		HTUtils::HTVec3 target = { std::sin(yaw), 3.0f, std::cos(yaw) };
+
+		HTUtils::HTMat4 viewProjection = HTUtils::HTMat4Multiply(HTUtils::HTMat4LookAtLH(eye, target, { 0.0f, 1.0f, 0.0f }),
+			HTUtils::HTMat4PerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+
+		m_Culler.Cull(viewProjection, &m_JobSystem, m_Config.OccluderCount > 0, m_Config.CullLevel);
+
+		const CullingStats& stats = m_Culler.GetStats();
+		m_CullingStats.Objects += stats.Objects;
+		m_CullingStats.FrustumVisible += stats.FrustumVisible;
+		m_CullingStats.OcclusionCulled += stats.OcclusionCulled;
+		m_CullingStats.Visible += stats.Visible;
+		m_CullingStats.Occluders += stats.Occluders;
+		m_CullingStats.RasterizedOccluders += stats.RasterizedOccluders;
+		m_CullingStats.FrustumNs += stats.FrustumNs;
+		m_CullingStats.RasterNs += stats.RasterNs;
+		m_CullingStats.OcclusionNs += stats.OcclusionNs;
+		m_CullingStats.Level = stats.Level;
+		m_CulledFrames++;
+	}
+
+	void HeadlessRenderer::BuildDrawList(const UploadAllocation& constants)
+	{
+		HT_PROFILE_FUNCTION();
+
+		//Without culling every draw is visible
+		const uint32_t* visible = m_Config.Culling ? m_Culler.GetVisibleIndices() : nullptr;
+		uint32_t drawCount = m_Config.Culling ? m_Culler.GetVisibleCount() : (uint32_t)m_Draws.size();
+
+		//The camera is around the origin, the depth is how far the draw was moved by its world matrix
+		m_DrawList.Reset();
+		m_DrawList.Resize(drawCount);
+		DrawPacket* packets = m_DrawList.GetDraws();
+
+		m_JobSystem.ParallelFor(drawCount, 1024, [this, packets, visible, &constants](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t packetIndex = begin; packetIndex < end; packetIndex++)
+			{
+				uint32_t i = visible ? visible[packetIndex] : packetIndex;
+				const SyntheticDraw& draw = m_Draws[i];
+				const float* world = m_DrawConstants[i].World;
+
+				DrawPacket& packet = packets[packetIndex];
+				packet.Pass = (uint8_t)draw.Pass;
+				packet.RootSignature = (uint8_t)draw.RootSignature;
+				packet.Pipeline = (uint16_t)draw.Pipeline;
+				packet.Material = (uint16_t)draw.Material;
+				packet.Depth = std::sqrt(world[12] * world[12] + world[13] * world[13] + world[14] * world[14]);
+				packet.Constants = constants.GPUAddress + (uint64_t)i * s_ConstantsStride;
+				packet.VertexCount = draw.VertexCount;
+				packet.InstanceCount = draw.InstanceCount;
+			}
+		});
+
+		if (m_Config.SortDraws)
+			m_DrawList.Sort(&m_JobSystem);
+		else
+			m_DrawList.BuildUnsorted();
+
+		const DrawListStats& stats = m_DrawList.GetStats();
+		m_DrawEncodeNs += stats.EncodeNs;
+		m_DrawSortNs += stats.SortNs;
+		m_DrawListFrames++;
+	}
+
+	//Writes the draws of HT::RecordDrawList into a null list. The ids become the made up API objects.
+	struct NullDrawSink
+	{
+		NullCommandList* CommandList;
+		const DrawConstants* Constants;
+		const UploadAllocation* Upload;
+
+		inline void SetRootSignature(uint32_t rootSignature) { CommandList->SetRootSignature(s_RootSignatureBase + rootSignature); }
+		inline void SetPipeline(uint32_t pipeline) { CommandList->SetPipelineState(s_DrawPipelineBase + pipeline); }
+		inline void SetMaterial(uint32_t material) { CommandList->SetDescriptorTable(1, s_MaterialTableBase + material * s_MaterialTableStride); }
+		inline void SetConstants(uint64_t gpuAddress) { CommandList->SetConstantBuffer(0, gpuAddress); }
+
+		//The constants of a draw are at the index of its SyntheticDraw, which is not the index of the packet when the draws are culled
+		inline void Draw(uint32_t, const DrawPacket& draw)
+		{
+			uint64_t offset = draw.Constants - Upload->GPUAddress;
+			memcpy(Upload->CPU + offset, &Constants[offset / s_ConstantsStride], sizeof(DrawConstants));
+			CommandList->Draw(draw.VertexCount, draw.InstanceCount, draw.StartVertex, draw.StartInstance);
+		}
+	};
+
+	uint32_t HeadlessRenderer::RecordDraws(const UploadAllocation& constants)
+	{
+		HT_PROFILE_FUNCTION();
+
+		uint32_t drawCount = m_DrawList.GetCount();
+		if (drawCount == 0)
+			return 0;
+
+		//The same split as HT::D3D12ParallelRecorder, but the chunk count doesn't depend on the threads.
+		//The chunks are ranges of the sorted draws, each one starts with nothing set.
+		uint32_t minDrawsPerChunk = HTUtils::HTMax(m_Config.MinDrawsPerChunk, 1u);
+		uint32_t chunkCount = HTUtils::HTMin((drawCount + minDrawsPerChunk - 1) / minDrawsPerChunk, (uint32_t)m_ChunkCommandLists.size());
+		uint32_t drawsPerChunk = (drawCount + chunkCount - 1) / chunkCount;
+		chunkCount = (drawCount + drawsPerChunk - 1) / drawsPerChunk;
+
+		uint64_t resourceHeap = m_DescriptorManager.GetTransientRing(DescriptorHeapType::CBV_SRV_UAV).GetHeap().Start.GPU;
+		uint64_t samplerHeap = m_DescriptorManager.GetTransientRing(DescriptorHeapType::Sampler).GetHeap().Start.GPU;
+		uint64_t renderTarget = m_BackBufferRTVs.At(m_CurrentBackBufferIndex).CPU;
+
+		JobCounter counter;
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			m_JobSystem.Run([this, &constants, chunk, chunkCount, drawsPerChunk, drawCount, resourceHeap, samplerHeap, renderTarget]()
+			{
+				m_ChunkCommandLists[chunk] = m_DirectCommandPool.Acquire();
+				NullCommandList* commandList = ToNullCommandList(m_ChunkCommandLists[chunk]);
+
+				//A list doesn't inherit anything from the previous one
+				commandList->SetDescriptorHeaps(resourceHeap, samplerHeap);
+				commandList->SetRenderTarget(renderTarget);
+
+				MarkResidentHeaps(chunk, chunkCount);
+
+				uint32_t begin = chunk * drawsPerChunk;
+				uint32_t end = HTUtils::HTMin(begin + drawsPerChunk, drawCount);
+
+				NullDrawSink sink = { commandList, m_DrawConstants.data(), &constants };
+				m_ChunkRecordStats[chunk] = RecordDrawList(m_DrawList, begin, end, sink);
+			}, &counter);
+		}
+
+		m_JobSystem.Wait(counter);
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+			m_DrawRecordStats += m_ChunkRecordStats[chunk];
+
+		return chunkCount;
+	}
+
+	void HeadlessRenderer::MarkResidentHeaps(uint32_t chunk, uint32_t chunkCount)
+	{
+		if (!m_ResidencyManager)
+			return;
+
+		//The window moves by one heap every 4 frames. Each chunk marks its share of it, like draws that use the textures of those heaps.
+		uint32_t heapCount = (uint32_t)m_HeapResidency.size();
+		uint32_t heapsPerFrame = HTUtils::HTMin(m_Config.ResidencyHeapsPerFrame, heapCount);
+		uint32_t windowBegin = (uint32_t)(m_FrameRing.GetFrameIndex() / 4);
+
+		for (uint32_t i = chunk; i < heapsPerFrame; i += chunkCount)
+			m_ResidencyManager->MarkUsed(m_HeapResidency[(windowBegin + i) % heapCount]);
+	}
+
+	QueueSyncPoint HeadlessRenderer::SubmitAsyncCompute()
+	{
+		if (m_Config.AsyncComputeDispatches == 0)
+			return {};
+
+		PooledCommandList computeCommandList = m_ComputeCommandPool.Acquire();
+		NullCommandList* commandList = ToNullCommandList(computeCommandList);
+
+		commandList->SetPipelineState(s_PassPipelineBase + m_Config.PassCount + 1);
+		for (uint32_t i = 0; i < m_Config.AsyncComputeDispatches; i++)
+			commandList->Dispatch(64, 1 + i % 8, 1);
+
+		commandList->Close();
+
+		void* submit = commandList;
+		QueueSyncPoint syncPoint = m_QueueScheduler.Submit(CommandQueueType::Compute, &submit, 1);
+
+		//The direct queue waits for this sync point, so it is signaled before the direct submission
+		m_ComputeCommandPool.Release(computeCommandList, syncPoint.FenceValue);
+		return syncPoint;
+	}
+
+	void HeadlessRenderer::FillResult(BenchmarkResult& result) const
+	{
+		result.ThreadCount = m_JobSystem.GetThreadCount();
+		result.Queues = m_QueueBackend.GetStats();
+		result.Scheduler = m_QueueScheduler.GetStats();
+		result.DirectPool = m_DirectCommandPool.GetStats();
+		result.ComputePool = m_ComputeCommandPool.GetStats();
+		result.Upload = m_UploadRing->GetStats();
+		result.FrameGraph = m_FrameGraph.GetStats();
+
+		result.DrawRecord = m_DrawRecordStats;
+		result.DrawEncodeNs = m_DrawEncodeNs;
+		result.DrawSortNs = m_DrawSortNs;
+		result.DrawListFrames = m_DrawListFrames;
+		result.DrawSort = m_DrawList.GetStats().Sort;
+		result.Scene = m_SceneStats;
+		result.SceneFrames = m_SceneFrames;
+		result.SceneMemory = m_Scene.GetMemoryStats();
+		result.Culling = m_CullingStats;
+		result.CulledFrames = m_CulledFrames;
+
+		if (m_GPUProfiler)
+		{
+			result.GPUProfiler = m_GPUProfiler->GetStats();
+			result.GPUScopes = m_GPUScopes;
+			result.GPUFrames = m_GPUFrames;
+			result.GPUFrameMs = m_GPUFrameMs;
+			result.GPUStartDelayMs = m_GPUStartDelayMs;
+		}
+
+		for (uint32_t i = 0; i < s_MaxFramesInFlight; i++)
+			result.FenceStallCount += m_FrameRing.GetSlot(i).StallCount;
+
+		if (m_ResidencyManager)
+			result.Residency = m_ResidencyManager->GetStats();
+
+		if (m_TextureStreamer)
+		{
+			result.Streaming = m_TextureStreamer->GetStats();
+			result.TextureLoadErrors = m_TextureLoadErrors;
+			result.SinkCopies = m_TextureSink.GetCopyCount();
+
+			//What reached the sink must be the bytes of the file
+			for (TextureHandle texture : m_Textures)
+			{
+				const DDSTexture& desc = m_TextureStreamer->GetTexture(texture);
+				uint32_t residentMip = m_TextureStreamer->GetResidentMip(texture);
+
+				if (residentMip < desc.MipCount && m_TextureSink.Verify(texture, desc, residentMip))
+					result.TexturesVerified++;
+			}
+		}
+	}
+
+	BenchmarkResult RunHeadlessBenchmark(const BenchmarkConfig& config)
+	{
+		BenchmarkResult result;
+		result.Config = config;
+
+		//The whole run goes in the trace, the setup and the warm up too
+		HT_PROFILE_THREAD("Frame Thread");
+		result.CPUTrace = !config.TracePath.empty() && CPUProfiler::Get().Start(config.TracePath);
+
+		//FrameStats is big (it keeps the history inline), it doesn't go on the stack
+		std::unique_ptr<FrameStats> frameStats = std::make_unique<FrameStats>();
+		std::unique_ptr<HeadlessRenderer> renderer;
+		{
+			HT_PROFILE_SCOPE("Init");
+			renderer = std::make_unique<HeadlessRenderer>(config, *frameStats);
+		}
+
+		for (uint32_t i = 0; i < config.WarmupFrames; i++)
+		{
+			HT_PROFILE_SCOPE("Warmup Frame");
+			renderer->Update();
+			renderer->Render();
+		}
+
+		frameStats->Reset();
+
+		std::vector<uint64_t> cpuFrameNs(config.FrameCount);
+
+		uint64_t begin = HTUtils::HTNowNanoseconds();
+
+		for (uint32_t i = 0; i < config.FrameCount; i++)
+		{
+			uint64_t frameBegin = HTUtils::HTNowNanoseconds();
+			HT_PROFILE_SCOPE("Frame");
+
+			renderer->Update();
+			renderer->Render();
+
+			cpuFrameNs[i] = HTUtils::HTNowNanoseconds() - frameBegin;
+		}
+
+		//The last frames are still "in flight", the time to execute them is part of the cost
+		renderer->Flush();
+
+		result.TotalNs = HTUtils::HTNowNanoseconds() - begin;
+		result.FramesPerSecond = result.TotalNs ? config.FrameCount * 1e9 / (double)result.TotalNs : 0.0;
+
+		for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+			result.Phases[p] = frameStats->Summarize((FramePhase)p);
+
+		renderer->FillResult(result);
+		renderer->SaveCapture(result);
+
+		if (result.CPUTrace)
+		{
+			CPUProfiler::Get().Stop();
+			result.CPUProfiler = CPUProfiler::Get().GetStats();
+		}
+
+		//The null GPU runs lazily inside the fence waits, so the measured frame is the CPU cost plus walking the commands. It is good enough for the model.
+		PresentModelConfig modelConfig;
+		modelConfig.BackBufferCount = s_BackBufferCount;
+		modelConfig.FramesInFlight = config.FramesInFlight;
+		modelConfig.MaxFrameLatency = config.MaxFrameLatency;
+		modelConfig.FrameCount = config.FrameCount;
+
+		uint64_t modelGPUNs = config.ModelGPUMicroseconds * 1000ull;
+
+		for (uint32_t p = 0; p < 2; p++)
+		{
+			modelConfig.Policy = (PresentLatencyPolicy)p;
+
+			PresentQueueModel model(modelConfig, [&cpuFrameNs](uint64_t frameIndex) { return cpuFrameNs[frameIndex]; }, [modelGPUNs](uint64_t) { return modelGPUNs; });
+			model.Run();
+
+			//The first frames fill the queue
+			result.PresentModels[p] = model.Summarize(HTUtils::HTMin(config.FrameCount / 10, 60u));
+		}
+
+		return result;
+	}
+
+	std::vector<BenchmarkResult> RunBenchmarkScaling(const BenchmarkConfig& config)
+	{
+		std::vector<BenchmarkResult> results;
+
+		BenchmarkConfig runConfig = config;
+		runConfig.TracePath.clear();
+		runConfig.CapturePath.clear();
+
+		for (uint32_t threads = 1; threads <= config.ScalingThreads; threads++)
+		{
+			runConfig.ThreadCount = threads;
+			results.push_back(RunHeadlessBenchmark(runConfig));
+		}
+
+		return results;
+	}
+
+	CaptureReplayResult RunCaptureReplay(const BenchmarkConfig& config)
+	{
+		CaptureReplayResult result;
+		result.Path = config.ReplayPath;
+
+		CommandCaptureReader capture;
+		if (!capture.Load(config.ReplayPath, result.Error))
+			return result;
+
+		result.Header = capture.GetHeader();
+		result.FileSize = capture.GetFileSize();
+
+		//The backends go before the replay, the pools it creates are destroyed first
+		NullQueueBackend queueBackend;
+		NullCommandPoolBackend commandPoolBackend;
+		NullCaptureRecorder recorder;
+
+		result.Replayed = ReplayCommandCapture(capture, &queueBackend, &commandPoolBackend, &recorder, result.Replay, result.Error);
+		result.Queues = queueBackend.GetStats();
+
+		return result;
+	}
+
+	void WriteCaptureReplayJSON(const CaptureReplayResult& result, std::ostream& stream)
+	{
+		const CaptureReplayStats& replay = result.Replay;
+		const NullQueueStats& queues = result.Queues;
+
+		char checksum[17];
+		snprintf(checksum, sizeof(checksum), "%016llx", (unsigned long long)queues.Checksum);
+
+		double replayMs = HTUtils::HTNanosecondsToMilliseconds(replay.ReplayNs);
+		double replaySeconds = (double)HTUtils::HTMax<uint64_t>(replay.ReplayNs, 1) * 1e-9;
+
+		stream << "{\n";
+		stream << "\t\"capture\": { ";
+		stream << "\"path\": \"" << result.Path << "\", ";
+		stream << "\"version\": " << result.Header.Version << ", ";
+		stream << "\"fileBytes\": " << result.FileSize << ", ";
+		stream << "\"streamBytes\": " << result.Header.StreamSize << ", ";
+		stream << "\"packets\": " << result.Header.PacketCount << ", ";
+		stream << "\"handles\": " << result.Header.HandleCount << " },\n";
+
+		stream << "\t\"replayed\": " << (result.Replayed ? "true" : "false") << ",\n";
+		if (!result.Error.empty())
+			stream << "\t\"error\": \"" << result.Error << "\",\n";
+
+		stream << "\t\"replay\": { ";
+		stream << "\"frames\": " << replay.Frames << ", ";
+		stream << "\"commandLists\": " << replay.CommandLists << ", ";
+		stream << "\"commands\": " << replay.Commands << ", ";
+		stream << "\"submissions\": " << replay.Submissions << ", ";
+		stream << "\"signals\": " << replay.Signals << ", ";
+		stream << "\"waits\": " << replay.Waits << ", ";
+		stream << "\"cpuWaits\": " << replay.CPUWaits << ", ";
+		stream << "\"presents\": " << replay.Presents << ", ";
+		stream << "\"skippedWaits\": " << replay.SkippedWaits << ", ";
+		stream << "\"fenceMismatches\": " << replay.FenceMismatches << ", ";
+		stream << "\"totalMs\": " << replayMs << ", ";
+		stream << "\"avgFrameMs\": " << replayMs / (double)HTUtils::HTMax(replay.Frames, 1u) << ", ";
+		stream << "\"commandsPerSecond\": " << (double)replay.Commands / replaySeconds << " },\n";
+
+		stream << "\t\"gpu\": { ";
+		stream << "\"executedLists\": " << queues.ExecutedCommandLists << ", ";
+		stream << "\"executedCommands\": " << queues.ExecutedCommands << ", ";
+		stream << "\"draws\": " << queues.Draws << ", ";
+		stream << "\"dispatches\": " << queues.Dispatches << ", ";
+		stream << "\"barriers\": " << queues.Barriers << ", ";
+		stream << "\"checksum\": \"" << checksum << "\" }\n";
+		stream << "}\n";
+	}
+
+	void WriteBenchmarkScalingJSON(const std::vector<BenchmarkResult>& results, std::ostream& stream)
+	{
+		if (results.empty())
+		{
+			stream << "{ \"runs\": [] }\n";
+			return;
+		}
+
+		const BenchmarkConfig& config = results[0].Config;
+		const BenchmarkResult& single = results[0];
+
+		bool sameChecksum = true;
+		for (const BenchmarkResult& result : results)
+			sameChecksum &= result.Queues.Checksum == single.Queues.Checksum;
+
+		stream << "{\n";
+		stream << "\t\"config\": { ";
+		stream << "\"frames\": " << config.FrameCount << ", ";
+		stream << "\"warmupFrames\": " << config.WarmupFrames << ", ";
+		stream << "\"draws\": " << config.DrawCount << ", ";
+		stream << "\"maxChunks\": " << config.MaxChunks << ", ";
+		stream << "\"culling\": " << (config.Culling ? "true" : "false") << ", ";
+		stream << "\"maxThreads\": " << config.ScalingThreads << ", ";
+		stream << "\"hardwareThreads\": " << std::thread::hardware_concurrency() << " },\n";
+		stream << "\t\"sameChecksum\": " << (sameChecksum ? "true" : "false") << ",\n";
+		stream << "\t\"runs\": [\n";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& result = results[i];
+			const FramePhaseSummary& frame = result.Phases[(uint32_t)FramePhase::Frame];
+			const FramePhaseSummary& record = result.Phases[(uint32_t)FramePhase::Record];
+			const FramePhaseSummary& cull = result.Phases[(uint32_t)FramePhase::Cull];
+
+			//Of the whole measured run, so the fence waits and the flush at the end count too
+			double speedup = (double)single.TotalNs / (double)HTUtils::HTMax<uint64_t>(result.TotalNs, 1);
+
+			stream << "\t\t{ ";
+			stream << "\"threads\": " << result.ThreadCount << ", ";
+			stream << "\"totalMs\": " << HTUtils::HTNanosecondsToMilliseconds(result.TotalNs) << ", ";
+			stream << "\"framesPerSecond\": " << result.FramesPerSecond << ", ";
+			stream << "\"avgFrameMs\": " << frame.AverageMs << ", ";
+			stream << "\"p50FrameMs\": " << frame.P50Ms << ", ";
+			stream << "\"p99FrameMs\": " << frame.P99Ms << ", ";
+			stream << "\"avgCullMs\": " << cull.AverageMs << ", ";
+			stream << "\"avgRecordMs\": " << record.AverageMs << ", ";
+			stream << "\"speedup\": " << speedup << ", ";
+			stream << "\"efficiency\": " << speedup / (double)HTUtils::HTMax(result.ThreadCount, 1u) << " }";
+			stream << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		stream << "\t]\n";
+		stream << "}\n";
+	}
+
+	void WriteBenchmarkJSON(const BenchmarkResult& result, std::ostream& stream)
+	{
+		const BenchmarkConfig& config = result.Config;
+
+		stream << "{\n";
+		stream << "\t\"config\": { ";
+		stream << "\"frames\": " << config.FrameCount << ", ";
+		stream << "\"warmupFrames\": " << config.WarmupFrames << ", ";
+		stream << "\"draws\": " << config.DrawCount << ", ";
+		stream << "\"minDrawsPerChunk\": " << config.MinDrawsPerChunk << ", ";
+		stream << "\"maxChunks\": " << config.MaxChunks << ", ";
+		stream << "\"pipelines\": " << config.PipelineCount << ", ";
+		stream << "\"rootSignatures\": " << config.RootSignatureCount << ", ";
+		stream << "\"materials\": " << config.MaterialCount << ", ";
+		stream << "\"sortDraws\": " << (config.SortDraws ? "true" : "false") << ", ";
+		stream << "\"sceneGroups\": " << config.SceneGroups << ", ";
+		stream << "\"spinningGroups\": " << config.SpinningGroups << ", ";
+		stream << "\"movingDrawPercent\": " << config.MovingDrawPercent << ", ";
+		stream << "\"gpuProfiling\": " << (config.GPUProfiling ? "true" : "false") << ", ";
+		stream << "\"culling\": " << (config.Culling ? "true" : "false") << ", ";
+		stream << "\"occluders\": " << config.OccluderCount << ", ";
+		stream << "\"cullLevel\": \"" << HTUtils::HTMathLevelName(config.CullLevel) << "\", ";
+		stream << "\"passes\": " << config.PassCount << ", ";
+		stream << "\"resourcesPerPass\": " << config.ResourcesPerPass << ", ";
+		stream << "\"asyncComputeDispatches\": " << config.AsyncComputeDispatches << ", ";
+		stream << "\"threads\": " << result.ThreadCount << ", ";
+		stream << "\"framesInFlight\": " << config.FramesInFlight << ", ";
+		stream << "\"pacingMode\": \"" << (config.PacingMode == FramePacingMode::LowLatency ? "low_latency" : "high_throughput") << "\", ";
+		stream << "\"seed\": " << config.Seed << ", ";
+		stream << "\"modelGPUMicroseconds\": " << config.ModelGPUMicroseconds << ", ";
+		stream << "\"maxFrameLatency\": " << config.MaxFrameLatency << ", ";
+		stream << "\"residencyHeaps\": " << config.ResidencyHeapCount << ", ";
+		stream << "\"residencyHeapMB\": " << config.ResidencyHeapMB << ", ";
+		stream << "\"residencyHeapsPerFrame\": " << config.ResidencyHeapsPerFrame << ", ";
+		stream << "\"residencyBudgetMB\": " << config.ResidencyBudgetMB << ", ";
+		stream << "\"streamBudgetKB\": " << config.StreamBudgetKB << ", ";
+		stream << "\"streamUploadMB\": " << config.StreamUploadMB << " },\n";
+
+		stream << "\t\"totalMs\": " << HTUtils::HTNanosecondsToMilliseconds(result.TotalNs) << ",\n";
+		stream << "\t\"framesPerSecond\": " << result.FramesPerSecond << ",\n";
+		stream << "\t\"phases\": {\n";
+
+		for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+		{
+			const FramePhaseSummary& summary = result.Phases[p];
+
+			stream << "\t\t\"" << FramePhaseName((FramePhase)p) << "\": { ";
+			stream << "\"avgMs\": " << summary.AverageMs << ", ";
+			stream << "\"p50Ms\": " << summary.P50Ms << ", ";
+			stream << "\"p95Ms\": " << summary.P95Ms << ", ";
+			stream << "\"p99Ms\": " << summary.P99Ms << ", ";
+			stream << "\"maxMs\": " << summary.MaxMs << ", ";
+			stream << "\"samples\": " << summary.SampleCount << " }";
+			stream << (p + 1 < (uint32_t)FramePhase::Count ? "," : "") << "\n";
+		}
+
+		stream << "\t},\n";
+
+		//The checksum is a string, JSON numbers are doubles for most readers and they can't hold 64 bits
+		const NullQueueStats& queues = result.Queues;
+		char checksum[17];
+		snprintf(checksum, sizeof(checksum), "%016llx", (unsigned long long)queues.Checksum);
+
+		stream << "\t\"gpu\": { ";
+		stream << "\"commandLists\": " << queues.ExecutedCommandLists << ", ";
+		stream << "\"commands\": " << queues.ExecutedCommands << ", ";
+		stream << "\"bytes\": " << queues.ExecutedBytes << ", ";
+		stream << "\"draws\": " << queues.Draws << ", ";
+		stream << "\"dispatches\": " << queues.Dispatches << ", ";
+		stream << "\"timestamps\": " << queues.Timestamps << ", ";
+		stream << "\"barriers\": " << queues.Barriers << ", ";
+		stream << "\"signals\": " << queues.Signals << ", ";
+		stream << "\"waits\": " << queues.Waits << ", ";
+		stream << "\"checksum\": \"" << checksum << "\" },\n";
+
+		const GPUProfilerStats& gpuProfiler = result.GPUProfiler;
+		double gpuFrames = (double)HTUtils::HTMax(result.GPUFrames, 1u);
+		stream << "\t\"gpuProfiler\": { ";
+		stream << "\"frames\": " << result.GPUFrames << ", ";
+		stream << "\"skippedFrames\": " << gpuProfiler.FramesSkipped << ", ";
+		stream << "\"droppedScopes\": " << gpuProfiler.ScopesDropped << ", ";
+		stream << "\"avgLatencyFrames\": " << (double)gpuProfiler.TotalLatencyFrames / (double)HTUtils::HTMax<uint64_t>(gpuProfiler.FramesResolved, 1) << ", ";
+		stream << "\"maxLatencyFrames\": " << gpuProfiler.MaxLatencyFrames << ", ";
+		stream << "\"avgFrameMs\": " << result.GPUFrameMs / gpuFrames << ", ";
+		stream << "\"avgStartDelayMs\": " << result.GPUStartDelayMs / gpuFrames << ", ";
+		stream << "\"scopes\": { ";
+
+		for (size_t i = 0; i < result.GPUScopes.size(); i++)
+		{
+			const BenchmarkResult::GPUScopeSummary& scope = result.GPUScopes[i];
+			stream << (i ? ", " : "") << "\"" << scope.Name << "\": { \"depth\": " << scope.Depth << ", \"avgMs\": " << scope.TotalMs / (double)HTUtils::HTMax<uint64_t>(scope.Count, 1) << " }";
+		}
+
+		stream << " } },\n";
+
+		const CPUProfilerStats& cpuProfiler = result.CPUProfiler;
+		stream << "\t\"cpuProfiler\": { ";
+		stream << "\"trace\": " << (result.CPUTrace ? "true" : "false") << ", ";
+		stream << "\"events\": " << cpuProfiler.EventsWritten << ", ";
+		stream << "\"dropped\": " << cpuProfiler.EventsDropped << ", ";
+		stream << "\"flushes\": " << cpuProfiler.Flushes << ", ";
+		stream << "\"threads\": " << cpuProfiler.Threads << " },\n";
+
+		const CommandCaptureStats& capture = result.Capture;
+		stream << "\t\"capture\": { ";
+		stream << "\"written\": " << (result.Captured ? "true" : "false") << ", ";
+		stream << "\"frames\": " << capture.Frames << ", ";
+		stream << "\"commandLists\": " << capture.CommandLists << ", ";
+		stream << "\"commands\": " << capture.Commands << ", ";
+		stream << "\"handles\": " << capture.Handles << ", ";
+		stream << "\"commandBytes\": " << capture.CommandBytes << ", ";
+		stream << "\"streamBytes\": " << capture.StreamBytes << " },\n";
+
+		stream << "\t\"scheduler\": { ";
+		stream << "\"submissions\": " << result.Scheduler.Submissions << ", ";
+		stream << "\"signals\": " << result.Scheduler.Signals << ", ";
+		stream << "\"waits\": " << result.Scheduler.Waits << ", ";
+		stream << "\"skippedWaits\": " << result.Scheduler.SkippedWaits << " },\n";
+
+		stream << "\t\"commandPools\": { ";
+		stream << "\"directAllocators\": " << result.DirectPool.AllocatorCount << ", ";
+		stream << "\"directPeakInUse\": " << result.DirectPool.PeakAllocatorsInUse << ", ";
+		stream << "\"computeAllocators\": " << result.ComputePool.AllocatorCount << ", ";
+		stream << "\"computePeakInUse\": " << result.ComputePool.PeakAllocatorsInUse << " },\n";
+
+		stream << "\t\"upload\": { ";
+		stream << "\"capacity\": " << result.Upload.Capacity << ", ";
+		stream << "\"peakUsed\": " << result.Upload.PeakUsed << ", ";
+		stream << "\"overflows\": " << result.Upload.OverflowCount << " },\n";
+
+		stream << "\t\"frameGraph\": { ";
+		stream << "\"passes\": " << result.FrameGraph.DeclaredPasses << ", ";
+		stream << "\"culledPasses\": " << result.FrameGraph.CulledPasses << ", ";
+		stream << "\"transientResources\": " << result.FrameGraph.TransientResources << ", ";
+		stream << "\"transientBytes\": " << result.FrameGraph.TransientBytesWithoutAliasing << ", ";
+		stream << "\"aliasedBytes\": " << result.FrameGraph.TransientBytesWithAliasing << " },\n";
+
+		stream << "\t\"presentModel\": {\n";
+
+		for (uint32_t p = 0; p < 2; p++)
+		{
+			const PresentModelSummary& model = result.PresentModels[p];
+
+			stream << "\t\t\"" << PresentLatencyPolicyName((PresentLatencyPolicy)p) << "\": { ";
+			stream << "\"avgLatencyMs\": " << model.AverageLatencyMs << ", ";
+			stream << "\"p50LatencyMs\": " << model.P50LatencyMs << ", ";
+			stream << "\"p99LatencyMs\": " << model.P99LatencyMs << ", ";
+			stream << "\"maxLatencyMs\": " << model.MaxLatencyMs << ", ";
+			stream << "\"avgInputToPresentMs\": " << model.AverageInputToPresentMs << ", ";
+			stream << "\"avgCPUBlockedMs\": " << model.AverageCPUBlockedMs << ", ";
+			stream << "\"framesPerSecond\": " << model.FramesPerSecond << ", ";
+			stream << "\"repeatedRefreshes\": " << model.RepeatedRefreshes << " }";
+			stream << (p + 1 < 2 ? "," : "") << "\n";
+		}
+
+		stream << "\t},\n";
+
+		const SceneUpdateStats& scene = result.Scene;
+		const SceneMemoryStats& sceneMemory = result.SceneMemory;
+		double sceneFrames = (double)HTUtils::HTMax(result.SceneFrames, 1u);
+		stream << "\t\"scene\": { ";
+		stream << "\"entities\": " << sceneMemory.Entities << ", ";
+		stream << "\"levels\": " << scene.Levels << ", ";
+		stream << "\"archetypes\": " << sceneMemory.Archetypes << ", ";
+		stream << "\"avgLocalDirty\": " << (double)scene.LocalDirty / sceneFrames << ", ";
+		stream << "\"avgWorldChanged\": " << (double)scene.WorldChanged / sceneFrames << ", ";
+		stream << "\"avgUpdateMs\": " << HTUtils::HTNanosecondsToMilliseconds(scene.UpdateNs) / sceneFrames << ", ";
+		stream << "\"avgReorderMs\": " << HTUtils::HTNanosecondsToMilliseconds(scene.ReorderNs) / sceneFrames << ", ";
+		stream << "\"nsPerEntity\": " << (double)scene.UpdateNs / sceneFrames / (double)HTUtils::HTMax(scene.Transforms, 1u) << ", ";
+		stream << "\"nsPerChangedTransform\": " << (double)scene.UpdateNs / (double)HTUtils::HTMax(scene.WorldChanged, 1u) << ", ";
+		stream << "\"bytesPerEntity\": " << (double)sceneMemory.GetTotalBytes() / (double)HTUtils::HTMax(sceneMemory.Entities, 1u) << ", ";
+		stream << "\"entityKB\": " << (sceneMemory.EntityBytes >> 10) << ", ";
+		stream << "\"transformKB\": " << (sceneMemory.TransformBytes >> 10) << ", ";
+		stream << "\"componentKB\": " << (sceneMemory.ComponentBytes >> 10) << " },\n";
+
+		const CullingStats& culling = result.Culling;
+		double culledFrames = (double)HTUtils::HTMax(result.CulledFrames, 1u);
+		stream << "\t\"culling\": { ";
+		stream << "\"frames\": " << result.CulledFrames << ", ";
+		stream << "\"avgObjects\": " << (double)culling.Objects / culledFrames << ", ";
+		stream << "\"avgFrustumVisible\": " << (double)culling.FrustumVisible / culledFrames << ", ";
+		stream << "\"avgOcclusionCulled\": " << (double)culling.OcclusionCulled / culledFrames << ", ";
+		stream << "\"avgVisible\": " << (double)culling.Visible / culledFrames << ", ";
+		stream << "\"avgRasterizedOccluders\": " << (double)culling.RasterizedOccluders / culledFrames << ", ";
+		stream << "\"avgFrustumMs\": " << HTUtils::HTNanosecondsToMilliseconds(culling.FrustumNs) / culledFrames << ", ";
+		stream << "\"avgRasterMs\": " << HTUtils::HTNanosecondsToMilliseconds(culling.RasterNs) / culledFrames << ", ";
+		stream << "\"avgOcclusionMs\": " << HTUtils::HTNanosecondsToMilliseconds(culling.OcclusionNs) / culledFrames << " },\n";
+
+		const DrawRecordStats& drawRecord = result.DrawRecord;
+		double drawListFrames = (double)HTUtils::HTMax(result.DrawListFrames, 1u);
+		stream << "\t\"drawSorting\": { ";
+		stream << "\"avgEncodeMs\": " << HTUtils::HTNanosecondsToMilliseconds(result.DrawEncodeNs) / drawListFrames << ", ";
+		stream << "\"avgSortMs\": " << HTUtils::HTNanosecondsToMilliseconds(result.DrawSortNs) / drawListFrames << ", ";
+		stream << "\"radixPasses\": " << result.DrawSort.Passes << ", ";
+		stream << "\"skippedRadixPasses\": " << result.DrawSort.SkippedPasses << ", ";
+		stream << "\"sortChunks\": " << result.DrawSort.Chunks << ", ";
+		stream << "\"avgStateChanges\": " << (double)drawRecord.GetStateChanges() / drawListFrames << ", ";
+		stream << "\"avgRootSignatureChanges\": " << (double)drawRecord.RootSignatureChanges / drawListFrames << ", ";
+		stream << "\"avgPipelineChanges\": " << (double)drawRecord.PipelineChanges / drawListFrames << ", ";
+		stream << "\"avgMaterialChanges\": " << (double)drawRecord.MaterialChanges / drawListFrames << ", ";
+		stream << "\"avgSkippedChanges\": " << (double)drawRecord.SkippedChanges / drawListFrames << " },\n";
+
+		const ResidencyStats& residency = result.Residency;
+		stream << "\t\"residency\": { ";
+		stream << "\"heaps\": " << residency.HeapCount << ", ";
+		stream << "\"evictedHeaps\": " << residency.EvictedHeapCount << ", ";
+		stream << "\"residentMB\": " << (residency.ResidentBytes[(uint32_t)MemorySegment::Local] >> 20) << ", ";
+		stream << "\"heapsEvicted\": " << residency.HeapsEvicted << ", ";
+		stream << "\"heapsMadeResident\": " << residency.HeapsMadeResident << ", ";
+		stream << "\"evictCalls\": " << residency.EvictCalls << ", ";
+		stream << "\"makeResidentCalls\": " << residency.MakeResidentCalls << ", ";
+		stream << "\"overBudgetFrames\": " << residency.OverBudgetFrames << " },\n";
+
+		const TextureStreamerStats& streaming = result.Streaming;
+		stream << "\t\"streaming\": { ";
+		stream << "\"textures\": " << streaming.TextureCount << ", ";
+		stream << "\"loadErrors\": " << result.TextureLoadErrors << ", ";
+		stream << "\"verified\": " << result.TexturesVerified << ", ";
+		stream << "\"atWantedMip\": " << streaming.FullyStreamedCount << ", ";
+		stream << "\"pendingReads\": " << streaming.PendingRequests << ", ";
+		stream << "\"reads\": " << streaming.Requests << ", ";
+		stream << "\"copies\": " << result.SinkCopies << ", ";
+		stream << "\"readMB\": " << (double)streaming.BytesRead / (1024.0 * 1024.0) << ", ";
+		stream << "\"uploadedMB\": " << (double)streaming.BytesUploaded / (1024.0 * 1024.0) << ", ";
+		stream << "\"readMs\": " << HTUtils::HTNanosecondsToMilliseconds(streaming.ReadNs) << ", ";
+		stream << "\"peakFrameKB\": " << (streaming.PeakFrameBytes >> 10) << ", ";
+		stream << "\"uploadFullFrames\": " << streaming.UploadMemoryFullFrames << " },\n";
+
+		stream << "\t\"fenceStalls\": " << result.FenceStallCount << "\n";
+		stream << "}\n";
+	}
+
+	bool ParseBenchmarkArguments(int argc, const char* const* argv, BenchmarkConfig& outConfig, std::string& outOutputPath, std::string& outError)
+	{
+		struct NumberOption
+		{
+			const char* Name;
+			uint32_t* Value;
+		};
+
+		const NumberOption numberOptions[] =
+		{
+			{ "--frames",           &outConfig.FrameCount },
+			{ "--warmup",           &outConfig.WarmupFrames },
+			{ "--draws",            &outConfig.DrawCount },
+			{ "--draws-per-chunk",  &outConfig.MinDrawsPerChunk },
+			{ "--max-chunks",       &outConfig.MaxChunks },
+			{ "--pipelines",        &outConfig.PipelineCount },
+			{ "--root-signatures",  &outConfig.RootSignatureCount },
+			{ "--materials",        &outConfig.MaterialCount },
+			{ "--occluders",        &outConfig.OccluderCount },
+			{ "--groups",           &outConfig.SceneGroups },
+			{ "--spinning-groups",  &outConfig.SpinningGroups },
+			{ "--moving-percent",   &outConfig.MovingDrawPercent },
+			{ "--passes",           &outConfig.PassCount },
+			{ "--resources",        &outConfig.ResourcesPerPass },
+			{ "--compute",          &outConfig.AsyncComputeDispatches },
+			{ "--threads",          &outConfig.ThreadCount },
+			{ "--scaling",          &outConfig.ScalingThreads },
+			{ "--frames-in-flight", &outConfig.FramesInFlight },
+			{ "--heaps",            &outConfig.ResidencyHeapCount },
+			{ "--heap-mb",          &outConfig.ResidencyHeapMB },
+			{ "--heaps-per-frame",  &outConfig.ResidencyHeapsPerFrame },
+			{ "--budget-mb",        &outConfig.ResidencyBudgetMB },
+			{ "--stream-budget-kb", &outConfig.StreamBudgetKB },
+			{ "--stream-upload-mb", &outConfig.StreamUploadMB },
+			{ "--seed",             &outConfig.Seed },
+			{ "--model-gpu-us",     &outConfig.ModelGPUMicroseconds },
+			{ "--max-latency",      &outConfig.MaxFrameLatency },
+		};
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+
+			if (argument == "--low-latency")
+			{
+				outConfig.PacingMode = FramePacingMode::LowLatency;
+				continue;
+			}
+
+			if (argument == "--no-sort")
+			{
+				outConfig.SortDraws = false;
+				continue;
+			}
+
+			if (argument == "--no-gpu-profile")
+			{
+				outConfig.GPUProfiling = false;
+				continue;
+			}
+
+			if (argument == "--cull")
+			{
+				outConfig.Culling = true;
+				continue;
+			}
+
+			//Everything else has a value
+			if (i + 1 >= argc)
+			{
+				outError = "Missing the value of " + argument;
+				return false;
+			}
+
+			const char* value = argv[++i];
+
+			if (argument == "--output")
+			{
+				outOutputPath = value;
+				continue;
+			}
+
+			if (argument == "--trace")
+			{
+				outConfig.TracePath = value;
+				continue;
+			}
+
+			if (argument == "--capture")
+			{
+				outConfig.CapturePath = value;
+				continue;
+			}
+
+			if (argument == "--replay")
+			{
+				outConfig.ReplayPath = value;
+				continue;
+			}
+
+			if (argument == "--textures")
+			{
+				outConfig.TextureDirectory = value;
+				continue;
+			}
+
+			if (argument == "--cull-level")
+			{
+				uint32_t level = 0;
+				while (level < (uint32_t)HTUtils::HTMathLevel::Count && strcmp(value, HTUtils::HTMathLevelName((HTUtils::HTMathLevel)level)) != 0)
+					level++;
+
+				if (level == (uint32_t)HTUtils::HTMathLevel::Count || !HTUtils::HTIsMathLevelSupported((HTUtils::HTMathLevel)level))
+				{
+					outError = std::string("Unknown or unsupported math level: ") + value;
+					return false;
+				}
+
+				outConfig.CullLevel = (HTUtils::HTMathLevel)level;
+				continue;
+			}
+
+			bool found = false;
+			for (const NumberOption& option : numberOptions)
+			{
+				if (argument != option.Name)
+					continue;
+
+				char* end = nullptr;
+				unsigned long number = strtoul(value, &end, 10);
+
+				if (end == value || *end != '\0')
+				{
+					outError = "Invalid number for " + argument + ": " + value;
+					return false;
+				}
+
+				*option.Value = (uint32_t)number;
+				found = true;
+				break;
+			}
+
+			if (!found)
+			{
+				outError = "Unknown argument " + argument;
+				return false;
+			}
+		}
+
+		if (outConfig.FramesInFlight < 1 || outConfig.FramesInFlight > s_MaxFramesInFlight)
+		{
+			outError = "--frames-in-flight must be between 1 and " + std::to_string(s_MaxFramesInFlight);
+			return false;
+		}
+
+		//The DXGI limit of SetMaximumFrameLatency
+		if (outConfig.MaxFrameLatency < 1 || outConfig.MaxFrameLatency > 16)
+		{
+			outError = "--max-latency must be between 1 and 16";
+			return false;
+		}
+
+		if (outConfig.PassCount > 0 && outConfig.ResourcesPerPass == 0)
+		{
+			outError = "--resources must be at least 1 when there are passes";
+			return false;
+		}
+
+		return true;
+	}
+}
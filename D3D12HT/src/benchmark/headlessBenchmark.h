@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <core/cpuProfiler.h>
+#include <core/frameStats.h>
+#include <renderer/commandCapture.h>
+#include <renderer/commandPool.h>
+#include <renderer/drawList.h>
+#include <renderer/frameGraph.h>
+#include <renderer/frameRing.h>
+#include <renderer/gpuProfiler.h>
+#include <renderer/presentQueueModel.h>
+#include <renderer/queueScheduler.h>
+#include <renderer/residencyManager.h>
+#include <renderer/textureStreamer.h>
+#include <renderer/uploadRing.h>
+#include <renderer/visibilityCuller.h>
+#include <renderer/null/nullQueueBackend.h>
+#include <scene/sceneStore.h>
+
+namespace HT
+{
+	//What a benchmark frame does. Everything is generated from the seed, so the same config always records the same commands.
+	struct BenchmarkConfig
+	{
+		uint32_t FrameCount   = 1000;
+
+		//Frames run before we start measuring (the pools, rings and caches grow in the first frames)
+		uint32_t WarmupFrames = 100;
+
+		//Scene draws, recorded in parallel in chunks of at least MinDrawsPerChunk draws and at most MaxChunks lists.
+		//The renderer has one chunk per thread at most, here it is fixed so the recorded commands don't depend on the machine.
+		uint32_t DrawCount        = 10000;
+		uint32_t MinDrawsPerChunk = 256;
+		uint32_t MaxChunks        = 8;
+
+		//How many different pipelines the draws switch between. Every pipeline belongs to one of the root signatures, and every draw has one of the materials (a descriptor table).
+		uint32_t PipelineCount = 32;
+		uint32_t RootSignatureCount = 4;
+		uint32_t MaterialCount = 256;
+
+		//The draws go through a HT::DrawList sorted by state (and by depth, every 8th draw is transparent and goes back to front after the others).
+		//false = they are recorded in the order they were generated, to see what the sort saves.
+		bool SortDraws = true;
+
+		//The draws are boxes culled by HT::VisibilityCuller against a camera that turns around the middle of the scene, only the visible ones are recorded.
+		//OccluderCount walls are added to the scene for the occlusion test (0 = frustum only). CullLevel is the SIMD of the frustum test.
+		bool Culling = false;
+		uint32_t OccluderCount = 0;
+		HTUtils::HTMathLevel CullLevel = HTUtils::HTGetMathLevel();
+
+		//The draws are entities of a HT::SceneStore: a root, SceneGroups groups under it and the draws under the groups (one after the other).
+		//Every frame SpinningGroups groups turn (and everything under them with them) and MovingDrawPercent of the draws turn on themselves,
+		//the rest doesn't move, so only the transforms under those are computed and copied to the constants again.
+		uint32_t SceneGroups = 16;
+		uint32_t SpinningGroups = 2;
+		uint32_t MovingDrawPercent = 10;
+
+		//The frame, its passes and the draws are timed by a HT::GPUProfiler. The null queue writes the timestamps when it executes the lists,
+		//so the GPU times are the time the null GPU took to walk the commands.
+		bool GPUProfiling = true;
+
+		//The CPU scopes of the whole run (and the GPU scopes, on their own track) are written to this file as a Chrome trace by HT::CPUProfiler.
+		//Empty = no trace. In Dist the scopes compile to nothing, so the trace is empty.
+		std::string TracePath;
+
+		//Everything the renderer sends to the queues, from the first frame to the flush at the end, is captured (HT::CommandCaptureWriter) and written to this file.
+		//--replay runs it again on new null queues, the checksum is the same as the one of the run that was captured. Empty = no capture.
+		std::string CapturePath;
+
+		//Instead of running the frames, the capture of this file is replayed. The other options are ignored.
+		std::string ReplayPath;
+
+		//Frame graph passes before the one that writes the back buffer, each one writes ResourcesPerPass transient resources and reads the ones of the previous pass
+		uint32_t PassCount        = 8;
+		uint32_t ResourcesPerPass = 2;
+
+		//Dispatches submitted to the compute queue every frame. The direct queue waits for them. 0 = no async compute.
+		uint32_t AsyncComputeDispatches = 0;
+
+		//Threads of the job system, including the thread that runs the frames. 0 = one per hardware thread, 1 = the frame thread alone (no workers).
+		uint32_t ThreadCount = 0;
+
+		//The frames are run once for every thread count from 1 to ScalingThreads (ThreadCount is ignored), to see how the frame scales with the threads.
+		//The trace and the capture are not written in these runs. 0 = a single run.
+		uint32_t ScalingThreads = 0;
+
+		uint32_t FramesInFlight = 3;
+		FramePacingMode PacingMode = FramePacingMode::HighThroughput;
+
+		//Heaps of ResidencyHeapMB in local memory. Each frame uses a window of ResidencyHeapsPerFrame of them that moves by one heap every few frames
+		//(like a camera going through a level). With a budget smaller than all the heaps, the residency manager evicts the ones left behind.
+		//0 heaps = no residency manager.
+		uint32_t ResidencyHeapCount     = 0;
+		uint32_t ResidencyHeapMB        = 64;
+		uint32_t ResidencyHeapsPerFrame = 8;
+		uint32_t ResidencyBudgetMB      = 1024;
+
+		//The DDS files of this directory are streamed by HT::TextureStreamer into CPU memory (the upload is a HT::CPUTextureUploadSink).
+		//The textures stand on a line and the camera goes along it during the run, so their size on screen (and the mips they want) keep changing.
+		//Empty = no streaming.
+		std::string TextureDirectory;
+		uint32_t StreamBudgetKB = 8192;
+		uint32_t StreamUploadMB = 64;
+
+		uint32_t Seed = 1;
+
+		//The measured CPU frame times are fed to HT::PresentQueueModel with this GPU time, once per latency policy.
+		//There is no display here, so this is how we see what the frame would cost in input lag.
+		uint32_t ModelGPUMicroseconds = 8000;
+		uint32_t MaxFrameLatency = 1;
+	};
+
+	struct BenchmarkResult
+	{
+		BenchmarkConfig Config;
+		uint32_t ThreadCount = 0;
+
+		//Of the measured frames only
+		uint64_t TotalNs = 0;
+		double FramesPerSecond = 0.0;
+
+		//Over the last FrameStats::s_HistoryCapacity measured frames
+		FramePhaseSummary Phases[(uint32_t)FramePhase::Count];
+
+		//Of the whole run (warm up included). The checksum must be the same for every run of the same config, whatever the thread count.
+		NullQueueStats Queues;
+		QueueSchedulerStats Scheduler;
+		CommandPoolStats DirectPool;
+		CommandPoolStats ComputePool;
+		UploadRingStats Upload;
+		FrameGraphStats FrameGraph;
+		uint64_t FenceStallCount = 0;
+		ResidencyStats Residency;
+
+		TextureStreamerStats Streaming;
+		uint32_t TextureLoadErrors = 0;
+		uint32_t TexturesVerified = 0; //Whose resident mips have the same bytes as the file
+		uint64_t SinkCopies = 0;
+
+		//What the recording of the draws set and skipped, and the time to build the keys and sort them, of every frame
+		DrawRecordStats DrawRecord;
+		uint64_t DrawEncodeNs = 0;
+		uint64_t DrawSortNs = 0;
+		uint32_t DrawListFrames = 0;
+		RadixSortStats DrawSort; //Of the last frame
+
+		//Sums of every frame (Transforms, Levels and Reordered are of the last one), and the frames
+		SceneUpdateStats Scene;
+		uint32_t SceneFrames = 0;
+		SceneMemoryStats SceneMemory;
+
+		//Sums of every frame, and the frames
+		CullingStats Culling;
+		uint32_t CulledFrames = 0;
+
+		//The GPU scopes of the measured frames, by name (in the order they were first seen), and their frames
+		struct GPUScopeSummary
+		{
+			std::string Name;
+			uint32_t Depth = 0;
+			uint64_t Count = 0;
+			double TotalMs = 0.0;
+		};
+
+		GPUProfilerStats GPUProfiler;
+		std::vector<GPUScopeSummary> GPUScopes;
+		uint32_t GPUFrames = 0;
+		double GPUFrameMs = 0.0;      //Sum of GPUProfilerFrame::GetGPUMs
+		double GPUStartDelayMs = 0.0; //Sum of the time from the CPU beginning a frame to the GPU beginning it
+
+		//The trace was written to Config.TracePath
+		bool CPUTrace = false;
+		CPUProfilerStats CPUProfiler;
+
+		//The capture was written to Config.CapturePath, or the reason it wasn't
+		bool Captured = false;
+		std::string CaptureError;
+		CommandCaptureStats Capture;
+
+		//Indexed by PresentLatencyPolicy
+		PresentModelSummary PresentModels[2];
+	};
+
+	//Runs the frame loop of the renderer (Update, Render and the fence pacing) on the null backend, without a window or a GPU.
+	//It measures the CPU cost of a frame: recording, the frame graph, the allocators, the scheduler and the submission.
+	//The null GPU executes lazily, when the CPU waits on a fence, so the fence waits measure how long it takes to walk the commands and not a GPU.
+	BenchmarkResult RunHeadlessBenchmark(const BenchmarkConfig& config);
+
+	//One JSON object with the config, the phase timings and the counters. Meant to be read by scripts (e.g: to compare against a baseline on a build machine).
+	void WriteBenchmarkJSON(const BenchmarkResult& result, std::ostream& stream);
+
+	//Runs RunHeadlessBenchmark with 1, 2, ... Config.ScalingThreads threads, one result per thread count
+	std::vector<BenchmarkResult> RunBenchmarkScaling(const BenchmarkConfig& config);
+
+	//The frame times of every thread count and the speedup over the one thread run. The checksums must all be the same.
+	void WriteBenchmarkScalingJSON(const std::vector<BenchmarkResult>& results, std::ostream& stream);
+
+	struct CaptureReplayResult
+	{
+		std::string Path;
+		bool Replayed = false;
+		std::string Error;
+
+		CaptureFileHeader Header = {};
+		uint64_t FileSize = 0;
+
+		CaptureReplayStats Replay;
+		NullQueueStats Queues;
+	};
+
+	//Replays the capture of Config.ReplayPath on a HT::NullQueueBackend, with null lists of a HT::NullCommandPoolBackend recorded by a HT::NullCaptureRecorder.
+	//The time is the CPU cost of the submission path for the frames of the capture: acquiring, recording and submitting the lists, the fences and walking the commands.
+	CaptureReplayResult RunCaptureReplay(const BenchmarkConfig& config);
+	void WriteCaptureReplayJSON(const CaptureReplayResult& result, std::ostream& stream);
+
+	//--frames N --warmup N --draws N --draws-per-chunk N --max-chunks N --pipelines N --root-signatures N --materials N --no-sort --groups N --spinning-groups N --moving-percent N --cull --occluders N --cull-level scalar|sse|avx2 --no-gpu-profile --trace path --capture path --replay path --passes N --resources N --compute N --threads N --scaling N --frames-in-flight N --low-latency --heaps N --heap-mb N --heaps-per-frame N --budget-mb N --textures dir --stream-budget-kb N --stream-upload-mb N --seed N --model-gpu-us N --max-latency N --output path
+	//Returns false (and the reason in outError) on an unknown or malformed argument.
+	bool ParseBenchmarkArguments(int argc, const char* const* argv, BenchmarkConfig& outConfig, std::string& outOutputPath, std::string& outError);
+}
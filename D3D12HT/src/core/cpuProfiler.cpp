@@ -0,0 +1,254 @@
+#include "cpuProfiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace HT
+{
+	std::atomic<bool> CPUProfiler::s_Enabled = false;
+	thread_local CPUProfiler::ThreadBuffer* CPUProfiler::s_ThreadBuffer = nullptr;
+
+	//Every event is in the same process, the threads are the tracks
+	static constexpr uint32_t s_ProcessId = 1;
+
+	static void WriteJSONString(std::ofstream& file, const char* text)
+	{
+		file.put('"');
+
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				file.put('\\');
+
+			//Control characters don't show up in the names we give, but they would break the whole file
+			file.put((unsigned char)*c < 0x20 ? ' ' : *c);
+		}
+
+		file.put('"');
+	}
+
+	CPUProfiler& CPUProfiler::Get()
+	{
+		static CPUProfiler s_Profiler;
+		return s_Profiler;
+	}
+
+	CPUProfiler::~CPUProfiler()
+	{
+		Stop();
+	}
+
+	bool CPUProfiler::Start(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(m_CaptureMutex);
+
+		if (IsEnabled())
+			return false;
+
+		m_File.open(path, std::ios::trunc);
+		if (!m_File)
+			return false;
+
+		//What was recorded since the last capture (scopes that ended after Stop) is not part of this one.
+		//Nothing else is draining, the flusher is not running.
+		{
+			std::lock_guard<std::mutex> buffersLock(m_BuffersMutex);
+
+			CPUProfilerEvent event;
+			for (std::unique_ptr<ThreadBuffer>& buffer : m_Buffers)
+			{
+				while (buffer->Events.TryPop(event)) {}
+				buffer->Dropped.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		m_File << "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << s_ProcessId << ",\"tid\":0,\"args\":{\"name\":\"D3D12HT\"}}";
+
+		m_HasGPUEvents = false;
+		m_EventsWritten = 0;
+		m_Flushes = 0;
+
+		m_StartNs = HTUtils::HTNowNanoseconds();
+		m_StartTicks = HTUtils::HTReadTimestampCounter();
+		m_NsPerTick = 1.0;
+
+		m_StopFlusher = false;
+		m_Flusher = std::thread(&CPUProfiler::FlusherMain, this);
+
+		s_Enabled.store(true, std::memory_order_release);
+		return true;
+	}
+
+	void CPUProfiler::Stop()
+	{
+		std::lock_guard<std::mutex> lock(m_CaptureMutex);
+
+		if (!IsEnabled())
+			return;
+
+		s_Enabled.store(false, std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> flusherLock(m_FlusherMutex);
+			m_StopFlusher = true;
+		}
+
+		m_FlusherCondition.notify_one();
+		m_Flusher.join();
+
+		//The scopes that began before the flag went down can still be ending on other threads, the ones that are late go to the next capture
+		//(which throws them away)
+		Drain();
+
+		{
+			std::lock_guard<std::mutex> buffersLock(m_BuffersMutex);
+
+			for (std::unique_ptr<ThreadBuffer>& buffer : m_Buffers)
+			{
+				if (!buffer->Name.empty())
+					WriteThreadName(buffer->ThreadId, buffer->Name.c_str());
+			}
+		}
+
+		if (m_HasGPUEvents)
+			WriteThreadName(s_GPUThreadId, "GPU");
+
+		m_File << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		m_File.close();
+	}
+
+	void CPUProfiler::SetThreadName(const char* name)
+	{
+		ThreadBuffer* buffer = s_ThreadBuffer ? s_ThreadBuffer : RegisterThread();
+
+		std::lock_guard<std::mutex> lock(m_BuffersMutex);
+		buffer->Name = name;
+	}
+
+	CPUProfilerStats CPUProfiler::GetStats() const
+	{
+		CPUProfilerStats stats;
+		stats.EventsWritten = m_EventsWritten.load(std::memory_order_relaxed);
+		stats.Flushes = m_Flushes.load(std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(m_BuffersMutex);
+		stats.Threads = (uint32_t)m_Buffers.size();
+
+		for (const std::unique_ptr<ThreadBuffer>& buffer : m_Buffers)
+			stats.EventsDropped += buffer->Dropped.load(std::memory_order_relaxed);
+
+		return stats;
+	}
+
+	CPUProfiler::ThreadBuffer* CPUProfiler::RegisterThread()
+	{
+		std::lock_guard<std::mutex> lock(m_BuffersMutex);
+
+		m_Buffers.push_back(std::make_unique<ThreadBuffer>());
+
+		ThreadBuffer* buffer = m_Buffers.back().get();
+		buffer->ThreadId = (uint32_t)m_Buffers.size(); //0 is the GPU
+
+		s_ThreadBuffer = buffer;
+		return buffer;
+	}
+
+	void CPUProfiler::FlusherMain()
+	{
+		SetThreadName("CPU Profiler");
+
+		std::unique_lock<std::mutex> lock(m_FlusherMutex);
+
+		while (!m_StopFlusher)
+		{
+			m_FlusherCondition.wait_for(lock, std::chrono::milliseconds(s_FlushIntervalMs), [this]() { return m_StopFlusher; });
+
+			lock.unlock();
+			Drain();
+			lock.lock();
+		}
+	}
+
+	void CPUProfiler::Drain()
+	{
+		Calibrate();
+
+		//The buffers are never freed, so they can be drained without holding the lock (and the threads that are registering don't wait for the file)
+		std::vector<ThreadBuffer*> buffers;
+		{
+			std::lock_guard<std::mutex> lock(m_BuffersMutex);
+			buffers.reserve(m_Buffers.size());
+
+			for (std::unique_ptr<ThreadBuffer>& buffer : m_Buffers)
+				buffers.push_back(buffer.get());
+		}
+
+		uint64_t written = 0;
+		CPUProfilerEvent event;
+
+		for (ThreadBuffer* buffer : buffers)
+		{
+			while (buffer->Events.TryPop(event))
+			{
+				WriteEvent(event, buffer->ThreadId);
+				written++;
+			}
+		}
+
+		m_File.flush();
+
+		m_EventsWritten.fetch_add(written, std::memory_order_relaxed);
+		m_Flushes.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void CPUProfiler::Calibrate()
+	{
+		//The longer since the start, the better the rate. Both clocks are read back to back, the error is the time between the two reads.
+		uint64_t nowNs = HTUtils::HTNowNanoseconds();
+		uint64_t nowTicks = HTUtils::HTReadTimestampCounter();
+
+		if (nowTicks > m_StartTicks && nowNs > m_StartNs)
+			m_NsPerTick = (double)(nowNs - m_StartNs) / (double)(nowTicks - m_StartTicks);
+	}
+
+	void CPUProfiler::WriteEvent(const CPUProfilerEvent& event, uint32_t threadId)
+	{
+		double beginUs;
+		double durationUs;
+
+		if (event.GPU)
+		{
+			//Resolved frames can be older than the capture
+			if (event.Begin < m_StartNs)
+				return;
+
+			beginUs = (double)(event.Begin - m_StartNs) * 1e-3;
+			durationUs = event.End > event.Begin ? (double)(event.End - event.Begin) * 1e-3 : 0.0;
+			threadId = s_GPUThreadId;
+			m_HasGPUEvents = true;
+		}
+		else
+		{
+			//A scope that began before the capture
+			if (event.Begin < m_StartTicks)
+				return;
+
+			beginUs = (double)(event.Begin - m_StartTicks) * m_NsPerTick * 1e-3;
+			durationUs = event.End > event.Begin ? (double)(event.End - event.Begin) * m_NsPerTick * 1e-3 : 0.0;
+		}
+
+		char numbers[128];
+		snprintf(numbers, sizeof(numbers), ",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", s_ProcessId, threadId, beginUs, durationUs);
+
+		m_File << ",\n{\"name\":";
+		WriteJSONString(m_File, event.Name);
+		m_File << numbers;
+	}
+
+	void CPUProfiler::WriteThreadName(uint32_t threadId, const char* name)
+	{
+		m_File << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << s_ProcessId << ",\"tid\":" << threadId << ",\"args\":{\"name\":";
+		WriteJSONString(m_File, name);
+		m_File << "}}";
+	}
+}
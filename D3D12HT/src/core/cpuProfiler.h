@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <core/spscQueue.h>
+#include <util/timer.h>
+
+namespace HT
+{
+	//A scope that ended. The CPU scopes are in HTUtils::HTReadTimestampCounter ticks, the GPU ones (see CPUProfiler::RecordGPUScope) in nanoseconds.
+	//The name is not copied, it must live until the capture is stopped (a literal, __FUNCTION__...).
+	struct CPUProfilerEvent
+	{
+		const char* Name = nullptr;
+		uint64_t Begin = 0;
+		uint64_t End = 0;
+		bool GPU = false;
+	};
+
+	struct CPUProfilerStats
+	{
+		uint64_t EventsWritten = 0;
+		uint64_t EventsDropped = 0; //The ring of a thread was full, the flusher was too slow
+		uint64_t Flushes = 0;
+		uint32_t Threads = 0;
+	};
+
+	//Times scopes of any thread and writes them to a Chrome trace (chrome://tracing, ui.perfetto.dev).
+	//
+	//Every thread has its own ring, so recording a scope is two reads of the time stamp counter and a push to a SPSC queue (no lock, nothing shared
+	//with the other threads). A scope is recorded once, when it ends, as a complete event ("X"): when a ring is full the whole scope is dropped
+	//and the trace never has a begin without its end.
+	//A background thread drains the rings every few milliseconds and writes the events to the file, converting the ticks to the same timeline
+	//as HTUtils::HTNowNanoseconds (the rate of the counter is measured against it on every flush, with the start of the capture as the base).
+	//
+	//Use the macros, HT_PROFILE_SCOPE and friends compile to nothing in Dist. When no capture is running a scope only reads a flag.
+	//A thread gets its ring on its first event (or HT_PROFILE_THREAD) and keeps it for the whole process, they are never freed.
+	class CPUProfiler
+	{
+	public:
+		//Events per thread. 64K events are more than a second of a busy thread, the flusher drains them every s_FlushIntervalMs.
+		static constexpr uint32_t s_ThreadCapacity = 1 << 16;
+		static constexpr uint32_t s_FlushIntervalMs = 10;
+
+		//The track of the GPU scopes in the trace
+		static constexpr uint32_t s_GPUThreadId = 0;
+
+		static CPUProfiler& Get();
+
+		CPUProfiler(const CPUProfiler&) = delete;
+		CPUProfiler& operator=(const CPUProfiler&) = delete;
+
+		//Starts writing a new trace (the events from before are discarded). False if the file can't be created or a capture is already running.
+		bool Start(const std::string& path);
+
+		//Writes what is left and closes the trace
+		void Stop();
+
+		static inline bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+		//The name of the calling thread in the trace (copied)
+		void SetThreadName(const char* name);
+
+		//A scope of the GPU in HTUtils::HTNowNanoseconds, e.g: the resolved scopes of HT::GPUProfiler. It goes to the track of the GPU.
+		static inline void RecordGPUScope(const char* name, uint64_t beginNs, uint64_t endNs)
+		{
+			if (IsEnabled())
+				Push({ name, beginNs, endNs, true });
+		}
+
+		//Ticks of HTUtils::HTReadTimestampCounter
+		static inline void Record(const char* name, uint64_t beginTicks, uint64_t endTicks)
+		{
+			Push({ name, beginTicks, endTicks, false });
+		}
+
+		CPUProfilerStats GetStats() const;
+
+	private:
+		struct ThreadBuffer
+		{
+			SPSCQueue<CPUProfilerEvent, s_ThreadCapacity> Events;
+
+			//Only the owner thread writes it
+			std::atomic<uint64_t> Dropped = 0;
+
+			uint32_t ThreadId = 0;
+			std::string Name;
+		};
+
+		CPUProfiler() = default;
+		~CPUProfiler();
+
+		static inline void Push(const CPUProfilerEvent& event)
+		{
+			ThreadBuffer* buffer = s_ThreadBuffer;
+			if (!buffer)
+				buffer = Get().RegisterThread();
+
+			if (!buffer->Events.TryPush(event))
+				buffer->Dropped.store(buffer->Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		ThreadBuffer* RegisterThread();
+
+		void FlusherMain();
+
+		//Only one thread drains at a time (the flusher, or Start/Stop when it is not running)
+		void Drain();
+		void Calibrate();
+		void WriteEvent(const CPUProfilerEvent& event, uint32_t threadId);
+		void WriteThreadName(uint32_t threadId, const char* name);
+
+	private:
+		static std::atomic<bool> s_Enabled;
+		static thread_local ThreadBuffer* s_ThreadBuffer;
+
+		//The buffers are only added, under the mutex
+		mutable std::mutex m_BuffersMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+
+		//Start/Stop
+		std::mutex m_CaptureMutex;
+
+		std::thread m_Flusher;
+		std::mutex m_FlusherMutex;
+		std::condition_variable m_FlusherCondition;
+		bool m_StopFlusher = false;
+
+		std::ofstream m_File;
+		bool m_HasGPUEvents = false;
+
+		//The base of the conversion from ticks, and the rate measured at the last flush
+		uint64_t m_StartTicks = 0;
+		uint64_t m_StartNs = 0;
+		double m_NsPerTick = 1.0;
+
+		std::atomic<uint64_t> m_EventsWritten = 0;
+		std::atomic<uint64_t> m_Flushes = 0;
+	};
+
+	//Times the scope it lives in. It is always recorded by the thread that created it.
+	class CPUProfileScope
+	{
+	public:
+		explicit CPUProfileScope(const char* name) : m_Name(name)
+		{
+			if (CPUProfiler::IsEnabled())
+				m_Begin = HTUtils::HTReadTimestampCounter();
+		}
+
+		~CPUProfileScope()
+		{
+			if (m_Begin)
+				CPUProfiler::Record(m_Name, m_Begin, HTUtils::HTReadTimestampCounter());
+		}
+
+		CPUProfileScope(const CPUProfileScope&) = delete;
+		CPUProfileScope& operator=(const CPUProfileScope&) = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Begin = 0; //0 = the profiler was disabled when the scope began
+	};
+}
+
+#if defined(D3D12HT_DIST)
+	#define HT_PROFILE_SCOPE(name)
+	#define HT_PROFILE_FUNCTION()
+	#define HT_PROFILE_THREAD(name)
+	#define HT_PROFILE_GPU_SCOPE(name, beginNs, endNs)
+#else
+	#define HT_PROFILE_CONCAT_INNER(a, b) a##b
+	#define HT_PROFILE_CONCAT(a, b) HT_PROFILE_CONCAT_INNER(a, b)
+
+	#define HT_PROFILE_SCOPE(name) ::HT::CPUProfileScope HT_PROFILE_CONCAT(htProfileScope, __LINE__)(name)
+
+	//Inside a lambda __FUNCTION__ is "operator()", give them a name with HT_PROFILE_SCOPE
+	#define HT_PROFILE_FUNCTION() HT_PROFILE_SCOPE(__FUNCTION__)
+	#define HT_PROFILE_THREAD(name) ::HT::CPUProfiler::Get().SetThreadName(name)
+	#define HT_PROFILE_GPU_SCOPE(name, beginNs, endNs) ::HT::CPUProfiler::RecordGPUScope(name, beginNs, endNs)
+#endif
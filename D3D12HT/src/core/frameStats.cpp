@@ -0,0 +1,219 @@
+#include "frameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	static const char* s_PhaseNames[(uint32_t)FramePhase::Count] =
+	{
+		"cull",
+		"record",
+		"execute",
+		"present",
+		"fence_wait",
+		"latency_wait",
+		"input_to_present",
+		"frame",
+	};
+
+	const char* FramePhaseName(FramePhase phase)
+	{
+		D3D_ASSERT(phase < FramePhase::Count, "Invalid frame phase!");
+		return s_PhaseNames[(uint32_t)phase];
+	}
+
+	FrameStats::FrameStats(double histogramBucketMs) : m_HistogramBucketMs(histogramBucketMs)
+	{
+		D3D_ASSERT(histogramBucketMs > 0.0, "Histogram bucket width must be positive!");
+		Reset();
+	}
+
+	void FrameStats::Reset()
+	{
+		m_Head  = 0;
+		m_Count = 0;
+		m_InFrame = false;
+		m_HasLastFrameEnd = false;
+		m_LastFrameEndNs = 0;
+		m_FrameIndex = 0;
+
+		m_Current = {};
+
+		for (uint32_t i = 0; i < (uint32_t)FramePhase::Count; i++)
+			m_PhaseBeginNs[i] = 0;
+	}
+
+	void FrameStats::BeginFrame(uint64_t timestampNs)
+	{
+		D3D_ASSERT(!m_InFrame, "BeginFrame called twice without EndFrame!");
+
+		m_Current = {};
+		m_Current.FrameIndex = m_FrameIndex;
+		m_PhaseBeginNs[(uint32_t)FramePhase::Frame] = timestampNs;
+		m_InFrame = true;
+	}
+
+	void FrameStats::EndFrame(uint64_t timestampNs)
+	{
+		D3D_ASSERT(m_InFrame, "EndFrame called without BeginFrame!");
+
+		//The frame time is measured from the end of the last frame, so the time spent outside of Update/Render (message pump, OS...) is also counted.
+		//For the very first frame we don't have a previous frame, so we take the begin of this one.
+		uint64_t frameStartNs = m_HasLastFrameEnd ? m_LastFrameEndNs : m_PhaseBeginNs[(uint32_t)FramePhase::Frame];
+		m_Current.PhaseNs[(uint32_t)FramePhase::Frame] = timestampNs >= frameStartNs ? timestampNs - frameStartNs : 0;
+
+		m_History[m_Head] = m_Current;
+		m_Head = (m_Head + 1) % s_HistoryCapacity;
+		m_Count = HTUtils::HTMin(m_Count + 1, s_HistoryCapacity);
+
+		m_LastFrameEndNs = timestampNs;
+		m_HasLastFrameEnd = true;
+		m_FrameIndex++;
+		m_InFrame = false;
+	}
+
+	void FrameStats::BeginPhase(FramePhase phase, uint64_t timestampNs)
+	{
+		D3D_ASSERT(phase < FramePhase::Frame, "Frame is measured by BeginFrame/EndFrame!");
+		m_PhaseBeginNs[(uint32_t)phase] = timestampNs;
+	}
+
+	void FrameStats::EndPhase(FramePhase phase, uint64_t timestampNs)
+	{
+		D3D_ASSERT(phase < FramePhase::Frame, "Frame is measured by BeginFrame/EndFrame!");
+
+		uint64_t beginNs = m_PhaseBeginNs[(uint32_t)phase];
+		AddPhaseDuration(phase, timestampNs >= beginNs ? timestampNs - beginNs : 0);
+	}
+
+	void FrameStats::AddPhaseDuration(FramePhase phase, uint64_t durationNs)
+	{
+		D3D_ASSERT(phase < FramePhase::Frame, "Frame is measured by BeginFrame/EndFrame!");
+		m_Current.PhaseNs[(uint32_t)phase] += durationNs;
+	}
+
+	const FrameStats::FrameSample& FrameStats::GetSample(uint32_t i) const
+	{
+		//m_Head is the oldest sample once the ring is full, otherwise the oldest is at 0
+		uint32_t oldest = (m_Count == s_HistoryCapacity) ? m_Head : 0;
+		return m_History[(oldest + i) % s_HistoryCapacity];
+	}
+
+	FramePhaseSummary FrameStats::Summarize(FramePhase phase) const
+	{
+		FramePhaseSummary summary;
+		summary.SampleCount = m_Count;
+
+		if (m_Count == 0)
+			return summary;
+
+		uint64_t totalNs = 0;
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			m_SortScratch[i] = GetSample(i).PhaseNs[(uint32_t)phase];
+			totalNs += m_SortScratch[i];
+		}
+
+		//We sort once and read all percentiles from it. Using the nearest-rank method, this is, the smallest sample
+		//that has at least P% of the samples less or equal than it. So the percentile is always a frame that really happened.
+		std::sort(m_SortScratch, m_SortScratch + m_Count);
+
+		auto Percentile = [this](double percent) -> double
+		{
+			uint32_t rank = (uint32_t)std::ceil(percent / 100.0 * m_Count);
+			rank = HTUtils::HTMax(rank, 1u);
+			return HTUtils::HTNanosecondsToMilliseconds(m_SortScratch[rank - 1]);
+		};
+
+		summary.AverageMs = HTUtils::HTNanosecondsToMilliseconds(totalNs) / m_Count;
+		summary.P50Ms = Percentile(50.0);
+		summary.P95Ms = Percentile(95.0);
+		summary.P99Ms = Percentile(99.0);
+		summary.MaxMs = HTUtils::HTNanosecondsToMilliseconds(m_SortScratch[m_Count - 1]);
+
+		return summary;
+	}
+
+	void FrameStats::BuildHistogram(FramePhase phase, Histogram& outHistogram) const
+	{
+		for (uint32_t i = 0; i < s_HistogramBuckets; i++)
+			outHistogram[i] = 0;
+
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			double ms = HTUtils::HTNanosecondsToMilliseconds(GetSample(i).PhaseNs[(uint32_t)phase]);
+			uint32_t bucket = HTUtils::HTMin((uint32_t)(ms / m_HistogramBucketMs), s_HistogramBuckets - 1);
+			outHistogram[bucket]++;
+		}
+	}
+
+	void FrameStats::ExportCSV(std::ostream& stream) const
+	{
+		stream << "frame";
+		for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+			stream << "," << s_PhaseNames[p] << "_ms";
+		stream << "\n";
+
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			const FrameSample& sample = GetSample(i);
+
+			stream << sample.FrameIndex;
+			for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+				stream << "," << HTUtils::HTNanosecondsToMilliseconds(sample.PhaseNs[p]);
+			stream << "\n";
+		}
+	}
+
+	void FrameStats::ExportJSON(std::ostream& stream) const
+	{
+		stream << "{\n";
+		stream << "\t\"frameCount\": " << m_FrameIndex << ",\n";
+		stream << "\t\"sampleCount\": " << m_Count << ",\n";
+		stream << "\t\"histogramBucketMs\": " << m_HistogramBucketMs << ",\n";
+		stream << "\t\"phases\": {\n";
+
+		for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+		{
+			FramePhaseSummary summary = Summarize((FramePhase)p);
+
+			Histogram histogram;
+			BuildHistogram((FramePhase)p, histogram);
+
+			stream << "\t\t\"" << s_PhaseNames[p] << "\": { ";
+			stream << "\"avgMs\": " << summary.AverageMs << ", ";
+			stream << "\"p50Ms\": " << summary.P50Ms << ", ";
+			stream << "\"p95Ms\": " << summary.P95Ms << ", ";
+			stream << "\"p99Ms\": " << summary.P99Ms << ", ";
+			stream << "\"maxMs\": " << summary.MaxMs << ", ";
+			stream << "\"histogram\": [";
+
+			for (uint32_t b = 0; b < s_HistogramBuckets; b++)
+				stream << (b ? ", " : "") << histogram[b];
+
+			stream << "] }" << (p + 1 < (uint32_t)FramePhase::Count ? "," : "") << "\n";
+		}
+
+		stream << "\t},\n";
+		stream << "\t\"samples\": [\n";
+
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			const FrameSample& sample = GetSample(i);
+
+			stream << "\t\t{ \"frame\": " << sample.FrameIndex;
+			for (uint32_t p = 0; p < (uint32_t)FramePhase::Count; p++)
+				stream << ", \"" << s_PhaseNames[p] << "Ms\": " << HTUtils::HTNanosecondsToMilliseconds(sample.PhaseNs[p]);
+
+			stream << " }" << (i + 1 < m_Count ? "," : "") << "\n";
+		}
+
+		stream << "\t]\n";
+		stream << "}\n";
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace HT
+{
+	//The CPU phases of a frame that we want to time. They map to the steps of our Render function:
+	//Cull      - Find the objects that can be on screen (HT::VisibilityCuller)
+	//Record    - Reset the allocator/command list and record all the commands
+	//Execute   - ExecuteCommandLists
+	//Present   - SwapChain::Present
+	//FenceWait - The time we stalled in WaitForFenceValue waiting for the next back buffer to be free
+	//LatencyWait    - The time we waited on the frame latency object of the swap chain, before sampling the input
+	//InputToPresent - From the moment the frame sampled the input to the moment Present returned (the part of the input lag we control on the CPU)
+	//Frame     - The time between the end of the previous frame and the end of this one (this is what the user actually feels)
+	enum class FramePhase : uint8_t
+	{
+		Cull = 0,
+		Record,
+		Execute,
+		Present,
+		FenceWait,
+		LatencyWait,
+		InputToPresent,
+		Frame,
+
+		Count
+	};
+
+	const char* FramePhaseName(FramePhase phase);
+
+	//Rolling statistics of a phase over all frames still inside the history ring.
+	struct FramePhaseSummary
+	{
+		double   AverageMs   = 0.0;
+		double   P50Ms       = 0.0;
+		double   P95Ms       = 0.0;
+		double   P99Ms       = 0.0;
+		double   MaxMs       = 0.0;
+		uint32_t SampleCount = 0;
+	};
+
+	//An average FPS hides every hitch we have. A frame of 100ms in the middle of 59 frames of 1ms still looks like ~40 FPS, 
+	//so we keep the duration of each phase of the last s_HistoryCapacity frames and compute percentiles over them.
+	//
+	//Everything lives inside the object (fixed size arrays), so recording a frame never allocates. 
+	//The class never reads the clock by itself, the caller passes the timestamps (in nanoseconds). This way we can feed it with
+	//synthetic timestamps and test it anywhere, not only on Windows.
+	class FrameStats
+	{
+	public:
+		static constexpr uint32_t s_HistoryCapacity  = 1024;
+		static constexpr uint32_t s_HistogramBuckets = 32;
+
+		using Histogram = uint32_t[s_HistogramBuckets];
+
+		//Each histogram bucket covers histogramBucketMs milliseconds. The last bucket also holds everything above it.
+		explicit FrameStats(double histogramBucketMs = 1.0);
+
+		void BeginFrame(uint64_t timestampNs);
+		void EndFrame(uint64_t timestampNs);
+
+		//A phase can be entered more than once in a frame, its durations are summed.
+		void BeginPhase(FramePhase phase, uint64_t timestampNs);
+		void EndPhase(FramePhase phase, uint64_t timestampNs);
+
+		//For when the caller already knows the duration (e.g: we measured it somewhere else).
+		void AddPhaseDuration(FramePhase phase, uint64_t durationNs);
+
+		FramePhaseSummary Summarize(FramePhase phase) const;
+		void BuildHistogram(FramePhase phase, Histogram& outHistogram) const;
+
+		//Writes one row per frame still in the history (oldest first).
+		void ExportCSV(std::ostream& stream) const;
+
+		//Writes the summary and histogram of every phase, followed by the per frame samples.
+		void ExportJSON(std::ostream& stream) const;
+
+		void Reset();
+
+		inline uint32_t GetSampleCount()     const { return m_Count; }
+		inline uint64_t GetFrameCount()      const { return m_FrameIndex; }
+		inline double   GetHistogramBucketMs() const { return m_HistogramBucketMs; }
+
+	private:
+		struct FrameSample
+		{
+			uint64_t FrameIndex;
+			uint64_t PhaseNs[(uint32_t)FramePhase::Count];
+		};
+
+		//Returns the i-th oldest sample in the ring
+		const FrameSample& GetSample(uint32_t i) const;
+
+	private:
+		FrameSample m_History[s_HistoryCapacity];
+		uint32_t m_Head  = 0; //Next slot to be written
+		uint32_t m_Count = 0;
+
+		//The frame being recorded at the moment
+		FrameSample m_Current;
+		uint64_t m_PhaseBeginNs[(uint32_t)FramePhase::Count];
+		bool m_InFrame = false;
+
+		uint64_t m_LastFrameEndNs = 0;
+		bool m_HasLastFrameEnd = false;
+
+		uint64_t m_FrameIndex = 0;
+		double m_HistogramBucketMs;
+
+		//Scratch memory to sort a phase when computing percentiles, so Summarize doesn't need to allocate either.
+		mutable uint64_t m_SortScratch[s_HistoryCapacity];
+	};
+}
@@ -0,0 +1,222 @@
+#include "jobSystem.h"
+
+#include <string>
+
+#include <core/cpuProfiler.h>
+#include <util/simpleAssert.h>
+
+namespace HT
+{
+	//Which thread of the job system we are. Threads that are not part of it behave as the thread 0.
+	static thread_local uint32_t s_ThreadIndex = 0;
+
+	uint32_t JobSystem::GetCurrentThreadIndex()
+	{
+		return s_ThreadIndex;
+	}
+
+	JobSystem::JobSystem(uint32_t workerCount)
+	{
+		if (workerCount == s_AutoWorkerCount)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		//One queue for the thread 0 and one for each worker
+		for (uint32_t i = 0; i < workerCount + 1; i++)
+			m_Queues.push_back(std::make_unique<WorkQueue>());
+
+		for (uint32_t i = 1; i <= workerCount; i++)
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_Running = false;
+		}
+
+		m_SleepCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	void JobSystem::Run(JobFunction job, JobCounter* counter)
+	{
+		if (counter)
+			counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+
+		Push({ std::move(job), counter });
+	}
+
+	void JobSystem::RunAfter(JobCounter& dependency, JobFunction job, JobCounter* counter)
+	{
+		//The counter is incremented now, so who waits for it also waits for a job that wasn't scheduled yet
+		if (counter)
+			counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(dependency.m_ContinuationMutex);
+
+			if (!dependency.IsDone())
+			{
+				dependency.m_Continuations.push_back({ std::move(job), counter });
+				return;
+			}
+		}
+
+		Push({ std::move(job), counter });
+	}
+
+	void JobSystem::Push(Job job)
+	{
+		uint32_t threadIndex = s_ThreadIndex < m_Queues.size() ? s_ThreadIndex : 0;
+		WorkQueue& queue = *m_Queues[threadIndex];
+
+		{
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			queue.Jobs.push_back(std::move(job));
+		}
+
+		m_PendingJobs.fetch_add(1);
+
+		//Only pay for the notification when someone is sleeping. The worker increments m_SleepingWorkers before checking m_PendingJobs and we do
+		//the opposite, so at least one of us sees the other. Taking the lock makes sure a worker that just checked m_PendingJobs is already waiting.
+		if (m_SleepingWorkers.load() > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_SleepMutex);
+			}
+			m_SleepCondition.notify_one();
+		}
+	}
+
+	bool JobSystem::Pop(uint32_t threadIndex, Job& outJob)
+	{
+		WorkQueue& queue = *m_Queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+
+		if (queue.Jobs.empty())
+			return false;
+
+		outJob = std::move(queue.Jobs.back());
+		queue.Jobs.pop_back();
+
+		return true;
+	}
+
+	bool JobSystem::Steal(uint32_t threadIndex, Job& outJob)
+	{
+		uint32_t queueCount = (uint32_t)m_Queues.size();
+
+		//Start from the next thread, so all threads don't try to steal from the same victim
+		for (uint32_t i = 1; i < queueCount; i++)
+		{
+			WorkQueue& queue = *m_Queues[(threadIndex + i) % queueCount];
+
+			//Don't wait for a busy queue, just try the next one
+			std::unique_lock<std::mutex> lock(queue.Mutex, std::try_to_lock);
+			if (!lock.owns_lock() || queue.Jobs.empty())
+				continue;
+
+			outJob = std::move(queue.Jobs.front());
+			queue.Jobs.pop_front();
+
+			m_StealCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		return false;
+	}
+
+	bool JobSystem::TryRunOne(uint32_t threadIndex)
+	{
+		Job job;
+
+		if (!Pop(threadIndex, job) && !Steal(threadIndex, job))
+			return false;
+
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(Job& job)
+	{
+		m_PendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+
+		{
+			HT_PROFILE_SCOPE("Job");
+			job.Function();
+		}
+
+		Finish(job.Counter);
+	}
+
+	void JobSystem::Finish(JobCounter* counter)
+	{
+		if (!counter)
+			return;
+
+		//While it can't reach zero there is no one to wake up
+		uint32_t value = counter->m_Value.load(std::memory_order_relaxed);
+		while (value > 1)
+		{
+			if (counter->m_Value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+				return;
+		}
+
+		//We may be the last one. The counter goes to zero under the lock: who waits for it may destroy it as soon as it sees zero,
+		//and Wait takes the lock once before returning, so we are done with the counter (and its mutex) by then.
+		std::vector<JobCounter::Continuation> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->m_ContinuationMutex);
+			if (counter->m_Value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+
+			//It reached zero, now the jobs that depend on it can run
+			continuations.swap(counter->m_Continuations);
+		}
+
+		for (JobCounter::Continuation& continuation : continuations)
+			Push({ std::move(continuation.Function), continuation.Counter });
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		uint32_t threadIndex = s_ThreadIndex < m_Queues.size() ? s_ThreadIndex : 0;
+
+		while (!counter.IsDone())
+		{
+			if (!TryRunOne(threadIndex))
+				std::this_thread::yield();
+		}
+
+		//The job that took it to zero may still be inside Finish, holding the lock
+		std::lock_guard<std::mutex> lock(counter.m_ContinuationMutex);
+	}
+
+	void JobSystem::WorkerLoop(uint32_t threadIndex)
+	{
+		s_ThreadIndex = threadIndex;
+		HT_PROFILE_THREAD(("Job Worker " + std::to_string(threadIndex)).c_str());
+
+		while (m_Running.load(std::memory_order_acquire))
+		{
+			if (TryRunOne(threadIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(m_SleepMutex);
+			m_SleepingWorkers.fetch_add(1);
+
+			m_SleepCondition.wait(lock, [this]()
+			{
+				return !m_Running.load() || m_PendingJobs.load() > 0;
+			});
+
+			m_SleepingWorkers.fetch_sub(1);
+		}
+	}
+}
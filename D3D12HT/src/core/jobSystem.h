@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace HT
+{
+	class JobSystem;
+
+	using JobFunction = std::function<void()>;
+
+	//Counts how many jobs are still running. A job that was given a counter decrements it when it is done, 
+	//so waiting for the counter to reach zero is waiting for all of them.
+	//It is also how we express dependencies: RunAfter(counter, job) only schedules the job once the counter reaches zero.
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		//To destroy the counter once it is done, use JobSystem::Wait: the last job may still be finishing right after IsDone is true
+		inline bool IsDone() const { return m_Value.load(std::memory_order_acquire) == 0; }
+		inline uint32_t GetValue() const { return m_Value.load(std::memory_order_acquire); }
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation
+		{
+			JobFunction Function;
+			JobCounter* Counter;
+		};
+
+		std::atomic<uint32_t> m_Value = 0;
+
+		//Jobs waiting for this counter to reach zero
+		std::mutex m_ContinuationMutex;
+		std::vector<Continuation> m_Continuations;
+	};
+
+	//A work-stealing job system. Every thread has its own deque of jobs: it pushes and pops at the back of its own deque (the last job pushed
+	//is the one with the hottest cache) and, when it runs out of work, it steals from the front of the deque of another thread.
+	//This way the threads almost never touch the same deque, and the work gets balanced by itself.
+	//
+	//The thread that creates the job system is the thread 0 and it also runs jobs, while it waits for a counter.
+	class JobSystem
+	{
+	public:
+		//One worker for each hardware thread, minus the one that created the job system.
+		static constexpr uint32_t s_AutoWorkerCount = ~0u;
+
+		//0 workers is valid: the thread 0 runs every job itself, inside Wait (a job that nobody waits for doesn't run until someone waits).
+		explicit JobSystem(uint32_t workerCount = s_AutoWorkerCount);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		void Run(JobFunction job, JobCounter* counter = nullptr);
+
+		//The job is scheduled once the dependency reaches zero (right away, if it already is).
+		void RunAfter(JobCounter& dependency, JobFunction job, JobCounter* counter = nullptr);
+
+		//Runs other jobs while the counter is not zero, so the waiting thread is never idle.
+		void Wait(JobCounter& counter);
+
+		//Calls function(begin, end) for chunks of [0, count) of at most grainSize items, in parallel, and waits for all of them.
+		template<typename TFunction>
+		void ParallelFor(uint32_t count, uint32_t grainSize, const TFunction& function)
+		{
+			if (count == 0)
+				return;
+
+			grainSize = grainSize > 0 ? grainSize : 1;
+
+			JobCounter counter;
+			for (uint32_t begin = 0; begin < count; begin += grainSize)
+			{
+				uint32_t end = (count - begin > grainSize) ? begin + grainSize : count;
+				Run([&function, begin, end]() { function(begin, end); }, &counter);
+			}
+
+			Wait(counter);
+		}
+
+		//Threads of the job system including the thread 0.
+		inline uint32_t GetThreadCount() const { return (uint32_t)m_Queues.size(); }
+
+		//0 for the thread that created the job system, 1..N for the workers. Useful to index per thread data.
+		static uint32_t GetCurrentThreadIndex();
+
+		inline uint64_t GetStealCount() const { return m_StealCount.load(std::memory_order_relaxed); }
+
+	private:
+		struct Job
+		{
+			JobFunction Function;
+			JobCounter* Counter;
+		};
+
+		struct alignas(64) WorkQueue
+		{
+			std::mutex Mutex;
+			std::deque<Job> Jobs;
+		};
+
+		void Push(Job job);
+		bool Pop(uint32_t threadIndex, Job& outJob);
+		bool Steal(uint32_t threadIndex, Job& outJob);
+		bool TryRunOne(uint32_t threadIndex);
+		void Execute(Job& job);
+		void Finish(JobCounter* counter);
+		void WorkerLoop(uint32_t threadIndex);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		//Sleeping workers wait here when there is nothing to steal
+		std::mutex m_SleepMutex;
+		std::condition_variable m_SleepCondition;
+		std::atomic<uint32_t> m_PendingJobs = 0;
+		std::atomic<uint32_t> m_SleepingWorkers = 0;
+		std::atomic<bool> m_Running = true;
+
+		std::atomic<uint64_t> m_StealCount = 0;
+	};
+}
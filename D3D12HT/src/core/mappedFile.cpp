@@ -0,0 +1,152 @@
+#include "mappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace HT
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_Data(other.m_Data), m_Size(other.m_Size), m_Mapping(other.m_Mapping)
+	{
+		other.m_Data = nullptr;
+		other.m_Size = 0;
+		other.m_Mapping = nullptr;
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			std::swap(m_Data, other.m_Data);
+			std::swap(m_Size, other.m_Size);
+			std::swap(m_Mapping, other.m_Mapping);
+		}
+
+		return *this;
+	}
+
+#if defined(_WIN32)
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size = {};
+		if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			::CloseHandle(file);
+			return false;
+		}
+
+		//The mapping keeps the file open, we don't need our handle anymore
+		HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		::CloseHandle(file);
+
+		if (!mapping)
+			return false;
+
+		void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			::CloseHandle(mapping);
+			return false;
+		}
+
+		m_Data = static_cast<const uint8_t*>(data);
+		m_Size = (uint64_t)size.QuadPart;
+		m_Mapping = mapping;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			::UnmapViewOfFile(m_Data);
+
+		if (m_Mapping)
+			::CloseHandle(m_Mapping);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Mapping = nullptr;
+	}
+
+	void MappedFile::Prefetch(uint64_t offset, uint64_t size) const
+	{
+		if (!m_Data || offset >= m_Size)
+			return;
+
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<uint8_t*>(m_Data + offset);
+		range.NumberOfBytes = (SIZE_T)(size < m_Size - offset ? size : m_Size - offset);
+		::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat status;
+		if (::fstat(file, &status) != 0 || status.st_size == 0)
+		{
+			::close(file);
+			return false;
+		}
+
+		//The mapping keeps the file open, we don't need our descriptor anymore
+		void* data = ::mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_Data = static_cast<const uint8_t*>(data);
+		m_Size = (uint64_t)status.st_size;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			::munmap(const_cast<uint8_t*>(m_Data), (size_t)m_Size);
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	void MappedFile::Prefetch(uint64_t offset, uint64_t size) const
+	{
+		if (!m_Data || offset >= m_Size)
+			return;
+
+		//madvise wants a page aligned address
+		uint64_t pageSize = (uint64_t)::sysconf(_SC_PAGESIZE);
+		uint64_t begin = offset & ~(pageSize - 1);
+		uint64_t end = offset + size < m_Size ? offset + size : m_Size;
+
+		::madvise(const_cast<uint8_t*>(m_Data + begin), (size_t)(end - begin), MADV_WILLNEED);
+	}
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HT
+{
+	//A whole file mapped read-only in our address space. Reading it is reading memory: the OS brings the pages in from disk the first time
+	//they are touched (in the thread that touches them) and keeps them in the file cache, so there is no read call and no copy to a buffer of ours.
+	//
+	//CreateFileMapping/MapViewOfFile on Windows, mmap everywhere else.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		//False if the file can't be opened or is empty (an empty file can't be mapped)
+		bool Open(const std::string& path);
+		void Close();
+
+		//Tells the OS we are going to read this range soon, so it can start reading it from disk in the background. Only a hint.
+		void Prefetch(uint64_t offset, uint64_t size) const;
+
+		inline const uint8_t* GetData() const { return m_Data; }
+		inline uint64_t GetSize() const { return m_Size; }
+		inline bool IsOpen() const { return m_Data != nullptr; }
+
+	private:
+		const uint8_t* m_Data = nullptr;
+		uint64_t m_Size = 0;
+
+		//The mapping object on Windows (the file handle is closed right after mapping)
+		void* m_Mapping = nullptr;
+	};
+}
@@ -0,0 +1,111 @@
+#include "radixSort.h"
+
+#include <cstring>
+#include <utility>
+
+#include <util/utils.h>
+
+namespace HT
+{
+	void RadixSorter::Sort(uint64_t* keys, uint32_t* values, uint32_t count, JobSystem* jobSystem)
+	{
+		m_LastStats = {};
+		if (count < 2)
+			return;
+
+		if (m_ScratchKeys.size() < count)
+		{
+			m_ScratchKeys.resize(count);
+			m_ScratchValues.resize(count);
+		}
+
+		uint32_t chunkCount = 1;
+		if (jobSystem && count >= s_MinParallelCount)
+			chunkCount = HTUtils::HTMin(jobSystem->GetThreadCount(), count / s_MinChunkSize);
+
+		chunkCount = HTUtils::HTMax(chunkCount, 1u);
+		uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+		chunkCount = (count + chunkSize - 1) / chunkSize;
+		m_LastStats.Chunks = chunkCount;
+
+		//Which digits need a pass: the ones where not every key is the same as the first one. One read of the keys for all 8.
+		uint64_t differentBits = 0;
+		for (uint32_t i = 1; i < count; i++)
+			differentBits |= keys[i] ^ keys[0];
+
+		uint64_t* sourceKeys = keys;
+		uint32_t* sourceValues = values;
+		uint64_t* destinationKeys = m_ScratchKeys.data();
+		uint32_t* destinationValues = m_ScratchValues.data();
+
+		m_ChunkHistograms.resize(chunkCount);
+
+		for (uint32_t pass = 0; pass < 8; pass++)
+		{
+			uint32_t shift = pass * 8;
+			if (((differentBits >> shift) & 0xff) == 0)
+			{
+				m_LastStats.SkippedPasses++;
+				continue;
+			}
+
+			m_LastStats.Passes++;
+
+			auto CountDigits = [&](uint32_t chunk)
+			{
+				Histogram& histogram = m_ChunkHistograms[chunk];
+				histogram.fill(0);
+
+				uint32_t end = HTUtils::HTMin((chunk + 1) * chunkSize, count);
+				for (uint32_t i = chunk * chunkSize; i < end; i++)
+					histogram[(sourceKeys[i] >> shift) & 0xff]++;
+			};
+
+			auto Scatter = [&](uint32_t chunk)
+			{
+				//After the prefix sum, the histogram of a chunk has where its next key of each digit goes
+				Histogram& offsets = m_ChunkHistograms[chunk];
+
+				uint32_t end = HTUtils::HTMin((chunk + 1) * chunkSize, count);
+				for (uint32_t i = chunk * chunkSize; i < end; i++)
+				{
+					uint32_t position = offsets[(sourceKeys[i] >> shift) & 0xff]++;
+					destinationKeys[position] = sourceKeys[i];
+					destinationValues[position] = sourceValues[i];
+				}
+			};
+
+			if (chunkCount > 1)
+				jobSystem->ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) { for (uint32_t chunk = begin; chunk < end; chunk++) CountDigits(chunk); });
+			else
+				CountDigits(0);
+
+			//Digit by digit, chunk by chunk: the keys of a digit are in the order of the chunks, and the chunks in the order of the keys
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < 256; digit++)
+			{
+				for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+				{
+					uint32_t digitCount = m_ChunkHistograms[chunk][digit];
+					m_ChunkHistograms[chunk][digit] = offset;
+					offset += digitCount;
+				}
+			}
+
+			if (chunkCount > 1)
+				jobSystem->ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) { for (uint32_t chunk = begin; chunk < end; chunk++) Scatter(chunk); });
+			else
+				Scatter(0);
+
+			std::swap(sourceKeys, destinationKeys);
+			std::swap(sourceValues, destinationValues);
+		}
+
+		//An odd number of passes leaves the result in the scratch memory
+		if (sourceKeys != keys)
+		{
+			memcpy(keys, sourceKeys, (size_t)count * sizeof(uint64_t));
+			memcpy(values, sourceValues, (size_t)count * sizeof(uint32_t));
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <core/jobSystem.h>
+
+namespace HT
+{
+	struct RadixSortStats
+	{
+		uint32_t Passes = 0;        //Of the 8 digits, how many were really sorted
+		uint32_t SkippedPasses = 0; //Digits that every key has the same, there is nothing to move
+		uint32_t Chunks = 0;        //1 = it ran on the calling thread only
+	};
+
+	//Stable LSD radix sort of 64 bit keys, with a 32 bit value moved along each key (e.g. the index of what the key belongs to).
+	//One digit of 8 bits per pass, so it is O(8n) no matter the keys, and passes are skipped when every key has the same digit
+	//(the high bits of draw keys are a few passes and root signatures, most of them are the same).
+	//
+	//With a job system, every pass is done by chunks in parallel: each chunk counts its digits, the counts give each chunk where its keys go
+	//for every digit, and then each chunk scatters its keys there. The chunks go in order, so it stays stable.
+	//The scratch memory is kept between sorts.
+	class RadixSorter
+	{
+	public:
+		//Below this, a single thread is faster than waking the workers up
+		static constexpr uint32_t s_MinParallelCount = 16 * 1024;
+		static constexpr uint32_t s_MinChunkSize = 8 * 1024;
+
+		void Sort(uint64_t* keys, uint32_t* values, uint32_t count, JobSystem* jobSystem = nullptr);
+
+		inline const RadixSortStats& GetLastStats() const { return m_LastStats; }
+
+	private:
+		using Histogram = std::array<uint32_t, 256>;
+
+		std::vector<uint64_t> m_ScratchKeys;
+		std::vector<uint32_t> m_ScratchValues;
+
+		//[chunk]
+		std::vector<Histogram> m_ChunkHistograms;
+
+		RadixSortStats m_LastStats;
+	};
+}
@@ -0,0 +1,184 @@
+#include "renderEvents.h"
+
+namespace HT
+{
+	RenderEvent RenderEvent::MakeResize(uint32_t width, uint32_t height)
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::Resize;
+		event.Width = width;
+		event.Height = height;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeSetFullscreen(bool fullscreen)
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::SetFullscreen;
+		event.Value = fullscreen ? 1 : 0;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeToggleVSync()
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::ToggleVSync;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeTogglePacingMode()
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::TogglePacingMode;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeSetFramesInFlight(uint32_t framesInFlight)
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::SetFramesInFlight;
+		event.Value = framesInFlight;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeToggleLatencyMode()
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::ToggleLatencyMode;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeSetMaxFrameLatency(uint32_t maxFrameLatency)
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::SetMaxFrameLatency;
+		event.Value = maxFrameLatency;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeExportFrameStats(FrameStatsFormat format)
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::ExportFrameStats;
+		event.Value = (uint32_t)format;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeToggleCPUTrace()
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::ToggleCPUTrace;
+		return event;
+	}
+
+	RenderEvent RenderEvent::MakeToggleCommandCapture()
+	{
+		RenderEvent event;
+		event.Type = RenderEventType::ToggleCommandCapture;
+		return event;
+	}
+
+	void RenderFrameCommands::Merge(const RenderEvent& event)
+	{
+		EventCount++;
+
+		switch (event.Type)
+		{
+		case RenderEventType::Resize:
+			Resize = true;
+			Width  = event.Width;
+			Height = event.Height;
+			break;
+
+		case RenderEventType::SetFullscreen:
+			SetFullscreen = true;
+			Fullscreen = event.Value != 0;
+			break;
+
+		case RenderEventType::ToggleVSync:
+			ToggleVSync = !ToggleVSync;
+			break;
+
+		case RenderEventType::TogglePacingMode:
+			TogglePacingMode = !TogglePacingMode;
+			break;
+
+		case RenderEventType::SetFramesInFlight:
+			FramesInFlight = event.Value;
+			break;
+
+		case RenderEventType::ToggleLatencyMode:
+			ToggleLatencyMode = !ToggleLatencyMode;
+			break;
+
+		case RenderEventType::SetMaxFrameLatency:
+			MaxFrameLatency = event.Value;
+			break;
+
+		case RenderEventType::ExportFrameStats:
+			ExportFrameStats |= event.Value;
+			break;
+
+		case RenderEventType::ToggleCPUTrace:
+			ToggleCPUTrace = !ToggleCPUTrace;
+			break;
+
+		case RenderEventType::ToggleCommandCapture:
+			ToggleCommandCapture = !ToggleCommandCapture;
+			break;
+		}
+	}
+
+	bool RenderEventQueue::Post(const RenderEvent& event)
+	{
+		//The last one wins, like in RenderFrameCommands::Merge
+		if (event.Type == RenderEventType::Resize)
+		{
+			m_PendingResize.store(((uint64_t)event.Width << 32) | event.Height, std::memory_order_relaxed);
+			return true;
+		}
+
+		if (event.Type == RenderEventType::SetFullscreen)
+		{
+			m_PendingFullscreen.store(event.Value ? 2 : 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		if (m_Queue.TryPush(event))
+			return true;
+
+		m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	RenderFrameCommands RenderEventQueue::Drain()
+	{
+		RenderFrameCommands commands;
+
+		RenderEvent event;
+		while (m_Queue.TryPop(event))
+			commands.Merge(event);
+
+		uint64_t resize = m_PendingResize.exchange(s_NoResize, std::memory_order_relaxed);
+		if (resize != s_NoResize)
+			commands.Merge(RenderEvent::MakeResize((uint32_t)(resize >> 32), (uint32_t)resize));
+
+		uint32_t fullscreen = m_PendingFullscreen.exchange(s_NoFullscreenChange, std::memory_order_relaxed);
+		if (fullscreen != s_NoFullscreenChange)
+			commands.Merge(RenderEvent::MakeSetFullscreen(fullscreen == 2));
+
+		return commands;
+	}
+
+	void WindowResizeFilter::EndSizeMove(uint32_t width, uint32_t height)
+	{
+		m_InSizeMove = false;
+		m_Queue.Post(RenderEvent::MakeResize(width, height));
+	}
+
+	void WindowResizeFilter::OnSize(uint32_t width, uint32_t height)
+	{
+		if (!m_InSizeMove)
+			m_Queue.Post(RenderEvent::MakeResize(width, height));
+	}
+}
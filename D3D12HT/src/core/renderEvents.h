@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+
+#include <core/spscQueue.h>
+
+namespace HT
+{
+	//Everything the window thread asks the render thread to do. The render thread owns the swap chain and the frame state, 
+	//so the window thread never touches them: it posts an event and the render thread applies it between two frames.
+	enum class RenderEventType : uint8_t
+	{
+		Resize,
+		SetFullscreen,
+		ToggleVSync,
+		TogglePacingMode,
+		SetFramesInFlight,
+		ToggleLatencyMode,
+		SetMaxFrameLatency,
+		ExportFrameStats,
+		ToggleCPUTrace,
+		ToggleCommandCapture
+	};
+
+	enum class FrameStatsFormat : uint8_t
+	{
+		CSV = 1 << 0,
+		JSON = 1 << 1
+	};
+
+	struct RenderEvent
+	{
+		RenderEventType Type = RenderEventType::Resize;
+
+		uint32_t Width  = 0;
+		uint32_t Height = 0;
+
+		//Fullscreen (0/1), frames in flight, max frame latency or the FrameStatsFormat of an export
+		uint32_t Value = 0;
+
+		static RenderEvent MakeResize(uint32_t width, uint32_t height);
+		static RenderEvent MakeSetFullscreen(bool fullscreen);
+		static RenderEvent MakeToggleVSync();
+		static RenderEvent MakeTogglePacingMode();
+		static RenderEvent MakeSetFramesInFlight(uint32_t framesInFlight);
+		static RenderEvent MakeToggleLatencyMode();
+		static RenderEvent MakeSetMaxFrameLatency(uint32_t maxFrameLatency);
+		static RenderEvent MakeExportFrameStats(FrameStatsFormat format);
+		static RenderEvent MakeToggleCPUTrace();
+		static RenderEvent MakeToggleCommandCapture();
+	};
+
+	//All the events posted since the last frame, merged. A window drag sends lots of resizes, but only the last size matters.
+	//Toggles cancel each other out (pressing 'V' twice before a frame changes nothing) and for the other values the last one wins.
+	struct RenderFrameCommands
+	{
+		bool Resize = false;
+		uint32_t Width  = 0;
+		uint32_t Height = 0;
+
+		bool SetFullscreen = false;
+		bool Fullscreen = false;
+
+		bool ToggleVSync = false;
+		bool TogglePacingMode = false;
+		bool ToggleLatencyMode = false;
+		bool ToggleCPUTrace = false;
+		bool ToggleCommandCapture = false;
+
+		//0 = unchanged
+		uint32_t FramesInFlight = 0;
+		uint32_t MaxFrameLatency = 0;
+
+		//FrameStatsFormat flags
+		uint32_t ExportFrameStats = 0;
+
+		uint32_t EventCount = 0;
+
+		inline bool IsEmpty() const { return EventCount == 0; }
+
+		void Merge(const RenderEvent& event);
+	};
+
+	//The queue between the window thread (the only producer) and the render thread (the only consumer)
+	//
+	//Post never waits. The render thread can be blocked in SetWindowPos/SetFullscreen, which SendMessage to the window thread: if the window thread
+	//waited for a free slot at that moment, each thread would wait for the other forever. So the resize and the fullscreen state are not queued,
+	//only their last value is kept (Drain merges them like that anyway) and a drag can post as many as it wants. The other events are key presses,
+	//to fill the queue the render thread has to be stuck for 1024 of them, and then they are dropped.
+	class RenderEventQueue
+	{
+	public:
+		//Window thread. False if the event was dropped because the queue is full.
+		bool Post(const RenderEvent& event);
+
+		//Render thread, at a frame boundary. Takes all the events posted so far.
+		RenderFrameCommands Drain();
+
+		inline uint64_t GetDroppedCount() const { return m_DroppedCount.load(std::memory_order_relaxed); }
+
+	private:
+		static const uint32_t s_Capacity = 1024;
+
+		//Width in the high 32 bits, height in the low ones: one store, so the render thread never sees the width of one resize with the height of another
+		static const uint64_t s_NoResize = ~0ull;
+
+		//0 = no change, 1 = windowed, 2 = fullscreen
+		static const uint32_t s_NoFullscreenChange = 0;
+
+		SPSCQueue<RenderEvent, s_Capacity> m_Queue;
+
+		std::atomic<uint64_t> m_PendingResize = s_NoResize;
+		std::atomic<uint32_t> m_PendingFullscreen = s_NoFullscreenChange;
+
+		//How many events Post dropped because the queue was full
+		std::atomic<uint64_t> m_DroppedCount = 0;
+	};
+
+	//The window thread side of the resizes. While the user drags the border of the window we get a WM_SIZE for every mouse move, and each resize
+	//waits for the frames in flight (ResizeBuffers needs the back buffers released, by us and by the GPU). So we don't resize while dragging:
+	//the swap chain stretches the old buffers to the window (DXGI_SCALING_STRETCH) and we post one resize, when the drag ends.
+	//Maximize, restore and our fullscreen switch don't drag, their WM_SIZE is posted right away.
+	class WindowResizeFilter
+	{
+	public:
+		explicit WindowResizeFilter(RenderEventQueue& queue) : m_Queue(queue) {}
+
+		//WM_ENTERSIZEMOVE
+		inline void BeginSizeMove() { m_InSizeMove = true; }
+
+		//WM_EXITSIZEMOVE, with the client size. A drag that only moved the window ends with the same size, the render thread skips it.
+		void EndSizeMove(uint32_t width, uint32_t height);
+
+		//WM_SIZE
+		void OnSize(uint32_t width, uint32_t height);
+
+		inline bool IsInSizeMove() const { return m_InSizeMove; }
+
+	private:
+		RenderEventQueue& m_Queue;
+		bool m_InSizeMove = false;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace HT
+{
+	//A lock-free queue for exactly one producer thread and one consumer thread. It is a ring of Capacity slots:
+	//the producer only writes the tail and the consumer only writes the head, so no thread ever waits for the other one.
+	//The head and the tail live in different cache lines, otherwise both threads would be fighting for the same line all the time.
+	//
+	//Capacity must be a power of two, so the index of a slot is just (position & (Capacity - 1)).
+	template<typename T, uint32_t Capacity>
+	class SPSCQueue
+	{
+		static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "The capacity of a SPSCQueue must be a power of two!");
+		static_assert(std::is_default_constructible<T>::value, "The slots of a SPSCQueue are default constructed!");
+
+	public:
+		SPSCQueue() = default;
+		SPSCQueue(const SPSCQueue&) = delete;
+		SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+		//Producer only. False if the queue is full.
+		bool TryPush(const T& value)
+		{
+			uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+
+			//The consumer may be freeing slots right now, at worst we think it is full a bit earlier
+			if (tail - m_Head.load(std::memory_order_acquire) == Capacity)
+				return false;
+
+			m_Slots[tail & (Capacity - 1)] = value;
+
+			//Release: the consumer can only see the new tail after the slot was written
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		//Consumer only. False if the queue is empty.
+		bool TryPop(T& outValue)
+		{
+			uint32_t head = m_Head.load(std::memory_order_relaxed);
+
+			if (head == m_Tail.load(std::memory_order_acquire))
+				return false;
+
+			outValue = m_Slots[head & (Capacity - 1)];
+
+			//Release: the producer can only reuse the slot after we read it
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		//Only a hint, the other thread may be changing it
+		inline uint32_t GetSizeApprox() const { return m_Tail.load(std::memory_order_acquire) - m_Head.load(std::memory_order_acquire); }
+		inline bool IsEmptyApprox() const { return GetSizeApprox() == 0; }
+
+		static constexpr uint32_t GetCapacity() { return Capacity; }
+
+	private:
+		//The positions only go up (and wrap around at 2^32), the difference between them is the size
+		alignas(64) std::atomic<uint32_t> m_Head = 0;
+		alignas(64) std::atomic<uint32_t> m_Tail = 0;
+		alignas(64) T m_Slots[Capacity] = {};
+	};
+}
@@ -0,0 +1,519 @@
+//The entry point of D3D12HTAllocatorFuzz. The allocators of the GPU memory only work with offsets, so we can hammer them with millions of random
+//Allocate/Free on any machine (it runs on the Linux build machines) and check every range they give out against a shadow copy:
+//inside the heap, aligned, never overlapping another live range and, for the heap allocator, never reused before its fence value completes.
+//Then it measures how fast the TLSF allocator is with a half full heap. The results are written as JSON to stdout, the exit code is 1 on any failure.
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/gpuHeapAllocator.h>
+#include <renderer/residencyManager.h>
+#include <renderer/tlsfAllocator.h>
+
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace
+{
+	struct FuzzConfig
+	{
+		uint32_t Operations = 4000000;
+		uint32_t HeapOperations = 1000000;
+		uint32_t BenchmarkOperations = 10000000;
+		uint32_t CapacityMB = 256;
+		uint32_t Granularity = 256;
+
+		//Validate walks every block of the allocator, so it is not done every operation
+		uint32_t ValidateInterval = 4096;
+		uint32_t Seed = 1;
+	};
+
+	//xorshift32, the same sequence on every platform
+	class FuzzRandom
+	{
+	public:
+		explicit FuzzRandom(uint32_t seed) : m_State(seed ? seed : 0x9e3779b9u) {}
+
+		inline uint32_t Next()
+		{
+			m_State ^= m_State << 13;
+			m_State ^= m_State >> 17;
+			m_State ^= m_State << 5;
+			return m_State;
+		}
+
+		inline uint32_t Range(uint32_t begin, uint32_t end) { return begin + Next() % (end - begin); }
+
+		//Sizes spread over many powers of two, like real resources (a lot of small ones, a few big ones)
+		inline uint64_t LogSize(uint32_t minBits, uint32_t maxBits)
+		{
+			uint32_t bits = Range(minBits, maxBits + 1);
+			return (1ull << bits) + (Next() & ((1ull << bits) - 1));
+		}
+
+	private:
+		uint32_t m_State;
+	};
+
+	//The live ranges, by offset. A new range must not overlap the one before or the one after it.
+	class ShadowRanges
+	{
+	public:
+		bool Insert(uint64_t key, uint64_t offset, uint64_t size)
+		{
+			std::pair<uint64_t, uint64_t> begin = { key, offset };
+
+			auto next = m_Ranges.lower_bound(begin);
+			if (next != m_Ranges.end() && next->first.first == key && next->first.second < offset + size)
+				return false;
+
+			if (next != m_Ranges.begin())
+			{
+				auto previous = std::prev(next);
+				if (previous->first.first == key && previous->second > offset)
+					return false;
+			}
+
+			m_Ranges[begin] = offset + size;
+			return true;
+		}
+
+		bool Erase(uint64_t key, uint64_t offset) { return m_Ranges.erase({ key, offset }) == 1; }
+
+		inline size_t GetCount() const { return m_Ranges.size(); }
+
+	private:
+		//(heap, offset) -> end
+		std::map<std::pair<uint64_t, uint64_t>, uint64_t> m_Ranges;
+	};
+
+	struct FuzzResult
+	{
+		bool Passed = true;
+		std::string Error;
+
+		uint64_t Allocations = 0;
+		uint64_t Frees = 0;
+		uint64_t FailedAllocations = 0;
+		uint64_t Validations = 0;
+		uint32_t PeakAllocations = 0;
+		double PeakUtilization = 0.0;
+		double PeakFragmentation = 0.0;
+	};
+
+	inline void Fail(FuzzResult& result, const std::string& error)
+	{
+		if (result.Passed)
+			result.Error = error;
+
+		result.Passed = false;
+	}
+
+	FuzzResult FuzzTLSF(const FuzzConfig& config)
+	{
+		FuzzResult result;
+		FuzzRandom random(config.Seed);
+
+		HT::TLSFAllocator allocator((uint64_t)config.CapacityMB << 20, config.Granularity);
+		std::vector<HT::TLSFAllocation> live;
+		ShadowRanges shadow;
+
+		for (uint32_t operation = 0; operation < config.Operations && result.Passed; operation++)
+		{
+			//The heap fills up and empties in waves, so we go through full heaps (failed allocations) and heavy fragmentation
+			bool filling = (operation / 100000) % 2 == 0;
+			bool allocate = live.empty() || random.Range(0, 100) < (filling ? 60u : 40u);
+
+			if (allocate)
+			{
+				uint64_t size = random.LogSize(4, 22);
+				uint64_t alignment = random.Range(0, 64) == 0 ? (4ull << 20) : 1ull << random.Range(0, 17);
+
+				HT::TLSFAllocation allocation = allocator.Allocate(size, alignment);
+				if (!allocation.IsValid())
+				{
+					result.FailedAllocations++;
+					continue;
+				}
+
+				if (allocation.Size < size || allocation.Offset % alignment != 0 || allocation.Offset + allocation.Size > allocator.GetCapacity())
+					Fail(result, "TLSF range out of the heap, too small or not aligned at operation " + std::to_string(operation));
+
+				if (!shadow.Insert(0, allocation.Offset, allocation.Size))
+					Fail(result, "TLSF range overlaps a live range at operation " + std::to_string(operation));
+
+				live.push_back(allocation);
+				result.Allocations++;
+			}
+			else
+			{
+				uint32_t index = random.Range(0, (uint32_t)live.size());
+				HT::TLSFAllocation allocation = live[index];
+				live[index] = live.back();
+				live.pop_back();
+
+				if (!shadow.Erase(0, allocation.Offset))
+					Fail(result, "Freeing a TLSF range the shadow doesn't know at operation " + std::to_string(operation));
+
+				allocator.Free(allocation);
+				result.Frees++;
+			}
+
+			result.PeakAllocations = HTUtils::HTMax(result.PeakAllocations, (uint32_t)live.size());
+
+			if (config.ValidateInterval > 0 && operation % config.ValidateInterval == 0)
+			{
+				if (!allocator.Validate())
+					Fail(result, "TLSF validation failed at operation " + std::to_string(operation));
+
+				HT::TLSFStats stats = allocator.GetStats();
+				result.PeakUtilization = HTUtils::HTMax(result.PeakUtilization, stats.GetUtilization());
+				result.PeakFragmentation = HTUtils::HTMax(result.PeakFragmentation, stats.GetFragmentation());
+				result.Validations++;
+			}
+		}
+
+		//Everything freed must merge back into a single block
+		for (HT::TLSFAllocation& allocation : live)
+			allocator.Free(allocation);
+
+		HT::TLSFStats stats = allocator.GetStats();
+		if (!allocator.Validate() || stats.FreeBlockCount != 1 || stats.LargestFreeBlock != allocator.GetCapacity() || stats.UsedSize != 0)
+			Fail(result, "The TLSF allocator didn't merge back into one block after freeing everything");
+
+		return result;
+	}
+
+	FuzzResult FuzzHeapAllocator(const FuzzConfig& config, HT::GPUHeapAllocatorStats& outPeakStats)
+	{
+		FuzzResult result;
+		FuzzRandom random(config.Seed * 7919u);
+
+		HT::CPUFence fence;
+		HT::CPUResidencyBackend residencyBackend;
+		HT::CPUGPUHeapBackend heapBackend;
+
+		{
+			HT::ResidencyManager residencyManager(&residencyBackend, &residencyBackend, &fence);
+			HT::GPUHeapAllocator allocator(&heapBackend, &residencyManager);
+
+			struct PendingRange
+			{
+				uint64_t Heap;
+				uint64_t Offset;
+				uint64_t FenceValue;
+			};
+
+			std::vector<HT::GPUAllocation> live;
+			std::vector<PendingRange> pending;
+			ShadowRanges shadow;
+
+			//A frame is 100 operations and the GPU is 2 frames behind
+			const uint32_t operationsPerFrame = 100;
+			const uint32_t framesBehind = 2;
+
+			for (uint32_t operation = 0; operation < config.HeapOperations && result.Passed; operation++)
+			{
+				if (operation % operationsPerFrame == 0)
+				{
+					uint64_t frameValue = fence.Signal();
+					if (frameValue > framesBehind)
+						fence.Complete(frameValue - framesBehind);
+
+					uint64_t completedValue = fence.GetCompletedValue();
+					allocator.BeginFrame(completedValue);
+
+					//The shadow lets the ranges go at the same time, anything given out before this would overlap them
+					for (size_t i = 0; i < pending.size();)
+					{
+						if (pending[i].FenceValue <= completedValue)
+						{
+							shadow.Erase(pending[i].Heap, pending[i].Offset);
+							pending[i] = pending.back();
+							pending.pop_back();
+						}
+						else
+						{
+							i++;
+						}
+					}
+				}
+
+				bool filling = (operation / 50000) % 2 == 0;
+				bool allocate = live.empty() || random.Range(0, 100) < (filling ? 60u : 40u);
+
+				if (allocate)
+				{
+					//Mostly small buffers and textures, sometimes something that needs a heap of its own
+					uint64_t size = random.Range(0, 200) == 0 ? random.LogSize(24, 26) : random.LogSize(8, 22);
+					uint64_t alignment = random.Range(0, 32) == 0 ? (4ull << 20) : random.Range(0, 2) == 0 ? (64ull << 10) : (4ull << 10);
+					HT::GPUHeapType type = (HT::GPUHeapType)random.Range(0, (uint32_t)HT::GPUHeapType::Count);
+					HT::GPUHeapCategory category = (HT::GPUHeapCategory)random.Range(0, (uint32_t)HT::GPUHeapCategory::Count);
+
+					HT::GPUAllocation allocation = allocator.Allocate(size, alignment, type, category);
+					if (!allocation.IsValid())
+					{
+						result.FailedAllocations++;
+						continue;
+					}
+
+					if (allocation.Size < size || allocation.Offset % alignment != 0)
+						Fail(result, "Heap range too small or not aligned at operation " + std::to_string(operation));
+
+					if (!residencyManager.IsResident(allocation.Residency))
+						Fail(result, "The heap of an allocation is not registered in the residency manager at operation " + std::to_string(operation));
+
+					if (!shadow.Insert((uint64_t)(uintptr_t)allocation.NativeHeap, allocation.Offset, allocation.Size))
+						Fail(result, "Heap range overlaps a live or pending range at operation " + std::to_string(operation));
+
+					live.push_back(allocation);
+					result.Allocations++;
+				}
+				else
+				{
+					uint32_t index = random.Range(0, (uint32_t)live.size());
+					HT::GPUAllocation allocation = live[index];
+					live[index] = live.back();
+					live.pop_back();
+
+					//Used by the frame being recorded
+					uint64_t fenceValue = fence.GetLastSignaledValue() + 1;
+					pending.push_back({ (uint64_t)(uintptr_t)allocation.NativeHeap, allocation.Offset, fenceValue });
+
+					allocator.Free(allocation, fenceValue);
+					result.Frees++;
+				}
+
+				result.PeakAllocations = HTUtils::HTMax(result.PeakAllocations, (uint32_t)live.size());
+
+				if (config.ValidateInterval > 0 && operation % config.ValidateInterval == 0)
+				{
+					HT::GPUHeapAllocatorStats stats = allocator.GetStats();
+					if (stats.HeapCount != heapBackend.GetLiveHeapCount() || stats.HeapBytes != heapBackend.GetLiveHeapBytes() ||
+						stats.HeapCount != residencyManager.GetStats().HeapCount)
+						Fail(result, "The heaps of the allocator, the backend and the residency manager don't match at operation " + std::to_string(operation));
+
+					if (stats.HeapBytes > outPeakStats.HeapBytes)
+						outPeakStats = stats;
+
+					result.PeakUtilization = HTUtils::HTMax(result.PeakUtilization, stats.GetUtilization());
+					result.PeakFragmentation = HTUtils::HTMax(result.PeakFragmentation, stats.GetFragmentation());
+					result.Validations++;
+				}
+			}
+
+			for (HT::GPUAllocation& allocation : live)
+				allocator.Free(allocation, fence.GetLastSignaledValue() + 1);
+
+			fence.Signal();
+			fence.CompleteAll();
+			allocator.BeginFrame(fence.GetCompletedValue());
+
+			HT::GPUHeapAllocatorStats stats = allocator.GetStats();
+			if (stats.AllocationCount != 0 || stats.UsedBytes != 0 || stats.DedicatedHeapCount != 0)
+				Fail(result, "The heap allocator still has allocations after freeing everything");
+		}
+
+		if (heapBackend.GetLiveHeapCount() != 0 || residencyBackend.GetLiveHeapCount() != 0)
+			Fail(result, "Heaps leaked after destroying the heap allocator");
+
+		return result;
+	}
+
+	struct BenchmarkResult
+	{
+		uint64_t Operations = 0;
+		uint64_t ElapsedNs = 0;
+		HT::TLSFStats Stats;
+	};
+
+	//Steady state of a half full heap: free a random range, allocate a random one. No shadow, no validation, only the allocator.
+	BenchmarkResult BenchmarkTLSF(const FuzzConfig& config)
+	{
+		BenchmarkResult result;
+		FuzzRandom random(config.Seed * 104729u);
+
+		HT::TLSFAllocator allocator((uint64_t)config.CapacityMB << 20, config.Granularity);
+		std::vector<HT::TLSFAllocation> live;
+
+		//The sizes are generated up front, so the timing is only the allocator
+		const uint32_t sizeCount = 1u << 16;
+		std::vector<uint64_t> sizes(sizeCount);
+		for (uint64_t& size : sizes)
+			size = random.LogSize(8, 18);
+
+		for (uint32_t i = 0; allocator.GetUsedSize() < allocator.GetCapacity() / 2; i++)
+		{
+			HT::TLSFAllocation allocation = allocator.Allocate(sizes[i % sizeCount]);
+			if (!allocation.IsValid())
+				break;
+
+			live.push_back(allocation);
+		}
+
+		uint64_t begin = HTUtils::HTNowNanoseconds();
+
+		for (uint32_t operation = 0; operation < config.BenchmarkOperations; operation++)
+		{
+			uint32_t index = random.Next() % (uint32_t)live.size();
+			allocator.Free(live[index]);
+
+			live[index] = allocator.Allocate(sizes[operation % sizeCount]);
+			if (!live[index].IsValid())
+			{
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		result.ElapsedNs = HTUtils::HTNowNanoseconds() - begin;
+		result.Operations = (uint64_t)config.BenchmarkOperations * 2;
+		result.Stats = allocator.GetStats();
+		return result;
+	}
+
+	void WriteFuzzResult(const char* name, const FuzzResult& result, std::ostream& stream)
+	{
+		stream << "\t\"" << name << "\": { ";
+		stream << "\"passed\": " << (result.Passed ? "true" : "false") << ", ";
+		stream << "\"allocations\": " << result.Allocations << ", ";
+		stream << "\"frees\": " << result.Frees << ", ";
+		stream << "\"failedAllocations\": " << result.FailedAllocations << ", ";
+		stream << "\"validations\": " << result.Validations << ", ";
+		stream << "\"peakAllocations\": " << result.PeakAllocations << ", ";
+		stream << "\"peakUtilization\": " << result.PeakUtilization << ", ";
+		stream << "\"peakFragmentation\": " << result.PeakFragmentation;
+
+		if (!result.Passed)
+			stream << ", \"error\": \"" << result.Error << "\"";
+
+		stream << " },\n";
+	}
+
+	bool ParseFuzzArguments(int argc, char** argv, FuzzConfig& outConfig, std::string& outError)
+	{
+		struct NumberOption
+		{
+			const char* Name;
+			uint32_t* Value;
+		};
+
+		const NumberOption numberOptions[] =
+		{
+			{ "--ops",            &outConfig.Operations },
+			{ "--heap-ops",       &outConfig.HeapOperations },
+			{ "--bench-ops",      &outConfig.BenchmarkOperations },
+			{ "--capacity-mb",    &outConfig.CapacityMB },
+			{ "--granularity",    &outConfig.Granularity },
+			{ "--validate-every", &outConfig.ValidateInterval },
+			{ "--seed",           &outConfig.Seed },
+		};
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+
+			if (i + 1 >= argc)
+			{
+				outError = "Missing the value of " + argument;
+				return false;
+			}
+
+			const char* value = argv[++i];
+
+			bool found = false;
+			for (const NumberOption& option : numberOptions)
+			{
+				if (argument != option.Name)
+					continue;
+
+				char* end = nullptr;
+				unsigned long number = strtoul(value, &end, 10);
+
+				if (end == value || *end != '\0')
+				{
+					outError = "Invalid number for " + argument + ": " + value;
+					return false;
+				}
+
+				*option.Value = (uint32_t)number;
+				found = true;
+				break;
+			}
+
+			if (!found)
+			{
+				outError = "Unknown argument " + argument;
+				return false;
+			}
+		}
+
+		if (!HTUtils::HTIsPowerOfTwo(outConfig.Granularity))
+		{
+			outError = "--granularity must be a power of two";
+			return false;
+		}
+
+		//The biggest fuzz allocation (8MB with a 4MB alignment) must fit
+		if (outConfig.CapacityMB < 16)
+		{
+			outError = "--capacity-mb must be at least 16";
+			return false;
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	FuzzConfig config;
+	std::string error;
+
+	if (!ParseFuzzArguments(argc, argv, config, error))
+	{
+		std::cerr << error << "\n";
+		std::cerr << "Usage: D3D12HTAllocatorFuzz [--ops N] [--heap-ops N] [--bench-ops N] [--capacity-mb N] [--granularity N] [--validate-every N] [--seed N]\n";
+		return 1;
+	}
+
+	FuzzResult tlsf = FuzzTLSF(config);
+
+	HT::GPUHeapAllocatorStats peakHeapStats;
+	FuzzResult heaps = FuzzHeapAllocator(config, peakHeapStats);
+
+	BenchmarkResult benchmark = BenchmarkTLSF(config);
+	double nsPerOperation = benchmark.Operations > 0 ? (double)benchmark.ElapsedNs / (double)benchmark.Operations : 0.0;
+
+	std::ostream& stream = std::cout;
+	stream << "{\n";
+	stream << "\t\"config\": { \"ops\": " << config.Operations << ", \"heapOps\": " << config.HeapOperations << ", \"benchOps\": " << config.BenchmarkOperations
+	       << ", \"capacityMB\": " << config.CapacityMB << ", \"granularity\": " << config.Granularity << ", \"seed\": " << config.Seed << " },\n";
+
+	WriteFuzzResult("tlsf", tlsf, stream);
+	WriteFuzzResult("heapAllocator", heaps, stream);
+
+	stream << "\t\"peakHeaps\": { ";
+	stream << "\"heaps\": " << peakHeapStats.HeapCount << ", ";
+	stream << "\"dedicatedHeaps\": " << peakHeapStats.DedicatedHeapCount << ", ";
+	stream << "\"heapMB\": " << (peakHeapStats.HeapBytes >> 20) << ", ";
+	stream << "\"usedMB\": " << (peakHeapStats.UsedBytes >> 20) << ", ";
+	stream << "\"utilization\": " << peakHeapStats.GetUtilization() << ", ";
+	stream << "\"fragmentation\": " << peakHeapStats.GetFragmentation() << " },\n";
+
+	stream << "\t\"benchmark\": { ";
+	stream << "\"operations\": " << benchmark.Operations << ", ";
+	stream << "\"totalMs\": " << HTUtils::HTNanosecondsToMilliseconds(benchmark.ElapsedNs) << ", ";
+	stream << "\"nsPerOperation\": " << nsPerOperation << ", ";
+	stream << "\"allocations\": " << benchmark.Stats.AllocationCount << ", ";
+	stream << "\"freeBlocks\": " << benchmark.Stats.FreeBlockCount << ", ";
+	stream << "\"utilization\": " << benchmark.Stats.GetUtilization() << ", ";
+	stream << "\"fragmentation\": " << benchmark.Stats.GetFragmentation() << " }\n";
+	stream << "}\n";
+
+	return tlsf.Passed && heaps.Passed ? 0 : 1;
+}
@@ -34,6 +34,16 @@
 //Kinda boring to write Microsoft::WRL::ComPtr<> every time.
 using namespace Microsoft::WRL;
 
+//We own our D3D12/DXGI objects with HT::ComRef, it is like ComPtr but it also builds on Linux (so the code around it can be tested there).
+//Everything we create is released now, either when its owner goes away or through the deferred release queue below.
+#include <renderer/comRef.h>
+#include <renderer/deferredReleaseQueue.h>
+
+//To list the D3D12/DXGI objects still alive when we close (the leaks), see the end of main
+#ifdef _DEBUG
+#include <dxgidebug.h>
+#endif
+
 //To ease the number of header files included by windows
 #define WIN32_LEAN_AND_MEAN
 
@@ -42,14 +52,94 @@ using namespace Microsoft::WRL;
 //to use timers and get the actual time
 #include <chrono>
 
+//To dump our frame statistics to a file
+#include <fstream>
+
 //For general utilities, like the "max" function (better than include the whole <algorithm>) (=
 #include <util/utils.h>
 
+//A monotonic clock in nanoseconds
+#include <util/timer.h>
+
+//Per phase frame timings (record, execute, present, fence wait, input to present...) with percentiles and histograms
+#include <core/frameStats.h>
+
+//The per frame resources and the CPU/GPU frame pacing
+#include <renderer/frameRing.h>
+#include <renderer/d3d12/d3d12Fence.h>
+
+//The per frame upload memory (constants, dynamic vertices...)
+#include <renderer/uploadRing.h>
+#include <renderer/d3d12/d3d12UploadHeap.h>
+
+//Descriptor heaps, paged allocators and the per frame descriptor tables
+#include <renderer/descriptorAllocator.h>
+#include <renderer/d3d12/d3d12DescriptorHeapBackend.h>
+
+//Automatic resource state tracking and batched barriers
+#include <renderer/resourceStateTracker.h>
+#include <renderer/d3d12/d3d12Barriers.h>
+
+//Passes declared with their reads and writes, culled, ordered and with aliased transient memory
+#include <renderer/frameGraph.h>
+
+//Work stealing jobs, used to record the command lists of a frame on many threads
+#include <core/jobSystem.h>
+#include <renderer/d3d12/d3d12ParallelRecorder.h>
+
+//Command allocators and lists on demand, recycled when their fence completes
+#include <renderer/commandPool.h>
+#include <renderer/d3d12/d3d12CommandPoolBackend.h>
+
+//The memory budget of the OS and the eviction of the heaps we didn't use for a while
+#include <renderer/residencyManager.h>
+#include <renderer/d3d12/d3d12Residency.h>
+
+//Placed resources in big heaps, instead of a committed resource (and its own heap) for every buffer and texture
+#include <renderer/gpuHeapAllocator.h>
+#include <renderer/d3d12/d3d12HeapBackend.h>
+
+//Texture streaming
+#include <renderer/textureStreamer.h>
+#include <renderer/d3d12/d3d12TextureUploadSink.h>
+#include <filesystem>
+
+//The compute and copy queues and the waits/signals between the queues
+#include <renderer/queueScheduler.h>
+#include <renderer/d3d12/d3d12QueueBackend.h>
+
+//What we send to the queues, captured to a file that the benchmark replays on Linux (D3D12HTBenchmark --replay)
+#include <renderer/commandCapture.h>
+
+//Shader compilation with an on-disk cache of the bytecode
+#include <renderer/shaderCache.h>
+#include <renderer/d3d12/d3dShaderCompiler.h>
+
+//Pipelines hashed, created ahead of time on the job system and saved in a pipeline library
+#include <renderer/pipelineCache.h>
+#include <renderer/d3d12/d3d12PipelineBackend.h>
+
+//GPU timings of named scopes with timestamp queries, read back a few frames later without waiting for the GPU
+#include <renderer/gpuProfiler.h>
+#include <renderer/d3d12/d3d12TimestampBackend.h>
+
+//The render thread and the events the window thread sends to it
+#include <thread>
+#include <core/renderEvents.h>
+
+//Scoped CPU timings of every thread, written as a Chrome trace. The scopes compile to nothing in Dist.
+#include <core/cpuProfiler.h>
+
 //This is the number of back buffers we have. This is, how many targets we are rendering while a target is being shown
 //While the program is presenting a frame to the screen, we are drawing another one under the hood.
 //i.e 2 = double buffering, 3 = triple buffering etc...
 const uint8_t g_NumFrames = 3;
 
+//This is the maximum number of frames the CPU can be recording/submitting while the GPU is still working on the previous ones. 
+//It is not the same thing as the number of back buffers. We can choose (at runtime) to use fewer frames in flight or to limit how many frames
+//we queue to the GPU, see g_FrameRing below.
+const uint8_t g_MaxFramesInFlight = 4;
+
 //Our initial window dimensions, we will be updating this once we take the screen size.
 uint32_t g_WindowWidth  = 1280;
 uint32_t g_WindowHeight = 720;
@@ -68,39 +158,47 @@ RECT g_WindowRect;
 //-------------- DirectX 12 Objects
 
 //The device is the virtual handle of the DirectX in the GPU. We will create everything DX12 related from a Device.
-ID3D12Device2* g_Device = nullptr;
+//It is the last global to be destroyed, every object created by it is already released by then.
+HT::ComRef<ID3D12Device2> g_Device;
 
-//A command allocator contains all of our commands. We will use a command list to record commands in this allocator
-//then, we will send this allocator to the command queue so all the commands inside it will be executed.
-//We have an array of allocators because each allocator have commands to draw a frame. So, if we have 3 frames,
-//then we will have 3 allocators. When the Command Queue are executing one allocator (drawing and then showing a screen),
-//we are recording on another.
-ID3D12CommandAllocator* g_CommandAllocators[g_NumFrames] = {};
+//The GPU we created the device on (the one with the most dedicated memory)
+HT::ComRef<IDXGIAdapter4> g_Adapter;
 
-//The command list will record all of our commands (inside command allocators)
+//The command list will record all of our commands (inside command allocators). It is the list of the current frame, taken from the command pool.
 ID3D12GraphicsCommandList* g_CommandList = nullptr;
 
 //A command queue will execute all of our commands inside command allocators (a Draw is a command, for example)
 //It can execute other commands as well, not necessarily inside a command allocator.
-ID3D12CommandQueue* g_CommandQueue = nullptr;
+HT::ComRef<ID3D12CommandQueue> g_CommandQueue;
 
 //This structure will be responsible to handle all "show to screen" part for us. You can notice that is not a D3D12 object
 //but a IDXGI, this is because the swap chain will show our image (D3D) to our Window (OS), so it will make this bridge for us,
 //this being part of the infrastructure.
-IDXGISwapChain4* g_SwapChain = nullptr;
+HT::ComRef<IDXGISwapChain4> g_SwapChain;
 
 //Almost everything in DirectX is a resource. In this case, the textures (our render targets) will be a texture.
-ID3D12Resource* g_BackBuffers[g_NumFrames] = {};
+HT::ComRef<ID3D12Resource> g_BackBuffers[g_NumFrames];
 
 //A descriptor heap is a place where we store descriptors. Whenever we have a resource, we have a struct that describes it
 //Like, what is the format of the texture? How many channels? How larger is it? Where is it in memory? 
 //We will store all of this inside a descriptor.
-ID3D12DescriptorHeap* g_RTVDescriptorHeap = nullptr;
+//We don't create the heaps by hand anymore. The descriptor manager creates pages of CPU-only heaps for each type as we need them
+//and it has the shader visible heaps we use (as rings) for the descriptor tables of each frame.
+HT::D3D12DescriptorHeapBackend* g_DescriptorHeapBackend = nullptr;
+HT::DescriptorManager* g_DescriptorManager = nullptr;
 
-//Descriptors can have different size based on its type and vendor (amd, nvidia etc...). We are querying the size of a RTV descriptor so we can create a
-//descriptor heap that knows the size of each of its slots. (And this one will only store RTV's or other descriptors with
-//the same size)
-uint32_t g_RTVDescriptorSize = 0;
+//The RTVs of our back buffers. One contiguous range, so the view of the back buffer i is just g_BackBufferRTVs.At(i).
+//Descriptors can have different size based on its type and vendor (amd, nvidia etc...), the range already knows the size of a RTV in this device.
+HT::DescriptorRange g_BackBufferRTVs;
+
+//Every resource must be in the right state before we use it (e.g: a render target to be written, a texture to be read by a shader...).
+//The registry knows in which state each resource is after all the command lists we already submitted, and the tracker
+//records the states inside our command list and generates the barriers for us.
+HT::ResourceStateRegistry g_ResourceStates;
+HT::ResourceStateTracker g_CommandListStates;
+
+//The passes of our frame. It is rebuilt every frame, see Render.
+HT::FrameGraph g_FrameGraph;
 
 //We need to take count in which backbuffer we are drawing/showing. After sending the backbuffer 0 to be executed and shown
 //we will increment this, and in the next iteration, we will be drawing/recording commands in the backbuffer 1.
@@ -117,7 +215,7 @@ uint32_t g_CurrentBackBufferIndex = 0;
 //didn't finish to use this resource. So, when the GPU is running and using a resource, we must wait on CPU before we can modify/delete it.
 //We don't need to worry for now about other command allocators using the same resource because they are sequential and all of them represents the GPU
 //But when we have, for example, some Compute commands to write a texture for us, we can also synchronize between queues in the GPU side.
-ID3D12Fence* g_Fence = nullptr;
+HT::ComRef<ID3D12Fence> g_Fence;
 
 //When we are in the beginning of the main loop (usually in the render part) we increment the g_FenceValue (in the CPU/C++ side)
 //and issue a command to the GPU to update its internal fence value to our actual fence value (g_FenceValue). This is done through a command.
@@ -127,12 +225,107 @@ ID3D12Fence* g_Fence = nullptr;
 //command is the last one, so we know that we executed everything.
 uint64_t     g_FenceValue = 0;
 
-//Each frame will have its own fence, this is, each allocator will have its own value to be updated at the last place (fence value)
-//to be compared with the CPU value.
-uint64_t     g_FrameFenceValues[g_NumFrames] = {};
-
 //This will be an OS event, Windows will tell us that our GPU fence value has reached our CPU fence value, through this event.
 HANDLE       g_FenceEvent;
+
+//The same fence, counter and event above, but behind the HT::IFence interface. So the frame ring doesn't need to know that it is talking to D3D12.
+HT::D3D12Fence* g_FrameFence = nullptr;
+
+//Each frame will have its own fence value to be compared with the CPU value. The frame ring keeps those values, and before we reuse a slot it waits for its fence.
+//Press 1-4 to change the frames in flight and 'L' to toggle between the low latency and high throughput pacing modes.
+HT::FrameRing<g_MaxFramesInFlight>* g_FrameRing = nullptr;
+
+//Objects the GPU may still be using when we are done with them. They wait here for the fence value of the last frame that used them
+//and are released at the beginning of a later frame, so we never have to stall (or flush) just to release something.
+HT::DeferredReleaseQueue* g_DeferredRelease = nullptr;
+// --------------
+
+// -------------- Residency
+
+//Choosing the GPU with the most memory is not enough, the OS gives us a budget (that changes while we run) and if we go over it, it pages our heaps out by itself
+//and the frame times collapse. The residency manager polls the budget every frame and evicts the heaps we didn't use for the longest time when we are over it.
+//Every heap we create is registered in it and every frame marks the heaps it uses (see HT::ResidencyManager).
+HT::D3D12ResidencyBackend* g_ResidencyBackend = nullptr;
+HT::DXGIMemoryBudgetSource* g_MemoryBudgetSource = nullptr;
+HT::ResidencyManager* g_ResidencyManager = nullptr;
+
+HT::ResidencyHandle g_UploadHeapResidency = HT::g_InvalidResidencyHandle;
+// --------------
+
+// -------------- GPU memory
+
+//Every buffer and texture we create goes in here (see HT::CreatePlacedResource). Its heaps are registered in the residency manager.
+//The memory of a released resource is given back once the frame fence passes the last frame that used it.
+HT::D3D12HeapBackend* g_HeapBackend = nullptr;
+HT::GPUHeapAllocator* g_HeapAllocator = nullptr;
+// --------------
+
+// -------------- Command allocators
+
+//A command allocator contains all of our commands. We will use a command list to record commands in this allocator
+//then, we will send this allocator to the command queue so all the commands inside it will be executed.
+//We can't reuse an allocator while the GPU is executing its commands. Instead of one allocator per frame in flight, we have a pool (one for each queue type)
+//that hands out allocators on demand and gets them back once the fence signaled after their submission is reached.
+//So a frame can record as many lists as it needs and worker threads never have to wait for a frame slot to get one.
+HT::D3D12CommandPoolBackend* g_CommandPoolBackend = nullptr;
+HT::CommandPool* g_DirectCommandPool = nullptr;
+// --------------
+
+// -------------- Async queues
+
+//With a single direct queue, the uploads and the compute work wait behind the graphics work. The GPU has dedicated engines for copies and compute,
+//so we also have a compute queue and a copy queue, each one with its own fence, and the work submitted to them can overlap with the rendering.
+//Each queue also has its own command pool, the fence of the queue is the one that recycles its allocators.
+struct AsyncQueue
+{
+	HT::ComRef<ID3D12CommandQueue> Queue;
+	HT::ComRef<ID3D12Fence> Fence;
+	uint64_t FenceValue = 0;
+	HANDLE FenceEvent = nullptr;
+
+	HT::D3D12Fence* QueueFence = nullptr;
+	HT::CommandPool* CommandPool = nullptr;
+};
+
+AsyncQueue g_ComputeQueue;
+AsyncQueue g_CopyQueue;
+
+//We don't sync the queues by hand. A submission tells the scheduler which work of other queues it depends on and the scheduler inserts 
+//only the waits and signals that are really needed (see HT::QueueScheduler).
+HT::D3D12QueueBackend* g_QueueBackend = nullptr;
+HT::QueueScheduler* g_QueueScheduler = nullptr;
+
+//The scheduler and the frame ring talk to the queues through the capture backend. F4 starts a capture of everything that is submitted and F4 again writes it.
+//Our lists are D3D12 lists, they can't be read back, so while we capture every list records its commands on a null list too (g_CaptureShadowLists).
+HT::CaptureQueueBackend* g_CaptureQueueBackend = nullptr;
+HT::CaptureShadowLists g_CaptureShadowLists;
+std::unique_ptr<HT::CommandCaptureWriter> g_CommandCapture;
+const char* g_CommandCapturePath = "frameCapture.htcap";
+// --------------
+
+// -------------- Per frame upload memory
+
+//Every frame we will have data that the CPU computes and the GPU reads (constants, dynamic vertices etc...). 
+//Creating a resource for each upload would be way too slow, so we have one big mapped buffer in an upload heap and we suballocate it linearly.
+//The memory of a frame is given back once the fence of this frame (the one the frame ring signaled) is completed.
+const uint64_t g_UploadRingSize = 4 * 1024 * 1024;
+
+HT::D3D12UploadHeap* g_UploadHeap = nullptr;
+HT::UploadRing* g_UploadRing = nullptr;
+// --------------
+
+// -------------- Texture streaming
+
+//The .dds files of this directory are memory mapped at startup and their mips are streamed in, the ones that matter most on screen first.
+//The reads go straight from the files to an upload heap of their own (on an I/O thread), and the frame copies them to the textures (see HT::TextureStreamer).
+const char* g_TextureDirectory = "textures";
+const uint64_t g_TextureStreamingMemorySize = 64 * 1024 * 1024;
+
+HT::D3D12UploadHeap* g_StreamingUploadHeap = nullptr;
+HT::ResidencyHandle g_StreamingUploadHeapResidency = HT::g_InvalidResidencyHandle;
+HT::D3D12TextureUploadSink* g_TextureSink = nullptr;
+HT::TextureStreamer* g_TextureStreamer = nullptr;
+std::vector<HT::TextureHandle> g_StreamedTextures;
 // --------------
 
 //If we are going to use VSync.
@@ -141,9 +334,72 @@ bool g_VSync = true;
 //True when we are in fullscreen mode
 bool g_Fullscreen = false;
 
+//Update and Render run on their own thread, so the frames don't depend on the window messages (dragging the window used to stall the rendering)
+//and the window thread can sleep until a message arrives instead of spinning. The render thread owns the swap chain and the frame state:
+//the window thread never touches them, it posts events (resize, fullscreen, vsync...) and the render thread applies them between two frames.
+std::thread g_RenderThread;
+std::atomic<bool> g_RenderThreadRunning = false;
+HT::RenderEventQueue g_RenderEvents;
+
+//The swap chain is a queue of presents (see the end of Render). By default DXGI lets us queue 3 frames, and when the queue is full Present blocks.
+//But we sampled the input before recording, so the input waits in Present and then in the queue: the more frames queued, the more input lag.
+//With the waitable latency mode we wait on the frame latency object of the swap chain (signaled when the queue has room) before sampling the input,
+//so Present never blocks and every frame starts with the freshest input. HT::PresentQueueModel simulates both modes, the benchmark prints them.
+//Press 'K' to toggle the mode and '[' / ']' to change the max frame latency (how many presents can be queued).
+const uint32_t g_MaxSwapChainFrameLatency = 16;
+
+HANDLE g_FrameLatencyWaitable = nullptr;
+bool g_WaitableLatencyMode = true;
+uint32_t g_SwapChainFrameLatency = 1;
+
+//When the render thread sampled the input (drained the window events) for the current frame. The frame stats keep how long it took to reach Present.
+uint64_t g_InputSampleNs = 0;
+uint64_t g_LatencyWaitNs = 0;
+
 //Sometimes we want to use a custom vsync technology, we can let the tearing occur so the application can decide when the vertical refresh should be done
 bool g_TearingSupported = false;
 
+//The timings of every phase of the last frames. The FPS alone hides the hitches, so we keep the p50/p95/p99/max of each phase.
+//Press F1 to dump it as CSV and F2 to dump it as JSON.
+HT::FrameStats g_FrameStats;
+
+//The worker threads. Recording a lot of draws is expensive on the CPU, so the draws are split in chunks and every chunk is recorded
+//on its own command list by a job. All the lists are submitted in order with a single ExecuteCommandLists.
+HT::JobSystem* g_JobSystem = nullptr;
+HT::D3D12ParallelRecorder* g_ParallelRecorder = nullptr;
+
+//The timestamps of the direct queue. The GPU time of the last frame read back and how many frames late it was are printed with the FPS.
+HT::D3D12TimestampBackend* g_TimestampBackend = nullptr;
+HT::GPUProfiler* g_GPUProfiler = nullptr;
+double g_GPUFrameMs = 0.0;
+uint32_t g_GPUFrameLatency = 0;
+
+//The CPU scopes of all our threads (and the GPU scopes of g_GPUProfiler) are written to a trace, open it in chrome://tracing or ui.perfetto.dev.
+//The startup is captured until the first g_StartupTraceFramesLeft frames are done. Then F3 starts a new capture and stops it (it overwrites the file).
+const char* g_CPUTracePath = "cpuTrace.json";
+uint32_t g_StartupTraceFramesLeft = 120;
+
+//How many draws we record this frame and how many draws a chunk must have at least to be worth its own command list.
+uint32_t g_SceneDrawCount = 0;
+const uint32_t g_MinDrawsPerChunk = 256;
+
+//Compiling HLSL at every startup is slow. The shaders are asked in batches to the compilation service: the ones that didn't change since the last run
+//are loaded from the cache folder and only the rest is compiled (in parallel, on the job system).
+const char* g_ShaderCacheDirectory = "shaderCache";
+
+HT::D3DShaderCompiler g_ShaderCompiler;
+HT::FileShaderSourceProvider g_ShaderSources;
+HT::ShaderDiskCache* g_ShaderDiskCache = nullptr;
+HT::ShaderCompilationService* g_ShaderService = nullptr;
+
+//Creating a pipeline state when we first draw with it is a hitch. The pipelines are requested to the cache ahead of time and created in the background,
+//and while a pipeline is not ready its draws use a fallback pipeline (or are skipped). Identical descs share the same pipeline.
+//The driver compiled pipelines are kept in a pipeline library next to the shader cache, so the next run just loads them.
+const char* g_PipelineLibraryPath = "shaderCache/pipelines.lib";
+
+HT::D3D12PipelineBackend* g_PipelineBackend = nullptr;
+HT::PipelineCache* g_PipelineCache = nullptr;
+
 
 //This function will handle OS events/messages. This is a forward declaration. It will be defined inside the main function after all directx related functions.
 //std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)> OSMessageHandler;
@@ -154,13 +410,19 @@ LRESULT TemporaryWndProc(HWND a, UINT b, WPARAM c, LPARAM d) { return DefWindowP
 
 int main()
 {
+#if !defined(D3D12HT_DIST)
+	HT_PROFILE_THREAD("Window Thread");
+	HT::CPUProfiler::Get().Start(g_CPUTracePath);
+	uint64_t initBeginTicks = HTUtils::HTReadTimestampCounter();
+#endif
+
 	//Before creating everything, we must create our debug layer. This is a helper feature of DX12, the API will try to give us hints in wrong stuff we did. 
 	//We have to create it before our ID3D12Device or it will not create the device with the right properties and it will remove the device on runtime.
 	//Also, before doing anything related to DX12, it is recommended to initialize the debug layer. So we can have
 	//messages in case anything went wrong. This includes the creation of the device, so we can have more info in case of failure.
 
 #ifdef _DEBUG
-	ID3D12Debug* debugInterface = nullptr;
+	HT::ComRef<ID3D12Debug> debugInterface;
 
 	//Get the Debug Interface and enable the Debug Layer.
 	//IID_PPV_ARGS is just a macro that looks the type of the variable we are sending in order to compute its IID (like an UIID)
@@ -168,7 +430,7 @@ int main()
 	//to point to the internal debug interface.
 	//Every time we have something that requires a separate IID and a interface pointer, we must use this macro. A lot of confusion can occur when 
 	//trying to do this by hand. This macro ensures that we are being persistent on the type of the variable, pointer and interface.
-	D3D12GetDebugInterface(IID_PPV_ARGS(&debugInterface));
+	D3D12GetDebugInterface(IID_PPV_ARGS(debugInterface.ReleaseAndGetAddressOf()));
 	debugInterface->EnableDebugLayer();
 #endif
 
@@ -239,7 +501,7 @@ int main()
 	//Before querying for available adapters (GPUs), we must create a DXGI Factory, this will let us to create other important DXGI objects.
 	//As said before, the DXGI is for stuff that is not related to the graphics API itself but for infrastructure. 
 	//Looking for and retrieving handles to available GPUs and its stats (GPU memory, clock, supported API versions etc...) is something related to infrastructure. 
-	IDXGIFactory4* dxgiFactory = nullptr;
+	HT::ComRef<IDXGIFactory4> dxgiFactory;
 	uint32_t createFactoryFlags = 0;
 	
 	//When enabling this debug flag, we are able to get errors when the factory fails to do an action (like creating a device or querying for adapters)
@@ -248,16 +510,17 @@ int main()
 #endif
 
 	//Let's actually create our factory and check if everything went fine.
-	Check(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)), "Failed to create DXGIFactory!");
+	Check(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())), "Failed to create DXGIFactory!");
 
 	//Now we will use this factory to query for a good GPU candidate.
 
 	//Create a pointer to an adapter and let's fill this pointer
-	IDXGIAdapter1* adapter1 = nullptr;
+	//ReleaseAndGetAddressOf releases the adapter of the previous iteration before EnumAdapters1 gives us the next one.
+	HT::ComRef<IDXGIAdapter1> adapter1;
 
 	//Adapter4 is an Adapter1 but with more features on it. Each AdapterN inherits from AdapterN-1 thus getting its features and adding more.
 	//EnumAdapters requires an Adapter1, so we will pass an Adapter1 and then cast this for an Adapter4, so we can use all features of Adapter4.
-	IDXGIAdapter4* adapter4 = nullptr;
+	//The adapter we choose is kept in g_Adapter, the residency manager asks it for the memory budget every frame.
 
 	//Usually, a safe parameter of a video card being better than other, is the available memory. 
 	//With this variable, we will try to get the GPU with the biggest dedicated video memory.
@@ -265,7 +528,7 @@ int main()
 
 	//EnumAdapters will retrieve an Adapter in the provided index. This is, if we have 4 adapters, we can get the first GPU by calling EnumAdapers with 0 as index and so on.
 	//We will iterate the GPU list in order to get the best GPU. Eventually, when we try to get a GPU that doesn't exist (e.g: index 4 in the list of 4 GPUs range[0,3]) it will return DXGI_ERROR_NOT_FOUND for us.
-	for (uint32_t i = 0; dxgiFactory->EnumAdapters1(i, &adapter1) != DXGI_ERROR_NOT_FOUND; i++)
+	for (uint32_t i = 0; dxgiFactory->EnumAdapters1(i, adapter1.ReleaseAndGetAddressOf()) != DXGI_ERROR_NOT_FOUND; i++)
 	{
 		//Let's query this adapter for a descriptor. A descriptor... describes the adapter. We can get important information through it.
 		DXGI_ADAPTER_DESC1 adapterDesc1; 
@@ -289,7 +552,7 @@ int main()
 			{
 				//If so, we just set it as our new best GPU and cast it to the equivalent Adapter4.
 				maxDedicatedVideoMemory = (uint32_t)adapterDesc1.DedicatedVideoMemory;
-				Check(adapter1->QueryInterface<IDXGIAdapter4>(&adapter4));
+				Check(adapter1->QueryInterface<IDXGIAdapter4>(g_Adapter.ReleaseAndGetAddressOf()));
 			}
 		}
 	}
@@ -301,12 +564,12 @@ int main()
 	//will be destroyed as well.
 
 	//Create the device and check if it succeeds
-	Check(D3D12CreateDevice(adapter4, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&g_Device)));
+	Check(D3D12CreateDevice(g_Adapter, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(g_Device.ReleaseAndGetAddressOf())));
 
 #ifdef _DEBUG
-	ID3D12InfoQueue* pInfoQueue = nullptr;
+	HT::ComRef<ID3D12InfoQueue> pInfoQueue;
 
-	g_Device->QueryInterface<ID3D12InfoQueue>(&pInfoQueue);
+	g_Device->QueryInterface<ID3D12InfoQueue>(pInfoQueue.ReleaseAndGetAddressOf());
 	
 	if (pInfoQueue)
 	{
@@ -336,7 +599,7 @@ int main()
 	commandQueueDescription.NodeMask = 0;
 
 	//Create our command queue.
-	Check(g_Device->CreateCommandQueue(&commandQueueDescription, IID_PPV_ARGS(&g_CommandQueue)));
+	Check(g_Device->CreateCommandQueue(&commandQueueDescription, IID_PPV_ARGS(g_CommandQueue.ReleaseAndGetAddressOf())));
 
 
 
@@ -345,8 +608,8 @@ int main()
 	//To make this, we must allow tearing to be done, this way, the "v-sync" will be done by the display itself
 	
 	//We then, query for the IDXGIFactory5 interface in order to be able to use CheckFeatureSupport()
-	IDXGIFactory5* dxgiFactory5 = nullptr;
-	Check(dxgiFactory->QueryInterface<IDXGIFactory5>(&dxgiFactory5));
+	HT::ComRef<IDXGIFactory5> dxgiFactory5;
+	Check(dxgiFactory->QueryInterface<IDXGIFactory5>(dxgiFactory5.ReleaseAndGetAddressOf()));
 	
 	BOOL tearingSupported = FALSE;
 	dxgiFactory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &tearingSupported, sizeof(tearingSupported));
@@ -378,11 +641,12 @@ int main()
 	swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;       //Indicates how we are going to handle transparency for the buffers. For now, we will not be using this.
 	
 	swapChainDesc.Flags = g_TearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0; //Tells to the swap chain if we are allowing tearing in order to use variable refresh rate.
+	swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;     //Gives us an object to wait on until the present queue has room (see g_FrameLatencyWaitable)
 
 
 	//Let's instantiate our swap chain object
-	IDXGISwapChain1* swapChain1 = nullptr;
-	Check(dxgiFactory->CreateSwapChainForHwnd(g_CommandQueue, g_hWnd, &swapChainDesc, nullptr, nullptr, &swapChain1));
+	HT::ComRef<IDXGISwapChain1> swapChain1;
+	Check(dxgiFactory->CreateSwapChainForHwnd(g_CommandQueue, g_hWnd, &swapChainDesc, nullptr, nullptr, swapChain1.ReleaseAndGetAddressOf()));
 	/* CreateSwapChainForHwnd arguments:
 	*  1 - A command queue of who we are creating this swap chain for
 	*  2 - The handle of the window that we are going to present to 
@@ -396,7 +660,13 @@ int main()
 	Check(dxgiFactory->MakeWindowAssociation(g_hWnd, DXGI_MWA_NO_ALT_ENTER));
 
 	//Let's cast our swap chain to a IDXGISwapChain4 and we are done!
-	Check(swapChain1->QueryInterface<IDXGISwapChain4>(&g_SwapChain));
+	Check(swapChain1->QueryInterface<IDXGISwapChain4>(g_SwapChain.ReleaseAndGetAddressOf()));
+
+	//With the waitable object flag, the max frame latency is set on the swap chain and not on the device.
+	//The object is signaled once per present that leaves the queue, it is a semaphore that starts at the max latency.
+	Check(g_SwapChain->SetMaximumFrameLatency(g_SwapChainFrameLatency));
+	g_FrameLatencyWaitable = g_SwapChain->GetFrameLatencyWaitableObject();
+	D3D_ASSERT(g_FrameLatencyWaitable, "Failed to get the frame latency waitable object!");
 
 
 	//Now that we have our swap chain, we need to create the descriptors for the swap chain back buffers
@@ -416,19 +686,17 @@ int main()
 	//If we have a RGB data but the view thinks that our data is 1 channel only (R), it would interpret a RGB data as 3 different colors 
 	//and this is totally wrong. 
 
-	//Let's create our descriptor heap:
+	//Let's create our descriptor manager:
 
-	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
-	descriptorHeapDesc.NumDescriptors = g_NumFrames;            //The number of descriptors in the heap
-	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;   //The type of views that we are going to store
-	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // The only other option is the D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE flag
 	//When we are creating descriptors, the application can decide if it want to store the descriptor in the CPU before copying it to the GPU (to be shade accessible)
-	//with this flag, we say to the application to create descriptors directly to the shader visible descriptor heaps without staging anything on the CPU.
-	//This flag only works with CBV, SRV and UAV
-	descriptorHeapDesc.NodeMask = 0; //We can create a heap for a specific GPU. Since we are using only one GPU, let's keep this on zero.
+	//or to create descriptors directly to the shader visible descriptor heaps without staging anything on the CPU (D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, only for CBV, SRV, UAV and samplers).
+	//The manager does the first: our views live in CPU-only heaps (created in pages, as many as we need) and every frame we copy the ones
+	//the shaders need to a shader visible ring.
+	g_DescriptorHeapBackend = new HT::D3D12DescriptorHeapBackend(g_Device);
+	g_DescriptorManager = new HT::DescriptorManager(g_DescriptorHeapBackend);
 
-	//Create our heap
-	Check(g_Device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&g_RTVDescriptorHeap)));
+	//One RTV for each back buffer. We only allocate it once, on resize we just overwrite the views.
+	g_BackBufferRTVs = g_DescriptorManager->GetAllocator(HT::DescriptorHeapType::RTV).Allocate(g_NumFrames);
 
 	//Now we can proceed to create our views (descriptors).
 
@@ -437,14 +705,6 @@ int main()
 	//Let's create our Render Target View (a resource where we are gong to render out screen to)
 	auto UpdateRenderTargetViews = []()
 	{
-		//Get the size of a RTV on this device. (size is vendor specific)
-		g_RTVDescriptorSize = g_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-		//We get the first handle of the heap, and we will use it to iterate our heap
-		//It is the same idea as taking the first element pointer of an array and adding + 1 to it
-		//Now, we have a pointer (inside this structure) to a descriptor inside the descriptor heap
-		CD3DX12_CPU_DESCRIPTOR_HANDLE firstRTVHandleIndex(g_RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
 		//One descriptor for each render target buffer 
 		for (uint32_t i = 0; i < g_NumFrames; i++)
 		{
@@ -456,14 +716,15 @@ int main()
 			//The first parameter is the resource that we are creating the descriptor to
 			//the second one is the description of the resource. Setting it to nullptr will make it to create a default descriptor for the resource
 			//In this case, the resource's internal description is used to create the RTV (when you create a resource, it asks for a bunch of details, it will use those details).
-			//The third parameter is only where we will store the descriptor. We will store it in this specific handle of the heap.
-			g_Device->CreateRenderTargetView(renderTarget, nullptr, firstRTVHandleIndex);
+			//The third parameter is only where we will store the descriptor. We will store it in the i-th handle of our range.
+			//It is the same idea as taking the first element pointer of an array and adding i to it (basically ptr + i * RTV size)
+			g_Device->CreateRenderTargetView(renderTarget, nullptr, HT::ToD3D12CPUHandle(g_BackBufferRTVs.At(i)));
 
-			//Now that our render target resources are complete, we can save them for later use.
-			g_BackBuffers[i] = renderTarget;
+			//Now that our render target resources are complete, we can save them for later use. GetBuffer gave us a reference, the ComRef takes it.
+			g_BackBuffers[i].Attach(renderTarget);
 
-			//Let's advance the handles to the available index. So we get a new handle next time. (basically ptr + g_RTVDescriptorSize)
-			firstRTVHandleIndex.Offset(g_RTVDescriptorSize);
+			//The swap chain buffers are created in the Present state
+			g_ResourceStates.Register(HT::ToResourceId(renderTarget), HT::ResourceState::Present);
 		}
 	};
 	
@@ -477,25 +738,17 @@ int main()
 	//We will know that the GPU is done, through a fence.
 	//D3D12_COMMAND_LIST_TYPE_DIRECT defines that this command allocator will have regular commands that the GPU can execute.
 	//beside the type DIRECT we also have the type COMPUTE (for compute dispatches), BUNDLE and COPY.
-	for (uint32_t i = 0; i < g_NumFrames; i++)
-		Check(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_CommandAllocators[i])));
-
-	//Now, let's create our command list.
-	Check(g_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_CommandAllocators[0], nullptr, IID_PPV_ARGS(&g_CommandList)));
-
-	//A command list is created in Recording state. The very first thing you want to do in the render loop is to Reset the command list.
-	//Because of the command list is created in recording state, we need to specify a command allocator that this command list will record to
-	//when creating the command list (CreateCommandList)
-	//We also will need to do this with the Reset() function, because the Reset() will set the command list to the recording state.
-	//Before reseting a command list, we must close it (the very last thing). So, let's change its state to Closed so it can be reset in the first iteration of the loop.
-	Check(g_CommandList->Close());
+	//The allocators (and the command lists recording into them) are created by our command pool, on demand, once we have our fence (see below).
+	//A command list is created in Recording state, we need to specify a command allocator that this command list will record to
+	//when creating the command list (CreateCommandList). We also will need to do this with the Reset() function, because the Reset() will set the command list to the recording state.
+	//The pool does that for us: a list is always handed out open, recording into an allocator the GPU is done with.
 
 	//In order to know when the GPU finished to execute all commands of a command allocator, we must setup a fence
 	//so the GPU can signal this fence for us.
 	//Let's create our fences!
 
 	//We should create the fence with 0 as being the value.
-	Check(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_Fence)));
+	Check(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(g_Fence.ReleaseAndGetAddressOf())));
 
 	//When the Fence reaches a specified value, it will trigger an event. As being the CPU, we can wait for this event to be triggered, thus knowing that the GPU finished all the job
 	//for this, let's create the event
@@ -509,78 +762,142 @@ int main()
 	*/
 
 	D3D_ASSERT(g_FenceEvent, "Failed to create fence event!");
-	
-	//So we can follow along all the tutorial instead of having to place a function and say "we will come later here, just ignore for now".
-	//And since this is a snippet of code that we will be using frequently, it worths to create a function just for it
-	auto SignalFence = [](ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, uint64_t& fenceValue ) -> uint64_t 
+
+	g_FrameFence = new HT::D3D12Fence(g_CommandQueue, g_Fence, &g_FenceValue, g_FenceEvent);
+	g_DeferredRelease = new HT::DeferredReleaseQueue(g_FrameFence);
+
+	//A slot more than the frames in flight, so the slot of a frame was always read by the time the frame ring lets us reuse it
+	HT::GPUProfilerConfig gpuProfilerConfig;
+	gpuProfilerConfig.FrameSlots = g_MaxFramesInFlight + 1;
+	g_TimestampBackend = new HT::D3D12TimestampBackend(g_Device, g_CommandQueue, HT::GPUProfiler::GetQueryCount(gpuProfilerConfig));
+	g_GPUProfiler = new HT::GPUProfiler(g_TimestampBackend, g_FrameFence, gpuProfilerConfig);
+
+	//The allocators of the direct queue are given back when the fence of this same queue reaches the value signaled after them
+	g_CommandPoolBackend = new HT::D3D12CommandPoolBackend(g_Device);
+	g_DirectCommandPool = new HT::CommandPool(g_CommandPoolBackend, HT::CommandQueueType::Direct, g_FrameFence);
+
+	//The compute and copy queues are created the same way as our direct queue, just with another type. Every one of them also gets a fence, a counter and an event.
+	auto CreateAsyncQueue = [](AsyncQueue& asyncQueue, HT::CommandQueueType type)
 	{
-		//Get the actual fence value and increment in the CPU
-		uint64_t fenceValueForSignal = ++fenceValue;
+		D3D12_COMMAND_QUEUE_DESC queueDescription = {};
+		queueDescription.Type = HT::ToD3D12CommandListType(type);
+		queueDescription.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+		queueDescription.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		queueDescription.NodeMask = 0;
 
-		//Ask for the GPU to update its fence with this CPU value. (this is run on the GPU, the CPU will not stop here, we will continue through our function)
-		Check(commandQueue->Signal(fence, fenceValueForSignal));
+		Check(g_Device->CreateCommandQueue(&queueDescription, IID_PPV_ARGS(asyncQueue.Queue.ReleaseAndGetAddressOf())));
+		Check(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(asyncQueue.Fence.ReleaseAndGetAddressOf())));
 
-		//Returns the value that we want the GPU to be on. We then will use this value to compare if the GPU has reached our fence. This is, we will stall until this fence is
-		//equal fenceValueForSignal.
-		return fenceValueForSignal;
+		asyncQueue.FenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+		D3D_ASSERT(asyncQueue.FenceEvent, "Failed to create fence event!");
+
+		asyncQueue.QueueFence = new HT::D3D12Fence(asyncQueue.Queue, asyncQueue.Fence, &asyncQueue.FenceValue, asyncQueue.FenceEvent);
+		asyncQueue.CommandPool = new HT::CommandPool(g_CommandPoolBackend, type, asyncQueue.QueueFence);
 	};
 
-	auto WaitForFenceValue = [](ID3D12Fence* fence, uint64_t fenceValueToWait, HANDLE fenceEvent)
+	CreateAsyncQueue(g_ComputeQueue, HT::CommandQueueType::Compute);
+	CreateAsyncQueue(g_CopyQueue, HT::CommandQueueType::Copy);
+
+	//Same order as HT::CommandQueueType
+	ID3D12CommandQueue* const queues[] = { g_CommandQueue, g_ComputeQueue.Queue, g_CopyQueue.Queue };
+	HT::D3D12Fence* const queueFences[] = { g_FrameFence, g_ComputeQueue.QueueFence, g_CopyQueue.QueueFence };
+
+	g_QueueBackend = new HT::D3D12QueueBackend(queues, queueFences);
+	g_CaptureQueueBackend = new HT::CaptureQueueBackend(g_QueueBackend, &g_CaptureShadowLists);
+	g_QueueScheduler = new HT::QueueScheduler(g_CaptureQueueBackend);
+
+	//Now we can create our frame ring. It starts with the same setup we had before: as many frames in flight as back buffers.
+	//It signals the frames through the capture backend, so they are in the captures.
+	g_FrameRing = new HT::FrameRing<g_MaxFramesInFlight>(g_CaptureQueueBackend->GetFence(HT::CommandQueueType::Direct), g_NumFrames);
+
+	//And the upload memory that all frames share
+	g_UploadHeap = new HT::D3D12UploadHeap(g_Device, g_UploadRingSize);
+
+	//The residency manager uses the fence of the frames, a heap is only evicted once the last frame that used it is done
+	g_ResidencyBackend = new HT::D3D12ResidencyBackend(g_Device);
+	g_MemoryBudgetSource = new HT::DXGIMemoryBudgetSource(g_Adapter);
+	g_ResidencyManager = new HT::ResidencyManager(g_ResidencyBackend, g_MemoryBudgetSource, g_FrameFence);
+
+	//The upload heap lives in system memory (it is a committed resource, the resource is its own heap)
+	g_UploadHeapResidency = g_ResidencyManager->Register(g_UploadHeap->GetResource(), g_UploadRingSize, HT::MemorySegment::NonLocal);
+	g_UploadRing = new HT::UploadRing(g_UploadHeap->GetMemory());
+
+	g_HeapBackend = new HT::D3D12HeapBackend(g_Device);
+	g_HeapAllocator = new HT::GPUHeapAllocator(g_HeapBackend, g_ResidencyManager);
+
+	//The streamed textures are placed in the heap allocator, the mips come through their own upload heap
+	g_StreamingUploadHeap = new HT::D3D12UploadHeap(g_Device, g_TextureStreamingMemorySize);
+	g_StreamingUploadHeapResidency = g_ResidencyManager->Register(g_StreamingUploadHeap->GetResource(), g_TextureStreamingMemorySize, HT::MemorySegment::NonLocal);
+	g_TextureSink = new HT::D3D12TextureUploadSink(g_Device, g_HeapAllocator, g_StreamingUploadHeap->GetResource(), g_ResidencyManager);
+	g_TextureStreamer = new HT::TextureStreamer(g_TextureSink, g_StreamingUploadHeap->GetMemory());
+
+	std::error_code directoryError;
+	if (std::filesystem::is_directory(g_TextureDirectory, directoryError))
 	{
-		//We check if the GPU has updated our fence to the CPU fence value
-		if (fence->GetCompletedValue() < fenceValueToWait)
+		for (const auto& entry : std::filesystem::directory_iterator(g_TextureDirectory, directoryError))
 		{
-			//If not, we will ask this fence to trigger this event once it reached the desired fence (usually, the CPU fence value)
-			Check(fence->SetEventOnCompletion(fenceValueToWait, fenceEvent));
+			if (entry.path().extension() != ".dds")
+				continue;
+
+			std::string error;
+			HT::TextureHandle texture = g_TextureStreamer->RegisterTexture(entry.path().string(), error);
 
-			//And now, we will stall the CPU until this event is triggered (i.e: until the GPU finishes its work).
-			//You can optionally set for how long you want to wait. In our case, we will wait for millions of years, or in this case, for a INFINITE time.
-			::WaitForSingleObject(fenceEvent, INFINITE);
+			if (texture != HT::g_InvalidTexture)
+				g_StreamedTextures.push_back(texture);
+			else
+				OutputDebugString(("Texture " + entry.path().string() + " not loaded: " + error + "\n").c_str());
 		}
-	};
+	}
 
-	//Next, a useful function that we may use, is the Flush function. This function just insert a Signal in the Queue and waits for it.
-	//This is, we insert a Signal in the Queue, and when the GPU reaches that point, it will trigger an event for us, so we know that the GPU finished everything.
-	//This is useful when we want to do something with the resources that are being in use by the GPU. For example, when we want to resize the screen, we need to
-	//resize all the buffers of the swap chain, but the GPU could be using those buffers. So we can Flush the GPU, thus knowing when the GPU finished to use everything
-	//and now that we know, we can proceed to resize our buffers since there's no buffer being referenced anymore. 
-	//After flushing and doing what we want, we can proceed to the default behavior of our pipeline.
-	auto FlushCommandQueue = [SignalFence, WaitForFenceValue](ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, uint64_t& currentFence, HANDLE fenceEvent)
-	{
-		uint64_t fenceValueToWait = SignalFence(commandQueue, fence, currentFence);
-		WaitForFenceValue(fence, fenceValueToWait, fenceEvent);
-	};
+	//The main thread also runs jobs while it waits for them, so we can have as many lists as threads.
+	g_JobSystem = new HT::JobSystem();
+	g_ParallelRecorder = new HT::D3D12ParallelRecorder(g_DirectCommandPool, g_JobSystem->GetThreadCount());
+
+	g_ShaderDiskCache = new HT::ShaderDiskCache(g_ShaderCacheDirectory);
+	g_ShaderService = new HT::ShaderCompilationService(&g_ShaderCompiler, &g_ShaderSources, g_ShaderDiskCache, g_JobSystem);
 
+	g_PipelineBackend = new HT::D3D12PipelineBackend(g_Device);
+	g_PipelineCache = new HT::PipelineCache(g_PipelineBackend, g_JobSystem);
+	g_PipelineCache->LoadLibrary(g_PipelineLibraryPath);
+	
 	 //Let's implement Update and Render functions
 	
 
-	//The update function will be super simple, it will just display the FPS on the VS debug output 
+	//The update function will be super simple, it will just display the frame statistics on the VS debug output 
 
-	//Every time this function is called, we sum the frameCounter and the deltaTime to the elapsedSeconds
-	//Eventually, this elapsedSeconds will reach 1 second. Then, we just need to divide the frameCounter to the elapsedSeconds
-	//and we have all the frames we got in one second.
+	//The frame timings are recorded by g_FrameStats inside Render, here we just print a summary of them once a second.
+	//We print the percentiles and not only the FPS, because a single frame of 100ms among many frames of 1ms will still give us a good FPS
+	//but the user will notice it.
 	static auto Update = []()
 	{
-		static uint64_t frameCounter = 0;
+		HT_PROFILE_SCOPE("Update");
+
 		static double elapsedSeconds = 0.0f;
-		static std::chrono::high_resolution_clock clock;
-		static auto timeStart = clock.now();
+		static auto timeStart = HTUtils::HTNowNanoseconds();
 		
-		frameCounter++;
-		auto timeEnd = clock.now();
-		std::chrono::nanoseconds deltaTime = timeEnd - timeStart;
+		auto timeEnd = HTUtils::HTNowNanoseconds();
+		uint64_t deltaTime = timeEnd - timeStart;
 		timeStart = timeEnd;
 
-		elapsedSeconds += deltaTime.count() * 1e-9;
+		elapsedSeconds += deltaTime * 1e-9;
 
 		if (elapsedSeconds > 1.0f)
 		{
-			char buffer[500];
-			double fps = frameCounter / elapsedSeconds;
-			sprintf_s(buffer, 500, "FPS: %f\n", fps);
+			HT::FramePhaseSummary frame = g_FrameStats.Summarize(HT::FramePhase::Frame);
+			HT::FramePhaseSummary fenceWait = g_FrameStats.Summarize(HT::FramePhase::FenceWait);
+			HT::FramePhaseSummary inputToPresent = g_FrameStats.Summarize(HT::FramePhase::InputToPresent);
+
+			char buffer[600];
+			double fps = frame.AverageMs > 0.0 ? 1000.0 / frame.AverageMs : 0.0;
+			HT::CommandPoolStats directPool = g_DirectCommandPool->GetStats();
+			HT::ResidencyStats residency = g_ResidencyManager->GetStats();
+			const HT::MemoryBudget& localMemory = residency.Budget[(uint32_t)HT::MemorySegment::Local];
+			sprintf_s(buffer, 600, "FPS: %f | Frame p50: %.3fms p95: %.3fms p99: %.3fms max: %.3fms | GPU: %.3fms (%u frames late) | Fence wait p99: %.3fms | Input to present p50: %.3fms p99: %.3fms (%s, latency %u) | Allocators: %u (peak in use %u) | VRAM %lluMB of %lluMB, %u heaps evicted\n", 
+				fps, frame.P50Ms, frame.P95Ms, frame.P99Ms, frame.MaxMs, g_GPUFrameMs, g_GPUFrameLatency, fenceWait.P99Ms, inputToPresent.P50Ms, inputToPresent.P99Ms, 
+				g_WaitableLatencyMode ? "waitable" : "present blocking", g_SwapChainFrameLatency, directPool.AllocatorCount, directPool.PeakAllocatorsInUse,
+				localMemory.CurrentUsage >> 20, localMemory.Budget >> 20, residency.EvictedHeapCount);
 			OutputDebugString(buffer);
 
-			frameCounter = 0;
 			elapsedSeconds = 0.0f;
 		}
 
@@ -592,51 +909,197 @@ int main()
 	
 	//For simplicity, I will define the Render function below the main function
 
-	static auto Render = [&SignalFence, &WaitForFenceValue]()
+	static auto Render = []()
 	{
-		ID3D12CommandAllocator* commandAllocator = g_CommandAllocators[g_CurrentBackBufferIndex];
+		HT_PROFILE_SCOPE("Render");
+
+		g_FrameStats.BeginFrame(HTUtils::HTNowNanoseconds());
+		g_CaptureQueueBackend->BeginFrame();
+
+		//Measured by the render thread before it sampled the input of this frame
+		g_FrameStats.AddPhaseDuration(HT::FramePhase::LatencyWait, g_LatencyWaitNs);
+
+		//Check if the next frame slot is suitable to use or if we must wait for it to be executed first.
+		//This is the only place where the CPU stalls waiting for the GPU, and the ring tells us for how long.
+		auto& frameSlot = g_FrameRing->BeginFrame();
+		g_FrameStats.AddPhaseDuration(HT::FramePhase::FenceWait, frameSlot.LastStallNs);
+
+		//Now that we waited, give back the upload memory and the descriptor tables of every frame the GPU has finished, and release the objects it was still using
+		uint64_t completedFenceValue = g_FrameFence->GetCompletedValue();
+		g_DeferredRelease->Collect();
+		g_UploadRing->BeginFrame(completedFenceValue);
+		g_DescriptorManager->BeginFrame(completedFenceValue);
+		g_HeapAllocator->BeginFrame(completedFenceValue);
+		g_TextureStreamer->BeginFrame(completedFenceValue);
+		g_ResidencyManager->BeginFrame();
+
+		//The timestamps of the frames the GPU finished. Only the latest one is kept for the FPS line.
+		g_GPUProfiler->BeginFrame();
+		if (uint32_t resolvedFrames = g_GPUProfiler->GetResolvedFrameCount())
+		{
+			const HT::GPUProfilerFrame& gpuFrame = g_GPUProfiler->GetResolvedFrame(resolvedFrames - 1);
+			g_GPUFrameMs = gpuFrame.GetGPUMs();
+			g_GPUFrameLatency = gpuFrame.LatencyFrames;
+		}
+
+		//All of them go to the GPU track of the trace
+		for (uint32_t i = 0; i < g_GPUProfiler->GetResolvedFrameCount(); i++)
+		{
+			for (const HT::GPUProfilerScope& scope : g_GPUProfiler->GetResolvedFrame(i).Scopes)
+				HT_PROFILE_GPU_SCOPE(scope.Name, scope.BeginNs, scope.EndNs);
+		}
+
+		//The constants of the frame live in the upload heap
+		g_ResidencyManager->MarkUsed(g_UploadHeapResidency);
+
 		ID3D12Resource* backBuffer = g_BackBuffers[g_CurrentBackBufferIndex];
 
-		//Clear all commands (memory) so we can reuse this memory for further commands. PS: We must before assure that we have no commands to be executed
-		//or else it will fail
-		commandAllocator->Reset();
+		g_FrameStats.BeginPhase(HT::FramePhase::Record, HTUtils::HTNowNanoseconds());
 
-		//Open our commandList for recording. When the CommandList is Reset, it will be open again to command recording, so we need to specify which 
-		//commandAllocator we will be using to store them
-		g_CommandList->Reset(commandAllocator, nullptr);
+		//Get an open commandList for recording. Its allocator was already Reset (all commands cleared, so we can reuse its memory) by the pool,
+		//which only does that once the GPU is done with it, or else it would fail.
+		HT::PooledCommandList frameCommandList = g_DirectCommandPool->Acquire();
+		g_CommandList = HT::ToD3D12CommandList(frameCommandList);
 
-		//== Right now, our resource that we are using as a Render Target is on Present State and in order to write to it, we must transition it to Render Target
-		//We can do this using the Transition method of the CD3DX12_RESOURCE_BARRIER helper struct.
-		CD3DX12_RESOURCE_BARRIER PresentToWriteBarrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		
-		//After we created the barrier, we will issue a command to make this transition to run. Everything will run automatically since this barrier already
-		//knows what state to transition what resource
-		g_CommandList->ResourceBarrier(1, &PresentToWriteBarrier);
+		//The shaders can only see the descriptors inside the shader visible heaps bound to the command list. We bind our rings once per frame, 
+		//changing them in the middle of a frame can be expensive on some hardware.
+		ID3D12DescriptorHeap* shaderVisibleHeaps[] = 
+		{
+			HT::ToD3D12Heap(g_DescriptorManager->GetTransientRing(HT::DescriptorHeapType::CBV_SRV_UAV).GetHeap()),
+			HT::ToD3D12Heap(g_DescriptorManager->GetTransientRing(HT::DescriptorHeapType::Sampler).GetHeap())
+		};
+		g_CommandList->SetDescriptorHeaps(_countof(shaderVisibleHeaps), shaderVisibleHeaps);
+
+		//Only while we capture. The heaps are captured by the GPU address of their start.
+		HT::NullCommandList* commandListShadow = g_CaptureShadowLists.Get(g_CommandList, HT::CommandQueueType::Direct);
+		uint64_t resourceHeapGPU = g_DescriptorManager->GetTransientRing(HT::DescriptorHeapType::CBV_SRV_UAV).GetHeap().Start.GPU;
+		uint64_t samplerHeapGPU = g_DescriptorManager->GetTransientRing(HT::DescriptorHeapType::Sampler).GetHeap().Start.GPU;
+
+		if (commandListShadow)
+			commandListShadow->SetDescriptorHeaps(resourceHeapGPU, samplerHeapGPU);
+
+		//Everything the GPU does in the frame, from the first command of g_CommandList to the end of the last chunk
+		g_GPUProfiler->BeginScope(g_CommandList, "Frame");
+
+		//The mips that finished loading are copied at the start of the frame. Nothing draws the textures yet, so all of them are "full screen".
+		//The copies read the streaming upload heap, the upload ranges wait for the value the frame ring signals after the frame.
+		for (HT::TextureHandle texture : g_StreamedTextures)
+			g_TextureStreamer->SetScreenSize(texture, (float)HTUtils::HTMax(g_WindowWidth, g_WindowHeight));
+
+		g_ResidencyManager->MarkUsed(g_StreamingUploadHeapResidency);
+		g_TextureSink->SetCommandList(g_CommandList);
+		g_TextureStreamer->Update();
+
+		//A new command list, so the tracker starts from scratch. We record and submit on this same thread in order, so the tracker
+		//can look at the registry right away to know the state of a resource the first time we use it.
+		g_CommandListStates.Reset(&g_ResourceStates);
+
+		//We don't record the passes inline anymore. Each frame we build a frame graph: the passes declare what they read and write (and in which state)
+		//and the graph orders them, culls the ones nobody needs and asks the tracker for the barriers of each pass.
+		//The back buffer is not created by the graph, so we import it. Its final version is an output, so the pass that writes it is never culled.
+		g_FrameGraph.Reset();
+		HT::FrameGraphHandle backBufferHandle = g_FrameGraph.Import("BackBuffer", HT::ToResourceId(backBuffer), HT::ResourceState::Present);
+
+		g_FrameGraph.AddPass("Clear", 
+			[&backBufferHandle](HT::FrameGraph::PassBuilder& builder)
+			{
+				//== Right now, our resource that we are using as a Render Target is on Present State and in order to write to it, we must transition it to Render Target
+				//We just declare the state we need, the tracker knows the state the resource is in and builds the barrier (Present -> Render Target) for us.
+				backBufferHandle = builder.Write(backBufferHandle, HT::ResourceState::RenderTarget);
+			},
+			[commandListShadow](HT::FrameGraphPassContext& context)
+			{
+				HT::GPUProfileScope scope(g_GPUProfiler, g_CommandList, "Clear");
+
+				//Now that our back buffer is ready to write, we will write the whole resource to an specific color. This is called "Clean".
+				//we will define a clean color as follows
+				float clearColor[] = { 0.5f, 0.0f, 0.0f, 1.0f };
+
+				//We then get the handle of our resource from the RTV range of our back buffers. The range knows where it starts (like the address of the first element of an array)
+				//and the size that we will be using to jump forward (literally like a pointer) 
+				D3D12_CPU_DESCRIPTOR_HANDLE rtv = HT::ToD3D12CPUHandle(g_BackBufferRTVs.At(g_CurrentBackBufferIndex));
 
+				//Submit the write command
+				g_CommandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
 
-		//Now that our back buffer is ready to write, we will write the whole resource to an specific color. This is called "Clean".
-		//we will define a clean color as follows
-		float clearColor[] = { 0.5f, 0.0f, 0.0f, 1.0f };
+				if (commandListShadow)
+					commandListShadow->ClearRenderTarget(rtv.ptr, clearColor);
+			});
 
-		//We then get the handle of our resource from the Descriptor Heap by passing the start of the heap (like the address of the first element of an array)
-		//and then we will pass the index that we want to jump forward and the size that we will be using to jump forward (literally like a pointer) 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(g_RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), g_CurrentBackBufferIndex, g_RTVDescriptorSize);
+		g_FrameGraph.MarkOutput(backBufferHandle);
+		g_FrameGraph.Compile();
 
-		//Submit the write command
-		g_CommandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+		//The batched transitions of each pass are issued right before the pass, all of them in a single ResourceBarrier call.
+		g_FrameGraph.Execute(g_CommandListStates, [commandListShadow](const std::vector<HT::ResourceBarrier>& barriers)
+			{
+				HT::SubmitBarriers(g_CommandList, barriers);
+
+				if (commandListShadow)
+					commandListShadow->ResourceBarriers(barriers.data(), (uint32_t)barriers.size());
+			});
+
+		//The chunks run after g_CommandList, the scope of the draws begins at its end and ends at the end of the last chunk
+		g_GPUProfiler->BeginScope(g_CommandList, "Draws");
+
+		//The draws are recorded in parallel, each chunk on its own list. The lists of the chunks run after g_CommandList, so the back buffer is already a render target.
+		//A list doesn't inherit anything from the previous one (render targets, viewports, heaps...), so every chunk must set its own state.
+		uint32_t chunkCount = g_ParallelRecorder->Record(*g_JobSystem, g_SceneDrawCount, g_MinDrawsPerChunk, 
+			[&shaderVisibleHeaps, resourceHeapGPU, samplerHeapGPU](ID3D12GraphicsCommandList* commandList, uint32_t begin, uint32_t end)
+			{
+				commandList->SetDescriptorHeaps(_countof(shaderVisibleHeaps), shaderVisibleHeaps);
+
+				D3D12_CPU_DESCRIPTOR_HANDLE rtv = HT::ToD3D12CPUHandle(g_BackBufferRTVs.At(g_CurrentBackBufferIndex));
+				commandList->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+
+				if (HT::NullCommandList* shadow = g_CaptureShadowLists.Get(commandList, HT::CommandQueueType::Direct))
+				{
+					shadow->SetDescriptorHeaps(resourceHeapGPU, samplerHeapGPU);
+					shadow->SetRenderTarget(rtv.ptr);
+				}
+
+				//The draws [begin, end) of the scene are recorded here
+			});
 
 		//In order to present our resource to the screen, we must transition again from the Render Target (write) to Present (read)
-		CD3DX12_RESOURCE_BARRIER WriteToPresentBarrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-		g_CommandList->ResourceBarrier(1, &WriteToPresentBarrier);
+		//This must be the last thing the GPU does with the back buffer, so it goes to the end of the last list we submit.
+		ID3D12GraphicsCommandList* lastCommandList = chunkCount ? g_ParallelRecorder->GetLastCommandList() : g_CommandList;
+		g_CommandListStates.Transition(HT::ToResourceId(backBuffer), HT::ResourceState::Present);
+		g_CommandListStates.Close();
+
+		g_GPUProfiler->EndScope(lastCommandList); //Draws
+
+		const std::vector<HT::ResourceBarrier>& presentBarriers = g_CommandListStates.FlushBarriers();
+		HT::SubmitBarriers(lastCommandList, presentBarriers);
+
+		if (HT::NullCommandList* shadow = g_CaptureShadowLists.Get(lastCommandList, HT::CommandQueueType::Direct))
+			shadow->ResourceBarriers(presentBarriers.data(), (uint32_t)presentBarriers.size());
+
+		//The timestamps are resolved at the end of the last list, the readback is read once the fence value of this frame is reached
+		g_GPUProfiler->EndScope(lastCommandList);
+		g_GPUProfiler->ResolveFrame(lastCommandList);
 
 		//We will not be recording commands anymore to this list, so before we can make use of it, we must close it first.
 		Check(g_CommandList->Close());
 
-		//ExecuteCommandLists of our Queue expects a const array of CommandLists, even if we only have one we must create an array of CommandLists
-		ID3D12CommandList* const commandLists[] = { g_CommandList };
+		//ExecuteCommandLists of our Queue expects an array of CommandLists. The first one is g_CommandList, then the chunks in the order of the draws.
+		static std::vector<ID3D12CommandList*> commandLists;
+		commandLists.clear();
+		commandLists.push_back(g_CommandList);
+		g_ParallelRecorder->Close(commandLists);
 
-		//Send the CommandList to be executed by our command queue
-		g_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+		g_FrameStats.EndPhase(HT::FramePhase::Record, HTUtils::HTNowNanoseconds());
+
+		//Everything the lists use must be resident before we submit them. The evictions and the heaps to bring back are done here, in one batch.
+		g_ResidencyManager->Commit();
+
+		//Send all the CommandLists to be executed by our command queue. A single call is cheaper than one call per list.
+		//The frame doesn't depend on the compute or copy queues yet, once it does, their sync points go as dependencies here.
+		g_FrameStats.BeginPhase(HT::FramePhase::Execute, HTUtils::HTNowNanoseconds());
+		g_QueueScheduler->Submit(HT::CommandQueueType::Direct, reinterpret_cast<void* const*>(commandLists.data()), (uint32_t)commandLists.size());
+		g_FrameStats.EndPhase(HT::FramePhase::Execute, HTUtils::HTNowNanoseconds());
+
+		//The next lists will run after this one, so the resources are now in the states this list left them
+		g_CommandListStates.CommitFinalStates(g_ResourceStates);
 
 		//Before presenting, we have to setup some properties and flags before. 
 		//By setting the Sync Interval to True, we are explicit saying that we want to cap our frame using vsync
@@ -646,17 +1109,39 @@ int main()
 		uint32_t presentFlags = g_TearingSupported && !g_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
 
 		//Ask the swap chain to present it's active back buffer (the actual back buffer index)
-		Check(g_SwapChain->Present(syncInterval, presentFlags));
-
-		// We will signal our fence to our current value + 1
-		g_FrameFenceValues[g_CurrentBackBufferIndex] = SignalFence(g_CommandQueue, g_Fence, g_FenceValue);
+		g_FrameStats.BeginPhase(HT::FramePhase::Present, HTUtils::HTNowNanoseconds());
+		{
+			HT_PROFILE_SCOPE("Present");
+			Check(g_SwapChain->Present(syncInterval, presentFlags));
+			g_CaptureQueueBackend->Present(syncInterval, presentFlags);
+		}
+		g_FrameStats.EndPhase(HT::FramePhase::Present, HTUtils::HTNowNanoseconds());
+
+		g_FrameStats.AddPhaseDuration(HT::FramePhase::InputToPresent, HTUtils::HTNowNanoseconds() - g_InputSampleNs);
+
+		// We will signal our fence to our current value + 1 and the frame slot will remember this value.
+		//The upload memory of this frame will be given back once this same value is reached.
+		uint64_t frameFenceValue = g_FrameRing->EndFrame();
+		g_UploadRing->EndFrame(frameFenceValue);
+		g_DescriptorManager->EndFrame(frameFenceValue);
+		g_ResidencyManager->EndFrame(frameFenceValue);
+		g_TextureStreamer->EndFrame(frameFenceValue);
+		g_GPUProfiler->EndFrame(frameFenceValue);
+
+		//The lists were submitted, the pool takes them back now and their allocators once this value is reached
+		g_DirectCommandPool->Release(frameCommandList, frameFenceValue);
+		g_ParallelRecorder->Release(frameFenceValue);
+
+		//The work of the async queues that no one waited for is signaled once per frame, so the CPU can know when it is done.
+		//Nothing is signaled if nothing was submitted.
+		g_QueueScheduler->Signal(HT::CommandQueueType::Compute);
+		g_QueueScheduler->Signal(HT::CommandQueueType::Copy);
 	
 		//Get the next render target
 		g_CurrentBackBufferIndex = g_SwapChain->GetCurrentBackBufferIndex();
 
-		//Check if this new render target is suitable to use or if we must it to be executed first
-		WaitForFenceValue(g_Fence, g_FrameFenceValues[g_CurrentBackBufferIndex], g_FenceEvent);
-
+		g_CaptureQueueBackend->EndFrame();
+		g_FrameStats.EndFrame(HTUtils::HTNowNanoseconds());
 
 		/*
 		* In general, the GPU is doing a lot of stuff and it will not stop the CPU.
@@ -698,8 +1183,10 @@ int main()
 	
 	//We will define functions that are not directly related to rendering below. 
 
-	static auto Resize = [&FlushCommandQueue, &UpdateRenderTargetViews](uint32_t width, uint32_t height)
+	static auto Resize = [&UpdateRenderTargetViews](uint32_t width, uint32_t height)
 	{
+		HT_PROFILE_SCOPE("Resize");
+
 		//Resize is kinda of an expensive operation (you need to recreate the buffers etc...) so it is good to check if we are actually resizing to a different size
 		if (g_WindowWidth != width || g_WindowHeight != height)
 		{
@@ -707,18 +1194,19 @@ int main()
 			g_WindowWidth  = HTUtils::HTMax<uint32_t>(1u, width);
 			g_WindowHeight = HTUtils::HTMax<uint32_t>(1u, height);
 
-			//Since we have to delete our back-buffers/render targets, first we must assure that none of them are being referenced in the GPU
-			FlushCommandQueue(g_CommandQueue, g_Fence, g_FenceValue, g_FenceEvent);
+			//Since we have to delete our back-buffers/render targets, first we must assure that none of them are being referenced in the GPU.
+			//We used to Flush here (a new signal on the direct queue and a wait for it). But only the frames render to the back buffers and the frame ring
+			//already signaled after each one of them, so we just wait for the last frame. We don't signal anything and the compute and copy queues keep running.
+			//This is the one wait we can't defer: ResizeBuffers fails if a back buffer is still referenced, by us or by the GPU, so they can't go to g_DeferredRelease.
+			//They are the only objects that depend on the size. What keeps this wait rare is the window only asking for a resize once the user stops dragging (HT::WindowResizeFilter).
+			g_FrameRing->WaitForIdle();
 
+			//Release all back-buffers
+			//We don't need to touch the fence values of the frame ring, after the wait all of them are already completed.
 			for (uint32_t i = 0; i < g_NumFrames; i++)
 			{
-				//Release all back-buffers
-				g_BackBuffers[i]->Release();
-
-				//Reset all fences to the value of our last fence. So we will all be in the same step when we recreate it.
-				//It is good to reset to the "last" closer value of the fence, because internally on the GPU our fence is with a higher value. 
-				//this way we don't need to wait much to the CPU fence to catch up with the GPU fence
-				g_FrameFenceValues[i] = g_FrameFenceValues[g_CurrentBackBufferIndex];
+				g_ResourceStates.Unregister(HT::ToResourceId(g_BackBuffers[i]));
+				g_BackBuffers[i].Reset();
 			}
 
 			//Resize the buffers using the same descriptors as our older buffers and swap-chain, we are only going to change it's dimensions
@@ -740,6 +1228,8 @@ int main()
 
 	static auto SetFullscreen = [](bool fullscreen)
 	{
+		HT_PROFILE_SCOPE("SetFullscreen");
+
 		//Check if it is a toggle
 		if (g_Fullscreen != fullscreen)
 		{
@@ -797,21 +1287,198 @@ int main()
 		}
 	};
 
+	//Called between frames: the shadow lists are on before the first list of the next frame records, so the capture gets every command of it.
+	//The back buffers are named so the replay can tell them apart.
+	static auto StartCommandCapture = []()
+	{
+		g_CommandCapture = std::make_unique<HT::CommandCaptureWriter>();
+
+		for (uint32_t i = 0; i < g_NumFrames; i++)
+			g_CommandCapture->NameHandle(HT::CaptureHandleKind::Resource, HT::ToResourceId(g_BackBuffers[i]), ("BackBuffer" + std::to_string(i)).c_str());
+
+		g_CaptureShadowLists.SetEnabled(true);
+		g_CaptureQueueBackend->SetWriter(g_CommandCapture.get());
+	};
+
+	static auto StopCommandCapture = []()
+	{
+		g_CaptureQueueBackend->SetWriter(nullptr);
+		g_CaptureShadowLists.SetEnabled(false);
+
+		std::string error;
+		if (!g_CommandCapture->Save(g_CommandCapturePath, error))
+			OutputDebugString(("Couldn't write the command capture: " + error + "\n").c_str());
+
+		g_CommandCapture.reset();
+	};
+
+	//Everything the window thread posted since the last frame, applied by the render thread before it starts a new frame.
+	//Up to g_MaxFramesInFlight frames can still be in flight here, the resize is only safe because Resize waits for them before it touches the back buffers.
+	static auto ApplyFrameCommands = [](const HT::RenderFrameCommands& commands)
+	{
+		if (commands.IsEmpty())
+			return;
+
+		//The fullscreen change resizes the window, its WM_SIZE will come in the next frames
+		if (commands.SetFullscreen)
+			SetFullscreen(commands.Fullscreen);
+
+		if (commands.Resize)
+			Resize(commands.Width, commands.Height);
+
+		if (commands.ToggleVSync)
+			g_VSync = !g_VSync;
+
+		//Low latency: the CPU waits for the previous frame before starting a new one. High throughput: the CPU can queue as many frames as we have in flight
+		if (commands.TogglePacingMode)
+		{
+			bool lowLatency = g_FrameRing->GetPacingMode() == HT::FramePacingMode::LowLatency;
+			g_FrameRing->SetPacingMode(lowLatency ? HT::FramePacingMode::HighThroughput : HT::FramePacingMode::LowLatency);
+		}
+
+		if (commands.FramesInFlight != 0)
+			g_FrameRing->SetFramesInFlight(commands.FramesInFlight);
+
+		//Waitable: wait for room in the present queue before sampling the input. Present blocking: sample the input and let Present block.
+		if (commands.ToggleLatencyMode)
+			g_WaitableLatencyMode = !g_WaitableLatencyMode;
+
+		//The waitable object is a semaphore, it follows the new max latency by itself.
+		if (commands.MaxFrameLatency != 0 && commands.MaxFrameLatency != g_SwapChainFrameLatency)
+		{
+			g_SwapChainFrameLatency = commands.MaxFrameLatency;
+			Check(g_SwapChain->SetMaximumFrameLatency(g_SwapChainFrameLatency));
+		}
+
+		//Dump the frame statistics we have so far
+		if (commands.ExportFrameStats & (uint32_t)HT::FrameStatsFormat::CSV)
+		{
+			std::ofstream csv("frameStats.csv");
+			g_FrameStats.ExportCSV(csv);
+		}
+
+		if (commands.ExportFrameStats & (uint32_t)HT::FrameStatsFormat::JSON)
+		{
+			std::ofstream json("frameStats.json");
+			g_FrameStats.ExportJSON(json);
+		}
+
+		if (commands.ToggleCommandCapture)
+		{
+			if (!g_CommandCapture)
+				StartCommandCapture();
+			else
+				StopCommandCapture();
+		}
+
+#if !defined(D3D12HT_DIST)
+		//F3 during the startup capture ends it, like any other capture
+		if (commands.ToggleCPUTrace)
+		{
+			g_StartupTraceFramesLeft = 0;
+
+			if (HT::CPUProfiler::IsEnabled())
+				HT::CPUProfiler::Get().Stop();
+			else if (!HT::CPUProfiler::Get().Start(g_CPUTracePath))
+				OutputDebugString("Couldn't create the CPU trace file!\n");
+		}
+#endif
+	};
+
+	static auto RenderThreadMain = []()
+	{
+		HT_PROFILE_THREAD("Render Thread");
+
+		while (g_RenderThreadRunning.load(std::memory_order_acquire))
+		{
+			//The object is signaled once per present that left the queue, so we must wait on it every frame, even in the present blocking mode.
+			//Otherwise it keeps the count of all the frames we didn't wait for and stops throttling when we toggle the mode back.
+			//The timeout is so we never hang on it (e.g: the window is minimized and nothing is being presented).
+			uint64_t waitBegin = HTUtils::HTNowNanoseconds();
+
+			if (g_WaitableLatencyMode)
+			{
+				::WaitForSingleObjectEx(g_FrameLatencyWaitable, 1000, TRUE);
+				g_LatencyWaitNs = HTUtils::HTNowNanoseconds() - waitBegin;
+			}
+
+			//Everything the window posted until now is the input of this frame
+			g_InputSampleNs = HTUtils::HTNowNanoseconds();
+			ApplyFrameCommands(g_RenderEvents.Drain());
+
+			if (!g_WaitableLatencyMode)
+			{
+				//Already signaled if Present blocked until the queue had room, this only keeps the count right
+				::WaitForSingleObjectEx(g_FrameLatencyWaitable, 0, TRUE);
+				g_LatencyWaitNs = 0;
+			}
+
+			Update();
+			Render();
+
+#if !defined(D3D12HT_DIST)
+			if (g_StartupTraceFramesLeft > 0 && --g_StartupTraceFramesLeft == 0)
+				HT::CPUProfiler::Get().Stop();
+#endif
+		}
+	};
+
+	//The render thread may be calling the window (SetFullscreen does), and those calls wait for the window thread to handle them.
+	//So we can't just block on join, while we wait we still handle the messages sent to our window.
+	static auto StopRenderThread = []()
+	{
+		if (!g_RenderThread.joinable())
+			return;
+
+		//From now on, the window messages are not posted to the render thread anymore
+		g_IsInitialized = false;
+		g_RenderThreadRunning.store(false, std::memory_order_release);
+
+		HANDLE renderThreadHandle = g_RenderThread.native_handle();
+		while (::MsgWaitForMultipleObjects(1, &renderThreadHandle, FALSE, INFINITE, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1)
+		{
+			MSG message;
+			::PeekMessage(&message, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+		}
+
+		g_RenderThread.join();
+	};
+
+	//Window thread only
+	static HT::WindowResizeFilter resizeFilter(g_RenderEvents);
+
+	static auto GetClientSize = [](uint32_t& outWidth, uint32_t& outHeight)
+	{
+		RECT clientRect = {};
+		::GetClientRect(g_hWnd, &clientRect);
+
+		outWidth = (uint32_t)(clientRect.right - clientRect.left);
+		outHeight = (uint32_t)(clientRect.bottom - clientRect.top);
+	};
+
 	OSMessageHandler = [](HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) -> LRESULT
 	{
+		//WM_CLOSE stops the render thread (which clears g_IsInitialized) before the window is destroyed, so this one can't wait for the check below
+		//or the message loop would never get its WM_QUIT
+		if (message == WM_DESTROY)
+		{
+			::PostQuitMessage(0);
+			return 0;
+		}
+
 		//Check if our graphics pipeline is initialized before trying to resize anything 
 		if (g_IsInitialized)
 		{
 			switch (message)
 			{
-				//WM_PAINT is being called every frame basically, so use this to update and draw stuff on the screen
+				//We used to Update and Render here. Now the render thread draws all the time, so we just let Windows validate the window.
 				case WM_PAINT:
 				{
-					Update();
-					Render();
-				} break;
+					return ::DefWindowProc(hwnd, message, wParam, lParam);
+				}
 
 				//Check if for keys 'V', 'ESC' and ALT + ENTER to toggle vsync, quit the app and toggle fullscreen respectively
+				//Everything but quitting is a render event, applied by the render thread before its next frame.
 				case WM_KEYDOWN: case WM_SYSKEYDOWN:
 				{
 					bool alt = (::GetAsyncKeyState(VK_MENU) & 0x8000) != 0;
@@ -820,7 +1487,35 @@ int main()
 					{
 						case 'V': 
 						{
-							g_VSync = !g_VSync;
+							g_RenderEvents.Post(HT::RenderEvent::MakeToggleVSync());
+						} break;
+
+						case 'L':
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeTogglePacingMode());
+						} break;
+
+						case '1': case '2': case '3': case '4':
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeSetFramesInFlight((uint32_t)(wParam - '0')));
+						} break;
+
+						case 'K':
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeToggleLatencyMode());
+						} break;
+
+						//g_SwapChainFrameLatency belongs to the render thread too, same as the fullscreen below
+						case VK_OEM_4: case VK_OEM_6:
+						{
+							static uint32_t requestedFrameLatency = 1;
+
+							if (wParam == VK_OEM_4)
+								requestedFrameLatency = HTUtils::HTMax(requestedFrameLatency - 1, 1u);
+							else
+								requestedFrameLatency = HTUtils::HTMin(requestedFrameLatency + 1, g_MaxSwapChainFrameLatency);
+
+							g_RenderEvents.Post(HT::RenderEvent::MakeSetMaxFrameLatency(requestedFrameLatency));
 						} break;
 
 						case VK_ESCAPE: 
@@ -828,10 +1523,36 @@ int main()
 							::PostQuitMessage(0);
 						} break;
 
+						//g_Fullscreen belongs to the render thread, the window thread keeps what it asked for last
 						case VK_RETURN:
 						{
+							static bool requestedFullscreen = false;
+
 							if (alt)
-								SetFullscreen(!g_Fullscreen);
+							{
+								requestedFullscreen = !requestedFullscreen;
+								g_RenderEvents.Post(HT::RenderEvent::MakeSetFullscreen(requestedFullscreen));
+							}
+						} break;
+
+						case VK_F1:
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeExportFrameStats(HT::FrameStatsFormat::CSV));
+						} break;
+
+						case VK_F2:
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeExportFrameStats(HT::FrameStatsFormat::JSON));
+						} break;
+
+						case VK_F3:
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeToggleCPUTrace());
+						} break;
+
+						case VK_F4:
+						{
+							g_RenderEvents.Post(HT::RenderEvent::MakeToggleCommandCapture());
 						} break;
 					}
 				} break;
@@ -846,23 +1567,34 @@ int main()
 
 				} break;
 
-				//check the new size of the screen and resize the swapchain to the new size
-				case WM_SIZE:
+				//We don't resize while the user drags the border of the window, only once the drag ends (see HT::WindowResizeFilter)
+				case WM_ENTERSIZEMOVE:
 				{
-					RECT clientRect = {};
-					::GetClientRect(g_hWnd, &clientRect);
+					resizeFilter.BeginSizeMove();
+				} break;
 
-					int width = clientRect.right - clientRect.left;
-					int height = clientRect.bottom - clientRect.top;
+				case WM_EXITSIZEMOVE:
+				{
+					uint32_t width, height;
+					GetClientSize(width, height);
+					resizeFilter.EndSizeMove(width, height);
+				} break;
 
-					Resize(width, height);
+				//check the new size of the screen and resize the swapchain to the new size
+				case WM_SIZE:
+				{
+					uint32_t width, height;
+					GetClientSize(width, height);
+					resizeFilter.OnSize(width, height);
 
 				} break;
 
-				case WM_DESTROY:
+				//The window is destroyed after this message, the render thread must stop presenting to it before
+				case WM_CLOSE:
 				{
-					::PostQuitMessage(0);
-				} break;
+					StopRenderThread();
+					return ::DefWindowProc(hwnd, message, wParam, lParam);
+				}
 
 				default:
 				{
@@ -881,32 +1613,124 @@ int main()
 	//Now we will be using the Message Handler that we defined above to handle our OS messages.
 	(WNDPROC)SetWindowLongPtr(g_hWnd, GWLP_WNDPROC, (LONG_PTR)OSMessageHandler);
 
-	//Everything is initialized.
+	//Everything is initialized. From now on, the window messages are posted to the render thread.
+#if !defined(D3D12HT_DIST)
+	HT::CPUProfiler::Record("Init", initBeginTicks, HTUtils::HTReadTimestampCounter());
+#endif
 	g_IsInitialized = true;
 
+	g_RenderThreadRunning = true;
+	g_RenderThread = std::thread(RenderThreadMain);
+
 	::ShowWindow(g_hWnd, SW_SHOW);
 
 
 	MSG msg = {};
 	//Run the app until we got a WM_QUIT. WM_QUIT messages can be get through the PostQuitMessage(0) method.
-	while (msg.message != WM_QUIT)
+	//GetMessage blocks until there is a message to process (it returns 0 on WM_QUIT), so this thread sleeps instead of burning a core.
+	while (::GetMessage(&msg, NULL, 0, 0) > 0)
 	{
-		//Take a peek to see if is there any message to process. PeekMessage will not block the application if isn't there any messages
-		if (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-		{
-			//Translate some keys messages to character messages
-			::TranslateMessage(&msg);
+		//Translate some keys messages to character messages
+		::TranslateMessage(&msg);
 
-			//send the translated message to the message handler
-			::DispatchMessage(&msg);
-		}
+		//send the translated message to the message handler
+		::DispatchMessage(&msg);
 	}
 
-	//before closing the application, let's wait and flush the app, thus assuring that we will have a clean close.
-	FlushCommandQueue(g_CommandQueue, g_Fence, g_FenceValue, g_FenceEvent);
+	StopRenderThread();
+
+#if !defined(D3D12HT_DIST)
+	//A capture that is still running keeps what it has so far
+	HT::CPUProfiler::Get().Stop();
+#endif
+
+	if (g_CommandCapture)
+		StopCommandCapture();
+
+	//before closing the application, let's wait and flush the app (all the queues), thus assuring that we will have a clean close.
+	g_QueueScheduler->Flush();
+
+	//Keep what the driver compiled for the next run
+	g_PipelineCache->SaveLibrary(g_PipelineLibraryPath);
+
+	//The GPU is idle, so what is still waiting for a fence can go now. The stats tell us if something was never released.
+	g_DeferredRelease->ReleaseAll();
+
+	HT::DeferredReleaseStats releaseStats = g_DeferredRelease->GetStats();
+	D3D_ASSERT(releaseStats.Pending == 0 && releaseStats.Released == releaseStats.Enqueued, "Objects left in the deferred release queue!");
+
+	//Destroy everything in the reverse order of creation. The HT objects release the D3D12 objects they created (pipelines, heaps, allocators...).
+	delete g_PipelineCache;
+	delete g_PipelineBackend;
+	delete g_ShaderService;
+	delete g_ShaderDiskCache;
+	delete g_GPUProfiler;
+	delete g_TimestampBackend;
+	delete g_ParallelRecorder;
+	delete g_JobSystem;
 
-	//close our fence event and we're done!
+	delete g_TextureStreamer;
+	delete g_TextureSink;
+
+	g_ResidencyManager->Unregister(g_StreamingUploadHeapResidency);
+	delete g_StreamingUploadHeap;
+
+	//The GPU is idle, every pending range can go
+	g_HeapAllocator->BeginFrame(g_FrameFence->GetCompletedValue());
+	delete g_HeapAllocator;
+	delete g_HeapBackend;
+
+	g_ResidencyManager->Unregister(g_UploadHeapResidency);
+	delete g_ResidencyManager;
+	delete g_MemoryBudgetSource;
+	delete g_ResidencyBackend;
+
+	delete g_UploadRing;
+	delete g_UploadHeap;
+	delete g_QueueScheduler;
+	delete g_CaptureQueueBackend;
+	delete g_QueueBackend;
+
+	for (AsyncQueue* asyncQueue : { &g_CopyQueue, &g_ComputeQueue })
+	{
+		delete asyncQueue->CommandPool;
+		delete asyncQueue->QueueFence;
+		asyncQueue->Fence.Reset();
+		asyncQueue->Queue.Reset();
+	}
+
+	delete g_DirectCommandPool;
+	delete g_CommandPoolBackend;
+	delete g_DeferredRelease;
+	delete g_FrameRing;
+	delete g_FrameFence;
+	delete g_DescriptorManager;
+	delete g_DescriptorHeapBackend;
+
+	for (uint32_t i = 0; i < g_NumFrames; i++)
+		g_BackBuffers[i].Reset();
+
+	g_SwapChain.Reset();
+	g_Fence.Reset();
+	g_CommandQueue.Reset();
+
+	//close our fence events and we're done!
 	::CloseHandle(g_FenceEvent);
+	::CloseHandle(g_ComputeQueue.FenceEvent);
+	::CloseHandle(g_CopyQueue.FenceEvent);
+	::CloseHandle(g_FrameLatencyWaitable);
+
+	g_Device.Reset();
+	g_Adapter.Reset();
+
+#ifdef _DEBUG
+	//Every D3D12/DXGI object still alive now is a leak, the debug layer prints them (with their names and ref counts) to the VS output.
+	//The factory and the debug interfaces are still alive (they are released when main returns), they are in the list too.
+	HT::ComRef<IDXGIDebug1> dxgiDebug;
+
+	if (SUCCEEDED(DXGIGetDebugInterface1(0, IID_PPV_ARGS(dxgiDebug.ReleaseAndGetAddressOf()))))
+		dxgiDebug->ReportLiveObjects(DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_FLAGS(DXGI_DEBUG_RLO_SUMMARY | DXGI_DEBUG_RLO_IGNORE_INTERNAL));
+#endif
 
 	return 0;
 }
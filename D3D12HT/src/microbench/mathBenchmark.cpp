@@ -0,0 +1,619 @@
+//The entry point of D3D12HTMathBenchmark. Checks every SIMD version of the math kernels (util/mathKernels.h) against the scalar one, on every
+//count up to a few registers (so every tail is covered), in place and not, with random inputs. The SSE versions do the same operations in the
+//same order, so they must give the same bits. The AVX2 versions use FMA, so they must be within a small relative error.
+//The single matrix/quaternion functions of util/vectorMath.h are checked against the kernels and against each other.
+//Then it measures the throughput of every kernel at every level the CPU has. The results are written as JSON to stdout, the exit code is 1 on any failure.
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <util/mathKernels.h>
+#include <util/timer.h>
+#include <util/utils.h>
+#include <util/vectorMath.h>
+
+using namespace HTUtils;
+
+namespace
+{
+	struct MathBenchmarkConfig
+	{
+		//Elements per call in the benchmark. 1024 matrices are 64KB: more than L1, but the inputs and outputs all fit in L2.
+		uint32_t Count = 1024;
+
+		//Calls per kernel and level, the fastest one is kept
+		uint32_t Repetitions = 200;
+
+		//Random inputs of each count checked against the scalar version
+		uint32_t Rounds = 64;
+		uint32_t Seed = 1;
+	};
+
+	//xorshift32, the same sequence on every platform
+	class MathRandom
+	{
+	public:
+		explicit MathRandom(uint32_t seed) : m_State(seed ? seed : 0x9e3779b9u) {}
+
+		inline uint32_t Next()
+		{
+			m_State ^= m_State << 13;
+			m_State ^= m_State >> 17;
+			m_State ^= m_State << 5;
+			return m_State;
+		}
+
+		inline float Float(float begin, float end) { return begin + (end - begin) * (float)(Next() >> 8) * (1.0f / 16777216.0f); }
+
+		HTQuat Rotation()
+		{
+			HTVec3 axis = HTVec3Normalize({ Float(-1.0f, 1.0f), Float(-1.0f, 1.0f), Float(-1.0f, 1.0f) });
+			if (HTVec3Length(axis) == 0.0f)
+				axis = { 0.0f, 1.0f, 0.0f };
+
+			return HTQuatFromAxisAngle(axis, Float(-3.14159265f, 3.14159265f));
+		}
+
+		//Rotation, scale (can be negative, mirrored objects exist) and translation
+		HTMat4 Transform(float minScale = 0.01f)
+		{
+			float scaleX = Float(minScale, 4.0f);
+			return HTMat4FromTRS({ Float(-1000.0f, 1000.0f), Float(-1000.0f, 1000.0f), Float(-1000.0f, 1000.0f) }, Rotation(),
+				{ (Next() & 1) ? scaleX : -scaleX, Float(minScale, 4.0f), Float(minScale, 4.0f) });
+		}
+
+		//Any values, like a projection
+		HTMat4 Matrix()
+		{
+			HTMat4 matrix;
+			for (uint32_t i = 0; i < 16; i++)
+				matrix.m[i / 4][i % 4] = Float(-10.0f, 10.0f);
+			return matrix;
+		}
+
+	private:
+		uint32_t m_State;
+	};
+
+	//The SoA arrays of the kernels, allocated for a count
+	struct TransformArrays
+	{
+		std::vector<float> Data[10];
+
+		explicit TransformArrays(uint32_t count) { for (std::vector<float>& array : Data) array.resize(count); }
+
+		HTTransformSoA Get() const
+		{
+			return { Data[0].data(), Data[1].data(), Data[2].data(), Data[3].data(), Data[4].data(), Data[5].data(), Data[6].data(),
+			         Data[7].data(), Data[8].data(), Data[9].data() };
+		}
+	};
+
+	struct BoxArrays
+	{
+		std::vector<float> Data[6];
+
+		explicit BoxArrays(uint32_t count) { for (std::vector<float>& array : Data) array.resize(count); }
+
+		HTAABBSoA Get() { return { Data[0].data(), Data[1].data(), Data[2].data(), Data[3].data(), Data[4].data(), Data[5].data() }; }
+	};
+
+	void FillTransforms(MathRandom& random, TransformArrays& arrays, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			HTQuat rotation = random.Rotation();
+			arrays.Data[0][i] = random.Float(-1000.0f, 1000.0f);
+			arrays.Data[1][i] = random.Float(-1000.0f, 1000.0f);
+			arrays.Data[2][i] = random.Float(-1000.0f, 1000.0f);
+			arrays.Data[3][i] = rotation.x;
+			arrays.Data[4][i] = rotation.y;
+			arrays.Data[5][i] = rotation.z;
+			arrays.Data[6][i] = rotation.w;
+			arrays.Data[7][i] = random.Float(-4.0f, 4.0f);
+			arrays.Data[8][i] = random.Float(0.01f, 4.0f);
+			arrays.Data[9][i] = random.Float(0.01f, 4.0f);
+		}
+	}
+
+	void FillBoxes(MathRandom& random, BoxArrays& arrays, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				float center = random.Float(-100.0f, 100.0f);
+				float extent = random.Float(0.0f, 50.0f);
+				arrays.Data[axis][i] = center - extent;
+				arrays.Data[axis + 3][i] = center + extent;
+			}
+		}
+	}
+
+	//How far a value is from the scalar one, relative to the size of the values that were summed to get it (a difference in rounding
+	//is relative to them, not to the result, which can be close to 0)
+	struct ErrorTracker
+	{
+		uint64_t Values = 0;
+		uint64_t DifferentBits = 0;
+		double MaxError = 0.0;
+
+		void Add(float value, float expected, float magnitude)
+		{
+			Values++;
+			if (std::memcmp(&value, &expected, sizeof(float)) == 0)
+				return;
+
+			DifferentBits++;
+			double error = std::fabs((double)value - (double)expected) / HTMax((double)magnitude, 1e-30);
+			if (!(error <= MaxError)) //NaN too
+				MaxError = std::isnan(error) ? 1e30 : error;
+		}
+	};
+
+	struct CheckResult
+	{
+		CheckResult(const char* name, HTMathLevel level) : Name(name), Level(level) {}
+
+		std::string Name;
+		HTMathLevel Level;
+		ErrorTracker Errors;
+		bool Passed = true;
+	};
+
+	//SSE must match the scalar bits, AVX2 (FMA) can be off by a few ulps of the terms
+	const double g_MaxFMAError = 1e-5;
+
+	void Finish(CheckResult& result)
+	{
+		if (result.Level == HTMathLevel::SSE)
+			result.Passed = result.Errors.DifferentBits == 0;
+		else
+			result.Passed = result.Errors.MaxError <= g_MaxFMAError;
+	}
+
+	float MatrixMagnitude(const HTMat4& a, const HTMat4& b, uint32_t row, uint32_t column)
+	{
+		float magnitude = 0.0f;
+		for (uint32_t k = 0; k < 4; k++)
+			magnitude += std::fabs(a.m[row][k] * b.m[k][column]);
+		return magnitude;
+	}
+
+	void CompareMatrices(const HTMat4& value, const HTMat4& expected, float magnitude, ErrorTracker& errors)
+	{
+		for (uint32_t i = 0; i < 16; i++)
+			errors.Add(value.m[i / 4][i % 4], expected.m[i / 4][i % 4], magnitude);
+	}
+
+	//Every count from 0 to maxCount, each one Rounds times with new random inputs. In place for half of them, where the kernel has an input of the same type.
+	CheckResult CheckComposeTransforms(HTMathLevel level, const MathBenchmarkConfig& config, uint32_t maxCount)
+	{
+		CheckResult result("composeTransforms", level);
+		MathRandom random(config.Seed);
+
+		TransformArrays transforms(maxCount);
+		std::vector<HTMat4> expected(maxCount), matrices(maxCount);
+
+		for (uint32_t count = 0; count <= maxCount; count++)
+		{
+			for (uint32_t round = 0; round < config.Rounds; round++)
+			{
+				FillTransforms(random, transforms, count);
+				HTComposeTransforms(transforms.Get(), expected.data(), count, HTMathLevel::Scalar);
+				HTComposeTransforms(transforms.Get(), matrices.data(), count, level);
+
+				//The biggest terms are the scale (rotation) and the translation
+				for (uint32_t i = 0; i < count; i++)
+					CompareMatrices(matrices[i], expected[i], 4.0f, result.Errors);
+			}
+		}
+
+		Finish(result);
+		return result;
+	}
+
+	CheckResult CheckMultiplyMatrices(HTMathLevel level, const MathBenchmarkConfig& config, uint32_t maxCount, bool singleB)
+	{
+		CheckResult result(singleB ? "multiplyMatricesByOne" : "multiplyMatrices", level);
+		MathRandom random(config.Seed);
+
+		std::vector<HTMat4> a(maxCount), b(maxCount), expected(maxCount), out(maxCount);
+
+		for (uint32_t count = 0; count <= maxCount; count++)
+		{
+			for (uint32_t round = 0; round < config.Rounds; round++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					a[i] = (round & 2) ? random.Transform() : random.Matrix();
+					b[i] = random.Matrix();
+				}
+
+				bool inPlace = (round & 1) != 0;
+				HTMat4* output = inPlace ? a.data() : out.data();
+				std::vector<HTMat4> inputA(a.begin(), a.begin() + count);
+
+				if (singleB)
+				{
+					HTMultiplyMatrices(a.data(), b[0], expected.data(), count, HTMathLevel::Scalar);
+					HTMultiplyMatrices(a.data(), b[0], output, count, level);
+				}
+				else
+				{
+					HTMultiplyMatrices(a.data(), b.data(), expected.data(), count, HTMathLevel::Scalar);
+					HTMultiplyMatrices(a.data(), b.data(), output, count, level);
+				}
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const HTMat4& rightSide = singleB ? b[0] : b[i];
+					for (uint32_t element = 0; element < 16; element++)
+					{
+						float magnitude = MatrixMagnitude(inputA[i], rightSide, element / 4, element % 4);
+						result.Errors.Add(output[i].m[element / 4][element % 4], expected[i].m[element / 4][element % 4], magnitude);
+					}
+				}
+			}
+		}
+
+		Finish(result);
+		return result;
+	}
+
+	CheckResult CheckTransformPoints(HTMathLevel level, const MathBenchmarkConfig& config, uint32_t maxCount)
+	{
+		CheckResult result("transformPoints", level);
+		MathRandom random(config.Seed);
+
+		std::vector<float> points[3], expected[3], out[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			points[axis].resize(maxCount);
+			expected[axis].resize(maxCount);
+			out[axis].resize(maxCount);
+		}
+
+		for (uint32_t count = 0; count <= maxCount; count++)
+		{
+			for (uint32_t round = 0; round < config.Rounds; round++)
+			{
+				HTMat4 matrix = (round & 2) ? random.Transform() : random.Matrix();
+				for (uint32_t axis = 0; axis < 3; axis++)
+					for (uint32_t i = 0; i < count; i++)
+						points[axis][i] = random.Float(-100.0f, 100.0f);
+
+				std::vector<float> inputs[3] = { points[0], points[1], points[2] };
+				bool inPlace = (round & 1) != 0;
+				std::vector<float>* output = inPlace ? points : out;
+
+				HTTransformPoints(matrix, points[0].data(), points[1].data(), points[2].data(), expected[0].data(), expected[1].data(), expected[2].data(), count, HTMathLevel::Scalar);
+				HTTransformPoints(matrix, points[0].data(), points[1].data(), points[2].data(), output[0].data(), output[1].data(), output[2].data(), count, level);
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						float magnitude = std::fabs(inputs[0][i] * matrix.m[0][axis]) + std::fabs(inputs[1][i] * matrix.m[1][axis]) +
+						                  std::fabs(inputs[2][i] * matrix.m[2][axis]) + std::fabs(matrix.m[3][axis]);
+						result.Errors.Add(output[axis][i], expected[axis][i], magnitude);
+					}
+				}
+			}
+		}
+
+		Finish(result);
+		return result;
+	}
+
+	CheckResult CheckTransformAABBs(HTMathLevel level, const MathBenchmarkConfig& config, uint32_t maxCount)
+	{
+		CheckResult result("transformAABBs", level);
+		MathRandom random(config.Seed);
+
+		BoxArrays boxes(maxCount), expected(maxCount), out(maxCount);
+		std::vector<HTMat4> matrices(maxCount);
+
+		for (uint32_t count = 0; count <= maxCount; count++)
+		{
+			for (uint32_t round = 0; round < config.Rounds; round++)
+			{
+				FillBoxes(random, boxes, count);
+				for (uint32_t i = 0; i < count; i++)
+					matrices[i] = random.Transform();
+
+				bool inPlace = (round & 1) != 0;
+				BoxArrays& output = inPlace ? boxes : out;
+
+				HTTransformAABBs(matrices.data(), boxes.Get(), expected.Get(), count, HTMathLevel::Scalar);
+				HTTransformAABBs(matrices.data(), boxes.Get(), output.Get(), count, level);
+
+				//The translations are up to 1000 and the boxes up to 150 * scale 4
+				for (uint32_t array = 0; array < 6; array++)
+					for (uint32_t i = 0; i < count; i++)
+						result.Errors.Add(output.Data[array][i], expected.Data[array][i], 2000.0f);
+			}
+		}
+
+		Finish(result);
+		return result;
+	}
+
+	//The single functions of vectorMath.h: the same as the kernels, and what they must be by definition
+	CheckResult CheckVectorMath(const MathBenchmarkConfig& config)
+	{
+		CheckResult result("vectorMath", HTMathLevel::Scalar);
+		MathRandom random(config.Seed);
+
+		ErrorTracker exact;
+		double maxError = 0.0;
+		auto Near = [&maxError](float value, float expected, float magnitude)
+		{
+			double error = std::fabs((double)value - (double)expected) / HTMax((double)magnitude, 1e-30);
+			if (!(error <= maxError))
+				maxError = std::isnan(error) ? 1e30 : error;
+		};
+
+		for (uint32_t round = 0; round < config.Rounds * 256; round++)
+		{
+			HTMat4 a = random.Matrix();
+			HTMat4 b = random.Matrix();
+
+			//The kernels and the inline functions do the same operations
+			HTMat4 kernel;
+			HTMultiplyMatrices(&a, &b, &kernel, 1, HTMathLevel::Scalar);
+			CompareMatrices(HTMat4Multiply(a, b), kernel, 1.0f, exact);
+
+			HTVec3 point = { random.Float(-100.0f, 100.0f), random.Float(-100.0f, 100.0f), random.Float(-100.0f, 100.0f) };
+			HTVec3 kernelPoint;
+			HTTransformPoints(a, &point.x, &point.y, &point.z, &kernelPoint.x, &kernelPoint.y, &kernelPoint.z, 1, HTMathLevel::Scalar);
+			HTVec3 transformed = HTMat4TransformPoint(point, a);
+			exact.Add(transformed.x, kernelPoint.x, 1.0f);
+			exact.Add(transformed.y, kernelPoint.y, 1.0f);
+			exact.Add(transformed.z, kernelPoint.z, 1.0f);
+
+			HTMat4 transposed = HTMat4Transpose(HTMat4Transpose(a));
+			CompareMatrices(transposed, a, 1.0f, exact);
+
+			//A quaternion rotates like its matrix, and the product of two quaternions like the product of their matrices
+			HTQuat q0 = random.Rotation();
+			HTQuat q1 = random.Rotation();
+			HTVec3 direction = HTVec3Normalize(point);
+			HTVec3 byQuat = HTQuatRotate(direction, q0);
+			HTVec3 byMatrix = HTMat4TransformVector(direction, HTMat4FromQuat(q0));
+			Near(byQuat.x, byMatrix.x, 1.0f); Near(byQuat.y, byMatrix.y, 1.0f); Near(byQuat.z, byMatrix.z, 1.0f);
+
+			HTMat4 product = HTMat4FromQuat(HTQuatNormalize(HTQuatMultiply(q0, q1)));
+			HTMat4 matrixProduct = HTMat4Multiply(HTMat4FromQuat(q0), HTMat4FromQuat(q1));
+			for (uint32_t i = 0; i < 16; i++)
+				Near(product.m[i / 4][i % 4], matrixProduct.m[i / 4][i % 4], 1.0f);
+
+			//The inverse of a transform takes the transformed point back. Not with tiny scales, the error grows with 1 / scale.
+			HTMat4 transform = random.Transform(0.25f);
+			HTVec3 back = HTMat4TransformPoint(HTMat4TransformPoint(point, transform), HTMat4InverseAffine(transform));
+			Near(back.x, point.x, 1000.0f); Near(back.y, point.y, 1000.0f); Near(back.z, point.z, 1000.0f);
+		}
+
+		//The camera: the target is in front (+z) and in the center of the screen, at a depth between 0 and 1
+		HTMat4 view = HTMat4LookAtLH({ 1.0f, 2.0f, -5.0f }, { 3.0f, 1.0f, 4.0f }, { 0.0f, 1.0f, 0.0f });
+		HTMat4 projection = HTMat4PerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+		HTVec4 clip = HTMat4Transform({ 3.0f, 1.0f, 4.0f, 1.0f }, HTMat4Multiply(view, projection));
+		Near(clip.x / clip.w, 0.0f, 1.0f);
+		Near(clip.y / clip.w, 0.0f, 1.0f);
+		bool depthInRange = clip.w > 0.0f && clip.z / clip.w > 0.0f && clip.z / clip.w < 1.0f;
+
+		result.Errors = exact;
+		result.Errors.MaxError = HTMax(result.Errors.MaxError, maxError);
+		result.Passed = exact.DifferentBits == 0 && maxError <= 1e-4 && depthInRange;
+		return result;
+	}
+
+	struct KernelTiming
+	{
+		std::string Name;
+		HTMathLevel Level;
+		uint64_t BestNs;
+		uint32_t Elements;
+	};
+
+	template<typename Func>
+	uint64_t BestTime(uint32_t repetitions, Func&& func)
+	{
+		uint64_t best = ~0ull;
+		for (uint32_t repetition = 0; repetition < repetitions; repetition++)
+		{
+			uint64_t begin = HTNowNanoseconds();
+			func();
+			best = HTMin(best, HTNowNanoseconds() - begin);
+		}
+		return best;
+	}
+
+	void BenchmarkKernels(const MathBenchmarkConfig& config, std::vector<KernelTiming>& outTimings)
+	{
+		MathRandom random(config.Seed);
+		uint32_t count = config.Count;
+
+		TransformArrays transforms(count);
+		FillTransforms(random, transforms, count);
+
+		std::vector<HTMat4> a(count), b(count), out(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			a[i] = random.Transform();
+			b[i] = random.Matrix();
+		}
+
+		std::vector<float> points[3], outPoints[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			points[axis].resize(count);
+			outPoints[axis].resize(count);
+			for (uint32_t i = 0; i < count; i++)
+				points[axis][i] = random.Float(-100.0f, 100.0f);
+		}
+
+		BoxArrays boxes(count), outBoxes(count);
+		FillBoxes(random, boxes, count);
+
+		for (uint32_t levelIndex = 0; levelIndex < (uint32_t)HTMathLevel::Count; levelIndex++)
+		{
+			HTMathLevel level = (HTMathLevel)levelIndex;
+			if (!HTIsMathLevelSupported(level))
+				continue;
+
+			outTimings.push_back({ "composeTransforms", level, BestTime(config.Repetitions, [&]() { HTComposeTransforms(transforms.Get(), out.data(), count, level); }), count });
+			outTimings.push_back({ "multiplyMatrices", level, BestTime(config.Repetitions, [&]() { HTMultiplyMatrices(a.data(), b.data(), out.data(), count, level); }), count });
+			outTimings.push_back({ "multiplyMatricesByOne", level, BestTime(config.Repetitions, [&]() { HTMultiplyMatrices(a.data(), b[0], out.data(), count, level); }), count });
+			outTimings.push_back({ "transformPoints", level, BestTime(config.Repetitions, [&]()
+				{
+					HTTransformPoints(b[0], points[0].data(), points[1].data(), points[2].data(), outPoints[0].data(), outPoints[1].data(), outPoints[2].data(), count, level);
+				}), count });
+			outTimings.push_back({ "transformAABBs", level, BestTime(config.Repetitions, [&]() { HTTransformAABBs(a.data(), boxes.Get(), outBoxes.Get(), count, level); }), count });
+		}
+	}
+
+	bool ParseMathBenchmarkArguments(int argc, char** argv, MathBenchmarkConfig& config, std::string& outError)
+	{
+		struct NumberOption
+		{
+			const char* Name;
+			uint32_t* Value;
+			uint32_t Min;
+		};
+
+		const NumberOption numberOptions[] =
+		{
+			{ "--count",  &config.Count,       1 },
+			{ "--reps",   &config.Repetitions, 1 },
+			{ "--rounds", &config.Rounds,      1 },
+			{ "--seed",   &config.Seed,        0 },
+		};
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+			bool found = false;
+
+			for (const NumberOption& option : numberOptions)
+			{
+				if (argument != option.Name)
+					continue;
+
+				if (i + 1 >= argc)
+				{
+					outError = argument + " needs a value";
+					return false;
+				}
+
+				char* end = nullptr;
+				unsigned long value = std::strtoul(argv[++i], &end, 10);
+				if (*end != '\0' || value < option.Min)
+				{
+					outError = "Invalid value for " + argument;
+					return false;
+				}
+
+				*option.Value = (uint32_t)value;
+				found = true;
+				break;
+			}
+
+			if (!found)
+			{
+				outError = "Unknown argument " + argument;
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	MathBenchmarkConfig config;
+	std::string error;
+
+	if (!ParseMathBenchmarkArguments(argc, argv, config, error))
+	{
+		std::cerr << error << "\n";
+		std::cerr << "Usage: D3D12HTMathBenchmark [--count N] [--reps N] [--rounds N] [--seed N]\n";
+		return 1;
+	}
+
+	//Up to 4 AVX2 registers, so every tail length of every level is checked, many times
+	const uint32_t maxCheckCount = 33;
+
+	std::vector<CheckResult> checks;
+	checks.push_back(CheckVectorMath(config));
+
+	for (uint32_t levelIndex = (uint32_t)HTMathLevel::SSE; levelIndex < (uint32_t)HTMathLevel::Count; levelIndex++)
+	{
+		HTMathLevel level = (HTMathLevel)levelIndex;
+		if (!HTIsMathLevelSupported(level))
+			continue;
+
+		checks.push_back(CheckComposeTransforms(level, config, maxCheckCount));
+		checks.push_back(CheckMultiplyMatrices(level, config, maxCheckCount, false));
+		checks.push_back(CheckMultiplyMatrices(level, config, maxCheckCount, true));
+		checks.push_back(CheckTransformPoints(level, config, maxCheckCount));
+		checks.push_back(CheckTransformAABBs(level, config, maxCheckCount));
+	}
+
+	std::vector<KernelTiming> timings;
+	BenchmarkKernels(config, timings);
+
+	bool passed = true;
+
+	std::ostream& stream = std::cout;
+	stream << "{\n";
+	stream << "\t\"config\": { \"count\": " << config.Count << ", \"reps\": " << config.Repetitions << ", \"rounds\": " << config.Rounds << ", \"seed\": " << config.Seed << " },\n";
+	stream << "\t\"bestLevel\": \"" << HTMathLevelName(HTGetMathLevel()) << "\",\n";
+
+	stream << "\t\"checks\": [\n";
+	for (size_t i = 0; i < checks.size(); i++)
+	{
+		const CheckResult& check = checks[i];
+		passed = passed && check.Passed;
+
+		stream << "\t\t{ \"kernel\": \"" << check.Name << "\", \"level\": \"" << HTMathLevelName(check.Level) << "\", ";
+		stream << "\"values\": " << check.Errors.Values << ", \"differentBits\": " << check.Errors.DifferentBits << ", ";
+		stream << "\"maxRelativeError\": " << check.Errors.MaxError << ", \"passed\": " << (check.Passed ? "true" : "false") << " }";
+		stream << (i + 1 < checks.size() ? ",\n" : "\n");
+	}
+	stream << "\t],\n";
+
+	stream << "\t\"benchmark\": [\n";
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		const KernelTiming& timing = timings[i];
+
+		//The scalar timing of the same kernel is always the first one
+		uint64_t scalarNs = timing.BestNs;
+		for (const KernelTiming& other : timings)
+		{
+			if (other.Name == timing.Name && other.Level == HTMathLevel::Scalar)
+			{
+				scalarNs = other.BestNs;
+				break;
+			}
+		}
+
+		double nsPerElement = (double)timing.BestNs / (double)timing.Elements;
+		double speedup = timing.BestNs > 0 ? (double)scalarNs / (double)timing.BestNs : 0.0;
+
+		stream << "\t\t{ \"kernel\": \"" << timing.Name << "\", \"level\": \"" << HTMathLevelName(timing.Level) << "\", ";
+		stream << "\"elements\": " << timing.Elements << ", \"nsPerElement\": " << nsPerElement << ", ";
+		stream << "\"millionsPerSecond\": " << (nsPerElement > 0.0 ? 1000.0 / nsPerElement : 0.0) << ", \"speedup\": " << speedup << " }";
+		stream << (i + 1 < timings.size() ? ",\n" : "\n");
+	}
+	stream << "\t],\n";
+	stream << "\t\"passed\": " << (passed ? "true" : "false") << "\n";
+	stream << "}\n";
+
+	return passed ? 0 : 1;
+}
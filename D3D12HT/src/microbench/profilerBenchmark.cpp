@@ -0,0 +1,294 @@
+//The entry point of D3D12HTProfilerBenchmark. Measures what a scope of the CPU profiler (core/cpuProfiler.h) costs: with no capture running,
+//and with a capture on one thread and on several threads at once. The scopes are recorded in batches smaller than a ring, and the next batch
+//only starts once the flusher wrote the last one, so what is timed is recording an event, not waiting for the file or dropping it.
+//The trace is then read back, it must have every event that was recorded. The results are written as JSON to stdout, the exit code is 1 on any failure.
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <core/cpuProfiler.h>
+#include <util/fileUtils.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+using namespace HT;
+using namespace HTUtils;
+
+namespace
+{
+	struct ProfilerBenchmarkConfig
+	{
+		//Scopes per batch, half a ring
+		uint32_t Events = CPUProfiler::s_ThreadCapacity / 2;
+		uint32_t Batches = 64;
+		uint32_t Threads = 4;
+
+		std::string TracePath = "profilerBenchmark.json";
+	};
+
+	struct ScopeTiming
+	{
+		const char* Name;
+		uint32_t Threads;
+		uint64_t Events;
+		double NsPerEvent;     //All the batches
+		double BestNsPerEvent; //The fastest batch
+	};
+
+	//Per thread, the threads would be writing the same cache line
+	thread_local volatile uint32_t s_Sink = 0;
+
+	uint64_t RecordBatch(uint32_t events, const char* name)
+	{
+		uint64_t begin = HTNowNanoseconds();
+
+		for (uint32_t i = 0; i < events; i++)
+		{
+			CPUProfileScope scope(name);
+			s_Sink = s_Sink + 1;
+		}
+
+		return HTNowNanoseconds() - begin;
+	}
+
+	template<typename TFunction>
+	double NsPerCall(uint32_t calls, const TFunction& function)
+	{
+		uint64_t begin = HTNowNanoseconds();
+
+		for (uint32_t i = 0; i < calls; i++)
+			function();
+
+		return (double)(HTNowNanoseconds() - begin) / (double)calls;
+	}
+
+	void WaitForFlusher(uint64_t events)
+	{
+		for (;;)
+		{
+			CPUProfilerStats stats = CPUProfiler::Get().GetStats();
+			if (stats.EventsWritten + stats.EventsDropped >= events)
+				return;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	ScopeTiming TimeOneThread(const ProfilerBenchmarkConfig& config, const char* name, uint64_t& inOutRecorded)
+	{
+		ScopeTiming timing = { name, 1, 0, 0.0, 1e30 };
+		uint64_t totalNs = 0;
+
+		for (uint32_t batch = 0; batch < config.Batches; batch++)
+		{
+			uint64_t ns = RecordBatch(config.Events, name);
+			totalNs += ns;
+			timing.Events += config.Events;
+			timing.BestNsPerEvent = HTMin(timing.BestNsPerEvent, (double)ns / (double)config.Events);
+
+			if (CPUProfiler::IsEnabled())
+			{
+				inOutRecorded += config.Events;
+				WaitForFlusher(inOutRecorded);
+			}
+		}
+
+		timing.NsPerEvent = (double)totalNs / (double)timing.Events;
+		return timing;
+	}
+
+	//Every thread records a batch, then they all wait for the flusher
+	ScopeTiming TimeThreads(const ProfilerBenchmarkConfig& config, uint64_t& inOutRecorded)
+	{
+		ScopeTiming timing = { "threads", config.Threads, 0, 0.0, 1e30 };
+
+		std::atomic<uint32_t> round = 0;
+		std::atomic<uint32_t> done = 0;
+		std::atomic<uint64_t> totalNs = 0;
+		std::vector<uint64_t> batchNs(config.Threads, 0);
+
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < config.Threads; t++)
+		{
+			threads.emplace_back([&, t]()
+			{
+				for (uint32_t batch = 0; batch < config.Batches; batch++)
+				{
+					while (round.load(std::memory_order_acquire) <= batch)
+						std::this_thread::yield();
+
+					batchNs[t] = RecordBatch(config.Events, "threads");
+					done.fetch_add(1, std::memory_order_release);
+				}
+			});
+		}
+
+		for (uint32_t batch = 0; batch < config.Batches; batch++)
+		{
+			done.store(0, std::memory_order_relaxed);
+			round.store(batch + 1, std::memory_order_release);
+
+			while (done.load(std::memory_order_acquire) < config.Threads)
+				std::this_thread::yield();
+
+			for (uint32_t t = 0; t < config.Threads; t++)
+			{
+				totalNs += batchNs[t];
+				timing.BestNsPerEvent = HTMin(timing.BestNsPerEvent, (double)batchNs[t] / (double)config.Events);
+			}
+
+			timing.Events += (uint64_t)config.Events * config.Threads;
+			inOutRecorded += (uint64_t)config.Events * config.Threads;
+			WaitForFlusher(inOutRecorded);
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		timing.NsPerEvent = (double)totalNs.load() / (double)timing.Events;
+		return timing;
+	}
+
+	uint64_t CountCompleteEvents(const std::string& path)
+	{
+		std::vector<uint8_t> data;
+		if (!HTReadFile(path, data))
+			return 0;
+
+		const std::string pattern = "\"ph\":\"X\"";
+		std::string text(data.begin(), data.end());
+
+		uint64_t count = 0;
+		for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + pattern.size()))
+			count++;
+
+		return count;
+	}
+
+	bool ParseProfilerBenchmarkArguments(int argc, char** argv, ProfilerBenchmarkConfig& config, std::string& outError)
+	{
+		struct NumberOption
+		{
+			const char* Name;
+			uint32_t* Value;
+			uint32_t Min;
+			uint32_t Max;
+		};
+
+		const NumberOption numberOptions[] =
+		{
+			{ "--events",  &config.Events,  1, CPUProfiler::s_ThreadCapacity },
+			{ "--batches", &config.Batches, 1, ~0u },
+			{ "--threads", &config.Threads, 1, 256 },
+		};
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+			bool found = false;
+
+			if (i + 1 >= argc)
+			{
+				outError = argument + " needs a value";
+				return false;
+			}
+
+			if (argument == "--trace")
+			{
+				config.TracePath = argv[++i];
+				continue;
+			}
+
+			for (const NumberOption& option : numberOptions)
+			{
+				if (argument != option.Name)
+					continue;
+
+				char* end = nullptr;
+				unsigned long value = std::strtoul(argv[++i], &end, 10);
+				if (*end != '\0' || value < option.Min || value > option.Max)
+				{
+					outError = "Invalid value for " + argument;
+					return false;
+				}
+
+				*option.Value = (uint32_t)value;
+				found = true;
+				break;
+			}
+
+			if (!found)
+			{
+				outError = "Unknown argument " + argument;
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProfilerBenchmarkConfig config;
+	std::string error;
+
+	if (!ParseProfilerBenchmarkArguments(argc, argv, config, error))
+	{
+		std::cerr << error << "\n";
+		std::cerr << "Usage: D3D12HTProfilerBenchmark [--events N] [--batches N] [--threads N] [--trace path]\n";
+		return 1;
+	}
+
+	const uint32_t clockCalls = 1000000;
+	double counterNs = NsPerCall(clockCalls, []() { s_Sink = s_Sink + (uint32_t)HTReadTimestampCounter(); });
+	double steadyClockNs = NsPerCall(clockCalls, []() { s_Sink = s_Sink + (uint32_t)HTNowNanoseconds(); });
+
+	std::vector<ScopeTiming> timings;
+	uint64_t recorded = 0;
+
+	timings.push_back(TimeOneThread(config, "disabled", recorded));
+
+	if (!CPUProfiler::Get().Start(config.TracePath))
+	{
+		std::cerr << "Can't write the trace to " << config.TracePath << "\n";
+		return 1;
+	}
+
+	timings.push_back(TimeOneThread(config, "enabled", recorded));
+	timings.push_back(TimeThreads(config, recorded));
+
+	CPUProfilerStats stats = CPUProfiler::Get().GetStats();
+	CPUProfiler::Get().Stop();
+
+	//A batch never fills a ring, so nothing can be dropped
+	uint64_t traceEvents = CountCompleteEvents(config.TracePath);
+	bool passed = stats.EventsDropped == 0 && stats.EventsWritten == recorded && traceEvents == recorded;
+
+	std::ostream& stream = std::cout;
+	stream << "{\n";
+	stream << "\t\"config\": { \"events\": " << config.Events << ", \"batches\": " << config.Batches << ", \"threads\": " << config.Threads << ", \"trace\": \"" << config.TracePath << "\" },\n";
+	stream << "\t\"clock\": { \"timestampCounterNs\": " << counterNs << ", \"steadyClockNs\": " << steadyClockNs << " },\n";
+
+	stream << "\t\"scopes\": [\n";
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		const ScopeTiming& timing = timings[i];
+
+		stream << "\t\t{ \"name\": \"" << timing.Name << "\", \"threads\": " << timing.Threads << ", \"events\": " << timing.Events << ", ";
+		stream << "\"nsPerEvent\": " << timing.NsPerEvent << ", \"bestNsPerEvent\": " << timing.BestNsPerEvent << " }";
+		stream << (i + 1 < timings.size() ? ",\n" : "\n");
+	}
+	stream << "\t],\n";
+
+	stream << "\t\"capture\": { \"recorded\": " << recorded << ", \"written\": " << stats.EventsWritten << ", \"dropped\": " << stats.EventsDropped << ", ";
+	stream << "\"inTrace\": " << traceEvents << ", \"flushes\": " << stats.Flushes << ", \"threads\": " << stats.Threads << " },\n";
+	stream << "\t\"passed\": " << (passed ? "true" : "false") << "\n";
+	stream << "}\n";
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+namespace HT
+{
+	//Owns a reference of a ref counted object (anything with AddRef/Release, like every D3D12 and DXGI object).
+	//It is the same idea as Microsoft::WRL::ComPtr, but it doesn't need any Windows header, so the code that owns objects (and the deferred release queue)
+	//can be built and tested on Linux with fake objects. It also converts to T* on its own, so passing it to functions that want a raw pointer just works.
+	//
+	//The constructor from T* takes the reference we already have (this is what Create* and QueryInterface give us), it doesn't AddRef.
+	template<typename T>
+	class ComRef
+	{
+	public:
+		ComRef() = default;
+		explicit ComRef(T* object) : m_Object(object) {}
+
+		ComRef(const ComRef& other) : m_Object(other.m_Object)
+		{
+			if (m_Object)
+				m_Object->AddRef();
+		}
+
+		ComRef(ComRef&& other) noexcept : m_Object(other.m_Object)
+		{
+			other.m_Object = nullptr;
+		}
+
+		~ComRef() { Reset(); }
+
+		ComRef& operator=(const ComRef& other)
+		{
+			//Other may be us, so we take its object before the Reset
+			T* object = other.m_Object;
+			if (object)
+				object->AddRef();
+
+			Reset();
+			m_Object = object;
+			return *this;
+		}
+
+		ComRef& operator=(ComRef&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				m_Object = other.m_Object;
+				other.m_Object = nullptr;
+			}
+
+			return *this;
+		}
+
+		//Releases our reference (if any)
+		void Reset()
+		{
+			if (m_Object)
+			{
+				T* object = m_Object;
+				m_Object = nullptr;
+				object->Release();
+			}
+		}
+
+		//Takes a reference we already have
+		void Attach(T* object)
+		{
+			Reset();
+			m_Object = object;
+		}
+
+		//Gives our reference to the caller, who is now the one that must release it (e.g: the deferred release queue)
+		T* Detach()
+		{
+			T* object = m_Object;
+			m_Object = nullptr;
+			return object;
+		}
+
+		//For the functions that create objects (IID_PPV_ARGS(ref.ReleaseAndGetAddressOf())). Whatever we had is released first.
+		T** ReleaseAndGetAddressOf()
+		{
+			Reset();
+			return &m_Object;
+		}
+
+		inline T* Get() const { return m_Object; }
+		inline T* operator->() const { return m_Object; }
+		inline operator T*() const { return m_Object; }
+
+	private:
+		T* m_Object = nullptr;
+	};
+}
@@ -0,0 +1,1134 @@
+#include "commandCapture.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include <util/fileUtils.h>
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	static_assert(sizeof(CaptureFileHeader) == 88, "The header of a capture changed size, bump g_CaptureVersion!");
+	static_assert(sizeof(CapturePacketHeader) == 8, "The header of a packet changed size, bump g_CaptureVersion!");
+	static_assert(sizeof(CaptureHandle) == 24, "A handle changed size, bump g_CaptureVersion!");
+
+	const char* CapturePacketTypeName(CapturePacketType type)
+	{
+		switch (type)
+		{
+		case CapturePacketType::BeginFrame:  return "BeginFrame";
+		case CapturePacketType::EndFrame:    return "EndFrame";
+		case CapturePacketType::CommandList: return "CommandList";
+		case CapturePacketType::Execute:     return "Execute";
+		case CapturePacketType::Signal:      return "Signal";
+		case CapturePacketType::Wait:        return "Wait";
+		case CapturePacketType::WaitOnCPU:   return "WaitOnCPU";
+		case CapturePacketType::Present:     return "Present";
+		default:                             return "Unknown";
+		}
+	}
+
+	const char* CaptureHandleKindName(CaptureHandleKind kind)
+	{
+		switch (kind)
+		{
+		case CaptureHandleKind::RootSignature:    return "RootSignature";
+		case CaptureHandleKind::Pipeline:         return "Pipeline";
+		case CaptureHandleKind::DescriptorHeap:   return "DescriptorHeap";
+		case CaptureHandleKind::RenderTargetView: return "RenderTargetView";
+		case CaptureHandleKind::Resource:         return "Resource";
+		case CaptureHandleKind::QueryHeap:        return "QueryHeap";
+		case CaptureHandleKind::QueryDestination: return "QueryDestination";
+		default:                                  return "Unknown";
+		}
+	}
+
+	namespace
+	{
+		//Small negative differences are small numbers too
+		inline uint64_t ZigzagEncode(uint64_t value, uint64_t previous)
+		{
+			int64_t difference = (int64_t)(value - previous);
+			return ((uint64_t)difference << 1) ^ (uint64_t)(difference >> 63);
+		}
+
+		inline uint64_t ZigzagDecode(uint64_t encoded, uint64_t previous)
+		{
+			return previous + ((encoded >> 1) ^ (0 - (encoded & 1)));
+		}
+
+		//Reads the varints of a packet. A read past the end returns 0 and marks the reader as failed, so the callers check once at the end.
+		struct CaptureStreamReader
+		{
+			const uint8_t* Current;
+			const uint8_t* End;
+			bool Failed = false;
+
+			inline uint8_t ReadByte()
+			{
+				if (Current == End)
+				{
+					Failed = true;
+					return 0;
+				}
+
+				return *Current++;
+			}
+
+			inline uint64_t ReadVarint()
+			{
+				uint64_t value = 0;
+
+				for (uint32_t shift = 0; shift < 64; shift += 7)
+				{
+					uint8_t byte = ReadByte();
+					value |= (uint64_t)(byte & 0x7f) << shift;
+
+					if ((byte & 0x80) == 0)
+						return value;
+				}
+
+				Failed = true;
+				return 0;
+			}
+
+			inline uint32_t ReadVarint32()
+			{
+				uint64_t value = ReadVarint();
+
+				if (value > UINT32_MAX)
+					Failed = true;
+
+				return (uint32_t)value;
+			}
+
+			inline void ReadBytes(void* destination, size_t size)
+			{
+				if ((size_t)(End - Current) < size)
+				{
+					Failed = true;
+					memset(destination, 0, size);
+					return;
+				}
+
+				memcpy(destination, Current, size);
+				Current += size;
+			}
+		};
+	}
+
+	CommandCaptureWriter::CommandCaptureWriter()
+	{
+		m_Header = {};
+		m_Header.Magic = g_CaptureMagic;
+		m_Header.Version = g_CaptureVersion;
+		m_Header.HeaderSize = (uint16_t)sizeof(CaptureFileHeader);
+	}
+
+	void CommandCaptureWriter::SetFenceBase(CommandQueueType queue, uint64_t value)
+	{
+		m_Header.FenceBase[(uint32_t)queue] = value;
+	}
+
+	void CommandCaptureWriter::BeginFrame()
+	{
+		EndPacket(BeginPacket(CapturePacketType::BeginFrame, CommandQueueType::Direct));
+	}
+
+	void CommandCaptureWriter::EndFrame()
+	{
+		EndPacket(BeginPacket(CapturePacketType::EndFrame, CommandQueueType::Direct));
+		m_Stats.Frames++;
+	}
+
+	void CommandCaptureWriter::ExecuteCommandLists(CommandQueueType queue, const NullCommandList* const* commandLists, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			WriteCommandList(queue, commandLists[i]);
+
+		size_t packet = BeginPacket(CapturePacketType::Execute, queue);
+		WriteVarint(count);
+		EndPacket(packet);
+
+		m_Stats.Submissions++;
+	}
+
+	void CommandCaptureWriter::Signal(CommandQueueType queue, uint64_t value)
+	{
+		size_t packet = BeginPacket(CapturePacketType::Signal, queue);
+		WriteVarint(value);
+		EndPacket(packet);
+
+		m_Stats.Signals++;
+	}
+
+	void CommandCaptureWriter::Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value)
+	{
+		size_t packet = BeginPacket(CapturePacketType::Wait, queue);
+		WriteByte((uint8_t)signalingQueue);
+		WriteVarint(value);
+		EndPacket(packet);
+
+		m_Stats.Waits++;
+	}
+
+	void CommandCaptureWriter::WaitOnCPU(CommandQueueType queue, uint64_t value)
+	{
+		size_t packet = BeginPacket(CapturePacketType::WaitOnCPU, queue);
+		WriteVarint(value);
+		EndPacket(packet);
+
+		m_Stats.CPUWaits++;
+	}
+
+	void CommandCaptureWriter::Present(uint32_t syncInterval, uint32_t flags)
+	{
+		size_t packet = BeginPacket(CapturePacketType::Present, CommandQueueType::Direct);
+		WriteVarint(syncInterval);
+		WriteVarint(flags);
+		EndPacket(packet);
+
+		m_Stats.Presents++;
+	}
+
+	void CommandCaptureWriter::NameHandle(CaptureHandleKind kind, uint64_t value, const char* name)
+	{
+		CaptureHandle& handle = m_Handles[InternHandle(kind, value)];
+
+		if (handle.Name == g_CaptureNoName)
+		{
+			handle.Name = (uint32_t)m_Strings.size();
+			m_Strings.push_back(name);
+		}
+		else
+		{
+			m_Strings[handle.Name] = name;
+		}
+	}
+
+	bool CommandCaptureWriter::Save(const std::string& path, std::string& outError) const
+	{
+		std::vector<uint8_t> strings;
+		for (const std::string& string : m_Strings)
+		{
+			for (uint64_t length = string.size(); ; length >>= 7)
+			{
+				strings.push_back((uint8_t)(length & 0x7f) | (length >= 0x80 ? 0x80 : 0));
+				if (length < 0x80)
+					break;
+			}
+
+			strings.insert(strings.end(), string.begin(), string.end());
+		}
+
+		CaptureFileHeader header = m_Header;
+		header.FrameCount = m_Stats.Frames;
+		header.PacketCount = (uint32_t)m_Stats.Packets;
+		header.StreamOffset = sizeof(CaptureFileHeader);
+		header.StreamSize = m_Stream.size();
+		header.HandleTableOffset = header.StreamOffset + header.StreamSize;
+		header.HandleCount = (uint32_t)m_Handles.size();
+		header.StringTableOffset = header.HandleTableOffset + m_Handles.size() * sizeof(CaptureHandle);
+		header.StringTableSize = strings.size();
+		header.StringCount = (uint32_t)m_Strings.size();
+
+		std::vector<uint8_t> file(header.StringTableOffset + header.StringTableSize);
+		memcpy(file.data(), &header, sizeof(header));
+		memcpy(file.data() + header.StreamOffset, m_Stream.data(), m_Stream.size());
+		memcpy(file.data() + header.HandleTableOffset, m_Handles.data(), m_Handles.size() * sizeof(CaptureHandle));
+		memcpy(file.data() + header.StringTableOffset, strings.data(), strings.size());
+
+		if (!HTUtils::HTWriteFileAtomic(path, file.data(), file.size()))
+		{
+			outError = "Can't write the capture to " + path;
+			return false;
+		}
+
+		return true;
+	}
+
+	uint32_t CommandCaptureWriter::InternHandle(CaptureHandleKind kind, uint64_t value, uint32_t count)
+	{
+		auto result = m_HandleIndices[(uint32_t)kind].emplace(value, (uint32_t)m_Handles.size());
+
+		if (result.second)
+		{
+			CaptureHandle handle = {};
+			handle.Value = value;
+			handle.Name = g_CaptureNoName;
+			handle.Kind = kind;
+			m_Handles.push_back(handle);
+
+			m_Stats.Handles++;
+		}
+
+		CaptureHandle& handle = m_Handles[result.first->second];
+		handle.Count = HTUtils::HTMax(handle.Count, count);
+
+		return result.first->second;
+	}
+
+	size_t CommandCaptureWriter::BeginPacket(CapturePacketType type, CommandQueueType queue)
+	{
+		CapturePacketHeader header = { type, queue, 0, 0 };
+
+		size_t packet = m_Stream.size();
+		m_Stream.resize(packet + sizeof(header));
+		memcpy(m_Stream.data() + packet, &header, sizeof(header));
+
+		return packet;
+	}
+
+	void CommandCaptureWriter::EndPacket(size_t packet)
+	{
+		uint32_t size = (uint32_t)(m_Stream.size() - packet - sizeof(CapturePacketHeader));
+		memcpy(m_Stream.data() + packet + offsetof(CapturePacketHeader, Size), &size, sizeof(size));
+
+		m_Stats.Packets++;
+		m_Stats.StreamBytes = m_Stream.size();
+	}
+
+	void CommandCaptureWriter::WriteVarint(uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			m_Stream.push_back((uint8_t)(value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+
+		m_Stream.push_back((uint8_t)value);
+	}
+
+	void CommandCaptureWriter::WriteCommandList(CommandQueueType queue, const NullCommandList* commandList)
+	{
+		size_t packet = BeginPacket(CapturePacketType::CommandList, commandList ? commandList->GetType() : queue);
+		WriteVarint(commandList ? commandList->GetCommandCount() : 0);
+
+		m_Stats.CommandLists++;
+
+		if (!commandList)
+		{
+			EndPacket(packet);
+			return;
+		}
+
+		uint64_t previousConstants = 0;
+		uint64_t previousTable = 0;
+
+		for (const NullCommandList::Segment& segment : commandList->GetSegments())
+		{
+			const uint8_t* current = segment.Data;
+			const uint8_t* end = segment.Data + segment.Size;
+
+			while (current < end)
+			{
+				NullCommandHeader header;
+				memcpy(&header, current, sizeof(header));
+
+				const uint8_t* payload = current + sizeof(NullCommandHeader);
+				WriteByte((uint8_t)header.Type);
+
+				switch (header.Type)
+				{
+				case NullCommandType::SetRootSignature:
+				{
+					NullSetRootSignatureCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::RootSignature, command.RootSignature));
+				} break;
+
+				case NullCommandType::SetPipelineState:
+				{
+					NullSetPipelineStateCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::Pipeline, command.Pipeline));
+				} break;
+
+				case NullCommandType::SetDescriptorHeaps:
+				{
+					NullSetDescriptorHeapsCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::DescriptorHeap, command.ResourceHeap));
+					WriteVarint(InternHandle(CaptureHandleKind::DescriptorHeap, command.SamplerHeap));
+				} break;
+
+				case NullCommandType::SetRenderTarget:
+				{
+					NullSetRenderTargetCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::RenderTargetView, command.RenderTargetView));
+				} break;
+
+				case NullCommandType::SetConstantBuffer:
+				{
+					NullSetConstantBufferCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(command.Slot);
+					WriteVarint(ZigzagEncode(command.GPUAddress, previousConstants));
+					previousConstants = command.GPUAddress;
+				} break;
+
+				case NullCommandType::SetDescriptorTable:
+				{
+					NullSetDescriptorTableCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(command.Slot);
+					WriteVarint(ZigzagEncode(command.GPUHandle, previousTable));
+					previousTable = command.GPUHandle;
+				} break;
+
+				case NullCommandType::ClearRenderTarget:
+				{
+					NullClearRenderTargetCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::RenderTargetView, command.RenderTargetView));
+
+					size_t color = m_Stream.size();
+					m_Stream.resize(color + sizeof(command.Color));
+					memcpy(m_Stream.data() + color, command.Color, sizeof(command.Color));
+				} break;
+
+				case NullCommandType::ResourceBarriers:
+				{
+					NullResourceBarriersCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(command.Count);
+
+					const uint8_t* barriers = payload + sizeof(command);
+					for (uint32_t i = 0; i < command.Count; i++)
+					{
+						ResourceBarrier barrier;
+						memcpy(&barrier, barriers + i * sizeof(ResourceBarrier), sizeof(barrier));
+
+						WriteByte((uint8_t)barrier.Type);
+						WriteByte((uint8_t)barrier.Flags);
+						WriteVarint(InternHandle(CaptureHandleKind::Resource, barrier.Resource));
+						WriteVarint((uint32_t)barrier.Before);
+						WriteVarint((uint32_t)barrier.After);
+					}
+				} break;
+
+				case NullCommandType::Draw:
+				{
+					NullDrawCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(command.VertexCount);
+					WriteVarint(command.InstanceCount);
+					WriteVarint(command.StartVertex);
+					WriteVarint(command.StartInstance);
+				} break;
+
+				case NullCommandType::Dispatch:
+				{
+					NullDispatchCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(command.X);
+					WriteVarint(command.Y);
+					WriteVarint(command.Z);
+				} break;
+
+				case NullCommandType::EndQuery:
+				{
+					NullEndQueryCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::QueryHeap, command.QueryHeap, command.Index + 1));
+					WriteVarint(command.Index);
+				} break;
+
+				case NullCommandType::ResolveQueries:
+				{
+					NullResolveQueriesCommand command;
+					memcpy(&command, payload, sizeof(command));
+					WriteVarint(InternHandle(CaptureHandleKind::QueryHeap, command.QueryHeap, command.First + command.Count));
+					WriteVarint(InternHandle(CaptureHandleKind::QueryDestination, command.Destination, command.First + command.Count));
+					WriteVarint(command.First);
+					WriteVarint(command.Count);
+				} break;
+
+				default:
+					D3D_ASSERT(false, "A null command the capture doesn't know!");
+					break;
+				}
+
+				current += header.Size;
+				m_Stats.Commands++;
+			}
+
+			m_Stats.CommandBytes += segment.Size;
+		}
+
+		EndPacket(packet);
+	}
+
+	bool CommandCaptureReader::Load(const std::string& path, std::string& outError)
+	{
+		std::vector<uint8_t> data;
+		if (!HTUtils::HTReadFile(path, data))
+		{
+			outError = "Can't read " + path;
+			return false;
+		}
+
+		return Parse(std::move(data), outError);
+	}
+
+	bool CommandCaptureReader::Parse(std::vector<uint8_t> data, std::string& outError)
+	{
+		m_Data = std::move(data);
+		m_Header = {};
+		m_Handles.clear();
+		m_Strings.clear();
+
+		CaptureFileHeader header;
+		if (m_Data.size() < sizeof(header))
+		{
+			outError = "The file is too small for a capture header";
+			return false;
+		}
+
+		memcpy(&header, m_Data.data(), sizeof(header));
+
+		if (header.Magic != g_CaptureMagic)
+		{
+			outError = "Not a capture file";
+			return false;
+		}
+
+		if (header.Version != g_CaptureVersion || header.HeaderSize != sizeof(CaptureFileHeader))
+		{
+			outError = "Capture version " + std::to_string(header.Version) + ", this build reads version " + std::to_string(g_CaptureVersion);
+			return false;
+		}
+
+		//The sizes are checked against what is left, so a huge number can't overflow the sum
+		uint64_t fileSize = m_Data.size();
+		auto InFile = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+
+		if (!InFile(header.StreamOffset, header.StreamSize) || header.HandleCount > fileSize / sizeof(CaptureHandle) ||
+			!InFile(header.HandleTableOffset, (uint64_t)header.HandleCount * sizeof(CaptureHandle)) || !InFile(header.StringTableOffset, header.StringTableSize))
+		{
+			outError = "The file is smaller than its tables";
+			return false;
+		}
+
+		m_Handles.resize(header.HandleCount);
+		memcpy(m_Handles.data(), m_Data.data() + header.HandleTableOffset, m_Handles.size() * sizeof(CaptureHandle));
+
+		CaptureStreamReader strings = { m_Data.data() + header.StringTableOffset, m_Data.data() + header.StringTableOffset + header.StringTableSize };
+		for (uint32_t i = 0; i < header.StringCount && !strings.Failed; i++)
+		{
+			uint64_t length = strings.ReadVarint();
+			if (length > (uint64_t)(strings.End - strings.Current))
+			{
+				strings.Failed = true;
+				break;
+			}
+
+			m_Strings.emplace_back(reinterpret_cast<const char*>(strings.Current), (size_t)length);
+			strings.Current += length;
+		}
+
+		if (strings.Failed)
+		{
+			outError = "The string table is truncated";
+			return false;
+		}
+
+		for (const CaptureHandle& handle : m_Handles)
+		{
+			if (handle.Kind >= CaptureHandleKind::Count || (handle.Name != g_CaptureNoName && handle.Name >= m_Strings.size()))
+			{
+				outError = "Invalid handle in the handle table";
+				return false;
+			}
+		}
+
+		m_Header = header;
+		return true;
+	}
+
+	const std::string& CommandCaptureReader::GetHandleName(uint32_t handle) const
+	{
+		static const std::string s_NoName;
+
+		uint32_t name = m_Handles[handle].Name;
+		return name == g_CaptureNoName ? s_NoName : m_Strings[name];
+	}
+
+	void CaptureShadowLists::SetEnabled(bool enabled)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_Enabled.store(enabled, std::memory_order_release);
+		if (!enabled)
+			m_Shadows.clear();
+	}
+
+	NullCommandList* CaptureShadowLists::Get(void* commandList, CommandQueueType type)
+	{
+		if (!IsEnabled())
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		//The references to the elements of an unordered_map stay valid when it grows, so the list can record after the lock is gone
+		Shadow& shadow = m_Shadows[commandList];
+		if (!shadow.CommandList)
+		{
+			shadow.Allocator = std::make_unique<NullCommandAllocator>(type);
+			shadow.CommandList = std::make_unique<NullCommandList>(type, shadow.Allocator.get());
+		}
+
+		return shadow.CommandList.get();
+	}
+
+	const NullCommandList* CaptureShadowLists::GetCommands(void* commandList)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto shadow = m_Shadows.find(commandList);
+		if (shadow == m_Shadows.end())
+			return nullptr;
+
+		if (!shadow->second.CommandList->IsClosed())
+			shadow->second.CommandList->Close();
+
+		return shadow->second.CommandList.get();
+	}
+
+	void CaptureShadowLists::OnExecuted(void* commandList)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		//The commands were copied to the capture, the native list is reset before it records again and so is its shadow
+		auto shadow = m_Shadows.find(commandList);
+		if (shadow == m_Shadows.end())
+			return;
+
+		shadow->second.Allocator->Reset();
+		shadow->second.CommandList->Reset(shadow->second.Allocator.get());
+	}
+
+	uint64_t CaptureFence::Signal()
+	{
+		return m_Backend->Signal(m_Queue);
+	}
+
+	void CaptureFence::WaitForValue(uint64_t value)
+	{
+		if (IsComplete(value))
+			return;
+
+		m_Backend->CaptureCPUWait(m_Queue, value);
+		m_Fence->WaitForValue(value);
+	}
+
+	CaptureQueueBackend::CaptureQueueBackend(ICommandQueueBackend* backend, ICaptureListSource* commandLists) : m_Backend(backend), m_CommandLists(commandLists)
+	{
+		for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+		{
+			m_Fences[i].m_Backend = this;
+			m_Fences[i].m_Fence = backend->GetFence((CommandQueueType)i);
+			m_Fences[i].m_Queue = (CommandQueueType)i;
+		}
+	}
+
+	void CaptureQueueBackend::SetWriter(CommandCaptureWriter* writer)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (writer)
+		{
+			for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+				writer->SetFenceBase((CommandQueueType)i, m_Fences[i].GetLastSignaledValue());
+		}
+
+		m_Writer = writer;
+	}
+
+	bool CaptureQueueBackend::IsCapturing() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Writer != nullptr;
+	}
+
+	void CaptureQueueBackend::BeginFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Writer)
+			m_Writer->BeginFrame();
+	}
+
+	void CaptureQueueBackend::EndFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Writer)
+			m_Writer->EndFrame();
+	}
+
+	void CaptureQueueBackend::Present(uint32_t syncInterval, uint32_t flags)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Writer)
+			m_Writer->Present(syncInterval, flags);
+	}
+
+	//The lock is held while the real queue gets the call too, so the capture has everything in the order the queues got it
+	void CaptureQueueBackend::ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Writer)
+		{
+			m_CapturedLists.clear();
+			for (uint32_t i = 0; i < count; i++)
+				m_CapturedLists.push_back(m_CommandLists->GetCommands(commandLists[i]));
+
+			m_Writer->ExecuteCommandLists(queue, m_CapturedLists.data(), count);
+		}
+
+		m_Backend->ExecuteCommandLists(queue, commandLists, count);
+
+		if (m_Writer)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				m_CommandLists->OnExecuted(commandLists[i]);
+		}
+	}
+
+	uint64_t CaptureQueueBackend::Signal(CommandQueueType queue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		uint64_t value = m_Backend->Signal(queue);
+
+		if (m_Writer)
+			m_Writer->Signal(queue, value);
+
+		return value;
+	}
+
+	void CaptureQueueBackend::Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_Backend->Wait(queue, signalingQueue, value);
+
+		if (m_Writer)
+			m_Writer->Wait(queue, signalingQueue, value);
+	}
+
+	//Only the wait is captured, the CPU blocks without the lock
+	void CaptureQueueBackend::CaptureCPUWait(CommandQueueType queue, uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Writer)
+			m_Writer->WaitOnCPU(queue, value);
+	}
+
+	namespace
+	{
+		//Walks the packets of a capture and drives the queues with them
+		class CaptureReplayer
+		{
+		public:
+			CaptureReplayer(const CommandCaptureReader& capture, ICommandQueueBackend* queues, ICommandPoolBackend* pools, ICaptureCommandRecorder* recorder, CaptureReplayStats& stats)
+				: m_Capture(capture), m_Queues(queues), m_Recorder(recorder), m_Stats(stats)
+			{
+				for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+					m_Pools[i] = std::make_unique<CommandPool>(pools, (CommandQueueType)i, queues->GetFence((CommandQueueType)i));
+			}
+
+			bool Run(std::string& outError);
+
+			//The lists that were not executed go back to their pool and the queues end idle, whatever happened
+			void Finish();
+
+		private:
+			bool ReplayCommandList(CommandQueueType queue, CaptureStreamReader& packet);
+			bool Execute(CommandQueueType queue, uint32_t listCount);
+
+			//Into the values of the replay. False for a value signaled before the capture began.
+			inline bool ToReplayValue(CommandQueueType queue, uint64_t value, uint64_t& outValue) const
+			{
+				uint64_t base = m_Capture.GetHeader().FenceBase[(uint32_t)queue];
+				bool inCapture = value > base;
+				outValue = value - base;
+				return inCapture;
+			}
+
+			inline uint32_t ReadHandle(CaptureStreamReader& packet, CaptureHandleKind kind)
+			{
+				uint32_t handle = packet.ReadVarint32();
+
+				if (handle >= m_Capture.GetHandleCount() || m_Capture.GetHandle(handle).Kind != kind)
+				{
+					packet.Failed = true;
+					return 0;
+				}
+
+				return handle;
+			}
+
+		private:
+			const CommandCaptureReader& m_Capture;
+			ICommandQueueBackend* m_Queues;
+			ICaptureCommandRecorder* m_Recorder;
+			CaptureReplayStats& m_Stats;
+
+			std::unique_ptr<CommandPool> m_Pools[(uint32_t)CommandQueueType::Count];
+
+			//The lists of the next Execute
+			std::vector<PooledCommandList> m_PendingLists;
+			std::vector<void*> m_SubmitList;
+			std::vector<ResourceBarrier> m_Barriers;
+
+			//Something was executed after the last signal of the queue
+			bool m_Unsignaled[(uint32_t)CommandQueueType::Count] = {};
+		};
+
+		bool CaptureReplayer::Run(std::string& outError)
+		{
+			const uint8_t* current = m_Capture.GetStream();
+			const uint8_t* end = current + m_Capture.GetStreamSize();
+
+			while (current < end)
+			{
+				CapturePacketHeader header;
+				if ((size_t)(end - current) < sizeof(header))
+				{
+					outError = "The stream ends in the middle of a packet header";
+					return false;
+				}
+
+				memcpy(&header, current, sizeof(header));
+				current += sizeof(header);
+
+				if ((uint64_t)(end - current) < header.Size || header.Queue >= CommandQueueType::Count)
+				{
+					outError = "Invalid packet header";
+					return false;
+				}
+
+				CaptureStreamReader packet = { current, current + header.Size };
+				current += header.Size;
+
+				IFence* fence = m_Queues->GetFence(header.Queue);
+				bool valid = true;
+
+				switch (header.Type)
+				{
+				case CapturePacketType::BeginFrame:
+					break;
+
+				case CapturePacketType::EndFrame:
+					m_Stats.Frames++;
+					break;
+
+				case CapturePacketType::CommandList:
+					valid = ReplayCommandList(header.Queue, packet);
+					break;
+
+				case CapturePacketType::Execute:
+					valid = Execute(header.Queue, packet.ReadVarint32());
+					break;
+
+				case CapturePacketType::Signal:
+				{
+					uint64_t expected = 0;
+					bool inCapture = ToReplayValue(header.Queue, packet.ReadVarint(), expected);
+
+					if (m_Queues->Signal(header.Queue) != expected || !inCapture)
+						m_Stats.FenceMismatches++;
+
+					m_Unsignaled[(uint32_t)header.Queue] = false;
+					m_Stats.Signals++;
+				} break;
+
+				case CapturePacketType::Wait:
+				{
+					uint8_t signalingQueue = packet.ReadByte();
+					uint64_t value = packet.ReadVarint();
+
+					if (signalingQueue >= (uint8_t)CommandQueueType::Count)
+					{
+						valid = false;
+						break;
+					}
+
+					if (!ToReplayValue((CommandQueueType)signalingQueue, value, value))
+						m_Stats.SkippedWaits++;
+					else if (value > m_Queues->GetFence((CommandQueueType)signalingQueue)->GetLastSignaledValue())
+						m_Stats.FenceMismatches++;
+					else
+						m_Queues->Wait(header.Queue, (CommandQueueType)signalingQueue, value);
+
+					m_Stats.Waits++;
+				} break;
+
+				case CapturePacketType::WaitOnCPU:
+				{
+					uint64_t value = 0;
+
+					if (!ToReplayValue(header.Queue, packet.ReadVarint(), value))
+						m_Stats.SkippedWaits++;
+					else if (value > fence->GetLastSignaledValue())
+						m_Stats.FenceMismatches++;
+					else
+						fence->WaitForValue(value);
+
+					m_Stats.CPUWaits++;
+				} break;
+
+				case CapturePacketType::Present:
+				{
+					uint32_t syncInterval = packet.ReadVarint32();
+					uint32_t flags = packet.ReadVarint32();
+
+					if (!packet.Failed)
+						m_Recorder->Present(syncInterval, flags);
+
+					m_Stats.Presents++;
+				} break;
+
+				default:
+					valid = false;
+					break;
+				}
+
+				if (!valid || packet.Failed)
+				{
+					outError = std::string("Malformed ") + CapturePacketTypeName(header.Type) + " packet";
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool CaptureReplayer::ReplayCommandList(CommandQueueType queue, CaptureStreamReader& packet)
+		{
+			uint32_t commandCount = packet.ReadVarint32();
+
+			m_PendingLists.push_back(m_Pools[(uint32_t)queue]->Acquire());
+			void* commandList = m_PendingLists.back().NativeCommandList;
+
+			uint64_t previousConstants = 0;
+			uint64_t previousTable = 0;
+
+			for (uint32_t i = 0; i < commandCount && !packet.Failed; i++)
+			{
+				NullCommandType type = (NullCommandType)packet.ReadByte();
+
+				switch (type)
+				{
+				case NullCommandType::SetRootSignature:
+				{
+					uint32_t rootSignature = ReadHandle(packet, CaptureHandleKind::RootSignature);
+					if (!packet.Failed)
+						m_Recorder->SetRootSignature(commandList, rootSignature);
+				} break;
+
+				case NullCommandType::SetPipelineState:
+				{
+					uint32_t pipeline = ReadHandle(packet, CaptureHandleKind::Pipeline);
+					if (!packet.Failed)
+						m_Recorder->SetPipelineState(commandList, pipeline);
+				} break;
+
+				case NullCommandType::SetDescriptorHeaps:
+				{
+					uint32_t resourceHeap = ReadHandle(packet, CaptureHandleKind::DescriptorHeap);
+					uint32_t samplerHeap = ReadHandle(packet, CaptureHandleKind::DescriptorHeap);
+					if (!packet.Failed)
+						m_Recorder->SetDescriptorHeaps(commandList, resourceHeap, samplerHeap);
+				} break;
+
+				case NullCommandType::SetRenderTarget:
+				{
+					uint32_t renderTargetView = ReadHandle(packet, CaptureHandleKind::RenderTargetView);
+					if (!packet.Failed)
+						m_Recorder->SetRenderTarget(commandList, renderTargetView);
+				} break;
+
+				case NullCommandType::SetConstantBuffer:
+				{
+					uint32_t slot = packet.ReadVarint32();
+					previousConstants = ZigzagDecode(packet.ReadVarint(), previousConstants);
+					if (!packet.Failed)
+						m_Recorder->SetConstantBuffer(commandList, slot, previousConstants);
+				} break;
+
+				case NullCommandType::SetDescriptorTable:
+				{
+					uint32_t slot = packet.ReadVarint32();
+					previousTable = ZigzagDecode(packet.ReadVarint(), previousTable);
+					if (!packet.Failed)
+						m_Recorder->SetDescriptorTable(commandList, slot, previousTable);
+				} break;
+
+				case NullCommandType::ClearRenderTarget:
+				{
+					uint32_t renderTargetView = ReadHandle(packet, CaptureHandleKind::RenderTargetView);
+					float color[4];
+					packet.ReadBytes(color, sizeof(color));
+					if (!packet.Failed)
+						m_Recorder->ClearRenderTarget(commandList, renderTargetView, color);
+				} break;
+
+				case NullCommandType::ResourceBarriers:
+				{
+					uint32_t count = packet.ReadVarint32();
+
+					//Every barrier takes 5 bytes at least, a count bigger than what is left is garbage (and would allocate it)
+					if (count > (uint64_t)(packet.End - packet.Current) / 5)
+					{
+						packet.Failed = true;
+						break;
+					}
+
+					m_Barriers.resize(count);
+					for (ResourceBarrier& barrier : m_Barriers)
+					{
+						barrier.Type = (BarrierType)packet.ReadByte();
+						barrier.Flags = (BarrierFlags)packet.ReadByte();
+						barrier.Resource = ReadHandle(packet, CaptureHandleKind::Resource);
+						barrier.Before = (ResourceState)packet.ReadVarint32();
+						barrier.After = (ResourceState)packet.ReadVarint32();
+					}
+
+					if (!packet.Failed)
+						m_Recorder->ResourceBarriers(commandList, m_Barriers.data(), count);
+				} break;
+
+				case NullCommandType::Draw:
+				{
+					uint32_t vertexCount = packet.ReadVarint32();
+					uint32_t instanceCount = packet.ReadVarint32();
+					uint32_t startVertex = packet.ReadVarint32();
+					uint32_t startInstance = packet.ReadVarint32();
+					if (!packet.Failed)
+						m_Recorder->Draw(commandList, vertexCount, instanceCount, startVertex, startInstance);
+				} break;
+
+				case NullCommandType::Dispatch:
+				{
+					uint32_t x = packet.ReadVarint32();
+					uint32_t y = packet.ReadVarint32();
+					uint32_t z = packet.ReadVarint32();
+					if (!packet.Failed)
+						m_Recorder->Dispatch(commandList, x, y, z);
+				} break;
+
+				case NullCommandType::EndQuery:
+				{
+					uint32_t queryHeap = ReadHandle(packet, CaptureHandleKind::QueryHeap);
+					uint32_t index = packet.ReadVarint32();
+
+					//The recorder sized the heap with the count of the handle
+					if (!packet.Failed && index >= m_Capture.GetHandle(queryHeap).Count)
+						packet.Failed = true;
+
+					if (!packet.Failed)
+						m_Recorder->EndQuery(commandList, queryHeap, index);
+				} break;
+
+				case NullCommandType::ResolveQueries:
+				{
+					uint32_t queryHeap = ReadHandle(packet, CaptureHandleKind::QueryHeap);
+					uint32_t destination = ReadHandle(packet, CaptureHandleKind::QueryDestination);
+					uint32_t first = packet.ReadVarint32();
+					uint32_t count = packet.ReadVarint32();
+
+					if (!packet.Failed && ((uint64_t)first + count > m_Capture.GetHandle(queryHeap).Count || (uint64_t)first + count > m_Capture.GetHandle(destination).Count))
+						packet.Failed = true;
+
+					if (!packet.Failed)
+						m_Recorder->ResolveQueries(commandList, queryHeap, first, count, destination);
+				} break;
+
+				default:
+					packet.Failed = true;
+					break;
+				}
+
+				m_Stats.Commands++;
+			}
+
+			//The list goes back to the pool with the others, even if it is incomplete
+			m_Recorder->Close(commandList);
+			m_Stats.CommandLists++;
+
+			return !packet.Failed && packet.Current == packet.End;
+		}
+
+		bool CaptureReplayer::Execute(CommandQueueType queue, uint32_t listCount)
+		{
+			if (listCount != m_PendingLists.size())
+				return false;
+
+			m_SubmitList.clear();
+			for (const PooledCommandList& commandList : m_PendingLists)
+			{
+				if (commandList.Type != queue)
+					return false;
+
+				m_SubmitList.push_back(commandList.NativeCommandList);
+			}
+
+			m_Queues->ExecuteCommandLists(queue, m_SubmitList.data(), listCount);
+
+			//The lists are done once the next signal of the queue is reached, the allocators go back to the pool then
+			uint64_t fenceValue = m_Queues->GetFence(queue)->GetLastSignaledValue() + 1;
+			for (const PooledCommandList& commandList : m_PendingLists)
+				m_Pools[(uint32_t)queue]->Release(commandList, fenceValue);
+
+			m_PendingLists.clear();
+			m_Unsignaled[(uint32_t)queue] = true;
+			m_Stats.Submissions++;
+
+			return true;
+		}
+
+		void CaptureReplayer::Finish()
+		{
+			for (const PooledCommandList& commandList : m_PendingLists)
+				m_Pools[(uint32_t)commandList.Type]->Release(commandList, 0);
+
+			m_PendingLists.clear();
+
+			for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+			{
+				if (m_Unsignaled[i])
+					m_Queues->Signal((CommandQueueType)i);
+
+				m_Queues->GetFence((CommandQueueType)i)->WaitForIdle();
+			}
+		}
+	}
+
+	bool ReplayCommandCapture(const CommandCaptureReader& capture, ICommandQueueBackend* queues, ICommandPoolBackend* pools, ICaptureCommandRecorder* recorder,
+		CaptureReplayStats& outStats, std::string& outError)
+	{
+		outStats = {};
+
+		if (!recorder->BeginReplay(capture, outError))
+			return false;
+
+		uint64_t begin = HTUtils::HTNowNanoseconds();
+
+		CaptureReplayer replayer(capture, queues, pools, recorder, outStats);
+		bool valid = replayer.Run(outError);
+		replayer.Finish();
+
+		outStats.ReplayNs = HTUtils::HTNowNanoseconds() - begin;
+		return valid;
+	}
+}
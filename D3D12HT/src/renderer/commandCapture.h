@@ -0,0 +1,364 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <renderer/commandPool.h>
+#include <renderer/queueScheduler.h>
+#include <renderer/resourceStateTracker.h>
+#include <renderer/null/nullCommandList.h>
+
+namespace HT
+{
+	//A capture is what the renderer sent to the queues during a few frames: the lists (with their commands), the submissions, the signals and waits of the fences
+	//and the presents. It is saved to a small binary file and replayed later on any backend, the null one included, as fast as it can.
+	//So the submission path can be profiled (and checked for regressions) on Linux, with the frames of a real run instead of made up ones.
+	//
+	//The file, little endian (every machine we run on is):
+	//- CaptureFileHeader
+	//- The stream: packets, one after the other. Each one is a CapturePacketHeader followed by Size bytes.
+	//- The handle table: a CaptureHandle for every API object the commands use. The commands refer to them by index.
+	//- The string table: the names of the handles, each one is a varint length followed by its characters.
+	//The numbers inside the packets are LEB128 varints, most of them fit in one or two bytes.
+	const uint32_t g_CaptureMagic = 0x50435448; //"HTCP"
+	const uint16_t g_CaptureVersion = 1;
+	const uint32_t g_CaptureNoName = ~0u;
+
+	struct CaptureFileHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t HeaderSize;
+		uint32_t FrameCount;
+		uint32_t PacketCount;
+
+		//The last value signaled on each queue when the capture began. The values of the capture are relative to them, the replay starts its fences at 0.
+		uint64_t FenceBase[(uint32_t)CommandQueueType::Count];
+
+		uint64_t StreamOffset;
+		uint64_t StreamSize;
+		uint64_t HandleTableOffset;
+		uint64_t StringTableOffset;
+		uint64_t StringTableSize;
+		uint32_t HandleCount;
+		uint32_t StringCount;
+	};
+
+	enum class CapturePacketType : uint8_t
+	{
+		BeginFrame = 0,
+		EndFrame,
+		CommandList, //Command count, then the commands. Queue is the type of the list.
+		Execute,     //List count: the last CommandList packets are executed on Queue, in order
+		Signal,      //The value the queue signaled
+		Wait,        //The signaling queue (1 byte) and the value Queue waits for on the GPU
+		WaitOnCPU,   //The value of the fence of Queue the CPU waited for
+		Present,     //Sync interval and flags
+
+		Count
+	};
+
+	const char* CapturePacketTypeName(CapturePacketType type);
+
+	struct CapturePacketHeader
+	{
+		CapturePacketType Type;
+		CommandQueueType Queue;
+		uint16_t Reserved;
+		uint32_t Size; //Of the payload
+	};
+
+	//The commands of a CommandList packet are the HT::NullCommandType ones: the type (1 byte) followed by its fields as varints, in the order of the null command.
+	//The API objects are indices into the handle table. The GPU addresses of SetConstantBuffer and SetDescriptorTable are the difference (zigzag) with the previous one of the list,
+	//the draws of a list walk their constants in order so most of them take two bytes. The colors of ClearRenderTarget are 4 raw floats.
+	//A barrier is its type and flags (1 byte each), then the handle of its resource and the states.
+	enum class CaptureHandleKind : uint8_t
+	{
+		RootSignature = 0,
+		Pipeline,
+		DescriptorHeap,
+		RenderTargetView,
+		Resource,
+		QueryHeap,
+		QueryDestination,
+
+		Count
+	};
+
+	const char* CaptureHandleKindName(CaptureHandleKind kind);
+
+	struct CaptureHandle
+	{
+		uint64_t Value;   //What the capture had (a pointer, a descriptor, a made up id)
+		uint32_t Count;   //Queries of a query heap or a destination (the biggest index used + 1), 0 for the others
+		uint32_t Name;    //Into the string table, g_CaptureNoName if it has none
+		CaptureHandleKind Kind;
+		uint8_t Reserved[7];
+	};
+
+	struct CommandCaptureStats
+	{
+		uint32_t Frames = 0;
+		uint64_t Packets = 0;
+		uint64_t CommandLists = 0;
+		uint64_t Commands = 0;
+		uint64_t Submissions = 0;
+		uint64_t Signals = 0;
+		uint64_t Waits = 0;
+		uint64_t CPUWaits = 0;
+		uint64_t Presents = 0;
+		uint32_t Handles = 0;
+
+		//The bytes of the null commands that were captured and what they took in the stream
+		uint64_t CommandBytes = 0;
+		uint64_t StreamBytes = 0;
+	};
+
+	//Builds a capture in memory, Save writes it. Not thread safe, HT::CaptureQueueBackend calls it under its lock.
+	class CommandCaptureWriter
+	{
+	public:
+		CommandCaptureWriter();
+
+		CommandCaptureWriter(const CommandCaptureWriter&) = delete;
+		CommandCaptureWriter& operator=(const CommandCaptureWriter&) = delete;
+
+		void SetFenceBase(CommandQueueType queue, uint64_t value);
+
+		void BeginFrame();
+		void EndFrame();
+
+		//A null list is a CommandList packet. A list can be null (a list with nothing we could capture), it is captured empty so the Execute still has all its lists.
+		void ExecuteCommandLists(CommandQueueType queue, const NullCommandList* const* commandLists, uint32_t count);
+		void Signal(CommandQueueType queue, uint64_t value);
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value);
+		void WaitOnCPU(CommandQueueType queue, uint64_t value);
+		void Present(uint32_t syncInterval, uint32_t flags);
+
+		//The name shows up in the handle table, so the objects can be found (or created again) by whoever replays the capture
+		void NameHandle(CaptureHandleKind kind, uint64_t value, const char* name);
+
+		//Written atomically (HTUtils::HTWriteFileAtomic)
+		bool Save(const std::string& path, std::string& outError) const;
+
+		const CommandCaptureStats& GetStats() const { return m_Stats; }
+
+	private:
+		uint32_t InternHandle(CaptureHandleKind kind, uint64_t value, uint32_t count = 0);
+
+		size_t BeginPacket(CapturePacketType type, CommandQueueType queue);
+		void EndPacket(size_t packet);
+
+		void WriteCommandList(CommandQueueType queue, const NullCommandList* commandList);
+		void WriteVarint(uint64_t value);
+		void WriteByte(uint8_t value) { m_Stream.push_back(value); }
+
+	private:
+		CaptureFileHeader m_Header;
+
+		std::vector<uint8_t> m_Stream;
+		std::vector<CaptureHandle> m_Handles;
+		std::vector<std::string> m_Strings;
+		std::unordered_map<uint64_t, uint32_t> m_HandleIndices[(uint32_t)CaptureHandleKind::Count];
+
+		CommandCaptureStats m_Stats;
+	};
+
+	//A capture file, loaded in memory. Load checks the header and the tables, the packets are checked while they are replayed.
+	class CommandCaptureReader
+	{
+	public:
+		bool Load(const std::string& path, std::string& outError);
+		bool Parse(std::vector<uint8_t> data, std::string& outError);
+
+		inline const CaptureFileHeader& GetHeader() const { return m_Header; }
+		inline const uint8_t* GetStream() const { return m_Data.data() + m_Header.StreamOffset; }
+		inline uint64_t GetStreamSize() const { return m_Header.StreamSize; }
+		inline uint64_t GetFileSize() const { return m_Data.size(); }
+
+		inline uint32_t GetHandleCount() const { return (uint32_t)m_Handles.size(); }
+		inline const CaptureHandle& GetHandle(uint32_t handle) const { return m_Handles[handle]; }
+
+		//Empty for a handle with no name
+		const std::string& GetHandleName(uint32_t handle) const;
+
+	private:
+		std::vector<uint8_t> m_Data;
+		CaptureFileHeader m_Header = {};
+
+		std::vector<CaptureHandle> m_Handles;
+		std::vector<std::string> m_Strings;
+	};
+
+	//Where the capture finds the commands of the lists that are executed. The null lists already are the commands, the lists of other backends
+	//have a null list next to them that records the same commands (see HT::CaptureShadowLists).
+	class ICaptureListSource
+	{
+	public:
+		virtual ~ICaptureListSource() = default;
+
+		//nullptr if the list has nothing to capture
+		virtual const NullCommandList* GetCommands(void* commandList) = 0;
+
+		//The list was captured and executed, what was kept for it can go
+		virtual void OnExecuted(void* commandList) = 0;
+	};
+
+	class NullCaptureListSource : public ICaptureListSource
+	{
+	public:
+		const NullCommandList* GetCommands(void* commandList) override { return ToNullCommandList(commandList); }
+		void OnExecuted(void*) override {}
+	};
+
+	//A null list per native list, for the backends that can't be read back (a D3D12 list is write only). The code that records a native list
+	//records the same commands on Get(list), when it isn't null. It is only null while nothing is captured, so outside of a capture this costs a branch.
+	class CaptureShadowLists : public ICaptureListSource
+	{
+	public:
+		//Turning it off throws away what the lists recorded. Only between frames (no list is recording).
+		void SetEnabled(bool enabled);
+		inline bool IsEnabled() const { return m_Enabled.load(std::memory_order_acquire); }
+
+		//Thread safe, every list records on its own thread
+		NullCommandList* Get(void* commandList, CommandQueueType type);
+
+		const NullCommandList* GetCommands(void* commandList) override;
+		void OnExecuted(void* commandList) override;
+
+	private:
+		struct Shadow
+		{
+			std::unique_ptr<NullCommandAllocator> Allocator;
+			std::unique_ptr<NullCommandList> CommandList;
+		};
+
+		std::atomic<bool> m_Enabled = false;
+
+		std::mutex m_Mutex;
+		std::unordered_map<void*, Shadow> m_Shadows;
+	};
+
+	class CaptureQueueBackend;
+
+	//The fence of a queue of HT::CaptureQueueBackend. The signals go through the backend and the CPU waits are captured, the rest is the fence of the real queue.
+	class CaptureFence : public IFence
+	{
+	public:
+		uint64_t Signal() override;
+		uint64_t GetCompletedValue() const override { return m_Fence->GetCompletedValue(); }
+		uint64_t GetLastSignaledValue() const override { return m_Fence->GetLastSignaledValue(); }
+		void WaitForValue(uint64_t value) override;
+
+	private:
+		friend class CaptureQueueBackend;
+
+		CaptureQueueBackend* m_Backend = nullptr;
+		IFence* m_Fence = nullptr;
+		CommandQueueType m_Queue = CommandQueueType::Direct;
+	};
+
+	//Goes between the scheduler (and everything that uses the fences) and the real queues. Everything is forwarded to the real backend, and while
+	//there is a writer it is also captured, in the order the queues get it. The frame ring must use GetFence too, or its signals are missing from the capture.
+	class CaptureQueueBackend : public ICommandQueueBackend
+	{
+	public:
+		CaptureQueueBackend(ICommandQueueBackend* backend, ICaptureListSource* commandLists);
+
+		CaptureQueueBackend(const CaptureQueueBackend&) = delete;
+		CaptureQueueBackend& operator=(const CaptureQueueBackend&) = delete;
+
+		//Starts capturing into writer, from the values the fences are at. nullptr stops. The writer isn't touched after it is replaced.
+		void SetWriter(CommandCaptureWriter* writer);
+		bool IsCapturing() const;
+
+		//What the queues don't see. Nothing happens when there is no writer.
+		void BeginFrame();
+		void EndFrame();
+		void Present(uint32_t syncInterval, uint32_t flags);
+
+		void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) override;
+		uint64_t Signal(CommandQueueType queue) override;
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) override;
+		IFence* GetFence(CommandQueueType queue) override { return &m_Fences[(uint32_t)queue]; }
+
+		inline ICommandQueueBackend* GetBackend() const { return m_Backend; }
+
+	private:
+		friend class CaptureFence;
+
+		void CaptureCPUWait(CommandQueueType queue, uint64_t value);
+
+	private:
+		ICommandQueueBackend* m_Backend;
+		ICaptureListSource* m_CommandLists;
+
+		mutable std::mutex m_Mutex;
+		CommandCaptureWriter* m_Writer = nullptr;
+		std::vector<const NullCommandList*> m_CapturedLists;
+
+		CaptureFence m_Fences[(uint32_t)CommandQueueType::Count];
+	};
+
+	//What a replay records the commands with. The handles are indices into the handle table of the capture, the recorder turns them into objects of its backend.
+	//HT::NullCaptureRecorder records on null lists.
+	class ICaptureCommandRecorder
+	{
+	public:
+		virtual ~ICaptureCommandRecorder() = default;
+
+		//Before the first command. The objects of the handles are created (or looked up by name) here.
+		virtual bool BeginReplay(const CommandCaptureReader& capture, std::string& outError) = 0;
+
+		virtual void SetRootSignature(void* commandList, uint32_t rootSignature) = 0;
+		virtual void SetPipelineState(void* commandList, uint32_t pipeline) = 0;
+		virtual void SetDescriptorHeaps(void* commandList, uint32_t resourceHeap, uint32_t samplerHeap) = 0;
+		virtual void SetRenderTarget(void* commandList, uint32_t renderTargetView) = 0;
+		virtual void SetConstantBuffer(void* commandList, uint32_t slot, uint64_t gpuAddress) = 0;
+		virtual void SetDescriptorTable(void* commandList, uint32_t slot, uint64_t gpuHandle) = 0;
+		virtual void ClearRenderTarget(void* commandList, uint32_t renderTargetView, const float (&color)[4]) = 0;
+
+		//The Resource of the barriers is a handle
+		virtual void ResourceBarriers(void* commandList, const ResourceBarrier* barriers, uint32_t count) = 0;
+
+		virtual void Draw(void* commandList, uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) = 0;
+		virtual void Dispatch(void* commandList, uint32_t x, uint32_t y, uint32_t z) = 0;
+		virtual void EndQuery(void* commandList, uint32_t queryHeap, uint32_t index) = 0;
+		virtual void ResolveQueries(void* commandList, uint32_t queryHeap, uint32_t first, uint32_t count, uint32_t destination) = 0;
+		virtual void Close(void* commandList) = 0;
+
+		virtual void Present(uint32_t syncInterval, uint32_t flags) = 0;
+	};
+
+	struct CaptureReplayStats
+	{
+		uint32_t Frames = 0;
+		uint64_t CommandLists = 0;
+		uint64_t Commands = 0;
+		uint64_t Submissions = 0;
+		uint64_t Signals = 0;
+		uint64_t Waits = 0;
+		uint64_t CPUWaits = 0;
+		uint64_t Presents = 0;
+
+		//Waits for values signaled before the capture began, the work is not in the capture
+		uint64_t SkippedWaits = 0;
+
+		//Signals that didn't get the value of the capture and waits for values that were never signaled (skipped, they would hang).
+		//Only a capture that misses a signal (a fence used behind the back of HT::CaptureQueueBackend) has them.
+		uint64_t FenceMismatches = 0;
+
+		uint64_t ReplayNs = 0;
+	};
+
+	//Replays the whole capture: the lists come from a HT::CommandPool per queue on pools, are recorded by recorder and executed (and synced) on queues
+	//in the order of the capture, without waiting for anything but the fences. At the end every queue is idle.
+	//False (and the reason in outError) if the capture is malformed, what was replayed up to there was still executed.
+	bool ReplayCommandCapture(const CommandCaptureReader& capture, ICommandQueueBackend* queues, ICommandPoolBackend* pools, ICaptureCommandRecorder* recorder,
+		CaptureReplayStats& outStats, std::string& outError);
+}
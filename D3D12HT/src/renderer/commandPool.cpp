@@ -0,0 +1,155 @@
+#include "commandPool.h"
+
+#include <algorithm>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	const char* CommandQueueTypeName(CommandQueueType type)
+	{
+		switch (type)
+		{
+		case CommandQueueType::Direct:  return "Direct";
+		case CommandQueueType::Compute: return "Compute";
+		case CommandQueueType::Copy:    return "Copy";
+		default:                        return "Unknown";
+		}
+	}
+
+	void* CPUCommandPoolBackend::CreateAllocator(CommandQueueType /*type*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LiveAllocators++;
+		return (void*)(m_NextId++);
+	}
+
+	void CPUCommandPoolBackend::ResetAllocator(void* /*allocator*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_AllocatorResets++;
+	}
+
+	void CPUCommandPoolBackend::DestroyAllocator(void* /*allocator*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LiveAllocators--;
+	}
+
+	void* CPUCommandPoolBackend::CreateCommandList(CommandQueueType /*type*/, void* /*allocator*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LiveCommandLists++;
+		return (void*)(m_NextId++);
+	}
+
+	void CPUCommandPoolBackend::ResetCommandList(void* /*commandList*/, void* /*allocator*/)
+	{
+	}
+
+	void CPUCommandPoolBackend::DestroyCommandList(void* /*commandList*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LiveCommandLists--;
+	}
+
+	CommandPool::CommandPool(ICommandPoolBackend* backend, CommandQueueType type, IFence* fence) : m_Backend(backend), m_Type(type), m_Fence(fence)
+	{
+		D3D_ASSERT(backend && fence, "A command pool needs a backend and the fence of its queue!");
+	}
+
+	CommandPool::~CommandPool()
+	{
+		D3D_ASSERT(m_Stats.AllocatorsInUse == (uint32_t)m_PendingAllocators.size(), "Destroying a command pool with acquired lists!");
+
+		for (void* commandList : m_AllCommandLists)
+			m_Backend->DestroyCommandList(commandList);
+
+		for (void* allocator : m_AllAllocators)
+			m_Backend->DestroyAllocator(allocator);
+	}
+
+	PooledCommandList CommandPool::Acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		Recycle();
+
+		PooledCommandList commandList;
+		commandList.Type = m_Type;
+
+		if (!m_FreeAllocators.empty())
+		{
+			commandList.NativeAllocator = m_FreeAllocators.back();
+			m_FreeAllocators.pop_back();
+
+			//The GPU is done with it, so its memory can be reused
+			m_Backend->ResetAllocator(commandList.NativeAllocator);
+		}
+		else
+		{
+			commandList.NativeAllocator = m_Backend->CreateAllocator(m_Type);
+			m_AllAllocators.push_back(commandList.NativeAllocator);
+			m_Stats.AllocatorCount++;
+		}
+
+		if (!m_FreeCommandLists.empty())
+		{
+			commandList.NativeCommandList = m_FreeCommandLists.back();
+			m_FreeCommandLists.pop_back();
+
+			m_Backend->ResetCommandList(commandList.NativeCommandList, commandList.NativeAllocator);
+		}
+		else
+		{
+			commandList.NativeCommandList = m_Backend->CreateCommandList(m_Type, commandList.NativeAllocator);
+			m_AllCommandLists.push_back(commandList.NativeCommandList);
+			m_Stats.CommandListCount++;
+		}
+
+		m_Stats.AcquireCount++;
+		m_Stats.AllocatorsInUse++;
+		m_Stats.PeakAllocatorsInUse = HTUtils::HTMax(m_Stats.PeakAllocatorsInUse, m_Stats.AllocatorsInUse);
+
+		return commandList;
+	}
+
+	void CommandPool::Release(const PooledCommandList& commandList, uint64_t fenceValue)
+	{
+		D3D_ASSERT(commandList.IsValid() && commandList.Type == m_Type, "Releasing a list that doesn't belong to this pool!");
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_FreeCommandLists.push_back(commandList.NativeCommandList);
+
+		//The values signaled on a queue only go up, but two threads may release in any order, so we insert it sorted (almost always at the back).
+		auto position = std::upper_bound(m_PendingAllocators.begin(), m_PendingAllocators.end(), fenceValue,
+			[](uint64_t value, const PendingAllocator& pending) { return value < pending.FenceValue; });
+
+		m_PendingAllocators.insert(position, { commandList.NativeAllocator, fenceValue });
+	}
+
+	CommandPoolStats CommandPool::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	void CommandPool::Recycle()
+	{
+		if (m_PendingAllocators.empty())
+			return;
+
+		uint64_t completedValue = m_Fence->GetCompletedValue();
+
+		while (!m_PendingAllocators.empty() && m_PendingAllocators.front().FenceValue <= completedValue)
+		{
+			m_FreeAllocators.push_back(m_PendingAllocators.front().Allocator);
+			m_PendingAllocators.pop_front();
+
+			m_Stats.AllocatorsInUse--;
+			m_Stats.RecycleCount++;
+		}
+	}
+}
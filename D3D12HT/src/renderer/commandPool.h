@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//The queues we submit to. Each queue type needs its own allocators and lists (a compute list can't be executed by a copy queue, for instance).
+	//PS: not the same values as D3D12_COMMAND_LIST_TYPE, which also has bundles.
+	enum class CommandQueueType : uint8_t
+	{
+		Direct = 0,
+		Compute,
+		Copy,
+
+		Count
+	};
+
+	const char* CommandQueueTypeName(CommandQueueType type);
+
+	//An allocator and the list recording into it. The natives are whatever the backend uses (ID3D12CommandAllocator* and ID3D12GraphicsCommandList* for D3D12).
+	struct PooledCommandList
+	{
+		void* NativeAllocator   = nullptr;
+		void* NativeCommandList = nullptr;
+		CommandQueueType Type   = CommandQueueType::Direct;
+
+		inline bool IsValid() const { return NativeCommandList != nullptr; }
+	};
+
+	//The only things the pool needs from the device. Keeping the recycling policy behind this lets us test it without a device (see HT::CPUCommandPoolBackend).
+	class ICommandPoolBackend
+	{
+	public:
+		virtual ~ICommandPoolBackend() = default;
+
+		virtual void* CreateAllocator(CommandQueueType type) = 0;
+		virtual void ResetAllocator(void* allocator) = 0;
+		virtual void DestroyAllocator(void* allocator) = 0;
+
+		//The list must be returned open (recording into allocator), like ID3D12Device::CreateCommandList does.
+		virtual void* CreateCommandList(CommandQueueType type, void* allocator) = 0;
+		virtual void ResetCommandList(void* commandList, void* allocator) = 0;
+		virtual void DestroyCommandList(void* commandList) = 0;
+	};
+
+	//Allocators and lists made of fake ids. It counts the resets, so we can check what the policy does.
+	class CPUCommandPoolBackend : public ICommandPoolBackend
+	{
+	public:
+		void* CreateAllocator(CommandQueueType type) override;
+		void ResetAllocator(void* allocator) override;
+		void DestroyAllocator(void* allocator) override;
+
+		void* CreateCommandList(CommandQueueType type, void* allocator) override;
+		void ResetCommandList(void* commandList, void* allocator) override;
+		void DestroyCommandList(void* commandList) override;
+
+		inline uint32_t GetLiveAllocatorCount()   const { return m_LiveAllocators; }
+		inline uint32_t GetLiveCommandListCount() const { return m_LiveCommandLists; }
+		inline uint64_t GetAllocatorResetCount()  const { return m_AllocatorResets; }
+
+	private:
+		std::mutex m_Mutex;
+		uintptr_t m_NextId = 1;
+		uint32_t m_LiveAllocators   = 0;
+		uint32_t m_LiveCommandLists = 0;
+		uint64_t m_AllocatorResets  = 0;
+	};
+
+	struct CommandPoolStats
+	{
+		uint32_t AllocatorCount  = 0;
+		uint32_t CommandListCount = 0;
+
+		//Acquired and not released yet, or released and waiting for their fence
+		uint32_t AllocatorsInUse     = 0;
+		uint32_t PeakAllocatorsInUse = 0;
+
+		uint64_t AcquireCount = 0;
+		uint64_t RecycleCount = 0;
+	};
+
+	//Hands out allocators and lists of a queue type on demand.
+	//Before, we had one allocator per frame slot, so a frame could only record on one list and a thread had to wait for a slot to get an allocator.
+	//Now anyone (any thread) can Acquire as many lists as it needs. Once the lists are submitted, they are released with the fence value signaled after them:
+	//- The list goes back right away, a list can be reset as soon as it was submitted.
+	//- The allocator only goes back once the fence reaches that value, the GPU reads the commands from the allocator memory.
+	//The pool only grows, the size it reaches is the peak usage of the application.
+	//
+	//The fence is an IFence, so the recycling can be driven by a CPUFence when there is no GPU.
+	class CommandPool
+	{
+	public:
+		CommandPool(ICommandPoolBackend* backend, CommandQueueType type, IFence* fence);
+		~CommandPool();
+
+		CommandPool(const CommandPool&) = delete;
+		CommandPool& operator=(const CommandPool&) = delete;
+
+		//Returns an open list, recording into an allocator the GPU is done with. Thread safe.
+		PooledCommandList Acquire();
+
+		//fenceValue is the value signaled on the queue after the list was submitted. A list that was never submitted can be released with 0. Thread safe.
+		void Release(const PooledCommandList& commandList, uint64_t fenceValue);
+
+		CommandPoolStats GetStats() const;
+		inline CommandQueueType GetType() const { return m_Type; }
+		inline IFence* GetFence() const { return m_Fence; }
+
+	private:
+		struct PendingAllocator
+		{
+			void* Allocator;
+			uint64_t FenceValue;
+		};
+
+		//Moves the allocators whose fence completed to the free list
+		void Recycle();
+
+	private:
+		ICommandPoolBackend* m_Backend;
+		CommandQueueType m_Type;
+		IFence* m_Fence;
+
+		mutable std::mutex m_Mutex;
+
+		//Ordered by fence value, so we only have to look at the front
+		std::deque<PendingAllocator> m_PendingAllocators;
+		std::vector<void*> m_FreeAllocators;
+		std::vector<void*> m_FreeCommandLists;
+
+		std::vector<void*> m_AllAllocators;
+		std::vector<void*> m_AllCommandLists;
+
+		CommandPoolStats m_Stats;
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//A fence where the "GPU" is whoever calls Complete(). 
+	//We use it to drive the frame pacing and allocators without a device: a test (or the null backend) decides when each value is reached.
+	//It can be completed from another thread (WaitForValue will block until it happens) or, for single-threaded simulations, 
+	//a wait handler can be set. The handler is called when someone is going to block and it is expected to complete the value (e.g: advance a simulated GPU clock).
+	class CPUFence : public IFence
+	{
+	public:
+		using WaitHandler = std::function<void(CPUFence& fence, uint64_t value)>;
+
+		CPUFence() = default;
+
+		uint64_t Signal() override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return ++m_SignaledValue;
+		}
+
+		uint64_t GetCompletedValue() const override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_CompletedValue;
+		}
+
+		uint64_t GetLastSignaledValue() const override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_SignaledValue;
+		}
+
+		void WaitForValue(uint64_t value) override
+		{
+			if (IsComplete(value))
+				return;
+
+			m_WaitCount++;
+
+			if (m_WaitHandler)
+				m_WaitHandler(*this, value);
+
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this, value]() { return m_CompletedValue >= value; });
+		}
+
+		//Simulates the queue reaching a value. Values never go backwards, like a real fence.
+		void Complete(uint64_t value)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+
+				if (value > m_CompletedValue)
+					m_CompletedValue = value;
+			}
+
+			m_Condition.notify_all();
+		}
+
+		//Complete everything that was signaled so far.
+		inline void CompleteAll() { Complete(GetLastSignaledValue()); }
+
+		inline void SetWaitHandler(WaitHandler handler) { m_WaitHandler = std::move(handler); }
+
+		//How many times a WaitForValue had to block. Useful to check that a pacing policy stalls when (and only when) it should.
+		inline uint64_t GetWaitCount() const { return m_WaitCount.load(); }
+
+	private:
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+
+		uint64_t m_SignaledValue  = 0;
+		uint64_t m_CompletedValue = 0;
+
+		std::atomic<uint64_t> m_WaitCount = 0;
+
+		WaitHandler m_WaitHandler;
+	};
+}
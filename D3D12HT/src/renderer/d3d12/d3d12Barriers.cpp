@@ -0,0 +1,54 @@
+#include "d3d12Barriers.h"
+
+namespace HT
+{
+	void SubmitBarriers(ID3D12GraphicsCommandList* commandList, const std::vector<ResourceBarrier>& barriers)
+	{
+		if (barriers.empty())
+			return;
+
+		//Most batches are small, so we translate them on the stack and only go to the heap for the big ones
+		const uint32_t stackCapacity = 32;
+		D3D12_RESOURCE_BARRIER stackBarriers[stackCapacity];
+		std::vector<D3D12_RESOURCE_BARRIER> heapBarriers;
+
+		D3D12_RESOURCE_BARRIER* d3dBarriers = stackBarriers;
+		if (barriers.size() > stackCapacity)
+		{
+			heapBarriers.resize(barriers.size());
+			d3dBarriers = heapBarriers.data();
+		}
+
+		for (size_t i = 0; i < barriers.size(); i++)
+		{
+			const ResourceBarrier& barrier = barriers[i];
+			D3D12_RESOURCE_BARRIER& d3dBarrier = d3dBarriers[i];
+
+			d3dBarrier = {};
+			d3dBarrier.Flags = (D3D12_RESOURCE_BARRIER_FLAGS)barrier.Flags;
+
+			if (barrier.Type == BarrierType::UAV)
+			{
+				d3dBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+				d3dBarrier.UAV.pResource = ToD3D12Resource(barrier.Resource);
+			}
+			else if (barrier.Type == BarrierType::Aliasing)
+			{
+				//We don't know which resource used the memory before, null means any placed resource of the heap
+				d3dBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+				d3dBarrier.Aliasing.pResourceBefore = nullptr;
+				d3dBarrier.Aliasing.pResourceAfter = ToD3D12Resource(barrier.Resource);
+			}
+			else
+			{
+				d3dBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+				d3dBarrier.Transition.pResource = ToD3D12Resource(barrier.Resource);
+				d3dBarrier.Transition.StateBefore = (D3D12_RESOURCE_STATES)barrier.Before;
+				d3dBarrier.Transition.StateAfter = (D3D12_RESOURCE_STATES)barrier.After;
+				d3dBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			}
+		}
+
+		commandList->ResourceBarrier((UINT)barriers.size(), d3dBarriers);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include <d3d12.h>
+
+#include <renderer/resourceStateTracker.h>
+
+namespace HT
+{
+	//For D3D12 the id of a resource is just its pointer
+	inline ResourceId ToResourceId(ID3D12Resource* resource)
+	{
+		return (ResourceId)(uintptr_t)resource;
+	}
+
+	inline ID3D12Resource* ToD3D12Resource(ResourceId resource)
+	{
+		return (ID3D12Resource*)(uintptr_t)resource;
+	}
+
+	//Translate the barriers generated by a tracker and submit all of them with a single ResourceBarrier call.
+	void SubmitBarriers(ID3D12GraphicsCommandList* commandList, const std::vector<ResourceBarrier>& barriers);
+}
@@ -0,0 +1,49 @@
+#include "d3d12CommandPoolBackend.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12CommandPoolBackend::D3D12CommandPoolBackend(ID3D12Device* device) : m_Device(device)
+	{
+		D3D_ASSERT(device, "D3D12CommandPoolBackend needs a device!");
+	}
+
+	void* D3D12CommandPoolBackend::CreateAllocator(CommandQueueType type)
+	{
+		ID3D12CommandAllocator* allocator = nullptr;
+		Check(m_Device->CreateCommandAllocator(ToD3D12CommandListType(type), IID_PPV_ARGS(&allocator)), "Failed to create a command allocator!");
+
+		return allocator;
+	}
+
+	void D3D12CommandPoolBackend::ResetAllocator(void* allocator)
+	{
+		Check(static_cast<ID3D12CommandAllocator*>(allocator)->Reset(), "Failed to reset a command allocator!");
+	}
+
+	void D3D12CommandPoolBackend::DestroyAllocator(void* allocator)
+	{
+		static_cast<ID3D12CommandAllocator*>(allocator)->Release();
+	}
+
+	void* D3D12CommandPoolBackend::CreateCommandList(CommandQueueType type, void* allocator)
+	{
+		ID3D12GraphicsCommandList* commandList = nullptr;
+		Check(m_Device->CreateCommandList(0, ToD3D12CommandListType(type), static_cast<ID3D12CommandAllocator*>(allocator), nullptr, IID_PPV_ARGS(&commandList)), 
+			"Failed to create a command list!");
+
+		return commandList;
+	}
+
+	void D3D12CommandPoolBackend::ResetCommandList(void* commandList, void* allocator)
+	{
+		Check(static_cast<ID3D12GraphicsCommandList*>(commandList)->Reset(static_cast<ID3D12CommandAllocator*>(allocator), nullptr), "Failed to reset a command list!");
+	}
+
+	void D3D12CommandPoolBackend::DestroyCommandList(void* commandList)
+	{
+		static_cast<ID3D12GraphicsCommandList*>(commandList)->Release();
+	}
+}
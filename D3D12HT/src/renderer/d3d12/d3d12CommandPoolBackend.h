@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/commandPool.h>
+
+namespace HT
+{
+	class D3D12CommandPoolBackend : public ICommandPoolBackend
+	{
+	public:
+		explicit D3D12CommandPoolBackend(ID3D12Device* device);
+
+		void* CreateAllocator(CommandQueueType type) override;
+		void ResetAllocator(void* allocator) override;
+		void DestroyAllocator(void* allocator) override;
+
+		void* CreateCommandList(CommandQueueType type, void* allocator) override;
+		void ResetCommandList(void* commandList, void* allocator) override;
+		void DestroyCommandList(void* commandList) override;
+
+	private:
+		ID3D12Device* m_Device;
+	};
+
+	inline D3D12_COMMAND_LIST_TYPE ToD3D12CommandListType(CommandQueueType type)
+	{
+		switch (type)
+		{
+		case CommandQueueType::Compute: return D3D12_COMMAND_LIST_TYPE_COMPUTE;
+		case CommandQueueType::Copy:    return D3D12_COMMAND_LIST_TYPE_COPY;
+		default:                        return D3D12_COMMAND_LIST_TYPE_DIRECT;
+		}
+	}
+
+	//Compute and copy lists are also created as graphics command lists, they just can't record the graphics commands.
+	inline ID3D12GraphicsCommandList* ToD3D12CommandList(const PooledCommandList& commandList)
+	{
+		return static_cast<ID3D12GraphicsCommandList*>(commandList.NativeCommandList);
+	}
+}
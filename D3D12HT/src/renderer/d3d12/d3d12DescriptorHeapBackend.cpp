@@ -0,0 +1,50 @@
+#include "d3d12DescriptorHeapBackend.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12DescriptorHeapBackend::D3D12DescriptorHeapBackend(ID3D12Device* device) : m_Device(device)
+	{
+		D3D_ASSERT(device, "D3D12DescriptorHeapBackend needs a device!");
+
+		for (uint32_t i = 0; i < (uint32_t)DescriptorHeapType::Count; i++)
+			m_IncrementSizes[i] = m_Device->GetDescriptorHandleIncrementSize((D3D12_DESCRIPTOR_HEAP_TYPE)i);
+	}
+
+	DescriptorHeapInfo D3D12DescriptorHeapBackend::CreateHeap(DescriptorHeapType type, uint32_t numDescriptors, bool shaderVisible)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.NumDescriptors = numDescriptors;
+		heapDesc.Type = (D3D12_DESCRIPTOR_HEAP_TYPE)type;
+		heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		heapDesc.NodeMask = 0;
+
+		ID3D12DescriptorHeap* heap = nullptr;
+		Check(m_Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap)), "Failed to create a descriptor heap!");
+
+		DescriptorHeapInfo info;
+		info.NativeHeap = heap;
+		info.NumDescriptors = numDescriptors;
+		info.IncrementSize = m_IncrementSizes[(uint32_t)type];
+		info.Start.CPU = heap->GetCPUDescriptorHandleForHeapStart().ptr;
+
+		//Asking a non shader visible heap for its GPU handle is an error in the debug layer
+		if (shaderVisible)
+			info.Start.GPU = heap->GetGPUDescriptorHandleForHeapStart().ptr;
+
+		return info;
+	}
+
+	void D3D12DescriptorHeapBackend::DestroyHeap(const DescriptorHeapInfo& heap)
+	{
+		if (heap.NativeHeap)
+			ToD3D12Heap(heap)->Release();
+	}
+
+	void D3D12DescriptorHeapBackend::CopyDescriptors(DescriptorHeapType type, DescriptorHandle destination, DescriptorHandle source, uint32_t count)
+	{
+		m_Device->CopyDescriptorsSimple(count, ToD3D12CPUHandle(destination), ToD3D12CPUHandle(source), (D3D12_DESCRIPTOR_HEAP_TYPE)type);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/descriptorHeap.h>
+
+namespace HT
+{
+	class D3D12DescriptorHeapBackend : public IDescriptorHeapBackend
+	{
+	public:
+		explicit D3D12DescriptorHeapBackend(ID3D12Device* device);
+
+		DescriptorHeapInfo CreateHeap(DescriptorHeapType type, uint32_t numDescriptors, bool shaderVisible) override;
+		void DestroyHeap(const DescriptorHeapInfo& heap) override;
+		void CopyDescriptors(DescriptorHeapType type, DescriptorHandle destination, DescriptorHandle source, uint32_t count) override;
+
+	private:
+		ID3D12Device* m_Device;
+
+		//Descriptor sizes are vendor specific, so we query them once
+		uint32_t m_IncrementSizes[(uint32_t)DescriptorHeapType::Count];
+	};
+
+	inline D3D12_CPU_DESCRIPTOR_HANDLE ToD3D12CPUHandle(DescriptorHandle handle)
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE d3dHandle = { (SIZE_T)handle.CPU };
+		return d3dHandle;
+	}
+
+	inline D3D12_GPU_DESCRIPTOR_HANDLE ToD3D12GPUHandle(DescriptorHandle handle)
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE d3dHandle = { handle.GPU };
+		return d3dHandle;
+	}
+
+	inline ID3D12DescriptorHeap* ToD3D12Heap(const DescriptorHeapInfo& heap)
+	{
+		return static_cast<ID3D12DescriptorHeap*>(heap.NativeHeap);
+	}
+}
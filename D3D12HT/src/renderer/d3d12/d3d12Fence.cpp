@@ -0,0 +1,40 @@
+#include "d3d12Fence.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12Fence::D3D12Fence(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, uint64_t* fenceValue, HANDLE fenceEvent)
+		: m_CommandQueue(commandQueue), m_Fence(fence), m_FenceValue(fenceValue), m_FenceEvent(fenceEvent)
+	{
+		D3D_ASSERT(commandQueue && fence && fenceValue && fenceEvent, "D3D12Fence needs a queue, a fence, a counter and an event!");
+	}
+
+	uint64_t D3D12Fence::Signal()
+	{
+		uint64_t fenceValueForSignal = ++(*m_FenceValue);
+		Check(m_CommandQueue->Signal(m_Fence, fenceValueForSignal));
+
+		return fenceValueForSignal;
+	}
+
+	uint64_t D3D12Fence::GetCompletedValue() const
+	{
+		return m_Fence->GetCompletedValue();
+	}
+
+	uint64_t D3D12Fence::GetLastSignaledValue() const
+	{
+		return *m_FenceValue;
+	}
+
+	void D3D12Fence::WaitForValue(uint64_t value)
+	{
+		if (m_Fence->GetCompletedValue() < value)
+		{
+			Check(m_Fence->SetEventOnCompletion(value, m_FenceEvent));
+			::WaitForSingleObject(m_FenceEvent, INFINITE);
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//IFence on top of an ID3D12Fence signaled by a command queue.
+	//It doesn't own anything, it just uses the fence, the CPU fence counter and the event we created in main. This way the Signal/Wait/Flush 
+	//helpers there and this class are always in sync (they increment the same counter).
+	class D3D12Fence : public IFence
+	{
+	public:
+		D3D12Fence(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, uint64_t* fenceValue, HANDLE fenceEvent);
+
+		uint64_t Signal() override;
+		uint64_t GetCompletedValue() const override;
+		uint64_t GetLastSignaledValue() const override;
+		void WaitForValue(uint64_t value) override;
+
+		inline ID3D12Fence* GetNativeFence() const { return m_Fence; }
+
+	private:
+		ID3D12CommandQueue* m_CommandQueue;
+		ID3D12Fence* m_Fence;
+		uint64_t* m_FenceValue;
+		HANDLE m_FenceEvent;
+	};
+}
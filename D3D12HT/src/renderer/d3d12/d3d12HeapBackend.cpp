@@ -0,0 +1,60 @@
+#include "d3d12HeapBackend.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12HeapBackend::D3D12HeapBackend(ID3D12Device* device) : m_Device(device)
+	{
+		D3D_ASSERT(device, "D3D12HeapBackend needs a device!");
+	}
+
+	void* D3D12HeapBackend::CreateHeap(const GPUHeapDesc& desc)
+	{
+		static const D3D12_HEAP_TYPE heapTypes[] = { D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_TYPE_UPLOAD, D3D12_HEAP_TYPE_READBACK };
+		static const D3D12_HEAP_FLAGS heapFlags[] = { D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES };
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = desc.Size;
+		heapDesc.Properties.Type = heapTypes[(uint32_t)desc.Type];
+		heapDesc.Alignment = desc.Alignment;
+		heapDesc.Flags = heapFlags[(uint32_t)desc.Category];
+
+		ID3D12Heap* heap = nullptr;
+		if (FAILED(m_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap))))
+			return nullptr;
+
+		return heap;
+	}
+
+	void D3D12HeapBackend::DestroyHeap(void* heap)
+	{
+		static_cast<ID3D12Heap*>(heap)->Release();
+	}
+
+	ID3D12Resource* CreatePlacedResource(ID3D12Device* device, GPUHeapAllocator& allocator, GPUHeapType type, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GPUAllocation& outAllocation)
+	{
+		GPUHeapCategory category = GPUHeapCategory::Buffers;
+		if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			bool renderTarget = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+			category = renderTarget ? GPUHeapCategory::RenderTargets : GPUHeapCategory::Textures;
+		}
+
+		D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+		if (info.SizeInBytes == UINT64_MAX)
+			return nullptr;
+
+		outAllocation = allocator.Allocate(info.SizeInBytes, info.Alignment, type, category);
+		if (!outAllocation.IsValid())
+			return nullptr;
+
+		ID3D12Resource* resource = nullptr;
+		Check(device->CreatePlacedResource(ToD3D12Heap(outAllocation), outAllocation.Offset, &desc, initialState, clearValue, IID_PPV_ARGS(&resource)),
+			"Failed to create a placed resource!");
+
+		return resource;
+	}
+}
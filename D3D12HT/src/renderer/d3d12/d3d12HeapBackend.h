@@ -0,0 +1,32 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/gpuHeapAllocator.h>
+
+namespace HT
+{
+	//The native heaps are ID3D12Heap*
+	class D3D12HeapBackend : public IGPUHeapBackend
+	{
+	public:
+		explicit D3D12HeapBackend(ID3D12Device* device);
+
+		//Returns null if the heap can't be created (out of memory), the allocator gives an invalid allocation then
+		void* CreateHeap(const GPUHeapDesc& desc) override;
+		void DestroyHeap(void* heap) override;
+
+	private:
+		ID3D12Device* m_Device;
+	};
+
+	//Allocates the memory of the resource in the heap allocator (with the size and alignment the device asks for) and places the resource there.
+	//Returns null if there is no memory. The allocation must be freed after the resource is released (both once the GPU is done with them).
+	ID3D12Resource* CreatePlacedResource(ID3D12Device* device, GPUHeapAllocator& allocator, GPUHeapType type, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GPUAllocation& outAllocation);
+
+	inline ID3D12Heap* ToD3D12Heap(const GPUAllocation& allocation)
+	{
+		return static_cast<ID3D12Heap*>(allocation.NativeHeap);
+	}
+}
@@ -0,0 +1,68 @@
+#include "d3d12ParallelRecorder.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	D3D12ParallelRecorder::D3D12ParallelRecorder(CommandPool* commandPool, uint32_t maxChunks) : m_CommandPool(commandPool), m_MaxChunks(maxChunks)
+	{
+		D3D_ASSERT(commandPool && maxChunks > 0, "The parallel recorder needs a command pool and at least one chunk!");
+		D3D_ASSERT(commandPool->GetType() == CommandQueueType::Direct, "The draws can only be recorded on direct lists!");
+
+		m_CommandLists.resize(maxChunks);
+	}
+
+	uint32_t D3D12ParallelRecorder::Record(JobSystem& jobSystem, uint32_t itemCount, uint32_t minItemsPerChunk, const RecordFunction& record)
+	{
+		D3D_ASSERT(m_ChunkCount == 0, "The lists of the last Record were not released!");
+
+		if (itemCount == 0)
+			return 0;
+
+		//Few big chunks. More chunks than threads would only give us more lists to submit.
+		minItemsPerChunk = HTUtils::HTMax(minItemsPerChunk, 1u);
+		uint32_t chunkCount = HTUtils::HTMin((itemCount + minItemsPerChunk - 1) / minItemsPerChunk, m_MaxChunks);
+		uint32_t itemsPerChunk = (itemCount + chunkCount - 1) / chunkCount;
+
+		//With the rounding, the last chunks may end up empty
+		chunkCount = (itemCount + itemsPerChunk - 1) / itemsPerChunk;
+		m_ChunkCount = chunkCount;
+
+		JobCounter counter;
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			jobSystem.Run([this, &record, chunk, itemsPerChunk, itemCount]()
+			{
+				//The pool is thread safe, every job takes its list without waiting for a frame slot
+				m_CommandLists[chunk] = m_CommandPool->Acquire();
+
+				uint32_t begin = chunk * itemsPerChunk;
+				uint32_t end = HTUtils::HTMin(begin + itemsPerChunk, itemCount);
+				record(ToD3D12CommandList(m_CommandLists[chunk]), begin, end);
+			}, &counter);
+		}
+
+		jobSystem.Wait(counter);
+		return chunkCount;
+	}
+
+	void D3D12ParallelRecorder::Close(std::vector<ID3D12CommandList*>& outCommandLists)
+	{
+		for (uint32_t i = 0; i < m_ChunkCount; i++)
+		{
+			ID3D12GraphicsCommandList* commandList = ToD3D12CommandList(m_CommandLists[i]);
+			Check(commandList->Close());
+			outCommandLists.push_back(commandList);
+		}
+	}
+
+	void D3D12ParallelRecorder::Release(uint64_t fenceValue)
+	{
+		for (uint32_t i = 0; i < m_ChunkCount; i++)
+			m_CommandPool->Release(m_CommandLists[i], fenceValue);
+
+		m_ChunkCount = 0;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <d3d12.h>
+
+#include <core/jobSystem.h>
+#include <renderer/d3d12/d3d12CommandPoolBackend.h>
+
+namespace HT
+{
+	//Records the draws of a frame on several threads. 
+	//A command list can only be recorded by one thread at a time, so we split the draws in ordered chunks and each chunk gets its own command list 
+	//(and allocator, an allocator can't be used by two lists recording at the same time either). Each chunk is recorded by a job.
+	//The lists are indexed by chunk and not by thread, so no matter which thread recorded what, they are always submitted in the order of the draws.
+	//
+	//The lists come from a HT::CommandPool, the jobs acquire them on their own threads and they are released with the fence of the frame.
+	class D3D12ParallelRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(ID3D12GraphicsCommandList* commandList, uint32_t begin, uint32_t end)>;
+
+		D3D12ParallelRecorder(CommandPool* commandPool, uint32_t maxChunks);
+
+		D3D12ParallelRecorder(const D3D12ParallelRecorder&) = delete;
+		D3D12ParallelRecorder& operator=(const D3D12ParallelRecorder&) = delete;
+
+		//Splits [0, itemCount) in chunks of at least minItemsPerChunk items and records them in parallel. Returns the number of chunks.
+		//The lists are left open, so more commands can be added to the last one after the draws (e.g: the barrier to present).
+		uint32_t Record(JobSystem& jobSystem, uint32_t itemCount, uint32_t minItemsPerChunk, const RecordFunction& record);
+
+		inline ID3D12GraphicsCommandList* GetLastCommandList() const { return m_ChunkCount ? ToD3D12CommandList(m_CommandLists[m_ChunkCount - 1]) : nullptr; }
+
+		//Closes the lists recorded this frame and appends them, in order, to outCommandLists
+		void Close(std::vector<ID3D12CommandList*>& outCommandLists);
+
+		//Gives the lists back to the pool once they were submitted. fenceValue is the value signaled after them.
+		void Release(uint64_t fenceValue);
+
+	private:
+		CommandPool* m_CommandPool;
+		uint32_t m_MaxChunks;
+		uint32_t m_ChunkCount = 0;
+
+		//[chunk]
+		std::vector<PooledCommandList> m_CommandLists;
+	};
+}
@@ -0,0 +1,241 @@
+#include "d3d12PipelineBackend.h"
+
+#include <cstring>
+#include <cwchar>
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	namespace
+	{
+		D3D12_SHADER_BYTECODE ToD3D12Bytecode(const PipelineShader& shader)
+		{
+			D3D12_SHADER_BYTECODE bytecode = {};
+			if (shader.IsValid())
+			{
+				bytecode.pShaderBytecode = shader.Bytecode->data();
+				bytecode.BytecodeLength = shader.Bytecode->size();
+			}
+
+			return bytecode;
+		}
+
+		//The inverse of BuildD3D12GraphicsState. The input elements point to the names inside the desc, so it must live while the D3D12 desc is used.
+		void ToD3D12GraphicsDesc(const PipelineDesc& desc, D3D12_GRAPHICS_PIPELINE_STATE_DESC& outDesc, std::vector<D3D12_INPUT_ELEMENT_DESC>& outElements)
+		{
+			D3D_ASSERT(desc.FixedFunctionState.size() >= sizeof(D3D12PipelineGraphicsState), "The desc doesn't have a D3D12 graphics state!");
+
+			const D3D12PipelineGraphicsState* state = reinterpret_cast<const D3D12PipelineGraphicsState*>(desc.FixedFunctionState.data());
+			const D3D12PipelineInputElement* elements = reinterpret_cast<const D3D12PipelineInputElement*>(state + 1);
+
+			outElements.resize(state->InputElementCount);
+			for (uint32_t i = 0; i < state->InputElementCount; i++)
+			{
+				outElements[i].SemanticName         = elements[i].SemanticName;
+				outElements[i].SemanticIndex        = elements[i].SemanticIndex;
+				outElements[i].Format               = elements[i].Format;
+				outElements[i].InputSlot            = elements[i].InputSlot;
+				outElements[i].AlignedByteOffset    = elements[i].AlignedByteOffset;
+				outElements[i].InputSlotClass       = elements[i].InputSlotClass;
+				outElements[i].InstanceDataStepRate = elements[i].InstanceDataStepRate;
+			}
+
+			outDesc = {};
+			outDesc.pRootSignature = static_cast<ID3D12RootSignature*>(desc.RootSignature);
+			outDesc.VS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Vertex]);
+			outDesc.HS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Hull]);
+			outDesc.DS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Domain]);
+			outDesc.GS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Geometry]);
+			outDesc.PS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Pixel]);
+			outDesc.BlendState = state->BlendState;
+			outDesc.SampleMask = state->SampleMask;
+			outDesc.RasterizerState = state->RasterizerState;
+			outDesc.DepthStencilState = state->DepthStencilState;
+			outDesc.InputLayout = { outElements.data(), (UINT)outElements.size() };
+			outDesc.IBStripCutValue = state->IBStripCutValue;
+			outDesc.PrimitiveTopologyType = state->PrimitiveTopologyType;
+			outDesc.NumRenderTargets = state->NumRenderTargets;
+			memcpy(outDesc.RTVFormats, state->RTVFormats, sizeof(outDesc.RTVFormats));
+			outDesc.DSVFormat = state->DSVFormat;
+			outDesc.SampleDesc = state->SampleDesc;
+			outDesc.NodeMask = state->NodeMask;
+			outDesc.Flags = state->Flags;
+		}
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC ToD3D12ComputeDesc(const PipelineDesc& desc)
+		{
+			D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc = {};
+			computeDesc.pRootSignature = static_cast<ID3D12RootSignature*>(desc.RootSignature);
+			computeDesc.CS = ToD3D12Bytecode(desc.Shaders[(uint32_t)ShaderStage::Compute]);
+			return computeDesc;
+		}
+
+		void ToLibraryName(uint64_t key, wchar_t (&outName)[17])
+		{
+			swprintf(outName, 17, L"%016llx", (unsigned long long)key);
+		}
+	}
+
+	std::vector<uint8_t> BuildD3D12GraphicsState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		D3D_ASSERT(desc.StreamOutput.NumEntries == 0, "Stream output is not supported by the pipeline cache!");
+
+		std::vector<uint8_t> bytes(sizeof(D3D12PipelineGraphicsState) + desc.InputLayout.NumElements * sizeof(D3D12PipelineInputElement), 0);
+
+		//The bytes start zeroed, so the padding (and the unused part of the names) is always the same
+		D3D12PipelineGraphicsState* state = reinterpret_cast<D3D12PipelineGraphicsState*>(bytes.data());
+		state->BlendState = desc.BlendState;
+		state->SampleMask = desc.SampleMask;
+		state->RasterizerState = desc.RasterizerState;
+		state->DepthStencilState = desc.DepthStencilState;
+		state->IBStripCutValue = desc.IBStripCutValue;
+		state->PrimitiveTopologyType = desc.PrimitiveTopologyType;
+		state->NumRenderTargets = desc.NumRenderTargets;
+		memcpy(state->RTVFormats, desc.RTVFormats, sizeof(state->RTVFormats));
+		state->DSVFormat = desc.DSVFormat;
+		state->SampleDesc = desc.SampleDesc;
+		state->NodeMask = desc.NodeMask;
+		state->Flags = desc.Flags;
+		state->InputElementCount = desc.InputLayout.NumElements;
+
+		D3D12PipelineInputElement* elements = reinterpret_cast<D3D12PipelineInputElement*>(state + 1);
+		for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+
+			D3D_ASSERT(strlen(element.SemanticName) < sizeof(elements[i].SemanticName), "Semantic name too long!");
+			strncpy(elements[i].SemanticName, element.SemanticName, sizeof(elements[i].SemanticName) - 1);
+
+			elements[i].SemanticIndex        = element.SemanticIndex;
+			elements[i].Format               = element.Format;
+			elements[i].InputSlot            = element.InputSlot;
+			elements[i].AlignedByteOffset    = element.AlignedByteOffset;
+			elements[i].InputSlotClass       = element.InputSlotClass;
+			elements[i].InstanceDataStepRate = element.InstanceDataStepRate;
+		}
+
+		return bytes;
+	}
+
+	D3D12PipelineBackend::D3D12PipelineBackend(ID3D12Device1* device) : m_Device(device)
+	{
+		D3D_ASSERT(device, "D3D12PipelineBackend needs a device!");
+	}
+
+	D3D12PipelineBackend::~D3D12PipelineBackend()
+	{
+		if (m_Library)
+			m_Library->Release();
+	}
+
+	void* D3D12PipelineBackend::CreatePipeline(const PipelineDesc& desc)
+	{
+		ID3D12PipelineState* pipeline = nullptr;
+		HRESULT result;
+
+		if (desc.Type == PipelineType::Compute)
+		{
+			D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc = ToD3D12ComputeDesc(desc);
+			result = m_Device->CreateComputePipelineState(&computeDesc, IID_PPV_ARGS(&pipeline));
+		}
+		else
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicsDesc;
+			std::vector<D3D12_INPUT_ELEMENT_DESC> elements;
+			ToD3D12GraphicsDesc(desc, graphicsDesc, elements);
+
+			result = m_Device->CreateGraphicsPipelineState(&graphicsDesc, IID_PPV_ARGS(&pipeline));
+		}
+
+		if (FAILED(result))
+		{
+			std::cout << "Failed to create the pipeline " << desc.DebugName << std::endl;
+			return nullptr;
+		}
+
+		return pipeline;
+	}
+
+	void D3D12PipelineBackend::DestroyPipeline(void* pipeline)
+	{
+		ToD3D12PipelineState(pipeline)->Release();
+	}
+
+	void D3D12PipelineBackend::InitializeLibrary(std::vector<uint8_t> data)
+	{
+		std::lock_guard<std::mutex> lock(m_LibraryMutex);
+
+		if (m_Library)
+		{
+			m_Library->Release();
+			m_Library = nullptr;
+		}
+
+		m_LibraryData = std::move(data);
+
+		//A library of another driver or adapter can't be used, we start an empty one and it will be filled again
+		if (m_LibraryData.empty() || FAILED(m_Device->CreatePipelineLibrary(m_LibraryData.data(), m_LibraryData.size(), IID_PPV_ARGS(&m_Library))))
+		{
+			m_LibraryData.clear();
+			Check(m_Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_Library)), "Failed to create a pipeline library!");
+		}
+	}
+
+	void* D3D12PipelineBackend::LoadFromLibrary(uint64_t key, const PipelineDesc& desc)
+	{
+		std::lock_guard<std::mutex> lock(m_LibraryMutex);
+
+		if (!m_Library)
+			return nullptr;
+
+		wchar_t name[17];
+		ToLibraryName(key, name);
+
+		ID3D12PipelineState* pipeline = nullptr;
+		HRESULT result;
+
+		//The desc must be the same one the pipeline was stored with, this is also how the library validates it
+		if (desc.Type == PipelineType::Compute)
+		{
+			D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc = ToD3D12ComputeDesc(desc);
+			result = m_Library->LoadComputePipeline(name, &computeDesc, IID_PPV_ARGS(&pipeline));
+		}
+		else
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicsDesc;
+			std::vector<D3D12_INPUT_ELEMENT_DESC> elements;
+			ToD3D12GraphicsDesc(desc, graphicsDesc, elements);
+
+			result = m_Library->LoadGraphicsPipeline(name, &graphicsDesc, IID_PPV_ARGS(&pipeline));
+		}
+
+		return SUCCEEDED(result) ? pipeline : nullptr;
+	}
+
+	void D3D12PipelineBackend::StoreInLibrary(uint64_t key, void* pipeline)
+	{
+		std::lock_guard<std::mutex> lock(m_LibraryMutex);
+
+		if (!m_Library)
+			return;
+
+		wchar_t name[17];
+		ToLibraryName(key, name);
+
+		//It fails if the name is already there, which is fine, the library already has it
+		m_Library->StorePipeline(name, ToD3D12PipelineState(pipeline));
+	}
+
+	bool D3D12PipelineBackend::SerializeLibrary(std::vector<uint8_t>& outData)
+	{
+		std::lock_guard<std::mutex> lock(m_LibraryMutex);
+
+		if (!m_Library)
+			return false;
+
+		outData.resize(m_Library->GetSerializedSize());
+		return SUCCEEDED(m_Library->Serialize(outData.data(), outData.size()));
+	}
+}
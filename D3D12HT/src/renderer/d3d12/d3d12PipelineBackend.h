@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <d3d12.h>
+
+#include <renderer/pipelineCache.h>
+
+namespace HT
+{
+	//The fixed function state of a D3D12 graphics pipeline without pointers, so it can be hashed and compared as bytes.
+	//It is followed by InputElementCount D3D12PipelineInputElement.
+	struct D3D12PipelineGraphicsState
+	{
+		D3D12_BLEND_DESC BlendState;
+		UINT SampleMask;
+		D3D12_RASTERIZER_DESC RasterizerState;
+		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+		D3D12_INDEX_BUFFER_STRIP_CUT_VALUE IBStripCutValue;
+		D3D12_PRIMITIVE_TOPOLOGY_TYPE PrimitiveTopologyType;
+		UINT NumRenderTargets;
+		DXGI_FORMAT RTVFormats[8];
+		DXGI_FORMAT DSVFormat;
+		DXGI_SAMPLE_DESC SampleDesc;
+		UINT NodeMask;
+		D3D12_PIPELINE_STATE_FLAGS Flags;
+		UINT InputElementCount;
+	};
+
+	struct D3D12PipelineInputElement
+	{
+		char SemanticName[32];
+		UINT SemanticIndex;
+		DXGI_FORMAT Format;
+		UINT InputSlot;
+		UINT AlignedByteOffset;
+		D3D12_INPUT_CLASSIFICATION InputSlotClass;
+		UINT InstanceDataStepRate;
+	};
+
+	//Flattens everything of the desc but the shaders, the root signature and the cached blob (those go in the HT::PipelineDesc).
+	//Stream output is not supported.
+	std::vector<uint8_t> BuildD3D12GraphicsState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	//Pipelines are ID3D12PipelineState* and the library is an ID3D12PipelineLibrary
+	class D3D12PipelineBackend : public IPipelineBackend
+	{
+	public:
+		explicit D3D12PipelineBackend(ID3D12Device1* device);
+		~D3D12PipelineBackend();
+
+		void* CreatePipeline(const PipelineDesc& desc) override;
+		void DestroyPipeline(void* pipeline) override;
+
+		void InitializeLibrary(std::vector<uint8_t> data) override;
+		void* LoadFromLibrary(uint64_t key, const PipelineDesc& desc) override;
+		void StoreInLibrary(uint64_t key, void* pipeline) override;
+		bool SerializeLibrary(std::vector<uint8_t>& outData) override;
+
+	private:
+		ID3D12Device1* m_Device;
+
+		//The library reads from the data it was created with, so we keep it while the library lives
+		std::mutex m_LibraryMutex;
+		ID3D12PipelineLibrary* m_Library = nullptr;
+		std::vector<uint8_t> m_LibraryData;
+	};
+
+	inline ID3D12PipelineState* ToD3D12PipelineState(void* pipeline)
+	{
+		return static_cast<ID3D12PipelineState*>(pipeline);
+	}
+}
@@ -0,0 +1,33 @@
+#include "d3d12QueueBackend.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12QueueBackend::D3D12QueueBackend(ID3D12CommandQueue* const (&queues)[(uint32_t)CommandQueueType::Count], D3D12Fence* const (&fences)[(uint32_t)CommandQueueType::Count])
+	{
+		for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+		{
+			D3D_ASSERT(queues[i] && fences[i], "D3D12QueueBackend needs a queue and a fence for every queue type!");
+
+			m_Queues[i] = queues[i];
+			m_Fences[i] = fences[i];
+		}
+	}
+
+	void D3D12QueueBackend::ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count)
+	{
+		m_Queues[(uint32_t)queue]->ExecuteCommandLists(count, reinterpret_cast<ID3D12CommandList* const*>(commandLists));
+	}
+
+	uint64_t D3D12QueueBackend::Signal(CommandQueueType queue)
+	{
+		return m_Fences[(uint32_t)queue]->Signal();
+	}
+
+	void D3D12QueueBackend::Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value)
+	{
+		Check(m_Queues[(uint32_t)queue]->Wait(m_Fences[(uint32_t)signalingQueue]->GetNativeFence(), value));
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/queueScheduler.h>
+#include <renderer/d3d12/d3d12Fence.h>
+
+namespace HT
+{
+	//The queues and the fences of each queue type. It doesn't own anything.
+	class D3D12QueueBackend : public ICommandQueueBackend
+	{
+	public:
+		D3D12QueueBackend(ID3D12CommandQueue* const (&queues)[(uint32_t)CommandQueueType::Count], D3D12Fence* const (&fences)[(uint32_t)CommandQueueType::Count]);
+
+		void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) override;
+		uint64_t Signal(CommandQueueType queue) override;
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) override;
+		IFence* GetFence(CommandQueueType queue) override { return m_Fences[(uint32_t)queue]; }
+
+		inline ID3D12CommandQueue* GetQueue(CommandQueueType queue) const { return m_Queues[(uint32_t)queue]; }
+
+	private:
+		ID3D12CommandQueue* m_Queues[(uint32_t)CommandQueueType::Count];
+		D3D12Fence* m_Fences[(uint32_t)CommandQueueType::Count];
+	};
+}
@@ -0,0 +1,48 @@
+#include "d3d12Residency.h"
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12ResidencyBackend::D3D12ResidencyBackend(ID3D12Device* device) : m_Device(device)
+	{
+		D3D_ASSERT(device, "D3D12ResidencyBackend needs a device!");
+	}
+
+	void D3D12ResidencyBackend::MakeResident(const ResidencyHeap* heaps, uint32_t count)
+	{
+		m_Pageables.clear();
+		for (uint32_t i = 0; i < count; i++)
+			m_Pageables.push_back(static_cast<ID3D12Pageable*>(heaps[i].NativeHeap));
+
+		Check(m_Device->MakeResident(count, m_Pageables.data()), "Failed to make the heaps resident!");
+	}
+
+	void D3D12ResidencyBackend::Evict(const ResidencyHeap* heaps, uint32_t count)
+	{
+		m_Pageables.clear();
+		for (uint32_t i = 0; i < count; i++)
+			m_Pageables.push_back(static_cast<ID3D12Pageable*>(heaps[i].NativeHeap));
+
+		Check(m_Device->Evict(count, m_Pageables.data()), "Failed to evict the heaps!");
+	}
+
+	DXGIMemoryBudgetSource::DXGIMemoryBudgetSource(IDXGIAdapter3* adapter) : m_Adapter(adapter)
+	{
+		D3D_ASSERT(adapter, "DXGIMemoryBudgetSource needs an adapter!");
+	}
+
+	MemoryBudget DXGIMemoryBudgetSource::QueryBudget(MemorySegment segment)
+	{
+		DXGI_MEMORY_SEGMENT_GROUP group = segment == MemorySegment::Local ? DXGI_MEMORY_SEGMENT_GROUP_LOCAL : DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL;
+
+		DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+		Check(m_Adapter->QueryVideoMemoryInfo(0, group, &info), "Failed to query the video memory info!");
+
+		MemoryBudget budget;
+		budget.Budget = info.Budget;
+		budget.CurrentUsage = info.CurrentUsage;
+		return budget;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include <renderer/residencyManager.h>
+
+namespace HT
+{
+	//The native heaps are ID3D12Pageable* (an ID3D12Heap, or a committed resource, or a descriptor heap...)
+	//MakeResident blocks until the heaps are back in memory. It is only called for heaps the frame needs, so we can't do much better without
+	//EnqueueMakeResident (we would have to make the queue wait on its fence, a later step).
+	class D3D12ResidencyBackend : public IResidencyBackend
+	{
+	public:
+		explicit D3D12ResidencyBackend(ID3D12Device* device);
+
+		void MakeResident(const ResidencyHeap* heaps, uint32_t count) override;
+		void Evict(const ResidencyHeap* heaps, uint32_t count) override;
+
+	private:
+		ID3D12Device* m_Device;
+		std::vector<ID3D12Pageable*> m_Pageables;
+	};
+
+	//IDXGIAdapter3::QueryVideoMemoryInfo of the adapter we created the device on
+	class DXGIMemoryBudgetSource : public IMemoryBudgetSource
+	{
+	public:
+		explicit DXGIMemoryBudgetSource(IDXGIAdapter3* adapter);
+
+		MemoryBudget QueryBudget(MemorySegment segment) override;
+
+	private:
+		IDXGIAdapter3* m_Adapter;
+	};
+}
@@ -0,0 +1,92 @@
+#include "d3d12TextureUploadSink.h"
+
+#include <renderer/d3d12/d3d12HeapBackend.h>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	D3D12TextureUploadSink::D3D12TextureUploadSink(ID3D12Device* device, GPUHeapAllocator* heapAllocator, ID3D12Resource* uploadBuffer, ResidencyManager* residencyManager)
+		: m_Device(device), m_HeapAllocator(heapAllocator), m_UploadBuffer(uploadBuffer), m_ResidencyManager(residencyManager)
+	{
+		D3D_ASSERT(device && heapAllocator && uploadBuffer, "D3D12TextureUploadSink needs a device, a heap allocator and the upload buffer!");
+	}
+
+	D3D12TextureUploadSink::~D3D12TextureUploadSink()
+	{
+		//The GPU is idle, the memory can be given back in the next BeginFrame of the allocator
+		for (auto& entry : m_Textures)
+		{
+			Texture& texture = entry.second;
+			texture.Resource.Reset();
+
+			if (texture.Allocation.IsValid())
+				m_HeapAllocator->Free(texture.Allocation, 0);
+		}
+	}
+
+	void D3D12TextureUploadSink::CreateTexture(TextureHandle texture, const DDSTexture& desc)
+	{
+		D3D_ASSERT(m_Textures.find(texture) == m_Textures.end(), "Texture created twice!");
+
+		Texture& entry = m_Textures[texture];
+		entry.Format = (DXGI_FORMAT)desc.Format;
+		entry.MipCount = desc.MipCount;
+
+		uint32_t blockBytes = 0;
+		GetTextureFormatBlock(desc.Format, blockBytes, entry.BlockDimension);
+
+		D3D12_RESOURCE_DESC resourceDesc = {};
+		resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		resourceDesc.Width = desc.Width;
+		resourceDesc.Height = desc.Height;
+		resourceDesc.DepthOrArraySize = (UINT16)desc.ArraySize;
+		resourceDesc.MipLevels = (UINT16)desc.MipCount;
+		resourceDesc.Format = entry.Format;
+		resourceDesc.SampleDesc.Count = 1;
+		resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+		//Out of memory leaves it without a resource, its copies are just skipped
+		entry.Resource.Attach(CreatePlacedResource(m_Device, *m_HeapAllocator, GPUHeapType::Default, resourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, entry.Allocation));
+	}
+
+	void D3D12TextureUploadSink::CopySubresource(TextureHandle texture, const TextureUploadFootprint& footprint)
+	{
+		D3D_ASSERT(m_CommandList, "No command list to record the texture copies!");
+
+		auto it = m_Textures.find(texture);
+		D3D_ASSERT(it != m_Textures.end(), "Copy to a texture that was never created!");
+
+		Texture& entry = it->second;
+		if (!entry.Resource)
+			return;
+
+		D3D12_TEXTURE_COPY_LOCATION destination = {};
+		destination.pResource = entry.Resource;
+		destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		destination.SubresourceIndex = footprint.Mip + footprint.Slice * entry.MipCount;
+
+		//The footprint of a block compressed mip is in whole blocks, even when the mip is smaller than one (the 2x2 and 1x1 mips)
+		D3D12_TEXTURE_COPY_LOCATION source = {};
+		source.pResource = m_UploadBuffer;
+		source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		source.PlacedFootprint.Offset = footprint.Offset;
+		source.PlacedFootprint.Footprint.Format = entry.Format;
+		source.PlacedFootprint.Footprint.Width = HTUtils::HTAlignUp(footprint.Width, entry.BlockDimension);
+		source.PlacedFootprint.Footprint.Height = HTUtils::HTAlignUp(footprint.Height, entry.BlockDimension);
+		source.PlacedFootprint.Footprint.Depth = 1;
+		source.PlacedFootprint.Footprint.RowPitch = footprint.RowPitch;
+
+		m_CommandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+
+		if (m_ResidencyManager)
+			m_ResidencyManager->MarkUsed(entry.Allocation.Residency);
+	}
+
+	ID3D12Resource* D3D12TextureUploadSink::GetResource(TextureHandle texture) const
+	{
+		auto it = m_Textures.find(texture);
+		return it != m_Textures.end() ? it->second.Resource.Get() : nullptr;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <unordered_map>
+
+#include <renderer/comRef.h>
+#include <renderer/gpuHeapAllocator.h>
+#include <renderer/textureStreamer.h>
+
+namespace HT
+{
+	//The streamed textures are placed resources in the heap allocator (default heap, every mip and slice from the start, only their texels arrive later).
+	//The copies are CopyTextureRegion from the streaming upload buffer, recorded in the list given by SetCommandList (the list of the frame
+	//that calls TextureStreamer::Update). The textures stay in COPY_DEST for now, nothing samples them yet.
+	class D3D12TextureUploadSink : public ITextureUploadSink
+	{
+	public:
+		//uploadBuffer is the buffer of the upload memory given to the streamer
+		D3D12TextureUploadSink(ID3D12Device* device, GPUHeapAllocator* heapAllocator, ID3D12Resource* uploadBuffer, ResidencyManager* residencyManager = nullptr);
+
+		//The GPU must be done with the textures (after a flush)
+		~D3D12TextureUploadSink();
+
+		D3D12TextureUploadSink(const D3D12TextureUploadSink&) = delete;
+		D3D12TextureUploadSink& operator=(const D3D12TextureUploadSink&) = delete;
+
+		inline void SetCommandList(ID3D12GraphicsCommandList* commandList) { m_CommandList = commandList; }
+
+		void CreateTexture(TextureHandle texture, const DDSTexture& desc) override;
+		void CopySubresource(TextureHandle texture, const TextureUploadFootprint& footprint) override;
+
+		//Null if the texture couldn't be created (out of memory)
+		ID3D12Resource* GetResource(TextureHandle texture) const;
+
+	private:
+		struct Texture
+		{
+			ComRef<ID3D12Resource> Resource;
+			GPUAllocation Allocation;
+			DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+			uint32_t MipCount = 0;
+			uint32_t BlockDimension = 1;
+		};
+
+		ID3D12Device* m_Device;
+		GPUHeapAllocator* m_HeapAllocator;
+		ID3D12Resource* m_UploadBuffer;
+		ResidencyManager* m_ResidencyManager;
+
+		ID3D12GraphicsCommandList* m_CommandList = nullptr;
+		std::unordered_map<TextureHandle, Texture> m_Textures;
+	};
+}
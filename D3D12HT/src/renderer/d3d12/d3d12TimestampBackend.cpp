@@ -0,0 +1,83 @@
+#include "d3d12TimestampBackend.h"
+
+#include <d3dx12.h>
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+#include <util/timer.h>
+
+namespace HT
+{
+	D3D12TimestampBackend::D3D12TimestampBackend(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t queryCount) : m_Queue(queue), m_QueryCount(queryCount)
+	{
+		D3D_ASSERT(device && queue, "D3D12TimestampBackend needs a device and a queue!");
+
+		D3D12_QUERY_HEAP_DESC heapDesc = {};
+		heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		heapDesc.Count = queryCount;
+		Check(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(m_QueryHeap.ReleaseAndGetAddressOf())), "Failed to create the timestamp query heap!");
+
+		//Resources in a readback heap must be created (and stay) in the COPY_DEST state
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer((uint64_t)queryCount * sizeof(uint64_t));
+		Check(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, 
+			IID_PPV_ARGS(m_Readback.ReleaseAndGetAddressOf())), "Failed to create the timestamp readback buffer!");
+
+		LARGE_INTEGER frequency;
+		::QueryPerformanceFrequency(&frequency);
+		m_QPCFrequency = (uint64_t)frequency.QuadPart;
+	}
+
+	void D3D12TimestampBackend::EndQuery(void* commandList, uint32_t query)
+	{
+		D3D_ASSERT(query < m_QueryCount, "Timestamp query out of range!");
+		static_cast<ID3D12GraphicsCommandList*>(commandList)->EndQuery(m_QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, query);
+	}
+
+	void D3D12TimestampBackend::ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(firstQuery + count <= m_QueryCount, "Timestamp resolve out of range!");
+		static_cast<ID3D12GraphicsCommandList*>(commandList)->ResolveQueryData(m_QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, count, 
+			m_Readback, (uint64_t)firstQuery * sizeof(uint64_t));
+	}
+
+	const uint64_t* D3D12TimestampBackend::MapReadback(uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(firstQuery + count <= m_QueryCount, "Timestamp readback out of range!");
+
+		//The range we read, so the driver only has to make that part visible to the CPU
+		CD3DX12_RANGE readRange((SIZE_T)firstQuery * sizeof(uint64_t), (SIZE_T)(firstQuery + count) * sizeof(uint64_t));
+		void* mapped = nullptr;
+		Check(m_Readback->Map(0, &readRange, &mapped), "Failed to map the timestamp readback buffer!");
+
+		return static_cast<const uint64_t*>(mapped) + firstQuery;
+	}
+
+	void D3D12TimestampBackend::UnmapReadback()
+	{
+		//Nothing was written
+		CD3DX12_RANGE writtenRange(0, 0);
+		m_Readback->Unmap(0, &writtenRange);
+	}
+
+	uint64_t D3D12TimestampBackend::GetFrequency()
+	{
+		uint64_t frequency = 0;
+		Check(m_Queue->GetTimestampFrequency(&frequency), "Failed to get the timestamp frequency!");
+		return frequency;
+	}
+
+	void D3D12TimestampBackend::GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds)
+	{
+		//The CPU side of the calibration is a QueryPerformanceCounter value. We take one together with HTNowNanoseconds to move it to our clock.
+		uint64_t cpuTicks = 0;
+		Check(m_Queue->GetClockCalibration(&outGPUTicks, &cpuTicks), "Failed to get the clock calibration!");
+
+		LARGE_INTEGER now;
+		::QueryPerformanceCounter(&now);
+		uint64_t nowNs = HTUtils::HTNowNanoseconds();
+
+		auto TicksToNanoseconds = [this](uint64_t ticks) { return (ticks / m_QPCFrequency) * 1000000000ull + (ticks % m_QPCFrequency) * 1000000000ull / m_QPCFrequency; };
+		outCPUNanoseconds = nowNs - (TicksToNanoseconds((uint64_t)now.QuadPart) - TicksToNanoseconds(cpuTicks));
+	}
+}
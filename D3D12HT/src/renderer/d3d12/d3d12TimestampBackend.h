@@ -0,0 +1,37 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/comRef.h>
+#include <renderer/gpuProfiler.h>
+
+namespace HT
+{
+	//A timestamp query heap and a readback buffer of the same size, for the queries of a queue (the direct one, the copy queue needs
+	//D3D12_FEATURE_D3D12_OPTIONS3::CopyQueueTimestampQueriesSupported). The lists are ID3D12GraphicsCommandList*.
+	//The readback buffer is mapped only for the range we read, reading from a readback heap is cached so it is not slow like an upload heap.
+	class D3D12TimestampBackend : public ITimestampBackend
+	{
+	public:
+		D3D12TimestampBackend(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t queryCount);
+
+		void EndQuery(void* commandList, uint32_t query) override;
+		void ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count) override;
+
+		const uint64_t* MapReadback(uint32_t firstQuery, uint32_t count) override;
+		void UnmapReadback() override;
+
+		uint64_t GetFrequency() override;
+		void GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds) override;
+
+	private:
+		ID3D12CommandQueue* m_Queue;
+		uint32_t m_QueryCount;
+
+		ComRef<ID3D12QueryHeap> m_QueryHeap;
+		ComRef<ID3D12Resource> m_Readback;
+
+		//QueryPerformanceCounter in ticks per second
+		uint64_t m_QPCFrequency = 1;
+	};
+}
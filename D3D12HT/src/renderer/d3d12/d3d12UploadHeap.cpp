@@ -0,0 +1,37 @@
+#include "d3d12UploadHeap.h"
+
+#include <d3dx12.h>
+
+#include <util/simpleAssert.h>
+#include <util/d3dFailureCheck.h>
+
+namespace HT
+{
+	D3D12UploadHeap::D3D12UploadHeap(ID3D12Device* device, uint64_t size)
+	{
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+		//Resources in an upload heap must be created (and stay) in the GENERIC_READ state.
+		Check(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_Resource)),
+			"Failed to create the upload heap!");
+
+		//An empty read range tells the driver that we will never read this memory in the CPU (reading write-combined memory is very slow).
+		CD3DX12_RANGE readRange(0, 0);
+		void* mapped = nullptr;
+		Check(m_Resource->Map(0, &readRange, &mapped), "Failed to map the upload heap!");
+
+		m_Memory.CPUBase = static_cast<uint8_t*>(mapped);
+		m_Memory.GPUBase = m_Resource->GetGPUVirtualAddress();
+		m_Memory.Size = size;
+	}
+
+	D3D12UploadHeap::~D3D12UploadHeap()
+	{
+		if (m_Resource)
+		{
+			m_Resource->Unmap(0, nullptr);
+			m_Resource->Release();
+		}
+	}
+}
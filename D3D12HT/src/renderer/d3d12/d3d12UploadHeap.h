@@ -0,0 +1,28 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <renderer/uploadRing.h>
+
+namespace HT
+{
+	//One big buffer in an upload heap, mapped once for its whole life. 
+	//Upload heaps are CPU write-combined memory that the GPU can read, so it is the memory we suballocate with the HT::UploadRing.
+	//Keeping it mapped is fine (and recommended) for upload heaps, Map/Unmap every frame would just cost us time.
+	class D3D12UploadHeap
+	{
+	public:
+		D3D12UploadHeap(ID3D12Device* device, uint64_t size);
+		~D3D12UploadHeap();
+
+		D3D12UploadHeap(const D3D12UploadHeap&) = delete;
+		D3D12UploadHeap& operator=(const D3D12UploadHeap&) = delete;
+
+		inline UploadMemory GetMemory() const { return m_Memory; }
+		inline ID3D12Resource* GetResource() const { return m_Resource; }
+
+	private:
+		ID3D12Resource* m_Resource = nullptr;
+		UploadMemory m_Memory;
+	};
+}
@@ -0,0 +1,97 @@
+#include "d3dShaderCompiler.h"
+
+#include <Windows.h>
+#include <d3dcompiler.h>
+
+#include <util/hash.h>
+
+namespace HT
+{
+	//Resolves the includes the same way the keys are built (HT::ResolveShaderInclude), so what we compile is what we hashed
+	class D3DShaderInclude : public ID3DInclude
+	{
+	public:
+		D3DShaderInclude(IShaderSourceProvider& sources, const std::string& rootPath) : m_Sources(sources), m_RootPath(rootPath) {}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* outData, UINT* outBytes) override
+		{
+			//The parent is the data we returned before, so we know its path. nullptr is the root file.
+			std::string parentPath = m_RootPath;
+			for (const OpenFile& file : m_OpenFiles)
+			{
+				if (file.Source->data() == parentData)
+					parentPath = file.Path;
+			}
+
+			OpenFile file;
+			file.Path = ResolveShaderInclude(parentPath, fileName);
+			file.Source = std::make_unique<std::string>();
+
+			if (!m_Sources.Read(file.Path, *file.Source))
+				return E_FAIL;
+
+			*outData = file.Source->data();
+			*outBytes = (UINT)file.Source->size();
+
+			m_OpenFiles.push_back(std::move(file));
+			return S_OK;
+		}
+
+		HRESULT __stdcall Close(LPCVOID data) override
+		{
+			//We keep the files until the compilation ends, a parent can be asked for after its children were closed
+			return S_OK;
+		}
+
+	private:
+		struct OpenFile
+		{
+			std::string Path;
+			std::unique_ptr<std::string> Source;
+		};
+
+		IShaderSourceProvider& m_Sources;
+		std::string m_RootPath;
+		std::vector<OpenFile> m_OpenFiles;
+	};
+
+	uint64_t D3DShaderCompiler::GetVersionHash() const
+	{
+		return HTUtils::HTHasher().Add("D3DCompile").Add<uint32_t>(D3D_COMPILER_VERSION).Get();
+	}
+
+	bool D3DShaderCompiler::Compile(const ShaderDesc& desc, const std::string& source, IShaderSourceProvider& sources, ShaderBytecode& outBytecode, std::string& outErrors)
+	{
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const ShaderDefine& define : desc.Defines)
+			macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+
+		macros.push_back({ nullptr, nullptr });
+
+		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+		flags |= desc.Debug ? (D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION) : D3DCOMPILE_OPTIMIZATION_LEVEL3;
+
+		D3DShaderInclude include(sources, desc.Path);
+
+		ID3DBlob* bytecode = nullptr;
+		ID3DBlob* errors = nullptr;
+
+		HRESULT result = D3DCompile(source.data(), source.size(), desc.Path.c_str(), macros.data(), &include, 
+			desc.EntryPoint.c_str(), desc.Target.c_str(), flags, 0, &bytecode, &errors);
+
+		if (errors)
+		{
+			outErrors.assign(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+			errors->Release();
+		}
+
+		if (FAILED(result) || !bytecode)
+			return false;
+
+		const uint8_t* data = static_cast<const uint8_t*>(bytecode->GetBufferPointer());
+		outBytecode.assign(data, data + bytecode->GetBufferSize());
+		bytecode->Release();
+
+		return true;
+	}
+}
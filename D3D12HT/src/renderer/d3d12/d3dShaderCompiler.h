@@ -0,0 +1,15 @@
+#pragma once
+
+#include <renderer/shaderCompiler.h>
+
+namespace HT
+{
+	//IShaderCompiler on top of D3DCompile (FXC, shader model 5.1). The includes are read from the same source provider used to build the cache keys.
+	class D3DShaderCompiler : public IShaderCompiler
+	{
+	public:
+		uint64_t GetVersionHash() const override;
+
+		bool Compile(const ShaderDesc& desc, const std::string& source, IShaderSourceProvider& sources, ShaderBytecode& outBytecode, std::string& outErrors) override;
+	};
+}
@@ -0,0 +1,342 @@
+#include "ddsTexture.h"
+
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	namespace
+	{
+		//The layout of the file, from the DDS documentation. Everything is little endian uint32.
+		const uint32_t s_DDSMagic = 0x20534444; //"DDS "
+
+		const uint32_t s_HeaderFlagMipCount = 0x20000;
+
+		const uint32_t s_PixelFlagAlphaPixels = 0x1;
+		const uint32_t s_PixelFlagFourCC      = 0x4;
+		const uint32_t s_PixelFlagRGB         = 0x40;
+		const uint32_t s_PixelFlagLuminance   = 0x20000;
+
+		const uint32_t s_Caps2Cube   = 0x200;
+		const uint32_t s_Caps2Volume = 0x200000;
+
+		const uint32_t s_DX10MiscCube = 0x4;
+		const uint32_t s_DX10Texture2D = 3;
+
+		struct DDSPixelFormat
+		{
+			uint32_t Size;
+			uint32_t Flags;
+			uint32_t FourCC;
+			uint32_t RGBBitCount;
+			uint32_t RBitMask;
+			uint32_t GBitMask;
+			uint32_t BBitMask;
+			uint32_t ABitMask;
+		};
+
+		struct DDSHeader
+		{
+			uint32_t Size;
+			uint32_t Flags;
+			uint32_t Height;
+			uint32_t Width;
+			uint32_t PitchOrLinearSize;
+			uint32_t Depth;
+			uint32_t MipMapCount;
+			uint32_t Reserved1[11];
+			DDSPixelFormat PixelFormat;
+			uint32_t Caps;
+			uint32_t Caps2;
+			uint32_t Caps3;
+			uint32_t Caps4;
+			uint32_t Reserved2;
+		};
+
+		struct DDSHeaderDX10
+		{
+			uint32_t Format;
+			uint32_t ResourceDimension;
+			uint32_t MiscFlag;
+			uint32_t ArraySize;
+			uint32_t MiscFlags2;
+		};
+
+		static_assert(sizeof(DDSHeader) == 124, "The DDS header is 124 bytes");
+		static_assert(sizeof(DDSHeaderDX10) == 20, "The DX10 header is 20 bytes");
+
+		constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+		{
+			return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+		}
+
+		//The old header says the format with a FourCC or with the bit masks of the channels
+		TextureFormat LegacyFormat(const DDSPixelFormat& pixelFormat)
+		{
+			if (pixelFormat.Flags & s_PixelFlagFourCC)
+			{
+				switch (pixelFormat.FourCC)
+				{
+				case MakeFourCC('D', 'X', 'T', '1'): return TextureFormat::BC1_UNorm;
+				case MakeFourCC('D', 'X', 'T', '2'):
+				case MakeFourCC('D', 'X', 'T', '3'): return TextureFormat::BC2_UNorm;
+				case MakeFourCC('D', 'X', 'T', '4'):
+				case MakeFourCC('D', 'X', 'T', '5'): return TextureFormat::BC3_UNorm;
+				case MakeFourCC('A', 'T', 'I', '1'):
+				case MakeFourCC('B', 'C', '4', 'U'): return TextureFormat::BC4_UNorm;
+				case MakeFourCC('B', 'C', '4', 'S'): return TextureFormat::BC4_SNorm;
+				case MakeFourCC('A', 'T', 'I', '2'):
+				case MakeFourCC('B', 'C', '5', 'U'): return TextureFormat::BC5_UNorm;
+				case MakeFourCC('B', 'C', '5', 'S'): return TextureFormat::BC5_SNorm;
+
+				//D3DFORMAT values written as FourCC by the old D3DX
+				case 111: return TextureFormat::R16_Float;
+				case 112: return TextureFormat::RG16_Float;
+				case 113: return TextureFormat::RGBA16_Float;
+				case 114: return TextureFormat::R32_Float;
+				case 116: return TextureFormat::RGBA32_Float;
+				default:  return TextureFormat::Unknown;
+				}
+			}
+
+			if ((pixelFormat.Flags & s_PixelFlagRGB) && pixelFormat.RGBBitCount == 32)
+			{
+				if (pixelFormat.RBitMask == 0x000000ff && pixelFormat.GBitMask == 0x0000ff00 && pixelFormat.BBitMask == 0x00ff0000)
+					return TextureFormat::RGBA8_UNorm;
+
+				if (pixelFormat.RBitMask == 0x00ff0000 && pixelFormat.GBitMask == 0x0000ff00 && pixelFormat.BBitMask == 0x000000ff)
+					return (pixelFormat.Flags & s_PixelFlagAlphaPixels) ? TextureFormat::BGRA8_UNorm : TextureFormat::BGRX8_UNorm;
+			}
+
+			if (pixelFormat.Flags & s_PixelFlagLuminance)
+			{
+				if (pixelFormat.RGBBitCount == 8)
+					return TextureFormat::R8_UNorm;
+
+				if (pixelFormat.RGBBitCount == 16 && (pixelFormat.Flags & s_PixelFlagAlphaPixels))
+					return TextureFormat::RG8_UNorm;
+			}
+
+			return TextureFormat::Unknown;
+		}
+	}
+
+	const char* TextureFormatName(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::RGBA32_Float:     return "rgba32_float";
+		case TextureFormat::RGBA16_Float:     return "rgba16_float";
+		case TextureFormat::RGBA16_UNorm:     return "rgba16_unorm";
+		case TextureFormat::RGBA8_UNorm:      return "rgba8_unorm";
+		case TextureFormat::RGBA8_UNorm_SRGB: return "rgba8_unorm_srgb";
+		case TextureFormat::RG16_Float:       return "rg16_float";
+		case TextureFormat::R32_Float:        return "r32_float";
+		case TextureFormat::RG8_UNorm:        return "rg8_unorm";
+		case TextureFormat::R16_Float:        return "r16_float";
+		case TextureFormat::R8_UNorm:         return "r8_unorm";
+		case TextureFormat::BC1_UNorm:        return "bc1_unorm";
+		case TextureFormat::BC1_UNorm_SRGB:   return "bc1_unorm_srgb";
+		case TextureFormat::BC2_UNorm:        return "bc2_unorm";
+		case TextureFormat::BC2_UNorm_SRGB:   return "bc2_unorm_srgb";
+		case TextureFormat::BC3_UNorm:        return "bc3_unorm";
+		case TextureFormat::BC3_UNorm_SRGB:   return "bc3_unorm_srgb";
+		case TextureFormat::BC4_UNorm:        return "bc4_unorm";
+		case TextureFormat::BC4_SNorm:        return "bc4_snorm";
+		case TextureFormat::BC5_UNorm:        return "bc5_unorm";
+		case TextureFormat::BC5_SNorm:        return "bc5_snorm";
+		case TextureFormat::BGRA8_UNorm:      return "bgra8_unorm";
+		case TextureFormat::BGRX8_UNorm:      return "bgrx8_unorm";
+		case TextureFormat::BGRA8_UNorm_SRGB: return "bgra8_unorm_srgb";
+		case TextureFormat::BC6H_UF16:        return "bc6h_uf16";
+		case TextureFormat::BC6H_SF16:        return "bc6h_sf16";
+		case TextureFormat::BC7_UNorm:        return "bc7_unorm";
+		case TextureFormat::BC7_UNorm_SRGB:   return "bc7_unorm_srgb";
+		default:                              return "unknown";
+		}
+	}
+
+	bool GetTextureFormatBlock(TextureFormat format, uint32_t& outBlockBytes, uint32_t& outBlockDimension)
+	{
+		outBlockDimension = 1;
+
+		switch (format)
+		{
+		case TextureFormat::RGBA32_Float:     outBlockBytes = 16; return true;
+		case TextureFormat::RGBA16_Float:
+		case TextureFormat::RGBA16_UNorm:     outBlockBytes = 8;  return true;
+		case TextureFormat::RGBA8_UNorm:
+		case TextureFormat::RGBA8_UNorm_SRGB:
+		case TextureFormat::RG16_Float:
+		case TextureFormat::R32_Float:
+		case TextureFormat::BGRA8_UNorm:
+		case TextureFormat::BGRX8_UNorm:
+		case TextureFormat::BGRA8_UNorm_SRGB: outBlockBytes = 4;  return true;
+		case TextureFormat::RG8_UNorm:
+		case TextureFormat::R16_Float:        outBlockBytes = 2;  return true;
+		case TextureFormat::R8_UNorm:         outBlockBytes = 1;  return true;
+		default: break;
+		}
+
+		outBlockDimension = 4;
+
+		switch (format)
+		{
+		case TextureFormat::BC1_UNorm:
+		case TextureFormat::BC1_UNorm_SRGB:
+		case TextureFormat::BC4_UNorm:
+		case TextureFormat::BC4_SNorm:        outBlockBytes = 8;  return true;
+		case TextureFormat::BC2_UNorm:
+		case TextureFormat::BC2_UNorm_SRGB:
+		case TextureFormat::BC3_UNorm:
+		case TextureFormat::BC3_UNorm_SRGB:
+		case TextureFormat::BC5_UNorm:
+		case TextureFormat::BC5_SNorm:
+		case TextureFormat::BC6H_UF16:
+		case TextureFormat::BC6H_SF16:
+		case TextureFormat::BC7_UNorm:
+		case TextureFormat::BC7_UNorm_SRGB:   outBlockBytes = 16; return true;
+		default:                              outBlockBytes = 0;  return false;
+		}
+	}
+
+	DDSSubresource DDSTexture::GetSubresource(uint32_t mip, uint32_t slice) const
+	{
+		uint32_t blockBytes, blockDimension;
+		GetTextureFormatBlock(Format, blockBytes, blockDimension);
+
+		DDSSubresource subresource;
+		subresource.Width = HTUtils::HTMax(Width >> mip, 1u);
+		subresource.Height = HTUtils::HTMax(Height >> mip, 1u);
+
+		//In 64 bits, ParseDDS keeps the sizes in the limits but the math must not wrap before it can check them
+		uint64_t rowBytes = ((uint64_t)subresource.Width + blockDimension - 1) / blockDimension * blockBytes;
+		uint64_t rowCount = ((uint64_t)subresource.Height + blockDimension - 1) / blockDimension;
+		D3D_ASSERT(rowBytes <= UINT32_MAX && rowCount <= UINT32_MAX, "The subresource is too big, the texture was not checked by ParseDDS");
+
+		subresource.RowBytes = (uint32_t)rowBytes;
+		subresource.RowCount = (uint32_t)rowCount;
+		subresource.Offset = (uint64_t)slice * SliceSize + MipOffsets[mip];
+		return subresource;
+	}
+
+	bool ParseDDS(const uint8_t* data, uint64_t size, DDSTexture& outTexture, std::string& outError)
+	{
+		outTexture = {};
+
+		if (size < sizeof(uint32_t) + sizeof(DDSHeader))
+		{
+			outError = "The file is too small for a DDS header";
+			return false;
+		}
+
+		//memcpy, the mapped data has no alignment guarantee for us. It is only the header, the texels are never copied.
+		uint32_t magic;
+		DDSHeader header;
+		memcpy(&magic, data, sizeof(magic));
+		memcpy(&header, data + sizeof(magic), sizeof(header));
+
+		if (magic != s_DDSMagic || header.Size != sizeof(DDSHeader) || header.PixelFormat.Size != sizeof(DDSPixelFormat))
+		{
+			outError = "Not a DDS file";
+			return false;
+		}
+
+		uint64_t texelOffset = sizeof(magic) + sizeof(DDSHeader);
+		uint32_t arraySize = 1;
+		bool cube = false;
+
+		if ((header.PixelFormat.Flags & s_PixelFlagFourCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			if (size < texelOffset + sizeof(DDSHeaderDX10))
+			{
+				outError = "The file is too small for a DX10 header";
+				return false;
+			}
+
+			DDSHeaderDX10 headerDX10;
+			memcpy(&headerDX10, data + texelOffset, sizeof(headerDX10));
+			texelOffset += sizeof(DDSHeaderDX10);
+
+			if (headerDX10.ResourceDimension != s_DX10Texture2D)
+			{
+				outError = "Only 2D textures are supported";
+				return false;
+			}
+
+			//Checked before the * 6 of the cubes, so it can't wrap
+			if (headerDX10.ArraySize > DDSTexture::s_MaxArraySize)
+			{
+				outError = "Invalid array size";
+				return false;
+			}
+
+			outTexture.Format = (TextureFormat)headerDX10.Format;
+			cube = (headerDX10.MiscFlag & s_DX10MiscCube) != 0;
+			arraySize = HTUtils::HTMax(headerDX10.ArraySize, 1u) * (cube ? 6u : 1u);
+
+			if (arraySize > DDSTexture::s_MaxArraySize)
+			{
+				outError = "Invalid array size";
+				return false;
+			}
+		}
+		else
+		{
+			if (header.Caps2 & s_Caps2Volume)
+			{
+				outError = "Volume textures are not supported";
+				return false;
+			}
+
+			outTexture.Format = LegacyFormat(header.PixelFormat);
+
+			//The old cube maps always have the 6 faces
+			cube = (header.Caps2 & s_Caps2Cube) != 0;
+			arraySize = cube ? 6 : 1;
+		}
+
+		uint32_t blockBytes, blockDimension;
+		if (!GetTextureFormatBlock(outTexture.Format, blockBytes, blockDimension))
+		{
+			outError = "Unsupported pixel format";
+			return false;
+		}
+
+		outTexture.Width = header.Width;
+		outTexture.Height = header.Height;
+		outTexture.MipCount = (header.Flags & s_HeaderFlagMipCount) ? HTUtils::HTMax(header.MipMapCount, 1u) : 1u;
+		outTexture.ArraySize = arraySize;
+		outTexture.Cube = cube;
+
+		//A full chain of 16384 has 15 mips, anything more is a broken header
+		uint32_t fullChain = HTUtils::HTHighestBit((uint64_t)HTUtils::HTMax(HTUtils::HTMax(header.Width, header.Height), 1u)) + 1;
+		if (header.Width == 0 || header.Height == 0 || header.Width > DDSTexture::s_MaxDimension || header.Height > DDSTexture::s_MaxDimension ||
+			outTexture.MipCount > fullChain || outTexture.MipCount > DDSTexture::s_MaxMips)
+		{
+			outError = "Invalid texture size or mip count";
+			return false;
+		}
+
+		//In the limits a slice is at most ~5.7GB (16384^2 texels of 16 bytes, plus the mips), 2048 of them still fit in 64 bits easily.
+		//The file size is compared without adding to it, a header can't make it wrap.
+		for (uint32_t mip = 0; mip < outTexture.MipCount; mip++)
+		{
+			outTexture.MipOffsets[mip] = outTexture.SliceSize;
+			outTexture.SliceSize += outTexture.GetSubresource(mip, 0).GetSize();
+		}
+
+		uint64_t texelDataSize = outTexture.SliceSize * arraySize;
+		if (texelDataSize > size - texelOffset)
+		{
+			outError = "The file is smaller than its texels";
+			return false;
+		}
+
+		outTexture.TexelData = data + texelOffset;
+		outTexture.TexelDataSize = texelDataSize;
+		return true;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace HT
+{
+	//The formats we can load. Same values as DXGI_FORMAT, so the D3D12 side can just cast it.
+	enum class TextureFormat : uint32_t
+	{
+		Unknown            = 0,
+		RGBA32_Float       = 2,
+		RGBA16_Float       = 10,
+		RGBA16_UNorm       = 11,
+		RGBA8_UNorm        = 28,
+		RGBA8_UNorm_SRGB   = 29,
+		RG16_Float         = 34,
+		R32_Float          = 41,
+		RG8_UNorm          = 49,
+		R16_Float          = 54,
+		R8_UNorm           = 61,
+		BC1_UNorm          = 71,
+		BC1_UNorm_SRGB     = 72,
+		BC2_UNorm          = 74,
+		BC2_UNorm_SRGB     = 75,
+		BC3_UNorm          = 77,
+		BC3_UNorm_SRGB     = 78,
+		BC4_UNorm          = 80,
+		BC4_SNorm          = 81,
+		BC5_UNorm          = 83,
+		BC5_SNorm          = 84,
+		BGRA8_UNorm        = 87,
+		BGRX8_UNorm        = 88,
+		BGRA8_UNorm_SRGB   = 91,
+		BC6H_UF16          = 95,
+		BC6H_SF16          = 96,
+		BC7_UNorm          = 98,
+		BC7_UNorm_SRGB     = 99,
+	};
+
+	const char* TextureFormatName(TextureFormat format);
+
+	//Block compressed formats store blocks of 4x4 texels, the others "blocks" of 1x1. False for the formats we don't know.
+	bool GetTextureFormatBlock(TextureFormat format, uint32_t& outBlockBytes, uint32_t& outBlockDimension);
+
+	//Where the texels of a mip of one array slice are in the file
+	struct DDSSubresource
+	{
+		uint64_t Offset = 0; //From the begin of the texel data
+		uint32_t Width  = 0;
+		uint32_t Height = 0;
+
+		//Rows of blocks, tightly packed
+		uint32_t RowBytes = 0;
+		uint32_t RowCount = 0;
+
+		inline uint64_t GetSize() const { return (uint64_t)RowBytes * RowCount; }
+	};
+
+	//A DDS file already in memory (mapped). Nothing is copied: the texel data is a pointer into the file, only the numbers of the header are read.
+	//2D textures, arrays and cube maps (a cube is an array of 6). In the file, every array slice has its whole mip chain, one slice after the other.
+	struct DDSTexture
+	{
+		static constexpr uint32_t s_MaxMips = 16;
+
+		//The D3D12 limits of a 2D texture, the headers asking for more are refused
+		static constexpr uint32_t s_MaxDimension = 16384;
+		static constexpr uint32_t s_MaxArraySize = 2048;
+
+		TextureFormat Format = TextureFormat::Unknown;
+		uint32_t Width     = 0;
+		uint32_t Height    = 0;
+		uint32_t MipCount  = 0;
+		uint32_t ArraySize = 0;
+		bool Cube = false;
+
+		const uint8_t* TexelData = nullptr;
+		uint64_t TexelDataSize = 0;
+
+		//Of the mips of one slice (the same for every slice)
+		uint64_t MipOffsets[s_MaxMips] = {};
+		uint64_t SliceSize = 0;
+
+		DDSSubresource GetSubresource(uint32_t mip, uint32_t slice) const;
+		inline const uint8_t* GetSubresourceData(uint32_t mip, uint32_t slice) const { return TexelData + GetSubresource(mip, slice).Offset; }
+	};
+
+	//Reads the header (and the DX10 header, if it has one) and checks that the file has all the texels the header says.
+	//Volume textures, pixel formats we don't know and sizes over the D3D12 limits are refused, with the reason in outError.
+	bool ParseDDS(const uint8_t* data, uint64_t size, DDSTexture& outTexture, std::string& outError);
+}
@@ -0,0 +1,86 @@
+#include "deferredReleaseQueue.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	DeferredReleaseQueue::DeferredReleaseQueue(IFence* fence) : m_Fence(fence)
+	{
+		D3D_ASSERT(fence, "The deferred release queue needs a fence!");
+	}
+
+	DeferredReleaseQueue::~DeferredReleaseQueue()
+	{
+		//We can't wait for the GPU here, the fence (or the queue behind it) may be gone already
+		D3D_ASSERT(m_Entries.empty(), "Objects still waiting to be released, call ReleaseAll before destroying the queue!");
+	}
+
+	void DeferredReleaseQueue::Enqueue(void* object, uint64_t fenceValue, ReleaseFunction release)
+	{
+		D3D_ASSERT(object && release, "Nothing to release!");
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (!m_Entries.empty())
+			fenceValue = HTUtils::HTMax(fenceValue, m_Entries.back().FenceValue);
+
+		m_Entries.push_back({ object, fenceValue, release });
+
+		m_Stats.Enqueued++;
+		m_Stats.Pending = (uint32_t)m_Entries.size();
+		m_Stats.PeakPending = HTUtils::HTMax(m_Stats.PeakPending, m_Stats.Pending);
+	}
+
+	uint32_t DeferredReleaseQueue::ReleaseCompleted(uint64_t completedValue)
+	{
+		uint32_t released = 0;
+
+		while (!m_Entries.empty() && m_Entries.front().FenceValue <= completedValue)
+		{
+			Entry entry = m_Entries.front();
+			m_Entries.pop_front();
+
+			entry.Release(entry.Object);
+			released++;
+		}
+
+		m_Stats.Released += released;
+		m_Stats.Pending = (uint32_t)m_Entries.size();
+
+		return released;
+	}
+
+	uint32_t DeferredReleaseQueue::Collect()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Entries.empty())
+			return 0;
+
+		return ReleaseCompleted(m_Fence->GetCompletedValue());
+	}
+
+	void DeferredReleaseQueue::ReleaseAll()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Entries.empty())
+			return;
+
+		//The last entry has the biggest value. If it was never signaled (the frame that used the objects didn't end), we signal it now.
+		uint64_t valueToWait = m_Entries.back().FenceValue;
+
+		while (m_Fence->GetLastSignaledValue() < valueToWait)
+			m_Fence->Signal();
+
+		m_Fence->WaitForValue(valueToWait);
+		ReleaseCompleted(valueToWait);
+	}
+
+	DeferredReleaseStats DeferredReleaseQueue::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+}
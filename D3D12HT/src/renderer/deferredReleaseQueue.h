@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include <renderer/comRef.h>
+#include <renderer/fence.h>
+
+namespace HT
+{
+	struct DeferredReleaseStats
+	{
+		uint64_t Enqueued = 0;
+		uint64_t Released = 0;
+
+		//Waiting for their fence value
+		uint32_t Pending     = 0;
+		uint32_t PeakPending = 0;
+	};
+
+	//We can't release an object while the GPU may still use it (a resource read by a frame in flight, a pipeline of a list not executed yet...).
+	//Instead of waiting for the GPU (this is what our old Flush did), the object goes here with the fence value signaled after the last work that used it,
+	//and it is really released by Collect once the fence reaches this value.
+	//
+	//Only Release is called on the objects, so anything ref counted works (D3D12/DXGI objects, or fake objects when testing with a HT::CPUFence).
+	class DeferredReleaseQueue
+	{
+	public:
+		using ReleaseFunction = void(*)(void* object);
+
+		explicit DeferredReleaseQueue(IFence* fence);
+		~DeferredReleaseQueue();
+
+		DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+		DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+		//Released once the GPU is done with everything submitted until now, and with the work of the frame being recorded
+		//(the next value of the fence is signaled after it).
+		template<typename T>
+		void Release(T* object) { Release(object, m_Fence->GetLastSignaledValue() + 1); }
+
+		//Released once the fence reaches fenceValue
+		template<typename T>
+		void Release(T* object, uint64_t fenceValue)
+		{
+			if (object)
+				Enqueue(object, fenceValue, [](void* pointer) { static_cast<T*>(pointer)->Release(); });
+		}
+
+		//Takes the reference of ref, ref is empty after this
+		template<typename T>
+		void Release(ComRef<T>& ref) { Release(ref.Detach()); }
+
+		//The values must not go backwards. If one does, it is moved up to the last one (releasing later is always safe).
+		void Enqueue(void* object, uint64_t fenceValue, ReleaseFunction release);
+
+		//Releases everything the GPU is done with. Call once per frame. Returns how many objects were released.
+		uint32_t Collect();
+
+		//Waits for the fence (signaling it if needed) and releases everything. At shutdown, before the device goes away.
+		void ReleaseAll();
+
+		DeferredReleaseStats GetStats() const;
+
+	private:
+		struct Entry
+		{
+			void* Object;
+			uint64_t FenceValue;
+			ReleaseFunction Release;
+		};
+
+		//Pops the entries with a value <= completedValue, the caller holds the lock
+		uint32_t ReleaseCompleted(uint64_t completedValue);
+
+	private:
+		IFence* m_Fence;
+
+		//Ordered by fence value
+		std::deque<Entry> m_Entries;
+
+		//The objects can be released by any thread (e.g: a job that replaced a resource)
+		mutable std::mutex m_Mutex;
+
+		DeferredReleaseStats m_Stats;
+	};
+}
@@ -0,0 +1,237 @@
+#include "descriptorAllocator.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	// -------------- DescriptorAllocator
+
+	DescriptorAllocator::DescriptorAllocator(IDescriptorHeapBackend* backend, DescriptorHeapType type, uint32_t descriptorsPerPage)
+		: m_Backend(backend), m_Type(type), m_DescriptorsPerPage(descriptorsPerPage)
+	{
+		D3D_ASSERT(backend, "DescriptorAllocator needs a backend!");
+		D3D_ASSERT(descriptorsPerPage > 0, "A descriptor page can't be empty!");
+	}
+
+	DescriptorAllocator::~DescriptorAllocator()
+	{
+		for (Page& page : m_Pages)
+			m_Backend->DestroyHeap(page.Heap);
+	}
+
+	uint32_t DescriptorAllocator::CreatePage(uint32_t numDescriptors)
+	{
+		Page page;
+		page.Heap = m_Backend->CreateHeap(m_Type, numDescriptors, false);
+		page.FreeBlocks.push_back({ 0, numDescriptors });
+		page.FreeCount = numDescriptors;
+
+		m_Pages.push_back(std::move(page));
+		m_Stats.PageCount++;
+
+		return (uint32_t)m_Pages.size() - 1;
+	}
+
+	bool DescriptorAllocator::AllocateFromPage(uint32_t pageIndex, uint32_t count, DescriptorRange& outRange)
+	{
+		Page& page = m_Pages[pageIndex];
+
+		if (page.FreeCount < count)
+			return false;
+
+		for (size_t i = 0; i < page.FreeBlocks.size(); i++)
+		{
+			FreeBlock& block = page.FreeBlocks[i];
+
+			if (block.Count < count)
+				continue;
+
+			outRange.PageIndex = pageIndex;
+			outRange.Offset = block.Offset;
+			outRange.Count = count;
+			outRange.IncrementSize = page.Heap.IncrementSize;
+			outRange.Base.CPU = page.Heap.Start.CPU + (uint64_t)block.Offset * page.Heap.IncrementSize;
+			outRange.Base.GPU = 0;
+
+			block.Offset += count;
+			block.Count -= count;
+
+			if (block.Count == 0)
+				page.FreeBlocks.erase(page.FreeBlocks.begin() + i);
+
+			page.FreeCount -= count;
+			return true;
+		}
+
+		return false;
+	}
+
+	DescriptorRange DescriptorAllocator::Allocate(uint32_t count)
+	{
+		D3D_ASSERT(count > 0, "Allocating zero descriptors!");
+
+		DescriptorRange range;
+
+		bool allocated = false;
+		for (uint32_t i = 0; i < (uint32_t)m_Pages.size() && !allocated; i++)
+			allocated = AllocateFromPage(i, count, range);
+
+		if (!allocated)
+		{
+			uint32_t pageIndex = CreatePage(HTUtils::HTMax(count, m_DescriptorsPerPage));
+			allocated = AllocateFromPage(pageIndex, count, range);
+		}
+
+		D3D_ASSERT(allocated, "Failed to allocate descriptors from a new page!");
+
+		m_Stats.AllocatedDescriptors += count;
+		m_Stats.PeakAllocatedDescriptors = HTUtils::HTMax(m_Stats.PeakAllocatedDescriptors, m_Stats.AllocatedDescriptors);
+		m_Stats.AllocationCount++;
+
+		return range;
+	}
+
+	void DescriptorAllocator::Free(DescriptorRange& range)
+	{
+		if (!range.IsValid())
+			return;
+
+		D3D_ASSERT(range.PageIndex < m_Pages.size(), "This range doesn't belong to this allocator!");
+
+		Page& page = m_Pages[range.PageIndex];
+		std::vector<FreeBlock>& blocks = page.FreeBlocks;
+
+		//Find where the range goes (the blocks are sorted by offset) and merge it with the blocks right before and after it
+		size_t insertAt = 0;
+		while (insertAt < blocks.size() && blocks[insertAt].Offset < range.Offset)
+			insertAt++;
+
+		//A range that overlaps a free block, before or after it, was already freed
+		D3D_ASSERT(insertAt == 0 || blocks[insertAt - 1].Offset + blocks[insertAt - 1].Count <= range.Offset, "Descriptor range freed twice!");
+		D3D_ASSERT(insertAt == blocks.size() || range.Offset + range.Count <= blocks[insertAt].Offset, "Descriptor range freed twice!");
+
+		bool mergesPrevious = insertAt > 0 && blocks[insertAt - 1].Offset + blocks[insertAt - 1].Count == range.Offset;
+		bool mergesNext = insertAt < blocks.size() && range.Offset + range.Count == blocks[insertAt].Offset;
+
+		if (mergesPrevious && mergesNext)
+		{
+			blocks[insertAt - 1].Count += range.Count + blocks[insertAt].Count;
+			blocks.erase(blocks.begin() + insertAt);
+		}
+		else if (mergesPrevious)
+		{
+			blocks[insertAt - 1].Count += range.Count;
+		}
+		else if (mergesNext)
+		{
+			blocks[insertAt].Offset = range.Offset;
+			blocks[insertAt].Count += range.Count;
+		}
+		else
+		{
+			blocks.insert(blocks.begin() + insertAt, { range.Offset, range.Count });
+		}
+
+		page.FreeCount += range.Count;
+
+		m_Stats.AllocatedDescriptors -= range.Count;
+		m_Stats.FreeCount++;
+
+		range = {};
+	}
+
+	// -------------- TransientDescriptorRing
+
+	TransientDescriptorRing::TransientDescriptorRing(IDescriptorHeapBackend* backend, DescriptorHeapType type, uint32_t capacity)
+		: m_Backend(backend), m_Type(type), m_Ring(capacity)
+	{
+		D3D_ASSERT(type == DescriptorHeapType::CBV_SRV_UAV || type == DescriptorHeapType::Sampler, "Only CBV_SRV_UAV and Sampler heaps can be shader visible!");
+		m_Heap = m_Backend->CreateHeap(type, capacity, true);
+	}
+
+	TransientDescriptorRing::~TransientDescriptorRing()
+	{
+		m_Backend->DestroyHeap(m_Heap);
+	}
+
+	DescriptorRange TransientDescriptorRing::Allocate(uint32_t count)
+	{
+		DescriptorRange range;
+
+		uint64_t offset = m_Ring.Allocate(count);
+		if (offset == RingAllocator::s_InvalidOffset)
+			return range;
+
+		range.Offset = (uint32_t)offset;
+		range.Count = count;
+		range.IncrementSize = m_Heap.IncrementSize;
+		range.Base.CPU = m_Heap.Start.CPU + offset * m_Heap.IncrementSize;
+		range.Base.GPU = m_Heap.Start.GPU + offset * m_Heap.IncrementSize;
+
+		return range;
+	}
+
+	DescriptorRange TransientDescriptorRing::CopyToTable(const DescriptorRange* sources, uint32_t sourceCount)
+	{
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < sourceCount; i++)
+			total += sources[i].Count;
+
+		DescriptorRange table = Allocate(total);
+		if (!table.IsValid())
+			return table;
+
+		uint32_t written = 0;
+		uint32_t i = 0;
+
+		while (i < sourceCount)
+		{
+			DescriptorHandle source = sources[i].Base;
+			uint32_t count = sources[i].Count;
+
+			//Grow the copy while the next source starts exactly where this one ends
+			while (i + 1 < sourceCount && sources[i + 1].Base.CPU == source.CPU + (uint64_t)count * m_Heap.IncrementSize)
+			{
+				count += sources[i + 1].Count;
+				i++;
+			}
+
+			m_Backend->CopyDescriptors(m_Type, table.At(written), source, count);
+
+			written += count;
+			i++;
+		}
+
+		return table;
+	}
+
+	// -------------- DescriptorManager
+
+	DescriptorManager::DescriptorManager(IDescriptorHeapBackend* backend, const DescriptorManagerDesc& desc)
+	{
+		for (uint32_t i = 0; i < (uint32_t)DescriptorHeapType::Count; i++)
+			m_Allocators[i] = std::make_unique<DescriptorAllocator>(backend, (DescriptorHeapType)i, desc.DescriptorsPerPage[i]);
+
+		m_CBVSRVUAVRing = std::make_unique<TransientDescriptorRing>(backend, DescriptorHeapType::CBV_SRV_UAV, desc.TransientCBVSRVUAVCapacity);
+		m_SamplerRing = std::make_unique<TransientDescriptorRing>(backend, DescriptorHeapType::Sampler, desc.TransientSamplerCapacity);
+	}
+
+	TransientDescriptorRing& DescriptorManager::GetTransientRing(DescriptorHeapType type)
+	{
+		D3D_ASSERT(type == DescriptorHeapType::CBV_SRV_UAV || type == DescriptorHeapType::Sampler, "Only CBV_SRV_UAV and Sampler heaps can be shader visible!");
+		return type == DescriptorHeapType::Sampler ? *m_SamplerRing : *m_CBVSRVUAVRing;
+	}
+
+	void DescriptorManager::BeginFrame(uint64_t completedFenceValue)
+	{
+		m_CBVSRVUAVRing->BeginFrame(completedFenceValue);
+		m_SamplerRing->BeginFrame(completedFenceValue);
+	}
+
+	void DescriptorManager::EndFrame(uint64_t fenceValue)
+	{
+		m_CBVSRVUAVRing->EndFrame(fenceValue);
+		m_SamplerRing->EndFrame(fenceValue);
+	}
+}
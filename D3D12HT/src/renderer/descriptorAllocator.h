@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <renderer/descriptorHeap.h>
+#include <renderer/ringAllocator.h>
+
+namespace HT
+{
+	struct DescriptorAllocatorStats
+	{
+		uint32_t PageCount            = 0;
+		uint32_t AllocatedDescriptors = 0;
+		uint32_t PeakAllocatedDescriptors = 0;
+		uint64_t AllocationCount      = 0;
+		uint64_t FreeCount            = 0;
+	};
+
+	//Allocator for the long-lived descriptors (the views of our textures, render targets etc...). 
+	//They live in CPU-only heaps, the shaders never see them directly, we copy them to a shader visible heap when we need them (see TransientDescriptorRing).
+	//
+	//A single heap sized for the swap chain doesn't scale, so we have pages: when a page is full we create another one.
+	//Inside a page we keep a list of free blocks, ordered by offset. Allocating takes the first block big enough (so ranges are always contiguous)
+	//and freeing puts the range back, merging it with its neighbours.
+	//
+	//CPU-only descriptors are read when the command is recorded (or copied), not when the GPU executes it, so a range can be freed right after its last use.
+	class DescriptorAllocator
+	{
+	public:
+		DescriptorAllocator(IDescriptorHeapBackend* backend, DescriptorHeapType type, uint32_t descriptorsPerPage = 256);
+		~DescriptorAllocator();
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		//A range bigger than a page gets a page of its own.
+		DescriptorRange Allocate(uint32_t count = 1);
+		void Free(DescriptorRange& range);
+
+		inline const DescriptorAllocatorStats& GetStats() const { return m_Stats; }
+		inline DescriptorHeapType GetType() const { return m_Type; }
+
+	private:
+		struct FreeBlock
+		{
+			uint32_t Offset;
+			uint32_t Count;
+		};
+
+		struct Page
+		{
+			DescriptorHeapInfo Heap;
+			std::vector<FreeBlock> FreeBlocks;
+			uint32_t FreeCount;
+		};
+
+		uint32_t CreatePage(uint32_t numDescriptors);
+		bool AllocateFromPage(uint32_t pageIndex, uint32_t count, DescriptorRange& outRange);
+
+	private:
+		IDescriptorHeapBackend* m_Backend;
+		DescriptorHeapType m_Type;
+		uint32_t m_DescriptorsPerPage;
+
+		std::vector<Page> m_Pages;
+		DescriptorAllocatorStats m_Stats;
+	};
+
+	//A shader visible heap used as a ring, for the descriptor tables of a frame. 
+	//Every frame we copy the descriptors the draws need from the CPU-only heaps into it. The ranges are given back once the fence of the frame completes,
+	//the same way as the upload ring (it also uses a HT::RingAllocator).
+	class TransientDescriptorRing
+	{
+	public:
+		TransientDescriptorRing(IDescriptorHeapBackend* backend, DescriptorHeapType type, uint32_t capacity);
+		~TransientDescriptorRing();
+
+		TransientDescriptorRing(const TransientDescriptorRing&) = delete;
+		TransientDescriptorRing& operator=(const TransientDescriptorRing&) = delete;
+
+		inline void BeginFrame(uint64_t completedFenceValue) { m_Ring.BeginFrame(completedFenceValue); }
+		inline void EndFrame(uint64_t fenceValue) { m_Ring.EndFrame(fenceValue); }
+
+		//An invalid range is returned if the ring is full.
+		DescriptorRange Allocate(uint32_t count);
+
+		//Allocates one contiguous table and copies all sources into it, in order. Sources that are next to each other in the same heap
+		//are merged, so we do as few copy calls as possible.
+		DescriptorRange CopyToTable(const DescriptorRange* sources, uint32_t sourceCount);
+
+		inline const DescriptorHeapInfo& GetHeap() const { return m_Heap; }
+		inline const RingAllocatorStats& GetStats() const { return m_Ring.GetStats(); }
+
+	private:
+		IDescriptorHeapBackend* m_Backend;
+		DescriptorHeapType m_Type;
+		DescriptorHeapInfo m_Heap;
+		RingAllocator m_Ring;
+	};
+
+	struct DescriptorManagerDesc
+	{
+		//The page size of the CPU-only heap of each type
+		uint32_t DescriptorsPerPage[(uint32_t)DescriptorHeapType::Count] = { 1024, 128, 64, 64 };
+
+		//Only CBV_SRV_UAV and samplers can be shader visible. The hardware limit for samplers is 2048.
+		uint32_t TransientCBVSRVUAVCapacity = 8192;
+		uint32_t TransientSamplerCapacity   = 1024;
+	};
+
+	//All the descriptor allocators of the renderer in one place: one paged CPU-only allocator for each type and the shader visible rings.
+	class DescriptorManager
+	{
+	public:
+		DescriptorManager(IDescriptorHeapBackend* backend, const DescriptorManagerDesc& desc = {});
+
+		inline DescriptorAllocator& GetAllocator(DescriptorHeapType type) { return *m_Allocators[(uint32_t)type]; }
+
+		//type must be CBV_SRV_UAV or Sampler
+		TransientDescriptorRing& GetTransientRing(DescriptorHeapType type);
+
+		void BeginFrame(uint64_t completedFenceValue);
+		void EndFrame(uint64_t fenceValue);
+
+	private:
+		std::unique_ptr<DescriptorAllocator> m_Allocators[(uint32_t)DescriptorHeapType::Count];
+		std::unique_ptr<TransientDescriptorRing> m_CBVSRVUAVRing;
+		std::unique_ptr<TransientDescriptorRing> m_SamplerRing;
+	};
+}
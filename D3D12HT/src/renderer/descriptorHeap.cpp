@@ -0,0 +1,33 @@
+#include "descriptorHeap.h"
+
+#include <util/simpleAssert.h>
+
+namespace HT
+{
+	DescriptorHeapInfo CPUDescriptorHeapBackend::CreateHeap(DescriptorHeapType /*type*/, uint32_t numDescriptors, bool shaderVisible)
+	{
+		DescriptorHeapInfo heap;
+		heap.NumDescriptors = numDescriptors;
+		heap.IncrementSize = m_IncrementSize;
+
+		//Every heap starts on its own 4GB boundary, CPU and GPU addresses on different halves so we notice if they get mixed
+		heap.Start.CPU = m_NextBase;
+		heap.Start.GPU = shaderVisible ? (m_NextBase | (1ull << 63)) : 0;
+		m_NextBase += 1ull << 32;
+
+		m_LiveHeaps++;
+		return heap;
+	}
+
+	void CPUDescriptorHeapBackend::DestroyHeap(const DescriptorHeapInfo& /*heap*/)
+	{
+		D3D_ASSERT(m_LiveHeaps > 0, "Destroying more heaps than we created!");
+		m_LiveHeaps--;
+	}
+
+	void CPUDescriptorHeapBackend::CopyDescriptors(DescriptorHeapType /*type*/, DescriptorHandle /*destination*/, DescriptorHandle /*source*/, uint32_t count)
+	{
+		m_CopyCalls++;
+		m_CopiedDescriptors += count;
+	}
+}
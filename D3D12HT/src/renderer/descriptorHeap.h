@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+
+namespace HT
+{
+	//Same order as D3D12_DESCRIPTOR_HEAP_TYPE, so the D3D12 backend can just cast it.
+	enum class DescriptorHeapType : uint8_t
+	{
+		CBV_SRV_UAV = 0,
+		Sampler,
+		RTV,
+		DSV,
+
+		Count
+	};
+
+	//A descriptor handle is just an address inside a heap. The CPU address is used to write the descriptor and the GPU address
+	//is used by the shaders (only shader visible heaps have a GPU address).
+	struct DescriptorHandle
+	{
+		uint64_t CPU = 0;
+		uint64_t GPU = 0;
+
+		inline bool IsNull() const { return CPU == 0; }
+		inline bool IsShaderVisible() const { return GPU != 0; }
+	};
+
+	//A contiguous range of descriptors. Being contiguous is what lets us copy a whole range (e.g: a descriptor table) with a single copy call.
+	struct DescriptorRange
+	{
+		DescriptorHandle Base;
+		uint32_t Count         = 0;
+		uint32_t IncrementSize = 0;
+
+		//Where it came from, so it can be given back
+		uint32_t PageIndex = 0;
+		uint32_t Offset    = 0;
+
+		inline bool IsValid() const { return Count > 0; }
+
+		//The same as CD3DX12_CPU_DESCRIPTOR_HANDLE::Offset, base + index * increment size
+		inline DescriptorHandle At(uint32_t index) const
+		{
+			DescriptorHandle handle;
+			handle.CPU = Base.CPU + (uint64_t)index * IncrementSize;
+			handle.GPU = Base.IsShaderVisible() ? Base.GPU + (uint64_t)index * IncrementSize : 0;
+			return handle;
+		}
+	};
+
+	//A heap as seen by the allocators. NativeHeap is whatever the backend uses (an ID3D12DescriptorHeap* for D3D12).
+	struct DescriptorHeapInfo
+	{
+		void* NativeHeap = nullptr;
+		DescriptorHandle Start;
+		uint32_t NumDescriptors = 0;
+		uint32_t IncrementSize  = 0;
+	};
+
+	//The only things the allocators need from the device: to create/destroy heaps and to copy descriptors.
+	//Keeping the allocation policy behind this lets us test it without a device (see HT::CPUDescriptorHeapBackend).
+	class IDescriptorHeapBackend
+	{
+	public:
+		virtual ~IDescriptorHeapBackend() = default;
+
+		virtual DescriptorHeapInfo CreateHeap(DescriptorHeapType type, uint32_t numDescriptors, bool shaderVisible) = 0;
+		virtual void DestroyHeap(const DescriptorHeapInfo& heap) = 0;
+
+		//Copy count contiguous descriptors from source to destination (like ID3D12Device::CopyDescriptorsSimple).
+		virtual void CopyDescriptors(DescriptorHeapType type, DescriptorHandle destination, DescriptorHandle source, uint32_t count) = 0;
+	};
+
+	//Heaps made of fake addresses. Each heap gets its own address space so handles of different heaps never overlap.
+	//It also counts the heaps and copies, so we can check how many calls a policy generates.
+	class CPUDescriptorHeapBackend : public IDescriptorHeapBackend
+	{
+	public:
+		explicit CPUDescriptorHeapBackend(uint32_t incrementSize = 32) : m_IncrementSize(incrementSize) {}
+
+		DescriptorHeapInfo CreateHeap(DescriptorHeapType type, uint32_t numDescriptors, bool shaderVisible) override;
+		void DestroyHeap(const DescriptorHeapInfo& heap) override;
+		void CopyDescriptors(DescriptorHeapType type, DescriptorHandle destination, DescriptorHandle source, uint32_t count) override;
+
+		inline uint32_t GetLiveHeapCount()   const { return m_LiveHeaps; }
+		inline uint64_t GetCopyCallCount()   const { return m_CopyCalls; }
+		inline uint64_t GetCopiedDescriptorCount() const { return m_CopiedDescriptors; }
+
+	private:
+		uint32_t m_IncrementSize;
+		uint64_t m_NextBase = 1ull << 32;
+		uint32_t m_LiveHeaps = 0;
+		uint64_t m_CopyCalls = 0;
+		uint64_t m_CopiedDescriptors = 0;
+	};
+}
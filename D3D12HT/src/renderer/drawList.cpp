@@ -0,0 +1,114 @@
+#include "drawList.h"
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+
+namespace HT
+{
+	DrawList::DrawList()
+	{
+		for (DrawSortOrder& order : m_PassOrders)
+			order = DrawSortOrder::StateThenFrontToBack;
+	}
+
+	void DrawList::SetPassOrder(uint32_t pass, DrawSortOrder order)
+	{
+		D3D_ASSERT(pass < s_MaxPasses, "Draw pass out of range!");
+		m_PassOrders[pass] = order;
+	}
+
+	void DrawList::Reset()
+	{
+		m_Draws.clear();
+		m_Keys.clear();
+		m_SortedIndices.clear();
+	}
+
+	void DrawList::Add(const DrawPacket& draw)
+	{
+		m_Draws.push_back(draw);
+	}
+
+	void DrawList::Resize(uint32_t count)
+	{
+		m_Draws.resize(count);
+	}
+
+	void DrawList::Sort(JobSystem* jobSystem)
+	{
+		uint32_t count = (uint32_t)m_Draws.size();
+		m_Keys.resize(count);
+		m_SortedIndices.resize(count);
+
+		uint64_t encodeBegin = HTUtils::HTNowNanoseconds();
+
+		auto EncodeKeys = [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const DrawPacket& draw = m_Draws[i];
+				m_Keys[i] = DrawSortKey::Encode(draw, m_PassOrders[draw.Pass & (s_MaxPasses - 1)]);
+				m_SortedIndices[i] = i;
+			}
+		};
+
+		if (jobSystem && count >= RadixSorter::s_MinParallelCount)
+			jobSystem->ParallelFor(count, RadixSorter::s_MinChunkSize, EncodeKeys);
+		else
+			EncodeKeys(0, count);
+
+		uint64_t sortBegin = HTUtils::HTNowNanoseconds();
+		m_Sorter.Sort(m_Keys.data(), m_SortedIndices.data(), count, jobSystem);
+
+		m_Stats.DrawCount = count;
+		m_Stats.EncodeNs = sortBegin - encodeBegin;
+		m_Stats.SortNs = HTUtils::HTNowNanoseconds() - sortBegin;
+		m_Stats.Sort = m_Sorter.GetLastStats();
+		m_Sorted = true;
+	}
+
+	void DrawList::BuildUnsorted()
+	{
+		uint32_t count = (uint32_t)m_Draws.size();
+		m_Keys.clear();
+		m_SortedIndices.resize(count);
+
+		for (uint32_t i = 0; i < count; i++)
+			m_SortedIndices[i] = i;
+
+		m_Stats = {};
+		m_Stats.DrawCount = count;
+		m_Sorted = false;
+	}
+
+	void DrawList::GetPassRange(uint32_t pass, uint32_t& outBegin, uint32_t& outEnd) const
+	{
+		if (!m_Sorted)
+		{
+			outBegin = 0;
+			outEnd = (uint32_t)m_SortedIndices.size();
+			return;
+		}
+
+		//The pass is the top of the key, the keys of a pass are together. Two binary searches.
+		auto LowerBound = [this](uint32_t value)
+		{
+			uint32_t low = 0;
+			uint32_t high = (uint32_t)m_Keys.size();
+
+			while (low < high)
+			{
+				uint32_t middle = low + (high - low) / 2;
+				if (DrawSortKey::GetPass(m_Keys[middle]) < value)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			return low;
+		};
+
+		outBegin = LowerBound(pass);
+		outEnd = LowerBound(pass + 1);
+	}
+}
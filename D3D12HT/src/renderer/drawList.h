@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <core/radixSort.h>
+
+namespace HT
+{
+	//How the draws of a pass are ordered
+	enum class DrawSortOrder : uint8_t
+	{
+		//Opaque: by state (root signature, pipeline, material), then front to back inside the same state so early Z rejects more pixels
+		StateThenFrontToBack = 0,
+
+		//Transparent: back to front first, blending needs it. The state only breaks ties.
+		BackToFront,
+	};
+
+	//A draw as the renderer submits it. The ids are indices in tables of the recorder (see RecordDrawList), not API objects, so they fit in the sort key.
+	struct DrawPacket
+	{
+		uint8_t  Pass = 0;          //< DrawList::s_MaxPasses
+		uint8_t  RootSignature = 0; //< 64
+		uint16_t Pipeline = 0;      //< 16384
+		uint16_t Material = 0;      //The descriptor table of the material
+
+		//Distance from the camera, >= 0 (negative is 0)
+		float Depth = 0.0f;
+
+		uint64_t Constants = 0;     //GPU address of the constants of the draw
+		uint32_t VertexCount = 0;
+		uint32_t InstanceCount = 1;
+		uint32_t StartVertex = 0;
+		uint32_t StartInstance = 0;
+	};
+
+	//The 64 bits of a key, from the most significant bit:
+	//StateThenFrontToBack: pass (6) | root signature (6) | pipeline (14) | material (16) | depth (22)
+	//BackToFront:          pass (6) | ~depth (22)        | root signature (6) | pipeline (14) | material (16)
+	//The depth is the top 22 bits of the float (without the sign bit), positive floats sort like their bits, so it keeps the order with 14 bits of mantissa.
+	namespace DrawSortKey
+	{
+		constexpr uint32_t PassBits = 6;
+		constexpr uint32_t RootSignatureBits = 6;
+		constexpr uint32_t PipelineBits = 14;
+		constexpr uint32_t MaterialBits = 16;
+		constexpr uint32_t DepthBits = 22;
+
+		constexpr uint32_t PassShift = 64 - PassBits;
+
+		inline uint32_t QuantizeDepth(float depth)
+		{
+			uint32_t bits;
+			memcpy(&bits, &depth, sizeof(bits));
+
+			//Negative (and -0, -NaN) is 0
+			if (bits & 0x80000000u)
+				return 0;
+
+			return bits >> (31 - DepthBits);
+		}
+
+		inline uint64_t Encode(const DrawPacket& draw, DrawSortOrder order)
+		{
+			uint64_t state = ((uint64_t)(draw.RootSignature & ((1u << RootSignatureBits) - 1)) << (PipelineBits + MaterialBits)) |
+			                 ((uint64_t)(draw.Pipeline & ((1u << PipelineBits) - 1)) << MaterialBits) |
+			                 (uint64_t)draw.Material;
+
+			uint64_t depth = QuantizeDepth(draw.Depth);
+			uint64_t pass = (uint64_t)(draw.Pass & ((1u << PassBits) - 1)) << PassShift;
+
+			if (order == DrawSortOrder::StateThenFrontToBack)
+				return pass | (state << DepthBits) | depth;
+
+			return pass | ((~depth & ((1u << DepthBits) - 1)) << (RootSignatureBits + PipelineBits + MaterialBits)) | state;
+		}
+
+		inline uint32_t GetPass(uint64_t key) { return (uint32_t)(key >> PassShift); }
+	}
+
+	struct DrawListStats
+	{
+		uint32_t DrawCount = 0;
+		uint64_t EncodeNs = 0;
+		uint64_t SortNs = 0;
+		RadixSortStats Sort;
+	};
+
+	//The draws of a frame. They are added in any order (from any number of threads, with Resize and GetDraws), Sort encodes a key for each one
+	//and radix sorts the keys, then the recording walks the draws in the order of the keys (RecordDrawList).
+	//Only the keys and the indices move, the packets stay where they were written.
+	class DrawList
+	{
+	public:
+		static constexpr uint32_t s_MaxPasses = 1u << DrawSortKey::PassBits;
+
+		DrawList();
+
+		//Passes are StateThenFrontToBack unless told otherwise
+		void SetPassOrder(uint32_t pass, DrawSortOrder order);
+
+		//Keeps the memory
+		void Reset();
+
+		void Add(const DrawPacket& draw);
+
+		//For threads that write their own range of GetDraws()
+		void Resize(uint32_t count);
+		inline DrawPacket* GetDraws() { return m_Draws.data(); }
+
+		//Encodes the keys and sorts them (both in parallel with a job system, for big lists)
+		void Sort(JobSystem* jobSystem = nullptr);
+
+		//No sort, the draws are recorded in the order they were added (to compare against the sorted list). GetPassRange is the whole list.
+		void BuildUnsorted();
+
+		inline uint32_t GetCount() const { return (uint32_t)m_Draws.size(); }
+		inline const DrawPacket& GetDraw(uint32_t index) const { return m_Draws[index]; }
+
+		//After Sort (or BuildUnsorted): the index (in GetDraw) of the draw at each sorted position, and its key
+		inline uint32_t GetSortedIndex(uint32_t position) const { return m_SortedIndices[position]; }
+		inline uint64_t GetSortedKey(uint32_t position) const { return m_Keys[position]; }
+
+		//After Sort: the sorted positions [begin, end) of the draws of a pass
+		void GetPassRange(uint32_t pass, uint32_t& outBegin, uint32_t& outEnd) const;
+
+		inline const DrawListStats& GetStats() const { return m_Stats; }
+
+	private:
+		DrawSortOrder m_PassOrders[s_MaxPasses];
+
+		std::vector<DrawPacket> m_Draws;
+		std::vector<uint64_t> m_Keys;
+		std::vector<uint32_t> m_SortedIndices;
+
+		RadixSorter m_Sorter;
+		DrawListStats m_Stats;
+		bool m_Sorted = false;
+	};
+
+	//What was recorded, and what was not because the list already had it
+	struct DrawRecordStats
+	{
+		uint32_t Draws = 0;
+		uint32_t RootSignatureChanges = 0;
+		uint32_t PipelineChanges = 0;
+		uint32_t MaterialChanges = 0;
+		uint32_t ConstantChanges = 0;
+		uint32_t SkippedChanges = 0; //Calls that would have set what was already set
+
+		inline DrawRecordStats& operator+=(const DrawRecordStats& other)
+		{
+			Draws += other.Draws;
+			RootSignatureChanges += other.RootSignatureChanges;
+			PipelineChanges += other.PipelineChanges;
+			MaterialChanges += other.MaterialChanges;
+			ConstantChanges += other.ConstantChanges;
+			SkippedChanges += other.SkippedChanges;
+			return *this;
+		}
+
+		inline uint32_t GetStateChanges() const { return RootSignatureChanges + PipelineChanges + MaterialChanges + ConstantChanges; }
+	};
+
+	//Records the sorted draws [begin, end) and only sets the state that changed from the previous draw.
+	//The sink is what writes the commands (a D3D12 list, a null list...) and must have:
+	//  SetRootSignature(uint32_t), SetPipeline(uint32_t), SetMaterial(uint32_t), SetConstants(uint64_t), Draw(uint32_t drawIndex, const DrawPacket&)
+	//
+	//A command list doesn't inherit any state, so every list starts with nothing set (a call to this per list, or per chunk of a list that is recorded apart).
+	//Setting the root signature clears every root argument (as in D3D12), so the material and the constants are set again after it.
+	template<typename TSink>
+	DrawRecordStats RecordDrawList(const DrawList& list, uint32_t begin, uint32_t end, TSink& sink)
+	{
+		DrawRecordStats stats;
+
+		uint32_t rootSignature = ~0u;
+		uint32_t pipeline = ~0u;
+		uint32_t material = ~0u;
+		uint64_t constants = ~0ull;
+
+		for (uint32_t position = begin; position < end; position++)
+		{
+			uint32_t index = list.GetSortedIndex(position);
+			const DrawPacket& draw = list.GetDraw(index);
+
+			if (draw.RootSignature != rootSignature)
+			{
+				sink.SetRootSignature(draw.RootSignature);
+				rootSignature = draw.RootSignature;
+				material = ~0u;
+				constants = ~0ull;
+				stats.RootSignatureChanges++;
+			}
+			else
+				stats.SkippedChanges++;
+
+			if (draw.Pipeline != pipeline)
+			{
+				sink.SetPipeline(draw.Pipeline);
+				pipeline = draw.Pipeline;
+				stats.PipelineChanges++;
+			}
+			else
+				stats.SkippedChanges++;
+
+			if (draw.Material != material)
+			{
+				sink.SetMaterial(draw.Material);
+				material = draw.Material;
+				stats.MaterialChanges++;
+			}
+			else
+				stats.SkippedChanges++;
+
+			if (draw.Constants != constants)
+			{
+				sink.SetConstants(draw.Constants);
+				constants = draw.Constants;
+				stats.ConstantChanges++;
+			}
+			else
+				stats.SkippedChanges++;
+
+			sink.Draw(index, draw);
+			stats.Draws++;
+		}
+
+		return stats;
+	}
+}
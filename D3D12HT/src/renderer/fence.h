@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace HT
+{
+	//A fence is a counter shared between the CPU and a queue. The CPU asks the queue to Signal a value, this value is written by the queue
+	//once it has executed everything that was submitted before the Signal. So, when the completed value reaches a value we signaled, we know
+	//that all the work before it is done and the resources it used can be reused.
+	//
+	//The frame pacing logic only needs those three operations, so it talks with this interface instead of an ID3D12Fence.
+	//The D3D12 one is HT::D3D12Fence and we also have a HT::CPUFence that is driven by the CPU (for tests and for the null backend).
+	class IFence
+	{
+	public:
+		virtual ~IFence() = default;
+
+		//Enqueue a signal with the next value and return this value. The value is only "completed" once the queue reaches it.
+		virtual uint64_t Signal() = 0;
+
+		//The last value that the queue has reached.
+		virtual uint64_t GetCompletedValue() const = 0;
+
+		//The last value that we asked the queue to signal.
+		virtual uint64_t GetLastSignaledValue() const = 0;
+
+		//Block the calling thread until the completed value is at least the value.
+		virtual void WaitForValue(uint64_t value) = 0;
+
+		inline bool IsComplete(uint64_t value) const { return GetCompletedValue() >= value; }
+		inline void WaitForIdle() { WaitForValue(GetLastSignaledValue()); }
+	};
+}
@@ -0,0 +1,449 @@
+#include "frameGraph.h"
+
+#include <algorithm>
+#include <queue>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	// -------------- FrameGraphPassContext
+
+	ResourceId FrameGraphPassContext::GetPhysical(FrameGraphHandle handle) const
+	{
+		return m_Graph.GetResource(handle).Physical;
+	}
+
+	bool FrameGraphPassContext::NeedsInitialization(FrameGraphHandle handle) const
+	{
+		const FrameGraphCompiledResource& resource = m_Graph.GetResource(handle);
+		return resource.Aliases && resource.FirstPass == m_PassOrder;
+	}
+
+	// -------------- PassBuilder
+
+	FrameGraphHandle FrameGraph::PassBuilder::Read(FrameGraphHandle handle, ResourceState state)
+	{
+		D3D_ASSERT(handle.IsValid() && handle.Resource < m_Graph.m_Resources.size(), "Reading an invalid frame graph resource!");
+		D3D_ASSERT(handle.Version < m_Graph.m_Versions[handle.Resource].size(), "Reading a version that was never written!");
+
+		m_Graph.m_Passes[m_PassIndex].Reads.push_back({ handle, state });
+		m_Graph.m_Versions[handle.Resource][handle.Version].Readers.push_back(m_PassIndex);
+
+		return handle;
+	}
+
+	FrameGraphHandle FrameGraph::PassBuilder::Write(FrameGraphHandle handle, ResourceState state)
+	{
+		D3D_ASSERT(handle.IsValid() && handle.Resource < m_Graph.m_Resources.size(), "Writing an invalid frame graph resource!");
+
+		std::vector<VersionInfo>& versions = m_Graph.m_Versions[handle.Resource];
+
+		//Writing an old version would fork the resource in two different contents, we don't support it.
+		D3D_ASSERT(handle.Version + 1 == versions.size(), "Only the latest version of a resource can be written!");
+
+		VersionInfo newVersion;
+		newVersion.Producer = m_PassIndex;
+		versions.push_back(newVersion);
+
+		FrameGraphHandle written = { handle.Resource, handle.Version + 1 };
+		m_Graph.m_Passes[m_PassIndex].Writes.push_back({ written, state });
+
+		return written;
+	}
+
+	FrameGraphHandle FrameGraph::PassBuilder::CreateTransient(const char* name, const FrameGraphResourceDesc& desc)
+	{
+		return m_Graph.CreateTransient(name, desc);
+	}
+
+	void FrameGraph::PassBuilder::SetSideEffect()
+	{
+		m_Graph.m_Passes[m_PassIndex].SideEffect = true;
+	}
+
+	// -------------- FrameGraph
+
+	FrameGraph::FrameGraph(uint64_t maxHeapSize) : m_MaxHeapSize(maxHeapSize)
+	{
+	}
+
+	FrameGraphHandle FrameGraph::Import(const char* name, ResourceId physical, ResourceState initialState)
+	{
+		FrameGraphCompiledResource resource;
+		resource.Name = name;
+		resource.Imported = true;
+		resource.Physical = physical;
+		resource.InitialState = initialState;
+
+		m_Resources.push_back(resource);
+		m_Versions.emplace_back(1);
+
+		return { (uint32_t)m_Resources.size() - 1, 0 };
+	}
+
+	FrameGraphHandle FrameGraph::CreateTransient(const char* name, const FrameGraphResourceDesc& desc)
+	{
+		D3D_ASSERT(desc.Size > 0 && HTUtils::HTIsPowerOfTwo(desc.Alignment), "Invalid transient resource description!");
+
+		FrameGraphCompiledResource resource;
+		resource.Name = name;
+		resource.Desc = desc;
+
+		m_Resources.push_back(resource);
+		m_Versions.emplace_back(1);
+
+		return { (uint32_t)m_Resources.size() - 1, 0 };
+	}
+
+	uint32_t FrameGraph::AddPass(const char* name, const std::function<void(PassBuilder& builder)>& setup, ExecuteFunction execute)
+	{
+		uint32_t passIndex = (uint32_t)m_Passes.size();
+
+		Pass pass;
+		pass.Name = name;
+		pass.Execute = std::move(execute);
+		m_Passes.push_back(std::move(pass));
+
+		PassBuilder builder(*this, passIndex);
+		setup(builder);
+
+		return passIndex;
+	}
+
+	void FrameGraph::MarkOutput(FrameGraphHandle handle)
+	{
+		D3D_ASSERT(handle.IsValid() && handle.Resource < m_Resources.size(), "Invalid frame graph output!");
+
+		m_Outputs.push_back(handle);
+		m_Resources[handle.Resource].Output = true;
+	}
+
+	void FrameGraph::SetPhysical(FrameGraphHandle handle, ResourceId physical)
+	{
+		m_Resources[handle.Resource].Physical = physical;
+	}
+
+	void FrameGraph::Compile()
+	{
+		m_Stats = {};
+		m_Stats.DeclaredPasses = (uint32_t)m_Passes.size();
+
+		CullPasses();
+		SortPasses();
+		ComputeLifetimes();
+		AliasTransientResources();
+
+		m_Compiled = true;
+	}
+
+	void FrameGraph::CullPasses()
+	{
+		//We walk backwards from what must be kept: the passes with side effects and the producers of the outputs.
+		//Every pass that produced a version read by a kept pass is kept too.
+		std::vector<uint32_t> worklist;
+
+		auto Keep = [this, &worklist](uint32_t passIndex)
+		{
+			if (passIndex != FrameGraphHandle::s_Invalid && !m_Passes[passIndex].Alive)
+			{
+				m_Passes[passIndex].Alive = true;
+				worklist.push_back(passIndex);
+			}
+		};
+
+		for (uint32_t i = 0; i < (uint32_t)m_Passes.size(); i++)
+		{
+			m_Passes[i].Alive = false;
+
+			if (m_Passes[i].SideEffect)
+				Keep(i);
+		}
+
+		for (const FrameGraphHandle& output : m_Outputs)
+			Keep(m_Versions[output.Resource][output.Version].Producer);
+
+		while (!worklist.empty())
+		{
+			uint32_t passIndex = worklist.back();
+			worklist.pop_back();
+
+			for (const Access& read : m_Passes[passIndex].Reads)
+				Keep(m_Versions[read.Handle.Resource][read.Handle.Version].Producer);
+		}
+
+		for (const Pass& pass : m_Passes)
+			m_Stats.CulledPasses += pass.Alive ? 0 : 1;
+	}
+
+	void FrameGraph::SortPasses()
+	{
+		uint32_t passCount = (uint32_t)m_Passes.size();
+
+		std::vector<std::vector<uint32_t>> edges(passCount);
+		std::vector<uint32_t> inDegree(passCount, 0);
+
+		auto AddEdge = [&edges, &inDegree](uint32_t from, uint32_t to)
+		{
+			if (from != to)
+			{
+				edges[from].push_back(to);
+				inDegree[to]++;
+			}
+		};
+
+		//For each resource, in version order:
+		//- The producer of a version runs before its readers (read after write).
+		//- The readers of a version run before the next kept writer (write after read).
+		//- Writers run in order (write after write).
+		for (uint32_t r = 0; r < (uint32_t)m_Resources.size(); r++)
+		{
+			uint32_t lastProducer = FrameGraphHandle::s_Invalid;
+			std::vector<uint32_t> readersSinceLastProducer;
+
+			for (const VersionInfo& version : m_Versions[r])
+			{
+				bool producerAlive = version.Producer != FrameGraphHandle::s_Invalid && m_Passes[version.Producer].Alive;
+
+				if (producerAlive)
+				{
+					if (lastProducer != FrameGraphHandle::s_Invalid)
+						AddEdge(lastProducer, version.Producer);
+
+					for (uint32_t reader : readersSinceLastProducer)
+						AddEdge(reader, version.Producer);
+
+					readersSinceLastProducer.clear();
+					lastProducer = version.Producer;
+				}
+
+				for (uint32_t reader : version.Readers)
+				{
+					if (!m_Passes[reader].Alive)
+						continue;
+
+					if (producerAlive)
+						AddEdge(version.Producer, reader);
+
+					readersSinceLastProducer.push_back(reader);
+				}
+			}
+		}
+
+		//Kahn's algorithm. Among the passes that are ready, we always take the one declared first, so when the declaration order is valid we keep it.
+		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+
+		uint32_t aliveCount = 0;
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			if (!m_Passes[i].Alive)
+				continue;
+
+			aliveCount++;
+
+			if (inDegree[i] == 0)
+				ready.push(i);
+		}
+
+		m_ExecutionOrder.clear();
+		m_ExecutionOrder.reserve(aliveCount);
+
+		while (!ready.empty())
+		{
+			uint32_t passIndex = ready.top();
+			ready.pop();
+
+			m_ExecutionOrder.push_back(passIndex);
+
+			for (uint32_t next : edges[passIndex])
+			{
+				if (--inDegree[next] == 0)
+					ready.push(next);
+			}
+		}
+
+		D3D_ASSERT(m_ExecutionOrder.size() == aliveCount, "The frame graph has a cycle!");
+	}
+
+	void FrameGraph::ComputeLifetimes()
+	{
+		for (FrameGraphCompiledResource& resource : m_Resources)
+			resource.Used = false;
+
+		for (uint32_t order = 0; order < (uint32_t)m_ExecutionOrder.size(); order++)
+		{
+			const Pass& pass = m_Passes[m_ExecutionOrder[order]];
+
+			auto Touch = [this, order](const Access& access)
+			{
+				FrameGraphCompiledResource& resource = m_Resources[access.Handle.Resource];
+
+				if (!resource.Used)
+				{
+					resource.Used = true;
+					resource.FirstPass = order;
+				}
+
+				resource.LastPass = order;
+			};
+
+			for (const Access& read : pass.Reads)
+				Touch(read);
+
+			for (const Access& write : pass.Writes)
+				Touch(write);
+		}
+	}
+
+	void FrameGraph::AliasTransientResources()
+	{
+		std::vector<uint32_t> transients;
+
+		for (Pass& pass : m_Passes)
+			pass.AliasedResources.clear();
+
+		for (uint32_t i = 0; i < (uint32_t)m_Resources.size(); i++)
+		{
+			FrameGraphCompiledResource& resource = m_Resources[i];
+			resource.Aliases = false;
+
+			if (resource.Imported || !resource.Used)
+				continue;
+
+			transients.push_back(i);
+			m_Stats.TransientResources++;
+			m_Stats.TransientBytesWithoutAliasing += HTUtils::HTAlignUp(resource.Desc.Size, resource.Desc.Alignment);
+		}
+
+		//Placing the big resources first leaves the small ones to fill the holes
+		std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+		{
+			return m_Resources[a].Desc.Size > m_Resources[b].Desc.Size;
+		});
+
+		struct Placed
+		{
+			uint64_t Offset;
+			uint64_t Size;
+			uint32_t FirstPass;
+			uint32_t LastPass;
+		};
+
+		std::vector<std::vector<Placed>> heaps;
+		m_HeapSizes.clear();
+
+		std::vector<Placed> conflicts;
+
+		for (uint32_t index : transients)
+		{
+			FrameGraphCompiledResource& resource = m_Resources[index];
+			bool placed = false;
+
+			for (uint32_t h = 0; h < (uint32_t)heaps.size() && !placed; h++)
+			{
+				//Only resources alive at the same time compete for memory
+				conflicts.clear();
+				for (const Placed& other : heaps[h])
+				{
+					if (other.FirstPass <= resource.LastPass && resource.FirstPass <= other.LastPass)
+						conflicts.push_back(other);
+				}
+
+				std::sort(conflicts.begin(), conflicts.end(), [](const Placed& a, const Placed& b) { return a.Offset < b.Offset; });
+
+				//First fit: the lowest offset that doesn't overlap any conflicting resource
+				uint64_t offset = 0;
+				for (const Placed& other : conflicts)
+				{
+					if (offset + resource.Desc.Size <= other.Offset)
+						break;
+
+					offset = HTUtils::HTMax(offset, HTUtils::HTAlignUp(other.Offset + other.Size, resource.Desc.Alignment));
+				}
+
+				if (offset + resource.Desc.Size > m_MaxHeapSize)
+					continue;
+
+				resource.HeapIndex = h;
+				resource.HeapOffset = offset;
+				heaps[h].push_back({ offset, resource.Desc.Size, resource.FirstPass, resource.LastPass });
+				m_HeapSizes[h] = HTUtils::HTMax(m_HeapSizes[h], offset + resource.Desc.Size);
+				placed = true;
+			}
+
+			if (!placed)
+			{
+				resource.HeapIndex = (uint32_t)heaps.size();
+				resource.HeapOffset = 0;
+				heaps.push_back({ { 0, resource.Desc.Size, resource.FirstPass, resource.LastPass } });
+				m_HeapSizes.push_back(resource.Desc.Size);
+			}
+		}
+
+		//A resource aliases if it shares memory with another one that was used before it
+		for (uint32_t a : transients)
+		{
+			FrameGraphCompiledResource& resource = m_Resources[a];
+
+			for (uint32_t b : transients)
+			{
+				const FrameGraphCompiledResource& other = m_Resources[b];
+
+				bool sameMemory = a != b && other.HeapIndex == resource.HeapIndex &&
+					other.HeapOffset < resource.HeapOffset + resource.Desc.Size && resource.HeapOffset < other.HeapOffset + other.Desc.Size;
+
+				if (sameMemory && other.LastPass < resource.FirstPass)
+				{
+					resource.Aliases = true;
+					m_Passes[m_ExecutionOrder[resource.FirstPass]].AliasedResources.push_back(a);
+					break;
+				}
+			}
+		}
+
+		for (uint64_t heapSize : m_HeapSizes)
+			m_Stats.TransientBytesWithAliasing += heapSize;
+	}
+
+	void FrameGraph::Execute(ResourceStateTracker& tracker, const std::function<void(const std::vector<ResourceBarrier>&)>& submitBarriers, void* userContext)
+	{
+		D3D_ASSERT(m_Compiled, "Compile the frame graph before executing it!");
+
+		FrameGraphPassContext context(*this, userContext);
+
+		for (uint32_t order = 0; order < (uint32_t)m_ExecutionOrder.size(); order++)
+		{
+			Pass& pass = m_Passes[m_ExecutionOrder[order]];
+			context.m_PassOrder = order;
+
+			//The memory was used by another resource, the aliasing barrier goes before the transitions of the same batch
+			for (uint32_t resource : pass.AliasedResources)
+				tracker.AliasingBarrier(m_Resources[resource].Physical);
+
+			for (const Access& read : pass.Reads)
+				tracker.Transition(m_Resources[read.Handle.Resource].Physical, read.State);
+
+			for (const Access& write : pass.Writes)
+				tracker.Transition(m_Resources[write.Handle.Resource].Physical, write.State);
+
+			submitBarriers(tracker.FlushBarriers());
+
+			if (pass.Execute)
+				pass.Execute(context);
+		}
+	}
+
+	void FrameGraph::Reset()
+	{
+		m_Passes.clear();
+		m_Resources.clear();
+		m_Versions.clear();
+		m_Outputs.clear();
+		m_ExecutionOrder.clear();
+		m_HeapSizes.clear();
+
+		m_Compiled = false;
+		m_Stats = {};
+	}
+}
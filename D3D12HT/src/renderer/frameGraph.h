@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <renderer/resourceStateTracker.h>
+
+namespace HT
+{
+	//A handle to a version of a frame graph resource. Every write creates a new version, this is how the graph knows
+	//who produces what each pass reads (a pass reading version 1 must run after the pass that wrote version 1, and before the one that writes version 2).
+	struct FrameGraphHandle
+	{
+		static constexpr uint32_t s_Invalid = ~0u;
+
+		uint32_t Resource = s_Invalid;
+		uint32_t Version  = 0;
+
+		inline bool IsValid() const { return Resource != s_Invalid; }
+	};
+
+	//What the graph needs to know to place a transient resource in a heap. 
+	//For D3D12 it comes from ID3D12Device::GetResourceAllocationInfo.
+	struct FrameGraphResourceDesc
+	{
+		uint64_t Size      = 0;
+		uint64_t Alignment = 65536;
+	};
+
+	struct FrameGraphCompiledResource
+	{
+		std::string Name;
+		FrameGraphResourceDesc Desc;
+		bool Imported = false;
+		bool Output = false;
+
+		//First and last pass (in execution order) that use the resource. Only transient resources that are used get a place in a heap.
+		bool Used = false;
+		uint32_t FirstPass = 0;
+		uint32_t LastPass = 0;
+
+		uint32_t HeapIndex = 0;
+		uint64_t HeapOffset = 0;
+
+		//True if this resource shares memory with a resource used before it. Its content is garbage at the first use, 
+		//so it needs an aliasing barrier (and a clear/discard) before it.
+		bool Aliases = false;
+
+		//The real resource, the one the barriers and the passes use. Imported resources have it from the start, 
+		//the transient ones get it after Compile (whoever creates the placed resources sets it).
+		ResourceId Physical = 0;
+
+		ResourceState InitialState = ResourceState::Common;
+	};
+
+	struct FrameGraphStats
+	{
+		uint32_t DeclaredPasses = 0;
+		uint32_t CulledPasses   = 0;
+		uint32_t TransientResources = 0;
+		uint64_t TransientBytesWithoutAliasing = 0;
+		uint64_t TransientBytesWithAliasing    = 0; //The sum of the heap sizes
+	};
+
+	class FrameGraph;
+
+	//Given to the execute function of a pass
+	class FrameGraphPassContext
+	{
+	public:
+		FrameGraphPassContext(const FrameGraph& graph, void* userContext) : m_Graph(graph), m_UserContext(userContext) {}
+
+		ResourceId GetPhysical(FrameGraphHandle handle) const;
+		inline void* GetUserContext() const { return m_UserContext; }
+
+		//True in the first pass of a resource that aliases (see FrameGraphCompiledResource::Aliases). Its content is garbage,
+		//the pass must clear it, discard it or write all of it before anything reads it.
+		bool NeedsInitialization(FrameGraphHandle handle) const;
+
+	private:
+		friend class FrameGraph;
+
+		const FrameGraph& m_Graph;
+		void* m_UserContext;
+		uint32_t m_PassOrder = 0;
+	};
+
+	//Before, everything was recorded inline in Render. To add passes we would need to manage the lifetime and the barriers of each resource by hand.
+	//With the frame graph, each pass only declares what it reads and writes (and in which state). Then Compile:
+	//- Culls the passes whose results nobody uses (a pass is kept if it has side effects or if it writes something a kept pass reads or an output).
+	//- Orders the passes topologically (Kahn's algorithm, ties broken by declaration order so the result is deterministic).
+	//- Computes the lifetime of each transient resource and packs them into heaps. Resources whose lifetimes don't overlap share memory (aliasing).
+	//
+	//Compile is pure CPU and it doesn't know about D3D12, so it can be tested and benchmarked anywhere. 
+	//Execute then runs the passes in order, asking the state tracker for the barriers of each pass (and an aliasing barrier before the first use of a resource that aliases).
+	class FrameGraph
+	{
+	public:
+		using ExecuteFunction = std::function<void(FrameGraphPassContext& context)>;
+
+		class PassBuilder
+		{
+		public:
+			FrameGraphHandle Read(FrameGraphHandle handle, ResourceState state);
+
+			//Returns the new version of the resource, the passes that read the result must read this one.
+			FrameGraphHandle Write(FrameGraphHandle handle, ResourceState state);
+
+			FrameGraphHandle CreateTransient(const char* name, const FrameGraphResourceDesc& desc);
+
+			//The pass does something outside of the graph (e.g: readback, present), it is never culled.
+			void SetSideEffect();
+
+		private:
+			friend class FrameGraph;
+			PassBuilder(FrameGraph& graph, uint32_t passIndex) : m_Graph(graph), m_PassIndex(passIndex) {}
+
+			FrameGraph& m_Graph;
+			uint32_t m_PassIndex;
+		};
+
+		//The heaps for the transient resources are at most this big. A resource bigger than that gets a heap for itself.
+		explicit FrameGraph(uint64_t maxHeapSize = 256ull * 1024 * 1024);
+
+		FrameGraphHandle Import(const char* name, ResourceId physical, ResourceState initialState = ResourceState::Common);
+		FrameGraphHandle CreateTransient(const char* name, const FrameGraphResourceDesc& desc);
+
+		uint32_t AddPass(const char* name, const std::function<void(PassBuilder& builder)>& setup, ExecuteFunction execute);
+
+		//The passes that write this resource (up to this version) are kept alive.
+		void MarkOutput(FrameGraphHandle handle);
+
+		void Compile();
+
+		//Runs the passes. submitBarriers is called with the barriers each pass needs, right before it.
+		void Execute(ResourceStateTracker& tracker, const std::function<void(const std::vector<ResourceBarrier>&)>& submitBarriers, void* userContext = nullptr);
+
+		//Clears all passes and resources, to build the graph of the next frame.
+		void Reset();
+
+		void SetPhysical(FrameGraphHandle handle, ResourceId physical);
+
+		inline const FrameGraphCompiledResource& GetResource(FrameGraphHandle handle) const { return m_Resources[handle.Resource]; }
+		inline const std::vector<uint32_t>& GetExecutionOrder() const { return m_ExecutionOrder; }
+		inline const std::vector<uint64_t>& GetHeapSizes() const { return m_HeapSizes; }
+		inline const FrameGraphStats& GetStats() const { return m_Stats; }
+		inline uint32_t GetResourceCount() const { return (uint32_t)m_Resources.size(); }
+
+		const char* GetPassName(uint32_t passIndex) const { return m_Passes[passIndex].Name.c_str(); }
+		bool IsPassCulled(uint32_t passIndex) const { return !m_Passes[passIndex].Alive; }
+
+	private:
+		struct Access
+		{
+			FrameGraphHandle Handle;
+			ResourceState State;
+		};
+
+		struct Pass
+		{
+			std::string Name;
+			ExecuteFunction Execute;
+			std::vector<Access> Reads;
+			std::vector<Access> Writes;
+			bool SideEffect = false;
+			bool Alive = false;
+
+			//The resources that alias and are used for the first time in this pass
+			std::vector<uint32_t> AliasedResources;
+		};
+
+		//Per resource, who produced each version and who read it
+		struct VersionInfo
+		{
+			uint32_t Producer = FrameGraphHandle::s_Invalid;
+			std::vector<uint32_t> Readers;
+		};
+
+		void CullPasses();
+		void SortPasses();
+		void ComputeLifetimes();
+		void AliasTransientResources();
+
+	private:
+		uint64_t m_MaxHeapSize;
+
+		std::vector<Pass> m_Passes;
+		std::vector<FrameGraphCompiledResource> m_Resources;
+		std::vector<std::vector<VersionInfo>> m_Versions;
+		std::vector<FrameGraphHandle> m_Outputs;
+
+		std::vector<uint32_t> m_ExecutionOrder;
+		std::vector<uint64_t> m_HeapSizes;
+
+		bool m_Compiled = false;
+		FrameGraphStats m_Stats;
+	};
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+
+#include <renderer/fence.h>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	//LowLatency     - The CPU can't be more than one frame ahead of the GPU. Less frames queued = less input lag, but the CPU and GPU overlap less.
+	//HighThroughput - The CPU can run as many frames ahead as we have frames in flight. Better to keep the GPU always busy.
+	enum class FramePacingMode : uint8_t
+	{
+		LowLatency = 0,
+		HighThroughput
+	};
+
+	//When the frames don't need anything besides the fence value
+	struct FrameRingNoResources {};
+
+	//Before, we had a fixed array of command allocators and fence values (one for each back buffer) and we waited on the fence of the next back buffer.
+	//This ring does the same thing, but it is not tied to the back buffers anymore:
+	//
+	//- It has N slots, each slot owns the resources of a frame (TFrameResources: a command allocator, transient memory etc...) and the fence value that
+	//  tells us when the GPU is done with them. Only the first "frames in flight" slots are used, and this can be changed at runtime (1 to N).
+	//- We can also limit how many frames the CPU can queue ahead of the GPU (max frame latency). With 3 frames in flight and a latency of 1, 
+	//  we still rotate between 3 sets of resources but the CPU waits until the previous frame is done before starting a new one.
+	//- It measures how long the CPU stalled on each slot, so we know if we are GPU bound.
+	//
+	//The fence is an IFence, so the ring can be driven by a CPUFence when there is no GPU.
+	template<uint32_t N, typename TFrameResources = FrameRingNoResources>
+	class FrameRing
+	{
+	public:
+		static_assert(N > 0, "FrameRing needs at least one slot.");
+
+		static constexpr uint32_t s_MaxFramesInFlight = N;
+
+		struct Slot
+		{
+			TFrameResources Resources = {};
+
+			//The fence value signaled after the last frame that used this slot. The resources can be reused once it is completed.
+			uint64_t FenceValue = 0;
+
+			//How long BeginFrame had to wait for this slot (the last time and in total).
+			uint64_t LastStallNs  = 0;
+			uint64_t TotalStallNs = 0;
+			uint64_t StallCount   = 0;
+		};
+
+		FrameRing(IFence* fence, uint32_t framesInFlight = N, FramePacingMode pacingMode = FramePacingMode::HighThroughput)
+			: m_Fence(fence)
+		{
+			D3D_ASSERT(fence, "FrameRing needs a fence!");
+
+			SetFramesInFlight(framesInFlight);
+			SetPacingMode(pacingMode);
+		}
+
+		//Wait until we can record a new frame and return the slot we are going to use.
+		//This is where the CPU stalls when it is too far ahead of the GPU.
+		Slot& BeginFrame()
+		{
+			D3D_ASSERT(!m_InFrame, "BeginFrame called twice without EndFrame!");
+
+			m_CurrentSlot = (uint32_t)(m_FrameIndex % m_FramesInFlight);
+			Slot& slot = m_Slots[m_CurrentSlot];
+
+			//We have to wait for two things. The resources of this slot must be free and we can't have more than m_MaxFrameLatency frames queued.
+			uint64_t valueToWait = slot.FenceValue;
+
+			if (m_FrameIndex >= m_MaxFrameLatency)
+				valueToWait = HTUtils::HTMax(valueToWait, m_SubmittedFenceValues[(m_FrameIndex - m_MaxFrameLatency) % N]);
+
+			slot.LastStallNs = 0;
+
+			if (!m_Fence->IsComplete(valueToWait))
+			{
+				uint64_t stallBegin = HTUtils::HTNowNanoseconds();
+				m_Fence->WaitForValue(valueToWait);
+				slot.LastStallNs = HTUtils::HTNowNanoseconds() - stallBegin;
+
+				slot.TotalStallNs += slot.LastStallNs;
+				slot.StallCount++;
+			}
+
+			m_InFrame = true;
+			return slot;
+		}
+
+		//Signal the fence after all the work of this frame has been submitted. Returns the signaled value.
+		uint64_t EndFrame()
+		{
+			D3D_ASSERT(m_InFrame, "EndFrame called without BeginFrame!");
+
+			uint64_t fenceValue = m_Fence->Signal();
+
+			m_Slots[m_CurrentSlot].FenceValue = fenceValue;
+			m_SubmittedFenceValues[m_FrameIndex % N] = fenceValue;
+
+			m_FrameIndex++;
+			m_InFrame = false;
+
+			return fenceValue;
+		}
+
+		//Changing the number of frames in flight doesn't need a flush. Each slot remembers the fence of the last frame that used it, so when
+		//a slot comes back into use we still wait for the right value.
+		void SetFramesInFlight(uint32_t framesInFlight)
+		{
+			D3D_ASSERT(framesInFlight >= 1 && framesInFlight <= N, "Frames in flight out of range!");
+			D3D_ASSERT(!m_InFrame, "Can't change the frames in flight in the middle of a frame!");
+
+			m_FramesInFlight = framesInFlight;
+			ApplyPacingMode();
+		}
+
+		//The latency is clamped by the number of frames in flight, since we can't queue more frames than we have resources for.
+		//In LowLatency mode it is always 1.
+		void SetMaxFrameLatency(uint32_t maxFrameLatency)
+		{
+			D3D_ASSERT(maxFrameLatency >= 1, "We need at least one frame of latency!");
+
+			m_RequestedMaxFrameLatency = maxFrameLatency;
+			ApplyPacingMode();
+		}
+
+		void SetPacingMode(FramePacingMode pacingMode)
+		{
+			m_PacingMode = pacingMode;
+			ApplyPacingMode();
+		}
+
+		void WaitForIdle()
+		{
+			m_Fence->WaitForIdle();
+		}
+
+		//Useful to create/destroy the resources of every slot.
+		template<typename TFunction>
+		void ForEachSlot(TFunction function)
+		{
+			for (uint32_t i = 0; i < N; i++)
+				function(m_Slots[i], i);
+		}
+
+		inline Slot& GetCurrentSlot() { return m_Slots[m_CurrentSlot]; }
+		inline Slot& GetSlot(uint32_t index) { return m_Slots[index]; }
+		inline const Slot& GetSlot(uint32_t index) const { return m_Slots[index]; }
+
+		inline uint32_t GetCurrentSlotIndex()  const { return m_CurrentSlot; }
+		inline uint32_t GetFramesInFlight()    const { return m_FramesInFlight; }
+		inline uint32_t GetMaxFrameLatency()   const { return m_MaxFrameLatency; }
+		inline uint64_t GetFrameIndex()        const { return m_FrameIndex; }
+		inline FramePacingMode GetPacingMode() const { return m_PacingMode; }
+		inline IFence* GetFence()              const { return m_Fence; }
+
+	private:
+		void ApplyPacingMode()
+		{
+			m_MaxFrameLatency = (m_PacingMode == FramePacingMode::LowLatency) ? 1 : HTUtils::HTMin(m_RequestedMaxFrameLatency, m_FramesInFlight);
+		}
+
+	private:
+		IFence* m_Fence;
+
+		Slot m_Slots[N];
+
+		//The fence values of the last N frames, indexed by frame index. This is what we use to bound the latency,
+		//because the slot of frame "i - latency" depends on how many frames in flight we had at that time.
+		uint64_t m_SubmittedFenceValues[N] = {};
+
+		uint64_t m_FrameIndex = 0;
+		uint32_t m_CurrentSlot = 0;
+		uint32_t m_FramesInFlight = N;
+		uint32_t m_MaxFrameLatency = N;
+		uint32_t m_RequestedMaxFrameLatency = N;
+		FramePacingMode m_PacingMode = FramePacingMode::HighThroughput;
+		bool m_InFrame = false;
+	};
+}
@@ -0,0 +1,285 @@
+#include "gpuHeapAllocator.h"
+
+#include <algorithm>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	const char* GPUHeapTypeName(GPUHeapType type)
+	{
+		switch (type)
+		{
+		case GPUHeapType::Default:  return "default";
+		case GPUHeapType::Upload:   return "upload";
+		case GPUHeapType::Readback: return "readback";
+		default:                    return "unknown";
+		}
+	}
+
+	const char* GPUHeapCategoryName(GPUHeapCategory category)
+	{
+		switch (category)
+		{
+		case GPUHeapCategory::Buffers:       return "buffers";
+		case GPUHeapCategory::Textures:      return "textures";
+		case GPUHeapCategory::RenderTargets: return "render_targets";
+		default:                             return "unknown";
+		}
+	}
+
+	void* CPUGPUHeapBackend::CreateHeap(const GPUHeapDesc& desc)
+	{
+		void* heap = reinterpret_cast<void*>(m_NextId++);
+		m_Heaps.push_back({ heap, desc.Size });
+
+		m_LiveHeaps++;
+		m_CreateHeapCalls++;
+		m_LiveHeapBytes += desc.Size;
+		return heap;
+	}
+
+	void CPUGPUHeapBackend::DestroyHeap(void* heap)
+	{
+		auto it = std::find_if(m_Heaps.begin(), m_Heaps.end(), [heap](const std::pair<void*, uint64_t>& entry) { return entry.first == heap; });
+		D3D_ASSERT(it != m_Heaps.end(), "Destroying a heap that doesn't exist!");
+
+		m_LiveHeaps--;
+		m_LiveHeapBytes -= it->second;
+
+		*it = m_Heaps.back();
+		m_Heaps.pop_back();
+	}
+
+	GPUHeapAllocator::GPUHeapAllocator(IGPUHeapBackend* backend, ResidencyManager* residencyManager, const GPUHeapAllocatorDesc& desc)
+		: m_Backend(backend), m_ResidencyManager(residencyManager), m_Desc(desc)
+	{
+		D3D_ASSERT(backend, "The GPU heap allocator needs a backend!");
+		D3D_ASSERT(HTUtils::HTIsPowerOfTwo(desc.MinAlignment) && HTUtils::HTIsPowerOfTwo(desc.HeapAlignment), "The alignments must be powers of two!");
+		D3D_ASSERT(desc.SmallMaxSize <= desc.SmallHeapSize && desc.MediumMaxSize <= desc.MediumHeapSize, "A size class must fit in its heaps!");
+		D3D_ASSERT(desc.SmallMaxSize <= desc.MediumMaxSize, "The small size class must be smaller than the medium one!");
+	}
+
+	GPUHeapAllocator::~GPUHeapAllocator()
+	{
+		//The GPU must be idle by now, the pending ranges are just dropped with their heaps
+		D3D_ASSERT(GetStats().AllocationCount == (uint32_t)m_PendingFrees.size(), "GPU allocations still alive when destroying the heap allocator!");
+
+		for (uint32_t i = 0; i < (uint32_t)m_Heaps.size(); i++)
+		{
+			if (m_Heaps[i].NativeHeap)
+				DestroyHeap(i);
+		}
+	}
+
+	uint32_t GPUHeapAllocator::CreateHeap(uint64_t size, GPUHeapType type, GPUHeapCategory category, uint32_t pool, bool dedicated)
+	{
+		GPUHeapDesc desc;
+		desc.Size = size;
+		desc.Alignment = m_Desc.HeapAlignment;
+		desc.Type = type;
+		desc.Category = category;
+
+		void* nativeHeap = m_Backend->CreateHeap(desc);
+		if (!nativeHeap)
+			return ~0u;
+
+		uint32_t heapIndex;
+		if (!m_FreeHeapIndices.empty())
+		{
+			heapIndex = m_FreeHeapIndices.back();
+			m_FreeHeapIndices.pop_back();
+		}
+		else
+		{
+			heapIndex = (uint32_t)m_Heaps.size();
+			m_Heaps.emplace_back();
+		}
+
+		Heap& heap = m_Heaps[heapIndex];
+		heap.NativeHeap = nativeHeap;
+		heap.Size = size;
+		heap.Pool = pool;
+		heap.AllocationCount = 0;
+		heap.Allocator = dedicated ? nullptr : std::make_unique<TLSFAllocator>(size, m_Desc.MinAlignment);
+
+		//Upload and readback heaps live in system memory
+		if (m_ResidencyManager)
+			heap.Residency = m_ResidencyManager->Register(nativeHeap, size, type == GPUHeapType::Default ? MemorySegment::Local : MemorySegment::NonLocal);
+
+		m_Pools[pool].push_back(heapIndex);
+		m_HeapsCreated++;
+
+		return heapIndex;
+	}
+
+	void GPUHeapAllocator::DestroyHeap(uint32_t heapIndex)
+	{
+		Heap& heap = m_Heaps[heapIndex];
+
+		if (m_ResidencyManager)
+			m_ResidencyManager->Unregister(heap.Residency);
+
+		m_Backend->DestroyHeap(heap.NativeHeap);
+
+		std::vector<uint32_t>& pool = m_Pools[heap.Pool];
+		pool.erase(std::find(pool.begin(), pool.end(), heapIndex));
+
+		heap = Heap();
+		m_FreeHeapIndices.push_back(heapIndex);
+		m_HeapsDestroyed++;
+	}
+
+	GPUAllocation GPUHeapAllocator::Allocate(uint64_t size, uint64_t alignment, GPUHeapType type, GPUHeapCategory category)
+	{
+		D3D_ASSERT(size > 0, "Allocating 0 bytes!");
+		D3D_ASSERT(HTUtils::HTIsPowerOfTwo(alignment), "The alignment must be a power of two!");
+		D3D_ASSERT(alignment <= m_Desc.HeapAlignment, "The alignment is bigger than the alignment of the heaps!");
+
+		alignment = HTUtils::HTMax(alignment, m_Desc.MinAlignment);
+		size = HTUtils::HTAlignUp(size, m_Desc.MinAlignment);
+
+		SizeClass sizeClass = size <= m_Desc.SmallMaxSize ? SizeClass::Small : size <= m_Desc.MediumMaxSize ? SizeClass::Medium : SizeClass::Dedicated;
+		uint32_t pool = PoolIndex(type, category, sizeClass);
+
+		GPUAllocation allocation;
+		uint32_t heapIndex = ~0u;
+		TLSFAllocation range;
+
+		if (sizeClass == SizeClass::Dedicated)
+		{
+			heapIndex = CreateHeap(HTUtils::HTAlignUp(size, alignment), type, category, pool, true);
+			if (heapIndex == ~0u)
+				return allocation;
+		}
+		else
+		{
+			//Newest heaps first, the old ones are the ones more likely to be full
+			const std::vector<uint32_t>& heaps = m_Pools[pool];
+			for (uint32_t i = (uint32_t)heaps.size(); i-- > 0;)
+			{
+				range = m_Heaps[heaps[i]].Allocator->Allocate(size, alignment);
+				if (range.IsValid())
+				{
+					heapIndex = heaps[i];
+					break;
+				}
+			}
+
+			if (heapIndex == ~0u)
+			{
+				heapIndex = CreateHeap(sizeClass == SizeClass::Small ? m_Desc.SmallHeapSize : m_Desc.MediumHeapSize, type, category, pool, false);
+				if (heapIndex == ~0u)
+					return allocation;
+
+				range = m_Heaps[heapIndex].Allocator->Allocate(size, alignment);
+				D3D_ASSERT(range.IsValid(), "An allocation doesn't fit in a new heap of its size class!");
+			}
+		}
+
+		Heap& heap = m_Heaps[heapIndex];
+		heap.AllocationCount++;
+		m_TotalAllocations++;
+
+		allocation.NativeHeap = heap.NativeHeap;
+		allocation.Offset = range.Offset;
+		allocation.Size = heap.Allocator ? range.Size : heap.Size;
+		allocation.Residency = heap.Residency;
+		allocation.HeapIndex = heapIndex;
+		allocation.Node = range.Node;
+		return allocation;
+	}
+
+	void GPUHeapAllocator::Free(GPUAllocation& allocation, uint64_t fenceValue)
+	{
+		D3D_ASSERT(allocation.IsValid() && allocation.HeapIndex < m_Heaps.size(), "Freeing an invalid GPU allocation!");
+
+		//The values must not go backwards, releasing later is always safe
+		if (!m_PendingFrees.empty())
+			fenceValue = HTUtils::HTMax(fenceValue, m_PendingFrees.back().FenceValue);
+
+		m_PendingFrees.push_back({ allocation, fenceValue });
+		allocation = {};
+	}
+
+	void GPUHeapAllocator::FreeNow(const GPUAllocation& allocation)
+	{
+		uint32_t heapIndex = allocation.HeapIndex;
+		Heap& heap = m_Heaps[heapIndex];
+		D3D_ASSERT(heap.NativeHeap == allocation.NativeHeap && heap.AllocationCount > 0, "Freeing a GPU allocation twice!");
+
+		if (heap.Allocator)
+		{
+			TLSFAllocation range;
+			range.Offset = allocation.Offset;
+			range.Size = allocation.Size;
+			range.Node = allocation.Node;
+			heap.Allocator->Free(range);
+		}
+
+		heap.AllocationCount--;
+		m_TotalFrees++;
+
+		if (heap.AllocationCount > 0)
+			return;
+
+		if (!heap.Allocator)
+		{
+			DestroyHeap(heapIndex);
+			return;
+		}
+
+		//Keep a few empty heaps around, the next allocations would just create them again
+		uint32_t emptyHeaps = 0;
+		for (uint32_t poolHeap : m_Pools[heap.Pool])
+			emptyHeaps += m_Heaps[poolHeap].AllocationCount == 0 ? 1 : 0;
+
+		if (emptyHeaps > m_Desc.EmptyHeapsToKeep)
+			DestroyHeap(heapIndex);
+	}
+
+	void GPUHeapAllocator::BeginFrame(uint64_t completedFenceValue)
+	{
+		while (!m_PendingFrees.empty() && m_PendingFrees.front().FenceValue <= completedFenceValue)
+		{
+			FreeNow(m_PendingFrees.front().Allocation);
+			m_PendingFrees.pop_front();
+		}
+	}
+
+	GPUHeapAllocatorStats GPUHeapAllocator::GetStats() const
+	{
+		GPUHeapAllocatorStats stats;
+		stats.PendingFrees = (uint32_t)m_PendingFrees.size();
+		stats.TotalAllocations = m_TotalAllocations;
+		stats.TotalFrees = m_TotalFrees;
+		stats.HeapsCreated = m_HeapsCreated;
+		stats.HeapsDestroyed = m_HeapsDestroyed;
+
+		for (const Heap& heap : m_Heaps)
+		{
+			if (!heap.NativeHeap)
+				continue;
+
+			stats.HeapCount++;
+			stats.HeapBytes += heap.Size;
+			stats.AllocationCount += heap.AllocationCount;
+
+			if (!heap.Allocator)
+			{
+				stats.DedicatedHeapCount++;
+				stats.UsedBytes += heap.Size;
+				continue;
+			}
+
+			TLSFStats heapStats = heap.Allocator->GetStats();
+			stats.UsedBytes += heapStats.UsedSize;
+			stats.FreeBytes += heapStats.FreeSize;
+			stats.LargestFreeBlock = HTUtils::HTMax(stats.LargestFreeBlock, heapStats.LargestFreeBlock);
+			stats.LargestFreeBlockSum += heapStats.LargestFreeBlock;
+		}
+
+		return stats;
+	}
+}
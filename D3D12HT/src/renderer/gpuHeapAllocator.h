@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <renderer/residencyManager.h>
+#include <renderer/tlsfAllocator.h>
+
+namespace HT
+{
+	//Same meaning as D3D12_HEAP_TYPE_DEFAULT/UPLOAD/READBACK
+	enum class GPUHeapType : uint8_t
+	{
+		Default = 0,
+		Upload,
+		Readback,
+
+		Count
+	};
+
+	//On resource heap tier 1 hardware a heap can only hold one of these (D3D12_HEAP_FLAG_ALLOW_ONLY_*), so they never share a heap, on any tier.
+	enum class GPUHeapCategory : uint8_t
+	{
+		Buffers = 0,
+		Textures,      //Not render targets or depth stencils
+		RenderTargets, //Render targets and depth stencils
+
+		Count
+	};
+
+	const char* GPUHeapTypeName(GPUHeapType type);
+	const char* GPUHeapCategoryName(GPUHeapCategory category);
+
+	struct GPUHeapDesc
+	{
+		uint64_t Size = 0;
+		uint64_t Alignment = 0;
+		GPUHeapType Type = GPUHeapType::Default;
+		GPUHeapCategory Category = GPUHeapCategory::Buffers;
+	};
+
+	//ID3D12Device::CreateHeap. NativeHeap is an ID3D12Heap* for D3D12.
+	class IGPUHeapBackend
+	{
+	public:
+		virtual ~IGPUHeapBackend() = default;
+
+		virtual void* CreateHeap(const GPUHeapDesc& desc) = 0;
+		virtual void DestroyHeap(void* heap) = 0;
+	};
+
+	//Fake heaps, it only counts them
+	class CPUGPUHeapBackend : public IGPUHeapBackend
+	{
+	public:
+		void* CreateHeap(const GPUHeapDesc& desc) override;
+		void DestroyHeap(void* heap) override;
+
+		inline uint32_t GetLiveHeapCount()    const { return m_LiveHeaps; }
+		inline uint64_t GetCreateHeapCalls()  const { return m_CreateHeapCalls; }
+		inline uint64_t GetLiveHeapBytes()    const { return m_LiveHeapBytes; }
+
+	private:
+		uintptr_t m_NextId = 1;
+		uint32_t m_LiveHeaps = 0;
+		uint64_t m_CreateHeapCalls = 0;
+		uint64_t m_LiveHeapBytes = 0;
+
+		//To know the size of the heap when it is destroyed
+		std::vector<std::pair<void*, uint64_t>> m_Heaps;
+	};
+
+	//Where a placed resource goes: a heap and an offset inside it
+	struct GPUAllocation
+	{
+		void* NativeHeap = nullptr;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+
+		//What the frames that use the resource pass to ResidencyManager::MarkUsed (invalid without a residency manager)
+		ResidencyHandle Residency = g_InvalidResidencyHandle;
+
+		//Where it came from, so it can be given back
+		uint32_t HeapIndex = ~0u;
+		uint32_t Node = TLSFAllocation::s_InvalidNode;
+
+		inline bool IsValid() const { return NativeHeap != nullptr; }
+	};
+
+	struct GPUHeapAllocatorDesc
+	{
+		//Resources up to SmallMaxSize go to heaps of SmallHeapSize, up to MediumMaxSize to heaps of MediumHeapSize, and anything bigger gets a heap of its own.
+		//Small heaps mean a few small buffers don't keep a big heap alive, and big resources don't fragment the heaps of the small ones.
+		uint64_t SmallMaxSize   = 256ull << 10;
+		uint64_t SmallHeapSize  = 8ull << 20;
+		uint64_t MediumMaxSize  = 16ull << 20;
+		uint64_t MediumHeapSize = 128ull << 20;
+
+		//D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, small textures can use 4KB and MSAA textures need 4MB (D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT).
+		//The heaps are aligned to the biggest one, the granularity of the allocators to the smallest one.
+		uint64_t MinAlignment = 4ull << 10;
+		uint64_t HeapAlignment = 4ull << 20;
+
+		//How many empty heaps each pool keeps instead of destroying them, creating heaps is a kernel call and may stall
+		uint32_t EmptyHeapsToKeep = 1;
+	};
+
+	struct GPUHeapAllocatorStats
+	{
+		uint32_t HeapCount = 0;
+		uint32_t DedicatedHeapCount = 0;
+		uint64_t HeapBytes = 0;
+
+		//Of the resources, including the space lost to alignment
+		uint64_t UsedBytes = 0;
+		uint64_t FreeBytes = 0;
+
+		//Over every pooled heap: the biggest free block of a heap, and the sum of the biggest blocks (for the fragmentation)
+		uint64_t LargestFreeBlock = 0;
+		uint64_t LargestFreeBlockSum = 0;
+
+		uint32_t AllocationCount = 0; //Alive
+		uint32_t PendingFrees = 0;    //Waiting for their fence value
+
+		//Totals since the creation
+		uint64_t TotalAllocations = 0;
+		uint64_t TotalFrees = 0;
+		uint64_t HeapsCreated = 0;
+		uint64_t HeapsDestroyed = 0;
+
+		inline double GetUtilization() const { return HeapBytes > 0 ? (double)UsedBytes / (double)HeapBytes : 0.0; }
+
+		//0 when every heap has its free space in one block. It is per heap because an allocation can't span heaps.
+		inline double GetFragmentation() const { return FreeBytes > 0 ? 1.0 - (double)LargestFreeBlockSum / (double)FreeBytes : 0.0; }
+	};
+
+	//Memory for placed resources, instead of a committed resource (and a heap, and a kernel call) for every buffer and texture.
+	//The heaps are split in pools by type, category and size class and each pooled heap has a HT::TLSFAllocator, so Allocate and Free are O(1)
+	//inside a heap (plus a walk over the heaps of the pool, which are few because they are big).
+	//
+	//The GPU may still use the memory of a resource after we release it, so Free takes the fence value of the last work that used it
+	//and the range is only given back in a BeginFrame where that value is completed (same as the upload ring and the descriptor rings).
+	//
+	//With a residency manager, every heap is registered in it when created and unregistered when destroyed.
+	class GPUHeapAllocator
+	{
+	public:
+		GPUHeapAllocator(IGPUHeapBackend* backend, ResidencyManager* residencyManager = nullptr, const GPUHeapAllocatorDesc& desc = {});
+		~GPUHeapAllocator();
+
+		GPUHeapAllocator(const GPUHeapAllocator&) = delete;
+		GPUHeapAllocator& operator=(const GPUHeapAllocator&) = delete;
+
+		//size and alignment come from ID3D12Device::GetResourceAllocationInfo. An invalid allocation is returned if the heap can't be created.
+		GPUAllocation Allocate(uint64_t size, uint64_t alignment, GPUHeapType type, GPUHeapCategory category);
+
+		//The range is given back once fenceValue is completed
+		void Free(GPUAllocation& allocation, uint64_t fenceValue);
+
+		//Gives back the ranges whose fence value is <= completedFenceValue and destroys the heaps that became empty
+		void BeginFrame(uint64_t completedFenceValue);
+
+		GPUHeapAllocatorStats GetStats() const;
+
+	private:
+		enum class SizeClass : uint8_t
+		{
+			Small = 0,
+			Medium,
+			Dedicated,
+
+			Count
+		};
+
+		struct Heap
+		{
+			void* NativeHeap = nullptr;
+			uint64_t Size = 0;
+			ResidencyHandle Residency = g_InvalidResidencyHandle;
+			uint32_t Pool = 0;
+
+			//Null for dedicated heaps, the resource takes the whole heap
+			std::unique_ptr<TLSFAllocator> Allocator;
+			uint32_t AllocationCount = 0;
+		};
+
+		struct PendingFree
+		{
+			GPUAllocation Allocation;
+			uint64_t FenceValue;
+		};
+
+		static constexpr uint32_t s_PoolCount = (uint32_t)GPUHeapType::Count * (uint32_t)GPUHeapCategory::Count * (uint32_t)SizeClass::Count;
+
+		inline static uint32_t PoolIndex(GPUHeapType type, GPUHeapCategory category, SizeClass sizeClass)
+		{
+			return ((uint32_t)type * (uint32_t)GPUHeapCategory::Count + (uint32_t)category) * (uint32_t)SizeClass::Count + (uint32_t)sizeClass;
+		}
+
+		uint32_t CreateHeap(uint64_t size, GPUHeapType type, GPUHeapCategory category, uint32_t pool, bool dedicated);
+		void DestroyHeap(uint32_t heapIndex);
+		void FreeNow(const GPUAllocation& allocation);
+
+	private:
+		IGPUHeapBackend* m_Backend;
+		ResidencyManager* m_ResidencyManager;
+		GPUHeapAllocatorDesc m_Desc;
+
+		//Destroyed heaps leave a hole that is reused, so the heap index of an allocation stays valid
+		std::vector<Heap> m_Heaps;
+		std::vector<uint32_t> m_FreeHeapIndices;
+
+		//The heaps of each pool, newest last
+		std::vector<uint32_t> m_Pools[s_PoolCount];
+
+		//Ordered by fence value
+		std::deque<PendingFree> m_PendingFrees;
+
+		uint64_t m_TotalAllocations = 0;
+		uint64_t m_TotalFrees = 0;
+		uint64_t m_HeapsCreated = 0;
+		uint64_t m_HeapsDestroyed = 0;
+	};
+}
@@ -0,0 +1,289 @@
+#include "gpuProfiler.h"
+
+#include <algorithm>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	static constexpr uint32_t s_DroppedScope = ~0u;
+
+	CPUTimestampBackend::CPUTimestampBackend(IFence* fence, uint32_t queryCount, uint64_t frequency) : m_Fence(fence), m_Frequency(frequency)
+	{
+		D3D_ASSERT(fence, "CPUTimestampBackend needs a fence!");
+		D3D_ASSERT(frequency > 0, "The timestamp frequency can't be zero!");
+
+		m_Queries.resize(queryCount, 0);
+		m_Readback.resize(queryCount, 0);
+	}
+
+	void CPUTimestampBackend::EndQuery(void* /*commandList*/, uint32_t query)
+	{
+		D3D_ASSERT(query < m_Queries.size(), "Timestamp query out of range!");
+		m_Queries[query] = m_Clock;
+	}
+
+	void CPUTimestampBackend::ResolveQueries(void* /*commandList*/, uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(firstQuery + count <= m_Queries.size(), "Timestamp resolve out of range!");
+
+		//The values land in the readback buffer when the next signal of the queue is reached
+		PendingResolve resolve;
+		resolve.FirstQuery = firstQuery;
+		resolve.Count = count;
+		resolve.FenceValue = m_Fence->GetLastSignaledValue() + 1;
+		resolve.Values.assign(m_Queries.begin() + firstQuery, m_Queries.begin() + firstQuery + count);
+
+		m_PendingResolves.push_back(std::move(resolve));
+	}
+
+	const uint64_t* CPUTimestampBackend::MapReadback(uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(!m_Mapped, "The readback buffer is already mapped!");
+		D3D_ASSERT(firstQuery + count <= m_Readback.size(), "Timestamp readback out of range!");
+
+		while (!m_PendingResolves.empty() && m_Fence->IsComplete(m_PendingResolves.front().FenceValue))
+		{
+			const PendingResolve& resolve = m_PendingResolves.front();
+			std::copy(resolve.Values.begin(), resolve.Values.end(), m_Readback.begin() + resolve.FirstQuery);
+			m_PendingResolves.pop_front();
+		}
+
+		for (const PendingResolve& resolve : m_PendingResolves)
+		{
+			if (resolve.FirstQuery < firstQuery + count && firstQuery < resolve.FirstQuery + resolve.Count)
+			{
+				m_EarlyReads++;
+				break;
+			}
+		}
+
+		m_Reads++;
+		m_Mapped = true;
+		return m_Readback.data() + firstQuery;
+	}
+
+	void CPUTimestampBackend::UnmapReadback()
+	{
+		D3D_ASSERT(m_Mapped, "The readback buffer is not mapped!");
+		m_Mapped = false;
+	}
+
+	void CPUTimestampBackend::GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds)
+	{
+		outGPUTicks = m_Clock;
+		outCPUNanoseconds = m_CalibrationCPUNanoseconds;
+	}
+
+	double GPUProfilerFrame::GetGPUMs() const
+	{
+		uint64_t begin = ~0ull;
+		uint64_t end = 0;
+
+		for (const GPUProfilerScope& scope : Scopes)
+		{
+			if (scope.Depth != 0)
+				continue;
+
+			begin = HTUtils::HTMin(begin, scope.BeginNs);
+			end = HTUtils::HTMax(end, scope.EndNs);
+		}
+
+		return end > begin ? (double)(end - begin) * 1e-6 : 0.0;
+	}
+
+	GPUProfiler::GPUProfiler(ITimestampBackend* backend, IFence* fence, const GPUProfilerConfig& config)
+		: m_Backend(backend), m_Fence(fence), m_Config(config)
+	{
+		D3D_ASSERT(backend, "GPUProfiler needs a timestamp backend!");
+		D3D_ASSERT(fence, "GPUProfiler needs a fence!");
+		D3D_ASSERT(config.FrameSlots > 0 && config.MaxScopesPerFrame > 0, "GPUProfiler needs at least a slot and a scope!");
+
+		m_Slots.resize(config.FrameSlots);
+		for (FrameSlot& slot : m_Slots)
+			slot.Scopes.reserve(config.MaxScopesPerFrame);
+
+		m_ScopeStack.reserve(config.MaxScopesPerFrame);
+
+		m_Frequency = backend->GetFrequency();
+		D3D_ASSERT(m_Frequency > 0, "The timestamp frequency can't be zero!");
+	}
+
+	uint32_t GPUProfiler::GetQueryCount(const GPUProfilerConfig& config)
+	{
+		return config.FrameSlots * config.MaxScopesPerFrame * 2;
+	}
+
+	void GPUProfiler::BeginFrame()
+	{
+		D3D_ASSERT(!m_InFrame, "GPUProfiler::BeginFrame called twice without EndFrame!");
+
+		if (m_Stats.Calibrations == 0 || (m_Config.CalibrationInterval > 0 && m_FrameIndex % m_Config.CalibrationInterval == 0))
+			Calibrate();
+
+		//A slot whose fence is not there yet is left for later, we never wait.
+		m_ResolvedCount = 0;
+		uint32_t slotCount = (uint32_t)m_Slots.size();
+
+		for (uint32_t slotIndex = 0; slotIndex < slotCount; slotIndex++)
+		{
+			FrameSlot& slot = m_Slots[slotIndex];
+
+			if (slot.Pending && m_Fence->IsComplete(slot.FenceValue))
+				ReadSlot(slot, slotIndex);
+		}
+
+		//The slot of frame f is f % slots, but once a frame is skipped a slot can hold an older frame than the one before it
+		std::sort(m_ResolvedFrames.begin(), m_ResolvedFrames.begin() + m_ResolvedCount,
+			[](const GPUProfilerFrame& a, const GPUProfilerFrame& b) { return a.FrameIndex < b.FrameIndex; });
+
+		m_CurrentSlot = (uint32_t)(m_FrameIndex % slotCount);
+		FrameSlot& slot = m_Slots[m_CurrentSlot];
+
+		m_Recording = !slot.Pending;
+		if (m_Recording)
+		{
+			slot.Scopes.clear();
+			slot.FrameIndex = m_FrameIndex;
+			slot.CPUBeginNs = HTUtils::HTNowNanoseconds();
+		}
+		else
+			m_Stats.FramesSkipped++;
+
+		m_ScopeStack.clear();
+		m_InFrame = true;
+		m_Resolved = false;
+	}
+
+	void GPUProfiler::BeginScope(void* commandList, const char* name)
+	{
+		D3D_ASSERT(m_InFrame, "GPU scope outside of a frame!");
+
+		FrameSlot& slot = m_Slots[m_CurrentSlot];
+
+		if (!m_Recording || slot.Scopes.size() >= m_Config.MaxScopesPerFrame)
+		{
+			if (m_Recording)
+				m_Stats.ScopesDropped++;
+
+			m_ScopeStack.push_back(s_DroppedScope);
+			return;
+		}
+
+		//Once a scope is dropped the frame is full, so the scopes on the stack below this one were all recorded
+		ScopeRecord record;
+		record.Name = name;
+		record.Depth = (uint32_t)m_ScopeStack.size();
+		record.Parent = m_ScopeStack.empty() ? GPUProfilerScope::s_NoParent : m_ScopeStack.back();
+
+		uint32_t index = (uint32_t)slot.Scopes.size();
+		slot.Scopes.push_back(record);
+		m_ScopeStack.push_back(index);
+
+		m_Backend->EndQuery(commandList, (m_CurrentSlot * m_Config.MaxScopesPerFrame + index) * 2);
+	}
+
+	void GPUProfiler::EndScope(void* commandList)
+	{
+		D3D_ASSERT(!m_ScopeStack.empty(), "GPUProfiler::EndScope without a scope!");
+
+		uint32_t index = m_ScopeStack.back();
+		m_ScopeStack.pop_back();
+
+		if (index != s_DroppedScope)
+			m_Backend->EndQuery(commandList, (m_CurrentSlot * m_Config.MaxScopesPerFrame + index) * 2 + 1);
+	}
+
+	void GPUProfiler::ResolveFrame(void* commandList)
+	{
+		D3D_ASSERT(m_InFrame, "GPUProfiler::ResolveFrame called without BeginFrame!");
+		D3D_ASSERT(m_ScopeStack.empty(), "A GPU scope was not ended!");
+		D3D_ASSERT(!m_Resolved, "GPUProfiler::ResolveFrame called twice in a frame!");
+
+		m_Resolved = true;
+
+		FrameSlot& slot = m_Slots[m_CurrentSlot];
+		if (m_Recording && !slot.Scopes.empty())
+			m_Backend->ResolveQueries(commandList, m_CurrentSlot * m_Config.MaxScopesPerFrame * 2, (uint32_t)slot.Scopes.size() * 2);
+	}
+
+	void GPUProfiler::EndFrame(uint64_t fenceValue)
+	{
+		D3D_ASSERT(m_InFrame, "GPUProfiler::EndFrame called without BeginFrame!");
+		D3D_ASSERT(m_ScopeStack.empty(), "A GPU scope was not ended!");
+
+		m_InFrame = false;
+		m_FrameIndex++;
+
+		if (!m_Recording)
+			return;
+
+		m_Stats.FramesRecorded++;
+
+		FrameSlot& slot = m_Slots[m_CurrentSlot];
+		if (slot.Scopes.empty())
+			return;
+
+		D3D_ASSERT(m_Resolved, "The GPU scopes of the frame were not resolved!");
+
+		slot.FenceValue = fenceValue;
+		slot.Pending = true;
+	}
+
+	void GPUProfiler::ReadSlot(FrameSlot& slot, uint32_t slotIndex)
+	{
+		//The frames are kept (with their scopes) from one BeginFrame to the other, so reading doesn't allocate after the first frames
+		if (m_ResolvedCount == m_ResolvedFrames.size())
+			m_ResolvedFrames.emplace_back();
+
+		GPUProfilerFrame& frame = m_ResolvedFrames[m_ResolvedCount++];
+		frame.FrameIndex = slot.FrameIndex;
+		frame.FenceValue = slot.FenceValue;
+		frame.CPUBeginNs = slot.CPUBeginNs;
+		frame.ReadbackNs = HTUtils::HTNowNanoseconds();
+		frame.LatencyFrames = (uint32_t)(m_FrameIndex - slot.FrameIndex);
+		frame.Scopes.clear();
+
+		uint32_t queryCount = (uint32_t)slot.Scopes.size() * 2;
+		const uint64_t* timestamps = m_Backend->MapReadback(slotIndex * m_Config.MaxScopesPerFrame * 2, queryCount);
+
+		for (uint32_t i = 0; i < (uint32_t)slot.Scopes.size(); i++)
+		{
+			const ScopeRecord& record = slot.Scopes[i];
+
+			GPUProfilerScope scope;
+			scope.Name = record.Name;
+			scope.Depth = record.Depth;
+			scope.Parent = record.Parent;
+			scope.BeginNs = TicksToCPUNanoseconds(timestamps[i * 2]);
+			scope.EndNs = TicksToCPUNanoseconds(timestamps[i * 2 + 1]);
+			frame.Scopes.push_back(scope);
+		}
+
+		m_Backend->UnmapReadback();
+
+		slot.Pending = false;
+
+		m_Stats.FramesResolved++;
+		m_Stats.TotalLatencyFrames += frame.LatencyFrames;
+		m_Stats.MaxLatencyFrames = HTUtils::HTMax(m_Stats.MaxLatencyFrames, frame.LatencyFrames);
+	}
+
+	void GPUProfiler::Calibrate()
+	{
+		m_Backend->GetClockCalibration(m_CalibrationGPUTicks, m_CalibrationCPUNs);
+		m_Stats.Calibrations++;
+	}
+
+	uint64_t GPUProfiler::TicksToCPUNanoseconds(uint64_t ticks) const
+	{
+		//The timestamp can be before the calibration. Whole seconds and the rest apart, so the multiplication doesn't overflow.
+		int64_t delta = (int64_t)(ticks - m_CalibrationGPUTicks);
+		int64_t frequency = (int64_t)m_Frequency;
+		int64_t nanoseconds = (delta / frequency) * 1000000000ll + (delta % frequency) * 1000000000ll / frequency;
+
+		return m_CalibrationCPUNs + (uint64_t)nanoseconds;
+	}
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//The timestamp queries of a queue: a query heap, where the GPU writes the timestamps when it executes EndQuery, and a readback buffer
+	//the CPU can read, where ResolveQueries copies them. Query i is always resolved to the element i of the readback buffer.
+	//The D3D12 one is HT::D3D12TimestampBackend, the null one writes the time when the null queue executes the list.
+	class ITimestampBackend
+	{
+	public:
+		virtual ~ITimestampBackend() = default;
+
+		virtual void EndQuery(void* commandList, uint32_t query) = 0;
+		virtual void ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count) = 0;
+
+		//Only for queries whose resolve the GPU has finished. Every MapReadback is followed by an UnmapReadback.
+		virtual const uint64_t* MapReadback(uint32_t firstQuery, uint32_t count) = 0;
+		virtual void UnmapReadback() = 0;
+
+		//Ticks per second of the timestamps (ID3D12CommandQueue::GetTimestampFrequency)
+		virtual uint64_t GetFrequency() = 0;
+
+		//A timestamp of the GPU and HTUtils::HTNowNanoseconds taken at the same moment (ID3D12CommandQueue::GetClockCalibration)
+		virtual void GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds) = 0;
+	};
+
+	//The mock of the queries, to test the profiler without a GPU. The "GPU clock" is moved by hand, EndQuery reads it right away.
+	//Like on a GPU, what is resolved only reaches the readback buffer once the fence value signaled after the resolve is completed,
+	//reading a query before that gives the old value and is counted as an early read (the profiler should never do it).
+	class CPUTimestampBackend : public ITimestampBackend
+	{
+	public:
+		CPUTimestampBackend(IFence* fence, uint32_t queryCount, uint64_t frequency = 10000000);
+
+		void EndQuery(void* commandList, uint32_t query) override;
+		void ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count) override;
+
+		const uint64_t* MapReadback(uint32_t firstQuery, uint32_t count) override;
+		void UnmapReadback() override;
+
+		uint64_t GetFrequency() override { return m_Frequency; }
+		void GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds) override;
+
+		inline void SetClock(uint64_t ticks) { m_Clock = ticks; }
+		inline void AdvanceClock(uint64_t ticks) { m_Clock += ticks; }
+		inline uint64_t GetClock() const { return m_Clock; }
+
+		//The CPU time of the current GPU clock, returned with it by GetClockCalibration
+		inline void SetCalibrationCPUNanoseconds(uint64_t nanoseconds) { m_CalibrationCPUNanoseconds = nanoseconds; }
+
+		inline uint64_t GetEarlyReads() const { return m_EarlyReads; }
+		inline uint64_t GetReads() const { return m_Reads; }
+		inline bool IsMapped() const { return m_Mapped; }
+
+	private:
+		struct PendingResolve
+		{
+			uint32_t FirstQuery;
+			uint32_t Count;
+			uint64_t FenceValue;
+			std::vector<uint64_t> Values;
+		};
+
+	private:
+		IFence* m_Fence;
+		uint64_t m_Frequency;
+
+		std::vector<uint64_t> m_Queries;
+		std::vector<uint64_t> m_Readback;
+		std::deque<PendingResolve> m_PendingResolves;
+
+		uint64_t m_Clock = 0;
+		uint64_t m_CalibrationCPUNanoseconds = 0;
+
+		uint64_t m_EarlyReads = 0;
+		uint64_t m_Reads = 0;
+		bool m_Mapped = false;
+	};
+
+	struct GPUProfilerConfig
+	{
+		uint32_t MaxScopesPerFrame = 64;
+
+		//The frames that can be waiting for their timestamps. It must be more than the frames in flight, or the profiler has to skip frames
+		//(it never waits for the GPU).
+		uint32_t FrameSlots = 5;
+
+		//The clocks of the CPU and the GPU drift apart, they are calibrated again every this many frames
+		uint32_t CalibrationInterval = 60;
+	};
+
+	//A scope of a resolved frame, in the CPU timeline (HTUtils::HTNowNanoseconds)
+	struct GPUProfilerScope
+	{
+		static constexpr uint32_t s_NoParent = ~0u;
+
+		const char* Name;
+		uint32_t Depth;
+		uint32_t Parent; //Index in the scopes of the frame
+
+		uint64_t BeginNs;
+		uint64_t EndNs;
+
+		inline double GetDurationMs() const { return EndNs > BeginNs ? (double)(EndNs - BeginNs) * 1e-6 : 0.0; }
+	};
+
+	struct GPUProfilerFrame
+	{
+		uint64_t FrameIndex = 0;
+		uint64_t FenceValue = 0;
+
+		//When the CPU began the frame and when its timestamps were read
+		uint64_t CPUBeginNs = 0;
+		uint64_t ReadbackNs = 0;
+
+		//How many frames later they were read
+		uint32_t LatencyFrames = 0;
+
+		//In the order they began, parents before children
+		std::vector<GPUProfilerScope> Scopes;
+
+		//From the first top level scope to the end of the last one
+		double GetGPUMs() const;
+	};
+
+	struct GPUProfilerStats
+	{
+		uint64_t FramesRecorded = 0;
+		uint64_t FramesResolved = 0;
+		uint64_t FramesSkipped = 0; //The slot was still waiting for the GPU
+		uint64_t ScopesDropped = 0; //More than MaxScopesPerFrame
+		uint64_t Calibrations = 0;
+
+		uint64_t TotalLatencyFrames = 0;
+		uint32_t MaxLatencyFrames = 0;
+	};
+
+	//Times named scopes of the GPU with timestamp queries, without ever making the CPU wait for the GPU.
+	//
+	//Each frame gets a slot of the query heap (two queries per scope, begin and end). ResolveFrame resolves the queries of the slot into the same
+	//part of the readback buffer, EndFrame remembers the fence value the frame ring signaled after it. BeginFrame reads the slots whose fence value is completed,
+	//so the timestamps of a frame show up a few frames later (as many as the GPU is behind), and a slot is only reused once it was read.
+	//
+	//The ticks are converted to the CPU timeline with the clock calibration of the queue, so the GPU scopes line up with the CPU phases of the frame.
+	//Scopes nest, and a scope can begin on a list and end on another one of the same queue (submitted after it, in the same frame).
+	//
+	//Not thread safe, the scopes are recorded by the thread that drives the frame.
+	class GPUProfiler
+	{
+	public:
+		GPUProfiler(ITimestampBackend* backend, IFence* fence, const GPUProfilerConfig& config = {});
+
+		GPUProfiler(const GPUProfiler&) = delete;
+		GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+		//How many queries the backend needs for this config
+		static uint32_t GetQueryCount(const GPUProfilerConfig& config);
+
+		//Reads every frame the GPU finished (see GetResolvedFrame) and starts recording a new one
+		void BeginFrame();
+
+		//The name must live until the frame is resolved (a literal, the name of a pass...)
+		void BeginScope(void* commandList, const char* name);
+		void EndScope(void* commandList);
+
+		//All scopes must be ended. The resolve is recorded on commandList, which must be the last list of the frame that has queries.
+		void ResolveFrame(void* commandList);
+
+		//After the frame was submitted, fenceValue is what HT::FrameRing::EndFrame returned. The value can't be guessed before that,
+		//anyone can signal the fence in the middle and the slot would be read before the GPU reached the resolve.
+		void EndFrame(uint64_t fenceValue);
+
+		//The frames read by the last BeginFrame, oldest first
+		inline uint32_t GetResolvedFrameCount() const { return m_ResolvedCount; }
+		inline const GPUProfilerFrame& GetResolvedFrame(uint32_t index) const { return m_ResolvedFrames[index]; }
+
+		inline const GPUProfilerStats& GetStats() const { return m_Stats; }
+
+	private:
+		struct ScopeRecord
+		{
+			const char* Name;
+			uint32_t Depth;
+			uint32_t Parent;
+		};
+
+		struct FrameSlot
+		{
+			bool Pending = false;
+			uint64_t FrameIndex = 0;
+			uint64_t FenceValue = 0;
+			uint64_t CPUBeginNs = 0;
+			std::vector<ScopeRecord> Scopes;
+		};
+
+		void ReadSlot(FrameSlot& slot, uint32_t slotIndex);
+		void Calibrate();
+		uint64_t TicksToCPUNanoseconds(uint64_t ticks) const;
+
+	private:
+		ITimestampBackend* m_Backend;
+		IFence* m_Fence;
+		GPUProfilerConfig m_Config;
+
+		std::vector<FrameSlot> m_Slots;
+
+		uint64_t m_FrameIndex = 0;
+		uint32_t m_CurrentSlot = 0;
+		bool m_Recording = false; //False when the frame was skipped
+		bool m_InFrame = false;
+		bool m_Resolved = false;
+
+		//Indices in the scopes of the current frame
+		std::vector<uint32_t> m_ScopeStack;
+
+		uint64_t m_Frequency = 1;
+		uint64_t m_CalibrationGPUTicks = 0;
+		uint64_t m_CalibrationCPUNs = 0;
+
+		//Only the first m_ResolvedCount are of the last BeginFrame, the others are kept to reuse their memory
+		std::vector<GPUProfilerFrame> m_ResolvedFrames;
+		uint32_t m_ResolvedCount = 0;
+
+		GPUProfilerStats m_Stats;
+	};
+
+	//Begins a scope and ends it when it goes out of scope. The list must be the same at both ends.
+	class GPUProfileScope
+	{
+	public:
+		GPUProfileScope(GPUProfiler* profiler, void* commandList, const char* name) : m_Profiler(profiler), m_CommandList(commandList)
+		{
+			if (m_Profiler)
+				m_Profiler->BeginScope(commandList, name);
+		}
+
+		~GPUProfileScope()
+		{
+			if (m_Profiler)
+				m_Profiler->EndScope(m_CommandList);
+		}
+
+		GPUProfileScope(const GPUProfileScope&) = delete;
+		GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+
+	private:
+		GPUProfiler* m_Profiler;
+		void* m_CommandList;
+	};
+}
@@ -0,0 +1,98 @@
+#include "nullCaptureRecorder.h"
+
+namespace HT
+{
+	bool NullCaptureRecorder::BeginReplay(const CommandCaptureReader& capture, std::string& /*outError*/)
+	{
+		uint32_t handleCount = capture.GetHandleCount();
+
+		m_Values.resize(handleCount);
+		m_QueryMemory.clear();
+		m_QueryMemory.resize(handleCount);
+
+		for (uint32_t i = 0; i < handleCount; i++)
+		{
+			const CaptureHandle& handle = capture.GetHandle(i);
+
+			if (handle.Kind == CaptureHandleKind::QueryHeap || handle.Kind == CaptureHandleKind::QueryDestination)
+			{
+				m_QueryMemory[i] = std::make_unique<uint64_t[]>(handle.Count ? handle.Count : 1);
+				m_Values[i] = (uint64_t)(uintptr_t)m_QueryMemory[i].get();
+				continue;
+			}
+
+			m_Values[i] = handle.Value;
+		}
+
+		return true;
+	}
+
+	void NullCaptureRecorder::SetRootSignature(void* commandList, uint32_t rootSignature)
+	{
+		ToNullCommandList(commandList)->SetRootSignature(m_Values[rootSignature]);
+	}
+
+	void NullCaptureRecorder::SetPipelineState(void* commandList, uint32_t pipeline)
+	{
+		ToNullCommandList(commandList)->SetPipelineState(m_Values[pipeline]);
+	}
+
+	void NullCaptureRecorder::SetDescriptorHeaps(void* commandList, uint32_t resourceHeap, uint32_t samplerHeap)
+	{
+		ToNullCommandList(commandList)->SetDescriptorHeaps(m_Values[resourceHeap], m_Values[samplerHeap]);
+	}
+
+	void NullCaptureRecorder::SetRenderTarget(void* commandList, uint32_t renderTargetView)
+	{
+		ToNullCommandList(commandList)->SetRenderTarget(m_Values[renderTargetView]);
+	}
+
+	void NullCaptureRecorder::SetConstantBuffer(void* commandList, uint32_t slot, uint64_t gpuAddress)
+	{
+		ToNullCommandList(commandList)->SetConstantBuffer(slot, gpuAddress);
+	}
+
+	void NullCaptureRecorder::SetDescriptorTable(void* commandList, uint32_t slot, uint64_t gpuHandle)
+	{
+		ToNullCommandList(commandList)->SetDescriptorTable(slot, gpuHandle);
+	}
+
+	void NullCaptureRecorder::ClearRenderTarget(void* commandList, uint32_t renderTargetView, const float (&color)[4])
+	{
+		ToNullCommandList(commandList)->ClearRenderTarget(m_Values[renderTargetView], color);
+	}
+
+	void NullCaptureRecorder::ResourceBarriers(void* commandList, const ResourceBarrier* barriers, uint32_t count)
+	{
+		m_Barriers.assign(barriers, barriers + count);
+		for (ResourceBarrier& barrier : m_Barriers)
+			barrier.Resource = m_Values[barrier.Resource];
+
+		ToNullCommandList(commandList)->ResourceBarriers(m_Barriers.data(), count);
+	}
+
+	void NullCaptureRecorder::Draw(void* commandList, uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+	{
+		ToNullCommandList(commandList)->Draw(vertexCount, instanceCount, startVertex, startInstance);
+	}
+
+	void NullCaptureRecorder::Dispatch(void* commandList, uint32_t x, uint32_t y, uint32_t z)
+	{
+		ToNullCommandList(commandList)->Dispatch(x, y, z);
+	}
+
+	void NullCaptureRecorder::EndQuery(void* commandList, uint32_t queryHeap, uint32_t index)
+	{
+		ToNullCommandList(commandList)->EndQuery(m_QueryMemory[queryHeap].get(), index);
+	}
+
+	void NullCaptureRecorder::ResolveQueries(void* commandList, uint32_t queryHeap, uint32_t first, uint32_t count, uint32_t destination)
+	{
+		ToNullCommandList(commandList)->ResolveQueries(m_QueryMemory[queryHeap].get(), first, count, m_QueryMemory[destination].get());
+	}
+
+	void NullCaptureRecorder::Close(void* commandList)
+	{
+		ToNullCommandList(commandList)->Close();
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <renderer/commandCapture.h>
+#include <renderer/null/nullCommandList.h>
+
+namespace HT
+{
+	//Replays a capture on null lists (created by a HT::NullCommandPoolBackend), to run it on a HT::NullQueueBackend.
+	//The handles become the values the capture had, so the null queue sees the same commands and computes the same checksum as the run that was captured.
+	//The query heaps and their destinations were memory of the captured process, they get arrays of their own here.
+	class NullCaptureRecorder : public ICaptureCommandRecorder
+	{
+	public:
+		bool BeginReplay(const CommandCaptureReader& capture, std::string& outError) override;
+
+		void SetRootSignature(void* commandList, uint32_t rootSignature) override;
+		void SetPipelineState(void* commandList, uint32_t pipeline) override;
+		void SetDescriptorHeaps(void* commandList, uint32_t resourceHeap, uint32_t samplerHeap) override;
+		void SetRenderTarget(void* commandList, uint32_t renderTargetView) override;
+		void SetConstantBuffer(void* commandList, uint32_t slot, uint64_t gpuAddress) override;
+		void SetDescriptorTable(void* commandList, uint32_t slot, uint64_t gpuHandle) override;
+		void ClearRenderTarget(void* commandList, uint32_t renderTargetView, const float (&color)[4]) override;
+		void ResourceBarriers(void* commandList, const ResourceBarrier* barriers, uint32_t count) override;
+		void Draw(void* commandList, uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override;
+		void Dispatch(void* commandList, uint32_t x, uint32_t y, uint32_t z) override;
+		void EndQuery(void* commandList, uint32_t queryHeap, uint32_t index) override;
+		void ResolveQueries(void* commandList, uint32_t queryHeap, uint32_t first, uint32_t count, uint32_t destination) override;
+		void Close(void* commandList) override;
+
+		//There is no swap chain, a present only ends the frame
+		void Present(uint32_t /*syncInterval*/, uint32_t /*flags*/) override {}
+
+	private:
+		//[handle]
+		std::vector<uint64_t> m_Values;
+		std::vector<std::unique_ptr<uint64_t[]>> m_QueryMemory;
+
+		std::vector<ResourceBarrier> m_Barriers;
+	};
+}
@@ -0,0 +1,244 @@
+#include "nullCommandList.h"
+
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	static const char* s_CommandNames[(uint32_t)NullCommandType::Count] =
+	{
+		"SetPipelineState",
+		"SetDescriptorHeaps",
+		"SetRenderTarget",
+		"SetConstantBuffer",
+		"SetDescriptorTable",
+		"ClearRenderTarget",
+		"ResourceBarriers",
+		"Draw",
+		"Dispatch",
+		"SetRootSignature",
+		"EndQuery",
+		"ResolveQueries",
+	};
+
+	const char* NullCommandTypeName(NullCommandType type)
+	{
+		D3D_ASSERT(type < NullCommandType::Count, "Invalid null command!");
+		return s_CommandNames[(uint32_t)type];
+	}
+
+	uint8_t* NullCommandAllocator::Allocate(uint32_t size)
+	{
+		D3D_ASSERT(size <= s_BlockSize, "A null command doesn't fit in a block!");
+
+		if (m_CurrentBlock < m_Blocks.size() && m_CurrentOffset + size > s_BlockSize)
+		{
+			m_CurrentBlock++;
+			m_CurrentOffset = 0;
+		}
+
+		//The blocks are kept after a reset, we only grow when a frame records more than any frame before it
+		if (m_CurrentBlock == m_Blocks.size())
+			m_Blocks.emplace_back(s_BlockSize);
+
+		uint8_t* memory = m_Blocks[m_CurrentBlock].data() + m_CurrentOffset;
+		m_CurrentOffset += size;
+
+		return memory;
+	}
+
+	void NullCommandAllocator::Reset()
+	{
+		m_CurrentBlock = 0;
+		m_CurrentOffset = 0;
+	}
+
+	NullCommandList::NullCommandList(CommandQueueType type, NullCommandAllocator* allocator) : m_Type(type), m_Allocator(nullptr)
+	{
+		Reset(allocator);
+	}
+
+	void NullCommandList::Reset(NullCommandAllocator* allocator)
+	{
+		D3D_ASSERT(allocator && allocator->GetType() == m_Type, "A null list must be reset with an allocator of its type!");
+
+		m_Allocator = allocator;
+		m_Segments.clear();
+		m_CommandCount = 0;
+		m_Closed = false;
+	}
+
+	void NullCommandList::Close()
+	{
+		D3D_ASSERT(!m_Closed, "Closing a list that is already closed!");
+		m_Closed = true;
+	}
+
+	uint8_t* NullCommandList::Record(NullCommandType type, uint32_t payloadSize)
+	{
+		D3D_ASSERT(!m_Closed, "Recording on a closed list!");
+
+		uint32_t size = HTUtils::HTAlignUp<uint32_t>((uint32_t)sizeof(NullCommandHeader) + payloadSize, 8u);
+		uint8_t* memory = m_Allocator->Allocate(size);
+
+		//Commands that follow each other in the same block are a single segment
+		if (!m_Segments.empty() && m_Segments.back().Data + m_Segments.back().Size == memory)
+			m_Segments.back().Size += size;
+		else
+			m_Segments.push_back({ memory, size });
+
+		NullCommandHeader* header = reinterpret_cast<NullCommandHeader*>(memory);
+		header->Type = type;
+		header->Size = (uint16_t)size;
+
+		m_CommandCount++;
+		return memory + sizeof(NullCommandHeader);
+	}
+
+	void NullCommandList::SetRootSignature(uint64_t rootSignature)
+	{
+		NullSetRootSignatureCommand command = { rootSignature };
+		memcpy(Record(NullCommandType::SetRootSignature, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::SetPipelineState(uint64_t pipeline)
+	{
+		NullSetPipelineStateCommand command = { pipeline };
+		memcpy(Record(NullCommandType::SetPipelineState, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::SetDescriptorHeaps(uint64_t resourceHeap, uint64_t samplerHeap)
+	{
+		NullSetDescriptorHeapsCommand command = { resourceHeap, samplerHeap };
+		memcpy(Record(NullCommandType::SetDescriptorHeaps, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::SetRenderTarget(uint64_t renderTargetView)
+	{
+		NullSetRenderTargetCommand command = { renderTargetView };
+		memcpy(Record(NullCommandType::SetRenderTarget, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::SetConstantBuffer(uint32_t slot, uint64_t gpuAddress)
+	{
+		NullSetConstantBufferCommand command = {};
+		command.GPUAddress = gpuAddress;
+		command.Slot = slot;
+		memcpy(Record(NullCommandType::SetConstantBuffer, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::SetDescriptorTable(uint32_t slot, uint64_t gpuHandle)
+	{
+		NullSetDescriptorTableCommand command = {};
+		command.GPUHandle = gpuHandle;
+		command.Slot = slot;
+		memcpy(Record(NullCommandType::SetDescriptorTable, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::ClearRenderTarget(uint64_t renderTargetView, const float (&color)[4])
+	{
+		NullClearRenderTargetCommand command = { renderTargetView, { color[0], color[1], color[2], color[3] } };
+		memcpy(Record(NullCommandType::ClearRenderTarget, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::ResourceBarriers(const ResourceBarrier* barriers, uint32_t count)
+	{
+		//The size of a command is 16 bits, a big batch is split in several commands
+		const uint32_t maxPerCommand = (UINT16_MAX - 64) / (uint32_t)sizeof(ResourceBarrier);
+
+		while (count > 0)
+		{
+			uint32_t batch = HTUtils::HTMin(count, maxPerCommand);
+
+			NullResourceBarriersCommand command = { batch };
+			uint8_t* payload = Record(NullCommandType::ResourceBarriers, (uint32_t)(sizeof(command) + batch * sizeof(ResourceBarrier)));
+
+			memcpy(payload, &command, sizeof(command));
+			memcpy(payload + sizeof(command), barriers, batch * sizeof(ResourceBarrier));
+
+			barriers += batch;
+			count -= batch;
+		}
+	}
+
+	void NullCommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+	{
+		NullDrawCommand command = { vertexCount, instanceCount, startVertex, startInstance };
+		memcpy(Record(NullCommandType::Draw, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+	{
+		NullDispatchCommand command = { x, y, z };
+		memcpy(Record(NullCommandType::Dispatch, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::EndQuery(uint64_t* queryHeap, uint32_t index)
+	{
+		NullEndQueryCommand command = { (uint64_t)(uintptr_t)queryHeap, index };
+		memcpy(Record(NullCommandType::EndQuery, sizeof(command)), &command, sizeof(command));
+	}
+
+	void NullCommandList::ResolveQueries(const uint64_t* queryHeap, uint32_t first, uint32_t count, uint64_t* destination)
+	{
+		NullResolveQueriesCommand command = { (uint64_t)(uintptr_t)queryHeap, (uint64_t)(uintptr_t)destination, first, count };
+		memcpy(Record(NullCommandType::ResolveQueries, sizeof(command)), &command, sizeof(command));
+	}
+
+	NullCommandPoolBackend::~NullCommandPoolBackend()
+	{
+		D3D_ASSERT(m_LiveAllocators == 0 && m_LiveCommandLists == 0, "Destroying the null backend before its command pools!");
+	}
+
+	void* NullCommandPoolBackend::CreateAllocator(CommandQueueType type)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_LiveAllocators++;
+		}
+
+		return new NullCommandAllocator(type);
+	}
+
+	void NullCommandPoolBackend::ResetAllocator(void* allocator)
+	{
+		static_cast<NullCommandAllocator*>(allocator)->Reset();
+	}
+
+	void NullCommandPoolBackend::DestroyAllocator(void* allocator)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_LiveAllocators--;
+		}
+
+		delete static_cast<NullCommandAllocator*>(allocator);
+	}
+
+	void* NullCommandPoolBackend::CreateCommandList(CommandQueueType type, void* allocator)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_LiveCommandLists++;
+		}
+
+		return new NullCommandList(type, static_cast<NullCommandAllocator*>(allocator));
+	}
+
+	void NullCommandPoolBackend::ResetCommandList(void* commandList, void* allocator)
+	{
+		ToNullCommandList(commandList)->Reset(static_cast<NullCommandAllocator*>(allocator));
+	}
+
+	void NullCommandPoolBackend::DestroyCommandList(void* commandList)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_LiveCommandLists--;
+		}
+
+		delete ToNullCommandList(commandList);
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <renderer/commandPool.h>
+#include <renderer/resourceStateTracker.h>
+
+namespace HT
+{
+	//The commands a null list can record. They are a small subset of ID3D12GraphicsCommandList, just what our frame uses.
+	enum class NullCommandType : uint16_t
+	{
+		SetPipelineState = 0,
+		SetDescriptorHeaps,
+		SetRenderTarget,
+		SetConstantBuffer,
+		SetDescriptorTable,
+		ClearRenderTarget,
+		ResourceBarriers,
+		Draw,
+		Dispatch,
+		SetRootSignature,
+		EndQuery,
+		ResolveQueries,
+
+		Count
+	};
+
+	const char* NullCommandTypeName(NullCommandType type);
+
+	//Every command starts with this header, followed by its payload. Size includes the header (and the padding to 8 bytes), 
+	//so we can walk the stream without knowing the commands.
+	struct alignas(8) NullCommandHeader
+	{
+		NullCommandType Type;
+		uint16_t Size;
+	};
+
+	//The payloads. ResourceBarriers is followed by Count HT::ResourceBarrier.
+	struct NullSetPipelineStateCommand  { uint64_t Pipeline; };
+	struct NullSetDescriptorHeapsCommand { uint64_t ResourceHeap; uint64_t SamplerHeap; };
+	struct NullSetRenderTargetCommand   { uint64_t RenderTargetView; };
+	struct NullSetConstantBufferCommand { uint64_t GPUAddress; uint32_t Slot; };
+	struct NullSetDescriptorTableCommand { uint64_t GPUHandle; uint32_t Slot; };
+	struct NullClearRenderTargetCommand { uint64_t RenderTargetView; float Color[4]; };
+	struct NullResourceBarriersCommand  { uint32_t Count; };
+	struct NullDrawCommand              { uint32_t VertexCount; uint32_t InstanceCount; uint32_t StartVertex; uint32_t StartInstance; };
+	struct NullDispatchCommand          { uint32_t X; uint32_t Y; uint32_t Z; };
+	struct NullSetRootSignatureCommand  { uint64_t RootSignature; };
+
+	//The query heap and the destination are arrays of uint64_t on the CPU, the queue writes the time when it executes EndQuery
+	struct NullEndQueryCommand          { uint64_t QueryHeap; uint32_t Index; };
+	struct NullResolveQueriesCommand    { uint64_t QueryHeap; uint64_t Destination; uint32_t First; uint32_t Count; };
+
+	//The memory of the null lists, like a command allocator. It is a list of fixed size blocks that are only given back when the allocator is reset,
+	//so after the first frames recording a list never allocates.
+	class NullCommandAllocator
+	{
+	public:
+		static constexpr uint32_t s_BlockSize = 64 * 1024;
+
+		explicit NullCommandAllocator(CommandQueueType type) : m_Type(type) {}
+
+		NullCommandAllocator(const NullCommandAllocator&) = delete;
+		NullCommandAllocator& operator=(const NullCommandAllocator&) = delete;
+
+		//Returns size contiguous bytes, right after the last allocation unless the current block can't fit them.
+		uint8_t* Allocate(uint32_t size);
+
+		void Reset();
+
+		inline CommandQueueType GetType() const { return m_Type; }
+		inline uint64_t GetReservedBytes() const { return (uint64_t)m_Blocks.size() * s_BlockSize; }
+
+	private:
+		CommandQueueType m_Type;
+
+		std::vector<std::vector<uint8_t>> m_Blocks;
+		uint32_t m_CurrentBlock = 0;
+		uint32_t m_CurrentOffset = 0;
+	};
+
+	//A command list that records into a NullCommandAllocator. The commands are real (packed in memory, like a driver would), the null queue walks them when it executes the list.
+	//The rules of a D3D12 list apply: it records on one thread at a time, it must be closed before it is executed and it is reset together with an allocator.
+	class NullCommandList
+	{
+	public:
+		//A contiguous run of commands inside a block of the allocator
+		struct Segment
+		{
+			const uint8_t* Data;
+			uint32_t Size;
+		};
+
+		NullCommandList(CommandQueueType type, NullCommandAllocator* allocator);
+
+		NullCommandList(const NullCommandList&) = delete;
+		NullCommandList& operator=(const NullCommandList&) = delete;
+
+		void Reset(NullCommandAllocator* allocator);
+		void Close();
+
+		void SetRootSignature(uint64_t rootSignature);
+		void SetPipelineState(uint64_t pipeline);
+		void SetDescriptorHeaps(uint64_t resourceHeap, uint64_t samplerHeap);
+		void SetRenderTarget(uint64_t renderTargetView);
+		void SetConstantBuffer(uint32_t slot, uint64_t gpuAddress);
+		void SetDescriptorTable(uint32_t slot, uint64_t gpuHandle);
+		void ClearRenderTarget(uint64_t renderTargetView, const float (&color)[4]);
+		void ResourceBarriers(const ResourceBarrier* barriers, uint32_t count);
+		void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance);
+		void Dispatch(uint32_t x, uint32_t y, uint32_t z);
+		void EndQuery(uint64_t* queryHeap, uint32_t index);
+		void ResolveQueries(const uint64_t* queryHeap, uint32_t first, uint32_t count, uint64_t* destination);
+
+		inline bool IsClosed() const { return m_Closed; }
+		inline CommandQueueType GetType() const { return m_Type; }
+		inline uint32_t GetCommandCount() const { return m_CommandCount; }
+		inline const std::vector<Segment>& GetSegments() const { return m_Segments; }
+
+	private:
+		uint8_t* Record(NullCommandType type, uint32_t payloadSize);
+
+	private:
+		CommandQueueType m_Type;
+		NullCommandAllocator* m_Allocator;
+
+		std::vector<Segment> m_Segments;
+		uint32_t m_CommandCount = 0;
+		bool m_Closed = false;
+	};
+
+	//Creates null allocators and lists for the command pool.
+	class NullCommandPoolBackend : public ICommandPoolBackend
+	{
+	public:
+		~NullCommandPoolBackend();
+
+		void* CreateAllocator(CommandQueueType type) override;
+		void ResetAllocator(void* allocator) override;
+		void DestroyAllocator(void* allocator) override;
+
+		void* CreateCommandList(CommandQueueType type, void* allocator) override;
+		void ResetCommandList(void* commandList, void* allocator) override;
+		void DestroyCommandList(void* commandList) override;
+
+		inline uint32_t GetLiveAllocatorCount()   const { return m_LiveAllocators; }
+		inline uint32_t GetLiveCommandListCount() const { return m_LiveCommandLists; }
+
+	private:
+		std::mutex m_Mutex;
+		uint32_t m_LiveAllocators   = 0;
+		uint32_t m_LiveCommandLists = 0;
+	};
+
+	inline NullCommandList* ToNullCommandList(void* commandList) { return static_cast<NullCommandList*>(commandList); }
+	inline NullCommandList* ToNullCommandList(const PooledCommandList& commandList) { return static_cast<NullCommandList*>(commandList.NativeCommandList); }
+}
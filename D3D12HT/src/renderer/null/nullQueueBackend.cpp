@@ -0,0 +1,265 @@
+#include "nullQueueBackend.h"
+
+#include <cstring>
+
+#include <util/hash.h>
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+
+namespace HT
+{
+	uint64_t NullFence::Signal()
+	{
+		return m_Backend->Signal(m_Queue);
+	}
+
+	void NullFence::WaitForValue(uint64_t value)
+	{
+		if (IsComplete(value))
+			return;
+
+		std::lock_guard<std::mutex> lock(m_Backend->m_Mutex);
+		m_Backend->ExecuteUntilLocked((uint32_t)m_Queue, value);
+	}
+
+	NullQueueBackend::NullQueueBackend()
+	{
+		for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+		{
+			m_Queues[i].Fence.m_Backend = this;
+			m_Queues[i].Fence.m_Queue = (CommandQueueType)i;
+		}
+
+		m_Stats.Checksum = HTUtils::g_HashSeed;
+	}
+
+	void NullQueueBackend::ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			NullCommandList* commandList = ToNullCommandList(commandLists[i]);
+			D3D_ASSERT(commandList->IsClosed(), "Executing a null list that was not closed!");
+			D3D_ASSERT(commandList->GetType() == queue, "Executing a null list on a queue of another type!");
+
+			Queue& nullQueue = m_Queues[(uint32_t)queue];
+			const std::vector<NullCommandList::Segment>& segments = commandList->GetSegments();
+
+			nullQueue.Segments.insert(nullQueue.Segments.end(), segments.begin(), segments.end());
+			nullQueue.Operations.push_back({ OperationType::Execute, queue, 0, (uint32_t)segments.size() });
+		}
+	}
+
+	uint64_t NullQueueBackend::Signal(CommandQueueType queue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return SignalLocked(queue);
+	}
+
+	uint64_t NullQueueBackend::SignalLocked(CommandQueueType queue)
+	{
+		Queue& nullQueue = m_Queues[(uint32_t)queue];
+
+		uint64_t value = nullQueue.Fence.m_SignaledValue.load(std::memory_order_relaxed) + 1;
+		nullQueue.Fence.m_SignaledValue.store(value, std::memory_order_release);
+
+		nullQueue.Operations.push_back({ OperationType::Signal, queue, value, 0 });
+		return value;
+	}
+
+	void NullQueueBackend::Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		D3D_ASSERT(value <= m_Queues[(uint32_t)signalingQueue].Fence.GetLastSignaledValue(), "Waiting for a value that was never signaled, this would hang a real queue!");
+		m_Queues[(uint32_t)queue].Operations.push_back({ OperationType::Wait, signalingQueue, value, 0 });
+	}
+
+	void NullQueueBackend::ExecuteAll()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (uint32_t i = 0; i < (uint32_t)CommandQueueType::Count; i++)
+			ExecuteUntilLocked(i, m_Queues[i].Fence.GetLastSignaledValue());
+	}
+
+	NullQueueStats NullQueueBackend::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	void NullQueueBackend::ExecuteUntilLocked(uint32_t queueIndex, uint64_t value)
+	{
+		Queue& queue = m_Queues[queueIndex];
+
+		while (queue.Fence.GetCompletedValue() < value)
+		{
+			D3D_ASSERT(!queue.Operations.empty(), "Waiting for a value that is not in the stream of the queue!");
+
+			Operation operation = queue.Operations.front();
+			queue.Operations.pop_front();
+
+			switch (operation.Type)
+			{
+			case OperationType::Execute:
+				ExecuteCommandList(queue, operation.SegmentCount);
+				break;
+
+			case OperationType::Signal:
+				queue.Fence.m_CompletedValue.store(operation.Value, std::memory_order_release);
+				m_Stats.Signals++;
+				break;
+
+			case OperationType::Wait:
+				//The other queue can't be waiting for us (the scheduler only waits for values that were already signaled), so this always ends
+				ExecuteUntilLocked((uint32_t)operation.OtherQueue, operation.Value);
+				m_Stats.Waits++;
+				break;
+			}
+		}
+	}
+
+	void NullQueueBackend::ExecuteCommandList(Queue& queue, uint32_t segmentCount)
+	{
+		//We fold what each command does and not its bytes, the padding of the commands is garbage
+		HTUtils::HTHasher checksum(m_Stats.Checksum);
+
+		for (uint32_t s = 0; s < segmentCount; s++)
+		{
+			NullCommandList::Segment segment = queue.Segments.front();
+			queue.Segments.pop_front();
+
+			const uint8_t* current = segment.Data;
+			const uint8_t* end = segment.Data + segment.Size;
+
+			while (current < end)
+			{
+				NullCommandHeader header;
+				memcpy(&header, current, sizeof(header));
+
+				const uint8_t* payload = current + sizeof(NullCommandHeader);
+				checksum.Add(header.Type);
+
+				switch (header.Type)
+				{
+				case NullCommandType::SetRootSignature:
+				{
+					NullSetRootSignatureCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.RootSignature);
+				} break;
+
+				case NullCommandType::SetPipelineState:
+				{
+					NullSetPipelineStateCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.Pipeline);
+				} break;
+
+				case NullCommandType::SetDescriptorHeaps:
+				{
+					NullSetDescriptorHeapsCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.ResourceHeap).Add(command.SamplerHeap);
+				} break;
+
+				case NullCommandType::SetRenderTarget:
+				{
+					NullSetRenderTargetCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.RenderTargetView);
+				} break;
+
+				case NullCommandType::SetConstantBuffer:
+				{
+					NullSetConstantBufferCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.GPUAddress).Add(command.Slot);
+				} break;
+
+				case NullCommandType::SetDescriptorTable:
+				{
+					NullSetDescriptorTableCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.GPUHandle).Add(command.Slot);
+				} break;
+
+				case NullCommandType::ClearRenderTarget:
+				{
+					NullClearRenderTargetCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.RenderTargetView).Add(command.Color);
+				} break;
+
+				case NullCommandType::ResourceBarriers:
+				{
+					NullResourceBarriersCommand command;
+					memcpy(&command, payload, sizeof(command));
+
+					const uint8_t* barriers = payload + sizeof(command);
+					for (uint32_t i = 0; i < command.Count; i++)
+					{
+						ResourceBarrier barrier;
+						memcpy(&barrier, barriers + i * sizeof(ResourceBarrier), sizeof(barrier));
+						checksum.Add(barrier.Type).Add(barrier.Flags).Add(barrier.Resource).Add(barrier.Before).Add(barrier.After);
+					}
+
+					m_Stats.Barriers += command.Count;
+				} break;
+
+				case NullCommandType::Draw:
+				{
+					NullDrawCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.VertexCount).Add(command.InstanceCount).Add(command.StartVertex).Add(command.StartInstance);
+					m_Stats.Draws++;
+				} break;
+
+				case NullCommandType::Dispatch:
+				{
+					NullDispatchCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.X).Add(command.Y).Add(command.Z);
+					m_Stats.Dispatches++;
+				} break;
+
+				//The times and the memory they go to change from run to run, only the queries are part of the checksum
+				case NullCommandType::EndQuery:
+				{
+					NullEndQueryCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.Index);
+
+					reinterpret_cast<uint64_t*>((uintptr_t)command.QueryHeap)[command.Index] = HTUtils::HTNowNanoseconds();
+					m_Stats.Timestamps++;
+				} break;
+
+				case NullCommandType::ResolveQueries:
+				{
+					NullResolveQueriesCommand command;
+					memcpy(&command, payload, sizeof(command));
+					checksum.Add(command.First).Add(command.Count);
+
+					const uint64_t* queries = reinterpret_cast<const uint64_t*>((uintptr_t)command.QueryHeap);
+					memcpy(reinterpret_cast<uint64_t*>((uintptr_t)command.Destination) + command.First, queries + command.First, command.Count * sizeof(uint64_t));
+				} break;
+
+				default:
+					D3D_ASSERT(false, "Unknown null command!");
+					break;
+				}
+
+				D3D_ASSERT(header.Size > 0, "A null command with no size!");
+				current += header.Size;
+				m_Stats.ExecutedCommands++;
+			}
+
+			m_Stats.ExecutedBytes += segment.Size;
+		}
+
+		m_Stats.ExecutedCommandLists++;
+		m_Stats.Checksum = checksum.Get();
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <renderer/queueScheduler.h>
+#include <renderer/null/nullCommandList.h>
+
+namespace HT
+{
+	class NullQueueBackend;
+
+	//The fence of a null queue. Like a D3D12 fence, Signal enqueues the signal on the queue (it is only reached once the queue executes everything before it),
+	//so the frame ring and the scheduler can share it the same way they share the fence of the direct queue.
+	class NullFence : public IFence
+	{
+	public:
+		uint64_t Signal() override;
+		uint64_t GetCompletedValue() const override { return m_CompletedValue.load(std::memory_order_acquire); }
+		uint64_t GetLastSignaledValue() const override { return m_SignaledValue.load(std::memory_order_acquire); }
+		void WaitForValue(uint64_t value) override;
+
+	private:
+		friend class NullQueueBackend;
+
+		NullQueueBackend* m_Backend = nullptr;
+		CommandQueueType m_Queue = CommandQueueType::Direct;
+
+		std::atomic<uint64_t> m_SignaledValue  = 0;
+		std::atomic<uint64_t> m_CompletedValue = 0;
+	};
+
+	//What the null GPU did. The checksum folds every command it executed (in execution order), two runs that record the same commands have the same checksum
+	//no matter how many threads recorded them.
+	struct NullQueueStats
+	{
+		uint64_t ExecutedCommandLists = 0;
+		uint64_t ExecutedCommands = 0;
+		uint64_t ExecutedBytes = 0;
+		uint64_t Draws = 0;
+		uint64_t Dispatches = 0;
+		uint64_t Timestamps = 0;
+		uint64_t Barriers = 0;
+		uint64_t Signals = 0;
+		uint64_t Waits = 0;
+		uint64_t Checksum = 0;
+	};
+
+	//Queues without a GPU, for running the frame loop headless (benchmarks, build machines without a GPU).
+	//Submitting only records the operation in the stream of the queue. The "GPU" is lazy: it executes a queue up to a value when someone on the CPU waits for it,
+	//so the work is always done at the same points and a run is deterministic (the fence waits happen on the same frames, whatever the machine is).
+	//Executing a list walks all its commands, so reading the command memory is part of the cost, like a real command processor would do.
+	//A queue that reaches a Wait first executes the other queue up to the waited value.
+	class NullQueueBackend : public ICommandQueueBackend
+	{
+	public:
+		NullQueueBackend();
+
+		NullQueueBackend(const NullQueueBackend&) = delete;
+		NullQueueBackend& operator=(const NullQueueBackend&) = delete;
+
+		void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) override;
+		uint64_t Signal(CommandQueueType queue) override;
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) override;
+		IFence* GetFence(CommandQueueType queue) override { return &m_Queues[(uint32_t)queue].Fence; }
+
+		inline NullFence* GetNullFence(CommandQueueType queue) { return &m_Queues[(uint32_t)queue].Fence; }
+
+		//Executes everything submitted so far, on all queues
+		void ExecuteAll();
+
+		NullQueueStats GetStats() const;
+
+	private:
+		friend class NullFence;
+
+		enum class OperationType : uint8_t
+		{
+			Execute,
+			Signal,
+			Wait
+		};
+
+		//An executed list only keeps its segments. The pool can reset the list as soon as it is submitted, but the memory of the segments 
+		//belongs to the allocator, which is only reset after the fence.
+		struct Operation
+		{
+			OperationType Type;
+			CommandQueueType OtherQueue;
+			uint64_t Value;
+			uint32_t SegmentCount;
+		};
+
+		struct Queue
+		{
+			NullFence Fence;
+			std::deque<Operation> Operations;
+			std::deque<NullCommandList::Segment> Segments;
+		};
+
+		uint64_t SignalLocked(CommandQueueType queue);
+
+		//Executes the queue until its fence reaches value. The mutex must be locked.
+		void ExecuteUntilLocked(uint32_t queue, uint64_t value);
+		void ExecuteCommandList(Queue& queue, uint32_t segmentCount);
+
+	private:
+		mutable std::mutex m_Mutex;
+
+		Queue m_Queues[(uint32_t)CommandQueueType::Count];
+
+		NullQueueStats m_Stats;
+	};
+}
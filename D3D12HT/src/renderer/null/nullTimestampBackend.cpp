@@ -0,0 +1,37 @@
+#include "nullTimestampBackend.h"
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+
+namespace HT
+{
+	NullTimestampBackend::NullTimestampBackend(uint32_t queryCount)
+	{
+		m_QueryHeap.resize(queryCount, 0);
+		m_Readback.resize(queryCount, 0);
+	}
+
+	void NullTimestampBackend::EndQuery(void* commandList, uint32_t query)
+	{
+		D3D_ASSERT(query < m_QueryHeap.size(), "Timestamp query out of range!");
+		ToNullCommandList(commandList)->EndQuery(m_QueryHeap.data(), query);
+	}
+
+	void NullTimestampBackend::ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(firstQuery + count <= m_QueryHeap.size(), "Timestamp resolve out of range!");
+		ToNullCommandList(commandList)->ResolveQueries(m_QueryHeap.data(), firstQuery, count, m_Readback.data());
+	}
+
+	const uint64_t* NullTimestampBackend::MapReadback(uint32_t firstQuery, uint32_t count)
+	{
+		D3D_ASSERT(firstQuery + count <= m_Readback.size(), "Timestamp readback out of range!");
+		return m_Readback.data() + firstQuery;
+	}
+
+	void NullTimestampBackend::GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds)
+	{
+		outCPUNanoseconds = HTUtils::HTNowNanoseconds();
+		outGPUTicks = outCPUNanoseconds;
+	}
+}
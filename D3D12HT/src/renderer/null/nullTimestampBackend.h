@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include <renderer/gpuProfiler.h>
+#include <renderer/null/nullCommandList.h>
+
+namespace HT
+{
+	//The timestamps of the null queues. EndQuery and ResolveQueries are recorded in the null lists and the queue does them when it executes the list,
+	//so the time is when the null GPU got there (the ticks are nanoseconds of HTUtils::HTNowNanoseconds, the calibration is the identity).
+	//The readback memory is written by whichever thread executes the queue, it is only read after the fence says it is done.
+	class NullTimestampBackend : public ITimestampBackend
+	{
+	public:
+		explicit NullTimestampBackend(uint32_t queryCount);
+
+		void EndQuery(void* commandList, uint32_t query) override;
+		void ResolveQueries(void* commandList, uint32_t firstQuery, uint32_t count) override;
+
+		const uint64_t* MapReadback(uint32_t firstQuery, uint32_t count) override;
+		void UnmapReadback() override {}
+
+		uint64_t GetFrequency() override { return 1000000000; }
+		void GetClockCalibration(uint64_t& outGPUTicks, uint64_t& outCPUNanoseconds) override;
+
+	private:
+		std::vector<uint64_t> m_QueryHeap;
+		std::vector<uint64_t> m_Readback;
+	};
+}
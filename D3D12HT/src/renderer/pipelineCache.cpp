@@ -0,0 +1,252 @@
+#include "pipelineCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/fileUtils.h>
+#include <util/hash.h>
+
+namespace HT
+{
+	uint64_t HashPipelineDesc(const PipelineDesc& desc)
+	{
+		HTUtils::HTHasher hasher;
+		hasher.Add(desc.Type);
+
+		for (const PipelineShader& shader : desc.Shaders)
+		{
+			if (!shader.IsValid())
+			{
+				hasher.Add<uint64_t>(0);
+				continue;
+			}
+
+			hasher.Add(shader.Hash ? shader.Hash : HTUtils::HTHash64(shader.Bytecode->data(), shader.Bytecode->size()));
+		}
+
+		hasher.Add(desc.RootSignatureHash);
+		hasher.Add<uint64_t>(desc.FixedFunctionState.size());
+		hasher.Add(desc.FixedFunctionState.data(), desc.FixedFunctionState.size());
+
+		return hasher.Get();
+	}
+
+	bool IsSamePipelineDesc(const PipelineDesc& a, const PipelineDesc& b)
+	{
+		if (a.Type != b.Type || a.RootSignatureHash != b.RootSignatureHash || a.FixedFunctionState != b.FixedFunctionState)
+			return false;
+
+		for (uint32_t i = 0; i < (uint32_t)ShaderStage::Count; i++)
+		{
+			const PipelineShader& shaderA = a.Shaders[i];
+			const PipelineShader& shaderB = b.Shaders[i];
+
+			if (shaderA.IsValid() != shaderB.IsValid())
+				return false;
+
+			if (shaderA.IsValid() && shaderA.Bytecode != shaderB.Bytecode && *shaderA.Bytecode != *shaderB.Bytecode)
+				return false;
+		}
+
+		return true;
+	}
+
+	void* CPUPipelineBackend::CreatePipeline(const PipelineDesc& /*desc*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CreateCount++;
+		m_LivePipelines++;
+		return (void*)(m_NextId++);
+	}
+
+	void CPUPipelineBackend::DestroyPipeline(void* /*pipeline*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LivePipelines--;
+	}
+
+	void CPUPipelineBackend::InitializeLibrary(std::vector<uint8_t> data)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_LibraryKeys.resize(data.size() / sizeof(uint64_t));
+		memcpy(m_LibraryKeys.data(), data.data(), m_LibraryKeys.size() * sizeof(uint64_t));
+	}
+
+	void* CPUPipelineBackend::LoadFromLibrary(uint64_t key, const PipelineDesc& /*desc*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (std::find(m_LibraryKeys.begin(), m_LibraryKeys.end(), key) == m_LibraryKeys.end())
+			return nullptr;
+
+		m_LivePipelines++;
+		return (void*)(m_NextId++);
+	}
+
+	void CPUPipelineBackend::StoreInLibrary(uint64_t key, void* /*pipeline*/)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LibraryKeys.push_back(key);
+	}
+
+	bool CPUPipelineBackend::SerializeLibrary(std::vector<uint8_t>& outData)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		outData.resize(m_LibraryKeys.size() * sizeof(uint64_t));
+		memcpy(outData.data(), m_LibraryKeys.data(), outData.size());
+		return true;
+	}
+
+	PipelineCache::PipelineCache(IPipelineBackend* backend, JobSystem* jobSystem) : m_Backend(backend), m_JobSystem(jobSystem)
+	{
+		D3D_ASSERT(backend, "The pipeline cache needs a backend!");
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		WaitAll();
+
+		for (Entry& entry : m_Entries)
+		{
+			if (entry.Pipeline)
+				m_Backend->DestroyPipeline(entry.Pipeline);
+		}
+	}
+
+	PipelineHandle PipelineCache::Request(const PipelineDesc& desc, PipelineHandle fallback)
+	{
+		uint64_t key = HashPipelineDesc(desc);
+		Entry* newEntry = nullptr;
+		PipelineHandle handle;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats.Requests++;
+
+			auto found = m_Handles.find(key);
+			if (found != m_Handles.end())
+			{
+				D3D_ASSERT(IsSamePipelineDesc(m_Entries[found->second].Desc, desc), "Two different pipelines with the same hash!");
+
+				m_Stats.Deduplicated++;
+				return found->second;
+			}
+
+			D3D_ASSERT(fallback == g_InvalidPipeline || fallback < m_Entries.size(), "Invalid fallback pipeline!");
+
+			handle = (PipelineHandle)m_Entries.size();
+			newEntry = &m_Entries.emplace_back();
+			newEntry->Desc = desc;
+			newEntry->Key = key;
+			newEntry->Fallback = fallback;
+
+			m_Handles[key] = handle;
+		}
+
+		if (m_JobSystem)
+			m_JobSystem->Run([this, newEntry]() { CreateEntry(*newEntry); }, &m_PendingJobs);
+		else
+			CreateEntry(*newEntry);
+
+		return handle;
+	}
+
+	void* PipelineCache::Get(PipelineHandle handle)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		bool usedFallback = false;
+		while (handle != g_InvalidPipeline)
+		{
+			Entry& entry = m_Entries[handle];
+			if (entry.State.load(std::memory_order_acquire) == EntryState::Ready)
+			{
+				if (usedFallback)
+					m_Stats.FallbackUses++;
+
+				return entry.Pipeline;
+			}
+
+			usedFallback = true;
+			handle = entry.Fallback;
+		}
+
+		m_Stats.FallbackUses++;
+		return nullptr;
+	}
+
+	bool PipelineCache::IsReady(PipelineHandle handle) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return handle < m_Entries.size() && m_Entries[handle].State.load(std::memory_order_acquire) == EntryState::Ready;
+	}
+
+	void PipelineCache::WaitAll()
+	{
+		if (m_JobSystem)
+			m_JobSystem->Wait(m_PendingJobs);
+	}
+
+	bool PipelineCache::LoadLibrary(const std::string& path)
+	{
+		std::vector<uint8_t> data;
+		bool loaded = HTUtils::HTReadFile(path, data);
+
+		m_Backend->InitializeLibrary(loaded ? std::move(data) : std::vector<uint8_t>());
+		return loaded;
+	}
+
+	bool PipelineCache::SaveLibrary(const std::string& path)
+	{
+		WaitAll();
+
+		std::vector<uint8_t> data;
+		if (!m_Backend->SerializeLibrary(data))
+			return false;
+
+		return HTUtils::HTWriteFileAtomic(path, data.data(), data.size());
+	}
+
+	PipelineCacheStats PipelineCache::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	uint32_t PipelineCache::GetPendingCount() const
+	{
+		return m_PendingJobs.GetValue();
+	}
+
+	void PipelineCache::CreateEntry(Entry& entry)
+	{
+		bool fromLibrary = true;
+		void* pipeline = m_Backend->LoadFromLibrary(entry.Key, entry.Desc);
+
+		if (!pipeline)
+		{
+			fromLibrary = false;
+			pipeline = m_Backend->CreatePipeline(entry.Desc);
+
+			if (pipeline)
+				m_Backend->StoreInLibrary(entry.Key, pipeline);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			if (!pipeline)
+				m_Stats.Failed++;
+			else if (fromLibrary)
+				m_Stats.LibraryHits++;
+			else
+				m_Stats.Created++;
+		}
+
+		entry.Pipeline = pipeline;
+		entry.State.store(pipeline ? EntryState::Ready : EntryState::Failed, std::memory_order_release);
+	}
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <renderer/shaderCache.h>
+
+namespace HT
+{
+	enum class PipelineType : uint8_t
+	{
+		Graphics = 0,
+		Compute
+	};
+
+	enum class ShaderStage : uint8_t
+	{
+		Vertex = 0,
+		Hull,
+		Domain,
+		Geometry,
+		Pixel,
+		Compute,
+
+		Count
+	};
+
+	struct PipelineShader
+	{
+		std::shared_ptr<const ShaderBytecode> Bytecode;
+
+		//The content key of the bytecode (ShaderCompileResult::Key). If it is 0 the bytecode itself is hashed.
+		uint64_t Hash = 0;
+
+		inline bool IsValid() const { return Bytecode != nullptr; }
+	};
+
+	inline PipelineShader ToPipelineShader(const ShaderCompileResult& result)
+	{
+		PipelineShader shader;
+		shader.Bytecode = result.Bytecode;
+		shader.Hash = result.Key;
+		return shader;
+	}
+
+	//Everything a pipeline is made of. The fixed function state (blend, rasterizer, depth, formats, input layout...) is defined by the backend
+	//and flattened to bytes (e.g: HT::BuildD3D12GraphicsState), this way the cache can hash and compare it without knowing what it is.
+	//The bytes must not have pointers or uninitialized padding, the same state must always give the same bytes (also in the next run).
+	struct PipelineDesc
+	{
+		PipelineType Type = PipelineType::Graphics;
+		PipelineShader Shaders[(uint32_t)ShaderStage::Count];
+
+		//The native root signature is used to create the pipeline. It can't be hashed (it is a pointer), so its hash goes with it 
+		//(e.g: the hash of the serialized root signature).
+		void* RootSignature = nullptr;
+		uint64_t RootSignatureHash = 0;
+
+		std::vector<uint8_t> FixedFunctionState;
+
+		//Not hashed
+		std::string DebugName;
+	};
+
+	//The same for identical descs, in this run and in the next ones
+	uint64_t HashPipelineDesc(const PipelineDesc& desc);
+	bool IsSamePipelineDesc(const PipelineDesc& a, const PipelineDesc& b);
+
+	//What the cache needs from the device. It must be thread safe, the pipelines are created on the job system.
+	class IPipelineBackend
+	{
+	public:
+		virtual ~IPipelineBackend() = default;
+
+		//nullptr if it failed
+		virtual void* CreatePipeline(const PipelineDesc& desc) = 0;
+		virtual void DestroyPipeline(void* pipeline) = 0;
+
+		//The library keeps the compiled pipelines between runs. The data is what SerializeLibrary gave in the last run (empty on the first one).
+		//If the data can't be used (e.g: another driver), the library just starts empty.
+		virtual void InitializeLibrary(std::vector<uint8_t> data) = 0;
+		virtual void* LoadFromLibrary(uint64_t key, const PipelineDesc& desc) = 0;
+		virtual void StoreInLibrary(uint64_t key, void* pipeline) = 0;
+		virtual bool SerializeLibrary(std::vector<uint8_t>& outData) = 0;
+	};
+
+	//Pipelines made of fake ids and a library made of the keys. It counts the creations, so we can check the dedupe and the library hits.
+	class CPUPipelineBackend : public IPipelineBackend
+	{
+	public:
+		void* CreatePipeline(const PipelineDesc& desc) override;
+		void DestroyPipeline(void* pipeline) override;
+
+		void InitializeLibrary(std::vector<uint8_t> data) override;
+		void* LoadFromLibrary(uint64_t key, const PipelineDesc& desc) override;
+		void StoreInLibrary(uint64_t key, void* pipeline) override;
+		bool SerializeLibrary(std::vector<uint8_t>& outData) override;
+
+		inline uint64_t GetCreateCount() const { return m_CreateCount; }
+		inline uint32_t GetLivePipelineCount() const { return m_LivePipelines; }
+
+	private:
+		std::mutex m_Mutex;
+		uintptr_t m_NextId = 1;
+		uint64_t m_CreateCount = 0;
+		uint32_t m_LivePipelines = 0;
+		std::vector<uint64_t> m_LibraryKeys;
+	};
+
+	using PipelineHandle = uint32_t;
+	const PipelineHandle g_InvalidPipeline = ~0u;
+
+	struct PipelineCacheStats
+	{
+		uint64_t Requests      = 0;
+
+		//Requests of a desc that was already requested
+		uint64_t Deduplicated  = 0;
+
+		uint64_t LibraryHits   = 0;
+		uint64_t Created       = 0;
+		uint64_t Failed        = 0;
+
+		//Times Get returned the fallback because the pipeline was not ready
+		uint64_t FallbackUses  = 0;
+	};
+
+	//Creating a pipeline compiles the shaders for the GPU, which can take many milliseconds. Doing it when we first draw with it is a hitch.
+	//So the pipelines are requested ahead of time and created on the job system:
+	//- The desc is hashed, identical descs get the same handle (and the same pipeline).
+	//- Until it is ready, Get returns the pipeline of the fallback (e.g: a simpler pipeline that is already created) or nullptr, meaning "skip the draw".
+	//- Before creating, we look in the pipeline library, which is saved to disk. So in the next run the pipelines are just loaded.
+	//
+	//The backend is an interface, so all this can run with a HT::CPUPipelineBackend.
+	class PipelineCache
+	{
+	public:
+		//Without a job system the pipelines are created in Request
+		PipelineCache(IPipelineBackend* backend, JobSystem* jobSystem = nullptr);
+		~PipelineCache();
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		//Thread safe
+		PipelineHandle Request(const PipelineDesc& desc, PipelineHandle fallback = g_InvalidPipeline);
+
+		//The native pipeline, the one of the fallback if it is not ready (or failed) or nullptr. Thread safe.
+		void* Get(PipelineHandle handle);
+		bool IsReady(PipelineHandle handle) const;
+
+		//Blocks until all the requested pipelines are created
+		void WaitAll();
+
+		//Loads/saves the pipeline library. Load before requesting anything.
+		bool LoadLibrary(const std::string& path);
+		bool SaveLibrary(const std::string& path);
+
+		PipelineCacheStats GetStats() const;
+		uint32_t GetPendingCount() const;
+
+	private:
+		enum class EntryState : uint8_t
+		{
+			Pending,
+			Ready,
+			Failed
+		};
+
+		struct Entry
+		{
+			PipelineDesc Desc;
+			uint64_t Key = 0;
+			PipelineHandle Fallback = g_InvalidPipeline;
+
+			std::atomic<EntryState> State = EntryState::Pending;
+			void* Pipeline = nullptr;
+		};
+
+		void CreateEntry(Entry& entry);
+
+	private:
+		IPipelineBackend* m_Backend;
+		JobSystem* m_JobSystem;
+
+		mutable std::mutex m_Mutex;
+
+		//A deque so the entries never move, the jobs hold a reference to theirs
+		std::deque<Entry> m_Entries;
+		std::unordered_map<uint64_t, PipelineHandle> m_Handles;
+
+		JobCounter m_PendingJobs;
+		PipelineCacheStats m_Stats;
+	};
+}
@@ -0,0 +1,162 @@
+#include "presentQueueModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	const char* PresentLatencyPolicyName(PresentLatencyPolicy policy)
+	{
+		switch (policy)
+		{
+		case PresentLatencyPolicy::PresentBlocking: return "present_blocking";
+		case PresentLatencyPolicy::Waitable:        return "waitable";
+		default:                                    return "unknown";
+		}
+	}
+
+	PresentQueueModel::PresentQueueModel(const PresentModelConfig& config, CostFunction cpuCost, CostFunction gpuCost)
+		: m_Config(config), m_CPUCost(std::move(cpuCost)), m_GPUCost(std::move(gpuCost))
+	{
+		D3D_ASSERT(m_CPUCost && m_GPUCost, "The present model needs the cost of the CPU and of the GPU!");
+		D3D_ASSERT(config.BackBufferCount >= 2, "The flip model needs at least two back buffers!");
+		D3D_ASSERT(config.FramesInFlight >= 1 && config.MaxFrameLatency >= 1, "We need at least one frame in flight and one frame of latency!");
+		D3D_ASSERT(!config.VSync || config.RefreshIntervalNs > 0, "VSync needs a refresh interval!");
+	}
+
+	uint64_t PresentQueueModel::GetDisplayTime(uint64_t gpuEndNs, uint64_t previousDisplayNs, bool hasPrevious) const
+	{
+		//Without VSync the flip happens as soon as the frame is done (tearing), but never before the previous one
+		if (!m_Config.VSync)
+			return hasPrevious ? HTUtils::HTMax(gpuEndNs, previousDisplayNs) : gpuEndNs;
+
+		//With VSync, the first vblank after the GPU is done. Only one flip per vblank.
+		const uint64_t refresh = m_Config.RefreshIntervalNs;
+		uint64_t vblank = (gpuEndNs + refresh - 1) / refresh;
+
+		if (hasPrevious)
+			vblank = HTUtils::HTMax(vblank, previousDisplayNs / refresh + 1);
+
+		return vblank * refresh;
+	}
+
+	void PresentQueueModel::Run()
+	{
+		const PresentModelConfig& config = m_Config;
+
+		m_Frames.clear();
+		m_Frames.resize(config.FrameCount);
+
+		uint64_t cpuTime = 0;
+
+		for (uint32_t i = 0; i < config.FrameCount; i++)
+		{
+			PresentModelFrame& frame = m_Frames[i];
+
+			//When the present queue has room for this frame
+			uint64_t queueRoomNs = i >= config.MaxFrameLatency ? m_Frames[i - config.MaxFrameLatency].DisplayNs : 0;
+
+			uint64_t blockedBegin = cpuTime;
+
+			if (config.Policy == PresentLatencyPolicy::Waitable)
+				cpuTime = HTUtils::HTMax(cpuTime, queueRoomNs);
+
+			frame.InputNs = cpuTime;
+
+			//The frame ring: the slot is free once the GPU finished the frame that used it before
+			if (i >= config.FramesInFlight)
+				cpuTime = HTUtils::HTMax(cpuTime, m_Frames[i - config.FramesInFlight].GPUEndNs);
+
+			uint64_t blockedBeforeRecord = cpuTime - blockedBegin;
+
+			cpuTime += m_CPUCost(i);
+			uint64_t submitNs = cpuTime;
+
+			//Present blocks until the queue has room. With the waitable policy it always has.
+			uint64_t presentBegin = cpuTime;
+			cpuTime = HTUtils::HTMax(cpuTime, queueRoomNs);
+
+			frame.PresentNs = cpuTime;
+			frame.CPUBlockedNs = blockedBeforeRecord + (cpuTime - presentBegin);
+
+			//The GPU renders in order, into a back buffer that is free once the frame after the one that used it is on the screen
+			uint64_t gpuStart = submitNs;
+
+			if (i > 0)
+				gpuStart = HTUtils::HTMax(gpuStart, m_Frames[i - 1].GPUEndNs);
+
+			if (i >= config.BackBufferCount)
+				gpuStart = HTUtils::HTMax(gpuStart, m_Frames[i - config.BackBufferCount + 1].DisplayNs);
+
+			frame.GPUStartNs = gpuStart;
+			frame.GPUEndNs = gpuStart + m_GPUCost(i);
+			frame.DisplayNs = GetDisplayTime(frame.GPUEndNs, i > 0 ? m_Frames[i - 1].DisplayNs : 0, i > 0);
+		}
+	}
+
+	PresentModelSummary PresentQueueModel::Summarize(uint32_t skipFrames) const
+	{
+		PresentModelSummary summary;
+
+		if (skipFrames >= m_Frames.size())
+			return summary;
+
+		uint32_t count = (uint32_t)m_Frames.size() - skipFrames;
+		summary.FrameCount = count;
+
+		std::vector<uint64_t> latencies;
+		latencies.reserve(count);
+
+		uint64_t totalInputToPresent = 0;
+		uint64_t totalBlocked = 0;
+
+		for (uint32_t i = skipFrames; i < (uint32_t)m_Frames.size(); i++)
+		{
+			const PresentModelFrame& frame = m_Frames[i];
+
+			latencies.push_back(frame.GetLatencyNs());
+			totalInputToPresent += frame.PresentNs - frame.InputNs;
+			totalBlocked += frame.CPUBlockedNs;
+
+			if (m_Config.VSync && i > skipFrames)
+			{
+				uint64_t refreshes = (frame.DisplayNs - m_Frames[i - 1].DisplayNs) / m_Config.RefreshIntervalNs;
+				summary.RepeatedRefreshes += refreshes > 1 ? (uint32_t)(refreshes - 1) : 0;
+			}
+		}
+
+		uint64_t totalLatency = 0;
+		for (uint64_t latency : latencies)
+			totalLatency += latency;
+
+		//Nearest rank, like HT::FrameStats
+		std::sort(latencies.begin(), latencies.end());
+
+		auto Percentile = [&latencies, count](double percent) -> double
+		{
+			uint32_t rank = HTUtils::HTMax((uint32_t)std::ceil(percent / 100.0 * count), 1u);
+			return HTUtils::HTNanosecondsToMilliseconds(latencies[rank - 1]);
+		};
+
+		summary.AverageLatencyMs = HTUtils::HTNanosecondsToMilliseconds(totalLatency) / count;
+		summary.P50LatencyMs = Percentile(50.0);
+		summary.P99LatencyMs = Percentile(99.0);
+		summary.MaxLatencyMs = HTUtils::HTNanosecondsToMilliseconds(latencies.back());
+
+		summary.AverageInputToPresentMs = HTUtils::HTNanosecondsToMilliseconds(totalInputToPresent) / count;
+		summary.AverageCPUBlockedMs = HTUtils::HTNanosecondsToMilliseconds(totalBlocked) / count;
+
+		if (count > 1)
+		{
+			uint64_t span = m_Frames.back().DisplayNs - m_Frames[skipFrames].DisplayNs;
+			summary.AverageFrameIntervalMs = HTUtils::HTNanosecondsToMilliseconds(span) / (count - 1);
+			summary.FramesPerSecond = span ? (count - 1) * 1e9 / (double)span : 0.0;
+		}
+
+		return summary;
+	}
+}
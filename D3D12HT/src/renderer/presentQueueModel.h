@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace HT
+{
+	//When the CPU waits for the present queue to have room.
+	//PresentBlocking - Sample the input, record, Present. When the queue is full, Present blocks. But the input was already sampled,
+	//                  so it gets older while the frame waits in Present and then in the queue. This is what we had before.
+	//Waitable        - Wait on the frame latency object of the swap chain (signaled when the queue has room) and only then sample the input.
+	//                  Present never blocks, the frame starts as late as possible and with the freshest input.
+	enum class PresentLatencyPolicy : uint8_t
+	{
+		PresentBlocking = 0,
+		Waitable
+	};
+
+	const char* PresentLatencyPolicyName(PresentLatencyPolicy policy);
+
+	struct PresentModelConfig
+	{
+		PresentLatencyPolicy Policy = PresentLatencyPolicy::PresentBlocking;
+
+		uint32_t BackBufferCount = 3;
+
+		//Slots of the frame ring, the CPU waits for the GPU to finish the frame that used the slot before
+		uint32_t FramesInFlight = 3;
+
+		//How many presents can be queued (IDXGISwapChain2::SetMaximumFrameLatency, DXGI uses 3 by default)
+		uint32_t MaxFrameLatency = 3;
+
+		bool VSync = true;
+		uint64_t RefreshIntervalNs = 16666667;
+
+		uint32_t FrameCount = 600;
+	};
+
+	//Everything is in nanoseconds since the start of the simulation
+	struct PresentModelFrame
+	{
+		uint64_t InputNs    = 0; //The CPU sampled the input
+		uint64_t PresentNs  = 0; //Present returned
+		uint64_t GPUStartNs = 0;
+		uint64_t GPUEndNs   = 0;
+		uint64_t DisplayNs  = 0; //The frame reached the screen
+
+		//Latency object + frame ring + Present
+		uint64_t CPUBlockedNs = 0;
+
+		inline uint64_t GetLatencyNs() const { return DisplayNs - InputNs; }
+	};
+
+	struct PresentModelSummary
+	{
+		//Input sample -> on screen, this is the input lag
+		double AverageLatencyMs = 0.0;
+		double P50LatencyMs     = 0.0;
+		double P99LatencyMs     = 0.0;
+		double MaxLatencyMs     = 0.0;
+
+		double AverageInputToPresentMs = 0.0;
+		double AverageCPUBlockedMs     = 0.0;
+
+		//Between two frames reaching the screen
+		double AverageFrameIntervalMs = 0.0;
+		double FramesPerSecond = 0.0;
+
+		//With VSync, refreshes that showed the same frame again (a stutter)
+		uint32_t RepeatedRefreshes = 0;
+		uint32_t FrameCount = 0;
+	};
+
+	//A model of the present queue described in the comments of Render: the CPU records frames and queues them, the GPU renders them in order into the back buffers
+	//and the display flips to a new frame at each vblank. A back buffer is only free again when the next frame is on the screen.
+	//It is a simple (and deterministic) timeline, so we can compare the latency policies, the frames in flight and the max latency anywhere, without a GPU or a display.
+	//
+	//The model assumes a present leaves the queue when it reaches the screen, so a new frame can be queued when the frame MaxFrameLatency frames before it was displayed.
+	class PresentQueueModel
+	{
+	public:
+		//How long the CPU and the GPU take for each frame
+		using CostFunction = std::function<uint64_t(uint64_t frameIndex)>;
+
+		PresentQueueModel(const PresentModelConfig& config, CostFunction cpuCost, CostFunction gpuCost);
+
+		void Run();
+
+		inline const std::vector<PresentModelFrame>& GetFrames() const { return m_Frames; }
+		inline const PresentModelConfig& GetConfig() const { return m_Config; }
+
+		//The first frames fill the queue, they can be skipped to measure the steady state
+		PresentModelSummary Summarize(uint32_t skipFrames = 0) const;
+
+	private:
+		uint64_t GetDisplayTime(uint64_t gpuEndNs, uint64_t previousDisplayNs, bool hasPrevious) const;
+
+	private:
+		PresentModelConfig m_Config;
+		CostFunction m_CPUCost;
+		CostFunction m_GPUCost;
+
+		std::vector<PresentModelFrame> m_Frames;
+	};
+}
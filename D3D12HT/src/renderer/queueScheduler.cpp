@@ -0,0 +1,149 @@
+#include "queueScheduler.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	QueueScheduler::QueueScheduler(ICommandQueueBackend* backend) : m_Backend(backend)
+	{
+		D3D_ASSERT(backend, "The queue scheduler needs a backend!");
+	}
+
+	QueueSyncPoint QueueScheduler::Submit(CommandQueueType queue, void* const* commandLists, uint32_t count, std::initializer_list<QueueSyncPoint> dependencies)
+	{
+		return Submit(queue, commandLists, count, dependencies.begin(), (uint32_t)dependencies.size());
+	}
+
+	QueueSyncPoint QueueScheduler::Submit(CommandQueueType queue, void* const* commandLists, uint32_t count, const QueueSyncPoint* dependencies, uint32_t dependencyCount)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		uint32_t queueIndex = (uint32_t)queue;
+
+		//Only the biggest value of each queue matters
+		uint64_t required[s_QueueCount] = {};
+		for (uint32_t i = 0; i < dependencyCount; i++)
+		{
+			uint32_t dependencyQueue = (uint32_t)dependencies[i].Queue;
+
+			if (dependencyQueue == queueIndex)
+				m_Stats.SkippedWaits++;
+			else
+				required[dependencyQueue] = HTUtils::HTMax(required[dependencyQueue], dependencies[i].FenceValue);
+		}
+
+		for (uint32_t otherQueue = 0; otherQueue < s_QueueCount; otherQueue++)
+		{
+			uint64_t value = required[otherQueue];
+			if (value == 0)
+				continue;
+
+			if (m_Clock[queueIndex][otherQueue] >= value)
+			{
+				m_Stats.SkippedWaits++;
+				continue;
+			}
+
+			//We depend on work of the other queue that was not signaled yet
+			if (value > m_Backend->GetFence((CommandQueueType)otherQueue)->GetLastSignaledValue())
+			{
+				D3D_ASSERT(value == m_PendingValue[otherQueue], "Depending on a sync point that was never submitted!");
+				SignalLocked(otherQueue);
+			}
+
+			m_Backend->Wait(queue, (CommandQueueType)otherQueue, value);
+			m_Stats.Waits++;
+
+			//Now we also know everything the other queue knew when it signaled this value
+			//Fence values can also be signaled outside of the scheduler (e.g: by the frame ring), so there may be no record of this value.
+			//What the queue knew at an earlier signal it still knew at this value, so we take the last record up to it.
+			m_Clock[queueIndex][otherQueue] = value;
+			for (auto record = m_SignalHistory[otherQueue].rbegin(); record != m_SignalHistory[otherQueue].rend(); ++record)
+			{
+				if (record->Value > value)
+					continue;
+
+				for (uint32_t i = 0; i < s_QueueCount; i++)
+					m_Clock[queueIndex][i] = HTUtils::HTMax(m_Clock[queueIndex][i], record->Clock[i]);
+
+				break;
+			}
+		}
+
+		if (count > 0)
+			m_Backend->ExecuteCommandLists(queue, commandLists, count);
+
+		m_Stats.Submissions++;
+
+		//Whoever signals the fence next (us or not) will signal this value, and it will be after this submission
+		m_PendingValue[queueIndex] = m_Backend->GetFence(queue)->GetLastSignaledValue() + 1;
+
+		QueueSyncPoint syncPoint;
+		syncPoint.Queue = queue;
+		syncPoint.FenceValue = m_PendingValue[queueIndex];
+		return syncPoint;
+	}
+
+	QueueSyncPoint QueueScheduler::Signal(CommandQueueType queue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		uint32_t queueIndex = (uint32_t)queue;
+		IFence* fence = m_Backend->GetFence(queue);
+
+		if (m_PendingValue[queueIndex] > fence->GetLastSignaledValue())
+			SignalLocked(queueIndex);
+
+		m_PendingValue[queueIndex] = 0;
+
+		QueueSyncPoint syncPoint;
+		syncPoint.Queue = queue;
+		syncPoint.FenceValue = fence->GetLastSignaledValue();
+		return syncPoint;
+	}
+
+	void QueueScheduler::WaitOnCPU(QueueSyncPoint syncPoint)
+	{
+		if (!syncPoint.IsValid())
+			return;
+
+		IFence* fence = m_Backend->GetFence(syncPoint.Queue);
+		if (syncPoint.FenceValue > fence->GetLastSignaledValue())
+			Signal(syncPoint.Queue);
+
+		fence->WaitForValue(syncPoint.FenceValue);
+	}
+
+	void QueueScheduler::Flush()
+	{
+		for (uint32_t queue = 0; queue < s_QueueCount; queue++)
+			WaitOnCPU(Signal((CommandQueueType)queue));
+	}
+
+	QueueSchedulerStats QueueScheduler::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	uint64_t QueueScheduler::SignalLocked(uint32_t queue)
+	{
+		SignalRecord record;
+		record.Value = m_Backend->Signal((CommandQueueType)queue);
+
+		for (uint32_t i = 0; i < s_QueueCount; i++)
+			record.Clock[i] = m_Clock[queue][i];
+
+		record.Clock[queue] = record.Value;
+
+		m_SignalHistory[queue].push_back(record);
+		if (m_SignalHistory[queue].size() > s_MaxSignalHistory)
+			m_SignalHistory[queue].pop_front();
+
+		m_PendingValue[queue] = 0;
+		m_Stats.Signals++;
+
+		return record.Value;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <mutex>
+
+#include <renderer/commandPool.h>
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//What the scheduler needs from the queues. Every queue type has one queue and one fence.
+	//The D3D12 one is HT::D3D12QueueBackend and HT::SimulatedQueueBackend runs the same stream of commands on a CPU model of the queues.
+	class ICommandQueueBackend
+	{
+	public:
+		virtual ~ICommandQueueBackend() = default;
+
+		virtual void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) = 0;
+
+		//Signals the fence of the queue with its next value, returns it
+		virtual uint64_t Signal(CommandQueueType queue) = 0;
+
+		//The queue doesn't execute anything submitted after this until the fence of signalingQueue reaches value. This is a GPU wait, the CPU doesn't block.
+		virtual void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) = 0;
+
+		virtual IFence* GetFence(CommandQueueType queue) = 0;
+	};
+
+	//A point in the timeline of a queue: everything submitted to Queue up to here is done once its fence reaches FenceValue.
+	struct QueueSyncPoint
+	{
+		CommandQueueType Queue = CommandQueueType::Direct;
+		uint64_t FenceValue    = 0;
+
+		inline bool IsValid() const { return FenceValue != 0; }
+	};
+
+	struct QueueSchedulerStats
+	{
+		uint64_t Submissions = 0;
+		uint64_t Signals     = 0;
+		uint64_t Waits       = 0;
+
+		//Dependencies that didn't need a wait: on the same queue, already waited for or known to be done through other waits.
+		uint64_t SkippedWaits = 0;
+	};
+
+	//Submits to the direct, compute and copy queues. Instead of syncing the queues by hand, a submission says which sync points of other queues it depends on
+	//and the scheduler inserts the waits and signals. It only inserts the ones that are needed:
+	//- A queue executes in order, so a dependency on the same queue is free.
+	//- Each queue remembers, for every other queue, the last value it waited for. And since a wait also makes the queue wait for everything the other queue 
+	//  waited for, this is known transitively (e.g: direct waits compute, which waited copy, so direct doesn't have to wait copy again).
+	//  This is a vector clock: each queue has, for every queue, the last value known to be done before its next submission.
+	//- Several dependencies on the same queue become a single wait, on the biggest value.
+	//- A submission isn't signaled right away. Its sync point is the next value of the fence and the signal is only inserted when someone waits for it
+	//  (or when Signal is called, e.g: at the end of the frame, so the CPU can know when the work is done).
+	class QueueScheduler
+	{
+	public:
+		explicit QueueScheduler(ICommandQueueBackend* backend);
+
+		QueueScheduler(const QueueScheduler&) = delete;
+		QueueScheduler& operator=(const QueueScheduler&) = delete;
+
+		QueueSyncPoint Submit(CommandQueueType queue, void* const* commandLists, uint32_t count, std::initializer_list<QueueSyncPoint> dependencies = {});
+		QueueSyncPoint Submit(CommandQueueType queue, void* const* commandLists, uint32_t count, const QueueSyncPoint* dependencies, uint32_t dependencyCount);
+
+		//Signals the work submitted to the queue that was not signaled yet. Returns the last signaled sync point of the queue.
+		QueueSyncPoint Signal(CommandQueueType queue);
+
+		//Blocks the CPU until the sync point is done (signaling it if needed)
+		void WaitOnCPU(QueueSyncPoint syncPoint);
+
+		//Blocks the CPU until all queues are idle
+		void Flush();
+
+		inline IFence* GetFence(CommandQueueType queue) const { return m_Backend->GetFence(queue); }
+
+		QueueSchedulerStats GetStats() const;
+
+	private:
+		static const uint32_t s_QueueCount = (uint32_t)CommandQueueType::Count;
+
+		//How many signals we remember per queue to know what a queue knew when it signaled. Older ones just don't propagate what they knew (we may wait more than needed, but never less).
+		static const uint32_t s_MaxSignalHistory = 64;
+
+		struct SignalRecord
+		{
+			uint64_t Value;
+			uint64_t Clock[s_QueueCount];
+		};
+
+		uint64_t SignalLocked(uint32_t queue);
+
+	private:
+		ICommandQueueBackend* m_Backend;
+		mutable std::mutex m_Mutex;
+
+		//[queue][otherQueue] = the last value of otherQueue known to be done before the next submission of queue
+		uint64_t m_Clock[s_QueueCount][s_QueueCount] = {};
+
+		//The value the work submitted but not signaled yet will be signaled with (0 if there is nothing pending)
+		uint64_t m_PendingValue[s_QueueCount] = {};
+
+		std::deque<SignalRecord> m_SignalHistory[s_QueueCount];
+
+		QueueSchedulerStats m_Stats;
+	};
+}
@@ -0,0 +1,338 @@
+#include "residencyManager.h"
+
+#include <algorithm>
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	const char* MemorySegmentName(MemorySegment segment)
+	{
+		switch (segment)
+		{
+		case MemorySegment::Local:    return "local";
+		case MemorySegment::NonLocal: return "non_local";
+		default:                      return "unknown";
+		}
+	}
+
+	void* CPUResidencyBackend::CreateHeap(uint64_t size, MemorySegment segment)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		void* heap = reinterpret_cast<void*>(m_NextId++);
+		m_Heaps[heap] = { size, segment, true };
+		m_ResidentBytes[(uint32_t)segment] += size;
+
+		return heap;
+	}
+
+	void CPUResidencyBackend::DestroyHeap(void* heap)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto it = m_Heaps.find(heap);
+		D3D_ASSERT(it != m_Heaps.end(), "Destroying a heap that doesn't exist!");
+
+		if (it->second.Resident)
+			m_ResidentBytes[(uint32_t)it->second.Segment] -= it->second.Size;
+
+		m_Heaps.erase(it);
+	}
+
+	void CPUResidencyBackend::MakeResident(const ResidencyHeap* heaps, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_MakeResidentCalls++;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Heap& heap = m_Heaps.at(heaps[i].NativeHeap);
+
+			if (!heap.Resident)
+			{
+				heap.Resident = true;
+				m_ResidentBytes[(uint32_t)heap.Segment] += heap.Size;
+			}
+		}
+	}
+
+	void CPUResidencyBackend::Evict(const ResidencyHeap* heaps, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_EvictCalls++;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Heap& heap = m_Heaps.at(heaps[i].NativeHeap);
+
+			if (heap.Resident)
+			{
+				heap.Resident = false;
+				m_ResidentBytes[(uint32_t)heap.Segment] -= heap.Size;
+			}
+		}
+	}
+
+	MemoryBudget CPUResidencyBackend::QueryBudget(MemorySegment segment)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		MemoryBudget budget;
+		budget.Budget = m_Budget[(uint32_t)segment];
+		budget.CurrentUsage = m_ExternalUsage[(uint32_t)segment] + m_ResidentBytes[(uint32_t)segment];
+		return budget;
+	}
+
+	void CPUResidencyBackend::SetBudget(MemorySegment segment, uint64_t budget)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Budget[(uint32_t)segment] = budget;
+	}
+
+	void CPUResidencyBackend::SetExternalUsage(MemorySegment segment, uint64_t usage)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ExternalUsage[(uint32_t)segment] = usage;
+	}
+
+	bool CPUResidencyBackend::IsResident(void* heap) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto it = m_Heaps.find(heap);
+		return it != m_Heaps.end() && it->second.Resident;
+	}
+
+	ResidencyManager::ResidencyManager(IResidencyBackend* backend, IMemoryBudgetSource* budgetSource, IFence* fence, const ResidencyConfig& config)
+		: m_Backend(backend), m_BudgetSource(budgetSource), m_Fence(fence), m_Config(config)
+	{
+		D3D_ASSERT(backend && budgetSource && fence, "The residency manager needs a backend, a budget source and a fence!");
+		D3D_ASSERT(config.BudgetFraction > 0.0f && config.BudgetFraction <= 1.0f, "The budget fraction must be in (0, 1]!");
+
+		m_Config.BudgetPollInterval = HTUtils::HTMax(config.BudgetPollInterval, 1u);
+		PollBudget();
+	}
+
+	ResidencyHandle ResidencyManager::Register(void* nativeHeap, uint64_t size, MemorySegment segment)
+	{
+		D3D_ASSERT(nativeHeap, "Registering a null heap!");
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		ResidencyHandle handle;
+		if (!m_FreeHandles.empty())
+		{
+			handle = m_FreeHandles.back();
+			m_FreeHandles.pop_back();
+		}
+		else
+		{
+			handle = (ResidencyHandle)m_Entries.size();
+			m_Entries.emplace_back();
+		}
+
+		Entry& entry = m_Entries[handle];
+		entry.Heap = { nativeHeap, size, segment };
+		entry.LastUsedFrame.store(m_FrameIndex, std::memory_order_relaxed);
+		entry.Resident = true;
+		entry.Live = true;
+
+		m_UsageDelta[(uint32_t)segment] += (int64_t)size;
+		m_Stats.ResidentBytes[(uint32_t)segment] += size;
+		m_Stats.HeapCount++;
+
+		return handle;
+	}
+
+	void ResidencyManager::Unregister(ResidencyHandle handle)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		D3D_ASSERT(handle < m_Entries.size() && m_Entries[handle].Live, "Unregistering an invalid residency handle!");
+
+		Entry& entry = m_Entries[handle];
+		uint32_t segment = (uint32_t)entry.Heap.Segment;
+
+		if (entry.Resident)
+		{
+			m_UsageDelta[segment] -= (int64_t)entry.Heap.Size;
+			m_Stats.ResidentBytes[segment] -= entry.Heap.Size;
+		}
+		else
+		{
+			m_Stats.EvictedBytes[segment] -= entry.Heap.Size;
+			m_Stats.EvictedHeapCount--;
+		}
+
+		entry.Live = false;
+		entry.Heap = {};
+		m_Stats.HeapCount--;
+
+		m_FreeHandles.push_back(handle);
+	}
+
+	void ResidencyManager::PollBudget()
+	{
+		for (uint32_t s = 0; s < (uint32_t)MemorySegment::Count; s++)
+		{
+			m_Stats.Budget[s] = m_BudgetSource->QueryBudget((MemorySegment)s);
+			m_UsageDelta[s] = 0;
+		}
+	}
+
+	void ResidencyManager::BeginFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_FrameIndex++ % m_Config.BudgetPollInterval == 0)
+			PollBudget();
+	}
+
+	void ResidencyManager::MarkUsed(ResidencyHandle handle)
+	{
+		//Many recording jobs can mark the same heap, they all write the same value
+		m_Entries[handle].LastUsedFrame.store(m_FrameIndex, std::memory_order_relaxed);
+	}
+
+	void ResidencyManager::Commit()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		const uint32_t segmentCount = (uint32_t)MemorySegment::Count;
+
+		while (!m_SubmittedFrames.empty() && m_Fence->IsComplete(m_SubmittedFrames.front().FenceValue))
+		{
+			m_CompletedFrame = m_SubmittedFrames.front().Frame;
+			m_SubmittedFrames.pop_front();
+		}
+
+		m_MakeResidentBatch.clear();
+		m_MakeResidentHandles.clear();
+		m_EvictBatch.clear();
+		m_Candidates.clear();
+
+		//What we would use after this frame: the usage the OS told us, what we changed since then and the heaps this frame needs back
+		int64_t projected[segmentCount];
+		int64_t target[segmentCount];
+
+		for (uint32_t s = 0; s < segmentCount; s++)
+		{
+			projected[s] = (int64_t)m_Stats.Budget[s].CurrentUsage + m_UsageDelta[s];
+			target[s] = (int64_t)(m_Stats.Budget[s].Budget * (double)m_Config.BudgetFraction);
+		}
+
+		for (ResidencyHandle handle = 0; handle < (ResidencyHandle)m_Entries.size(); handle++)
+		{
+			Entry& entry = m_Entries[handle];
+
+			if (!entry.Live)
+				continue;
+
+			uint64_t lastUsed = entry.LastUsedFrame.load(std::memory_order_relaxed);
+
+			if (!entry.Resident)
+			{
+				if (lastUsed == m_FrameIndex)
+				{
+					m_MakeResidentBatch.push_back(entry.Heap);
+					m_MakeResidentHandles.push_back(handle);
+					projected[(uint32_t)entry.Heap.Segment] += (int64_t)entry.Heap.Size;
+				}
+			}
+			//Not used by this frame and the GPU is done with it
+			else if (lastUsed < m_FrameIndex && lastUsed <= m_CompletedFrame)
+			{
+				m_Candidates.push_back(handle);
+			}
+		}
+
+		bool overBudget = false;
+		for (uint32_t s = 0; s < segmentCount; s++)
+			overBudget |= projected[s] > target[s];
+
+		if (overBudget)
+		{
+			//Least recently used first
+			std::sort(m_Candidates.begin(), m_Candidates.end(), [this](ResidencyHandle a, ResidencyHandle b)
+			{
+				return m_Entries[a].LastUsedFrame.load(std::memory_order_relaxed) < m_Entries[b].LastUsedFrame.load(std::memory_order_relaxed);
+			});
+
+			for (ResidencyHandle handle : m_Candidates)
+			{
+				Entry& entry = m_Entries[handle];
+				uint32_t segment = (uint32_t)entry.Heap.Segment;
+
+				if (projected[segment] <= target[segment])
+					continue;
+
+				projected[segment] -= (int64_t)entry.Heap.Size;
+				m_EvictBatch.push_back(entry.Heap);
+
+				entry.Resident = false;
+				m_UsageDelta[segment] -= (int64_t)entry.Heap.Size;
+				m_Stats.ResidentBytes[segment] -= entry.Heap.Size;
+				m_Stats.EvictedBytes[segment] += entry.Heap.Size;
+				m_Stats.EvictedHeapCount++;
+			}
+
+			for (uint32_t s = 0; s < segmentCount; s++)
+			{
+				if (projected[s] > target[s])
+				{
+					m_Stats.OverBudgetFrames++;
+					break;
+				}
+			}
+		}
+
+		//Make room first
+		if (!m_EvictBatch.empty())
+		{
+			m_Backend->Evict(m_EvictBatch.data(), (uint32_t)m_EvictBatch.size());
+			m_Stats.HeapsEvicted += m_EvictBatch.size();
+			m_Stats.EvictCalls++;
+		}
+
+		if (!m_MakeResidentBatch.empty())
+		{
+			m_Backend->MakeResident(m_MakeResidentBatch.data(), (uint32_t)m_MakeResidentBatch.size());
+			m_Stats.HeapsMadeResident += m_MakeResidentBatch.size();
+			m_Stats.MakeResidentCalls++;
+
+			for (ResidencyHandle handle : m_MakeResidentHandles)
+			{
+				Entry& entry = m_Entries[handle];
+				uint32_t segment = (uint32_t)entry.Heap.Segment;
+
+				entry.Resident = true;
+				m_UsageDelta[segment] += (int64_t)entry.Heap.Size;
+				m_Stats.ResidentBytes[segment] += entry.Heap.Size;
+				m_Stats.EvictedBytes[segment] -= entry.Heap.Size;
+				m_Stats.EvictedHeapCount--;
+			}
+		}
+	}
+
+	void ResidencyManager::EndFrame(uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		D3D_ASSERT(m_SubmittedFrames.empty() || m_SubmittedFrames.back().Frame < m_FrameIndex, "ResidencyManager::EndFrame called twice in a frame!");
+		m_SubmittedFrames.push_back({ m_FrameIndex, fenceValue });
+	}
+
+	ResidencyStats ResidencyManager::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	bool ResidencyManager::IsResident(ResidencyHandle handle) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return handle < m_Entries.size() && m_Entries[handle].Live && m_Entries[handle].Resident;
+	}
+}
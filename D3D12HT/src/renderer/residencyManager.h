@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <renderer/fence.h>
+
+namespace HT
+{
+	//Local is the memory of the GPU (VRAM on a discrete card), NonLocal is system memory the GPU can read (upload/readback heaps).
+	//Same meaning as DXGI_MEMORY_SEGMENT_GROUP_LOCAL/NON_LOCAL.
+	enum class MemorySegment : uint8_t
+	{
+		Local = 0,
+		NonLocal,
+
+		Count
+	};
+
+	const char* MemorySegmentName(MemorySegment segment);
+
+	//What the OS lets us use of a segment and how much we use. Same as DXGI_QUERY_VIDEO_MEMORY_INFO.
+	//The budget changes at runtime (other apps, the window going to the background...), so it must be polled.
+	struct MemoryBudget
+	{
+		uint64_t Budget       = 0;
+		uint64_t CurrentUsage = 0;
+	};
+
+	class IMemoryBudgetSource
+	{
+	public:
+		virtual ~IMemoryBudgetSource() = default;
+
+		virtual MemoryBudget QueryBudget(MemorySegment segment) = 0;
+	};
+
+	//A heap (or a committed resource, anything the device can page in and out) that the residency manager knows about
+	struct ResidencyHeap
+	{
+		void* NativeHeap = nullptr;
+		uint64_t Size = 0;
+		MemorySegment Segment = MemorySegment::Local;
+	};
+
+	//ID3D12Device::MakeResident and Evict. They are called at most once each per frame, with every heap of the frame in the same call.
+	class IResidencyBackend
+	{
+	public:
+		virtual ~IResidencyBackend() = default;
+
+		virtual void MakeResident(const ResidencyHeap* heaps, uint32_t count) = 0;
+		virtual void Evict(const ResidencyHeap* heaps, uint32_t count) = 0;
+	};
+
+	//The mock of the device and the OS: fake heaps, a budget we choose and the usage of the heaps that are resident.
+	//The "external usage" is the memory used by everyone else (other apps), so we can shrink what is left for us in the middle of a run.
+	class CPUResidencyBackend : public IResidencyBackend, public IMemoryBudgetSource
+	{
+	public:
+		//Heaps are created resident, like the D3D12 ones
+		void* CreateHeap(uint64_t size, MemorySegment segment);
+		void DestroyHeap(void* heap);
+
+		void MakeResident(const ResidencyHeap* heaps, uint32_t count) override;
+		void Evict(const ResidencyHeap* heaps, uint32_t count) override;
+
+		MemoryBudget QueryBudget(MemorySegment segment) override;
+
+		void SetBudget(MemorySegment segment, uint64_t budget);
+		void SetExternalUsage(MemorySegment segment, uint64_t usage);
+
+		bool IsResident(void* heap) const;
+
+		inline uint32_t GetLiveHeapCount()    const { return (uint32_t)m_Heaps.size(); }
+		inline uint64_t GetMakeResidentCalls() const { return m_MakeResidentCalls; }
+		inline uint64_t GetEvictCalls()        const { return m_EvictCalls; }
+
+	private:
+		struct Heap
+		{
+			uint64_t Size;
+			MemorySegment Segment;
+			bool Resident;
+		};
+
+		mutable std::mutex m_Mutex;
+		std::unordered_map<void*, Heap> m_Heaps;
+		uintptr_t m_NextId = 1;
+
+		uint64_t m_Budget[(uint32_t)MemorySegment::Count] = {};
+		uint64_t m_ExternalUsage[(uint32_t)MemorySegment::Count] = {};
+		uint64_t m_ResidentBytes[(uint32_t)MemorySegment::Count] = {};
+
+		uint64_t m_MakeResidentCalls = 0;
+		uint64_t m_EvictCalls = 0;
+	};
+
+	using ResidencyHandle = uint32_t;
+	const ResidencyHandle g_InvalidResidencyHandle = ~0u;
+
+	struct ResidencyConfig
+	{
+		//We try to stay under this fraction of the budget, the rest is headroom for the driver and for what we create before the next poll
+		float BudgetFraction = 0.9f;
+
+		//Polling the budget every frame is cheap enough, but it can be made less frequent
+		uint32_t BudgetPollInterval = 1;
+	};
+
+	struct ResidencyStats
+	{
+		MemoryBudget Budget[(uint32_t)MemorySegment::Count];
+
+		//Of the heaps registered in the manager
+		uint64_t ResidentBytes[(uint32_t)MemorySegment::Count] = {};
+		uint64_t EvictedBytes[(uint32_t)MemorySegment::Count] = {};
+
+		uint32_t HeapCount = 0;
+		uint32_t EvictedHeapCount = 0;
+
+		//Totals since the start
+		uint64_t HeapsMadeResident = 0;
+		uint64_t HeapsEvicted = 0;
+		uint64_t MakeResidentCalls = 0;
+		uint64_t EvictCalls = 0;
+
+		//Frames where even after evicting everything we could, we were still over the budget (the OS is going to page us)
+		uint64_t OverBudgetFrames = 0;
+	};
+
+	//Keeps the heaps we use under the memory budget of the OS. Above the budget the OS starts paging our heaps in and out by itself,
+	//at the worst moments, and the frame times collapse. So we choose what goes out: the heaps not used for the longest time (LRU).
+	//
+	//Every frame:
+	//- BeginFrame polls the budget.
+	//- While recording, MarkUsed tells which heaps the frame uses (from any thread, it is just an atomic store).
+	//- Commit, before the frame is submitted, makes resident the evicted heaps the frame uses and, if we are over budget, evicts the heaps
+	//  least recently used. Everything is done in one Evict and one MakeResident call.
+	//- EndFrame, after the frame was submitted, gets the fence value the frame ring signaled after it.
+	//
+	//"Used" is the number of the frame. A heap is only evicted once the fence value of the last frame that used it is completed (the same fence as the frame ring).
+	//The value isn't known while the frame records: anyone can signal the fence before the frame ring does.
+	class ResidencyManager
+	{
+	public:
+		ResidencyManager(IResidencyBackend* backend, IMemoryBudgetSource* budgetSource, IFence* fence, const ResidencyConfig& config = {});
+
+		ResidencyManager(const ResidencyManager&) = delete;
+		ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+		//The heap must be resident (just created). Not while frames are being recorded (MarkUsed may be running).
+		ResidencyHandle Register(void* nativeHeap, uint64_t size, MemorySegment segment);
+
+		//The heap can be destroyed after this. If the GPU may still use it, destroy it through the deferred release queue.
+		void Unregister(ResidencyHandle handle);
+
+		void BeginFrame();
+
+		//Any thread, between BeginFrame and Commit
+		void MarkUsed(ResidencyHandle handle);
+
+		void Commit();
+
+		//fenceValue is what HT::FrameRing::EndFrame returned
+		void EndFrame(uint64_t fenceValue);
+
+		ResidencyStats GetStats() const;
+		bool IsResident(ResidencyHandle handle) const;
+
+	private:
+		struct Entry
+		{
+			ResidencyHeap Heap;
+			std::atomic<uint64_t> LastUsedFrame = 0;
+			bool Resident = false;
+			bool Live = false;
+		};
+
+		void PollBudget();
+
+	private:
+		IResidencyBackend* m_Backend;
+		IMemoryBudgetSource* m_BudgetSource;
+		IFence* m_Fence;
+		ResidencyConfig m_Config;
+
+		mutable std::mutex m_Mutex;
+
+		//A deque so the entries never move: MarkUsed reads them without the lock
+		std::deque<Entry> m_Entries;
+		std::vector<ResidencyHandle> m_FreeHandles;
+
+		struct SubmittedFrame
+		{
+			uint64_t Frame;
+			uint64_t FenceValue;
+		};
+
+		//The number of the current frame, the first one is 1. The heaps registered before it were "used" by frame 0.
+		uint64_t m_FrameIndex = 0;
+
+		//The frames the GPU may still be running, oldest first, and the last one it finished
+		std::deque<SubmittedFrame> m_SubmittedFrames;
+		uint64_t m_CompletedFrame = 0;
+
+		//What changed since the last poll (the OS usage doesn't know it yet)
+		int64_t m_UsageDelta[(uint32_t)MemorySegment::Count] = {};
+
+		ResidencyStats m_Stats;
+
+		//Scratch, kept to not allocate every frame
+		std::vector<ResidencyHeap> m_MakeResidentBatch;
+		std::vector<ResidencyHandle> m_MakeResidentHandles;
+		std::vector<ResidencyHeap> m_EvictBatch;
+		std::vector<ResidencyHandle> m_Candidates;
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace HT
+{
+	//The states a resource can be in. The values are the same as D3D12_RESOURCE_STATES, so the D3D12 backend can just cast it.
+	//Several read states can be combined (e.g: a texture that is read by the pixel shader and copied from), but a write state is always alone.
+	enum class ResourceState : uint32_t
+	{
+		Common                   = 0,
+		VertexAndConstantBuffer  = 0x1,
+		IndexBuffer              = 0x2,
+		RenderTarget             = 0x4,
+		UnorderedAccess          = 0x8,
+		DepthWrite               = 0x10,
+		DepthRead                = 0x20,
+		NonPixelShaderResource   = 0x40,
+		PixelShaderResource      = 0x80,
+		StreamOut                = 0x100,
+		IndirectArgument         = 0x200,
+		CopyDest                 = 0x400,
+		CopySource               = 0x800,
+		ResolveDest              = 0x1000,
+		ResolveSource            = 0x2000,
+
+		Present                  = Common,
+		GenericRead              = VertexAndConstantBuffer | IndexBuffer | NonPixelShaderResource | PixelShaderResource | IndirectArgument | CopySource
+	};
+
+	inline ResourceState operator|(ResourceState a, ResourceState b) { return (ResourceState)((uint32_t)a | (uint32_t)b); }
+	inline ResourceState operator&(ResourceState a, ResourceState b) { return (ResourceState)((uint32_t)a & (uint32_t)b); }
+
+	//True if the state only has read bits. Common counts as read-only too, but it can't be combined with anything, so we don't treat it as mergeable.
+	inline bool IsMergeableReadState(ResourceState state)
+	{
+		const uint32_t readBits = (uint32_t)(ResourceState::GenericRead | ResourceState::DepthRead | ResourceState::ResolveSource);
+		return state != ResourceState::Common && ((uint32_t)state & ~readBits) == 0;
+	}
+
+	//Resources are identified by a number. For D3D12 it is the ID3D12Resource pointer, but any unique number works (tests, captures...).
+	using ResourceId = uint64_t;
+
+	//The state of each resource after all the command lists that were already submitted. 
+	//A command list doesn't know in which state a resource will be when it runs (other lists may run before it), 
+	//so the trackers only look at this when the list is submitted.
+	class ResourceStateRegistry
+	{
+	public:
+		void Register(ResourceId resource, ResourceState initialState)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_States[resource] = initialState;
+		}
+
+		void Unregister(ResourceId resource)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_States.erase(resource);
+		}
+
+		bool IsRegistered(ResourceId resource) const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_States.find(resource) != m_States.end();
+		}
+
+		//Unknown resources are considered to be in the Common state, like D3D12 does with resources that decay.
+		ResourceState Get(ResourceId resource) const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			auto it = m_States.find(resource);
+			return it != m_States.end() ? it->second : ResourceState::Common;
+		}
+
+		void Set(ResourceId resource, ResourceState state)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_States[resource] = state;
+		}
+
+	private:
+		mutable std::mutex m_Mutex;
+		std::unordered_map<ResourceId, ResourceState> m_States;
+	};
+}
@@ -0,0 +1,273 @@
+#include "resourceStateTracker.h"
+
+#include <util/simpleAssert.h>
+
+namespace HT
+{
+	void ResourceStateTracker::Reset(const ResourceStateRegistry* inlineRegistry)
+	{
+		m_InlineRegistry = inlineRegistry;
+
+		m_Resources.clear();
+		m_ResourceOrder.clear();
+		m_Batch.clear();
+		m_BatchRemoved.clear();
+		m_Flushed.clear();
+		m_Epoch++;
+	}
+
+	ResourceStateTracker::TrackedResource& ResourceStateTracker::GetTracked(ResourceId resource, bool& outIsNew)
+	{
+		auto inserted = m_Resources.try_emplace(resource);
+		outIsNew = inserted.second;
+
+		if (outIsNew)
+			m_ResourceOrder.push_back(resource);
+
+		return inserted.first->second;
+	}
+
+	uint32_t ResourceStateTracker::PushBarrier(const ResourceBarrier& barrier)
+	{
+		m_Batch.push_back(barrier);
+		m_BatchRemoved.push_back(false);
+
+		return (uint32_t)m_Batch.size() - 1;
+	}
+
+	void ResourceStateTracker::Transition(ResourceId resource, ResourceState state)
+	{
+		m_Stats.RequestedTransitions++;
+
+		bool isNew = false;
+		TrackedResource& tracked = GetTracked(resource, isNew);
+
+		if (isNew)
+		{
+			if (m_InlineRegistry)
+			{
+				tracked.State = m_InlineRegistry->Get(resource);
+			}
+			else
+			{
+				//We don't know the state yet, the barrier is generated on submit
+				tracked.PendingFirstUse = true;
+				tracked.FirstUseState = state;
+				tracked.State = state;
+				return;
+			}
+		}
+
+		if (tracked.SplitActive)
+		{
+			tracked.SplitActive = false;
+
+			if (tracked.SplitEpoch == m_Epoch)
+			{
+				//The begin didn't leave the batch yet, so there is no work in between. A split barrier would be useless, we do a normal transition instead.
+				m_BatchRemoved[tracked.SplitBatchIndex] = true;
+			}
+			else
+			{
+				PushBarrier({ BarrierType::Transition, BarrierFlags::EndOnly, resource, tracked.State, tracked.SplitState });
+
+				tracked.State = tracked.SplitState;
+				tracked.BatchIndex = s_NoBarrier;
+				tracked.HasBarrier = true;
+				m_Stats.SplitBarriers++;
+			}
+		}
+
+		AddTransition(tracked, resource, state);
+	}
+
+	void ResourceStateTracker::AddTransition(TrackedResource& tracked, ResourceId resource, ResourceState state)
+	{
+		if (tracked.State == state)
+		{
+			m_Stats.DroppedTransitions++;
+			return;
+		}
+
+		if (IsMergeableReadState(tracked.State) && IsMergeableReadState(state))
+		{
+			//Already readable in this state
+			if ((tracked.State & state) == state)
+			{
+				m_Stats.DroppedTransitions++;
+				return;
+			}
+
+			state = tracked.State | state;
+			m_Stats.MergedTransitions++;
+
+			//Nothing was emitted yet, so the list can just start in the combined state
+			if (tracked.PendingFirstUse && !tracked.HasBarrier)
+			{
+				tracked.FirstUseState = state;
+				tracked.State = state;
+				return;
+			}
+		}
+
+		//The resource already has a transition in this batch. Instead of adding a second barrier, change where the first one goes.
+		if (tracked.BatchEpoch == m_Epoch && tracked.BatchIndex != s_NoBarrier)
+		{
+			ResourceBarrier& barrier = m_Batch[tracked.BatchIndex];
+			m_Stats.MergedTransitions++;
+
+			if (barrier.Before == state)
+			{
+				m_BatchRemoved[tracked.BatchIndex] = true;
+				tracked.BatchIndex = s_NoBarrier;
+			}
+			else
+			{
+				barrier.After = state;
+			}
+
+			tracked.State = state;
+			return;
+		}
+
+		tracked.BatchIndex = PushBarrier({ BarrierType::Transition, BarrierFlags::None, resource, tracked.State, state });
+		tracked.BatchEpoch = m_Epoch;
+		tracked.State = state;
+		tracked.HasBarrier = true;
+	}
+
+	void ResourceStateTracker::BeginTransition(ResourceId resource, ResourceState state)
+	{
+		bool isNew = false;
+		TrackedResource& tracked = GetTracked(resource, isNew);
+
+		if (isNew)
+		{
+			//Without a registry we don't know where the resource is, so we can't begin anything. The later Transition will handle it.
+			if (!m_InlineRegistry)
+			{
+				m_Resources.erase(resource);
+				m_ResourceOrder.pop_back();
+				return;
+			}
+
+			tracked.State = m_InlineRegistry->Get(resource);
+		}
+
+		if (tracked.SplitActive || tracked.State == state)
+			return;
+
+		tracked.SplitActive = true;
+		tracked.SplitState = state;
+		tracked.SplitEpoch = m_Epoch;
+		tracked.SplitBatchIndex = PushBarrier({ BarrierType::Transition, BarrierFlags::BeginOnly, resource, tracked.State, state });
+		tracked.HasBarrier = true;
+	}
+
+	void ResourceStateTracker::UAVBarrier(ResourceId resource)
+	{
+		bool isNew = false;
+		TrackedResource& tracked = GetTracked(resource, isNew);
+
+		if (isNew)
+		{
+			//A UAV barrier doesn't change the state, the resource must already be in UnorderedAccess.
+			tracked.State = m_InlineRegistry ? m_InlineRegistry->Get(resource) : ResourceState::UnorderedAccess;
+			tracked.PendingFirstUse = !m_InlineRegistry;
+			tracked.FirstUseState = ResourceState::UnorderedAccess;
+		}
+
+		if (tracked.UAVEpoch == m_Epoch)
+		{
+			m_Stats.DroppedTransitions++;
+			return;
+		}
+
+		PushBarrier({ BarrierType::UAV, BarrierFlags::None, resource, ResourceState::UnorderedAccess, ResourceState::UnorderedAccess });
+		tracked.UAVEpoch = m_Epoch;
+		tracked.HasBarrier = true;
+	}
+
+	void ResourceStateTracker::AliasingBarrier(ResourceId resource)
+	{
+		//It doesn't change the state, it only has to come before the transitions of the resource in the batch
+		PushBarrier({ BarrierType::Aliasing, BarrierFlags::None, resource, ResourceState::Common, ResourceState::Common });
+	}
+
+	const std::vector<ResourceBarrier>& ResourceStateTracker::FlushBarriers()
+	{
+		m_Flushed.clear();
+
+		for (size_t i = 0; i < m_Batch.size(); i++)
+		{
+			if (!m_BatchRemoved[i])
+				m_Flushed.push_back(m_Batch[i]);
+		}
+
+		m_Batch.clear();
+		m_BatchRemoved.clear();
+		m_Epoch++;
+
+		if (!m_Flushed.empty())
+		{
+			m_Stats.Flushes++;
+			m_Stats.EmittedBarriers += m_Flushed.size();
+		}
+
+		return m_Flushed;
+	}
+
+	void ResourceStateTracker::Close()
+	{
+		for (ResourceId resource : m_ResourceOrder)
+		{
+			TrackedResource& tracked = m_Resources[resource];
+
+			if (!tracked.SplitActive)
+				continue;
+
+			tracked.SplitActive = false;
+
+			if (tracked.SplitEpoch == m_Epoch)
+			{
+				m_Batch[tracked.SplitBatchIndex].Flags = BarrierFlags::None;
+			}
+			else
+			{
+				PushBarrier({ BarrierType::Transition, BarrierFlags::EndOnly, resource, tracked.State, tracked.SplitState });
+				m_Stats.SplitBarriers++;
+			}
+
+			tracked.State = tracked.SplitState;
+			tracked.BatchIndex = s_NoBarrier;
+		}
+	}
+
+	void ResourceStateTracker::ResolvePendingBarriers(const ResourceStateRegistry& registry, std::vector<ResourceBarrier>& outBarriers) const
+	{
+		for (ResourceId resource : m_ResourceOrder)
+		{
+			const TrackedResource& tracked = m_Resources.at(resource);
+
+			if (!tracked.PendingFirstUse)
+				continue;
+
+			ResourceState before = registry.Get(resource);
+
+			//It has to be the exact state, the barriers recorded in the list have Before == FirstUseState
+			if (before != tracked.FirstUseState)
+				outBarriers.push_back({ BarrierType::Transition, BarrierFlags::None, resource, before, tracked.FirstUseState });
+		}
+	}
+
+	void ResourceStateTracker::CommitFinalStates(ResourceStateRegistry& registry) const
+	{
+		for (ResourceId resource : m_ResourceOrder)
+		{
+			const TrackedResource& tracked = m_Resources.at(resource);
+			D3D_ASSERT(!tracked.SplitActive, "Close the tracker before committing, a split barrier is still open!");
+
+			registry.Set(resource, tracked.State);
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <renderer/resourceState.h>
+
+namespace HT
+{
+	//Aliasing: the resource starts using memory that other placed resources of the same heap used before it. We don't keep which ones,
+	//so it means "any of them" (a null pResourceBefore for D3D12). Before/After are not used by UAV and aliasing barriers.
+	enum class BarrierType : uint8_t
+	{
+		Transition = 0,
+		UAV,
+		Aliasing
+	};
+
+	//Same meaning as D3D12_RESOURCE_BARRIER_FLAGS. A split barrier is a transition in two halves, the GPU can do the transition
+	//at any moment between the begin and the end, overlapping it with the work in the middle.
+	enum class BarrierFlags : uint8_t
+	{
+		None = 0,
+		BeginOnly,
+		EndOnly
+	};
+
+	struct ResourceBarrier
+	{
+		BarrierType Type = BarrierType::Transition;
+		BarrierFlags Flags = BarrierFlags::None;
+		ResourceId Resource = 0;
+		ResourceState Before = ResourceState::Common;
+		ResourceState After = ResourceState::Common;
+
+		inline bool operator==(const ResourceBarrier& other) const
+		{
+			return Type == other.Type && Flags == other.Flags && Resource == other.Resource && Before == other.Before && After == other.After;
+		}
+	};
+
+	struct ResourceStateTrackerStats
+	{
+		uint64_t RequestedTransitions = 0;
+		uint64_t EmittedBarriers      = 0;
+		uint64_t DroppedTransitions   = 0; //Redundant, or cancelled out inside a batch
+		uint64_t MergedTransitions    = 0; //Collapsed into a barrier of the same batch, or into a combined read state
+		uint64_t SplitBarriers        = 0; //Transitions that were emitted as begin/end pairs
+		uint64_t Flushes              = 0; //Batches with at least one barrier (= ResourceBarrier calls)
+	};
+
+	//Tracks the state of the resources used by one command list and generates the barriers for us.
+	//
+	//Instead of writing the transitions by hand (and submitting each one with its own ResourceBarrier call), we just say in which state we need a resource.
+	//The tracker then:
+	//- Drops transitions to the state the resource is already in.
+	//- Batches all transitions until FlushBarriers is called (right before the command that needs them), so they go in a single ResourceBarrier call.
+	//- Collapses A->B->C inside the same batch into A->C, and removes A->B->A.
+	//- Combines read states (a texture read as SRV and copy source doesn't need to go back and forth).
+	//- Emits split barriers: BeginTransition tells it that we will need a state later. If there is work between the begin and the Transition (a flush happened),
+	//  a BEGIN_ONLY and an END_ONLY barrier are emitted. Otherwise it is just a normal transition.
+	//
+	//The first time a resource is used in the list, we don't know its state (it depends on the lists submitted before this one). 
+	//So we remember the state it needs and ResolvePendingBarriers generates the missing transitions when the list is submitted, 
+	//against the global ResourceStateRegistry. Those barriers go into a small list executed right before this one.
+	//When the lists are recorded and submitted in order on a single thread, the registry can be given to Reset and the first use is resolved inline.
+	class ResourceStateTracker
+	{
+	public:
+		//Forget everything, called when the command list is reset.
+		void Reset(const ResourceStateRegistry* inlineRegistry = nullptr);
+
+		void Transition(ResourceId resource, ResourceState state);
+		void BeginTransition(ResourceId resource, ResourceState state);
+		void UAVBarrier(ResourceId resource);
+
+		//The content of the resource is undefined after it, the first use must clear it, discard it or overwrite all of it.
+		void AliasingBarrier(ResourceId resource);
+
+		//Returns all the barriers batched so far and empties the batch. The array is valid until the next call.
+		const std::vector<ResourceBarrier>& FlushBarriers();
+
+		//Call before the last flush. Ends the split barriers that were begun but never ended.
+		void Close();
+
+		//The transitions from the states in the registry to the states this list expects on the first use of each resource.
+		void ResolvePendingBarriers(const ResourceStateRegistry& registry, std::vector<ResourceBarrier>& outBarriers) const;
+
+		//After the list is submitted, the registry gets the state each resource has at the end of it.
+		void CommitFinalStates(ResourceStateRegistry& registry) const;
+
+		inline const ResourceStateTrackerStats& GetStats() const { return m_Stats; }
+
+	private:
+		static constexpr uint32_t s_NoBarrier = ~0u;
+
+		struct TrackedResource
+		{
+			ResourceState State = ResourceState::Common;
+
+			//When resolved at submit time, the state the resource needs at the first use in this list
+			bool PendingFirstUse = false;
+			ResourceState FirstUseState = ResourceState::Common;
+
+			//The barrier of this resource inside the current batch (only valid if BatchEpoch == m_Epoch)
+			uint32_t BatchIndex = s_NoBarrier;
+			uint32_t BatchEpoch = 0;
+
+			//A split barrier in progress
+			bool SplitActive = false;
+			ResourceState SplitState = ResourceState::Common;
+			uint32_t SplitEpoch = 0;
+			uint32_t SplitBatchIndex = s_NoBarrier;
+
+			//The last batch with a UAV barrier of this resource, so we don't add two in the same batch
+			uint32_t UAVEpoch = 0;
+
+			//If nothing was emitted for this resource yet, a pending first use can still absorb read states
+			bool HasBarrier = false;
+		};
+
+		TrackedResource& GetTracked(ResourceId resource, bool& outIsNew);
+		void AddTransition(TrackedResource& tracked, ResourceId resource, ResourceState state);
+		uint32_t PushBarrier(const ResourceBarrier& barrier);
+
+	private:
+		const ResourceStateRegistry* m_InlineRegistry = nullptr;
+
+		std::unordered_map<ResourceId, TrackedResource> m_Resources;
+
+		//The resources in the order they were first used, so the resolved barriers always come in the same order
+		std::vector<ResourceId> m_ResourceOrder;
+
+		//Barriers can be removed from the batch (A->B->A), we mark them as removed and skip them on flush so the indices stay valid
+		std::vector<ResourceBarrier> m_Batch;
+		std::vector<bool> m_BatchRemoved;
+		std::vector<ResourceBarrier> m_Flushed;
+		uint32_t m_Epoch = 1;
+
+		ResourceStateTrackerStats m_Stats;
+	};
+}
@@ -0,0 +1,105 @@
+#include "ringAllocator.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	RingAllocator::RingAllocator(uint64_t capacity) : m_Capacity(capacity)
+	{
+		D3D_ASSERT(capacity > 0, "RingAllocator needs a capacity!");
+		m_Stats.Capacity = capacity;
+	}
+
+	void RingAllocator::BeginFrame(uint64_t completedFenceValue)
+	{
+		//Frames are retired in order, the same order the GPU finishes them
+		while (m_PendingCount > 0)
+		{
+			const PendingFrame& frame = m_PendingFrames[m_PendingFirst];
+
+			if (frame.FenceValue > completedFenceValue)
+				break;
+
+			m_Tail = frame.EndOffset;
+			m_Stats.Used -= frame.Size;
+
+			m_PendingFirst = (m_PendingFirst + 1) % s_MaxPendingFrames;
+			m_PendingCount--;
+		}
+
+		//Bump and reset. If the GPU is done with everything, we can start again from the begin.
+		if (m_Stats.Used == 0)
+		{
+			m_Head = 0;
+			m_Tail = 0;
+		}
+
+		m_Stats.FrameUsed = 0;
+	}
+
+	uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		D3D_ASSERT(HTUtils::HTIsPowerOfTwo(alignment), "Ring alignment must be a power of two!");
+
+		if (size == 0)
+			return s_InvalidOffset;
+
+		//The free range is [head, capacity) + [0, tail) when the head is ahead of the tail (or the ring is empty)
+		//and it is [head, tail) when the head has wrapped around and is behind the tail.
+		bool headAhead = m_Head > m_Tail || m_Stats.Used == 0;
+		uint64_t alignedHead = HTUtils::HTAlignUp(m_Head, alignment);
+		uint64_t limit = headAhead ? m_Capacity : m_Tail;
+
+		uint64_t offset = 0;
+		uint64_t consumed = 0;
+
+		if (alignedHead + size <= limit)
+		{
+			offset = alignedHead;
+			consumed = alignedHead + size - m_Head;
+		}
+		else if (headAhead && size <= m_Tail)
+		{
+			//Doesn't fit at the end, but it fits at the begin. The end of the ring is lost until the tail passes it.
+			offset = 0;
+			consumed = (m_Capacity - m_Head) + size;
+			m_Stats.WrapCount++;
+		}
+		else
+		{
+			m_Stats.OverflowCount++;
+			m_Stats.OverflowSize += size;
+			return s_InvalidOffset;
+		}
+
+		m_Head = offset + size;
+		if (m_Head == m_Capacity)
+			m_Head = 0;
+
+		m_Stats.Used += consumed;
+		m_Stats.FrameUsed += consumed;
+		m_Stats.Padding += consumed - size;
+		m_Stats.PeakUsed = HTUtils::HTMax(m_Stats.PeakUsed, m_Stats.Used);
+		m_Stats.AllocationCount++;
+
+		return offset;
+	}
+
+	void RingAllocator::EndFrame(uint64_t fenceValue)
+	{
+		//A frame that allocated nothing doesn't need to be tracked
+		if (m_Stats.FrameUsed == 0)
+			return;
+
+		D3D_ASSERT(m_PendingCount < s_MaxPendingFrames, "Too many frames waiting for the GPU in the ring allocator!");
+
+		PendingFrame& frame = m_PendingFrames[(m_PendingFirst + m_PendingCount) % s_MaxPendingFrames];
+		frame.FenceValue = fenceValue;
+		frame.EndOffset = m_Head;
+		frame.Size = m_Stats.FrameUsed;
+
+		m_PendingCount++;
+		m_Stats.FrameUsed = 0;
+	}
+}
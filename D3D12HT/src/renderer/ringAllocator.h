@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace HT
+{
+	struct RingAllocatorStats
+	{
+		uint64_t Capacity        = 0;
+		uint64_t Used            = 0; //Units that the GPU may still be reading (including the ones of this frame)
+		uint64_t PeakUsed        = 0;
+		uint64_t FrameUsed       = 0; //Units given out in the current frame (including alignment and wrap padding)
+		uint64_t Padding         = 0; //Total units lost to alignment and wrap-around, since the creation
+		uint64_t AllocationCount = 0;
+		uint64_t OverflowCount   = 0; //How many allocations failed because the ring was full
+		uint64_t OverflowSize    = 0;
+		uint64_t WrapCount       = 0;
+	};
+
+	//A linear allocator on a ring of offsets, for memory that is used for one frame only. It doesn't know what is being allocated 
+	//(bytes of an upload buffer, descriptors of a heap...), it only gives out ranges of [0, capacity).
+	//Instead of creating something for each allocation, we just move the head forward (O(1)).
+	//
+	//The ranges given out during a frame can only be reused once the GPU finished this frame. So, at the end of the frame, we store where the 
+	//frame ended together with its fence value. At the begin of a new frame, all frames whose fence has completed are retired and their ranges are free again.
+	//When the ring is full we wrap around to the begin (if the GPU is already done with it). 
+	//When everything is retired, we reset the ring to the begin, so we don't keep wrapping around with a half empty ring.
+	class RingAllocator
+	{
+	public:
+		static constexpr uint64_t s_InvalidOffset = ~0ull;
+
+		//How many frames can be waiting for the GPU at the same time. It must be at least the frames in flight we use.
+		static constexpr uint32_t s_MaxPendingFrames = 16;
+
+		explicit RingAllocator(uint64_t capacity);
+
+		//Retire all frames that were completed by the GPU (this is, the frames with a fence value <= completedFenceValue).
+		void BeginFrame(uint64_t completedFenceValue);
+
+		//Returns s_InvalidOffset when there is not enough free space. It never waits for the GPU.
+		uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+
+		//Mark the end of a frame. fenceValue is the value that will be signaled after all the work that uses the ranges of this frame.
+		void EndFrame(uint64_t fenceValue);
+
+		inline const RingAllocatorStats& GetStats() const { return m_Stats; }
+		inline uint32_t GetPendingFrameCount() const { return m_PendingCount; }
+		inline uint64_t GetCapacity() const { return m_Capacity; }
+
+	private:
+		struct PendingFrame
+		{
+			uint64_t FenceValue;
+			uint64_t EndOffset; //Where the head was at the end of the frame, the tail moves here once it is retired
+			uint64_t Size;      //Everything that this frame consumed, including padding
+		};
+
+		uint64_t m_Capacity;
+
+		//Allocations happen at the head, ranges are released at the tail
+		uint64_t m_Head = 0;
+		uint64_t m_Tail = 0;
+
+		PendingFrame m_PendingFrames[s_MaxPendingFrames];
+		uint32_t m_PendingFirst = 0;
+		uint32_t m_PendingCount = 0;
+
+		RingAllocatorStats m_Stats;
+	};
+}
@@ -0,0 +1,323 @@
+#include "shaderCache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <util/simpleAssert.h>
+#include <util/fileUtils.h>
+
+namespace HT
+{
+	ShaderDiskCache::ShaderDiskCache(const std::string& directory) : m_Directory(directory)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_Directory, error);
+
+		LoadIndex();
+	}
+
+	bool ShaderDiskCache::Load(uint64_t key, ShaderBytecode& outBytecode)
+	{
+		IndexEntry entry;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			auto found = m_Index.find(key);
+			if (found == m_Index.end())
+				return false;
+
+			entry = found->second;
+		}
+
+		std::ifstream file(GetBytecodePath(key), std::ios::binary);
+		if (file)
+		{
+			outBytecode.resize((size_t)entry.Size);
+			file.read(reinterpret_cast<char*>(outBytecode.data()), (std::streamsize)entry.Size);
+
+			//Exactly the size we wrote and nothing more
+			if (file.gcount() == (std::streamsize)entry.Size && file.peek() == std::ifstream::traits_type::eof()
+				&& HTUtils::HTHash64(outBytecode.data(), outBytecode.size()) == entry.Checksum)
+				return true;
+		}
+
+		//Missing or corrupted, we forget about it and it will be compiled again
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Index.erase(key);
+		m_IndexDirty = true;
+
+		return false;
+	}
+
+	void ShaderDiskCache::Store(uint64_t key, const ShaderBytecode& bytecode)
+	{
+		if (!HTUtils::HTWriteFileAtomic(GetBytecodePath(key), bytecode.data(), bytecode.size()))
+			return;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Index[key] = { (uint64_t)bytecode.size(), HTUtils::HTHash64(bytecode.data(), bytecode.size()) };
+		m_IndexDirty = true;
+	}
+
+	bool ShaderDiskCache::SaveIndex()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (!m_IndexDirty)
+			return true;
+
+		std::stringstream stream;
+		stream << "HTShaderCache " << s_IndexVersion << "\n";
+
+		char line[64];
+		for (const auto& [key, entry] : m_Index)
+		{
+			snprintf(line, sizeof(line), "%016" PRIx64 " %" PRIu64 " %016" PRIx64 "\n", key, entry.Size, entry.Checksum);
+			stream << line;
+		}
+
+		std::string index = stream.str();
+		if (!HTUtils::HTWriteFileAtomic(m_Directory + "/index.txt", index.data(), index.size()))
+			return false;
+
+		m_IndexDirty = false;
+		return true;
+	}
+
+	size_t ShaderDiskCache::GetEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Index.size();
+	}
+
+	void ShaderDiskCache::LoadIndex()
+	{
+		std::ifstream file(m_Directory + "/index.txt");
+		if (!file)
+			return;
+
+		std::string magic;
+		uint32_t version = 0;
+		file >> magic >> version;
+
+		//An index of another version is ignored, everything will be compiled and stored again
+		if (magic != "HTShaderCache" || version != s_IndexVersion)
+			return;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			uint64_t key, size, checksum;
+			if (sscanf(line.c_str(), "%" SCNx64 " %" SCNu64 " %" SCNx64, &key, &size, &checksum) == 3)
+				m_Index[key] = { size, checksum };
+		}
+	}
+
+	std::string ShaderDiskCache::GetBytecodePath(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/%016" PRIx64 ".cso", key);
+
+		return m_Directory + name;
+	}
+
+	ShaderCompilationService::ShaderCompilationService(IShaderCompiler* compiler, IShaderSourceProvider* sources, ShaderDiskCache* diskCache, JobSystem* jobSystem)
+		: m_Compiler(compiler), m_Sources(sources), m_DiskCache(diskCache), m_JobSystem(jobSystem)
+	{
+		D3D_ASSERT(compiler && sources, "The shader compilation service needs a compiler and a source provider!");
+	}
+
+	uint64_t ShaderCompilationService::ComputeKey(const ShaderDesc& desc, std::string* outSource)
+	{
+		std::string source;
+		if (!m_Sources->Read(desc.Path, source))
+			return 0;
+
+		HTUtils::HTHasher hasher;
+		hasher.Add(m_Compiler->GetVersionHash());
+		hasher.Add(desc.EntryPoint);
+		hasher.Add(desc.Target);
+		hasher.Add(desc.Debug);
+
+		hasher.Add<uint64_t>(desc.Defines.size());
+		for (const ShaderDefine& define : desc.Defines)
+			hasher.Add(define.Name).Add(define.Value);
+
+		//The path is not part of the key, the same content compiles to the same bytecode. The includes are found relative to it, 
+		//but we hash what they resolve to (their content).
+		hasher.Add(source);
+
+		std::vector<std::string> visited;
+		visited.push_back(desc.Path);
+
+		bool missing = false;
+		HashIncludes(desc.Path, source, hasher, visited, missing);
+
+		if (missing)
+			return 0;
+
+		if (outSource)
+			*outSource = std::move(source);
+
+		//0 means "no key"
+		uint64_t key = hasher.Get();
+		return key ? key : 1;
+	}
+
+	void ShaderCompilationService::HashIncludes(const std::string& path, const std::string& source, HTUtils::HTHasher& hasher, std::vector<std::string>& visited, bool& outMissing)
+	{
+		for (const std::string& include : FindShaderIncludes(source))
+		{
+			std::string includePath = ResolveShaderInclude(path, include);
+			hasher.Add(include);
+
+			//An include that was already hashed (include guards, #pragma once) doesn't change anything the second time
+			if (std::find(visited.begin(), visited.end(), includePath) != visited.end())
+				continue;
+
+			visited.push_back(includePath);
+
+			std::string includeSource;
+			if (!m_Sources->Read(includePath, includeSource))
+			{
+				outMissing = true;
+				return;
+			}
+
+			hasher.Add(includeSource);
+			HashIncludes(includePath, includeSource, hasher, visited, outMissing);
+
+			if (outMissing)
+				return;
+		}
+	}
+
+	std::vector<ShaderCompileResult> ShaderCompilationService::CompileBatch(const std::vector<ShaderDesc>& descs)
+	{
+		std::vector<ShaderCompileResult> results(descs.size());
+
+		//A unique key of the batch that is not in memory, with the first request that asked for it
+		struct Miss
+		{
+			uint64_t Key;
+			uint32_t DescIndex;
+			std::string Source;
+			ShaderCompileResult Result;
+		};
+
+		std::vector<Miss> misses;
+		std::unordered_map<uint64_t, uint32_t> missIndices;
+
+		for (uint32_t i = 0; i < (uint32_t)descs.size(); i++)
+		{
+			std::string source;
+			uint64_t key = ComputeKey(descs[i], &source);
+			results[i].Key = key;
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats.Requests++;
+
+			if (key == 0)
+			{
+				results[i].Errors = "Failed to read " + descs[i].Path + " or one of its includes";
+				m_Stats.Failed++;
+				continue;
+			}
+
+			auto cached = m_MemoryCache.find(key);
+			if (cached != m_MemoryCache.end())
+			{
+				results[i].Bytecode = cached->second;
+				results[i].FromCache = true;
+				m_Stats.MemoryHits++;
+				continue;
+			}
+
+			if (missIndices.count(key))
+			{
+				m_Stats.Deduplicated++;
+				continue;
+			}
+
+			missIndices[key] = (uint32_t)misses.size();
+			misses.push_back({ key, i, std::move(source), {} });
+		}
+
+		//The disk reads and the compilations of the misses, in parallel. Each miss only touches its own result.
+		auto ResolveMisses = [this, &misses, &descs](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				Miss& miss = misses[i];
+				miss.Result.Key = miss.Key;
+
+				ShaderBytecode bytecode;
+				if (m_DiskCache && m_DiskCache->Load(miss.Key, bytecode))
+				{
+					miss.Result.Bytecode = std::make_shared<const ShaderBytecode>(std::move(bytecode));
+					miss.Result.FromCache = true;
+					continue;
+				}
+
+				if (m_Compiler->Compile(descs[miss.DescIndex], miss.Source, *m_Sources, bytecode, miss.Result.Errors))
+				{
+					if (m_DiskCache)
+						m_DiskCache->Store(miss.Key, bytecode);
+
+					miss.Result.Bytecode = std::make_shared<const ShaderBytecode>(std::move(bytecode));
+				}
+			}
+		};
+
+		if (m_JobSystem)
+			m_JobSystem->ParallelFor((uint32_t)misses.size(), 1, ResolveMisses);
+		else
+			ResolveMisses(0, (uint32_t)misses.size());
+
+		if (m_DiskCache && !misses.empty())
+			m_DiskCache->SaveIndex();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			for (const Miss& miss : misses)
+			{
+				if (!miss.Result.IsValid())
+					m_Stats.Failed++;
+				else if (miss.Result.FromCache)
+					m_Stats.DiskHits++;
+				else
+					m_Stats.Compiled++;
+
+				//Failures are not cached, the source may be fixed while we run
+				if (miss.Result.IsValid())
+					m_MemoryCache[miss.Key] = miss.Result.Bytecode;
+			}
+		}
+
+		//Every request gets the result of the miss with its key (the duplicated ones included)
+		for (uint32_t i = 0; i < (uint32_t)descs.size(); i++)
+		{
+			auto miss = missIndices.find(results[i].Key);
+			if (results[i].Key != 0 && !results[i].IsValid() && miss != missIndices.end())
+				results[i] = misses[miss->second].Result;
+		}
+
+		return results;
+	}
+
+	ShaderCompileResult ShaderCompilationService::Compile(const ShaderDesc& desc)
+	{
+		return CompileBatch({ desc })[0];
+	}
+
+	ShaderCacheStats ShaderCompilationService::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+}
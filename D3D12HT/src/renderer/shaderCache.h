@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <renderer/shaderCompiler.h>
+#include <util/hash.h>
+
+namespace HT
+{
+	//The compiled shaders on disk. A shader is addressed by its content key (see ShaderCompilationService::ComputeKey), so if the source,
+	//an include, a define, the target or the compiler changes, the key changes and the old entry is just never asked again.
+	//
+	//Every bytecode is its own file (<key>.cso) and the index keeps the size and checksum of each one, so a truncated or corrupted file is a miss instead of a crash.
+	//All files are written atomically (HTUtils::HTWriteFileAtomic), so a crash in the middle of a write never leaves a half written file behind.
+	class ShaderDiskCache
+	{
+	public:
+		explicit ShaderDiskCache(const std::string& directory);
+
+		ShaderDiskCache(const ShaderDiskCache&) = delete;
+		ShaderDiskCache& operator=(const ShaderDiskCache&) = delete;
+
+		//Thread safe
+		bool Load(uint64_t key, ShaderBytecode& outBytecode);
+		void Store(uint64_t key, const ShaderBytecode& bytecode);
+
+		//Writes the index, if something changed
+		bool SaveIndex();
+
+		size_t GetEntryCount() const;
+		inline const std::string& GetDirectory() const { return m_Directory; }
+
+	private:
+		struct IndexEntry
+		{
+			uint64_t Size;
+			uint64_t Checksum;
+		};
+
+		void LoadIndex();
+		std::string GetBytecodePath(uint64_t key) const;
+
+	private:
+		static const uint32_t s_IndexVersion = 1;
+
+		std::string m_Directory;
+
+		mutable std::mutex m_Mutex;
+		std::unordered_map<uint64_t, IndexEntry> m_Index;
+		bool m_IndexDirty = false;
+	};
+
+	struct ShaderCompileResult
+	{
+		uint64_t Key = 0;
+		std::shared_ptr<const ShaderBytecode> Bytecode;
+		std::string Errors;
+
+		//Found in memory or on disk, the compiler was not called
+		bool FromCache = false;
+
+		inline bool IsValid() const { return Bytecode != nullptr; }
+	};
+
+	struct ShaderCacheStats
+	{
+		uint64_t Requests     = 0;
+		uint64_t MemoryHits   = 0;
+		uint64_t DiskHits     = 0;
+		uint64_t Compiled     = 0;
+		uint64_t Failed       = 0;
+
+		//Requests of the same batch with the same key, compiled (or loaded) only once
+		uint64_t Deduplicated = 0;
+	};
+
+	//Compiling all the shaders at every startup is slow, so we only compile what is not in the cache:
+	//1- The key of every shader is computed (source, includes, defines, target, entry point and compiler version).
+	//2- The keys are looked up in memory and then on disk.
+	//3- The misses are compiled in parallel on the job system and stored on disk for the next run.
+	//So a warm start doesn't compile anything.
+	//
+	//The compiler and the sources are interfaces, so this can run with a HT::StubShaderCompiler and the sources in memory.
+	class ShaderCompilationService
+	{
+	public:
+		//diskCache and jobSystem are optional: without a disk cache only the memory cache is used, without a job system the misses are compiled on this thread.
+		ShaderCompilationService(IShaderCompiler* compiler, IShaderSourceProvider* sources, ShaderDiskCache* diskCache = nullptr, JobSystem* jobSystem = nullptr);
+
+		//0 if the source (or one of its includes) can't be read. The source is returned, so it doesn't need to be read again to compile.
+		uint64_t ComputeKey(const ShaderDesc& desc, std::string* outSource = nullptr);
+
+		//The results are in the same order as the descs
+		std::vector<ShaderCompileResult> CompileBatch(const std::vector<ShaderDesc>& descs);
+		ShaderCompileResult Compile(const ShaderDesc& desc);
+
+		ShaderCacheStats GetStats() const;
+
+	private:
+		void HashIncludes(const std::string& path, const std::string& source, HTUtils::HTHasher& hasher, std::vector<std::string>& visited, bool& outMissing);
+
+	private:
+		IShaderCompiler* m_Compiler;
+		IShaderSourceProvider* m_Sources;
+		ShaderDiskCache* m_DiskCache;
+		JobSystem* m_JobSystem;
+
+		mutable std::mutex m_Mutex;
+		std::unordered_map<uint64_t, std::shared_ptr<const ShaderBytecode>> m_MemoryCache;
+		ShaderCacheStats m_Stats;
+	};
+}
@@ -0,0 +1,98 @@
+#include "shaderCompiler.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace HT
+{
+	bool FileShaderSourceProvider::Read(const std::string& path, std::string& outSource)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		outSource = stream.str();
+
+		return true;
+	}
+
+	bool MemoryShaderSourceProvider::Read(const std::string& path, std::string& outSource)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto file = m_Files.find(path);
+		if (file == m_Files.end())
+			return false;
+
+		outSource = file->second;
+		return true;
+	}
+
+	void MemoryShaderSourceProvider::SetFile(const std::string& path, const std::string& source)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Files[path] = source;
+	}
+
+	bool StubShaderCompiler::Compile(const ShaderDesc& desc, const std::string& source, IShaderSourceProvider& /*sources*/, ShaderBytecode& outBytecode, std::string& outErrors)
+	{
+		m_CompileCount++;
+
+		if (source.find("#error") != std::string::npos)
+		{
+			outErrors = desc.Path + ": #error";
+			return false;
+		}
+
+		std::string output = desc.Target + ":" + desc.EntryPoint + ":";
+		for (const ShaderDefine& define : desc.Defines)
+			output += define.Name + "=" + define.Value + ";";
+
+		output += source;
+		outBytecode.assign(output.begin(), output.end());
+
+		return true;
+	}
+
+	std::vector<std::string> FindShaderIncludes(const std::string& source)
+	{
+		std::vector<std::string> includes;
+
+		size_t lineStart = 0;
+		while (lineStart < source.size())
+		{
+			size_t lineEnd = source.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = source.size();
+
+			size_t position = source.find_first_not_of(" \t", lineStart);
+			if (position < lineEnd && source.compare(position, 8, "#include") == 0)
+			{
+				size_t open = source.find_first_of("\"<", position + 8);
+				if (open < lineEnd)
+				{
+					char closeCharacter = source[open] == '"' ? '"' : '>';
+					size_t close = source.find(closeCharacter, open + 1);
+
+					if (close < lineEnd)
+						includes.push_back(source.substr(open + 1, close - open - 1));
+				}
+			}
+
+			lineStart = lineEnd + 1;
+		}
+
+		return includes;
+	}
+
+	std::string ResolveShaderInclude(const std::string& includerPath, const std::string& includePath)
+	{
+		size_t separator = includerPath.find_last_of("/\\");
+		if (separator == std::string::npos)
+			return includePath;
+
+		return includerPath.substr(0, separator + 1) + includePath;
+	}
+}
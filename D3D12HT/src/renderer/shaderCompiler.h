@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace HT
+{
+	using ShaderBytecode = std::vector<uint8_t>;
+
+	struct ShaderDefine
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	//Everything that changes the output of the compiler (besides the source and its includes)
+	struct ShaderDesc
+	{
+		std::string Path;
+		std::string EntryPoint = "main";
+
+		//e.g: "vs_5_1", "ps_5_1", "cs_5_1"
+		std::string Target;
+
+		std::vector<ShaderDefine> Defines;
+
+		bool Debug = false;
+	};
+
+	//Where the source of the shaders and their includes come from. The cache needs the content of every include to build the key, 
+	//and the compiler needs them to compile. Tests can give the files from memory (HT::MemoryShaderSourceProvider).
+	class IShaderSourceProvider
+	{
+	public:
+		virtual ~IShaderSourceProvider() = default;
+
+		virtual bool Read(const std::string& path, std::string& outSource) = 0;
+	};
+
+	class FileShaderSourceProvider : public IShaderSourceProvider
+	{
+	public:
+		bool Read(const std::string& path, std::string& outSource) override;
+	};
+
+	class MemoryShaderSourceProvider : public IShaderSourceProvider
+	{
+	public:
+		bool Read(const std::string& path, std::string& outSource) override;
+
+		void SetFile(const std::string& path, const std::string& source);
+
+	private:
+		std::mutex m_Mutex;
+		std::unordered_map<std::string, std::string> m_Files;
+	};
+
+	//Compiles a shader. The D3D one is HT::D3DShaderCompiler, the cache and the compilation service only talk with this interface.
+	//It must be thread safe, the misses are compiled in parallel.
+	class IShaderCompiler
+	{
+	public:
+		virtual ~IShaderCompiler() = default;
+
+		//Goes into the key, a new compiler (or version) must not use what an old one compiled
+		virtual uint64_t GetVersionHash() const = 0;
+
+		virtual bool Compile(const ShaderDesc& desc, const std::string& source, IShaderSourceProvider& sources, ShaderBytecode& outBytecode, std::string& outErrors) = 0;
+	};
+
+	//Doesn't compile anything, the "bytecode" is the source with the defines and target. It fails if the source has "#error".
+	//It counts how many times it was called, so we can check that a warm cache doesn't compile at all.
+	class StubShaderCompiler : public IShaderCompiler
+	{
+	public:
+		uint64_t GetVersionHash() const override { return 1; }
+
+		bool Compile(const ShaderDesc& desc, const std::string& source, IShaderSourceProvider& sources, ShaderBytecode& outBytecode, std::string& outErrors) override;
+
+		inline uint64_t GetCompileCount() const { return m_CompileCount.load(); }
+
+	private:
+		std::atomic<uint64_t> m_CompileCount = 0;
+	};
+
+	//The includes of a source, in the order they appear. Only #include "file" and #include <file> lines, no macros.
+	std::vector<std::string> FindShaderIncludes(const std::string& source);
+
+	//The path an include refers to: relative to the file that includes it. The same rule is used to build the key and to compile.
+	std::string ResolveShaderInclude(const std::string& includerPath, const std::string& includePath);
+}
@@ -0,0 +1,152 @@
+#include "simulatedQueues.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	SimulatedQueueBackend::SimulatedQueueBackend(CostFunction costFunction) : m_CostFunction(std::move(costFunction))
+	{
+		for (Queue& queue : m_Queues)
+			queue.Fence.SetWaitHandler([this](CPUFence& /*fence*/, uint64_t /*value*/) { Run(); });
+	}
+
+	void SimulatedQueueBackend::ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count)
+	{
+		Operation operation;
+		operation.Type = OperationType::Execute;
+		operation.OtherQueue = queue;
+		operation.Value = 0;
+		operation.CommandLists.assign(commandLists, commandLists + count);
+
+		m_Queues[(uint32_t)queue].Operations.push_back(std::move(operation));
+	}
+
+	uint64_t SimulatedQueueBackend::Signal(CommandQueueType queue)
+	{
+		Queue& simulatedQueue = m_Queues[(uint32_t)queue];
+
+		Operation operation;
+		operation.Type = OperationType::Signal;
+		operation.OtherQueue = queue;
+		operation.Value = simulatedQueue.Fence.Signal();
+
+		simulatedQueue.Operations.push_back(std::move(operation));
+		return simulatedQueue.Operations.back().Value;
+	}
+
+	void SimulatedQueueBackend::Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value)
+	{
+		Operation operation;
+		operation.Type = OperationType::Wait;
+		operation.OtherQueue = signalingQueue;
+		operation.Value = value;
+
+		m_Queues[(uint32_t)queue].Operations.push_back(std::move(operation));
+	}
+
+	SimulationResult SimulatedQueueBackend::Run()
+	{
+		const uint32_t queueCount = (uint32_t)CommandQueueType::Count;
+
+		while (true)
+		{
+			//The queue that is further behind in time goes first. This way, when a queue reaches a Wait, 
+			//the signal it waits for (if it happens before) was already played.
+			int32_t next = -1;
+			bool hasWork = false;
+
+			for (uint32_t i = 0; i < queueCount; i++)
+			{
+				const Queue& queue = m_Queues[i];
+				if (queue.NextOperation >= queue.Operations.size())
+					continue;
+
+				hasWork = true;
+
+				if (IsBlocked(queue))
+					continue;
+
+				if (next < 0 || queue.Time < m_Queues[next].Time)
+					next = (int32_t)i;
+			}
+
+			if (!hasWork)
+				break;
+
+			//Every queue with work is waiting for a signal that will never come
+			if (next < 0)
+			{
+				m_Result.Deadlocked = true;
+				break;
+			}
+
+			Queue& queue = m_Queues[next];
+			const Operation& operation = queue.Operations[queue.NextOperation++];
+
+			switch (operation.Type)
+			{
+			case OperationType::Execute:
+				for (void* commandList : operation.CommandLists)
+				{
+					uint64_t cost = m_CostFunction ? m_CostFunction((CommandQueueType)next, commandList) : 1;
+
+					m_Executions.push_back({ (CommandQueueType)next, commandList, queue.Time, queue.Time + cost });
+					queue.Time += cost;
+					m_Result.BusyTime[next] += cost;
+				}
+				break;
+
+			case OperationType::Signal:
+				queue.SignalTimes.push_back({ operation.Value, queue.Time });
+				queue.Fence.Complete(operation.Value);
+				break;
+
+			case OperationType::Wait:
+			{
+				uint64_t signalTime = GetSignalTime(m_Queues[(uint32_t)operation.OtherQueue], operation.Value);
+				if (signalTime > queue.Time)
+				{
+					m_Result.WaitTime[next] += signalTime - queue.Time;
+					queue.Time = signalTime;
+				}
+				break;
+			}
+			}
+
+			m_Result.TotalTime = HTUtils::HTMax(m_Result.TotalTime, queue.Time);
+		}
+
+		return m_Result;
+	}
+
+	const SimulatedExecution* SimulatedQueueBackend::FindExecution(void* commandList) const
+	{
+		for (const SimulatedExecution& execution : m_Executions)
+		{
+			if (execution.CommandList == commandList)
+				return &execution;
+		}
+
+		return nullptr;
+	}
+
+	bool SimulatedQueueBackend::IsBlocked(const Queue& queue) const
+	{
+		const Operation& operation = queue.Operations[queue.NextOperation];
+		return operation.Type == OperationType::Wait && !m_Queues[(uint32_t)operation.OtherQueue].Fence.IsComplete(operation.Value);
+	}
+
+	uint64_t SimulatedQueueBackend::GetSignalTime(const Queue& queue, uint64_t value) const
+	{
+		//The first signal that reached the value
+		for (const SignalTime& signal : queue.SignalTimes)
+		{
+			if (signal.Value >= value)
+				return signal.Time;
+		}
+
+		D3D_ASSERT(false, "Waiting for a value that was never reached!");
+		return 0;
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/queueScheduler.h>
+
+namespace HT
+{
+	struct SimulatedExecution
+	{
+		CommandQueueType Queue;
+		void* CommandList;
+		uint64_t Start;
+		uint64_t End;
+	};
+
+	struct SimulationResult
+	{
+		bool Deadlocked = false;
+
+		//When the last queue finished
+		uint64_t TotalTime = 0;
+
+		uint64_t BusyTime[(uint32_t)CommandQueueType::Count] = {};
+
+		//Time a queue was idle because of a Wait
+		uint64_t WaitTime[(uint32_t)CommandQueueType::Count] = {};
+	};
+
+	//A CPU model of the queues. The commands are not executed when they are submitted, they are recorded in a stream per queue (like a real queue)
+	//and Run() plays them: every queue executes its stream in order, a list takes the time the cost function says and a Wait holds the queue until 
+	//the other queue reaches the signal. The fences are CPUFences, completed as the simulated queues reach the signals.
+	//
+	//With it we can check what the scheduler generates (did a list start after the lists it depends on? do the queues overlap? does it deadlock?) without a GPU.
+	//A CPU wait on one of the fences runs the simulation, so the scheduler can also be driven from a single thread.
+	class SimulatedQueueBackend : public ICommandQueueBackend
+	{
+	public:
+		//The time units are arbitrary. Without a cost function every list costs 1.
+		using CostFunction = std::function<uint64_t(CommandQueueType queue, void* commandList)>;
+
+		explicit SimulatedQueueBackend(CostFunction costFunction = nullptr);
+
+		SimulatedQueueBackend(const SimulatedQueueBackend&) = delete;
+		SimulatedQueueBackend& operator=(const SimulatedQueueBackend&) = delete;
+
+		void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) override;
+		uint64_t Signal(CommandQueueType queue) override;
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) override;
+		IFence* GetFence(CommandQueueType queue) override { return &m_Queues[(uint32_t)queue].Fence; }
+
+		//Plays everything recorded since the last Run
+		SimulationResult Run();
+
+		inline const std::vector<SimulatedExecution>& GetExecutions() const { return m_Executions; }
+
+		//The first execution of a list, nullptr if it was not executed
+		const SimulatedExecution* FindExecution(void* commandList) const;
+
+	private:
+		enum class OperationType : uint8_t
+		{
+			Execute,
+			Signal,
+			Wait
+		};
+
+		struct Operation
+		{
+			OperationType Type;
+			CommandQueueType OtherQueue;
+			uint64_t Value;
+			std::vector<void*> CommandLists;
+		};
+
+		struct SignalTime
+		{
+			uint64_t Value;
+			uint64_t Time;
+		};
+
+		struct Queue
+		{
+			CPUFence Fence;
+			std::vector<Operation> Operations;
+			size_t NextOperation = 0;
+			uint64_t Time = 0;
+
+			//In the order they were reached, so the values only go up
+			std::vector<SignalTime> SignalTimes;
+		};
+
+		bool IsBlocked(const Queue& queue) const;
+		uint64_t GetSignalTime(const Queue& queue, uint64_t value) const;
+
+	private:
+		CostFunction m_CostFunction;
+		Queue m_Queues[(uint32_t)CommandQueueType::Count];
+
+		std::vector<SimulatedExecution> m_Executions;
+		SimulationResult m_Result;
+	};
+}
@@ -0,0 +1,380 @@
+#include "textureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	uint64_t ComputeUploadFootprints(const DDSTexture& texture, uint32_t firstMip, uint32_t lastMip, TextureUploadFootprint* outFootprints)
+	{
+		uint64_t offset = 0;
+		uint32_t index = 0;
+
+		for (uint32_t slice = 0; slice < texture.ArraySize; slice++)
+		{
+			for (uint32_t mip = firstMip; mip <= lastMip; mip++)
+			{
+				DDSSubresource subresource = texture.GetSubresource(mip, slice);
+				uint32_t rowPitch = HTUtils::HTAlignUp(subresource.RowBytes, g_TextureUploadPitchAlignment);
+
+				offset = HTUtils::HTAlignUp(offset, g_TextureUploadPlacementAlignment);
+
+				if (outFootprints)
+				{
+					TextureUploadFootprint& footprint = outFootprints[index++];
+					footprint.Mip = mip;
+					footprint.Slice = slice;
+					footprint.Offset = offset;
+					footprint.CPU = nullptr;
+					footprint.Width = subresource.Width;
+					footprint.Height = subresource.Height;
+					footprint.RowPitch = rowPitch;
+					footprint.RowBytes = subresource.RowBytes;
+					footprint.RowCount = subresource.RowCount;
+				}
+
+				//The last row doesn't need its padding
+				offset += (uint64_t)rowPitch * (subresource.RowCount - 1) + subresource.RowBytes;
+			}
+		}
+
+		return offset;
+	}
+
+	void CPUTextureUploadSink::CreateTexture(TextureHandle texture, const DDSTexture& desc)
+	{
+		Texture& cpuTexture = m_Textures[texture];
+		cpuTexture.Desc = desc;
+		cpuTexture.Texels.assign((size_t)desc.TexelDataSize, 0);
+	}
+
+	void CPUTextureUploadSink::CopySubresource(TextureHandle texture, const TextureUploadFootprint& footprint)
+	{
+		Texture& cpuTexture = m_Textures.at(texture);
+		uint8_t* destination = cpuTexture.Texels.data() + cpuTexture.Desc.GetSubresource(footprint.Mip, footprint.Slice).Offset;
+
+		for (uint32_t row = 0; row < footprint.RowCount; row++)
+			memcpy(destination + (uint64_t)row * footprint.RowBytes, footprint.CPU + (uint64_t)row * footprint.RowPitch, footprint.RowBytes);
+
+		m_CopyCount++;
+		m_CopiedBytes += (uint64_t)footprint.RowBytes * footprint.RowCount;
+	}
+
+	bool CPUTextureUploadSink::Verify(TextureHandle texture, const DDSTexture& file, uint32_t firstMip) const
+	{
+		auto it = m_Textures.find(texture);
+		if (it == m_Textures.end())
+			return false;
+
+		for (uint32_t slice = 0; slice < file.ArraySize; slice++)
+		{
+			for (uint32_t mip = firstMip; mip < file.MipCount; mip++)
+			{
+				DDSSubresource subresource = file.GetSubresource(mip, slice);
+				if (memcmp(it->second.Texels.data() + subresource.Offset, file.TexelData + subresource.Offset, (size_t)subresource.GetSize()) != 0)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	TextureStreamer::TextureStreamer(ITextureUploadSink* sink, const UploadMemory& uploadMemory, const TextureStreamerConfig& config)
+		: m_Sink(sink), m_UploadMemory(uploadMemory), m_Config(config), m_UploadAllocator(uploadMemory.Size, g_TextureUploadPlacementAlignment)
+	{
+		D3D_ASSERT(sink, "The texture streamer needs a sink!");
+		D3D_ASSERT(uploadMemory.CPUBase, "The texture streamer needs upload memory!");
+
+		m_IOThread = std::thread([this]() { IOThreadMain(); });
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+
+		m_RequestCondition.notify_one();
+		m_IOThread.join();
+	}
+
+	TextureHandle TextureStreamer::RegisterTexture(const std::string& path, std::string& outError)
+	{
+		Texture texture;
+
+		if (!texture.File.Open(path))
+		{
+			outError = "Can't map " + path;
+			return g_InvalidTexture;
+		}
+
+		if (!ParseDDS(texture.File.GetData(), texture.File.GetSize(), texture.Desc, outError))
+		{
+			outError = path + ": " + outError;
+			return g_InvalidTexture;
+		}
+
+		//The tail: every mip from the first one that fits in TailMipSize (or the last mip, if none fits)
+		const DDSTexture& desc = texture.Desc;
+		texture.TailMip = desc.MipCount - 1;
+		for (uint32_t mip = 0; mip < desc.MipCount; mip++)
+		{
+			if (HTUtils::HTMax(desc.Width >> mip, desc.Height >> mip) <= m_Config.TailMipSize)
+			{
+				texture.TailMip = mip;
+				break;
+			}
+		}
+
+		//Nothing is resident yet, and until we know its size on screen it only wants the tail
+		texture.ResidentMip = desc.MipCount;
+		texture.WantedMip = texture.TailMip;
+
+		TextureHandle handle = (TextureHandle)m_Textures.size();
+		m_Textures.push_back(std::move(texture));
+		m_Sink->CreateTexture(handle, m_Textures.back().Desc);
+
+		m_Stats.TextureCount++;
+		return handle;
+	}
+
+	void TextureStreamer::SetScreenSize(TextureHandle texture, float pixels)
+	{
+		Texture& streamed = m_Textures[texture];
+		streamed.ScreenPixels = pixels;
+
+		if (pixels < 1.0f)
+		{
+			streamed.WantedMip = streamed.TailMip;
+			return;
+		}
+
+		//Every mip halves the size: the wanted mip is the log2 of how many texels we have for each pixel
+		float texelsPerPixel = (float)HTUtils::HTMax(streamed.Desc.Width, streamed.Desc.Height) / pixels;
+		uint32_t mip = texelsPerPixel >= 2.0f ? HTUtils::HTHighestBit((uint64_t)texelsPerPixel) : 0;
+
+		streamed.WantedMip = HTUtils::HTMin(mip, streamed.TailMip);
+	}
+
+	float TextureStreamer::GetPriority(const Texture& texture) const
+	{
+		//Nothing to show at all goes before everything else
+		if (texture.ResidentMip == texture.Desc.MipCount)
+			return 1e30f;
+
+		//How magnified the mip we have is on screen
+		uint32_t residentSize = HTUtils::HTMax(HTUtils::HTMax(texture.Desc.Width, texture.Desc.Height) >> texture.ResidentMip, 1u);
+		return texture.ScreenPixels / (float)residentSize;
+	}
+
+	void TextureStreamer::BeginFrame(uint64_t completedFenceValue)
+	{
+		while (!m_PendingFrees.empty() && m_PendingFrees.front().FenceValue <= completedFenceValue)
+		{
+			m_UploadAllocator.Free(m_PendingFrees.front().Range);
+			m_PendingFrees.pop_front();
+		}
+	}
+
+	void TextureStreamer::Update()
+	{
+		m_Done.clear();
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Done.swap(m_Completed);
+			m_Stats.ReadNs = m_ReadNs;
+			m_Stats.BytesRead = m_BytesRead;
+		}
+
+		//The reads that are done are copied by this frame, their upload memory is free once it is done
+		for (ReadRequest& request : m_Done)
+		{
+			uint32_t footprintCount = (request.LastMip - request.FirstMip + 1) * request.Desc.ArraySize;
+			m_Footprints.resize(footprintCount);
+			ComputeUploadFootprints(request.Desc, request.FirstMip, request.LastMip, m_Footprints.data());
+
+			for (TextureUploadFootprint& footprint : m_Footprints)
+			{
+				footprint.Offset += request.Range.Offset;
+				footprint.CPU = m_UploadMemory.CPUBase + footprint.Offset;
+				m_Sink->CopySubresource(request.Texture, footprint);
+			}
+
+			Texture& texture = m_Textures[request.Texture];
+			texture.ResidentMip = request.FirstMip;
+			texture.InFlight = false;
+
+			m_FrameFrees.push_back(request.Range);
+			m_Stats.BytesUploaded += request.Bytes;
+		}
+
+		//Every texture that wants more, the most magnified first. Only one read per texture at a time, so the mips always arrive in order.
+		m_Candidates.clear();
+		for (TextureHandle handle = 0; handle < (TextureHandle)m_Textures.size(); handle++)
+		{
+			const Texture& texture = m_Textures[handle];
+			if (!texture.InFlight && texture.ResidentMip > texture.WantedMip)
+				m_Candidates.push_back(handle);
+		}
+
+		std::sort(m_Candidates.begin(), m_Candidates.end(), [this](TextureHandle a, TextureHandle b)
+		{
+			return GetPriority(m_Textures[a]) > GetPriority(m_Textures[b]);
+		});
+
+		m_Batch.clear();
+		uint64_t frameBytes = 0;
+		bool uploadMemoryFull = false;
+
+		for (TextureHandle handle : m_Candidates)
+		{
+			Texture& texture = m_Textures[handle];
+
+			//The whole tail first, then one mip at a time
+			uint32_t firstMip = texture.ResidentMip == texture.Desc.MipCount ? texture.TailMip : texture.ResidentMip - 1;
+			uint32_t lastMip = texture.ResidentMip == texture.Desc.MipCount ? texture.Desc.MipCount - 1 : firstMip;
+			uint64_t bytes = ComputeUploadFootprints(texture.Desc, firstMip, lastMip, nullptr);
+
+			//The first read always goes, even if it is bigger than the budget. Smaller ones may still fit after one that doesn't.
+			if (frameBytes > 0 && frameBytes + bytes > m_Config.FrameByteBudget)
+				continue;
+
+			//A smaller read may still fit. A mip bigger than the whole upload memory never loads.
+			TLSFAllocation range = m_UploadAllocator.Allocate(bytes, g_TextureUploadPlacementAlignment);
+			if (!range.IsValid())
+			{
+				uploadMemoryFull = true;
+				continue;
+			}
+
+			m_Batch.push_back({ handle, texture.Desc, firstMip, lastMip, GetPriority(texture), range, bytes });
+			texture.InFlight = true;
+			frameBytes += bytes;
+		}
+
+		if (!m_Batch.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Requests.insert(m_Requests.end(), m_Batch.begin(), m_Batch.end());
+			}
+
+			m_RequestCondition.notify_one();
+		}
+
+		m_Stats.Requests += m_Batch.size();
+		m_Stats.UploadMemoryFullFrames += uploadMemoryFull ? 1 : 0;
+		m_Stats.PeakFrameBytes = HTUtils::HTMax(m_Stats.PeakFrameBytes, frameBytes);
+
+		m_Stats.PendingRequests = 0;
+		m_Stats.FullyStreamedCount = 0;
+		for (const Texture& texture : m_Textures)
+		{
+			m_Stats.PendingRequests += texture.InFlight ? 1 : 0;
+			m_Stats.FullyStreamedCount += texture.ResidentMip <= texture.WantedMip ? 1 : 0;
+		}
+	}
+
+	void TextureStreamer::EndFrame(uint64_t fenceValue)
+	{
+		for (const TLSFAllocation& range : m_FrameFrees)
+			m_PendingFrees.push_back({ range, fenceValue });
+
+		m_FrameFrees.clear();
+	}
+
+	void TextureStreamer::WaitForReads()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_IdleCondition.wait(lock, [this]() { return m_Requests.empty() && m_ReadsInProgress == 0; });
+	}
+
+	uint32_t TextureStreamer::GetResidentMip(TextureHandle texture) const
+	{
+		return m_Textures[texture].ResidentMip;
+	}
+
+	uint32_t TextureStreamer::GetWantedMip(TextureHandle texture) const
+	{
+		return m_Textures[texture].WantedMip;
+	}
+
+	const DDSTexture& TextureStreamer::GetTexture(TextureHandle texture) const
+	{
+		return m_Textures[texture].Desc;
+	}
+
+	void TextureStreamer::IOThreadMain()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		for (;;)
+		{
+			m_RequestCondition.wait(lock, [this]() { return m_Stop || !m_Requests.empty(); });
+
+			//The requests left are dropped, their upload memory goes away with us
+			if (m_Stop)
+				return;
+
+			//The most important read first. The list is short (one read per texture at most), a walk is enough.
+			size_t best = 0;
+			for (size_t i = 1; i < m_Requests.size(); i++)
+			{
+				if (m_Requests[i].Priority > m_Requests[best].Priority)
+					best = i;
+			}
+
+			ReadRequest request = m_Requests[best];
+			m_Requests[best] = m_Requests.back();
+			m_Requests.pop_back();
+			m_ReadsInProgress++;
+
+			lock.unlock();
+
+			uint64_t begin = HTUtils::HTNowNanoseconds();
+			Read(request);
+			uint64_t elapsed = HTUtils::HTNowNanoseconds() - begin;
+
+			lock.lock();
+
+			m_Completed.push_back(request);
+			m_ReadsInProgress--;
+			m_ReadNs += elapsed;
+			m_BytesRead += request.Bytes;
+
+			if (m_Requests.empty() && m_ReadsInProgress == 0)
+				m_IdleCondition.notify_all();
+		}
+	}
+
+	void TextureStreamer::Read(const ReadRequest& request)
+	{
+		//The I/O thread has its own footprints, the ones of the streamer belong to the thread of Update
+		uint32_t footprintCount = (request.LastMip - request.FirstMip + 1) * request.Desc.ArraySize;
+		m_IOFootprints.resize(footprintCount);
+		ComputeUploadFootprints(request.Desc, request.FirstMip, request.LastMip, m_IOFootprints.data());
+
+		uint8_t* upload = m_UploadMemory.CPUBase + request.Range.Offset;
+
+		for (const TextureUploadFootprint& footprint : m_IOFootprints)
+		{
+			const uint8_t* source = request.Desc.GetSubresourceData(footprint.Mip, footprint.Slice);
+			uint8_t* destination = upload + footprint.Offset;
+
+			//Straight from the mapped file to the upload memory. Touching the file is what reads it from disk.
+			if (footprint.RowPitch == footprint.RowBytes)
+			{
+				memcpy(destination, source, (size_t)footprint.RowBytes * footprint.RowCount);
+				continue;
+			}
+
+			for (uint32_t row = 0; row < footprint.RowCount; row++)
+				memcpy(destination + (uint64_t)row * footprint.RowPitch, source + (uint64_t)row * footprint.RowBytes, footprint.RowBytes);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <core/mappedFile.h>
+#include <renderer/ddsTexture.h>
+#include <renderer/tlsfAllocator.h>
+#include <renderer/uploadRing.h>
+
+namespace HT
+{
+	using TextureHandle = uint32_t;
+	const TextureHandle g_InvalidTexture = ~0u;
+
+	//Where a subresource was written in the upload memory. The rows follow the rules of D3D12 for copies from a buffer
+	//(D3D12_PLACED_SUBRESOURCE_FOOTPRINT): the offset is 512 bytes aligned and the row pitch 256 bytes aligned.
+	struct TextureUploadFootprint
+	{
+		uint32_t Mip   = 0;
+		uint32_t Slice = 0;
+
+		uint64_t Offset = 0;     //In the upload memory
+		const uint8_t* CPU = nullptr;
+
+		uint32_t Width    = 0;
+		uint32_t Height   = 0;
+		uint32_t RowPitch = 0;
+		uint32_t RowBytes = 0;   //Of the rows of blocks in the file
+		uint32_t RowCount = 0;
+	};
+
+	//D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	const uint64_t g_TextureUploadPlacementAlignment = 512;
+	const uint32_t g_TextureUploadPitchAlignment = 256;
+
+	//Lays out mips [firstMip, lastMip] of every slice in upload memory, from outFootprints[0] at offset 0. outFootprints can be null (only the size).
+	//Returns the bytes needed.
+	uint64_t ComputeUploadFootprints(const DDSTexture& texture, uint32_t firstMip, uint32_t lastMip, TextureUploadFootprint* outFootprints);
+
+	//What the streamer needs from the renderer: to create the texture and to copy the subresources from the upload memory into it.
+	//On D3D12 this is CopyTextureRegion recorded in the list of the frame (see HT::D3D12TextureUploadSink). The streamer calls it from the thread
+	//that calls TextureStreamer::Update.
+	class ITextureUploadSink
+	{
+	public:
+		virtual ~ITextureUploadSink() = default;
+
+		virtual void CreateTexture(TextureHandle texture, const DDSTexture& desc) = 0;
+		virtual void CopySubresource(TextureHandle texture, const TextureUploadFootprint& footprint) = 0;
+	};
+
+	//The upload done by the CPU: the subresources are copied (without the row padding) into memory of ours. We can then check them against the file.
+	class CPUTextureUploadSink : public ITextureUploadSink
+	{
+	public:
+		void CreateTexture(TextureHandle texture, const DDSTexture& desc) override;
+		void CopySubresource(TextureHandle texture, const TextureUploadFootprint& footprint) override;
+
+		//True if every mip from firstMip down, of every slice, has the same bytes as the file
+		bool Verify(TextureHandle texture, const DDSTexture& file, uint32_t firstMip) const;
+
+		inline uint64_t GetCopyCount() const { return m_CopyCount; }
+		inline uint64_t GetCopiedBytes() const { return m_CopiedBytes; }
+
+	private:
+		struct Texture
+		{
+			DDSTexture Desc;
+			std::vector<uint8_t> Texels; //Same layout as the file
+		};
+
+		std::unordered_map<TextureHandle, Texture> m_Textures;
+		uint64_t m_CopyCount = 0;
+		uint64_t m_CopiedBytes = 0;
+	};
+
+	struct TextureStreamerConfig
+	{
+		//How many bytes of mips are sent to the I/O thread each frame. They are copied to the GPU by the frames that find them ready, so this also
+		//bounds the copies of a frame (a single mip bigger than this still goes, alone).
+		uint64_t FrameByteBudget = 8ull << 20;
+
+		//Mips up to this size are small enough to be loaded together, as the first request of every texture. Then every texture has something to show.
+		uint32_t TailMipSize = 64;
+	};
+
+	struct TextureStreamerStats
+	{
+		uint32_t TextureCount = 0;
+		uint32_t FullyStreamedCount = 0; //At the mip they want
+		uint32_t PendingRequests = 0;    //Sent to the I/O thread and not uploaded yet
+
+		uint64_t Requests = 0;
+		uint64_t BytesRead = 0;
+		uint64_t BytesUploaded = 0;
+		uint64_t ReadNs = 0;             //Time of the I/O thread copying from the files to the upload memory (page faults included)
+		uint64_t PeakFrameBytes = 0;
+		uint64_t UploadMemoryFullFrames = 0; //Frames where a read didn't fit in the upload memory
+	};
+
+	//Streams the mips of DDS textures from disk into upload memory, in the order that matters most on screen.
+	//
+	//The files are memory mapped and only their header is parsed when registered (HT::ParseDDS, no copy). Every frame:
+	//- SetScreenSize tells how big each texture is on screen (in pixels, along its biggest side). That gives the mip it wants: the first mip
+	//  not bigger than that, there is no point in loading texels smaller than a pixel.
+	//- Update hands the reads finished by the I/O thread to the sink (they are copied by this frame) and sends new reads: for every texture missing mips,
+	//  the next mip up, ordered by how magnified its current mip is on screen (screen size / resident size), until the byte budget of the frame.
+	//- The I/O thread takes the reads by priority and copies the rows straight from the mapped file into the upload memory, with the D3D12 row pitch.
+	//  The page faults of the file happen in the I/O thread, never in the render thread, and there is no buffer in the middle.
+	//
+	//The upload memory is shared by reads in flight, so it is split with a HT::TLSFAllocator (a read can take frames and they finish out of order).
+	//A range is given back in the BeginFrame where the fence value of the frame that copied it is completed.
+	//Mips are only added: a texture never goes back to a smaller mip (that would be the job of the residency side).
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(ITextureUploadSink* sink, const UploadMemory& uploadMemory, const TextureStreamerConfig& config = {});
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		//Maps the file and parses its header. g_InvalidTexture (and the reason in outError) if it can't be loaded. The texture is created in the sink right away.
+		TextureHandle RegisterTexture(const std::string& path, std::string& outError);
+
+		//0 pixels = not visible, it only wants the tail
+		void SetScreenSize(TextureHandle texture, float pixels);
+
+		void BeginFrame(uint64_t completedFenceValue);
+
+		void Update();
+
+		//After the frame was submitted, fenceValue is what HT::FrameRing::EndFrame returned. The upload memory of the copies of this frame
+		//waits for it, a value guessed before the submit could be reached by someone else's signal while the copies are still running.
+		void EndFrame(uint64_t fenceValue);
+
+		//Blocks until the I/O thread has no reads left (the results are handed to the sink in the next Update)
+		void WaitForReads();
+
+		//The biggest mip (smallest index) the sink has, or the mip count if it has none yet
+		uint32_t GetResidentMip(TextureHandle texture) const;
+		uint32_t GetWantedMip(TextureHandle texture) const;
+		const DDSTexture& GetTexture(TextureHandle texture) const;
+
+		inline const TextureStreamerStats& GetStats() const { return m_Stats; }
+
+	private:
+		struct Texture
+		{
+			MappedFile File;
+			DDSTexture Desc;
+
+			uint32_t ResidentMip = 0;
+			uint32_t WantedMip = 0;
+			uint32_t TailMip = 0;   //The first mip of the tail
+			float ScreenPixels = 0.0f;
+			bool InFlight = false;
+		};
+
+		struct ReadRequest
+		{
+			TextureHandle Texture;
+			DDSTexture Desc;
+			uint32_t FirstMip;
+			uint32_t LastMip;
+			float Priority;
+			TLSFAllocation Range;
+			uint64_t Bytes;
+		};
+
+		struct PendingFree
+		{
+			TLSFAllocation Range;
+			uint64_t FenceValue;
+		};
+
+		void IOThreadMain();
+		void Read(const ReadRequest& request);
+
+		float GetPriority(const Texture& texture) const;
+
+	private:
+		ITextureUploadSink* m_Sink;
+		UploadMemory m_UploadMemory;
+		TextureStreamerConfig m_Config;
+
+		//Only the thread that calls Update touches the textures and the allocator. A deque so the textures never move.
+		std::deque<Texture> m_Textures;
+		TLSFAllocator m_UploadAllocator;
+		std::deque<PendingFree> m_PendingFrees;
+		std::vector<TLSFAllocation> m_FrameFrees; //Copied by the current frame, they wait for EndFrame
+
+		//Shared with the I/O thread
+		std::mutex m_Mutex;
+		std::condition_variable m_RequestCondition;
+		std::condition_variable m_IdleCondition;
+		std::vector<ReadRequest> m_Requests;
+		std::vector<ReadRequest> m_Completed;
+		uint32_t m_ReadsInProgress = 0;
+		uint64_t m_ReadNs = 0;
+		uint64_t m_BytesRead = 0;
+		bool m_Stop = false;
+
+		std::thread m_IOThread;
+
+		TextureStreamerStats m_Stats;
+
+		//Scratch, kept to not allocate every frame
+		std::vector<TextureUploadFootprint> m_Footprints;
+		std::vector<TextureHandle> m_Candidates;
+		std::vector<ReadRequest> m_Batch;
+		std::vector<ReadRequest> m_Done;
+
+		//Only used by the I/O thread
+		std::vector<TextureUploadFootprint> m_IOFootprints;
+	};
+}
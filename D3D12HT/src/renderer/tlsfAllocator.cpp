@@ -0,0 +1,355 @@
+#include "tlsfAllocator.h"
+
+#include <util/simpleAssert.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	TLSFAllocator::TLSFAllocator(uint64_t capacity, uint64_t granularity) : m_Granularity(granularity)
+	{
+		D3D_ASSERT(HTUtils::HTIsPowerOfTwo(granularity), "The granularity of the TLSF allocator must be a power of two!");
+		D3D_ASSERT(capacity >= granularity, "The TLSF allocator needs at least one granule!");
+
+		m_GranularityLog2 = HTUtils::HTLowestBit(granularity);
+		m_Capacity = capacity & ~(granularity - 1);
+
+		uint32_t lastFirst, lastSecond;
+		Mapping(m_Capacity >> m_GranularityLog2, lastFirst, lastSecond);
+		m_FirstLevelCount = lastFirst + 1;
+
+		m_FreeLists.assign(m_FirstLevelCount * s_SecondLevelCount, s_InvalidBlock);
+		m_SecondLevelBitmaps.assign(m_FirstLevelCount, 0);
+
+		//Everything starts as one free block. Block 0 is always the one at offset 0 (merges keep the block of the lowest offset).
+		uint32_t block = NewBlock();
+		m_Blocks[block].Offset = 0;
+		m_Blocks[block].Size = m_Capacity;
+		InsertFree(block);
+
+		m_Stats.Capacity = m_Capacity;
+	}
+
+	void TLSFAllocator::Mapping(uint64_t units, uint32_t& outFirst, uint32_t& outSecond) const
+	{
+		//Small sizes have a list each, so the first level starts at 32 units
+		if (units < s_SecondLevelCount)
+		{
+			outFirst = 0;
+			outSecond = (uint32_t)units;
+			return;
+		}
+
+		uint32_t highestBit = HTUtils::HTHighestBit(units);
+		outFirst = highestBit - s_SecondLevelLog2 + 1;
+		outSecond = (uint32_t)(units >> (highestBit - s_SecondLevelLog2)) & (s_SecondLevelCount - 1);
+	}
+
+	bool TLSFAllocator::FindFreeList(uint64_t units, uint32_t& outFirst, uint32_t& outSecond) const
+	{
+		//A list holds a range of sizes, so we round up to the next list: any block of it is big enough and we never have to walk a list
+		if (units >= s_SecondLevelCount)
+			units += (1ull << (HTUtils::HTHighestBit(units) - s_SecondLevelLog2)) - 1;
+
+		uint32_t first, second;
+		Mapping(units, first, second);
+
+		if (first >= m_FirstLevelCount)
+			return false;
+
+		uint32_t secondBitmap = m_SecondLevelBitmaps[first] & (~0u << second);
+		if (secondBitmap == 0)
+		{
+			uint64_t firstBitmap = m_FirstLevelBitmap & (~0ull << (first + 1));
+			if (firstBitmap == 0)
+				return false;
+
+			first = HTUtils::HTLowestBit(firstBitmap);
+			secondBitmap = m_SecondLevelBitmaps[first];
+		}
+
+		outFirst = first;
+		outSecond = HTUtils::HTLowestBit(secondBitmap);
+		return true;
+	}
+
+	uint32_t TLSFAllocator::NewBlock()
+	{
+		uint32_t block;
+		if (!m_UnusedBlocks.empty())
+		{
+			block = m_UnusedBlocks.back();
+			m_UnusedBlocks.pop_back();
+		}
+		else
+		{
+			block = (uint32_t)m_Blocks.size();
+			m_Blocks.emplace_back();
+		}
+
+		m_Blocks[block] = { 0, 0, s_InvalidBlock, s_InvalidBlock, s_InvalidBlock, s_InvalidBlock, false };
+		return block;
+	}
+
+	void TLSFAllocator::InsertFree(uint32_t block)
+	{
+		Block& freeBlock = m_Blocks[block];
+
+		uint32_t first, second;
+		Mapping(freeBlock.Size >> m_GranularityLog2, first, second);
+
+		uint32_t& head = FreeListHead(first, second);
+		freeBlock.Free = true;
+		freeBlock.PreviousFree = s_InvalidBlock;
+		freeBlock.NextFree = head;
+
+		if (head != s_InvalidBlock)
+			m_Blocks[head].PreviousFree = block;
+
+		head = block;
+		m_FirstLevelBitmap |= 1ull << first;
+		m_SecondLevelBitmaps[first] |= 1u << second;
+
+		m_Stats.FreeBlockCount++;
+	}
+
+	void TLSFAllocator::RemoveFree(uint32_t block)
+	{
+		Block& freeBlock = m_Blocks[block];
+
+		uint32_t first, second;
+		Mapping(freeBlock.Size >> m_GranularityLog2, first, second);
+
+		if (freeBlock.PreviousFree != s_InvalidBlock)
+			m_Blocks[freeBlock.PreviousFree].NextFree = freeBlock.NextFree;
+		else
+			FreeListHead(first, second) = freeBlock.NextFree;
+
+		if (freeBlock.NextFree != s_InvalidBlock)
+			m_Blocks[freeBlock.NextFree].PreviousFree = freeBlock.PreviousFree;
+
+		if (FreeListHead(first, second) == s_InvalidBlock)
+		{
+			m_SecondLevelBitmaps[first] &= ~(1u << second);
+			if (m_SecondLevelBitmaps[first] == 0)
+				m_FirstLevelBitmap &= ~(1ull << first);
+		}
+
+		freeBlock.Free = false;
+		freeBlock.PreviousFree = s_InvalidBlock;
+		freeBlock.NextFree = s_InvalidBlock;
+
+		m_Stats.FreeBlockCount--;
+	}
+
+	void TLSFAllocator::SplitFront(uint32_t block, uint64_t size)
+	{
+		//NewBlock may grow the vector, so no references before it
+		uint32_t rest = NewBlock();
+
+		Block& front = m_Blocks[block];
+		Block& back = m_Blocks[rest];
+
+		back.Offset = front.Offset + size;
+		back.Size = front.Size - size;
+		back.PreviousPhysical = block;
+		back.NextPhysical = front.NextPhysical;
+
+		if (front.NextPhysical != s_InvalidBlock)
+			m_Blocks[front.NextPhysical].PreviousPhysical = rest;
+
+		front.Size = size;
+		front.NextPhysical = rest;
+
+		InsertFree(rest);
+	}
+
+	TLSFAllocation TLSFAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		D3D_ASSERT(size > 0, "Allocating 0 bytes!");
+		D3D_ASSERT(HTUtils::HTIsPowerOfTwo(alignment), "The alignment must be a power of two!");
+
+		alignment = HTUtils::HTMax(alignment, m_Granularity);
+		size = HTUtils::HTAlignUp(size, m_Granularity);
+
+		//Offsets are always multiples of the granularity, so aligning a block never moves it by more than this
+		uint64_t worstPadding = alignment - m_Granularity;
+
+		uint32_t first, second;
+		if (size > m_Capacity || !FindFreeList((size + worstPadding) >> m_GranularityLog2, first, second))
+		{
+			m_Stats.FailedAllocations++;
+			return {};
+		}
+
+		uint32_t block = FreeListHead(first, second);
+		RemoveFree(block);
+
+		//The padding before the aligned offset stays free. Its physical neighbour before it is not free (free blocks are always merged).
+		uint64_t padding = HTUtils::HTAlignUp(m_Blocks[block].Offset, alignment) - m_Blocks[block].Offset;
+		if (padding > 0)
+		{
+			SplitFront(block, padding);
+
+			uint32_t paddingBlock = block;
+			block = m_Blocks[paddingBlock].NextPhysical;
+
+			RemoveFree(block);
+			InsertFree(paddingBlock);
+		}
+
+		//And so does what we don't need at the end
+		if (m_Blocks[block].Size > size)
+			SplitFront(block, size);
+
+		m_Stats.UsedSize += size;
+		m_Stats.AllocationCount++;
+		m_Stats.TotalAllocations++;
+
+		TLSFAllocation allocation;
+		allocation.Offset = m_Blocks[block].Offset;
+		allocation.Size = size;
+		allocation.Node = block;
+		return allocation;
+	}
+
+	void TLSFAllocator::Free(TLSFAllocation& allocation)
+	{
+		D3D_ASSERT(allocation.IsValid() && allocation.Node < m_Blocks.size(), "Freeing an invalid TLSF allocation!");
+
+		uint32_t block = allocation.Node;
+		D3D_ASSERT(!m_Blocks[block].Free && m_Blocks[block].Offset == allocation.Offset, "Freeing a TLSF allocation twice!");
+
+		m_Stats.UsedSize -= m_Blocks[block].Size;
+		m_Stats.AllocationCount--;
+		m_Stats.TotalFrees++;
+
+		//Merge with the block before, it is the one that stays
+		uint32_t previous = m_Blocks[block].PreviousPhysical;
+		if (previous != s_InvalidBlock && m_Blocks[previous].Free)
+		{
+			RemoveFree(previous);
+
+			Block& merged = m_Blocks[previous];
+			merged.Size += m_Blocks[block].Size;
+			merged.NextPhysical = m_Blocks[block].NextPhysical;
+
+			if (merged.NextPhysical != s_InvalidBlock)
+				m_Blocks[merged.NextPhysical].PreviousPhysical = previous;
+
+			m_UnusedBlocks.push_back(block);
+			block = previous;
+		}
+
+		//And with the block after
+		uint32_t next = m_Blocks[block].NextPhysical;
+		if (next != s_InvalidBlock && m_Blocks[next].Free)
+		{
+			RemoveFree(next);
+
+			Block& merged = m_Blocks[block];
+			merged.Size += m_Blocks[next].Size;
+			merged.NextPhysical = m_Blocks[next].NextPhysical;
+
+			if (merged.NextPhysical != s_InvalidBlock)
+				m_Blocks[merged.NextPhysical].PreviousPhysical = block;
+
+			m_UnusedBlocks.push_back(next);
+		}
+
+		InsertFree(block);
+		allocation = {};
+	}
+
+	bool TLSFAllocator::Validate() const
+	{
+		//The physical chain covers [0, capacity) without holes and there are never two free blocks next to each other
+		uint64_t offset = 0;
+		uint64_t used = 0;
+		uint32_t freeBlocks = 0;
+		uint32_t allocations = 0;
+		uint32_t previous = s_InvalidBlock;
+
+		for (uint32_t block = 0; block != s_InvalidBlock; block = m_Blocks[block].NextPhysical)
+		{
+			const Block& current = m_Blocks[block];
+
+			if (current.Offset != offset || current.Size == 0 || current.PreviousPhysical != previous)
+				return false;
+
+			if (current.Offset % m_Granularity != 0 || current.Size % m_Granularity != 0)
+				return false;
+
+			if (current.Free)
+			{
+				if (previous != s_InvalidBlock && m_Blocks[previous].Free)
+					return false;
+
+				freeBlocks++;
+			}
+			else
+			{
+				used += current.Size;
+				allocations++;
+			}
+
+			offset += current.Size;
+			previous = block;
+		}
+
+		if (offset != m_Capacity || used != m_Stats.UsedSize || allocations != m_Stats.AllocationCount || freeBlocks != m_Stats.FreeBlockCount)
+			return false;
+
+		//Every free block is in the list of its size, and the bitmaps say which lists have blocks
+		uint32_t listedBlocks = 0;
+		for (uint32_t first = 0; first < m_FirstLevelCount; first++)
+		{
+			for (uint32_t second = 0; second < s_SecondLevelCount; second++)
+			{
+				uint32_t head = FreeListHead(first, second);
+				bool bitSet = (m_SecondLevelBitmaps[first] >> second) & 1u;
+
+				if (bitSet != (head != s_InvalidBlock))
+					return false;
+
+				uint32_t previousFree = s_InvalidBlock;
+				for (uint32_t block = head; block != s_InvalidBlock; block = m_Blocks[block].NextFree)
+				{
+					const Block& current = m_Blocks[block];
+
+					uint32_t blockFirst, blockSecond;
+					Mapping(current.Size >> m_GranularityLog2, blockFirst, blockSecond);
+
+					if (!current.Free || current.PreviousFree != previousFree || blockFirst != first || blockSecond != second)
+						return false;
+
+					previousFree = block;
+					listedBlocks++;
+				}
+			}
+
+			bool firstBitSet = (m_FirstLevelBitmap >> first) & 1ull;
+			if (firstBitSet != (m_SecondLevelBitmaps[first] != 0))
+				return false;
+		}
+
+		return listedBlocks == freeBlocks;
+	}
+
+	TLSFStats TLSFAllocator::GetStats() const
+	{
+		TLSFStats stats = m_Stats;
+		stats.FreeSize = m_Capacity - m_Stats.UsedSize;
+
+		//The biggest block is in the highest list that has blocks. That list holds a range of sizes, so we walk it.
+		if (m_FirstLevelBitmap != 0)
+		{
+			uint32_t first = HTUtils::HTHighestBit(m_FirstLevelBitmap);
+			uint32_t second = HTUtils::HTHighestBit(m_SecondLevelBitmaps[first]);
+
+			for (uint32_t block = FreeListHead(first, second); block != s_InvalidBlock; block = m_Blocks[block].NextFree)
+				stats.LargestFreeBlock = HTUtils::HTMax(stats.LargestFreeBlock, m_Blocks[block].Size);
+		}
+
+		return stats;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace HT
+{
+	//Where an allocation lives. Node is the block inside the allocator, it is what Free needs.
+	struct TLSFAllocation
+	{
+		static constexpr uint32_t s_InvalidNode = ~0u;
+
+		uint64_t Offset = 0;
+		uint64_t Size   = 0;
+		uint32_t Node   = s_InvalidNode;
+
+		inline bool IsValid() const { return Node != s_InvalidNode; }
+	};
+
+	struct TLSFStats
+	{
+		uint64_t Capacity = 0;
+		uint64_t UsedSize = 0;
+		uint64_t FreeSize = 0;
+		uint64_t LargestFreeBlock = 0;
+
+		uint32_t AllocationCount = 0; //Alive
+		uint32_t FreeBlockCount  = 0;
+
+		//Totals since the creation
+		uint64_t TotalAllocations = 0;
+		uint64_t TotalFrees       = 0;
+		uint64_t FailedAllocations = 0;
+
+		//0 when all the free space is a single block, close to 1 when it is split in many small blocks (so a big allocation fails even with a lot of free space)
+		inline double GetFragmentation() const { return FreeSize > 0 ? 1.0 - (double)LargestFreeBlock / (double)FreeSize : 0.0; }
+		inline double GetUtilization()   const { return Capacity > 0 ? (double)UsedSize / (double)Capacity : 0.0; }
+	};
+
+	//A general purpose allocator of ranges of [0, capacity), with O(1) Allocate and Free (Two-Level Segregated Fit, Masmano et al.).
+	//Like the HT::RingAllocator, it doesn't know what it is allocating, it only gives out offsets (inside a GPU heap for the placed resources).
+	//
+	//The free blocks are kept in lists by size: the first level is the power of two of the size, the second level splits each power of two in 32 lists.
+	//A bit per list tells if it has blocks, so finding a list with a block big enough is two bit scans, no matter how many blocks we have.
+	//Blocks also know their physical neighbours, so Free merges a block with the free blocks around it right away (no free blocks next to each other, ever).
+	//
+	//Every size and offset is a multiple of the granularity. The space lost to it (and to alignment) counts as used.
+	class TLSFAllocator
+	{
+	public:
+		static constexpr uint32_t s_SecondLevelLog2  = 5;
+		static constexpr uint32_t s_SecondLevelCount = 1u << s_SecondLevelLog2;
+
+		//granularity must be a power of two
+		explicit TLSFAllocator(uint64_t capacity, uint64_t granularity = 256);
+
+		TLSFAllocator(const TLSFAllocator&) = delete;
+		TLSFAllocator& operator=(const TLSFAllocator&) = delete;
+
+		//alignment must be a power of two. An invalid allocation is returned when there is no free block big enough.
+		TLSFAllocation Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(TLSFAllocation& allocation);
+
+		//Walks every block and checks the lists, the bitmaps and the neighbours. Slow, it is for the fuzz tests.
+		bool Validate() const;
+
+		TLSFStats GetStats() const;
+
+		inline uint64_t GetCapacity()    const { return m_Capacity; }
+		inline uint64_t GetGranularity() const { return m_Granularity; }
+		inline uint64_t GetUsedSize()    const { return m_Stats.UsedSize; }
+		inline bool IsEmpty() const { return m_Stats.AllocationCount == 0; }
+
+	private:
+		static constexpr uint32_t s_InvalidBlock = ~0u;
+
+		struct Block
+		{
+			uint64_t Offset;
+			uint64_t Size;
+
+			//Physical neighbours (by offset)
+			uint32_t PreviousPhysical;
+			uint32_t NextPhysical;
+
+			//Neighbours in the free list, only for free blocks
+			uint32_t PreviousFree;
+			uint32_t NextFree;
+
+			bool Free;
+		};
+
+		//The list whose blocks have this size range
+		void Mapping(uint64_t units, uint32_t& outFirst, uint32_t& outSecond) const;
+
+		//The first list whose blocks are all at least this size, or false if there is none
+		bool FindFreeList(uint64_t units, uint32_t& outFirst, uint32_t& outSecond) const;
+
+		uint32_t NewBlock();
+		void InsertFree(uint32_t block);
+		void RemoveFree(uint32_t block);
+
+		//Cuts size bytes out of the begin of block, the rest goes to a new free block
+		void SplitFront(uint32_t block, uint64_t size);
+
+		inline uint32_t& FreeListHead(uint32_t first, uint32_t second) { return m_FreeLists[first * s_SecondLevelCount + second]; }
+		inline uint32_t FreeListHead(uint32_t first, uint32_t second) const { return m_FreeLists[first * s_SecondLevelCount + second]; }
+
+	private:
+		uint64_t m_Capacity;
+		uint64_t m_Granularity;
+		uint32_t m_GranularityLog2;
+		uint32_t m_FirstLevelCount;
+
+		std::vector<Block> m_Blocks;
+		std::vector<uint32_t> m_UnusedBlocks;
+
+		//[first level][second level], s_InvalidBlock when empty
+		std::vector<uint32_t> m_FreeLists;
+		uint64_t m_FirstLevelBitmap = 0;
+		std::vector<uint32_t> m_SecondLevelBitmaps;
+
+		TLSFStats m_Stats;
+	};
+}
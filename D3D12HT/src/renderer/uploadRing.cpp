@@ -0,0 +1,35 @@
+#include "uploadRing.h"
+
+#include <util/simpleAssert.h>
+
+namespace HT
+{
+	CPUUploadMemory::CPUUploadMemory(uint64_t size, uint64_t fakeGPUBase)
+		: m_Storage(new uint8_t[size])
+	{
+		m_Memory.CPUBase = m_Storage.get();
+		m_Memory.GPUBase = fakeGPUBase;
+		m_Memory.Size = size;
+	}
+
+	UploadRing::UploadRing(const UploadMemory& memory) : m_Memory(memory), m_Ring(memory.Size)
+	{
+		D3D_ASSERT(memory.CPUBase && memory.Size > 0, "UploadRing needs a mapped memory!");
+	}
+
+	UploadAllocation UploadRing::Allocate(uint64_t size, uint64_t alignment)
+	{
+		UploadAllocation allocation;
+
+		uint64_t offset = m_Ring.Allocate(size, alignment);
+		if (offset == RingAllocator::s_InvalidOffset)
+			return allocation;
+
+		allocation.CPU = m_Memory.CPUBase + offset;
+		allocation.GPUAddress = m_Memory.GPUBase + offset;
+		allocation.Offset = offset;
+		allocation.Size = size;
+
+		return allocation;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <renderer/ringAllocator.h>
+
+namespace HT
+{
+	//A block of memory that the CPU writes to and the GPU reads from. For D3D12 it is a mapped buffer in an upload heap (see HT::D3D12UploadHeap),
+	//but the ring below only needs the pointers, so it can also be plain CPU memory (HT::CPUUploadMemory).
+	struct UploadMemory
+	{
+		uint8_t* CPUBase = nullptr;
+		uint64_t GPUBase = 0;
+		uint64_t Size    = 0;
+	};
+
+	//An upload memory that lives in the CPU. The "GPU address" is just an arbitrary base, only useful to check offsets.
+	class CPUUploadMemory
+	{
+	public:
+		CPUUploadMemory(uint64_t size, uint64_t fakeGPUBase = 0x10000);
+
+		inline UploadMemory GetMemory() const { return m_Memory; }
+
+	private:
+		std::unique_ptr<uint8_t[]> m_Storage;
+		UploadMemory m_Memory;
+	};
+
+	struct UploadAllocation
+	{
+		uint8_t* CPU        = nullptr;
+		uint64_t GPUAddress = 0;
+		uint64_t Offset     = 0;
+		uint64_t Size       = 0;
+
+		inline bool IsValid() const { return CPU != nullptr; }
+	};
+
+	using UploadRingStats = RingAllocatorStats;
+
+	//A linear allocator on a ring of upload memory, for the data that changes every frame (constants, dynamic vertices...).
+	//Instead of creating a committed resource for each upload, we just move a pointer forward inside a big mapped buffer.
+	//The offsets and the fence retirement are handled by a HT::RingAllocator, this class just turns them into CPU/GPU addresses.
+	class UploadRing
+	{
+	public:
+		explicit UploadRing(const UploadMemory& memory);
+
+		//Retire all frames that were completed by the GPU (this is, the frames with a fence value <= completedFenceValue).
+		inline void BeginFrame(uint64_t completedFenceValue) { m_Ring.BeginFrame(completedFenceValue); }
+
+		//Returns an invalid allocation when there is not enough free space. It never waits for the GPU.
+		UploadAllocation Allocate(uint64_t size, uint64_t alignment = 256);
+
+		//Mark the end of a frame. fenceValue is the value that will be signaled after all the work that uses the memory of this frame.
+		inline void EndFrame(uint64_t fenceValue) { m_Ring.EndFrame(fenceValue); }
+
+		inline const UploadRingStats& GetStats() const { return m_Ring.GetStats(); }
+		inline uint32_t GetPendingFrameCount() const { return m_Ring.GetPendingFrameCount(); }
+
+	private:
+		UploadMemory m_Memory;
+		RingAllocator m_Ring;
+	};
+}
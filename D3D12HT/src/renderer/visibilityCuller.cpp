@@ -0,0 +1,475 @@
+#include "visibilityCuller.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	using namespace HTUtils;
+
+	namespace
+	{
+		//The planes of the frustum, a.x + b.y + c.z + d >= 0 inside. Not normalized, the test doesn't need it.
+		struct FrustumPlanes
+		{
+			float A[6], B[6], C[6], D[6];
+		};
+
+		//Row vectors: clip = (x, y, z, 1) * M, so each clip component is a column of M.
+		//D3D clip space: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+		FrustumPlanes ExtractPlanes(const HTMat4& m)
+		{
+			FrustumPlanes planes;
+			float* components[4] = { planes.A, planes.B, planes.C, planes.D };
+
+			for (uint32_t row = 0; row < 4; row++)
+			{
+				float x = m.m[row][0], y = m.m[row][1], z = m.m[row][2], w = m.m[row][3];
+
+				//Left, right, bottom, top, near, far
+				const float values[6] = { w + x, w - x, w + y, w - y, z, w - z };
+				for (uint32_t p = 0; p < 6; p++)
+					components[row][p] = values[p];
+			}
+
+			return planes;
+		}
+
+		//A box is out when it is all behind one plane: the distance of the center plus the projection of the extents on the normal is < 0.
+		//The SIMD versions do these same operations in the same order. A NaN box is out on every level.
+		uint32_t FrustumScalar(const FrustumPlanes& planes, const CullingBoundsSoA& bounds, uint32_t begin, uint32_t end, uint32_t* outIndices)
+		{
+			uint32_t visibleCount = 0;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < 6 && visible; p++)
+				{
+					float distance = (planes.A[p] * bounds.CenterX[i] + planes.B[p] * bounds.CenterY[i]) + (planes.C[p] * bounds.CenterZ[i] + planes.D[p]);
+					float radius = (std::fabs(planes.A[p]) * bounds.ExtentX[i] + std::fabs(planes.B[p]) * bounds.ExtentY[i]) + std::fabs(planes.C[p]) * bounds.ExtentZ[i];
+					visible = distance + radius >= 0.0f;
+				}
+
+				if (visible)
+					outIndices[visibleCount++] = i;
+			}
+
+			return visibleCount;
+		}
+
+		inline uint32_t WriteMask(uint32_t mask, uint32_t first, uint32_t* outIndices)
+		{
+			uint32_t count = 0;
+			while (mask)
+			{
+				outIndices[count++] = first + HTLowestBit(mask);
+				mask &= mask - 1;
+			}
+
+			return count;
+		}
+
+#if HT_MATH_SIMD
+		uint32_t FrustumSSE(const FrustumPlanes& planes, const CullingBoundsSoA& bounds, uint32_t begin, uint32_t end, uint32_t* outIndices)
+		{
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			const __m128 zero = _mm_setzero_ps();
+
+			uint32_t visibleCount = 0;
+			uint32_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 cx = _mm_loadu_ps(bounds.CenterX + i), cy = _mm_loadu_ps(bounds.CenterY + i), cz = _mm_loadu_ps(bounds.CenterZ + i);
+				__m128 ex = _mm_loadu_ps(bounds.ExtentX + i), ey = _mm_loadu_ps(bounds.ExtentY + i), ez = _mm_loadu_ps(bounds.ExtentZ + i);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m128 a = _mm_set1_ps(planes.A[p]), b = _mm_set1_ps(planes.B[p]), c = _mm_set1_ps(planes.C[p]), d = _mm_set1_ps(planes.D[p]);
+
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)), _mm_add_ps(_mm_mul_ps(c, cz), d));
+					__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(a, absMask), ex), _mm_mul_ps(_mm_and_ps(b, absMask), ey)), _mm_mul_ps(_mm_and_ps(c, absMask), ez));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+				}
+
+				visibleCount += WriteMask((uint32_t)_mm_movemask_ps(inside), i, outIndices + visibleCount);
+			}
+
+			return visibleCount + FrustumScalar(planes, bounds, i, end, outIndices + visibleCount);
+		}
+
+		HT_AVX2_FUNCTION uint32_t FrustumAVX2(const FrustumPlanes& planes, const CullingBoundsSoA& bounds, uint32_t begin, uint32_t end, uint32_t* outIndices)
+		{
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+			const __m256 zero = _mm256_setzero_ps();
+
+			//The planes don't change, they stay in registers (with their absolute values) for the whole chunk
+			__m256 a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				a[p] = _mm256_set1_ps(planes.A[p]); b[p] = _mm256_set1_ps(planes.B[p]); c[p] = _mm256_set1_ps(planes.C[p]); d[p] = _mm256_set1_ps(planes.D[p]);
+				absA[p] = _mm256_and_ps(a[p], absMask); absB[p] = _mm256_and_ps(b[p], absMask); absC[p] = _mm256_and_ps(c[p], absMask);
+			}
+
+			uint32_t visibleCount = 0;
+			uint32_t i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256 cx = _mm256_loadu_ps(bounds.CenterX + i), cy = _mm256_loadu_ps(bounds.CenterY + i), cz = _mm256_loadu_ps(bounds.CenterZ + i);
+				__m256 ex = _mm256_loadu_ps(bounds.ExtentX + i), ey = _mm256_loadu_ps(bounds.ExtentY + i), ez = _mm256_loadu_ps(bounds.ExtentZ + i);
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[p], cx), _mm256_mul_ps(b[p], cy)), _mm256_add_ps(_mm256_mul_ps(c[p], cz), d[p]));
+					__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absA[p], ex), _mm256_mul_ps(absB[p], ey)), _mm256_mul_ps(absC[p], ez));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+				}
+
+				visibleCount += WriteMask((uint32_t)_mm256_movemask_ps(inside), i, outIndices + visibleCount);
+			}
+
+			return visibleCount + FrustumScalar(planes, bounds, i, end, outIndices + visibleCount);
+		}
+#endif
+
+		//A corner of a box in the depth buffer: pixels, and the depth of D3D (0 near, 1 far)
+		struct ScreenPoint
+		{
+			float X, Y, Z;
+		};
+
+		//The 8 corners of a box. False if one of them is not in front of the near plane (the projection is not a box anymore).
+		bool ProjectBox(const HTMat4& m, const HTVec3& center, const HTVec3& extents, ScreenPoint (&outCorners)[8])
+		{
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				float x = center.x + ((corner & 1) ? extents.x : -extents.x);
+				float y = center.y + ((corner & 2) ? extents.y : -extents.y);
+				float z = center.z + ((corner & 4) ? extents.z : -extents.z);
+
+				float clipX = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0];
+				float clipY = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1];
+				float clipZ = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2];
+				float clipW = x * m.m[0][3] + y * m.m[1][3] + z * m.m[2][3] + m.m[3][3];
+
+				if (!(clipZ >= 0.0f) || !(clipW > 0.0f))
+					return false;
+
+				float inverseW = 1.0f / clipW;
+				outCorners[corner].X = (clipX * inverseW * 0.5f + 0.5f) * (float)VisibilityCuller::s_DepthWidth;
+				outCorners[corner].Y = (0.5f - clipY * inverseW * 0.5f) * (float)VisibilityCuller::s_DepthHeight;
+				outCorners[corner].Z = clipZ * inverseW;
+			}
+
+			return true;
+		}
+
+		//The corners of each face, in order around it
+		const uint8_t s_BoxFaces[6][4] =
+		{
+			{ 0, 2, 6, 4 }, { 1, 3, 7, 5 }, //-x, +x
+			{ 0, 1, 5, 4 }, { 2, 3, 7, 6 }, //-y, +y
+			{ 0, 1, 3, 2 }, { 4, 5, 7, 6 }, //-z, +z
+		};
+	}
+
+	void VisibilityCuller::Resize(uint32_t count)
+	{
+		m_Count = count;
+		for (std::vector<float>& array : m_Bounds)
+			array.resize(count);
+	}
+
+	CullingBoundsSoA VisibilityCuller::GetBounds()
+	{
+		return { m_Bounds[0].data(), m_Bounds[1].data(), m_Bounds[2].data(), m_Bounds[3].data(), m_Bounds[4].data(), m_Bounds[5].data() };
+	}
+
+	void VisibilityCuller::SetBounds(uint32_t index, const HTVec3& center, const HTVec3& extents)
+	{
+		D3D_ASSERT(index < m_Count, "Culling bounds out of range!");
+
+		m_Bounds[0][index] = center.x;  m_Bounds[1][index] = center.y;  m_Bounds[2][index] = center.z;
+		m_Bounds[3][index] = extents.x; m_Bounds[4][index] = extents.y; m_Bounds[5][index] = extents.z;
+	}
+
+	void VisibilityCuller::ClearOccluders()
+	{
+		m_Occluders.clear();
+	}
+
+	void VisibilityCuller::AddOccluder(const HTVec3& center, const HTVec3& extents)
+	{
+		m_Occluders.push_back({ center, extents });
+	}
+
+	template<typename TFunction>
+	uint32_t VisibilityCuller::RunChunks(uint32_t count, JobSystem* jobSystem, std::vector<uint32_t>& output, const TFunction& function)
+	{
+		uint32_t chunkCount = (count + s_ChunkSize - 1) / s_ChunkSize;
+		m_ChunkOutput.resize(count);
+		m_ChunkCounts.resize(chunkCount);
+
+		auto RunRange = [&](uint32_t chunkBegin, uint32_t chunkEnd)
+		{
+			for (uint32_t chunk = chunkBegin; chunk < chunkEnd; chunk++)
+			{
+				uint32_t begin = chunk * s_ChunkSize;
+				m_ChunkCounts[chunk] = function(begin, HTMin(begin + s_ChunkSize, count), m_ChunkOutput.data() + begin);
+			}
+		};
+
+		bool parallel = jobSystem && chunkCount > 1;
+		if (parallel)
+			jobSystem->ParallelFor(chunkCount, 1, RunRange);
+		else
+			RunRange(0, chunkCount);
+
+		//Where each chunk goes in the output. The counts become the offsets.
+		uint32_t total = 0;
+		for (uint32_t& offset : m_ChunkCounts)
+		{
+			uint32_t written = offset;
+			offset = total;
+			total += written;
+		}
+
+		output.resize(total);
+
+		auto PackRange = [&](uint32_t chunkBegin, uint32_t chunkEnd)
+		{
+			for (uint32_t chunk = chunkBegin; chunk < chunkEnd; chunk++)
+			{
+				uint32_t offset = m_ChunkCounts[chunk];
+				uint32_t written = (chunk + 1 < chunkCount ? m_ChunkCounts[chunk + 1] : total) - offset;
+				memcpy(output.data() + offset, m_ChunkOutput.data() + (size_t)chunk * s_ChunkSize, (size_t)written * sizeof(uint32_t));
+			}
+		};
+
+		if (parallel)
+			jobSystem->ParallelFor(chunkCount, 4, PackRange);
+		else
+			PackRange(0, chunkCount);
+
+		return total;
+	}
+
+	void VisibilityCuller::Cull(const HTMat4& viewProjection, JobSystem* jobSystem, bool occlusion, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Culling with a math level this CPU doesn't have!");
+
+		m_Stats = {};
+		m_Stats.Objects = m_Count;
+		m_Stats.Occluders = (uint32_t)m_Occluders.size();
+		m_Stats.Level = level;
+
+		uint64_t frustumBegin = HTNowNanoseconds();
+
+		FrustumPlanes planes = ExtractPlanes(viewProjection);
+		CullingBoundsSoA bounds = GetBounds();
+
+		bool testOcclusion = occlusion && !m_Occluders.empty();
+		std::vector<uint32_t>& frustumOutput = testOcclusion ? m_FrustumVisible : m_Visible;
+
+		m_Stats.FrustumVisible = RunChunks(m_Count, jobSystem, frustumOutput, [&planes, &bounds, level](uint32_t begin, uint32_t end, uint32_t* outIndices)
+		{
+			switch (level)
+			{
+#if HT_MATH_SIMD
+			case HTMathLevel::AVX2: return FrustumAVX2(planes, bounds, begin, end, outIndices);
+			case HTMathLevel::SSE:  return FrustumSSE(planes, bounds, begin, end, outIndices);
+#endif
+			default:                return FrustumScalar(planes, bounds, begin, end, outIndices);
+			}
+		});
+
+		m_Stats.FrustumNs = HTNowNanoseconds() - frustumBegin;
+		m_Stats.Visible = m_Stats.FrustumVisible;
+
+		if (!testOcclusion)
+			return;
+
+		uint64_t rasterBegin = HTNowNanoseconds();
+		RasterizeOccluders(viewProjection);
+		m_Stats.RasterNs = HTNowNanoseconds() - rasterBegin;
+
+		uint64_t occlusionBegin = HTNowNanoseconds();
+
+		if (m_Stats.RasterizedOccluders == 0)
+			m_Visible = m_FrustumVisible;
+		else
+		{
+			m_Stats.Visible = RunChunks(m_Stats.FrustumVisible, jobSystem, m_Visible, [this, &viewProjection](uint32_t begin, uint32_t end, uint32_t* outIndices)
+			{
+				uint32_t visibleCount = 0;
+				for (uint32_t i = begin; i < end; i++)
+				{
+					uint32_t index = m_FrustumVisible[i];
+					if (!IsOccluded(viewProjection, index))
+						outIndices[visibleCount++] = index;
+				}
+
+				return visibleCount;
+			});
+		}
+
+		m_Stats.OcclusionCulled = m_Stats.FrustumVisible - m_Stats.Visible;
+		m_Stats.OcclusionNs = HTNowNanoseconds() - occlusionBegin;
+	}
+
+	void VisibilityCuller::RasterizeOccluders(const HTMat4& viewProjection)
+	{
+		//One thread, there are a few occluders and the buffer is small
+		m_Depth.assign(s_DepthWidth * s_DepthHeight, 1.0f);
+
+		for (const Occluder& occluder : m_Occluders)
+		{
+			ScreenPoint corners[8];
+			if (!ProjectBox(viewProjection, occluder.Center, occluder.Extents, corners))
+				continue;
+
+			m_Stats.RasterizedOccluders++;
+
+			//The back faces are behind the front ones, the depth test keeps the front ones
+			for (const uint8_t (&face)[4] : s_BoxFaces)
+			{
+				const ScreenPoint* points[4] = { &corners[face[0]], &corners[face[1]], &corners[face[2]], &corners[face[3]] };
+
+				//The farthest corner: nothing of the face is behind it
+				float depth = HTMax(HTMax(points[0]->Z, points[1]->Z), HTMax(points[2]->Z, points[3]->Z));
+
+				float minX = HTMin(HTMin(points[0]->X, points[1]->X), HTMin(points[2]->X, points[3]->X));
+				float maxX = HTMax(HTMax(points[0]->X, points[1]->X), HTMax(points[2]->X, points[3]->X));
+				float minY = HTMin(HTMin(points[0]->Y, points[1]->Y), HTMin(points[2]->Y, points[3]->Y));
+				float maxY = HTMax(HTMax(points[0]->Y, points[1]->Y), HTMax(points[2]->Y, points[3]->Y));
+
+				int32_t beginX = HTMax((int32_t)std::floor(minX), 0), endX = HTMin((int32_t)std::ceil(maxX), (int32_t)s_DepthWidth);
+				int32_t beginY = HTMax((int32_t)std::floor(minY), 0), endY = HTMin((int32_t)std::ceil(maxY), (int32_t)s_DepthHeight);
+				if (beginX >= endX || beginY >= endY)
+					continue;
+
+				//The edges as a.x + b.y + c >= 0 inside, for either winding (a face can be seen from both sides)
+				float area = 0.0f;
+				for (uint32_t e = 0; e < 4; e++)
+				{
+					const ScreenPoint* from = points[e];
+					const ScreenPoint* to = points[(e + 1) % 4];
+					area += from->X * to->Y - to->X * from->Y;
+				}
+
+				if (std::fabs(area) < 1e-6f)
+					continue;
+
+				float winding = area > 0.0f ? 1.0f : -1.0f;
+				float edgeA[4], edgeB[4], edgeC[4];
+
+				for (uint32_t e = 0; e < 4; e++)
+				{
+					const ScreenPoint* from = points[e];
+					const ScreenPoint* to = points[(e + 1) % 4];
+
+					edgeA[e] = winding * (from->Y - to->Y);
+					edgeB[e] = winding * (to->X - from->X);
+					edgeC[e] = winding * (from->X * to->Y - to->X * from->Y);
+
+					//Only the pixels the face covers whole: the edge is tested at the corner of the pixel that is the most outside of it
+					edgeC[e] -= 0.5f * (std::fabs(edgeA[e]) + std::fabs(edgeB[e]));
+				}
+
+				for (int32_t y = beginY; y < endY; y++)
+				{
+					float pixelY = (float)y + 0.5f;
+					float* row = m_Depth.data() + (size_t)y * s_DepthWidth;
+
+					for (int32_t x = beginX; x < endX; x++)
+					{
+						float pixelX = (float)x + 0.5f;
+
+						bool covered = true;
+						for (uint32_t e = 0; e < 4; e++)
+							covered &= edgeA[e] * pixelX + edgeB[e] * pixelY + edgeC[e] >= 0.0f;
+
+						if (covered && depth < row[x])
+							row[x] = depth;
+					}
+				}
+			}
+		}
+
+		//The farthest occluder depth of each tile: a box nearer than that is behind nothing in the tile
+		const uint32_t tilesX = s_DepthWidth / s_DepthTileSize;
+		const uint32_t tilesY = s_DepthHeight / s_DepthTileSize;
+		m_TileMaxDepth.resize(tilesX * tilesY);
+
+		for (uint32_t tileY = 0; tileY < tilesY; tileY++)
+		{
+			for (uint32_t tileX = 0; tileX < tilesX; tileX++)
+			{
+				float maxDepth = 0.0f;
+				for (uint32_t y = tileY * s_DepthTileSize; y < (tileY + 1) * s_DepthTileSize; y++)
+					for (uint32_t x = tileX * s_DepthTileSize; x < (tileX + 1) * s_DepthTileSize; x++)
+						maxDepth = HTMax(maxDepth, m_Depth[y * s_DepthWidth + x]);
+
+				m_TileMaxDepth[tileY * tilesX + tileX] = maxDepth;
+			}
+		}
+	}
+
+	bool VisibilityCuller::IsOccluded(const HTMat4& viewProjection, uint32_t index) const
+	{
+		HTVec3 center = { m_Bounds[0][index], m_Bounds[1][index], m_Bounds[2][index] };
+		HTVec3 extents = { m_Bounds[3][index], m_Bounds[4][index], m_Bounds[5][index] };
+
+		ScreenPoint corners[8];
+		if (!ProjectBox(viewProjection, center, extents, corners))
+			return false;
+
+		float minX = corners[0].X, maxX = corners[0].X;
+		float minY = corners[0].Y, maxY = corners[0].Y;
+		float nearest = corners[0].Z;
+
+		for (uint32_t corner = 1; corner < 8; corner++)
+		{
+			minX = HTMin(minX, corners[corner].X); maxX = HTMax(maxX, corners[corner].X);
+			minY = HTMin(minY, corners[corner].Y); maxY = HTMax(maxY, corners[corner].Y);
+			nearest = HTMin(nearest, corners[corner].Z);
+		}
+
+		//Every pixel the rectangle touches. None = it is not on screen (the frustum test is conservative, it lets a few of those through).
+		int32_t beginX = HTMax((int32_t)std::floor(minX), 0), lastX = HTMin((int32_t)std::floor(maxX), (int32_t)s_DepthWidth - 1);
+		int32_t beginY = HTMax((int32_t)std::floor(minY), 0), lastY = HTMin((int32_t)std::floor(maxY), (int32_t)s_DepthHeight - 1);
+		if (beginX > lastX || beginY > lastY)
+			return true;
+
+		const int32_t tileSize = (int32_t)s_DepthTileSize;
+		const uint32_t tilesX = s_DepthWidth / s_DepthTileSize;
+
+		for (int32_t tileY = beginY / tileSize; tileY <= lastY / tileSize; tileY++)
+		{
+			for (int32_t tileX = beginX / tileSize; tileX <= lastX / tileSize; tileX++)
+			{
+				if (m_TileMaxDepth[tileY * tilesX + tileX] < nearest)
+					continue;
+
+				//Some pixel of the tile is not hidden. If the rectangle has the whole tile, it is that one.
+				int32_t x0 = HTMax(beginX, tileX * tileSize), x1 = HTMin(lastX, tileX * tileSize + tileSize - 1);
+				int32_t y0 = HTMax(beginY, tileY * tileSize), y1 = HTMin(lastY, tileY * tileSize + tileSize - 1);
+
+				if (x1 - x0 + 1 == tileSize && y1 - y0 + 1 == tileSize)
+					return false;
+
+				for (int32_t y = y0; y <= y1; y++)
+					for (int32_t x = x0; x <= x1; x++)
+						if (m_Depth[y * s_DepthWidth + x] >= nearest)
+							return false;
+			}
+		}
+
+		return true;
+	}
+}
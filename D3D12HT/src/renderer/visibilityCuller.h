@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <util/mathKernels.h>
+#include <util/vectorMath.h>
+
+namespace HT
+{
+	struct CullingStats
+	{
+		uint32_t Objects = 0;
+		uint32_t FrustumVisible = 0;
+		uint32_t OcclusionCulled = 0;
+		uint32_t Visible = 0;
+
+		uint32_t Occluders = 0;
+		uint32_t RasterizedOccluders = 0; //The others cross the near plane, they don't occlude anything (it would not be conservative)
+
+		uint64_t FrustumNs = 0;
+		uint64_t RasterNs = 0;
+		uint64_t OcclusionNs = 0;
+
+		HTUtils::HTMathLevel Level = HTUtils::HTMathLevel::Scalar;
+	};
+
+	//The world space boxes of the objects as centers and extents (half sizes), one array per component
+	struct CullingBoundsSoA
+	{
+		float* CenterX; float* CenterY; float* CenterZ;
+		float* ExtentX; float* ExtentY; float* ExtentZ;
+	};
+
+	//The visibility stage between the scene and the recording: which objects of the frame can be on screen.
+	//
+	//Frustum: the boxes are tested against the 6 planes of the view projection, 8 boxes per instruction with AVX2 (4 with SSE), in chunks
+	//spread over the job system. The SIMD versions do the same operations in the same order as the scalar one (no FMA), so every level
+	//gives the same visible list on every machine.
+	//
+	//Occlusion (optional): the faces of the occluders (a few big boxes, walls and buildings) are rasterized into a small depth buffer, each face
+	//with its farthest depth and only on the pixels it covers whole, so the buffer is never nearer than the real occluders. A box that passed the
+	//frustum is then hidden if every pixel of its screen rectangle has an occluder in front of its nearest point. A tile level of the buffer
+	//(the farthest depth of each tile) answers most boxes without reading the pixels.
+	//Boxes and occluders that cross the near plane are always visible / never occlude.
+	//
+	//The output is the sorted list of visible indices, what the draw recorder walks.
+	class VisibilityCuller
+	{
+	public:
+		//Boxes per job
+		static constexpr uint32_t s_ChunkSize = 4096;
+
+		static constexpr uint32_t s_DepthWidth = 256;
+		static constexpr uint32_t s_DepthHeight = 128;
+		static constexpr uint32_t s_DepthTileSize = 8;
+
+		void Resize(uint32_t count);
+		inline uint32_t GetCount() const { return m_Count; }
+
+		//The arrays are written directly (e.g. in parallel by the code that moves the objects)
+		CullingBoundsSoA GetBounds();
+		void SetBounds(uint32_t index, const HTUtils::HTVec3& center, const HTUtils::HTVec3& extents);
+
+		void ClearOccluders();
+		void AddOccluder(const HTUtils::HTVec3& center, const HTUtils::HTVec3& extents);
+
+		//viewProjection takes world space to the D3D clip space (0 <= z <= w), with row vectors as in util/vectorMath.h
+		void Cull(const HTUtils::HTMat4& viewProjection, JobSystem* jobSystem = nullptr, bool occlusion = true,
+			HTUtils::HTMathLevel level = HTUtils::HTGetMathLevel());
+
+		//After Cull, in increasing order
+		inline const uint32_t* GetVisibleIndices() const { return m_Visible.data(); }
+		inline uint32_t GetVisibleCount() const { return m_Stats.Visible; }
+
+		inline const CullingStats& GetStats() const { return m_Stats; }
+
+		//After Cull with occlusion: the occluder depth of a pixel (1 = nothing)
+		inline float GetOccluderDepth(uint32_t x, uint32_t y) const { return m_Depth[y * s_DepthWidth + x]; }
+
+	private:
+		struct Occluder
+		{
+			HTUtils::HTVec3 Center;
+			HTUtils::HTVec3 Extents;
+		};
+
+		void RasterizeOccluders(const HTUtils::HTMat4& viewProjection);
+		bool IsOccluded(const HTUtils::HTMat4& viewProjection, uint32_t index) const;
+
+		//Runs function(chunk, begin, end, outIndices) over chunks of [0, count) and packs what each chunk wrote (at the start of its
+		//own part of m_ChunkOutput) into output, in order. Returns how many were written.
+		template<typename TFunction>
+		uint32_t RunChunks(uint32_t count, JobSystem* jobSystem, std::vector<uint32_t>& output, const TFunction& function);
+
+	private:
+		uint32_t m_Count = 0;
+		std::vector<float> m_Bounds[6];
+
+		std::vector<Occluder> m_Occluders;
+
+		std::vector<uint32_t> m_ChunkOutput;
+		std::vector<uint32_t> m_ChunkCounts;
+		std::vector<uint32_t> m_FrustumVisible;
+		std::vector<uint32_t> m_Visible;
+
+		std::vector<float> m_Depth;
+		std::vector<float> m_TileMaxDepth;
+
+		CullingStats m_Stats;
+	};
+}
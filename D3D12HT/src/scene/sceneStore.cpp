@@ -0,0 +1,582 @@
+#include "sceneStore.h"
+
+#include <cstring>
+
+#include <util/simpleAssert.h>
+#include <util/timer.h>
+#include <util/utils.h>
+
+namespace HT
+{
+	using namespace HTUtils;
+
+	//Transforms per job when the changed ones are collected (reading a byte per transform, so more than s_TransformGrain)
+	static const uint32_t s_ChangedGrain = 16 * 1024;
+
+	SceneArchetypeView SceneStore::Archetype::GetView()
+	{
+		return { (uint32_t)Entities.size(), Entities.data(), Mask, Columns.data() };
+	}
+
+	SceneStore::SceneStore()
+	{
+		m_LevelBegin.push_back(0);
+
+		//Every entity starts in the archetype without components
+		GetOrCreateArchetype(0);
+	}
+
+	ComponentId SceneStore::RegisterComponent(const char* name, uint32_t size, uint32_t alignment)
+	{
+		D3D_ASSERT(m_Components.size() < s_MaxComponents, "Too many scene components!");
+		D3D_ASSERT(size > 0, "Empty scene component!");
+
+		//The columns are in std::vector<uint8_t>, the allocator gives 16 bytes
+		D3D_ASSERT(alignment <= 16, "Scene components can't be aligned to more than 16 bytes!");
+
+		m_Components.push_back({ name, size, alignment });
+		return (ComponentId)(m_Components.size() - 1);
+	}
+
+	// -------------- Entities
+
+	const SceneStore::EntityRecord& SceneStore::GetRecord(EntityHandle entity) const
+	{
+		D3D_ASSERT(IsAlive(entity), "Using a destroyed entity!");
+		return m_Entities[entity.Index];
+	}
+
+	SceneStore::EntityRecord& SceneStore::GetRecord(EntityHandle entity)
+	{
+		D3D_ASSERT(IsAlive(entity), "Using a destroyed entity!");
+		return m_Entities[entity.Index];
+	}
+
+	bool SceneStore::IsAlive(EntityHandle entity) const
+	{
+		return entity.Index < m_Entities.size() && m_Entities[entity.Index].Archetype != s_None && m_Entities[entity.Index].Generation == entity.Generation;
+	}
+
+	EntityHandle SceneStore::Create(EntityHandle parent, const SceneTransform& local)
+	{
+		uint32_t parentTransform = parent.IsValid() ? GetRecord(parent).Transform : s_None;
+
+		uint32_t index;
+		if (!m_FreeEntities.empty())
+		{
+			index = m_FreeEntities.back();
+			m_FreeEntities.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)m_Entities.size();
+			m_Entities.emplace_back();
+		}
+
+		EntityRecord& record = m_Entities[index];
+		EntityHandle entity = { index, record.Generation };
+
+		Archetype& empty = m_Archetypes[0];
+		record.Archetype = 0;
+		record.Row = (uint32_t)empty.Entities.size();
+		empty.Entities.push_back(entity);
+
+		record.Transform = PushTransform(index, parentTransform, local);
+
+		if (parent.IsValid())
+			LinkChild(parent.Index, index);
+
+		m_AliveCount++;
+		return entity;
+	}
+
+	void SceneStore::Destroy(EntityHandle entity)
+	{
+		D3D_ASSERT(IsAlive(entity), "Destroying an entity that is already destroyed!");
+		UnlinkChild(entity.Index);
+
+		//The entity and everything under it
+		std::vector<uint32_t> pending = { entity.Index };
+
+		while (!pending.empty())
+		{
+			uint32_t index = pending.back();
+			pending.pop_back();
+
+			EntityRecord& record = m_Entities[index];
+			for (uint32_t child = record.FirstChild; child != s_None; child = m_Entities[child].NextSibling)
+				pending.push_back(child);
+
+			RemoveRow(record.Archetype, record.Row);
+
+			//A hole in the transforms, the next update sorts them and drops it
+			m_TransformEntity[record.Transform] = s_None;
+
+			uint32_t generation = record.Generation + 1;
+			record = {};
+			record.Generation = generation;
+
+			m_FreeEntities.push_back(index);
+			m_AliveCount--;
+		}
+
+		m_NeedsSort = true;
+	}
+
+	void SceneStore::LinkChild(uint32_t parent, uint32_t child)
+	{
+		EntityRecord& parentRecord = m_Entities[parent];
+		EntityRecord& childRecord = m_Entities[child];
+
+		childRecord.Parent = parent;
+		childRecord.PreviousSibling = s_None;
+		childRecord.NextSibling = parentRecord.FirstChild;
+
+		if (parentRecord.FirstChild != s_None)
+			m_Entities[parentRecord.FirstChild].PreviousSibling = child;
+
+		parentRecord.FirstChild = child;
+	}
+
+	void SceneStore::UnlinkChild(uint32_t child)
+	{
+		EntityRecord& record = m_Entities[child];
+		if (record.Parent == s_None)
+			return;
+
+		if (record.PreviousSibling != s_None)
+			m_Entities[record.PreviousSibling].NextSibling = record.NextSibling;
+		else
+			m_Entities[record.Parent].FirstChild = record.NextSibling;
+
+		if (record.NextSibling != s_None)
+			m_Entities[record.NextSibling].PreviousSibling = record.PreviousSibling;
+
+		record.Parent = s_None;
+		record.NextSibling = s_None;
+		record.PreviousSibling = s_None;
+	}
+
+	void SceneStore::SetParent(EntityHandle entity, EntityHandle parent)
+	{
+		EntityRecord& record = GetRecord(entity);
+
+		if (parent.IsValid())
+		{
+			//The new parent can't be under the entity
+			D3D_ASSERT(IsAlive(parent), "Parenting to a destroyed entity!");
+			for (uint32_t ancestor = parent.Index; ancestor != s_None; ancestor = m_Entities[ancestor].Parent)
+				D3D_ASSERT(ancestor != entity.Index, "An entity can't be its own ancestor!");
+		}
+
+		UnlinkChild(entity.Index);
+		if (parent.IsValid())
+			LinkChild(parent.Index, entity.Index);
+
+		//The depth of the subtree changed and the parent may be after it in the transforms, the sort fixes both (and the parent transform)
+		if (!(m_Flags[record.Transform] & s_LocalDirty))
+		{
+			m_Flags[record.Transform] |= s_LocalDirty;
+			m_DirtyCount++;
+		}
+
+		m_NeedsSort = true;
+	}
+
+	EntityHandle SceneStore::GetParent(EntityHandle entity) const
+	{
+		uint32_t parent = GetRecord(entity).Parent;
+		if (parent == s_None)
+			return {};
+
+		return { parent, m_Entities[parent].Generation };
+	}
+
+	// -------------- Transforms
+
+	uint32_t SceneStore::PushTransform(uint32_t entityIndex, uint32_t parentTransform, const SceneTransform& local)
+	{
+		uint32_t transform = (uint32_t)m_World.size();
+		ResizeTransforms(transform + 1);
+
+		m_World[transform] = HTMat4Identity();
+		m_ParentTransform[transform] = parentTransform;
+		m_TransformEntity[transform] = entityIndex;
+		m_Flags[transform] = s_LocalDirty;
+		m_DirtyCount++;
+
+		uint16_t depth = parentTransform != s_None ? (uint16_t)(m_Depth[parentTransform] + 1) : 0;
+		m_Depth[transform] = depth;
+
+		WriteLocal(transform, local);
+
+		//At the end of the deepest level (or as the first of a new one) the transforms stay sorted
+		uint32_t levels = (uint32_t)m_LevelBegin.size() - 1;
+		if (m_NeedsSort || (levels > 0 && depth + 1u < levels))
+			m_NeedsSort = true;
+		else if (depth == levels)
+			m_LevelBegin.push_back(transform + 1);
+		else
+			m_LevelBegin.back() = transform + 1;
+
+		return transform;
+	}
+
+	void SceneStore::ResizeTransforms(uint32_t count)
+	{
+		for (std::vector<float>& array : m_Local)
+			array.resize(count);
+
+		m_World.resize(count);
+		m_ParentTransform.resize(count);
+		m_TransformEntity.resize(count);
+		m_Depth.resize(count);
+		m_Flags.resize(count);
+	}
+
+	void SceneStore::WriteLocal(uint32_t transform, const SceneTransform& local)
+	{
+		const float values[10] = { local.Position.x, local.Position.y, local.Position.z, local.Rotation.x, local.Rotation.y, local.Rotation.z, local.Rotation.w,
+		                           local.Scale.x, local.Scale.y, local.Scale.z };
+		for (uint32_t i = 0; i < 10; i++)
+			m_Local[i][transform] = values[i];
+	}
+
+	void SceneStore::SetLocalTransform(EntityHandle entity, const SceneTransform& local)
+	{
+		uint32_t transform = GetRecord(entity).Transform;
+		WriteLocal(transform, local);
+
+		if (!(m_Flags[transform] & s_LocalDirty))
+		{
+			m_Flags[transform] |= s_LocalDirty;
+			m_DirtyCount++;
+		}
+	}
+
+	SceneTransform SceneStore::GetLocalTransform(EntityHandle entity) const
+	{
+		uint32_t t = GetRecord(entity).Transform;
+
+		SceneTransform local;
+		local.Position = { m_Local[0][t], m_Local[1][t], m_Local[2][t] };
+		local.Rotation = { m_Local[3][t], m_Local[4][t], m_Local[5][t], m_Local[6][t] };
+		local.Scale = { m_Local[7][t], m_Local[8][t], m_Local[9][t] };
+		return local;
+	}
+
+	const HTMat4& SceneStore::GetWorldMatrix(EntityHandle entity) const
+	{
+		return m_World[GetRecord(entity).Transform];
+	}
+
+	void SceneStore::SortTransforms()
+	{
+		uint32_t oldCount = (uint32_t)m_World.size();
+
+		//Breadth first from the roots: every depth comes after the one above it. The roots keep their order.
+		std::vector<uint32_t> order;
+		order.reserve(m_AliveCount);
+
+		for (uint32_t transform = 0; transform < oldCount; transform++)
+		{
+			uint32_t entity = m_TransformEntity[transform];
+			if (entity != s_None && m_Entities[entity].Parent == s_None)
+				order.push_back(transform);
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+		{
+			const EntityRecord& record = m_Entities[m_TransformEntity[order[i]]];
+			for (uint32_t child = record.FirstChild; child != s_None; child = m_Entities[child].NextSibling)
+				order.push_back(m_Entities[child].Transform);
+		}
+
+		D3D_ASSERT(order.size() == m_AliveCount, "The scene hierarchy lost entities!");
+
+		uint32_t count = (uint32_t)order.size();
+		std::vector<uint32_t> newIndex(oldCount, s_None);
+
+		//Moved one array at a time, each one is read once and written once
+		for (std::vector<float>& array : m_Local)
+		{
+			std::vector<float> sorted(count);
+			for (uint32_t i = 0; i < count; i++)
+				sorted[i] = array[order[i]];
+			array.swap(sorted);
+		}
+
+		std::vector<HTMat4> world(count);
+		std::vector<uint32_t> parentTransform(count);
+		std::vector<uint32_t> transformEntity(count);
+		std::vector<uint16_t> depth(count);
+		std::vector<uint8_t> flags(count);
+
+		m_LevelBegin.assign(1, 0);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t old = order[i];
+			newIndex[old] = i;
+
+			uint32_t entity = m_TransformEntity[old];
+			uint32_t parent = m_Entities[entity].Parent;
+
+			world[i] = m_World[old];
+			transformEntity[i] = entity;
+			flags[i] = m_Flags[old];
+
+			//The parent is always before, it already has its new index
+			parentTransform[i] = parent != s_None ? newIndex[m_Entities[parent].Transform] : s_None;
+			depth[i] = parent != s_None ? (uint16_t)(depth[parentTransform[i]] + 1) : 0;
+
+			if (depth[i] == m_LevelBegin.size() - 1)
+				m_LevelBegin.push_back(i + 1);
+			else
+				m_LevelBegin.back() = i + 1;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+			m_Entities[transformEntity[i]].Transform = i;
+
+		m_World.swap(world);
+		m_ParentTransform.swap(parentTransform);
+		m_TransformEntity.swap(transformEntity);
+		m_Depth.swap(depth);
+		m_Flags.swap(flags);
+
+		m_NeedsSort = false;
+	}
+
+	void SceneStore::UpdateTransforms(JobSystem* jobSystem)
+	{
+		uint64_t begin = HTNowNanoseconds();
+
+		m_UpdateStats = {};
+		m_UpdateStats.LocalDirty = m_DirtyCount;
+		m_DirtyCount = 0;
+
+		if (m_NeedsSort)
+		{
+			SortTransforms();
+			m_UpdateStats.Reordered = true;
+			m_UpdateStats.ReorderNs = HTNowNanoseconds() - begin;
+		}
+
+		uint32_t count = (uint32_t)m_World.size();
+		uint32_t levels = (uint32_t)m_LevelBegin.size() - 1;
+
+		//A transform is computed again if it was set or its parent changed in this update (the parents are a level above, already done).
+		//Only the changed ones keep the flag, the next update reads it for their children.
+		auto UpdateRange = [this](uint32_t rangeBegin, uint32_t rangeEnd)
+		{
+			for (uint32_t i = rangeBegin; i < rangeEnd; i++)
+			{
+				uint32_t parent = m_ParentTransform[i];
+				bool parentChanged = parent != s_None && (m_Flags[parent] & s_WorldChanged);
+
+				if (!(m_Flags[i] & s_LocalDirty) && !parentChanged)
+				{
+					m_Flags[i] = 0;
+					continue;
+				}
+
+				HTMat4 local = HTMat4FromTRS({ m_Local[0][i], m_Local[1][i], m_Local[2][i] }, { m_Local[3][i], m_Local[4][i], m_Local[5][i], m_Local[6][i] },
+					{ m_Local[7][i], m_Local[8][i], m_Local[9][i] });
+
+				m_World[i] = parent != s_None ? HTMat4Multiply(local, m_World[parent]) : local;
+				m_Flags[i] = s_WorldChanged;
+			}
+		};
+
+		for (uint32_t level = 0; level < levels; level++)
+		{
+			uint32_t levelBegin = m_LevelBegin[level];
+			uint32_t levelCount = m_LevelBegin[level + 1] - levelBegin;
+
+			if (jobSystem && levelCount > s_TransformGrain)
+				jobSystem->ParallelFor(levelCount, s_TransformGrain, [&UpdateRange, levelBegin](uint32_t rangeBegin, uint32_t rangeEnd) { UpdateRange(levelBegin + rangeBegin, levelBegin + rangeEnd); });
+			else
+				UpdateRange(levelBegin, levelBegin + levelCount);
+		}
+
+		//What changed, in the order of the transforms
+		uint32_t chunkCount = (count + s_ChangedGrain - 1) / s_ChangedGrain;
+		if (m_ChunkChanged.size() < chunkCount)
+			m_ChunkChanged.resize(chunkCount);
+
+		auto CollectChanged = [this, count](uint32_t chunkBegin, uint32_t chunkEnd)
+		{
+			for (uint32_t chunk = chunkBegin; chunk < chunkEnd; chunk++)
+			{
+				std::vector<EntityHandle>& changed = m_ChunkChanged[chunk];
+				changed.clear();
+
+				uint32_t end = HTMin((chunk + 1) * s_ChangedGrain, count);
+				for (uint32_t i = chunk * s_ChangedGrain; i < end; i++)
+				{
+					if (m_Flags[i] & s_WorldChanged)
+					{
+						uint32_t entity = m_TransformEntity[i];
+						changed.push_back({ entity, m_Entities[entity].Generation });
+					}
+				}
+			}
+		};
+
+		if (jobSystem && chunkCount > 1)
+			jobSystem->ParallelFor(chunkCount, 1, CollectChanged);
+		else
+			CollectChanged(0, chunkCount);
+
+		m_Changed.clear();
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+			m_Changed.insert(m_Changed.end(), m_ChunkChanged[chunk].begin(), m_ChunkChanged[chunk].end());
+
+		m_UpdateStats.Transforms = count;
+		m_UpdateStats.Levels = levels;
+		m_UpdateStats.WorldChanged = (uint32_t)m_Changed.size();
+		m_UpdateStats.UpdateNs = HTNowNanoseconds() - begin;
+	}
+
+	// -------------- Components
+
+	uint32_t SceneStore::GetOrCreateArchetype(ComponentMask mask)
+	{
+		auto found = m_ArchetypeByMask.find(mask);
+		if (found != m_ArchetypeByMask.end())
+			return found->second;
+
+		//Every component has a slot, so a component registered later doesn't change the archetypes that exist
+		Archetype archetype;
+		archetype.Mask = mask;
+		archetype.Storage.resize(s_MaxComponents);
+		archetype.Columns.resize(s_MaxComponents, nullptr);
+
+		uint32_t index = (uint32_t)m_Archetypes.size();
+		m_Archetypes.push_back(std::move(archetype));
+		m_ArchetypeByMask[mask] = index;
+		return index;
+	}
+
+	void SceneStore::MoveToArchetype(uint32_t entityIndex, uint32_t newArchetype)
+	{
+		EntityRecord& record = m_Entities[entityIndex];
+		Archetype& source = m_Archetypes[record.Archetype];
+		Archetype& destination = m_Archetypes[newArchetype];
+
+		uint32_t sourceRow = record.Row;
+		uint32_t row = (uint32_t)destination.Entities.size();
+		destination.Entities.push_back(source.Entities[sourceRow]);
+
+		for (ComponentMask components = destination.Mask; components; components &= components - 1)
+		{
+			uint32_t component = HTLowestBit(components);
+			uint32_t size = m_Components[component].Size;
+
+			std::vector<uint8_t>& column = destination.Storage[component];
+			column.resize((size_t)(row + 1) * size);
+			destination.Columns[component] = column.data();
+
+			uint8_t* value = column.data() + (size_t)row * size;
+			if (source.Mask & (1ull << component))
+				memcpy(value, source.Columns[component] + (size_t)sourceRow * size, size);
+			else
+				memset(value, 0, size);
+		}
+
+		RemoveRow(record.Archetype, sourceRow);
+
+		record.Archetype = newArchetype;
+		record.Row = row;
+	}
+
+	void SceneStore::RemoveRow(uint32_t archetypeIndex, uint32_t row)
+	{
+		Archetype& archetype = m_Archetypes[archetypeIndex];
+		uint32_t last = (uint32_t)archetype.Entities.size() - 1;
+
+		//The last row takes the place of the removed one
+		if (row != last)
+		{
+			EntityHandle moved = archetype.Entities[last];
+			archetype.Entities[row] = moved;
+			m_Entities[moved.Index].Row = row;
+		}
+
+		archetype.Entities.pop_back();
+
+		for (ComponentMask components = archetype.Mask; components; components &= components - 1)
+		{
+			uint32_t component = HTLowestBit(components);
+			uint32_t size = m_Components[component].Size;
+			std::vector<uint8_t>& column = archetype.Storage[component];
+
+			if (row != last)
+				memcpy(column.data() + (size_t)row * size, column.data() + (size_t)last * size, size);
+
+			column.resize((size_t)last * size);
+		}
+	}
+
+	void* SceneStore::AddComponent(EntityHandle entity, ComponentId component)
+	{
+		D3D_ASSERT(component < m_Components.size(), "Unknown scene component!");
+
+		EntityRecord& record = GetRecord(entity);
+		ComponentMask mask = m_Archetypes[record.Archetype].Mask;
+		D3D_ASSERT(!(mask & (1ull << component)), "The entity already has the component!");
+
+		MoveToArchetype(entity.Index, GetOrCreateArchetype(mask | (1ull << component)));
+		return GetComponent(entity, component);
+	}
+
+	void SceneStore::RemoveComponent(EntityHandle entity, ComponentId component)
+	{
+		EntityRecord& record = GetRecord(entity);
+		ComponentMask mask = m_Archetypes[record.Archetype].Mask;
+		D3D_ASSERT(mask & (1ull << component), "The entity doesn't have the component!");
+
+		MoveToArchetype(entity.Index, GetOrCreateArchetype(mask & ~(1ull << component)));
+	}
+
+	bool SceneStore::HasComponent(EntityHandle entity, ComponentId component) const
+	{
+		return (m_Archetypes[GetRecord(entity).Archetype].Mask & (1ull << component)) != 0;
+	}
+
+	void* SceneStore::GetComponent(EntityHandle entity, ComponentId component)
+	{
+		const EntityRecord& record = GetRecord(entity);
+		Archetype& archetype = m_Archetypes[record.Archetype];
+
+		if (!(archetype.Mask & (1ull << component)))
+			return nullptr;
+
+		return archetype.Columns[component] + (size_t)record.Row * m_Components[component].Size;
+	}
+
+	SceneMemoryStats SceneStore::GetMemoryStats() const
+	{
+		SceneMemoryStats stats;
+		stats.Entities = m_AliveCount;
+		stats.Archetypes = (uint32_t)m_Archetypes.size();
+
+		stats.EntityBytes = m_Entities.capacity() * sizeof(EntityRecord) + m_FreeEntities.capacity() * sizeof(uint32_t);
+
+		for (const std::vector<float>& array : m_Local)
+			stats.TransformBytes += array.capacity() * sizeof(float);
+
+		stats.TransformBytes += m_World.capacity() * sizeof(HTMat4) + m_ParentTransform.capacity() * sizeof(uint32_t) +
+			m_TransformEntity.capacity() * sizeof(uint32_t) + m_Depth.capacity() * sizeof(uint16_t) + m_Flags.capacity() * sizeof(uint8_t);
+
+		for (const Archetype& archetype : m_Archetypes)
+		{
+			stats.ComponentBytes += archetype.Entities.capacity() * sizeof(EntityHandle);
+			for (const std::vector<uint8_t>& column : archetype.Storage)
+				stats.ComponentBytes += column.capacity();
+		}
+
+		return stats;
+	}
+}
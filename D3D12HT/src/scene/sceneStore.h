@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <util/vectorMath.h>
+
+namespace HT
+{
+	//A handle to an entity. The index of a destroyed entity is given to a new one with the next generation, so an old handle is never mistaken for it.
+	struct EntityHandle
+	{
+		static constexpr uint32_t s_Invalid = ~0u;
+
+		uint32_t Index = s_Invalid;
+		uint32_t Generation = 0;
+
+		inline bool IsValid() const { return Index != s_Invalid; }
+		inline bool operator==(const EntityHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+		inline bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+	};
+
+	using ComponentId = uint32_t;
+	using ComponentMask = uint64_t;
+
+	//The local transform of an entity, relative to its parent
+	struct SceneTransform
+	{
+		HTUtils::HTVec3 Position = { 0.0f, 0.0f, 0.0f };
+		HTUtils::HTQuat Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		HTUtils::HTVec3 Scale = { 1.0f, 1.0f, 1.0f };
+	};
+
+	struct SceneUpdateStats
+	{
+		uint32_t Transforms = 0;
+		uint32_t Levels = 0;       //Depth of the deepest entity + 1
+		uint32_t LocalDirty = 0;   //Set since the last update
+		uint32_t WorldChanged = 0; //The dirty ones and everything under them
+		bool Reordered = false;    //The hierarchy changed, the transforms were sorted again
+		uint64_t ReorderNs = 0;
+		uint64_t UpdateNs = 0;
+	};
+
+	//What is allocated (the capacity, not what is used)
+	struct SceneMemoryStats
+	{
+		uint32_t Entities = 0;
+		uint32_t Archetypes = 0;
+		uint64_t EntityBytes = 0;
+		uint64_t TransformBytes = 0;
+		uint64_t ComponentBytes = 0;
+
+		inline uint64_t GetTotalBytes() const { return EntityBytes + TransformBytes + ComponentBytes; }
+	};
+
+	//The rows of an archetype: Count entities and, for each component of the archetype, a column of Count values
+	struct SceneArchetypeView
+	{
+		uint32_t Count;
+		const EntityHandle* Entities;
+		ComponentMask Mask;
+
+		//[ComponentId], null for the components the archetype doesn't have
+		uint8_t* const* Columns;
+
+		template<typename T>
+		inline T* GetColumn(ComponentId component) const { return reinterpret_cast<T*>(Columns[component]); }
+	};
+
+	//The scene: entities, their hierarchy and their components.
+	//
+	//Components are plain data (trivially copyable, moved with memcpy) registered at runtime. The entities with the same set of components
+	//(an archetype) are the rows of one table, which has a contiguous column per component, so a system that reads two components of every
+	//entity that has them walks two arrays. Adding or removing a component moves the entity to the table of its new set.
+	//
+	//Every entity has a transform, they are not in the tables: the local transforms (as SoA arrays), the world matrices and the parents are
+	//sorted by depth in the hierarchy, so the parents of a depth are all done before it and each depth is updated in parallel.
+	//SetLocalTransform marks an entity dirty, UpdateTransforms computes the world matrices of the dirty entities and of everything under
+	//them, and nothing else. GetChangedEntities is what has to be uploaded again.
+	//Creating entities in hierarchy order keeps the sort, anything else (destroying, reparenting) sorts again on the next update.
+	//
+	//Not thread safe, except UpdateTransforms which uses the job system itself.
+	class SceneStore
+	{
+	public:
+		static constexpr uint32_t s_MaxComponents = 64;
+
+		//Transforms per job
+		static constexpr uint32_t s_TransformGrain = 2048;
+
+		SceneStore();
+
+		SceneStore(const SceneStore&) = delete;
+		SceneStore& operator=(const SceneStore&) = delete;
+
+		ComponentId RegisterComponent(const char* name, uint32_t size, uint32_t alignment);
+
+		template<typename T>
+		ComponentId RegisterComponent(const char* name)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Scene components are moved with memcpy!");
+			return RegisterComponent(name, (uint32_t)sizeof(T), (uint32_t)alignof(T));
+		}
+
+		inline const char* GetComponentName(ComponentId component) const { return m_Components[component].Name.c_str(); }
+
+		// -------------- Entities
+
+		//No parent = a root
+		EntityHandle Create(EntityHandle parent = {}, const SceneTransform& local = {});
+
+		//The children are destroyed too
+		void Destroy(EntityHandle entity);
+
+		bool IsAlive(EntityHandle entity) const;
+		inline uint32_t GetEntityCount() const { return m_AliveCount; }
+
+		//The world transform of the entity keeps following the new parent (its local transform is kept)
+		void SetParent(EntityHandle entity, EntityHandle parent);
+		EntityHandle GetParent(EntityHandle entity) const;
+
+		// -------------- Transforms
+
+		void SetLocalTransform(EntityHandle entity, const SceneTransform& local);
+		SceneTransform GetLocalTransform(EntityHandle entity) const;
+
+		//As of the last UpdateTransforms
+		const HTUtils::HTMat4& GetWorldMatrix(EntityHandle entity) const;
+
+		void UpdateTransforms(JobSystem* jobSystem = nullptr);
+
+		//The entities whose world matrix changed in the last UpdateTransforms, parents before children
+		inline const std::vector<EntityHandle>& GetChangedEntities() const { return m_Changed; }
+
+		inline const SceneUpdateStats& GetUpdateStats() const { return m_UpdateStats; }
+		SceneMemoryStats GetMemoryStats() const;
+
+		// -------------- Components
+
+		//The new component is zeroed
+		void* AddComponent(EntityHandle entity, ComponentId component);
+		void RemoveComponent(EntityHandle entity, ComponentId component);
+		bool HasComponent(EntityHandle entity, ComponentId component) const;
+
+		//Null if the entity doesn't have it. Valid until the entity (or another of its archetype) changes of archetype.
+		void* GetComponent(EntityHandle entity, ComponentId component);
+
+		template<typename T>
+		T& AddComponent(EntityHandle entity, ComponentId component, const T& value)
+		{
+			T* memory = reinterpret_cast<T*>(AddComponent(entity, component));
+			*memory = value;
+			return *memory;
+		}
+
+		template<typename T>
+		T* GetComponent(EntityHandle entity, ComponentId component) { return reinterpret_cast<T*>(GetComponent(entity, component)); }
+
+		//Calls function(const SceneArchetypeView&) for every archetype with all the components of mask (and maybe others)
+		template<typename TFunction>
+		void ForEachArchetype(ComponentMask mask, const TFunction& function)
+		{
+			for (Archetype& archetype : m_Archetypes)
+			{
+				if ((archetype.Mask & mask) != mask || archetype.Entities.empty())
+					continue;
+
+				function(archetype.GetView());
+			}
+		}
+
+	private:
+		static constexpr uint32_t s_None = ~0u;
+
+		//Transform flags
+		static constexpr uint8_t s_LocalDirty = 1;
+		static constexpr uint8_t s_WorldChanged = 2;
+
+		struct ComponentInfo
+		{
+			std::string Name;
+			uint32_t Size;
+			uint32_t Alignment;
+		};
+
+		struct Archetype
+		{
+			ComponentMask Mask = 0;
+			std::vector<EntityHandle> Entities;
+
+			//[ComponentId], empty for the components it doesn't have. Columns points at their data.
+			std::vector<std::vector<uint8_t>> Storage;
+			std::vector<uint8_t*> Columns;
+
+			SceneArchetypeView GetView();
+		};
+
+		//Cold, only touched by the structural changes
+		struct EntityRecord
+		{
+			uint32_t Generation = 0;
+			uint32_t Archetype = s_None; //None = free
+			uint32_t Row = 0;
+			uint32_t Transform = 0;
+
+			//Entity indices
+			uint32_t Parent = s_None;
+			uint32_t FirstChild = s_None;
+			uint32_t NextSibling = s_None;
+			uint32_t PreviousSibling = s_None;
+		};
+
+		const EntityRecord& GetRecord(EntityHandle entity) const;
+		EntityRecord& GetRecord(EntityHandle entity);
+
+		void LinkChild(uint32_t parent, uint32_t child);
+		void UnlinkChild(uint32_t child);
+
+		uint32_t GetOrCreateArchetype(ComponentMask mask);
+		void MoveToArchetype(uint32_t entityIndex, uint32_t newArchetype);
+		void RemoveRow(uint32_t archetypeIndex, uint32_t row);
+
+		uint32_t PushTransform(uint32_t entityIndex, uint32_t parentTransform, const SceneTransform& local);
+		void ResizeTransforms(uint32_t count);
+		void WriteLocal(uint32_t transform, const SceneTransform& local);
+		void SortTransforms();
+
+	private:
+		std::vector<ComponentInfo> m_Components;
+
+		std::vector<EntityRecord> m_Entities;
+		std::vector<uint32_t> m_FreeEntities;
+		uint32_t m_AliveCount = 0;
+
+		std::vector<Archetype> m_Archetypes;
+		std::unordered_map<ComponentMask, uint32_t> m_ArchetypeByMask;
+
+		//The transforms, by transform index (sorted by depth). The local transforms are in the layout of HTUtils::HTTransformSoA.
+		std::vector<float> m_Local[10];
+		std::vector<HTUtils::HTMat4> m_World;
+		std::vector<uint32_t> m_ParentTransform;
+		std::vector<uint32_t> m_TransformEntity;
+		std::vector<uint16_t> m_Depth;
+		std::vector<uint8_t> m_Flags;
+
+		//The transforms of depth d are [m_LevelBegin[d], m_LevelBegin[d + 1])
+		std::vector<uint32_t> m_LevelBegin;
+
+		//Destroyed entities and new parents leave the transforms out of order (or with holes) until the next update
+		bool m_NeedsSort = false;
+
+		std::vector<std::vector<EntityHandle>> m_ChunkChanged;
+		std::vector<EntityHandle> m_Changed;
+
+		//Set dirty since the last update
+		uint32_t m_DirtyCount = 0;
+
+		SceneUpdateStats m_UpdateStats;
+	};
+}
@@ -0,0 +1,257 @@
+#include "testFramework.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <renderer/commandCapture.h>
+#include <renderer/null/nullCaptureRecorder.h>
+#include <renderer/null/nullCommandList.h>
+#include <renderer/null/nullQueueBackend.h>
+#include <util/fileUtils.h>
+
+using namespace HT;
+
+namespace
+{
+	//The lists of a run, they are kept until the null queues executed them
+	struct RecordedLists
+	{
+		std::vector<std::unique_ptr<NullCommandAllocator>> Allocators;
+		std::vector<std::unique_ptr<NullCommandList>> CommandLists;
+
+		NullCommandList* Create(CommandQueueType type)
+		{
+			Allocators.push_back(std::make_unique<NullCommandAllocator>(type));
+			CommandLists.push_back(std::make_unique<NullCommandList>(type, Allocators.back().get()));
+			return CommandLists.back().get();
+		}
+	};
+
+	//A few frames like the renderer's: a compute list the direct queue waits for, then the direct list and the present.
+	//The constants of the draws walk forward and back, so their deltas in the capture go both ways.
+	void RecordFrame(CaptureQueueBackend& queues, RecordedLists& lists, uint32_t frame)
+	{
+		queues.BeginFrame();
+
+		NullCommandList* compute = lists.Create(CommandQueueType::Compute);
+		compute->SetRootSignature(0x100);
+		compute->SetPipelineState(0x2000 + frame);
+		compute->SetDescriptorTable(0, 0xD000000000ull + frame * 64);
+		compute->Dispatch(8 + frame, 4, 1);
+		compute->Close();
+
+		void* computeList = compute;
+		queues.ExecuteCommandLists(CommandQueueType::Compute, &computeList, 1);
+		uint64_t computeDone = queues.Signal(CommandQueueType::Compute);
+		queues.Wait(CommandQueueType::Direct, CommandQueueType::Compute, computeDone);
+
+		NullCommandList* direct = lists.Create(CommandQueueType::Direct);
+		const uint64_t backBuffer = 0x7000 + frame % 2;
+		ResourceBarrier toRenderTarget;
+		toRenderTarget.Resource = backBuffer;
+		toRenderTarget.Before = ResourceState::Present;
+		toRenderTarget.After = ResourceState::RenderTarget;
+
+		const float color[4] = { 0.1f, 0.2f, 0.3f * frame, 1.0f };
+		direct->ResourceBarriers(&toRenderTarget, 1);
+		direct->SetRootSignature(0x101);
+		direct->SetDescriptorHeaps(0xA0, 0xB0);
+		direct->SetRenderTarget(0xC00 + frame % 2);
+		direct->ClearRenderTarget(0xC00 + frame % 2, color);
+		direct->SetPipelineState(0x3000);
+
+		for (uint32_t draw = 0; draw < 5; draw++)
+		{
+			direct->SetConstantBuffer(1, 0xF00000000ull + ((draw * 7) % 5) * 256);
+			direct->Draw(3, 1, draw * 3, 0);
+		}
+
+		ResourceBarrier toPresent = toRenderTarget;
+		toPresent.Before = ResourceState::RenderTarget;
+		toPresent.After = ResourceState::Present;
+		direct->ResourceBarriers(&toPresent, 1);
+		direct->Close();
+
+		//An empty list is executed too
+		NullCommandList* empty = lists.Create(CommandQueueType::Direct);
+		empty->Close();
+
+		void* directLists[] = { direct, empty };
+		queues.ExecuteCommandLists(CommandQueueType::Direct, directLists, 2);
+		queues.Present(1, 0);
+		uint64_t frameDone = queues.Signal(CommandQueueType::Direct);
+		queues.EndFrame();
+
+		//Two frames in flight
+		if (frameDone > 2)
+			queues.GetFence(CommandQueueType::Direct)->WaitForValue(frameDone - 2);
+	}
+}
+
+HT_TEST(CommandCapture, ReplayRunsTheSameCommands)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "HTCommandCaptureTests_RoundTrip.htcap").string();
+	std::filesystem::remove(path);
+
+	NullQueueStats captured;
+	CommandCaptureStats written;
+	{
+		NullQueueBackend nullQueues;
+		NullCaptureListSource listSource;
+		CaptureQueueBackend queues(&nullQueues, &listSource);
+		RecordedLists lists;
+
+		//A frame before the capture: the values of the capture start after it, and the waits for it are not replayed
+		RecordFrame(queues, lists, 0);
+
+		CommandCaptureWriter writer;
+		writer.NameHandle(CaptureHandleKind::Resource, 0x7000, "BackBuffer0");
+		queues.SetWriter(&writer);
+
+		queues.Wait(CommandQueueType::Compute, CommandQueueType::Direct, 1);
+		for (uint32_t frame = 1; frame <= 4; frame++)
+			RecordFrame(queues, lists, frame);
+
+		queues.SetWriter(nullptr);
+		nullQueues.ExecuteAll();
+		captured = nullQueues.GetStats();
+		written = writer.GetStats();
+
+		std::string error;
+		HT_CHECK(writer.Save(path, error));
+	}
+
+	CommandCaptureReader capture;
+	std::string error;
+	HT_CHECK(capture.Load(path, error));
+	HT_CHECK_EQ(capture.GetHeader().FrameCount, 4u);
+	HT_CHECK_EQ(capture.GetHeader().FenceBase[(uint32_t)CommandQueueType::Direct], 1ull);
+	HT_CHECK_EQ(capture.GetHeader().FenceBase[(uint32_t)CommandQueueType::Compute], 1ull);
+	HT_CHECK_EQ(capture.GetHandleCount(), written.Handles);
+
+	//The name goes with the handle of the value it was given for
+	bool named = false;
+	for (uint32_t handle = 0; handle < capture.GetHandleCount(); handle++)
+	{
+		if (capture.GetHandle(handle).Kind == CaptureHandleKind::Resource && capture.GetHandle(handle).Value == 0x7000)
+			named = capture.GetHandleName(handle) == "BackBuffer0";
+	}
+	HT_CHECK(named);
+
+	NullQueueBackend replayQueues;
+	NullCommandPoolBackend replayPools;
+	NullCaptureRecorder recorder;
+	CaptureReplayStats replay;
+	HT_CHECK(ReplayCommandCapture(capture, &replayQueues, &replayPools, &recorder, replay, error));
+
+	HT_CHECK_EQ(replay.Frames, 4u);
+	HT_CHECK_EQ(replay.CommandLists, written.CommandLists);
+	HT_CHECK_EQ(replay.Commands, written.Commands);
+	HT_CHECK_EQ(replay.Submissions, written.Submissions);
+	HT_CHECK_EQ(replay.Signals, written.Signals);
+	HT_CHECK_EQ(replay.Waits, written.Waits);
+	HT_CHECK_EQ(replay.CPUWaits, written.CPUWaits);
+	HT_CHECK_EQ(replay.Presents, 4ull);
+
+	//The GPU wait on the first frame, and the CPU wait for it two frames later (the null GPU is lazy, it didn't run it yet)
+	HT_CHECK_EQ(replay.SkippedWaits, 2ull);
+	HT_CHECK_EQ(replay.FenceMismatches, 0ull);
+
+	//The frame before the capture is not in it, what the null GPU executed for the four captured frames is the same command for command
+	NullQueueStats replayed = replayQueues.GetStats();
+	HT_CHECK_EQ(replayed.ExecutedCommandLists, written.CommandLists);
+	HT_CHECK_EQ(replayed.ExecutedCommands, written.Commands);
+	HT_CHECK_EQ(replayed.Draws, captured.Draws - 5);
+	HT_CHECK_EQ(replayed.Dispatches, captured.Dispatches - 1);
+	HT_CHECK_EQ(replayed.Barriers, captured.Barriers - 2);
+
+	std::filesystem::remove(path);
+}
+
+HT_TEST(CommandCapture, SameChecksumAsTheCapturedRun)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "HTCommandCaptureTests_Checksum.htcap").string();
+	std::filesystem::remove(path);
+
+	//Captured from the first frame, so the null GPU of the run and of the replay execute exactly the same lists
+	uint64_t checksum = 0;
+	{
+		NullQueueBackend nullQueues;
+		NullCaptureListSource listSource;
+		CaptureQueueBackend queues(&nullQueues, &listSource);
+		RecordedLists lists;
+
+		CommandCaptureWriter writer;
+		queues.SetWriter(&writer);
+		for (uint32_t frame = 0; frame < 6; frame++)
+			RecordFrame(queues, lists, frame);
+		queues.SetWriter(nullptr);
+
+		nullQueues.ExecuteAll();
+		checksum = nullQueues.GetStats().Checksum;
+
+		std::string error;
+		HT_CHECK(writer.Save(path, error));
+	}
+
+	CommandCaptureReader capture;
+	std::string error;
+	HT_CHECK(capture.Load(path, error));
+
+	//Twice: the replay doesn't depend on anything but the capture
+	for (uint32_t run = 0; run < 2; run++)
+	{
+		NullQueueBackend replayQueues;
+		NullCommandPoolBackend replayPools;
+		NullCaptureRecorder recorder;
+		CaptureReplayStats replay;
+		HT_CHECK(ReplayCommandCapture(capture, &replayQueues, &replayPools, &recorder, replay, error));
+		HT_CHECK_EQ(replayQueues.GetStats().Checksum, checksum);
+	}
+
+	std::filesystem::remove(path);
+}
+
+HT_TEST(CommandCapture, TruncatedFilesAreRejected)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "HTCommandCaptureTests_Truncated.htcap").string();
+	std::filesystem::remove(path);
+	{
+		NullQueueBackend nullQueues;
+		NullCaptureListSource listSource;
+		CaptureQueueBackend queues(&nullQueues, &listSource);
+		RecordedLists lists;
+
+		CommandCaptureWriter writer;
+		queues.SetWriter(&writer);
+		RecordFrame(queues, lists, 0);
+		queues.SetWriter(nullptr);
+		nullQueues.ExecuteAll();
+
+		std::string error;
+		HT_CHECK(writer.Save(path, error));
+	}
+
+	std::vector<uint8_t> data;
+	HT_CHECK(HTUtils::HTReadFile(path, data));
+	std::filesystem::remove(path);
+
+	//The whole file is fine, a byte less and the tables at the end don't fit anymore
+	std::string error;
+	CommandCaptureReader whole;
+	HT_CHECK(whole.Parse(data, error));
+
+	for (size_t size : { (size_t)0, sizeof(CaptureFileHeader) - 1, sizeof(CaptureFileHeader), data.size() - 1 })
+	{
+		CommandCaptureReader truncated;
+		error.clear();
+		HT_CHECK(!truncated.Parse(std::vector<uint8_t>(data.begin(), data.begin() + size), error));
+		HT_CHECK(!error.empty());
+	}
+
+	//Not a capture at all
+	data[0] ^= 0xFF;
+	CommandCaptureReader wrongMagic;
+	HT_CHECK(!wrongMagic.Parse(data, error));
+}
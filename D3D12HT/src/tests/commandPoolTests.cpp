@@ -0,0 +1,97 @@
+#include "testFramework.h"
+
+#include <renderer/commandPool.h>
+#include <renderer/cpuFence.h>
+
+using namespace HT;
+
+HT_TEST(CommandPool, AllocatorsComeBackOnlyOnceTheFenceCompletes)
+{
+	CPUFence fence;
+	CPUCommandPoolBackend backend;
+	{
+		CommandPool pool(&backend, CommandQueueType::Direct, &fence);
+
+		PooledCommandList first = pool.Acquire();
+		HT_CHECK(first.IsValid());
+		HT_CHECK_EQ(first.Type, CommandQueueType::Direct);
+		pool.Release(first, fence.Signal());
+
+		//The list can be reused right away, the allocator can't: the "GPU" didn't reach the value yet
+		PooledCommandList second = pool.Acquire();
+		HT_CHECK(second.NativeCommandList == first.NativeCommandList);
+		HT_CHECK(second.NativeAllocator != first.NativeAllocator);
+		HT_CHECK_EQ(pool.GetStats().AllocatorCount, 2u);
+		HT_CHECK_EQ(backend.GetAllocatorResetCount(), 0ull);
+		pool.Release(second, fence.Signal());
+
+		fence.Complete(1);
+
+		//Reset before it is handed out again
+		PooledCommandList third = pool.Acquire();
+		HT_CHECK(third.NativeAllocator == first.NativeAllocator);
+		HT_CHECK_EQ(backend.GetAllocatorResetCount(), 1ull);
+		HT_CHECK_EQ(pool.GetStats().AllocatorCount, 2u);
+		HT_CHECK_EQ(pool.GetStats().RecycleCount, 1ull);
+		HT_CHECK_EQ(pool.GetStats().AllocatorsInUse, 2u);
+		pool.Release(third, fence.Signal());
+
+		HT_CHECK_EQ(pool.GetStats().PeakAllocatorsInUse, 2u);
+		HT_CHECK_EQ(backend.GetLiveAllocatorCount(), 2u);
+		HT_CHECK_EQ(backend.GetLiveCommandListCount(), 1u);
+
+		fence.CompleteAll();
+	}
+
+	HT_CHECK_EQ(backend.GetLiveAllocatorCount(), 0u);
+	HT_CHECK_EQ(backend.GetLiveCommandListCount(), 0u);
+}
+
+HT_TEST(CommandPool, AllocatorsAreRecycledInFenceOrder)
+{
+	CPUFence fence;
+	CPUCommandPoolBackend backend;
+	CommandPool pool(&backend, CommandQueueType::Compute, &fence);
+
+	PooledCommandList lists[3];
+	for (PooledCommandList& list : lists)
+		list = pool.Acquire();
+
+	//Threads may release out of order, the values 3, 1 and 2
+	uint64_t one = fence.Signal();
+	uint64_t two = fence.Signal();
+	uint64_t three = fence.Signal();
+	pool.Release(lists[0], three);
+	pool.Release(lists[1], one);
+	pool.Release(lists[2], two);
+
+	//Only what signaled 1 is done
+	fence.Complete(one);
+	PooledCommandList reused = pool.Acquire();
+	HT_CHECK(reused.NativeAllocator == lists[1].NativeAllocator);
+	HT_CHECK_EQ(pool.GetStats().RecycleCount, 1ull);
+
+	//Still waiting for 2, a new allocator is made
+	PooledCommandList fresh = pool.Acquire();
+	HT_CHECK_EQ(pool.GetStats().AllocatorCount, 4u);
+
+	fence.Complete(two);
+	PooledCommandList second = pool.Acquire();
+	HT_CHECK(second.NativeAllocator == lists[2].NativeAllocator);
+
+	fence.Complete(three);
+	PooledCommandList third = pool.Acquire();
+	HT_CHECK(third.NativeAllocator == lists[0].NativeAllocator);
+	HT_CHECK_EQ(pool.GetStats().RecycleCount, 3ull);
+	HT_CHECK_EQ(pool.GetStats().AllocatorCount, 4u);
+
+	//A list that was never submitted is released with 0, its allocator is free on the next Acquire
+	for (const PooledCommandList& list : { reused, fresh, second, third })
+		pool.Release(list, 0);
+
+	HT_CHECK_EQ(pool.GetStats().AllocatorsInUse, 4u);
+	PooledCommandList last = pool.Acquire();
+	HT_CHECK_EQ(pool.GetStats().AllocatorsInUse, 1u);
+	HT_CHECK_EQ(pool.GetStats().AllocatorCount, 4u);
+	pool.Release(last, 0);
+}
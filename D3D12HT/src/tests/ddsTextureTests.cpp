@@ -0,0 +1,127 @@
+#include "testFramework.h"
+
+#include <cstring>
+#include <vector>
+
+#include <renderer/ddsTexture.h>
+
+using namespace HT;
+
+namespace
+{
+	const uint32_t s_HeaderBytes = 4 + 124;
+	const uint32_t s_DX10HeaderBytes = 20;
+
+	//The fields as uint32 offsets in the file, the magic included
+	enum DDSField : uint32_t
+	{
+		Magic          = 0,
+		HeaderSize     = 1,
+		Flags          = 2,
+		Height         = 3,
+		Width          = 4,
+		MipMapCount    = 7,
+		PixelSize      = 19,
+		PixelFlags     = 20,
+		FourCC         = 21,
+		DX10Format     = 32,
+		DX10Dimension  = 33,
+		DX10MiscFlag   = 34,
+		DX10ArraySize  = 35,
+	};
+
+	struct DDSFile
+	{
+		std::vector<uint8_t> Bytes;
+
+		//A DX10 file, the texels are left to the test
+		DDSFile(TextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount = 1, uint32_t arraySize = 1)
+			: Bytes(s_HeaderBytes + s_DX10HeaderBytes, 0)
+		{
+			Set(Magic, 0x20534444);
+			Set(HeaderSize, 124);
+			Set(Flags, 0x20000);
+			Set(Height, height);
+			Set(Width, width);
+			Set(MipMapCount, mipCount);
+			Set(PixelSize, 32);
+			Set(PixelFlags, 0x4);
+			Set(FourCC, 0x30315844); //"DX10"
+			Set(DX10Format, (uint32_t)format);
+			Set(DX10Dimension, 3);
+			Set(DX10ArraySize, arraySize);
+		}
+
+		void Set(DDSField field, uint32_t value)
+		{
+			memcpy(Bytes.data() + field * sizeof(uint32_t), &value, sizeof(value));
+		}
+
+		bool Parse(DDSTexture& outTexture, std::string& outError) const
+		{
+			return ParseDDS(Bytes.data(), Bytes.size(), outTexture, outError);
+		}
+	};
+}
+
+HT_TEST(DDSTexture, MipsAndSlicesAreLaidOutInTheFile)
+{
+	//8x8 BC1 with 3 mips (2x2, 1x1 and 1x1 blocks of 8 bytes), 2 slices
+	DDSFile file(TextureFormat::BC1_UNorm, 8, 8, 3, 2);
+	file.Bytes.resize(file.Bytes.size() + 2 * (32 + 8 + 8));
+
+	DDSTexture texture;
+	std::string error;
+	HT_CHECK(file.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string());
+
+	HT_CHECK_EQ(texture.MipCount, 3u);
+	HT_CHECK_EQ(texture.ArraySize, 2u);
+	HT_CHECK_EQ(texture.SliceSize, 48ull);
+	HT_CHECK_EQ(texture.TexelDataSize, 96ull);
+	HT_CHECK(texture.TexelData == file.Bytes.data() + s_HeaderBytes + s_DX10HeaderBytes);
+
+	DDSSubresource subresource = texture.GetSubresource(1, 1);
+	HT_CHECK_EQ(subresource.Offset, 48ull + 32);
+	HT_CHECK_EQ(subresource.Width, 4u);
+	HT_CHECK_EQ(subresource.RowBytes, 8u);
+	HT_CHECK_EQ(subresource.RowCount, 1u);
+
+	//One byte less than the texels
+	file.Bytes.pop_back();
+	HT_CHECK(!file.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("The file is smaller than its texels"));
+}
+
+HT_TEST(DDSTexture, SizesOverTheLimitsAreRefused)
+{
+	DDSTexture texture;
+	std::string error;
+
+	//A 128 byte file saying 2^30 x 2^30: the size of its texels must not wrap to something that fits
+	DDSFile huge(TextureFormat::RGBA32_Float, 1u << 30, 1u << 30);
+	huge.Bytes.resize(s_HeaderBytes);
+	huge.Set(FourCC, 116); //RGBA32_Float without the DX10 header
+	HT_CHECK(!huge.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("Invalid texture size or mip count"));
+
+	DDSFile wide(TextureFormat::R8_UNorm, DDSTexture::s_MaxDimension + 1, 1);
+	HT_CHECK(!wide.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("Invalid texture size or mip count"));
+
+	//Fits before the * 6 of the cube, not after
+	DDSFile cubes(TextureFormat::R8_UNorm, 1, 1, 1, DDSTexture::s_MaxArraySize / 6 + 1);
+	cubes.Set(DX10MiscFlag, 0x4);
+	HT_CHECK(!cubes.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("Invalid array size"));
+
+	//Would wrap to 0 slices in 32 bits
+	DDSFile wrapping(TextureFormat::R8_UNorm, 1, 1, 1, 0x80000000u);
+	HT_CHECK(!wrapping.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("Invalid array size"));
+
+	//The limits themselves are fine, only the file is too small
+	DDSFile biggest(TextureFormat::RGBA32_Float, DDSTexture::s_MaxDimension, DDSTexture::s_MaxDimension, 15, DDSTexture::s_MaxArraySize);
+	HT_CHECK(!biggest.Parse(texture, error));
+	HT_CHECK_EQ(error, std::string("The file is smaller than its texels"));
+}
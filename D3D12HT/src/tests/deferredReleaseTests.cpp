@@ -0,0 +1,210 @@
+#include "testFramework.h"
+
+#include <utility>
+#include <vector>
+
+#include <renderer/comRef.h>
+#include <renderer/cpuFence.h>
+#include <renderer/deferredReleaseQueue.h>
+
+using namespace HT;
+
+namespace
+{
+	//Ref counted like a D3D12 object. The live count is how we see leaks and double releases.
+	class FakeObject
+	{
+	public:
+		FakeObject() { s_Live++; }
+
+		uint32_t AddRef() { return ++m_RefCount; }
+
+		uint32_t Release()
+		{
+			uint32_t count = --m_RefCount;
+			if (count == 0)
+			{
+				s_Live--;
+				delete this;
+			}
+			return count;
+		}
+
+		inline uint32_t GetRefCount() const { return m_RefCount; }
+
+		static int32_t s_Live;
+
+	private:
+		~FakeObject() = default;
+
+		uint32_t m_RefCount = 1;
+	};
+
+	int32_t FakeObject::s_Live = 0;
+}
+
+HT_TEST(ComRef, OwnsOneReference)
+{
+	{
+		ComRef<FakeObject> first(new FakeObject());
+		HT_CHECK_EQ(first->GetRefCount(), 1u);
+
+		//A copy is one more reference, a move is the same one
+		ComRef<FakeObject> copy = first;
+		HT_CHECK_EQ(first->GetRefCount(), 2u);
+
+		ComRef<FakeObject> moved = std::move(copy);
+		HT_CHECK(copy.Get() == nullptr);
+		HT_CHECK_EQ(first->GetRefCount(), 2u);
+
+		//Assigning to itself doesn't release it
+		moved = moved;
+		moved = std::move(moved);
+		HT_CHECK(moved.Get() == first.Get());
+		HT_CHECK_EQ(first->GetRefCount(), 2u);
+
+		moved.Reset();
+		HT_CHECK_EQ(first->GetRefCount(), 1u);
+
+		//Assigning releases what it had
+		ComRef<FakeObject> second(new FakeObject());
+		second = first;
+		HT_CHECK_EQ(FakeObject::s_Live, 1);
+		HT_CHECK_EQ(first->GetRefCount(), 2u);
+
+		//Attach takes a reference we already have, ReleaseAndGetAddressOf is what the Create functions fill
+		second.Attach(new FakeObject());
+		HT_CHECK_EQ(first->GetRefCount(), 1u);
+		*second.ReleaseAndGetAddressOf() = new FakeObject();
+		HT_CHECK_EQ(FakeObject::s_Live, 2);
+	}
+
+	HT_CHECK_EQ(FakeObject::s_Live, 0);
+}
+
+HT_TEST(DeferredReleaseQueue, ObjectsLiveUntilTheirFenceValue)
+{
+	//The "GPU" gets to a value when the CPU waits for it
+	CPUFence fence;
+	fence.SetWaitHandler([](CPUFence& waitedFence, uint64_t value) { waitedFence.Complete(value); });
+	DeferredReleaseQueue queue(&fence);
+
+	//Used by the frame being recorded, which will be signaled with 1
+	ComRef<FakeObject> first(new FakeObject());
+	queue.Release(first);
+	HT_CHECK(first.Get() == nullptr);
+	uint64_t frame1 = fence.Signal();
+
+	ComRef<FakeObject> second(new FakeObject());
+	ComRef<FakeObject> kept = second;
+	queue.Release(second);
+	fence.Signal();
+
+	queue.Release(new FakeObject(), 5);
+
+	HT_CHECK_EQ(queue.Collect(), 0u);
+	HT_CHECK_EQ(FakeObject::s_Live, 3);
+
+	fence.Complete(frame1);
+	HT_CHECK_EQ(queue.Collect(), 1u);
+	HT_CHECK_EQ(FakeObject::s_Live, 2);
+
+	//The queue only drops its reference, whoever still has one keeps the object
+	fence.Complete(2);
+	HT_CHECK_EQ(queue.Collect(), 1u);
+	HT_CHECK_EQ(FakeObject::s_Live, 2);
+	HT_CHECK_EQ(kept->GetRefCount(), 1u);
+	kept.Reset();
+
+	HT_CHECK_EQ(queue.GetStats().Pending, 1u);
+	HT_CHECK_EQ(queue.GetStats().PeakPending, 3u);
+
+	//A null object is nothing to release
+	FakeObject* none = nullptr;
+	queue.Release(none);
+	HT_CHECK_EQ(queue.GetStats().Enqueued, 3ull);
+
+	//5 was never signaled, ReleaseAll signals up to it and waits
+	queue.ReleaseAll();
+	HT_CHECK_EQ(FakeObject::s_Live, 0);
+	HT_CHECK_EQ(fence.GetLastSignaledValue(), 5ull);
+	HT_CHECK_EQ(fence.GetWaitCount(), 1ull);
+
+	DeferredReleaseStats stats = queue.GetStats();
+	HT_CHECK_EQ(stats.Pending, 0u);
+	HT_CHECK_EQ(stats.Released, stats.Enqueued);
+}
+
+HT_TEST(DeferredReleaseQueue, ValuesNeverGoBackwards)
+{
+	CPUFence fence;
+	DeferredReleaseQueue queue(&fence);
+
+	//Released at 4, then something at 2: it is held until 4 too
+	queue.Release(new FakeObject(), 4);
+	queue.Release(new FakeObject(), 2);
+
+	while (fence.GetLastSignaledValue() < 4)
+		fence.Signal();
+
+	fence.Complete(3);
+	HT_CHECK_EQ(queue.Collect(), 0u);
+	HT_CHECK_EQ(FakeObject::s_Live, 2);
+
+	fence.Complete(4);
+	HT_CHECK_EQ(queue.Collect(), 2u);
+	HT_CHECK_EQ(FakeObject::s_Live, 0);
+}
+
+//Frames in flight with objects retired every frame and a "GPU" a few frames behind. Nothing is released early and nothing leaks.
+HT_TEST(DeferredReleaseQueue, FramesInFlight)
+{
+	const uint32_t framesInFlight = 3;
+
+	CPUFence fence;
+	fence.SetWaitHandler([](CPUFence& waitedFence, uint64_t value) { waitedFence.Complete(value); });
+	DeferredReleaseQueue queue(&fence);
+
+	//The objects of each frame, still referenced by the "GPU" while the frame is in flight
+	std::vector<std::vector<ComRef<FakeObject>>> gpuReferences;
+	uint32_t releasedEarly = 0;
+
+	for (uint32_t frame = 0; frame < 100; frame++)
+	{
+		uint64_t frameValue = fence.GetLastSignaledValue() + 1;
+		if (frameValue > framesInFlight)
+		{
+			uint64_t completed = frameValue - framesInFlight;
+			fence.Complete(completed);
+
+			//The GPU is done with that frame, it lets go of its references
+			gpuReferences[completed - 1].clear();
+		}
+
+		queue.Collect();
+
+		//Every object the "GPU" still uses has the queue reference too
+		for (const auto& references : gpuReferences)
+		{
+			for (const ComRef<FakeObject>& object : references)
+				releasedEarly += object->GetRefCount() < 2;
+		}
+
+		gpuReferences.emplace_back();
+		for (uint32_t i = 0; i < frame % 4; i++)
+		{
+			ComRef<FakeObject> object(new FakeObject());
+			gpuReferences.back().push_back(object);
+			queue.Release(object);
+		}
+
+		HT_CHECK_EQ(fence.Signal(), frameValue);
+	}
+
+	HT_CHECK_EQ(releasedEarly, 0u);
+
+	queue.ReleaseAll();
+	gpuReferences.clear();
+	HT_CHECK_EQ(FakeObject::s_Live, 0);
+	HT_CHECK_EQ(queue.GetStats().Released, queue.GetStats().Enqueued);
+}
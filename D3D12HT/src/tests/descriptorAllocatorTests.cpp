@@ -0,0 +1,147 @@
+#include "testFramework.h"
+
+#include <renderer/cpuFence.h>
+#include <renderer/descriptorAllocator.h>
+
+using namespace HT;
+
+HT_TEST(DescriptorAllocator, NewPageWhenThePagesAreFull)
+{
+	CPUDescriptorHeapBackend backend(32);
+	{
+		DescriptorAllocator allocator(&backend, DescriptorHeapType::RTV, 4);
+
+		DescriptorRange first = allocator.Allocate(3);
+		DescriptorRange second = allocator.Allocate(3);
+
+		HT_CHECK_EQ(first.PageIndex, 0u);
+		HT_CHECK_EQ(second.PageIndex, 1u);
+		HT_CHECK_EQ(allocator.GetStats().PageCount, 2u);
+
+		//The hole left in the first page is still used
+		DescriptorRange third = allocator.Allocate(1);
+		HT_CHECK_EQ(third.PageIndex, 0u);
+		HT_CHECK_EQ(third.Offset, 3u);
+		HT_CHECK_EQ(third.Base.CPU, first.Base.CPU + 3 * 32);
+		HT_CHECK(!third.Base.IsShaderVisible());
+
+		//Bigger than a page, it gets a page of its own
+		DescriptorRange big = allocator.Allocate(10);
+		HT_CHECK_EQ(big.PageIndex, 2u);
+		HT_CHECK_EQ(big.Offset, 0u);
+		HT_CHECK_EQ(allocator.GetStats().PageCount, 3u);
+		HT_CHECK_EQ(allocator.GetStats().AllocatedDescriptors, 17u);
+		HT_CHECK_EQ(backend.GetLiveHeapCount(), 3u);
+
+		//The pages have their own address space
+		HT_CHECK(second.Base.CPU >= first.Base.CPU + 4 * 32);
+
+		allocator.Free(first);
+		allocator.Free(second);
+		allocator.Free(third);
+		allocator.Free(big);
+
+		HT_CHECK(!first.IsValid());
+		HT_CHECK_EQ(allocator.GetStats().AllocatedDescriptors, 0u);
+		HT_CHECK_EQ(allocator.GetStats().FreeCount, 4ull);
+	}
+
+	HT_CHECK_EQ(backend.GetLiveHeapCount(), 0u);
+}
+
+HT_TEST(DescriptorAllocator, FreedRangesAreMerged)
+{
+	CPUDescriptorHeapBackend backend;
+	DescriptorAllocator allocator(&backend, DescriptorHeapType::CBV_SRV_UAV, 8);
+
+	DescriptorRange ranges[4];
+	for (DescriptorRange& range : ranges)
+		range = allocator.Allocate(2);
+
+	//Free the middle ones first, then the ends: the page must be one block again, or 8 contiguous descriptors wouldn't fit
+	allocator.Free(ranges[1]);
+	allocator.Free(ranges[2]);
+	allocator.Free(ranges[0]);
+	allocator.Free(ranges[3]);
+
+	DescriptorRange whole = allocator.Allocate(8);
+	HT_CHECK_EQ(whole.PageIndex, 0u);
+	HT_CHECK_EQ(whole.Offset, 0u);
+	HT_CHECK_EQ(allocator.GetStats().PageCount, 1u);
+
+	allocator.Free(whole);
+
+	//An invalid range is ignored
+	DescriptorRange invalid;
+	allocator.Free(invalid);
+	HT_CHECK_EQ(allocator.GetStats().FreeCount, 5ull);
+}
+
+HT_TEST(DescriptorAllocator, DoubleFreeAsserts)
+{
+	CPUDescriptorHeapBackend backend;
+	DescriptorAllocator allocator(&backend, DescriptorHeapType::CBV_SRV_UAV, 8);
+
+	DescriptorRange first = allocator.Allocate(2);
+	DescriptorRange second = allocator.Allocate(2);
+	allocator.Allocate(4);
+
+	//The range is a free block of its own now
+	DescriptorRange secondCopy = second;
+	allocator.Free(second);
+	HT_CHECK_ASSERT(allocator.Free(secondCopy));
+
+	//first and second were merged in one block that begins before the range
+	allocator.Free(first);
+	HT_CHECK_ASSERT(allocator.Free(secondCopy));
+
+	//The frees that asserted ran in another process, the allocator is untouched
+	DescriptorRange again = allocator.Allocate(4);
+	HT_CHECK_EQ(again.Offset, 0u);
+}
+
+HT_TEST(TransientDescriptorRing, TablesMergeContiguousSources)
+{
+	CPUDescriptorHeapBackend backend(32);
+	DescriptorAllocator allocator(&backend, DescriptorHeapType::CBV_SRV_UAV, 64);
+	TransientDescriptorRing ring(&backend, DescriptorHeapType::CBV_SRV_UAV, 16);
+
+	DescriptorRange a = allocator.Allocate(2);
+	DescriptorRange b = allocator.Allocate(3);
+	allocator.Allocate(1);
+	DescriptorRange c = allocator.Allocate(1);
+
+	//a and b are next to each other, c is not
+	DescriptorRange sources[] = { a, b, c };
+	DescriptorRange table = ring.CopyToTable(sources, 3);
+
+	HT_CHECK(table.IsValid());
+	HT_CHECK_EQ(table.Count, 6u);
+	HT_CHECK(table.Base.IsShaderVisible());
+	HT_CHECK_EQ(table.At(5).GPU, table.Base.GPU + 5 * 32);
+	HT_CHECK_EQ(backend.GetCopyCallCount(), 2ull);
+	HT_CHECK_EQ(backend.GetCopiedDescriptorCount(), 6ull);
+}
+
+HT_TEST(TransientDescriptorRing, TablesAreRetiredByTheFence)
+{
+	CPUFence fence;
+	CPUDescriptorHeapBackend backend;
+	TransientDescriptorRing ring(&backend, DescriptorHeapType::Sampler, 16);
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK(ring.Allocate(10).IsValid());
+	ring.EndFrame(fence.Signal());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK(ring.Allocate(6).IsValid());
+	HT_CHECK(!ring.Allocate(1).IsValid());
+	ring.EndFrame(fence.Signal());
+
+	fence.Complete(1);
+	ring.BeginFrame(fence.GetCompletedValue());
+
+	DescriptorRange reused = ring.Allocate(10);
+	HT_CHECK(reused.IsValid());
+	HT_CHECK_EQ(reused.Offset, 0u);
+}
@@ -0,0 +1,181 @@
+#include "testFramework.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <core/jobSystem.h>
+#include <core/radixSort.h>
+#include <renderer/drawList.h>
+
+using namespace HT;
+
+namespace
+{
+	//Lots of equal keys, so a sort that isn't stable shows it. The value is where the key was.
+	void MakeKeys(uint32_t count, uint32_t seed, std::vector<uint64_t>& outKeys, std::vector<uint32_t>& outValues)
+	{
+		outKeys.resize(count);
+		outValues.resize(count);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			outKeys[i] = ((uint64_t)(seed >> 24) << 40) | ((uint64_t)(seed >> 28) << 3) | 0x5000000000000000ull;
+			outValues[i] = i;
+		}
+	}
+
+	//Sorted by key, and the values of equal keys in the order they came
+	bool IsStableSorted(const std::vector<uint64_t>& keys, const std::vector<uint32_t>& values)
+	{
+		for (size_t i = 1; i < keys.size(); i++)
+		{
+			if (keys[i - 1] > keys[i] || (keys[i - 1] == keys[i] && values[i - 1] > values[i]))
+				return false;
+		}
+		return true;
+	}
+
+	//Writes down what RecordDrawList sets
+	struct RecordingSink
+	{
+		std::vector<std::string> Calls;
+
+		void SetRootSignature(uint32_t rootSignature) { Calls.push_back("RootSignature " + std::to_string(rootSignature)); }
+		void SetPipeline(uint32_t pipeline)           { Calls.push_back("Pipeline " + std::to_string(pipeline)); }
+		void SetMaterial(uint32_t material)           { Calls.push_back("Material " + std::to_string(material)); }
+		void SetConstants(uint64_t constants)         { Calls.push_back("Constants " + std::to_string(constants)); }
+		void Draw(uint32_t drawIndex, const DrawPacket&) { Calls.push_back("Draw " + std::to_string(drawIndex)); }
+	};
+
+	DrawPacket MakeDraw(uint8_t pass, uint8_t rootSignature, uint16_t pipeline, uint16_t material, float depth, uint64_t constants = 0)
+	{
+		DrawPacket draw;
+		draw.Pass = pass;
+		draw.RootSignature = rootSignature;
+		draw.Pipeline = pipeline;
+		draw.Material = material;
+		draw.Depth = depth;
+		draw.Constants = constants;
+		return draw;
+	}
+}
+
+HT_TEST(RadixSorter, StableAndInKeyOrder)
+{
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	MakeKeys(5000, 3, keys, values);
+
+	std::vector<uint64_t> expectedKeys = keys;
+	std::stable_sort(expectedKeys.begin(), expectedKeys.end());
+
+	RadixSorter sorter;
+	sorter.Sort(keys.data(), values.data(), (uint32_t)keys.size());
+
+	HT_CHECK(keys == expectedKeys);
+	HT_CHECK(IsStableSorted(keys, values));
+	HT_CHECK_EQ(sorter.GetLastStats().Chunks, 1u);
+
+	//Only the digits that differ are sorted: the byte with bits 3-6 and the byte of bits 40-47. The others are the same in every key.
+	HT_CHECK_EQ(sorter.GetLastStats().Passes, 2u);
+	HT_CHECK_EQ(sorter.GetLastStats().SkippedPasses, 6u);
+
+	//Sorting again what is already sorted changes nothing
+	std::vector<uint32_t> sortedValues = values;
+	sorter.Sort(keys.data(), values.data(), (uint32_t)keys.size());
+	HT_CHECK(values == sortedValues);
+
+	//Nothing and one key
+	sorter.Sort(nullptr, nullptr, 0);
+	uint64_t oneKey = 42;
+	uint32_t oneValue = 7;
+	sorter.Sort(&oneKey, &oneValue, 1);
+	HT_CHECK_EQ(oneKey, 42ull);
+	HT_CHECK_EQ(oneValue, 7u);
+}
+
+HT_TEST(RadixSorter, ParallelChunksStayStable)
+{
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	MakeKeys(RadixSorter::s_MinParallelCount * 6 + 123, 11, keys, values);
+
+	std::vector<uint64_t> serialKeys = keys;
+	std::vector<uint32_t> serialValues = values;
+	RadixSorter serial;
+	serial.Sort(serialKeys.data(), serialValues.data(), (uint32_t)serialKeys.size());
+
+	JobSystem jobSystem(3);
+	RadixSorter parallel;
+	parallel.Sort(keys.data(), values.data(), (uint32_t)keys.size(), &jobSystem);
+
+	HT_CHECK(parallel.GetLastStats().Chunks > 1);
+	HT_CHECK(IsStableSorted(keys, values));
+	HT_CHECK(keys == serialKeys);
+	HT_CHECK(values == serialValues);
+}
+
+HT_TEST(DrawList, KeysOrderPassesStateAndDepth)
+{
+	DrawList list;
+	list.SetPassOrder(1, DrawSortOrder::BackToFront);
+
+	//Pass 0 is opaque, pass 1 transparent
+	list.Add(MakeDraw(1, 0, 0, 0, 5.0f));  //0
+	list.Add(MakeDraw(0, 1, 2, 0, 3.0f));  //1
+	list.Add(MakeDraw(0, 1, 1, 0, 9.0f));  //2
+	list.Add(MakeDraw(0, 1, 1, 0, 2.0f));  //3
+	list.Add(MakeDraw(1, 3, 0, 0, 20.0f)); //4
+	list.Add(MakeDraw(0, 0, 7, 0, -4.0f)); //5, a negative depth is 0
+	list.Add(MakeDraw(1, 0, 0, 0, 5.0f));  //6, same key as 0
+	list.Sort();
+
+	std::vector<uint32_t> order;
+	for (uint32_t position = 0; position < list.GetCount(); position++)
+		order.push_back(list.GetSortedIndex(position));
+
+	//Opaque: root signature, pipeline, then the nearest first. Transparent: the farthest first, then the state, and equal keys keep their order.
+	HT_CHECK(order == std::vector<uint32_t>({ 5, 3, 2, 1, 4, 0, 6 }));
+
+	uint32_t begin, end;
+	list.GetPassRange(0, begin, end);
+	HT_CHECK_EQ(begin, 0u);
+	HT_CHECK_EQ(end, 4u);
+	list.GetPassRange(1, begin, end);
+	HT_CHECK_EQ(begin, 4u);
+	HT_CHECK_EQ(end, 7u);
+	list.GetPassRange(2, begin, end);
+	HT_CHECK_EQ(begin, end);
+
+	HT_CHECK_EQ(DrawSortKey::QuantizeDepth(-4.0f), 0u);
+	HT_CHECK(DrawSortKey::QuantizeDepth(2.0f) < DrawSortKey::QuantizeDepth(2.5f));
+	HT_CHECK_EQ(DrawSortKey::GetPass(list.GetSortedKey(4)), 1u);
+}
+
+HT_TEST(DrawList, RecordingSkipsTheStateAlreadySet)
+{
+	DrawList list;
+	list.Add(MakeDraw(0, 1, 4, 2, 1.0f, 100));
+	list.Add(MakeDraw(0, 1, 4, 2, 2.0f, 100));
+	list.Add(MakeDraw(0, 1, 4, 3, 3.0f, 200));
+	list.Add(MakeDraw(0, 2, 4, 3, 1.0f, 200));
+	list.Sort();
+
+	RecordingSink sink;
+	DrawRecordStats stats = RecordDrawList(list, 0, list.GetCount(), sink);
+
+	//A new root signature clears the material and the constants, the pipeline stays
+	HT_CHECK(sink.Calls == std::vector<std::string>(
+	{
+		"RootSignature 1", "Pipeline 4", "Material 2", "Constants 100", "Draw 0",
+		"Draw 1",
+		"Material 3", "Constants 200", "Draw 2",
+		"RootSignature 2", "Material 3", "Constants 200", "Draw 3"
+	}));
+
+	HT_CHECK_EQ(stats.Draws, 4u);
+	HT_CHECK_EQ(stats.GetStateChanges(), 9u);
+	HT_CHECK_EQ(stats.SkippedChanges, 4u * 4 - 9);
+}
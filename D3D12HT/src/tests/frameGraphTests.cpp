@@ -0,0 +1,153 @@
+#include "testFramework.h"
+
+#include <vector>
+
+#include <renderer/frameGraph.h>
+
+using namespace HT;
+
+namespace
+{
+	const uint64_t s_MB = 1024 * 1024;
+
+	//A -> B -> C -> back buffer, each resource is only alive for two passes. C can take the memory of A.
+	struct ChainGraph
+	{
+		FrameGraph Graph;
+		FrameGraphHandle A, B, C, BackBuffer;
+
+		//NeedsInitialization of A, B and C, per pass
+		std::vector<std::vector<bool>> Initialize;
+
+		ChainGraph()
+		{
+			BackBuffer = Graph.Import("BackBuffer", 1, ResourceState::Present);
+
+			auto Record = [this](FrameGraphPassContext& context)
+			{
+				Initialize.push_back({ context.NeedsInitialization(A), context.NeedsInitialization(B), context.NeedsInitialization(C) });
+			};
+
+			Graph.AddPass("WriteA", [this](FrameGraph::PassBuilder& builder)
+			{
+				A = builder.Write(builder.CreateTransient("A", { s_MB }), ResourceState::RenderTarget);
+			}, Record);
+
+			Graph.AddPass("WriteB", [this](FrameGraph::PassBuilder& builder)
+			{
+				builder.Read(A, ResourceState::PixelShaderResource);
+				B = builder.Write(builder.CreateTransient("B", { s_MB }), ResourceState::RenderTarget);
+			}, Record);
+
+			Graph.AddPass("WriteC", [this](FrameGraph::PassBuilder& builder)
+			{
+				builder.Read(B, ResourceState::PixelShaderResource);
+				C = builder.Write(builder.CreateTransient("C", { s_MB }), ResourceState::RenderTarget);
+			}, Record);
+
+			Graph.AddPass("Composite", [this](FrameGraph::PassBuilder& builder)
+			{
+				builder.Read(C, ResourceState::PixelShaderResource);
+				BackBuffer = builder.Write(BackBuffer, ResourceState::RenderTarget);
+			}, Record);
+
+			Graph.MarkOutput(BackBuffer);
+			Graph.Compile();
+
+			Graph.SetPhysical(A, 100);
+			Graph.SetPhysical(B, 101);
+			Graph.SetPhysical(C, 102);
+		}
+	};
+}
+
+HT_TEST(FrameGraph, TransientsWithDisjointLifetimesShareMemory)
+{
+	ChainGraph chain;
+	const FrameGraph& graph = chain.Graph;
+
+	HT_CHECK_EQ(graph.GetHeapSizes().size(), (size_t)1);
+	HT_CHECK_EQ(graph.GetHeapSizes()[0], 2 * s_MB);
+	HT_CHECK_EQ(graph.GetStats().TransientBytesWithoutAliasing, 3 * s_MB);
+
+	HT_CHECK_EQ(graph.GetResource(chain.C).HeapOffset, graph.GetResource(chain.A).HeapOffset);
+	HT_CHECK(graph.GetResource(chain.B).HeapOffset != graph.GetResource(chain.A).HeapOffset);
+
+	HT_CHECK(!graph.GetResource(chain.A).Aliases);
+	HT_CHECK(!graph.GetResource(chain.B).Aliases);
+	HT_CHECK(graph.GetResource(chain.C).Aliases);
+}
+
+HT_TEST(FrameGraph, AliasingBarrierBeforeTheFirstUse)
+{
+	ChainGraph chain;
+
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::Present);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	std::vector<std::vector<ResourceBarrier>> batches;
+	chain.Graph.Execute(tracker, [&batches](const std::vector<ResourceBarrier>& barriers) { batches.push_back(barriers); });
+
+	HT_CHECK_EQ(batches.size(), (size_t)4);
+	if (batches.size() != 4)
+		return;
+
+	//Only C takes memory that was used before, its aliasing barrier comes before its transition
+	for (uint32_t pass = 0; pass < 4; pass++)
+	{
+		for (const ResourceBarrier& barrier : batches[pass])
+			HT_CHECK(barrier.Type != BarrierType::Aliasing || pass == 2);
+	}
+
+	const std::vector<ResourceBarrier>& writeC = batches[2];
+	HT_CHECK_EQ(writeC.size(), (size_t)3);
+	if (writeC.size() == 3)
+	{
+		HT_CHECK_EQ(writeC[0].Type, BarrierType::Aliasing);
+		HT_CHECK_EQ(writeC[0].Resource, 102ull);
+		HT_CHECK_EQ(writeC[0].Flags, BarrierFlags::None);
+
+		HT_CHECK_EQ(writeC[1].Resource, 101ull);
+		HT_CHECK_EQ(writeC[1].After, ResourceState::PixelShaderResource);
+
+		HT_CHECK_EQ(writeC[2].Type, BarrierType::Transition);
+		HT_CHECK_EQ(writeC[2].Resource, 102ull);
+		HT_CHECK_EQ(writeC[2].After, ResourceState::RenderTarget);
+	}
+
+	//And the pass that uses it first is told to initialize it
+	const std::vector<std::vector<bool>> expected = { { false, false, false }, { false, false, false }, { false, false, true }, { false, false, false } };
+	HT_CHECK(chain.Initialize == expected);
+}
+
+HT_TEST(FrameGraph, UnusedPassesAreCulled)
+{
+	FrameGraph graph;
+	FrameGraphHandle backBuffer = graph.Import("BackBuffer", 1);
+	FrameGraphHandle unused;
+
+	uint32_t culled = graph.AddPass("Unused", [&unused](FrameGraph::PassBuilder& builder)
+	{
+		unused = builder.Write(builder.CreateTransient("Unused", { s_MB }), ResourceState::RenderTarget);
+	}, nullptr);
+
+	uint32_t readback = graph.AddPass("Readback", [](FrameGraph::PassBuilder& builder) { builder.SetSideEffect(); }, nullptr);
+
+	uint32_t composite = graph.AddPass("Composite", [&backBuffer](FrameGraph::PassBuilder& builder)
+	{
+		backBuffer = builder.Write(backBuffer, ResourceState::RenderTarget);
+	}, nullptr);
+
+	graph.MarkOutput(backBuffer);
+	graph.Compile();
+
+	HT_CHECK(graph.IsPassCulled(culled));
+	HT_CHECK(!graph.IsPassCulled(readback));
+	HT_CHECK(!graph.IsPassCulled(composite));
+	HT_CHECK_EQ(graph.GetStats().CulledPasses, 1u);
+	HT_CHECK_EQ(graph.GetStats().TransientResources, 0u);
+	HT_CHECK(graph.GetExecutionOrder() == std::vector<uint32_t>({ readback, composite }));
+}
@@ -0,0 +1,151 @@
+#include "testFramework.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/frameRing.h>
+
+using namespace HT;
+
+namespace
+{
+	//The "GPU" only finishes a frame when the CPU has to wait for it, so the CPU always runs as far ahead as the ring lets it
+	struct LazyGPU
+	{
+		CPUFence Fence;
+		std::vector<uint64_t> Waits;
+
+		LazyGPU()
+		{
+			Fence.SetWaitHandler([this](CPUFence& fence, uint64_t value)
+			{
+				Waits.push_back(value);
+				fence.Complete(value);
+			});
+		}
+
+		//Frames submitted that the GPU hasn't finished
+		uint64_t GetQueuedFrames() const { return Fence.GetLastSignaledValue() - Fence.GetCompletedValue(); }
+	};
+
+	//Runs frames and returns the most frames that were still queued when one began
+	template<uint32_t N>
+	uint64_t RunFrames(FrameRing<N>& ring, LazyGPU& gpu, uint32_t frameCount)
+	{
+		uint64_t maxQueued = 0;
+		for (uint32_t i = 0; i < frameCount; i++)
+		{
+			auto& slot = ring.BeginFrame();
+
+			//The resources of the slot are free and no more than the latency is queued, the frame we begin included
+			HT_CHECK(gpu.Fence.IsComplete(slot.FenceValue));
+			HT_CHECK(gpu.GetQueuedFrames() < ring.GetMaxFrameLatency());
+
+			maxQueued = HTUtils::HTMax(maxQueued, gpu.GetQueuedFrames());
+			ring.EndFrame();
+		}
+		return maxQueued;
+	}
+}
+
+HT_TEST(FrameRing, FramesInFlightChangeWithoutAFlush)
+{
+	LazyGPU gpu;
+	FrameRing<4> ring(&gpu.Fence, 4);
+
+	//The first 4 frames have free slots, then each frame waits for the one 4 frames before it
+	HT_CHECK_EQ(RunFrames(ring, gpu, 8), 3ull);
+	HT_CHECK(gpu.Waits == std::vector<uint64_t>({ 1, 2, 3, 4 }));
+
+	//Down to 2: the first frame waits for the frame before the last one, not for everything
+	gpu.Waits.clear();
+	ring.SetFramesInFlight(2);
+
+	ring.BeginFrame();
+	HT_CHECK(gpu.Waits == std::vector<uint64_t>({ 7 }));
+	HT_CHECK_EQ(gpu.GetQueuedFrames(), 1ull);
+	ring.EndFrame();
+
+	HT_CHECK_EQ(RunFrames(ring, gpu, 6), 1ull);
+
+	//Back up to 4: the slots that come back still know the fence of their last frame, and the CPU gets ahead again
+	gpu.Waits.clear();
+	ring.SetFramesInFlight(4);
+	HT_CHECK_EQ(RunFrames(ring, gpu, 8), 3ull);
+
+	ring.SetFramesInFlight(1);
+	HT_CHECK_EQ(RunFrames(ring, gpu, 4), 0ull);
+	HT_CHECK_EQ(ring.GetFramesInFlight(), 1u);
+}
+
+HT_TEST(FrameRing, LowLatencyQueuesLessThanHighThroughput)
+{
+	LazyGPU throughputGPU;
+	FrameRing<3> throughput(&throughputGPU.Fence, 3, FramePacingMode::HighThroughput);
+	HT_CHECK_EQ(throughput.GetMaxFrameLatency(), 3u);
+	HT_CHECK_EQ(RunFrames(throughput, throughputGPU, 20), 2ull);
+
+	//Still 3 sets of resources, but the CPU never starts a frame with another one queued
+	LazyGPU latencyGPU;
+	FrameRing<3> latency(&latencyGPU.Fence, 3, FramePacingMode::LowLatency);
+	HT_CHECK_EQ(latency.GetMaxFrameLatency(), 1u);
+	HT_CHECK_EQ(RunFrames(latency, latencyGPU, 20), 0ull);
+	HT_CHECK(latencyGPU.Fence.GetWaitCount() > throughputGPU.Fence.GetWaitCount());
+
+	//The latency in between, and the mode changes it at runtime
+	throughput.SetMaxFrameLatency(2);
+	HT_CHECK_EQ(RunFrames(throughput, throughputGPU, 20), 1ull);
+	throughput.SetPacingMode(FramePacingMode::LowLatency);
+	HT_CHECK_EQ(RunFrames(throughput, throughputGPU, 20), 0ull);
+}
+
+HT_TEST(FrameRing, StallsAreOnlyCountedWhenTheFenceBlocks)
+{
+	const auto stall = std::chrono::milliseconds(2);
+
+	CPUFence fence;
+	fence.SetWaitHandler([stall](CPUFence& fence, uint64_t value)
+	{
+		std::this_thread::sleep_for(stall);
+		fence.Complete(value);
+	});
+
+	FrameRing<2> ring(&fence, 2);
+
+	//Two free slots
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		auto& slot = ring.BeginFrame();
+		HT_CHECK_EQ(slot.LastStallNs, 0ull);
+		HT_CHECK_EQ(slot.StallCount, 0ull);
+		ring.EndFrame();
+	}
+	HT_CHECK_EQ(fence.GetWaitCount(), 0ull);
+
+	//Slot 0 is still on the "GPU"
+	auto& blocked = ring.BeginFrame();
+	HT_CHECK_EQ(fence.GetWaitCount(), 1ull);
+	HT_CHECK_EQ(blocked.StallCount, 1ull);
+	HT_CHECK(blocked.LastStallNs >= (uint64_t)std::chrono::nanoseconds(stall).count());
+	HT_CHECK_EQ(blocked.TotalStallNs, blocked.LastStallNs);
+	ring.EndFrame();
+
+	//The GPU caught up before the CPU came back, nothing blocks. The last stall is cleared, the total is kept.
+	fence.CompleteAll();
+	auto& free = ring.BeginFrame();
+	HT_CHECK_EQ(&free, &ring.GetSlot(1));
+	HT_CHECK_EQ(fence.GetWaitCount(), 1ull);
+	HT_CHECK_EQ(free.LastStallNs, 0ull);
+	HT_CHECK_EQ(free.StallCount, 0ull);
+	ring.EndFrame();
+
+	auto& again = ring.BeginFrame();
+	HT_CHECK_EQ(&again, &ring.GetSlot(0));
+	HT_CHECK_EQ(fence.GetWaitCount(), 1ull);
+	HT_CHECK_EQ(again.LastStallNs, 0ull);
+	HT_CHECK_EQ(again.StallCount, 1ull);
+	HT_CHECK(again.TotalStallNs > 0);
+	ring.EndFrame();
+}
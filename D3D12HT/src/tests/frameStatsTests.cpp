@@ -0,0 +1,180 @@
+#include "testFramework.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include <core/frameStats.h>
+
+using namespace HT;
+
+namespace
+{
+	const uint64_t s_Ms = 1000000;
+
+	//The nanoseconds are converted with a multiply, 1ms may not be exactly 1.0
+	bool Near(double a, double b)
+	{
+		return std::abs(a - b) < 1e-9;
+	}
+
+	//Frames back to back, like the renderer records them
+	struct FrameFeeder
+	{
+		FrameStats& Stats;
+		uint64_t Now = 0;
+
+		void Frame(uint64_t durationNs)
+		{
+			Stats.BeginFrame(Now);
+			Now += durationNs;
+			Stats.EndFrame(Now);
+		}
+	};
+
+	//A histogram line of the JSON: every sample in the bucket given
+	std::string HistogramJSON(uint32_t bucket, uint32_t count)
+	{
+		std::string text = "[";
+		for (uint32_t b = 0; b < FrameStats::s_HistogramBuckets; b++)
+			text += (b ? ", " : "") + std::to_string(b == bucket ? count : 0);
+		return text + "]";
+	}
+}
+
+HT_TEST(FrameStats, NearestRankPercentiles)
+{
+	FrameStats stats;
+	FrameFeeder feeder = { stats };
+
+	//1 to 100ms, shuffled so the sort is needed
+	for (uint32_t i = 0; i < 100; i++)
+		feeder.Frame((i * 37 % 100 + 1) * s_Ms);
+
+	FramePhaseSummary summary = stats.Summarize(FramePhase::Frame);
+	HT_CHECK_EQ(summary.SampleCount, 100u);
+	HT_CHECK(Near(summary.AverageMs, 50.5));
+	HT_CHECK(Near(summary.P50Ms, 50.0));
+	HT_CHECK(Near(summary.P95Ms, 95.0));
+	HT_CHECK(Near(summary.P99Ms, 99.0));
+	HT_CHECK(Near(summary.MaxMs, 100.0));
+
+	//With 3 samples the ranks round up: p50 is the 2nd, p95 and p99 the 3rd. Always a sample, never an interpolation.
+	FrameStats few;
+	FrameFeeder fewFeeder = { few };
+	fewFeeder.Frame(10 * s_Ms);
+	fewFeeder.Frame(30 * s_Ms);
+	fewFeeder.Frame(20 * s_Ms);
+
+	FramePhaseSummary fewSummary = few.Summarize(FramePhase::Frame);
+	HT_CHECK(Near(fewSummary.P50Ms, 20.0));
+	HT_CHECK(Near(fewSummary.P95Ms, 30.0));
+	HT_CHECK(Near(fewSummary.P99Ms, 30.0));
+
+	//Nothing recorded, nothing to summarize
+	FrameStats empty;
+	HT_CHECK_EQ(empty.Summarize(FramePhase::Frame).SampleCount, 0u);
+	HT_CHECK_EQ(empty.Summarize(FramePhase::Frame).MaxMs, 0.0);
+}
+
+HT_TEST(FrameStats, HistoryWrapsAround)
+{
+	FrameStats stats;
+	FrameFeeder feeder = { stats };
+
+	//The 10 slow frames are the oldest, they fall out of the ring
+	for (uint32_t i = 0; i < 10; i++)
+		feeder.Frame(100 * s_Ms);
+	for (uint32_t i = 0; i < FrameStats::s_HistoryCapacity; i++)
+		feeder.Frame(1 * s_Ms);
+
+	HT_CHECK_EQ(stats.GetSampleCount(), FrameStats::s_HistoryCapacity);
+	HT_CHECK_EQ(stats.GetFrameCount(), (uint64_t)FrameStats::s_HistoryCapacity + 10);
+	HT_CHECK(Near(stats.Summarize(FramePhase::Frame).MaxMs, 1.0));
+
+	//The oldest row is the first frame still in the ring
+	std::ostringstream csv;
+	stats.ExportCSV(csv);
+
+	std::string text = csv.str();
+	std::string firstRow = text.substr(text.find('\n') + 1);
+	HT_CHECK_EQ(firstRow.substr(0, firstRow.find(',')), std::string("10"));
+
+	//One more frame moves the oldest by one
+	feeder.Frame(5 * s_Ms);
+	HT_CHECK(Near(stats.Summarize(FramePhase::Frame).MaxMs, 5.0));
+	HT_CHECK_EQ(stats.GetSampleCount(), FrameStats::s_HistoryCapacity);
+}
+
+HT_TEST(FrameStats, HistogramClampsToTheLastBucket)
+{
+	FrameStats stats(1.0);
+	FrameFeeder feeder = { stats };
+
+	feeder.Frame(s_Ms / 2);
+	feeder.Frame(30 * s_Ms + s_Ms / 2);
+	feeder.Frame(31 * s_Ms + s_Ms / 2);
+	feeder.Frame(500 * s_Ms);
+
+	FrameStats::Histogram histogram;
+	stats.BuildHistogram(FramePhase::Frame, histogram);
+
+	HT_CHECK_EQ(histogram[0], 1u);
+	HT_CHECK_EQ(histogram[30], 1u);
+	HT_CHECK_EQ(histogram[FrameStats::s_HistogramBuckets - 1], 2u);
+
+	uint32_t total = 0;
+	for (uint32_t count : histogram)
+		total += count;
+	HT_CHECK_EQ(total, 4u);
+}
+
+HT_TEST(FrameStats, ExportsCSVAndJSON)
+{
+	FrameStats stats(2.0);
+
+	//Frame 0: 0.5ms of cull, 2ms long. Frame 1: 1ms of present in two parts, 3ms long (measured from the end of frame 0).
+	stats.BeginFrame(0);
+	stats.BeginPhase(FramePhase::Cull, 0);
+	stats.EndPhase(FramePhase::Cull, s_Ms / 2);
+	stats.EndFrame(2 * s_Ms);
+
+	stats.BeginFrame(3 * s_Ms);
+	stats.AddPhaseDuration(FramePhase::Present, s_Ms / 2);
+	stats.AddPhaseDuration(FramePhase::Present, s_Ms / 2);
+	stats.EndFrame(5 * s_Ms);
+
+	std::ostringstream csv;
+	stats.ExportCSV(csv);
+	HT_CHECK_EQ(csv.str(), std::string(
+		"frame,cull_ms,record_ms,execute_ms,present_ms,fence_wait_ms,latency_wait_ms,input_to_present_ms,frame_ms\n"
+		"0,0.5,0,0,0,0,0,0,2\n"
+		"1,0,0,0,1,0,0,0,3\n"));
+
+	const std::string zero = "\"avgMs\": 0, \"p50Ms\": 0, \"p95Ms\": 0, \"p99Ms\": 0, \"maxMs\": 0, \"histogram\": " + HistogramJSON(0, 2);
+	const std::string halfMs = "\"avgMs\": 0.25, \"p50Ms\": 0, \"p95Ms\": 0.5, \"p99Ms\": 0.5, \"maxMs\": 0.5, \"histogram\": " + HistogramJSON(0, 2);
+	const std::string oneMs = "\"avgMs\": 0.5, \"p50Ms\": 0, \"p95Ms\": 1, \"p99Ms\": 1, \"maxMs\": 1, \"histogram\": " + HistogramJSON(0, 2);
+
+	std::ostringstream json;
+	stats.ExportJSON(json);
+	HT_CHECK_EQ(json.str(), std::string(
+		"{\n"
+		"\t\"frameCount\": 2,\n"
+		"\t\"sampleCount\": 2,\n"
+		"\t\"histogramBucketMs\": 2,\n"
+		"\t\"phases\": {\n"
+		"\t\t\"cull\": { " + halfMs + " },\n"
+		"\t\t\"record\": { " + zero + " },\n"
+		"\t\t\"execute\": { " + zero + " },\n"
+		"\t\t\"present\": { " + oneMs + " },\n"
+		"\t\t\"fence_wait\": { " + zero + " },\n"
+		"\t\t\"latency_wait\": { " + zero + " },\n"
+		"\t\t\"input_to_present\": { " + zero + " },\n"
+		"\t\t\"frame\": { \"avgMs\": 2.5, \"p50Ms\": 2, \"p95Ms\": 3, \"p99Ms\": 3, \"maxMs\": 3, \"histogram\": " + HistogramJSON(1, 2) + " }\n"
+		"\t},\n"
+		"\t\"samples\": [\n"
+		"\t\t{ \"frame\": 0, \"cullMs\": 0.5, \"recordMs\": 0, \"executeMs\": 0, \"presentMs\": 0, \"fence_waitMs\": 0, \"latency_waitMs\": 0, \"input_to_presentMs\": 0, \"frameMs\": 2 },\n"
+		"\t\t{ \"frame\": 1, \"cullMs\": 0, \"recordMs\": 0, \"executeMs\": 0, \"presentMs\": 1, \"fence_waitMs\": 0, \"latency_waitMs\": 0, \"input_to_presentMs\": 0, \"frameMs\": 3 }\n"
+		"\t]\n"
+		"}\n"));
+}
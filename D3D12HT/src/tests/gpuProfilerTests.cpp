@@ -0,0 +1,271 @@
+#include "testFramework.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/frameRing.h>
+#include <renderer/gpuProfiler.h>
+#include <renderer/null/nullCommandList.h>
+#include <renderer/null/nullQueueBackend.h>
+#include <renderer/null/nullTimestampBackend.h>
+
+using namespace HT;
+
+namespace
+{
+	//The CPU timestamps have no lists, any pointer will do
+	void* const s_CommandList = nullptr;
+
+	//A frame with one scope, ended with the value the ring signaled after it
+	void RecordFrame(GPUProfiler& profiler, FrameRing<4>& ring, CPUTimestampBackend& timestamps, const char* name)
+	{
+		ring.BeginFrame();
+		profiler.BeginFrame();
+
+		profiler.BeginScope(s_CommandList, name);
+		timestamps.AdvanceClock(100);
+		profiler.EndScope(s_CommandList);
+		profiler.ResolveFrame(s_CommandList);
+
+		profiler.EndFrame(ring.EndFrame());
+	}
+
+	std::vector<std::string> ResolvedNames(const GPUProfiler& profiler)
+	{
+		std::vector<std::string> names;
+		for (uint32_t i = 0; i < profiler.GetResolvedFrameCount(); i++)
+			names.push_back(profiler.GetResolvedFrame(i).Scopes[0].Name);
+		return names;
+	}
+}
+
+HT_TEST(GPUProfiler, NestedScopesKeepTheirDepthAndParent)
+{
+	CPUFence fence;
+	GPUProfilerConfig config;
+	CPUTimestampBackend timestamps(&fence, GPUProfiler::GetQueryCount(config));
+	GPUProfiler profiler(&timestamps, &fence, config);
+	FrameRing<4> ring(&fence);
+
+	//10MHz, 100ns a tick. The tick 0 is 5us on the CPU.
+	timestamps.SetCalibrationCPUNanoseconds(5000);
+
+	ring.BeginFrame();
+	profiler.BeginFrame();
+
+	timestamps.SetClock(100);
+	profiler.BeginScope(s_CommandList, "Frame");
+	timestamps.SetClock(200);
+	profiler.BeginScope(s_CommandList, "Shadows");
+	timestamps.SetClock(300);
+	profiler.EndScope(s_CommandList);
+	{
+		GPUProfileScope opaque(&profiler, s_CommandList, "Opaque");
+		timestamps.SetClock(400);
+		profiler.BeginScope(s_CommandList, "Sky");
+		timestamps.SetClock(450);
+		profiler.EndScope(s_CommandList);
+		timestamps.SetClock(600);
+	}
+	timestamps.SetClock(700);
+	profiler.EndScope(s_CommandList);
+	profiler.ResolveFrame(s_CommandList);
+	profiler.EndFrame(ring.EndFrame());
+
+	fence.CompleteAll();
+	ring.BeginFrame();
+	profiler.BeginFrame();
+
+	HT_CHECK_EQ(profiler.GetResolvedFrameCount(), 1u);
+	const GPUProfilerFrame& frame = profiler.GetResolvedFrame(0);
+	HT_CHECK_EQ(frame.Scopes.size(), (size_t)4);
+
+	//In the order they began, parents before their children
+	const uint32_t none = GPUProfilerScope::s_NoParent;
+	const char* names[] = { "Frame", "Shadows", "Opaque", "Sky" };
+	uint32_t depths[] = { 0, 1, 1, 2 };
+	uint32_t parents[] = { none, 0, 0, 2 };
+	uint64_t begins[] = { 15000, 25000, 35000, 45000 };
+	uint64_t ends[] = { 75000, 35000, 65000, 50000 };
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		const GPUProfilerScope& scope = frame.Scopes[i];
+		HT_CHECK_EQ(std::string(scope.Name), std::string(names[i]));
+		HT_CHECK_EQ(scope.Depth, depths[i]);
+		HT_CHECK_EQ(scope.Parent, parents[i]);
+		HT_CHECK_EQ(scope.BeginNs, begins[i]);
+		HT_CHECK_EQ(scope.EndNs, ends[i]);
+	}
+
+	//Only the top level scope counts for the frame
+	HT_CHECK_EQ(frame.GetGPUMs(), 0.06);
+	HT_CHECK_EQ(frame.Scopes[3].GetDurationMs(), 0.005);
+
+	profiler.ResolveFrame(s_CommandList);
+	profiler.EndFrame(ring.EndFrame());
+}
+
+//A frequency that doesn't divide a second, a calibration after a month of uptime and scopes far from it on both sides
+HT_TEST(GPUProfiler, TicksBecomeCPUNanoseconds)
+{
+	const uint64_t frequency = 19200000;
+	const uint64_t calibrationTicks = frequency * 60 * 60 * 24 * 30;
+	const uint64_t calibrationNs = 1000000000000ull;
+
+	CPUFence fence;
+	GPUProfilerConfig config;
+	config.CalibrationInterval = 0;
+	CPUTimestampBackend timestamps(&fence, GPUProfiler::GetQueryCount(config), frequency);
+	timestamps.SetClock(calibrationTicks);
+	timestamps.SetCalibrationCPUNanoseconds(calibrationNs);
+
+	GPUProfiler profiler(&timestamps, &fence, config);
+	FrameRing<4> ring(&fence);
+
+	ring.BeginFrame();
+	profiler.BeginFrame();
+
+	//100us before the calibration, 192 ticks are 10us
+	timestamps.SetClock(calibrationTicks - 1920);
+	profiler.BeginScope(s_CommandList, "Before");
+	timestamps.AdvanceClock(192);
+	profiler.EndScope(s_CommandList);
+
+	//1000s after it: the ticks times a billion don't fit in 64 bits
+	timestamps.SetClock(calibrationTicks + frequency * 1000);
+	profiler.BeginScope(s_CommandList, "Later");
+	timestamps.AdvanceClock(1);
+	profiler.EndScope(s_CommandList);
+
+	profiler.ResolveFrame(s_CommandList);
+	profiler.EndFrame(ring.EndFrame());
+
+	fence.CompleteAll();
+	ring.BeginFrame();
+	profiler.BeginFrame();
+
+	HT_CHECK_EQ(profiler.GetResolvedFrameCount(), 1u);
+	const std::vector<GPUProfilerScope>& scopes = profiler.GetResolvedFrame(0).Scopes;
+	HT_CHECK_EQ(scopes[0].BeginNs, calibrationNs - 100000);
+	HT_CHECK_EQ(scopes[0].EndNs, calibrationNs - 90000);
+	HT_CHECK_EQ(scopes[0].GetDurationMs(), 0.01);
+
+	//A tick is 52.08ns, the rest of the division is truncated
+	HT_CHECK_EQ(scopes[1].BeginNs, calibrationNs + 1000000000000ull);
+	HT_CHECK_EQ(scopes[1].EndNs, calibrationNs + 1000000000052ull);
+	HT_CHECK_EQ(profiler.GetStats().Calibrations, 1ull);
+
+	profiler.ResolveFrame(s_CommandList);
+	profiler.EndFrame(ring.EndFrame());
+}
+
+HT_TEST(GPUProfiler, SlotsAreOnlyReadOnceTheirFenceCompletes)
+{
+	CPUFence fence;
+	GPUProfilerConfig config;
+	config.FrameSlots = 3;
+	CPUTimestampBackend timestamps(&fence, GPUProfiler::GetQueryCount(config));
+	GPUProfiler profiler(&timestamps, &fence, config);
+	FrameRing<4> ring(&fence);
+
+	//The GPU doesn't finish anything: the three slots fill up and nothing is read
+	RecordFrame(profiler, ring, timestamps, "F0");
+	RecordFrame(profiler, ring, timestamps, "F1");
+	RecordFrame(profiler, ring, timestamps, "F2");
+	HT_CHECK_EQ(profiler.GetResolvedFrameCount(), 0u);
+
+	//The slot of the fourth frame is still waiting, the frame isn't profiled. The profiler never waits.
+	RecordFrame(profiler, ring, timestamps, "F3");
+	HT_CHECK_EQ(profiler.GetResolvedFrameCount(), 0u);
+	HT_CHECK_EQ(profiler.GetStats().FramesSkipped, 1ull);
+	HT_CHECK_EQ(fence.GetWaitCount(), 0ull);
+	HT_CHECK_EQ(timestamps.GetReads(), 0ull);
+
+	//The GPU is done with the first two frames, they are read four and three frames after they were recorded
+	fence.Complete(2);
+	RecordFrame(profiler, ring, timestamps, "F4");
+	HT_CHECK(ResolvedNames(profiler) == std::vector<std::string>({ "F0", "F1" }));
+	HT_CHECK_EQ(profiler.GetResolvedFrame(0).LatencyFrames, 4u);
+	HT_CHECK_EQ(profiler.GetResolvedFrame(1).LatencyFrames, 3u);
+	HT_CHECK_EQ(profiler.GetResolvedFrame(0).FenceValue, 1ull);
+
+	//The rest, still the oldest first even if the frame in the middle was skipped
+	fence.CompleteAll();
+	RecordFrame(profiler, ring, timestamps, "F5");
+	HT_CHECK(ResolvedNames(profiler) == std::vector<std::string>({ "F2", "F4" }));
+	HT_CHECK_EQ(profiler.GetResolvedFrame(0).LatencyFrames, 3u);
+	HT_CHECK_EQ(profiler.GetResolvedFrame(1).LatencyFrames, 1u);
+
+	//Every read was of timestamps the GPU had resolved
+	HT_CHECK_EQ(timestamps.GetReads(), 4ull);
+	HT_CHECK_EQ(timestamps.GetEarlyReads(), 0ull);
+
+	const GPUProfilerStats& stats = profiler.GetStats();
+	HT_CHECK_EQ(stats.FramesRecorded, 5ull);
+	HT_CHECK_EQ(stats.FramesResolved, 4ull);
+	HT_CHECK_EQ(stats.TotalLatencyFrames, 11ull);
+	HT_CHECK_EQ(stats.MaxLatencyFrames, 4u);
+}
+
+//The null queues write the timestamps when they execute the lists, and they only execute them when the CPU waits for them
+HT_TEST(GPUProfiler, NullQueueTimestamps)
+{
+	NullQueueBackend queues;
+	IFence* fence = queues.GetFence(CommandQueueType::Direct);
+
+	GPUProfilerConfig config;
+	NullTimestampBackend timestamps(GPUProfiler::GetQueryCount(config));
+	GPUProfiler profiler(&timestamps, fence, config);
+	FrameRing<2> ring(fence);
+
+	std::vector<std::unique_ptr<NullCommandAllocator>> allocators;
+	std::vector<std::unique_ptr<NullCommandList>> lists;
+
+	for (uint32_t frame = 0; frame < 4; frame++)
+	{
+		ring.BeginFrame();
+		profiler.BeginFrame();
+
+		//Two frames in flight: the first frame is only executed when the third one waits for its slot
+		HT_CHECK_EQ(profiler.GetResolvedFrameCount(), frame >= 2 ? 1u : 0u);
+		if (profiler.GetResolvedFrameCount() > 0)
+		{
+			const GPUProfilerFrame& resolved = profiler.GetResolvedFrame(0);
+			HT_CHECK_EQ(resolved.FrameIndex, frame - 2ull);
+			HT_CHECK_EQ(resolved.LatencyFrames, 2u);
+			HT_CHECK_EQ(resolved.Scopes.size(), (size_t)2);
+
+			//The clock of the null GPU is the CPU one: the frame was executed after it began and before it was read
+			const GPUProfilerScope& outer = resolved.Scopes[0];
+			const GPUProfilerScope& inner = resolved.Scopes[1];
+			HT_CHECK_EQ(inner.Depth, 1u);
+			HT_CHECK_EQ(inner.Parent, 0u);
+			HT_CHECK(resolved.CPUBeginNs <= outer.BeginNs);
+			HT_CHECK(outer.BeginNs <= inner.BeginNs && inner.BeginNs <= inner.EndNs && inner.EndNs <= outer.EndNs);
+			HT_CHECK(outer.EndNs <= resolved.ReadbackNs);
+		}
+
+		allocators.push_back(std::make_unique<NullCommandAllocator>(CommandQueueType::Direct));
+		lists.push_back(std::make_unique<NullCommandList>(CommandQueueType::Direct, allocators.back().get()));
+		NullCommandList* commandList = lists.back().get();
+
+		profiler.BeginScope(commandList, "Frame");
+		profiler.BeginScope(commandList, "Draws");
+		commandList->Draw(3, 1, 0, 0);
+		profiler.EndScope(commandList);
+		profiler.EndScope(commandList);
+		profiler.ResolveFrame(commandList);
+		commandList->Close();
+
+		void* submit = commandList;
+		queues.ExecuteCommandLists(CommandQueueType::Direct, &submit, 1);
+		profiler.EndFrame(ring.EndFrame());
+	}
+
+	queues.ExecuteAll();
+	HT_CHECK_EQ(queues.GetStats().Timestamps, 16ull);
+	HT_CHECK_EQ(profiler.GetStats().FramesResolved, 2ull);
+}
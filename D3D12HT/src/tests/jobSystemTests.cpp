@@ -0,0 +1,64 @@
+#include "testFramework.h"
+
+#include <atomic>
+#include <vector>
+
+#include <core/jobSystem.h>
+
+using namespace HT;
+
+HT_TEST(JobSystem, NoWorkersRunsEverythingOnThreadZero)
+{
+	JobSystem jobSystem(0);
+	HT_CHECK_EQ(jobSystem.GetThreadCount(), 1u);
+
+	std::vector<uint32_t> threads(1000, ~0u);
+	jobSystem.ParallelFor((uint32_t)threads.size(), 10, [&threads](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+			threads[i] = JobSystem::GetCurrentThreadIndex();
+	});
+
+	for (uint32_t thread : threads)
+		HT_CHECK_EQ(thread, 0u);
+
+	HT_CHECK_EQ(jobSystem.GetStealCount(), 0ull);
+}
+
+HT_TEST(JobSystem, WorkerCountIsWhatWasAskedFor)
+{
+	JobSystem one(1);
+	HT_CHECK_EQ(one.GetThreadCount(), 2u);
+
+	JobSystem three(3);
+	HT_CHECK_EQ(three.GetThreadCount(), 4u);
+
+	//Auto has at least one worker, even on a single core
+	JobSystem automatic;
+	HT_CHECK(automatic.GetThreadCount() >= 2u);
+}
+
+HT_TEST(JobSystem, DependenciesRunInOrder)
+{
+	for (uint32_t workers : { 0u, 3u })
+	{
+		JobSystem jobSystem(workers);
+
+		std::atomic<uint32_t> firstDone = 0;
+		bool ordered = true;
+
+		JobCounter first;
+		JobCounter second;
+
+		for (uint32_t i = 0; i < 16; i++)
+			jobSystem.Run([&firstDone]() { firstDone.fetch_add(1); }, &first);
+
+		//Only scheduled once the 16 jobs of the first counter are done
+		jobSystem.RunAfter(first, [&firstDone, &ordered]() { ordered = firstDone.load() == 16; }, &second);
+
+		jobSystem.Wait(second);
+		HT_CHECK(ordered);
+		HT_CHECK_EQ(firstDone.load(), 16u);
+		HT_CHECK(first.IsDone());
+	}
+}
@@ -0,0 +1,184 @@
+#include "testFramework.h"
+
+#include <filesystem>
+#include <string>
+
+#include <renderer/pipelineCache.h>
+
+using namespace HT;
+
+namespace
+{
+	PipelineShader MakeShader(const std::string& code, uint64_t hash = 0)
+	{
+		PipelineShader shader;
+		shader.Bytecode = std::make_shared<const ShaderBytecode>(code.begin(), code.end());
+		shader.Hash = hash;
+		return shader;
+	}
+
+	PipelineDesc MakeDesc(const std::string& pixelShader, uint64_t rootSignatureHash = 1)
+	{
+		PipelineDesc desc;
+		desc.Shaders[(uint32_t)ShaderStage::Vertex] = MakeShader("vs");
+		desc.Shaders[(uint32_t)ShaderStage::Pixel] = MakeShader(pixelShader);
+		desc.RootSignatureHash = rootSignatureHash;
+		desc.FixedFunctionState = { 1, 2, 3, 4 };
+		return desc;
+	}
+
+	//Fails to create the pipelines of one root signature
+	class FailingPipelineBackend : public CPUPipelineBackend
+	{
+	public:
+		static const uint64_t s_FailingRootSignature = 666;
+
+		void* CreatePipeline(const PipelineDesc& desc) override
+		{
+			return desc.RootSignatureHash == s_FailingRootSignature ? nullptr : CPUPipelineBackend::CreatePipeline(desc);
+		}
+	};
+}
+
+HT_TEST(PipelineCache, HashFollowsEverythingThatIsCreated)
+{
+	const PipelineDesc desc = MakeDesc("ps");
+	const uint64_t hash = HashPipelineDesc(desc);
+
+	//The bytecode is compared by content, the names and the native root signature don't matter
+	PipelineDesc same = MakeDesc("ps");
+	same.DebugName = "Same";
+	same.RootSignature = (void*)0x1234;
+	HT_CHECK_EQ(HashPipelineDesc(same), hash);
+	HT_CHECK(IsSamePipelineDesc(desc, same));
+
+	PipelineDesc otherShader = MakeDesc("ps2");
+	PipelineDesc otherRootSignature = MakeDesc("ps", 2);
+	PipelineDesc otherState = MakeDesc("ps");
+	otherState.FixedFunctionState.back() = 5;
+	PipelineDesc longerState = MakeDesc("ps");
+	longerState.FixedFunctionState.push_back(0);
+
+	//The same shader in another stage
+	PipelineDesc otherStage = MakeDesc("ps");
+	otherStage.Shaders[(uint32_t)ShaderStage::Geometry] = otherStage.Shaders[(uint32_t)ShaderStage::Pixel];
+	otherStage.Shaders[(uint32_t)ShaderStage::Pixel] = {};
+
+	for (const PipelineDesc* other : { &otherShader, &otherRootSignature, &otherState, &longerState, &otherStage })
+	{
+		HT_CHECK(HashPipelineDesc(*other) != hash);
+		HT_CHECK(!IsSamePipelineDesc(desc, *other));
+	}
+
+	//With a key the bytecode isn't hashed, the key is trusted
+	PipelineDesc keyed = MakeDesc("ps");
+	keyed.Shaders[(uint32_t)ShaderStage::Pixel].Hash = 42;
+	PipelineDesc keyedOther = MakeDesc("something else");
+	keyedOther.Shaders[(uint32_t)ShaderStage::Pixel].Hash = 42;
+	HT_CHECK_EQ(HashPipelineDesc(keyed), HashPipelineDesc(keyedOther));
+	HT_CHECK(HashPipelineDesc(keyed) != hash);
+}
+
+HT_TEST(PipelineCache, IdenticalDescsShareAPipeline)
+{
+	CPUPipelineBackend backend;
+	{
+		PipelineCache cache(&backend);
+
+		PipelineHandle first = cache.Request(MakeDesc("ps"));
+		PipelineHandle second = cache.Request(MakeDesc("ps"));
+		PipelineHandle other = cache.Request(MakeDesc("ps2"));
+
+		HT_CHECK_EQ(first, second);
+		HT_CHECK(first != other);
+
+		//Without a job system they are created in Request
+		HT_CHECK(cache.IsReady(first));
+		HT_CHECK(cache.Get(first) != nullptr);
+		HT_CHECK(cache.Get(first) != cache.Get(other));
+
+		HT_CHECK_EQ(cache.GetStats().Requests, 3ull);
+		HT_CHECK_EQ(cache.GetStats().Deduplicated, 1ull);
+		HT_CHECK_EQ(cache.GetStats().Created, 2ull);
+		HT_CHECK_EQ(backend.GetCreateCount(), 2ull);
+		HT_CHECK_EQ(backend.GetLivePipelineCount(), 2u);
+	}
+
+	HT_CHECK_EQ(backend.GetLivePipelineCount(), 0u);
+}
+
+HT_TEST(PipelineCache, FallbackWhileBuilding)
+{
+	FailingPipelineBackend backend;
+
+	//No workers: the pipelines are only created when we wait for them, so we can look at the cache in the middle
+	JobSystem jobSystem(0);
+	PipelineCache cache(&backend, &jobSystem);
+
+	PipelineHandle fallback = cache.Request(MakeDesc("simple"));
+	cache.WaitAll();
+	void* fallbackPipeline = cache.Get(fallback);
+	HT_CHECK(fallbackPipeline != nullptr);
+
+	PipelineHandle pipeline = cache.Request(MakeDesc("complex"), fallback);
+	PipelineHandle alone = cache.Request(MakeDesc("alone"));
+	PipelineHandle failing = cache.Request(MakeDesc("broken", FailingPipelineBackend::s_FailingRootSignature), fallback);
+
+	HT_CHECK_EQ(cache.GetPendingCount(), 3u);
+	HT_CHECK(!cache.IsReady(pipeline));
+	HT_CHECK(cache.Get(pipeline) == fallbackPipeline);
+	HT_CHECK(cache.Get(alone) == nullptr);
+	HT_CHECK_EQ(cache.GetStats().FallbackUses, 2ull);
+
+	cache.WaitAll();
+	HT_CHECK_EQ(cache.GetPendingCount(), 0u);
+
+	HT_CHECK(cache.IsReady(pipeline));
+	HT_CHECK(cache.Get(pipeline) != nullptr);
+	HT_CHECK(cache.Get(pipeline) != fallbackPipeline);
+	HT_CHECK(cache.Get(alone) != nullptr);
+
+	//A pipeline that failed keeps using its fallback
+	HT_CHECK(!cache.IsReady(failing));
+	HT_CHECK(cache.Get(failing) == fallbackPipeline);
+	HT_CHECK_EQ(cache.GetStats().Failed, 1ull);
+	HT_CHECK_EQ(cache.GetStats().FallbackUses, 3ull);
+}
+
+HT_TEST(PipelineCache, LibraryRoundTrip)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "HTPipelineCacheTests_Library.bin").string();
+	std::filesystem::remove(path);
+
+	{
+		CPUPipelineBackend backend;
+		PipelineCache cache(&backend);
+
+		//First run, there is no library yet
+		HT_CHECK(!cache.LoadLibrary(path));
+		cache.Request(MakeDesc("ps"));
+		cache.Request(MakeDesc("ps2"));
+		HT_CHECK_EQ(cache.GetStats().LibraryHits, 0ull);
+		HT_CHECK(cache.SaveLibrary(path));
+	}
+
+	{
+		CPUPipelineBackend backend;
+		JobSystem jobSystem(1);
+		PipelineCache cache(&backend, &jobSystem);
+
+		HT_CHECK(cache.LoadLibrary(path));
+		PipelineHandle first = cache.Request(MakeDesc("ps"));
+		cache.Request(MakeDesc("ps2"));
+		cache.Request(MakeDesc("ps3"));
+		cache.WaitAll();
+
+		//Only the new one is created
+		HT_CHECK_EQ(cache.GetStats().LibraryHits, 2ull);
+		HT_CHECK_EQ(cache.GetStats().Created, 1ull);
+		HT_CHECK_EQ(backend.GetCreateCount(), 1ull);
+		HT_CHECK(cache.Get(first) != nullptr);
+	}
+
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,114 @@
+#include "testFramework.h"
+
+#include <renderer/presentQueueModel.h>
+
+using namespace HT;
+
+namespace
+{
+	const uint64_t s_Ms = 1000000;
+
+	PresentQueueModel::CostFunction Constant(uint64_t costNs)
+	{
+		return [costNs](uint64_t) { return costNs; };
+	}
+}
+
+HT_TEST(PresentQueueModel, CPUBoundWithoutVSyncNeverBlocks)
+{
+	PresentModelConfig config;
+	config.VSync = false;
+	config.FrameCount = 50;
+
+	//The GPU is always done before the next frame is submitted, nothing queues up
+	PresentQueueModel model(config, Constant(5 * s_Ms), Constant(3 * s_Ms));
+	model.Run();
+
+	const std::vector<PresentModelFrame>& frames = model.GetFrames();
+	HT_CHECK_EQ(frames.size(), (size_t)50);
+
+	for (uint32_t i = 0; i < frames.size(); i++)
+	{
+		HT_CHECK_EQ(frames[i].InputNs, i * 5 * s_Ms);
+		HT_CHECK_EQ(frames[i].PresentNs, (i + 1) * 5 * s_Ms);
+		HT_CHECK_EQ(frames[i].DisplayNs, (i + 1) * 5 * s_Ms + 3 * s_Ms);
+		HT_CHECK_EQ(frames[i].CPUBlockedNs, 0ull);
+	}
+
+	PresentModelSummary summary = model.Summarize();
+	HT_CHECK_EQ(summary.FrameCount, 50u);
+	HT_CHECK_EQ(summary.MaxLatencyMs, 8.0);
+	HT_CHECK_EQ(summary.AverageFrameIntervalMs, 5.0);
+	HT_CHECK_EQ(summary.RepeatedRefreshes, 0u);
+}
+
+//GPU bound with VSync: the queue fills up. Both policies show the same frames at the same rate, but the waitable one samples the input later.
+HT_TEST(PresentQueueModel, WaitableSamplesTheInputLater)
+{
+	PresentModelConfig config;
+	config.RefreshIntervalNs = 10 * s_Ms;
+	config.FrameCount = 200;
+
+	PresentQueueModel blocking(config, Constant(1 * s_Ms), Constant(9 * s_Ms));
+	blocking.Run();
+
+	config.Policy = PresentLatencyPolicy::Waitable;
+	PresentQueueModel waitable(config, Constant(1 * s_Ms), Constant(9 * s_Ms));
+	waitable.Run();
+
+	PresentModelSummary blockingSummary = blocking.Summarize(20);
+	PresentModelSummary waitableSummary = waitable.Summarize(20);
+
+	HT_CHECK_EQ(blockingSummary.AverageFrameIntervalMs, 10.0);
+	HT_CHECK_EQ(waitableSummary.AverageFrameIntervalMs, 10.0);
+	HT_CHECK_EQ(blockingSummary.RepeatedRefreshes, 0u);
+	HT_CHECK_EQ(waitableSummary.RepeatedRefreshes, 0u);
+
+	HT_CHECK(waitableSummary.AverageLatencyMs < blockingSummary.AverageLatencyMs);
+	HT_CHECK(waitableSummary.MaxLatencyMs < blockingSummary.MaxLatencyMs);
+
+	//With the waitable policy Present never blocks, input to present is only the recording
+	HT_CHECK_EQ(waitableSummary.AverageInputToPresentMs, 1.0);
+	HT_CHECK(blockingSummary.AverageInputToPresentMs > 1.0);
+
+	//A shorter present queue helps the blocking policy too
+	config.Policy = PresentLatencyPolicy::PresentBlocking;
+	config.MaxFrameLatency = 1;
+	PresentQueueModel shortQueue(config, Constant(1 * s_Ms), Constant(9 * s_Ms));
+	shortQueue.Run();
+	HT_CHECK(shortQueue.Summarize(20).AverageLatencyMs < blockingSummary.AverageLatencyMs);
+}
+
+HT_TEST(PresentQueueModel, FramesFlipOnVBlanksInOrder)
+{
+	PresentModelConfig config;
+	config.RefreshIntervalNs = 10 * s_Ms;
+	config.FrameCount = 40;
+
+	//One slow frame on the GPU in the middle
+	PresentQueueModel model(config, Constant(2 * s_Ms), [](uint64_t frameIndex) { return frameIndex == 20 ? 35 * s_Ms : 4 * s_Ms; });
+	model.Run();
+
+	const std::vector<PresentModelFrame>& frames = model.GetFrames();
+	for (uint32_t i = 0; i < frames.size(); i++)
+	{
+		const PresentModelFrame& frame = frames[i];
+		HT_CHECK(frame.InputNs <= frame.PresentNs);
+		HT_CHECK(frame.GPUStartNs < frame.GPUEndNs);
+		HT_CHECK(frame.GPUEndNs <= frame.DisplayNs);
+		HT_CHECK_EQ(frame.DisplayNs % config.RefreshIntervalNs, 0ull);
+
+		//One flip per vblank, in order, and the GPU renders one frame at a time
+		if (i > 0)
+		{
+			HT_CHECK(frame.DisplayNs > frames[i - 1].DisplayNs);
+			HT_CHECK(frame.GPUStartNs >= frames[i - 1].GPUEndNs);
+		}
+	}
+
+	//The 35ms frame starts on the GPU at 190ms, when its back buffer is free, and reaches the screen at 230ms instead of 210ms:
+	//the frame before it is shown at 200, 210 and 220
+	HT_CHECK_EQ(frames[19].DisplayNs, 200 * s_Ms);
+	HT_CHECK_EQ(frames[20].DisplayNs, 230 * s_Ms);
+	HT_CHECK_EQ(model.Summarize().RepeatedRefreshes, 2u);
+}
@@ -0,0 +1,204 @@
+#include "testFramework.h"
+
+#include <string>
+#include <vector>
+
+#include <renderer/simulatedQueues.h>
+
+using namespace HT;
+
+namespace HTTest
+{
+	static std::string ToString(const std::vector<std::string>& lines)
+	{
+		std::string text = "[";
+		for (const std::string& line : lines)
+			text += " \"" + line + "\"";
+		return text + " ]";
+	}
+}
+
+namespace
+{
+	using Calls = std::vector<std::string>;
+
+	//Writes down what the scheduler asks the queues, in order, and passes it to the simulated queues
+	class RecordingQueueBackend : public ICommandQueueBackend
+	{
+	public:
+		void ExecuteCommandLists(CommandQueueType queue, void* const* commandLists, uint32_t count) override
+		{
+			m_Calls.push_back(std::string("Execute ") + CommandQueueTypeName(queue) + " " + std::to_string(count));
+			m_Queues.ExecuteCommandLists(queue, commandLists, count);
+		}
+
+		uint64_t Signal(CommandQueueType queue) override
+		{
+			uint64_t value = m_Queues.Signal(queue);
+			m_Calls.push_back(std::string("Signal ") + CommandQueueTypeName(queue) + " " + std::to_string(value));
+			return value;
+		}
+
+		void Wait(CommandQueueType queue, CommandQueueType signalingQueue, uint64_t value) override
+		{
+			m_Calls.push_back(std::string("Wait ") + CommandQueueTypeName(queue) + " " + CommandQueueTypeName(signalingQueue) + " " + std::to_string(value));
+			m_Queues.Wait(queue, signalingQueue, value);
+		}
+
+		IFence* GetFence(CommandQueueType queue) override { return m_Queues.GetFence(queue); }
+
+		//What was called since the last time
+		Calls TakeCalls()
+		{
+			Calls calls;
+			calls.swap(m_Calls);
+			return calls;
+		}
+
+		inline SimulatedQueueBackend& GetQueues() { return m_Queues; }
+
+	private:
+		SimulatedQueueBackend m_Queues;
+		Calls m_Calls;
+	};
+
+	//The lists are only ids for the simulated queues
+	void* s_Lists[] = { (void*)1, (void*)2, (void*)3, (void*)4, (void*)5, (void*)6 };
+}
+
+HT_TEST(QueueScheduler, SignalsAreOnlyInsertedWhenNeeded)
+{
+	RecordingQueueBackend backend;
+	QueueScheduler scheduler(&backend);
+
+	QueueSyncPoint first = scheduler.Submit(CommandQueueType::Direct, &s_Lists[0], 1);
+	QueueSyncPoint second = scheduler.Submit(CommandQueueType::Direct, &s_Lists[1], 1);
+
+	//Nobody waited yet, both are the next value of the fence
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Execute Direct 1", "Execute Direct 1" }));
+	HT_CHECK_EQ(first.FenceValue, 1ull);
+	HT_CHECK_EQ(second.FenceValue, 1ull);
+
+	//A single signal for both, and nothing new to signal after it
+	HT_CHECK_EQ(scheduler.Signal(CommandQueueType::Direct).FenceValue, 1ull);
+	HT_CHECK_EQ(scheduler.Signal(CommandQueueType::Direct).FenceValue, 1ull);
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Signal Direct 1" }));
+
+	//Waiting for a sync point on the CPU signals it
+	QueueSyncPoint third = scheduler.Submit(CommandQueueType::Direct, &s_Lists[2], 1);
+	scheduler.WaitOnCPU(third);
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Execute Direct 1", "Signal Direct 2" }));
+	HT_CHECK_EQ(backend.GetFence(CommandQueueType::Direct)->GetCompletedValue(), 2ull);
+
+	HT_CHECK_EQ(scheduler.GetStats().Signals, 2ull);
+	HT_CHECK_EQ(scheduler.GetStats().Waits, 0ull);
+}
+
+HT_TEST(QueueScheduler, RedundantWaitsAreSkipped)
+{
+	RecordingQueueBackend backend;
+	QueueScheduler scheduler(&backend);
+
+	QueueSyncPoint copyA = scheduler.Submit(CommandQueueType::Copy, &s_Lists[0], 1);
+	QueueSyncPoint direct = scheduler.Submit(CommandQueueType::Direct, &s_Lists[1], 1);
+	scheduler.Signal(CommandQueueType::Copy);
+	QueueSyncPoint copyB = scheduler.Submit(CommandQueueType::Copy, &s_Lists[2], 1);
+	backend.TakeCalls();
+
+	//Two dependencies on copy are one wait on the biggest value, the one on its own queue is free
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[3], 1, { copyA, copyB, direct });
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Signal Copy 2", "Wait Direct Copy 2", "Execute Direct 1" }));
+
+	//Direct already waited for a later value of copy
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[4], 1, { copyA });
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[5], 1, { copyB });
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Execute Direct 1", "Execute Direct 1" }));
+
+	//copyA and copyB already merged, the same queue, and the two waits that were known to be done
+	HT_CHECK_EQ(scheduler.GetStats().Waits, 1ull);
+	HT_CHECK_EQ(scheduler.GetStats().SkippedWaits, 3ull);
+
+	scheduler.Flush();
+	const SimulatedExecution* copy = backend.GetQueues().FindExecution(s_Lists[2]);
+	const SimulatedExecution* after = backend.GetQueues().FindExecution(s_Lists[3]);
+	HT_CHECK(copy && after && after->Start >= copy->End);
+	HT_CHECK(!backend.GetQueues().Run().Deadlocked);
+}
+
+HT_TEST(QueueScheduler, WaitsArePropagatedThroughOtherQueues)
+{
+	RecordingQueueBackend backend;
+	QueueScheduler scheduler(&backend);
+
+	//copy -> compute -> direct. Direct waits compute, which waited copy, so direct doesn't wait copy again.
+	QueueSyncPoint copy = scheduler.Submit(CommandQueueType::Copy, &s_Lists[0], 1);
+	QueueSyncPoint compute = scheduler.Submit(CommandQueueType::Compute, &s_Lists[1], 1, { copy });
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[2], 1, { compute, copy });
+
+	HT_CHECK_EQ(backend.TakeCalls(), Calls(
+	{
+		"Execute Copy 1", "Signal Copy 1", "Wait Compute Copy 1", "Execute Compute 1",
+		"Signal Compute 1", "Wait Direct Compute 1", "Execute Direct 1"
+	}));
+
+	HT_CHECK_EQ(scheduler.GetStats().Waits, 2ull);
+	HT_CHECK_EQ(scheduler.GetStats().SkippedWaits, 1ull);
+
+	scheduler.Flush();
+	const SimulatedExecution* copyExecution = backend.GetQueues().FindExecution(s_Lists[0]);
+	const SimulatedExecution* directExecution = backend.GetQueues().FindExecution(s_Lists[2]);
+	HT_CHECK(copyExecution && directExecution && directExecution->Start >= copyExecution->End);
+}
+
+namespace
+{
+	//Compute 1 is signaled before compute waits copy 1, compute 2 after it. Then the frame ring signals compute 3 on its own, so there is no record of 3.
+	struct ComputeHistory
+	{
+		QueueSyncPoint ComputeBefore, Copy, ComputeAfter, External;
+
+		ComputeHistory(RecordingQueueBackend& backend, QueueScheduler& scheduler)
+		{
+			ComputeBefore = scheduler.Submit(CommandQueueType::Compute, &s_Lists[0], 1);
+			scheduler.Signal(CommandQueueType::Compute);
+
+			Copy = scheduler.Submit(CommandQueueType::Copy, &s_Lists[1], 1);
+			ComputeAfter = scheduler.Submit(CommandQueueType::Compute, &s_Lists[2], 1, { Copy });
+			scheduler.Signal(CommandQueueType::Compute);
+
+			External = { CommandQueueType::Compute, backend.Signal(CommandQueueType::Compute) };
+			backend.TakeCalls();
+		}
+	};
+}
+
+HT_TEST(QueueScheduler, SignalsBeforeAWaitDontPropagateIt)
+{
+	RecordingQueueBackend backend;
+	QueueScheduler scheduler(&backend);
+	ComputeHistory history(backend, scheduler);
+
+	//Compute 1 says nothing about copy, direct still has to wait it
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[3], 1, { history.ComputeBefore, history.Copy });
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Wait Direct Compute 1", "Wait Direct Copy 1", "Execute Direct 1" }));
+
+	scheduler.Flush();
+	HT_CHECK(!backend.GetQueues().Run().Deadlocked);
+}
+
+HT_TEST(QueueScheduler, ValuesSignaledOutsideUseTheLastRecord)
+{
+	RecordingQueueBackend backend;
+	QueueScheduler scheduler(&backend);
+	ComputeHistory history(backend, scheduler);
+	HT_CHECK_EQ(history.External.FenceValue, 3ull);
+
+	//What compute knew at 2 it still knew at 3, so copy 1 is known to be done
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[3], 1, { history.External, history.Copy });
+	scheduler.Submit(CommandQueueType::Direct, &s_Lists[4], 1, { history.ComputeAfter });
+	HT_CHECK_EQ(backend.TakeCalls(), Calls({ "Wait Direct Compute 3", "Execute Direct 1", "Execute Direct 1" }));
+	HT_CHECK_EQ(scheduler.GetStats().SkippedWaits, 2ull);
+
+	scheduler.Flush();
+	HT_CHECK(!backend.GetQueues().Run().Deadlocked);
+}
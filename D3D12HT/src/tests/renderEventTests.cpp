@@ -0,0 +1,288 @@
+#include "testFramework.h"
+
+#include <atomic>
+#include <thread>
+
+#include <core/renderEvents.h>
+#include <core/spscQueue.h>
+
+using namespace HT;
+
+HT_TEST(SPSCQueue, FullAndEmpty)
+{
+	SPSCQueue<uint32_t, 4> queue;
+	uint32_t value = 0;
+
+	HT_CHECK(!queue.TryPop(value));
+
+	for (uint32_t i = 0; i < 4; i++)
+		HT_CHECK(queue.TryPush(i));
+
+	HT_CHECK(!queue.TryPush(4));
+	HT_CHECK_EQ(queue.GetSizeApprox(), 4u);
+
+	//A slot that is freed can be used again, in order around the ring
+	HT_CHECK(queue.TryPop(value));
+	HT_CHECK_EQ(value, 0u);
+	HT_CHECK(queue.TryPush(4));
+
+	for (uint32_t i = 1; i <= 4; i++)
+	{
+		HT_CHECK(queue.TryPop(value));
+		HT_CHECK_EQ(value, i);
+	}
+
+	HT_CHECK(queue.IsEmptyApprox());
+}
+
+HT_TEST(SPSCQueue, ProducerAndConsumerKeepTheOrder)
+{
+	//A small ring, so it is full and empty all the time and wraps around many times
+	static SPSCQueue<uint64_t, 64> queue;
+	const uint64_t count = 1000000;
+
+	std::thread producer([count]()
+	{
+		for (uint64_t i = 0; i < count; i++)
+		{
+			while (!queue.TryPush(i))
+				std::this_thread::yield();
+		}
+	});
+
+	uint64_t expected = 0;
+	uint64_t outOfOrder = 0;
+
+	while (expected < count)
+	{
+		uint64_t value;
+		if (!queue.TryPop(value))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		outOfOrder += value != expected;
+		expected++;
+	}
+
+	producer.join();
+
+	HT_CHECK_EQ(outOfOrder, 0ull);
+	HT_CHECK(queue.IsEmptyApprox());
+}
+
+HT_TEST(RenderEventQueue, EventsAreMerged)
+{
+	RenderEventQueue queue;
+
+	queue.Post(RenderEvent::MakeResize(100, 100));
+	queue.Post(RenderEvent::MakeToggleVSync());
+	queue.Post(RenderEvent::MakeSetFramesInFlight(2));
+	queue.Post(RenderEvent::MakeResize(200, 150));
+	queue.Post(RenderEvent::MakeToggleVSync());
+	queue.Post(RenderEvent::MakeToggleCPUTrace());
+	queue.Post(RenderEvent::MakeSetFramesInFlight(3));
+	queue.Post(RenderEvent::MakeSetFullscreen(true));
+	queue.Post(RenderEvent::MakeSetFullscreen(false));
+	queue.Post(RenderEvent::MakeExportFrameStats(FrameStatsFormat::CSV));
+	queue.Post(RenderEvent::MakeExportFrameStats(FrameStatsFormat::JSON));
+
+	//The resizes and the fullscreen changes are kept as their last value before they get to the queue, they count once each
+	RenderFrameCommands commands = queue.Drain();
+	HT_CHECK_EQ(commands.EventCount, 9u);
+
+	//The last size and value win
+	HT_CHECK(commands.Resize);
+	HT_CHECK_EQ(commands.Width, 200u);
+	HT_CHECK_EQ(commands.Height, 150u);
+	HT_CHECK_EQ(commands.FramesInFlight, 3u);
+	HT_CHECK(commands.SetFullscreen);
+	HT_CHECK(!commands.Fullscreen);
+
+	//Two toggles cancel out, one doesn't
+	HT_CHECK(!commands.ToggleVSync);
+	HT_CHECK(commands.ToggleCPUTrace);
+	HT_CHECK(!commands.TogglePacingMode);
+
+	//Both exports are done
+	HT_CHECK_EQ(commands.ExportFrameStats, (uint32_t)FrameStatsFormat::CSV | (uint32_t)FrameStatsFormat::JSON);
+
+	HT_CHECK_EQ(commands.MaxFrameLatency, 0u);
+	HT_CHECK(queue.Drain().IsEmpty());
+}
+
+//The window thread posts while the render thread drains between "frames". Whatever the drains cut, no event is lost or reordered:
+//the sizes only grow and never tear, the last drain ends with the last size and the toggles of all the drains add up to the ones posted.
+HT_TEST(RenderEventQueue, ProducerAndConsumerStress)
+{
+	static RenderEventQueue queue;
+	static std::atomic<bool> posted = false;
+	const uint32_t resizeCount = 200000;
+
+	//This test wants every key press, so it waits when the queue is full. The window thread doesn't.
+	std::thread windowThread([resizeCount]()
+	{
+		for (uint32_t i = 1; i <= resizeCount; i++)
+		{
+			queue.Post(RenderEvent::MakeResize(i, i * 2));
+
+			if (i % 3 == 0)
+			{
+				while (!queue.Post(RenderEvent::MakeToggleVSync()))
+					std::this_thread::yield();
+			}
+
+			if (i % 7 == 0)
+			{
+				while (!queue.Post(RenderEvent::MakeSetMaxFrameLatency(i)))
+					std::this_thread::yield();
+			}
+		}
+
+		posted = true;
+	});
+
+	const uint32_t toggleCount = resizeCount / 3;
+	const uint32_t latencyCount = resizeCount / 7;
+
+	uint32_t queued = 0;
+	uint32_t lastWidth = 0;
+	uint32_t lastLatency = 0;
+	bool vsyncToggled = false;
+	uint32_t outOfOrder = 0;
+	uint32_t badSizes = 0;
+
+	//Once everything is posted, one more drain takes what is left
+	for (bool done = false; !done; )
+	{
+		done = posted;
+
+		RenderFrameCommands commands = queue.Drain();
+		if (commands.IsEmpty())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		queued += commands.EventCount;
+
+		if (commands.Resize)
+		{
+			queued--;
+			outOfOrder += commands.Width <= lastWidth;
+			badSizes += commands.Height != commands.Width * 2;
+			lastWidth = commands.Width;
+		}
+
+		if (commands.MaxFrameLatency)
+		{
+			outOfOrder += commands.MaxFrameLatency <= lastLatency;
+			lastLatency = commands.MaxFrameLatency;
+		}
+
+		vsyncToggled ^= commands.ToggleVSync;
+	}
+
+	windowThread.join();
+
+	HT_CHECK_EQ(queued, toggleCount + latencyCount);
+	HT_CHECK_EQ(outOfOrder, 0u);
+	HT_CHECK_EQ(badSizes, 0u);
+	HT_CHECK_EQ(lastWidth, resizeCount);
+	HT_CHECK_EQ(lastLatency, latencyCount * 7);
+	HT_CHECK_EQ(vsyncToggled, (toggleCount % 2) == 1);
+	HT_CHECK(queue.Drain().IsEmpty());
+}
+
+//The render thread is stuck (e.g. in a SetWindowPos waiting for the window thread): Post must return, whatever is posted
+HT_TEST(RenderEventQueue, PostNeverWaitsOnAFullQueue)
+{
+	RenderEventQueue queue;
+
+	uint32_t accepted = 0;
+	while (queue.Post(RenderEvent::MakeToggleVSync()))
+		accepted++;
+
+	HT_CHECK(accepted > 0);
+	HT_CHECK_EQ(queue.GetDroppedCount(), 1ull);
+	HT_CHECK(!queue.Post(RenderEvent::MakeToggleCPUTrace()));
+	HT_CHECK_EQ(queue.GetDroppedCount(), 2ull);
+
+	//A drag keeps resizing and the fullscreen can still change, only their last value is kept
+	for (uint32_t i = 1; i <= 5000; i++)
+		HT_CHECK(queue.Post(RenderEvent::MakeResize(i, i + 1)));
+	HT_CHECK(queue.Post(RenderEvent::MakeSetFullscreen(true)));
+
+	RenderFrameCommands commands = queue.Drain();
+	HT_CHECK_EQ(commands.EventCount, accepted + 2);
+	HT_CHECK_EQ(commands.ToggleVSync, (accepted % 2) == 1);
+	HT_CHECK(!commands.ToggleCPUTrace);
+	HT_CHECK(commands.Resize);
+	HT_CHECK_EQ(commands.Width, 5000u);
+	HT_CHECK_EQ(commands.Height, 5001u);
+	HT_CHECK(commands.SetFullscreen && commands.Fullscreen);
+
+	//Drained, there is room again
+	HT_CHECK(queue.Post(RenderEvent::MakeToggleVSync()));
+	HT_CHECK(queue.Drain().ToggleVSync);
+}
+
+namespace
+{
+	//What Resize does on the render thread: a new size waits for the frames in flight, the same size is skipped
+	struct ResizingRenderThread
+	{
+		RenderEventQueue& Queue;
+		uint32_t Width = 800;
+		uint32_t Height = 600;
+		uint32_t Idles = 0;
+
+		void Frame()
+		{
+			RenderFrameCommands commands = Queue.Drain();
+			if (commands.Resize && (commands.Width != Width || commands.Height != Height))
+			{
+				Width = commands.Width;
+				Height = commands.Height;
+				Idles++;
+			}
+		}
+	};
+}
+
+HT_TEST(WindowResizeFilter, OneIdlePerDrag)
+{
+	RenderEventQueue queue;
+	WindowResizeFilter filter(queue);
+	ResizingRenderThread renderThread = { queue };
+
+	//A WM_SIZE for every mouse move, with frames in between: nothing reaches the render thread until the drag ends
+	filter.BeginSizeMove();
+	for (uint32_t i = 1; i <= 300; i++)
+	{
+		filter.OnSize(800 + i, 600 + i / 2);
+		renderThread.Frame();
+	}
+	HT_CHECK_EQ(renderThread.Idles, 0u);
+
+	filter.EndSizeMove(1100, 750);
+	renderThread.Frame();
+	HT_CHECK_EQ(renderThread.Idles, 1u);
+	HT_CHECK_EQ(renderThread.Width, 1100u);
+	HT_CHECK_EQ(renderThread.Height, 750u);
+
+	//Moving the window ends with the same size
+	filter.BeginSizeMove();
+	filter.EndSizeMove(1100, 750);
+	renderThread.Frame();
+	HT_CHECK_EQ(renderThread.Idles, 1u);
+
+	//Maximize doesn't drag, it resizes right away. Sizes posted between two frames still cost one idle.
+	HT_CHECK(!filter.IsInSizeMove());
+	filter.OnSize(1920, 1080);
+	filter.OnSize(1920, 1017);
+	renderThread.Frame();
+	HT_CHECK_EQ(renderThread.Idles, 2u);
+	HT_CHECK_EQ(renderThread.Height, 1017u);
+}
@@ -0,0 +1,181 @@
+#include "testFramework.h"
+
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/residencyManager.h>
+
+using namespace HT;
+
+namespace
+{
+	const uint64_t s_MB = 1024 * 1024;
+
+	//Remembers the heaps of every Evict call, in the order they were given
+	class RecordingResidencyBackend : public CPUResidencyBackend
+	{
+	public:
+		std::vector<std::vector<void*>> Evictions;
+
+		void Evict(const ResidencyHeap* heaps, uint32_t count) override
+		{
+			std::vector<void*> evicted;
+			for (uint32_t i = 0; i < count; i++)
+				evicted.push_back(heaps[i].NativeHeap);
+
+			Evictions.push_back(evicted);
+			CPUResidencyBackend::Evict(heaps, count);
+		}
+	};
+
+	//Heaps of 30MB in VRAM, frames driven like the renderer does: BeginFrame, MarkUsed, Commit, then the frame ring signals and EndFrame gets the value
+	struct ResidencyScene
+	{
+		RecordingResidencyBackend Backend;
+		CPUFence Fence;
+		ResidencyManager Manager;
+
+		std::vector<void*> Heaps;
+		std::vector<ResidencyHandle> Handles;
+
+		ResidencyScene(uint64_t budget) : Manager(&Backend, &Backend, &Fence, { 1.0f, 1 })
+		{
+			Backend.SetBudget(MemorySegment::Local, budget);
+		}
+
+		uint32_t AddHeap()
+		{
+			Heaps.push_back(Backend.CreateHeap(30 * s_MB, MemorySegment::Local));
+			Handles.push_back(Manager.Register(Heaps.back(), 30 * s_MB, MemorySegment::Local));
+			return (uint32_t)Heaps.size() - 1;
+		}
+
+		//The GPU finishes the frame right away unless told otherwise
+		void Frame(const std::vector<uint32_t>& used, bool complete = true)
+		{
+			Manager.BeginFrame();
+			for (uint32_t heap : used)
+				Manager.MarkUsed(Handles[heap]);
+			Manager.Commit();
+
+			uint64_t value = Fence.Signal();
+			Manager.EndFrame(value);
+			if (complete)
+				Fence.Complete(value);
+		}
+
+		bool IsResident(uint32_t heap) const
+		{
+			return Manager.IsResident(Handles[heap]) && Backend.IsResident(Heaps[heap]);
+		}
+	};
+}
+
+HT_TEST(ResidencyManager, LeastRecentlyUsedIsEvictedFirst)
+{
+	ResidencyScene scene(100 * s_MB);
+
+	uint32_t a = scene.AddHeap();
+	uint32_t b = scene.AddHeap();
+	uint32_t c = scene.AddHeap();
+
+	//Used in the order a, b, c. 90MB fit.
+	scene.Frame({ a });
+	scene.Frame({ b });
+	scene.Frame({ c });
+	HT_CHECK(scene.Backend.Evictions.empty());
+
+	//120MB: only the oldest one goes, 90MB is under the budget again
+	uint32_t d = scene.AddHeap();
+	scene.Frame({ d });
+	HT_CHECK(scene.Backend.Evictions == std::vector<std::vector<void*>>({ { scene.Heaps[a] } }));
+	HT_CHECK(!scene.IsResident(a));
+	HT_CHECK(scene.IsResident(b) && scene.IsResident(c) && scene.IsResident(d));
+
+	//a comes back for a frame that uses it: b is the oldest now, it makes room in the same Commit
+	scene.Frame({ a, d });
+	HT_CHECK_EQ(scene.Backend.Evictions.size(), (size_t)2);
+	HT_CHECK(scene.Backend.Evictions.back() == std::vector<void*>({ scene.Heaps[b] }));
+	HT_CHECK(scene.IsResident(a));
+	HT_CHECK(!scene.IsResident(b));
+
+	ResidencyStats stats = scene.Manager.GetStats();
+	HT_CHECK_EQ(stats.ResidentBytes[(uint32_t)MemorySegment::Local], 90 * s_MB);
+	HT_CHECK_EQ(stats.EvictedBytes[(uint32_t)MemorySegment::Local], 30 * s_MB);
+	HT_CHECK_EQ(stats.EvictedHeapCount, 1u);
+	HT_CHECK_EQ(stats.HeapsEvicted, 2ull);
+	HT_CHECK_EQ(stats.HeapsMadeResident, 1ull);
+	HT_CHECK_EQ(stats.MakeResidentCalls, 1ull);
+	HT_CHECK_EQ(stats.OverBudgetFrames, 0ull);
+
+	//The budget shrinks (another app): c is older than a, both go in one call, oldest first
+	scene.Backend.SetBudget(MemorySegment::Local, 50 * s_MB);
+	scene.Frame({ d });
+	HT_CHECK(scene.Backend.Evictions.back() == std::vector<void*>({ scene.Heaps[c], scene.Heaps[a] }));
+	HT_CHECK(scene.IsResident(d));
+	HT_CHECK_EQ(scene.Backend.GetEvictCalls(), 3ull);
+}
+
+HT_TEST(ResidencyManager, HeapsTheGPUMayUseAreNotEvicted)
+{
+	ResidencyScene scene(100 * s_MB);
+
+	uint32_t a = scene.AddHeap();
+	uint32_t b = scene.AddHeap();
+
+	//b's frame is still on the GPU
+	scene.Frame({ a });
+	scene.Frame({ b }, false);
+
+	//Nothing fits, but only a can go: b may still be used and the frame needs the third one
+	scene.Backend.SetBudget(MemorySegment::Local, 10 * s_MB);
+	uint32_t c = scene.AddHeap();
+	scene.Frame({ c }, false);
+
+	HT_CHECK(!scene.IsResident(a));
+	HT_CHECK(scene.IsResident(b));
+	HT_CHECK(scene.IsResident(c));
+	HT_CHECK_EQ(scene.Manager.GetStats().OverBudgetFrames, 1ull);
+
+	//Once the GPU is done, b is the least recently used
+	scene.Fence.CompleteAll();
+	scene.Frame({ c });
+	HT_CHECK(!scene.IsResident(b));
+	HT_CHECK(scene.IsResident(c));
+
+	//Unregistered heaps are forgotten, evicted or not
+	scene.Manager.Unregister(scene.Handles[a]);
+	scene.Manager.Unregister(scene.Handles[b]);
+	ResidencyStats stats = scene.Manager.GetStats();
+	HT_CHECK_EQ(stats.HeapCount, 1u);
+	HT_CHECK_EQ(stats.EvictedHeapCount, 0u);
+	HT_CHECK_EQ(stats.EvictedBytes[(uint32_t)MemorySegment::Local], 0ull);
+}
+
+//Someone else signals the fence while the frame records (a sync point of the scheduler). Its value completing says nothing about the frame.
+HT_TEST(ResidencyManager, OnlyTheValueOfTheFrameFreesItsHeaps)
+{
+	ResidencyScene scene(100 * s_MB);
+
+	uint32_t a = scene.AddHeap();
+	uint32_t b = scene.AddHeap();
+	scene.Frame({ a });
+
+	scene.Manager.BeginFrame();
+	scene.Manager.MarkUsed(scene.Handles[b]);
+	scene.Manager.Commit();
+	scene.Fence.Complete(scene.Fence.Signal());
+	scene.Manager.EndFrame(scene.Fence.Signal());
+
+	//No room for either: b's frame is still on the GPU, only a goes
+	scene.Backend.SetBudget(MemorySegment::Local, 20 * s_MB);
+	scene.Frame({}, false);
+	HT_CHECK(!scene.IsResident(a));
+	HT_CHECK(scene.IsResident(b));
+	HT_CHECK_EQ(scene.Manager.GetStats().OverBudgetFrames, 1ull);
+
+	scene.Fence.CompleteAll();
+	scene.Frame({ a });
+	HT_CHECK(scene.IsResident(a));
+	HT_CHECK(!scene.IsResident(b));
+}
@@ -0,0 +1,208 @@
+#include "testFramework.h"
+
+#include <vector>
+
+#include <renderer/resourceStateTracker.h>
+
+using namespace HT;
+
+namespace HTTest
+{
+	static std::string ToString(const std::vector<ResourceBarrier>& barriers)
+	{
+		std::string text = "[";
+		for (const ResourceBarrier& barrier : barriers)
+		{
+			text += " { type " + std::to_string((uint32_t)barrier.Type) + ", flags " + std::to_string((uint32_t)barrier.Flags) + ", resource " + std::to_string(barrier.Resource);
+			text += ", " + std::to_string((uint32_t)barrier.Before) + " -> " + std::to_string((uint32_t)barrier.After) + " }";
+		}
+		return text + " ]";
+	}
+}
+
+namespace
+{
+	using Barriers = std::vector<ResourceBarrier>;
+
+	ResourceBarrier MakeTransition(ResourceId resource, ResourceState before, ResourceState after, BarrierFlags flags = BarrierFlags::None)
+	{
+		return { BarrierType::Transition, flags, resource, before, after };
+	}
+}
+
+HT_TEST(ResourceStateTracker, RedundantTransitionsAreDropped)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::RenderTarget);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	tracker.Transition(1, ResourceState::RenderTarget);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers());
+
+	tracker.Transition(1, ResourceState::PixelShaderResource);
+	tracker.Transition(1, ResourceState::PixelShaderResource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, ResourceState::RenderTarget, ResourceState::PixelShaderResource) }));
+
+	HT_CHECK_EQ(tracker.GetStats().DroppedTransitions, 2ull);
+	HT_CHECK_EQ(tracker.GetStats().EmittedBarriers, 1ull);
+	HT_CHECK_EQ(tracker.GetStats().Flushes, 1ull);
+}
+
+HT_TEST(ResourceStateTracker, TransitionsInABatchCollapse)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::Common);
+	registry.Register(2, ResourceState::Common);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	//A->B->A cancels out
+	tracker.Transition(1, ResourceState::RenderTarget);
+	tracker.Transition(1, ResourceState::Common);
+
+	//A->B->C is A->C
+	tracker.Transition(2, ResourceState::CopyDest);
+	tracker.Transition(2, ResourceState::UnorderedAccess);
+
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(2, ResourceState::Common, ResourceState::UnorderedAccess) }));
+
+	//Across a flush nothing can be collapsed, the work in the middle needs the state
+	tracker.Transition(2, ResourceState::CopySource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(2, ResourceState::UnorderedAccess, ResourceState::CopySource) }));
+	tracker.Transition(2, ResourceState::UnorderedAccess);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(2, ResourceState::CopySource, ResourceState::UnorderedAccess) }));
+}
+
+HT_TEST(ResourceStateTracker, ReadStatesAreMerged)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::PixelShaderResource);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	const ResourceState combined = ResourceState::PixelShaderResource | ResourceState::CopySource;
+
+	tracker.Transition(1, ResourceState::CopySource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, ResourceState::PixelShaderResource, combined) }));
+
+	//Both reads are already allowed, nothing to do
+	tracker.Transition(1, ResourceState::PixelShaderResource);
+	tracker.Transition(1, ResourceState::CopySource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers());
+
+	//A write leaves the combined state
+	tracker.Transition(1, ResourceState::CopyDest);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, combined, ResourceState::CopyDest) }));
+}
+
+HT_TEST(ResourceStateTracker, SplitBarriersAroundWork)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::RenderTarget);
+	registry.Register(2, ResourceState::RenderTarget);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	//Work between the begin and the end: BEGIN_ONLY, then END_ONLY
+	tracker.BeginTransition(1, ResourceState::PixelShaderResource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, ResourceState::RenderTarget, ResourceState::PixelShaderResource, BarrierFlags::BeginOnly) }));
+
+	tracker.Transition(1, ResourceState::PixelShaderResource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, ResourceState::RenderTarget, ResourceState::PixelShaderResource, BarrierFlags::EndOnly) }));
+
+	//No work in between: a normal transition
+	tracker.BeginTransition(2, ResourceState::CopySource);
+	tracker.Transition(2, ResourceState::CopySource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(2, ResourceState::RenderTarget, ResourceState::CopySource) }));
+
+	HT_CHECK_EQ(tracker.GetStats().SplitBarriers, 1ull);
+}
+
+HT_TEST(ResourceStateTracker, CloseEndsOpenSplitBarriers)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::Common);
+	registry.Register(2, ResourceState::Common);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	tracker.BeginTransition(1, ResourceState::CopyDest);
+	tracker.FlushBarriers();
+
+	//Begun in the last batch, it becomes a normal transition
+	tracker.BeginTransition(2, ResourceState::CopyDest);
+	tracker.Close();
+
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers(
+	{
+		MakeTransition(2, ResourceState::Common, ResourceState::CopyDest),
+		MakeTransition(1, ResourceState::Common, ResourceState::CopyDest, BarrierFlags::EndOnly)
+	}));
+
+	tracker.CommitFinalStates(registry);
+	HT_CHECK_EQ(registry.Get(1), ResourceState::CopyDest);
+	HT_CHECK_EQ(registry.Get(2), ResourceState::CopyDest);
+}
+
+HT_TEST(ResourceStateTracker, FirstUsesAreResolvedOnSubmit)
+{
+	ResourceStateTracker tracker;
+	tracker.Reset();
+
+	//Without a registry the first use of each resource only records the state it needs
+	tracker.Transition(1, ResourceState::RenderTarget);
+	tracker.Transition(2, ResourceState::PixelShaderResource);
+	tracker.Transition(2, ResourceState::NonPixelShaderResource);
+	tracker.Transition(3, ResourceState::CopyDest);
+	tracker.UAVBarrier(4);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ { BarrierType::UAV, BarrierFlags::None, 4, ResourceState::UnorderedAccess, ResourceState::UnorderedAccess } }));
+
+	//After the first use the transitions are recorded in the list
+	tracker.Transition(1, ResourceState::PixelShaderResource);
+	HT_CHECK_EQ(tracker.FlushBarriers(), Barriers({ MakeTransition(1, ResourceState::RenderTarget, ResourceState::PixelShaderResource) }));
+	tracker.Close();
+
+	//What the lists submitted before this one left
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::Common);
+	registry.Register(2, ResourceState::CopyDest);
+	registry.Register(3, ResourceState::CopyDest);
+	registry.Register(4, ResourceState::PixelShaderResource);
+
+	Barriers resolved;
+	tracker.ResolvePendingBarriers(registry, resolved);
+
+	//In the order of the first uses, 3 is already in its state. The reads of 2 were merged in its first use.
+	HT_CHECK_EQ(resolved, Barriers(
+	{
+		MakeTransition(1, ResourceState::Common, ResourceState::RenderTarget),
+		MakeTransition(2, ResourceState::CopyDest, ResourceState::PixelShaderResource | ResourceState::NonPixelShaderResource),
+		MakeTransition(4, ResourceState::PixelShaderResource, ResourceState::UnorderedAccess)
+	}));
+
+	tracker.CommitFinalStates(registry);
+	HT_CHECK_EQ(registry.Get(1), ResourceState::PixelShaderResource);
+	HT_CHECK_EQ(registry.Get(4), ResourceState::UnorderedAccess);
+}
+
+HT_TEST(ResourceStateTracker, OneUAVBarrierPerBatch)
+{
+	ResourceStateRegistry registry;
+	registry.Register(1, ResourceState::UnorderedAccess);
+
+	ResourceStateTracker tracker;
+	tracker.Reset(&registry);
+
+	tracker.UAVBarrier(1);
+	tracker.UAVBarrier(1);
+	HT_CHECK_EQ(tracker.FlushBarriers().size(), (size_t)1);
+
+	tracker.UAVBarrier(1);
+	HT_CHECK_EQ(tracker.FlushBarriers().size(), (size_t)1);
+}
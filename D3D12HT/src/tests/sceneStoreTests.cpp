@@ -0,0 +1,138 @@
+#include "testFramework.h"
+
+#include <vector>
+
+#include <scene/sceneStore.h>
+
+using namespace HT;
+
+namespace
+{
+	struct Velocity { float X, Y, Z; };
+	struct Health { uint32_t Value; };
+
+	SceneTransform Translation(float x, float y, float z)
+	{
+		SceneTransform transform;
+		transform.Position = { x, y, z };
+		return transform;
+	}
+
+	//Row vectors, the translation is the last row
+	bool HasTranslation(const HTUtils::HTMat4& matrix, float x, float y, float z)
+	{
+		return matrix.m[3][0] == x && matrix.m[3][1] == y && matrix.m[3][2] == z;
+	}
+}
+
+HT_TEST(SceneStore, DestroyedIndicesComeBackWithANewGeneration)
+{
+	SceneStore store;
+
+	EntityHandle first = store.Create();
+	EntityHandle other = store.Create();
+	store.Destroy(first);
+
+	HT_CHECK(!store.IsAlive(first));
+	HT_CHECK_EQ(store.GetEntityCount(), 1u);
+
+	//Same slot, next generation: the old handle doesn't see the new entity
+	EntityHandle second = store.Create();
+	HT_CHECK_EQ(second.Index, first.Index);
+	HT_CHECK_EQ(second.Generation, first.Generation + 1);
+	HT_CHECK(second != first);
+	HT_CHECK(store.IsAlive(second));
+	HT_CHECK(!store.IsAlive(first));
+	HT_CHECK(store.IsAlive(other));
+	HT_CHECK_ASSERT(store.GetWorldMatrix(first));
+	HT_CHECK_ASSERT(store.Destroy(first));
+
+	//Again and again, the generation keeps growing
+	EntityHandle last = second;
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		store.Destroy(last);
+		EntityHandle next = store.Create();
+		HT_CHECK_EQ(next.Index, first.Index);
+		HT_CHECK_EQ(next.Generation, last.Generation + 1);
+		last = next;
+	}
+
+	//A default handle is never alive
+	HT_CHECK(!store.IsAlive(EntityHandle()));
+}
+
+HT_TEST(SceneStore, ReusedEntitiesStartClean)
+{
+	SceneStore store;
+	ComponentId velocity = store.RegisterComponent<Velocity>("Velocity");
+	ComponentId health = store.RegisterComponent<Health>("Health");
+
+	//A parent with a child, both with components
+	EntityHandle parent = store.Create({}, Translation(1.0f, 0.0f, 0.0f));
+	EntityHandle child = store.Create(parent, Translation(0.0f, 2.0f, 0.0f));
+	store.AddComponent(parent, velocity, Velocity{ 1.0f, 2.0f, 3.0f });
+	store.AddComponent(child, health, Health{ 50 });
+
+	store.UpdateTransforms();
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(child), 1.0f, 2.0f, 0.0f));
+
+	//The children go with the parent
+	store.Destroy(parent);
+	HT_CHECK(!store.IsAlive(child));
+	HT_CHECK_EQ(store.GetEntityCount(), 0u);
+
+	//Both slots are reused: no components, no parent, and the world matrix is their own after the update
+	EntityHandle a = store.Create({}, Translation(0.0f, 0.0f, 5.0f));
+	EntityHandle b = store.Create({}, Translation(0.0f, 0.0f, 7.0f));
+	HT_CHECK(a.Index == parent.Index || a.Index == child.Index);
+	HT_CHECK(b.Index == parent.Index || b.Index == child.Index);
+
+	for (EntityHandle entity : { a, b })
+	{
+		HT_CHECK(!store.HasComponent(entity, velocity));
+		HT_CHECK(!store.HasComponent(entity, health));
+		HT_CHECK(store.GetComponent(entity, velocity) == nullptr);
+		HT_CHECK(!store.GetParent(entity).IsValid());
+	}
+
+	store.UpdateTransforms();
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(a), 0.0f, 0.0f, 5.0f));
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(b), 0.0f, 0.0f, 7.0f));
+
+	//Only the archetype without components has entities
+	uint32_t withVelocity = 0;
+	store.ForEachArchetype(1ull << velocity, [&withVelocity](const SceneArchetypeView& view) { withVelocity += view.Count; });
+	HT_CHECK_EQ(withVelocity, 0u);
+}
+
+HT_TEST(SceneStore, OnlyDirtyBranchesAreUpdated)
+{
+	SceneStore store;
+
+	EntityHandle root = store.Create({}, Translation(1.0f, 0.0f, 0.0f));
+	EntityHandle left = store.Create(root, Translation(0.0f, 1.0f, 0.0f));
+	EntityHandle leftChild = store.Create(left, Translation(0.0f, 0.0f, 1.0f));
+	EntityHandle right = store.Create(root, Translation(0.0f, -1.0f, 0.0f));
+
+	store.UpdateTransforms();
+	HT_CHECK_EQ(store.GetChangedEntities().size(), (size_t)4);
+	HT_CHECK_EQ(store.GetUpdateStats().Levels, 3u);
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(leftChild), 1.0f, 1.0f, 1.0f));
+
+	store.UpdateTransforms();
+	HT_CHECK(store.GetChangedEntities().empty());
+
+	//Moving the left branch changes it and what is under it, parents first
+	store.SetLocalTransform(left, Translation(0.0f, 3.0f, 0.0f));
+	store.UpdateTransforms();
+	HT_CHECK(store.GetChangedEntities() == std::vector<EntityHandle>({ left, leftChild }));
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(leftChild), 1.0f, 3.0f, 1.0f));
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(right), 1.0f, -1.0f, 0.0f));
+
+	//A new parent keeps the local transform, the world one follows the new parent
+	store.SetParent(leftChild, right);
+	store.UpdateTransforms();
+	HT_CHECK(store.GetParent(leftChild) == right);
+	HT_CHECK(HasTranslation(store.GetWorldMatrix(leftChild), 1.0f, -1.0f, 1.0f));
+}
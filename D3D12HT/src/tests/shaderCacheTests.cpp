@@ -0,0 +1,275 @@
+#include "testFramework.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <renderer/shaderCache.h>
+
+using namespace HT;
+
+namespace
+{
+	//A directory of its own for the disk cache, removed at the end of the test
+	struct TempDirectory
+	{
+		std::string Path;
+
+		explicit TempDirectory(const char* name)
+		{
+			Path = (std::filesystem::temp_directory_path() / (std::string("HTShaderCacheTests_") + name)).string();
+			std::filesystem::remove_all(Path);
+		}
+
+		~TempDirectory()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(Path, error);
+		}
+	};
+
+	void AddShaders(MemoryShaderSourceProvider& sources)
+	{
+		sources.SetFile("shaders/common.hlsli", "float4 Tint;\n");
+		sources.SetFile("shaders/lighting.hlsli", "#include \"common.hlsli\"\nfloat3 Light;\n");
+		sources.SetFile("shaders/mesh.hlsl", "#include \"lighting.hlsli\"\n#include \"common.hlsli\"\nfloat4 main() : SV_Target { return Tint; }\n");
+		sources.SetFile("shaders/post.hlsl", "#include \"common.hlsli\"\nfloat4 main() : SV_Target { return 0; }\n");
+	}
+
+	ShaderDesc MakeDesc(const char* path, const char* target = "ps_5_1")
+	{
+		ShaderDesc desc;
+		desc.Path = path;
+		desc.Target = target;
+		return desc;
+	}
+
+	void OverwriteFile(const std::string& path, const std::string& content)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << content;
+	}
+}
+
+HT_TEST(ShaderCache, KeysFollowEverythingThatChangesTheOutput)
+{
+	MemoryShaderSourceProvider sources;
+	AddShaders(sources);
+
+	StubShaderCompiler compiler;
+	ShaderCompilationService service(&compiler, &sources);
+
+	ShaderDesc mesh = MakeDesc("shaders/mesh.hlsl");
+	uint64_t key = service.ComputeKey(mesh);
+	HT_CHECK(key != 0);
+	HT_CHECK_EQ(service.ComputeKey(mesh), key);
+
+	ShaderDesc withDefine = mesh;
+	withDefine.Defines.push_back({ "SHADOWS", "1" });
+	ShaderDesc otherValue = mesh;
+	otherValue.Defines.push_back({ "SHADOWS", "0" });
+	ShaderDesc otherTarget = MakeDesc("shaders/mesh.hlsl", "ps_6_0");
+	ShaderDesc otherEntry = mesh;
+	otherEntry.EntryPoint = "MainPS";
+	ShaderDesc debug = mesh;
+	debug.Debug = true;
+
+	std::vector<uint64_t> keys = { key, service.ComputeKey(withDefine), service.ComputeKey(otherValue), service.ComputeKey(otherTarget), service.ComputeKey(otherEntry), service.ComputeKey(debug) };
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		for (size_t j = i + 1; j < keys.size(); j++)
+			HT_CHECK(keys[i] != keys[j]);
+	}
+
+	//An include two levels down changes the key of who includes it
+	uint64_t postKey = service.ComputeKey(MakeDesc("shaders/post.hlsl"));
+	sources.SetFile("shaders/common.hlsli", "float4 Tint;\nfloat Exposure;\n");
+	HT_CHECK(service.ComputeKey(mesh) != key);
+	HT_CHECK(service.ComputeKey(MakeDesc("shaders/post.hlsl")) != postKey);
+
+	//Back to the same content, back to the same key
+	sources.SetFile("shaders/common.hlsli", "float4 Tint;\n");
+	HT_CHECK_EQ(service.ComputeKey(mesh), key);
+
+	//The path is not in the key, only what it resolves to
+	sources.SetFile("shaders/copy.hlsl", "#include \"lighting.hlsli\"\n#include \"common.hlsli\"\nfloat4 main() : SV_Target { return Tint; }\n");
+	HT_CHECK_EQ(service.ComputeKey(MakeDesc("shaders/copy.hlsl")), key);
+
+	//A missing include is no key
+	sources.SetFile("shaders/broken.hlsl", "#include \"missing.hlsli\"\n");
+	HT_CHECK_EQ(service.ComputeKey(MakeDesc("shaders/broken.hlsl")), 0ull);
+	HT_CHECK_EQ(service.ComputeKey(MakeDesc("shaders/nothing.hlsl")), 0ull);
+}
+
+HT_TEST(ShaderCache, BatchCompilesEachKeyOnce)
+{
+	MemoryShaderSourceProvider sources;
+	AddShaders(sources);
+
+	StubShaderCompiler compiler;
+	JobSystem jobSystem(2);
+	ShaderCompilationService service(&compiler, &sources, nullptr, &jobSystem);
+
+	sources.SetFile("shaders/copy.hlsl", "#include \"common.hlsli\"\nfloat4 main() : SV_Target { return 0; }\n");
+
+	std::vector<ShaderCompileResult> results = service.CompileBatch(
+	{
+		MakeDesc("shaders/mesh.hlsl"), MakeDesc("shaders/post.hlsl"), MakeDesc("shaders/mesh.hlsl"), MakeDesc("shaders/copy.hlsl")
+	});
+
+	//copy.hlsl is post.hlsl under another name
+	HT_CHECK_EQ(compiler.GetCompileCount(), 2ull);
+	HT_CHECK_EQ(service.GetStats().Deduplicated, 2ull);
+	HT_CHECK_EQ(service.GetStats().Compiled, 2ull);
+
+	for (const ShaderCompileResult& result : results)
+		HT_CHECK(result.IsValid());
+
+	HT_CHECK(results[0].Bytecode == results[2].Bytecode);
+	HT_CHECK(results[1].Bytecode == results[3].Bytecode);
+	HT_CHECK(results[0].Bytecode != results[1].Bytecode);
+
+	//The next batch finds them in memory
+	ShaderCompileResult again = service.Compile(MakeDesc("shaders/mesh.hlsl"));
+	HT_CHECK(again.FromCache);
+	HT_CHECK(again.Bytecode == results[0].Bytecode);
+	HT_CHECK_EQ(service.GetStats().MemoryHits, 1ull);
+	HT_CHECK_EQ(compiler.GetCompileCount(), 2ull);
+}
+
+HT_TEST(ShaderCache, FailuresAreNotCached)
+{
+	MemoryShaderSourceProvider sources;
+	sources.SetFile("broken.hlsl", "#error not yet\n");
+
+	StubShaderCompiler compiler;
+	ShaderCompilationService service(&compiler, &sources);
+
+	ShaderCompileResult failed = service.Compile(MakeDesc("broken.hlsl"));
+	HT_CHECK(!failed.IsValid());
+	HT_CHECK(!failed.Errors.empty());
+	HT_CHECK_EQ(service.GetStats().Failed, 1ull);
+
+	//Same key, compiled again
+	HT_CHECK(!service.Compile(MakeDesc("broken.hlsl")).IsValid());
+	HT_CHECK_EQ(compiler.GetCompileCount(), 2ull);
+
+	sources.SetFile("broken.hlsl", "float4 main() : SV_Target { return 1; }\n");
+	HT_CHECK(service.Compile(MakeDesc("broken.hlsl")).IsValid());
+}
+
+HT_TEST(ShaderCache, WarmStartDoesntCompile)
+{
+	TempDirectory directory("WarmStart");
+
+	MemoryShaderSourceProvider sources;
+	AddShaders(sources);
+
+	const std::vector<ShaderDesc> descs = { MakeDesc("shaders/mesh.hlsl"), MakeDesc("shaders/post.hlsl"), MakeDesc("shaders/mesh.hlsl", "vs_5_1") };
+
+	std::vector<ShaderCompileResult> cold;
+	{
+		StubShaderCompiler compiler;
+		ShaderDiskCache diskCache(directory.Path);
+		ShaderCompilationService service(&compiler, &sources, &diskCache);
+
+		cold = service.CompileBatch(descs);
+		HT_CHECK_EQ(compiler.GetCompileCount(), 3ull);
+		HT_CHECK_EQ(diskCache.GetEntryCount(), (size_t)3);
+	}
+
+	//A new run: nothing in memory, everything on disk
+	StubShaderCompiler compiler;
+	ShaderDiskCache diskCache(directory.Path);
+	ShaderCompilationService service(&compiler, &sources, &diskCache);
+
+	std::vector<ShaderCompileResult> warm = service.CompileBatch(descs);
+	HT_CHECK_EQ(compiler.GetCompileCount(), 0ull);
+	HT_CHECK_EQ(service.GetStats().DiskHits, 3ull);
+
+	for (size_t i = 0; i < descs.size(); i++)
+	{
+		HT_CHECK(warm[i].FromCache);
+		HT_CHECK(warm[i].IsValid() && *warm[i].Bytecode == *cold[i].Bytecode);
+	}
+
+	//A changed include is a new key, only who includes it is compiled
+	sources.SetFile("shaders/lighting.hlsli", "#include \"common.hlsli\"\nfloat3 LightDirection;\n");
+	service.CompileBatch(descs);
+	HT_CHECK_EQ(compiler.GetCompileCount(), 2ull);
+}
+
+HT_TEST(ShaderCache, CorruptedFilesAreCompiledAgain)
+{
+	TempDirectory directory("Corrupted");
+
+	MemoryShaderSourceProvider sources;
+	AddShaders(sources);
+
+	const ShaderDesc mesh = MakeDesc("shaders/mesh.hlsl");
+	const ShaderDesc post = MakeDesc("shaders/post.hlsl");
+
+	uint64_t meshKey, postKey;
+	ShaderBytecode meshBytecode;
+	{
+		StubShaderCompiler compiler;
+		ShaderDiskCache diskCache(directory.Path);
+		ShaderCompilationService service(&compiler, &sources, &diskCache);
+
+		std::vector<ShaderCompileResult> results = service.CompileBatch({ mesh, post });
+		meshKey = results[0].Key;
+		postKey = results[1].Key;
+		meshBytecode = *results[0].Bytecode;
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.cso", (unsigned long long)meshKey);
+	const std::string meshPath = directory.Path + name;
+	snprintf(name, sizeof(name), "/%016llx.cso", (unsigned long long)postKey);
+	const std::string postPath = directory.Path + name;
+
+	//The same size with other bytes (the checksum catches it), and a truncated file
+	OverwriteFile(meshPath, std::string(meshBytecode.size(), 'x'));
+	OverwriteFile(postPath, "float");
+	{
+		StubShaderCompiler compiler;
+		ShaderDiskCache diskCache(directory.Path);
+		ShaderCompilationService service(&compiler, &sources, &diskCache);
+
+		std::vector<ShaderCompileResult> results = service.CompileBatch({ mesh, post });
+		HT_CHECK_EQ(compiler.GetCompileCount(), 2ull);
+		HT_CHECK_EQ(service.GetStats().DiskHits, 0ull);
+		HT_CHECK(results[0].IsValid() && *results[0].Bytecode == meshBytecode);
+	}
+
+	//They were stored again, a clean start loads them
+	{
+		StubShaderCompiler compiler;
+		ShaderDiskCache diskCache(directory.Path);
+		ShaderCompilationService service(&compiler, &sources, &diskCache);
+
+		service.CompileBatch({ mesh, post });
+		HT_CHECK_EQ(compiler.GetCompileCount(), 0ull);
+	}
+
+	//An index that can't be read is an empty cache, not a crash
+	OverwriteFile(directory.Path + "/index.txt", "HTShaderCache 1\nzzzz not an entry\n\x01\x02");
+	{
+		StubShaderCompiler compiler;
+		ShaderDiskCache diskCache(directory.Path);
+		HT_CHECK_EQ(diskCache.GetEntryCount(), (size_t)0);
+
+		ShaderCompilationService service(&compiler, &sources, &diskCache);
+		HT_CHECK(service.Compile(mesh).IsValid());
+		HT_CHECK_EQ(compiler.GetCompileCount(), 1ull);
+	}
+
+	//An index of another version too
+	OverwriteFile(directory.Path + "/index.txt", "HTShaderCache 999\n");
+	{
+		ShaderDiskCache diskCache(directory.Path);
+		HT_CHECK_EQ(diskCache.GetEntryCount(), (size_t)0);
+	}
+}
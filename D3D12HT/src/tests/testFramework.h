@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+//A very small test runner for the subsystems that don't need a device. Every test file registers its tests with HT_TEST and checks with HT_CHECK/HT_CHECK_EQ,
+//a failed check is reported and the test keeps going (so one run shows every difference). D3D12HTTests runs all of them, or only the suites given
+//on the command line, and the exit code is 1 if anything failed. It runs on the Linux build machines like the fuzz and the benchmarks.
+namespace HTTest
+{
+	using TestFunction = void(*)();
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* suite, const char* name, TestFunction function);
+	};
+
+	void ReportFailure(const char* file, int line, const std::string& message);
+
+	//True if function hits a D3D_ASSERT. It runs in a child process, since the assert traps. Where we can't fork (Windows) it isn't run and counts as true.
+	bool ExpectAssert(const std::function<void()>& function);
+
+	//The enums are printed as numbers
+	template<typename T>
+	std::string ToString(const T& value)
+	{
+		if constexpr (std::is_enum_v<T>)
+		{
+			return std::to_string((int64_t)value);
+		}
+		else
+		{
+			std::ostringstream stream;
+			stream << value;
+			return stream.str();
+		}
+	}
+
+	inline std::string ToString(uint8_t value) { return std::to_string(value); }
+}
+
+#define HT_TEST_NAME(suite, name) HTTest_##suite##_##name
+
+#define HT_TEST(suite, name) \
+	static void HT_TEST_NAME(suite, name)(); \
+	static HTTest::TestRegistrar HT_TEST_NAME(suite, name##_Registrar)(#suite, #name, &HT_TEST_NAME(suite, name)); \
+	static void HT_TEST_NAME(suite, name)()
+
+#define HT_CHECK(expr) \
+	do { if (!(expr)) HTTest::ReportFailure(__FILE__, __LINE__, #expr); } while (0)
+
+#define HT_CHECK_EQ(a, b) \
+	do \
+	{ \
+		auto htCheckA = (a); \
+		auto htCheckB = (b); \
+		if (!(htCheckA == htCheckB)) \
+			HTTest::ReportFailure(__FILE__, __LINE__, std::string(#a " == " #b " (") + HTTest::ToString(htCheckA) + " != " + HTTest::ToString(htCheckB) + ")"); \
+	} while (0)
+
+#define HT_CHECK_ASSERT(expr) \
+	do { if (!HTTest::ExpectAssert([&]() { expr; })) HTTest::ReportFailure(__FILE__, __LINE__, "Expected an assert: " #expr); } while (0)
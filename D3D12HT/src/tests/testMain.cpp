@@ -0,0 +1,99 @@
+//The entry point of D3D12HTTests. Usage: D3D12HTTests [suite...], no suite runs everything.
+#include "testFramework.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#if !defined(_MSC_VER)
+	#include <fcntl.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+namespace HTTest
+{
+	namespace
+	{
+		struct TestCase
+		{
+			const char* Suite;
+			const char* Name;
+			TestFunction Function;
+		};
+
+		//A function static, the registrars of the other files run before main in any order
+		std::vector<TestCase>& GetTests()
+		{
+			static std::vector<TestCase> s_Tests;
+			return s_Tests;
+		}
+
+		uint32_t s_CurrentFailures = 0;
+	}
+
+	TestRegistrar::TestRegistrar(const char* suite, const char* name, TestFunction function)
+	{
+		GetTests().push_back({ suite, name, function });
+	}
+
+	void ReportFailure(const char* file, int line, const std::string& message)
+	{
+		std::cout << "\t" << file << ":" << line << ": " << message << "\n";
+		s_CurrentFailures++;
+	}
+
+	bool ExpectAssert(const std::function<void()>& function)
+	{
+#if defined(_MSC_VER)
+		(void)function;
+		return true;
+#else
+		std::cout.flush();
+
+		pid_t child = fork();
+		if (child == 0)
+		{
+			//The assert prints to stderr, that's expected here
+			int null = open("/dev/null", O_WRONLY);
+			dup2(null, 2);
+
+			function();
+			_exit(0);
+		}
+
+		int status = 0;
+		waitpid(child, &status, 0);
+		return WIFSIGNALED(status);
+#endif
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace HTTest;
+
+	std::vector<std::string> suites(argv + 1, argv + argc);
+
+	uint32_t run = 0;
+	uint32_t failed = 0;
+
+	for (const TestCase& test : GetTests())
+	{
+		if (!suites.empty() && std::find(suites.begin(), suites.end(), test.Suite) == suites.end())
+			continue;
+
+		std::cout << "[ RUN  ] " << test.Suite << "." << test.Name << "\n";
+
+		s_CurrentFailures = 0;
+		test.Function();
+
+		std::cout << (s_CurrentFailures ? "[ FAIL ] " : "[  OK  ] ") << test.Suite << "." << test.Name << "\n";
+
+		run++;
+		failed += s_CurrentFailures ? 1 : 0;
+	}
+
+	std::cout << run - failed << "/" << run << " tests passed\n";
+	return failed || run == 0 ? 1 : 0;
+}
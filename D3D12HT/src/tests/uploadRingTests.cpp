@@ -0,0 +1,182 @@
+#include "testFramework.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <renderer/cpuFence.h>
+#include <renderer/uploadRing.h>
+
+using namespace HT;
+
+//The frames are driven like the renderer does: allocate, EndFrame with the value signaled after the frame, BeginFrame with what the fence completed.
+HT_TEST(UploadRing, MemoryIsOnlyReusedOnceTheFenceCompletes)
+{
+	CPUFence fence;
+	CPUUploadMemory memory(1024);
+	UploadRing ring(memory.GetMemory());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	UploadAllocation first = ring.Allocate(512, 256);
+	HT_CHECK(first.IsValid());
+	HT_CHECK_EQ(first.Offset, 0ull);
+	ring.EndFrame(fence.Signal());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	UploadAllocation second = ring.Allocate(512, 256);
+	HT_CHECK(second.IsValid());
+	HT_CHECK_EQ(second.Offset, 512ull);
+	ring.EndFrame(fence.Signal());
+
+	//Both frames are still on the "GPU", the ring is full
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK(!ring.Allocate(256, 256).IsValid());
+	HT_CHECK_EQ(ring.GetStats().OverflowCount, 1ull);
+	HT_CHECK_EQ(ring.GetPendingFrameCount(), 2u);
+	ring.EndFrame(fence.GetLastSignaledValue() + 1);
+
+	//The first frame is done, only its range comes back
+	fence.Complete(1);
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.GetPendingFrameCount(), 1u);
+
+	UploadAllocation third = ring.Allocate(512, 256);
+	HT_CHECK(third.IsValid());
+	HT_CHECK_EQ(third.Offset, 0ull);
+	HT_CHECK(!ring.Allocate(1, 1).IsValid());
+	ring.EndFrame(fence.Signal());
+
+	fence.CompleteAll();
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.GetPendingFrameCount(), 0u);
+	HT_CHECK_EQ(ring.GetStats().Used, 0ull);
+}
+
+HT_TEST(UploadRing, WrapsAroundWhenTheEndIsTooSmall)
+{
+	CPUFence fence;
+	CPUUploadMemory memory(1024);
+	UploadRing ring(memory.GetMemory());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.Allocate(600, 1).Offset, 0ull);
+	ring.EndFrame(fence.Signal());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.Allocate(300, 1).Offset, 600ull);
+	ring.EndFrame(fence.Signal());
+
+	//The tail moves to 600, the head is at 900. 200 doesn't fit in the last 124, so it goes to the begin and the end is lost.
+	fence.Complete(1);
+	ring.BeginFrame(fence.GetCompletedValue());
+
+	UploadAllocation wrapped = ring.Allocate(200, 1);
+	HT_CHECK(wrapped.IsValid());
+	HT_CHECK_EQ(wrapped.Offset, 0ull);
+	HT_CHECK_EQ(ring.GetStats().WrapCount, 1ull);
+	HT_CHECK_EQ(ring.GetStats().Padding, 124ull);
+	HT_CHECK_EQ(ring.GetStats().FrameUsed, 324ull);
+
+	//The head is behind the tail now, it can't pass it
+	HT_CHECK_EQ(ring.Allocate(400, 1).Offset, 200ull);
+	HT_CHECK(!ring.Allocate(1, 1).IsValid());
+	ring.EndFrame(fence.Signal());
+
+	//The second frame retires the range up to the end of the ring, the wrap padding included
+	fence.Complete(2);
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.GetStats().Used, 724ull);
+
+	fence.CompleteAll();
+	ring.BeginFrame(fence.GetCompletedValue());
+	HT_CHECK_EQ(ring.GetStats().Used, 0ull);
+
+	//Everything retired, the ring starts again from the begin
+	HT_CHECK_EQ(ring.Allocate(1024, 1).Offset, 0ull);
+}
+
+HT_TEST(UploadRing, AllocationsAreAlignedAndAddressed)
+{
+	CPUFence fence;
+	CPUUploadMemory memory(4096, 0x10000);
+	UploadRing ring(memory.GetMemory());
+
+	ring.BeginFrame(fence.GetCompletedValue());
+
+	UploadAllocation first = ring.Allocate(10, 256);
+	UploadAllocation second = ring.Allocate(10, 256);
+
+	HT_CHECK_EQ(first.Offset, 0ull);
+	HT_CHECK_EQ(second.Offset, 256ull);
+	HT_CHECK_EQ(second.GPUAddress, 0x10000ull + 256);
+	HT_CHECK(second.CPU == memory.GetMemory().CPUBase + 256);
+	HT_CHECK_EQ(ring.GetStats().Padding, 246ull);
+
+	//Nothing allocated, nothing to track
+	HT_CHECK(!ring.Allocate(0).IsValid());
+	ring.EndFrame(fence.Signal());
+	ring.BeginFrame(fence.GetCompletedValue());
+	ring.EndFrame(fence.Signal());
+	HT_CHECK_EQ(ring.GetPendingFrameCount(), 1u);
+}
+
+//The frames run ahead of a "GPU" that is completed a few frames late, like frames in flight. No range may be handed out while a pending frame still owns it.
+HT_TEST(UploadRing, FramesInFlightNeverOverlap)
+{
+	const uint64_t capacity = 64 * 1024;
+	const uint32_t framesInFlight = 3;
+
+	CPUFence fence;
+	CPUUploadMemory memory(capacity);
+	UploadRing ring(memory.GetMemory());
+
+	//Which frame value owns each byte, 0 = free
+	std::vector<uint64_t> owners(capacity, 0);
+	std::vector<std::pair<uint64_t, uint64_t>> frameRanges[framesInFlight + 1];
+
+	uint32_t seed = 7;
+	for (uint32_t frame = 0; frame < 2000; frame++)
+	{
+		uint64_t frameValue = fence.GetLastSignaledValue() + 1;
+		if (frameValue > framesInFlight)
+			fence.Complete(frameValue - framesInFlight);
+
+		//Free what the completed frames owned
+		uint64_t completed = fence.GetCompletedValue();
+		for (auto& ranges : frameRanges)
+		{
+			for (auto& range : ranges)
+			{
+				if (owners[range.first] != 0 && owners[range.first] <= completed)
+					std::fill(owners.begin() + range.first, owners.begin() + range.first + range.second, 0);
+			}
+		}
+
+		ring.BeginFrame(completed);
+
+		auto& ranges = frameRanges[frameValue % (framesInFlight + 1)];
+		ranges.clear();
+
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			uint64_t size = 64 + (seed >> 8) % 3000;
+
+			UploadAllocation allocation = ring.Allocate(size, 256);
+			if (!allocation.IsValid())
+				continue;
+
+			HT_CHECK(allocation.Offset % 256 == 0);
+			HT_CHECK(allocation.Offset + size <= capacity);
+			HT_CHECK(std::all_of(owners.begin() + allocation.Offset, owners.begin() + allocation.Offset + size, [](uint64_t owner) { return owner == 0; }));
+
+			std::fill(owners.begin() + allocation.Offset, owners.begin() + allocation.Offset + size, frameValue);
+			ranges.push_back({ allocation.Offset, size });
+		}
+
+		ring.EndFrame(fence.Signal());
+	}
+
+	HT_CHECK(ring.GetStats().WrapCount > 0);
+	HT_CHECK(ring.GetPendingFrameCount() <= framesInFlight);
+}
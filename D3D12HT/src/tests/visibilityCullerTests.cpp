@@ -0,0 +1,103 @@
+#include "testFramework.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <renderer/visibilityCuller.h>
+
+using namespace HT;
+using namespace HTUtils;
+
+namespace
+{
+	struct Box
+	{
+		HTVec3 Center;
+		HTVec3 Extents;
+	};
+
+	//The boxes are repeated so the SIMD levels go through their 4/8 wide loops and not only the scalar tail
+	std::vector<uint32_t> CullOnLevel(const std::vector<Box>& boxes, uint32_t copies, const HTMat4& viewProjection, HTMathLevel level)
+	{
+		VisibilityCuller culler;
+		culler.Resize((uint32_t)boxes.size() * copies);
+
+		for (uint32_t copy = 0; copy < copies; copy++)
+		{
+			for (uint32_t i = 0; i < boxes.size(); i++)
+				culler.SetBounds(copy * (uint32_t)boxes.size() + i, boxes[i].Center, boxes[i].Extents);
+		}
+
+		culler.Cull(viewProjection, nullptr, true, level);
+		return std::vector<uint32_t>(culler.GetVisibleIndices(), culler.GetVisibleIndices() + culler.GetVisibleCount());
+	}
+
+	//Every level the CPU has must give the same list
+	void CheckEveryLevel(const std::vector<Box>& boxes, const HTMat4& viewProjection, const std::vector<uint32_t>& expected)
+	{
+		const uint32_t copies = 3;
+
+		std::vector<uint32_t> expectedCopies;
+		for (uint32_t copy = 0; copy < copies; copy++)
+		{
+			for (uint32_t index : expected)
+				expectedCopies.push_back(copy * (uint32_t)boxes.size() + index);
+		}
+
+		for (uint32_t level = 0; level < (uint32_t)HTMathLevel::Count; level++)
+		{
+			if (!HTIsMathLevelSupported((HTMathLevel)level))
+				continue;
+
+			std::vector<uint32_t> visible = CullOnLevel(boxes, copies, viewProjection, (HTMathLevel)level);
+			if (visible != expectedCopies)
+				HTTest::ReportFailure(__FILE__, __LINE__, std::string("Wrong visible list on the level ") + HTMathLevelName((HTMathLevel)level));
+		}
+	}
+}
+
+//The culler only tests boxes, a sphere goes through its bounding box and a point is a box without extents.
+//With the identity as view projection the frustum is the clip space itself, -1 <= x, y <= 1 and 0 <= z <= 1, and the math is exact.
+HT_TEST(VisibilityCuller, BoxesOnThePlanes)
+{
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+
+	std::vector<Box> boxes =
+	{
+		{ { 0.0f, 0.0f, 0.5f },   { 0.0f, 0.0f, 0.0f } },    //0: inside
+		{ { -1.5f, 0.0f, 0.5f },  { 0.5f, 0.0f, 0.0f } },    //1: touches the left plane from outside, visible
+		{ { -1.5f, 0.0f, 0.5f },  { 0.49f, 0.0f, 0.0f } },   //2: just short of it
+		{ { 0.0f, 0.0f, 1.0f },   { 0.0f, 0.0f, 0.0f } },    //3: a point on the far plane, visible
+		{ { 0.0f, 0.0f, 1.001f }, { 0.0f, 0.0f, 0.0f } },    //4: a point just beyond it
+		{ { 0.0f, 0.0f, -0.5f },  { 0.25f, 0.25f, 0.25f } }, //5: behind the near plane
+		{ { 0.0f, 0.0f, 0.0f },   { 0.0f, 0.0f, 0.1f } },    //6: crosses the near plane
+		{ { nan, 0.0f, 0.5f },    { 0.0f, 0.0f, 0.0f } },    //7: NaN is out on every level
+		{ { 0.0f, 0.0f, 0.0f },   { 100.0f, 100.0f, 100.0f } }, //8: the frustum is inside the box
+		{ { 1.5f, 1.5f, 0.5f },   { 0.4f, 0.4f, 0.4f } },    //9: out of the corner
+	};
+
+	CheckEveryLevel(boxes, HTMat4Identity(), { 0, 1, 3, 6, 8 });
+}
+
+HT_TEST(VisibilityCuller, BoxesBehindTheCamera)
+{
+	//At the origin looking down +z, 90 degrees, near 0.1 and far 100
+	HTMat4 view = HTMat4LookAtLH({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f });
+	HTMat4 projection = HTMat4PerspectiveFovLH(3.14159265f * 0.5f, 1.0f, 0.1f, 100.0f);
+	HTMat4 viewProjection = HTMat4Multiply(view, projection);
+
+	std::vector<Box> boxes =
+	{
+		{ { 0.0f, 0.0f, 10.0f },   { 1.0f, 1.0f, 1.0f } },   //0: in front
+		{ { 0.0f, 0.0f, -10.0f },  { 1.0f, 1.0f, 1.0f } },   //1: behind, the mirror of 0. The side planes alone would let it pass.
+		{ { 0.0f, 0.0f, -10.0f },  { 1.0f, 1.0f, 9.95f } },  //2: behind, up to just behind the near plane
+		{ { 0.0f, 0.0f, 0.0f },    { 1.0f, 1.0f, 1.0f } },   //3: around the camera
+		{ { 30.0f, 0.0f, 10.0f },  { 1.0f, 1.0f, 1.0f } },   //4: out of the side
+		{ { 0.0f, 0.0f, 200.0f },  { 1.0f, 1.0f, 1.0f } },   //5: beyond the far plane
+		{ { 0.0f, 50.0f, -50.0f }, { 1.0f, 1.0f, 1.0f } },   //6: behind and above
+		{ { 0.0f, 0.0f, 99.5f },   { 1.0f, 1.0f, 1.0f } },   //7: crosses the far plane
+	};
+
+	CheckEveryLevel(boxes, viewProjection, { 0, 3, 7 });
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace HTUtils
+{
+	inline bool HTReadFile(const std::string& path, std::vector<uint8_t>& outData)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+
+		std::streamsize size = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		outData.resize((size_t)size);
+		return (bool)file.read(reinterpret_cast<char*>(outData.data()), size);
+	}
+
+	//Writes to a temporary file first and then renames it over the old one. The rename replaces the file in a single step,
+	//the readers see the old file or the new one, never a part of it (and a crash in the middle of the write leaves the old file untouched).
+	inline bool HTWriteFileAtomic(const std::string& path, const void* data, size_t size)
+	{
+		//Every write has its own temporary file, two threads (or two processes) never write the same one
+		static std::atomic<uint64_t> s_TemporaryCounter = 0;
+		uint64_t threadHash = (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+		std::string temporaryPath = path + ".tmp" + std::to_string(threadHash) + "_" + std::to_string(s_TemporaryCounter++);
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+
+			file.write(static_cast<const char*>(data), (std::streamsize)size);
+			file.flush();
+
+			if (!file)
+			{
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+
+		if (error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace HTUtils
+{
+	//FNV-1a, 64 bits. Not the fastest hash around but it is tiny, it has no dependencies and it gives the same result on every platform and run,
+	//which is what we need for keys that are saved to disk.
+	const uint64_t g_HashSeed = 0xcbf29ce484222325ull;
+
+	inline uint64_t HTHash64(const void* data, size_t size, uint64_t hash = g_HashSeed)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	//Builds a hash out of many values. Strings are hashed with their size, so ("ab", "c") and ("a", "bc") are different.
+	class HTHasher
+	{
+	public:
+		explicit HTHasher(uint64_t seed = g_HashSeed) : m_Hash(seed) {}
+
+		inline HTHasher& Add(const void* data, size_t size)
+		{
+			m_Hash = HTHash64(data, size, m_Hash);
+			return *this;
+		}
+
+		inline HTHasher& Add(const std::string& value)
+		{
+			Add<uint64_t>(value.size());
+			return Add(value.data(), value.size());
+		}
+
+		template<typename T>
+		inline HTHasher& Add(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed by their bytes!");
+			return Add(&value, sizeof(T));
+		}
+
+		inline uint64_t Get() const { return m_Hash; }
+
+	private:
+		uint64_t m_Hash;
+	};
+}
@@ -0,0 +1,479 @@
+#include "mathKernels.h"
+
+#include <util/simpleAssert.h>
+
+#if HT_MATH_SIMD && defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace HTUtils
+{
+	namespace
+	{
+		// -------------- Scalar (also the tails of the SIMD versions)
+
+		void ComposeTransformsScalar(const HTTransformSoA& t, HTMat4* out, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				out[i] = HTMat4FromTRS({ t.PositionX[i], t.PositionY[i], t.PositionZ[i] }, { t.RotationX[i], t.RotationY[i], t.RotationZ[i], t.RotationW[i] },
+					{ t.ScaleX[i], t.ScaleY[i], t.ScaleZ[i] });
+			}
+		}
+
+		inline void MultiplyScalar(const HTMat4& a, const HTMat4& b, HTMat4& out)
+		{
+			HTMat4 result;
+			for (uint32_t row = 0; row < 4; row++)
+				for (uint32_t column = 0; column < 4; column++)
+					result.m[row][column] = (a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column]) + (a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column]);
+			out = result;
+		}
+
+		void TransformPointsScalar(const HTMat4& m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				float x = inX[i], y = inY[i], z = inZ[i];
+				outX[i] = (x * m.m[0][0] + y * m.m[1][0]) + (z * m.m[2][0] + m.m[3][0]);
+				outY[i] = (x * m.m[0][1] + y * m.m[1][1]) + (z * m.m[2][1] + m.m[3][1]);
+				outZ[i] = (x * m.m[0][2] + y * m.m[1][2]) + (z * m.m[2][2] + m.m[3][2]);
+			}
+		}
+
+		void TransformAABBsScalar(const HTMat4* matrices, const HTAABBSoA& in, const HTAABBSoA& out, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const float (*m)[4] = matrices[i].m;
+
+				float cx = (in.MinX[i] + in.MaxX[i]) * 0.5f, cy = (in.MinY[i] + in.MaxY[i]) * 0.5f, cz = (in.MinZ[i] + in.MaxZ[i]) * 0.5f;
+				float ex = (in.MaxX[i] - in.MinX[i]) * 0.5f, ey = (in.MaxY[i] - in.MinY[i]) * 0.5f, ez = (in.MaxZ[i] - in.MinZ[i]) * 0.5f;
+
+				float center[3], extent[3];
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					center[c] = (cx * m[0][c] + cy * m[1][c]) + (cz * m[2][c] + m[3][c]);
+					extent[c] = (ex * std::fabs(m[0][c]) + ey * std::fabs(m[1][c])) + ez * std::fabs(m[2][c]);
+				}
+
+				out.MinX[i] = center[0] - extent[0]; out.MaxX[i] = center[0] + extent[0];
+				out.MinY[i] = center[1] - extent[1]; out.MaxY[i] = center[1] + extent[1];
+				out.MinZ[i] = center[2] - extent[2]; out.MaxZ[i] = center[2] + extent[2];
+			}
+		}
+
+#if HT_MATH_SIMD
+		// -------------- SSE, 4 elements at a time. Same operations in the same order as the scalar code, so the results are the same bits.
+
+		void ComposeTransformsSSE(const HTTransformSoA& t, HTMat4* out, uint32_t count)
+		{
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 two = _mm_set1_ps(2.0f);
+			const __m128 zero = _mm_setzero_ps();
+
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 qx = _mm_loadu_ps(t.RotationX + i), qy = _mm_loadu_ps(t.RotationY + i), qz = _mm_loadu_ps(t.RotationZ + i), qw = _mm_loadu_ps(t.RotationW + i);
+				__m128 sx = _mm_loadu_ps(t.ScaleX + i), sy = _mm_loadu_ps(t.ScaleY + i), sz = _mm_loadu_ps(t.ScaleZ + i);
+
+				__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+				__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+				__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+				//rows[row][column], one element per matrix
+				__m128 rows[4][4];
+				rows[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+				rows[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+				rows[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+				rows[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+				rows[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+				rows[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+				rows[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+				rows[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+				rows[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+				rows[3][0] = _mm_loadu_ps(t.PositionX + i);
+				rows[3][1] = _mm_loadu_ps(t.PositionY + i);
+				rows[3][2] = _mm_loadu_ps(t.PositionZ + i);
+				rows[0][3] = rows[1][3] = rows[2][3] = zero;
+				rows[3][3] = one;
+
+				//The transpose turns "an element of 4 matrices" into "a row of a matrix"
+				for (uint32_t row = 0; row < 4; row++)
+				{
+					_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+					for (uint32_t k = 0; k < 4; k++)
+						_mm_store_ps(out[i + k].m[row], rows[row][k]);
+				}
+			}
+
+			ComposeTransformsScalar(t, out, i, count);
+		}
+
+		inline void MultiplySSE(const HTMat4& a, __m128 b0, __m128 b1, __m128 b2, __m128 b3, HTMat4& out)
+		{
+			//All of a is read before out is written, out can be a
+			__m128 rows[4];
+			for (uint32_t row = 0; row < 4; row++)
+			{
+				__m128 sum01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[row][0]), b0), _mm_mul_ps(_mm_set1_ps(a.m[row][1]), b1));
+				__m128 sum23 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[row][2]), b2), _mm_mul_ps(_mm_set1_ps(a.m[row][3]), b3));
+				rows[row] = _mm_add_ps(sum01, sum23);
+			}
+
+			for (uint32_t row = 0; row < 4; row++)
+				_mm_store_ps(out.m[row], rows[row]);
+		}
+
+		void MultiplyMatricesSSE(const HTMat4* a, const HTMat4* b, HTMat4* out, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				MultiplySSE(a[i], _mm_load_ps(b[i].m[0]), _mm_load_ps(b[i].m[1]), _mm_load_ps(b[i].m[2]), _mm_load_ps(b[i].m[3]), out[i]);
+		}
+
+		void MultiplyMatricesSSE(const HTMat4* a, const HTMat4& b, HTMat4* out, uint32_t count)
+		{
+			__m128 b0 = _mm_load_ps(b.m[0]), b1 = _mm_load_ps(b.m[1]), b2 = _mm_load_ps(b.m[2]), b3 = _mm_load_ps(b.m[3]);
+			for (uint32_t i = 0; i < count; i++)
+				MultiplySSE(a[i], b0, b1, b2, b3, out[i]);
+		}
+
+		void TransformPointsSSE(const HTMat4& m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, uint32_t count)
+		{
+			__m128 m00 = _mm_set1_ps(m.m[0][0]), m01 = _mm_set1_ps(m.m[0][1]), m02 = _mm_set1_ps(m.m[0][2]);
+			__m128 m10 = _mm_set1_ps(m.m[1][0]), m11 = _mm_set1_ps(m.m[1][1]), m12 = _mm_set1_ps(m.m[1][2]);
+			__m128 m20 = _mm_set1_ps(m.m[2][0]), m21 = _mm_set1_ps(m.m[2][1]), m22 = _mm_set1_ps(m.m[2][2]);
+			__m128 m30 = _mm_set1_ps(m.m[3][0]), m31 = _mm_set1_ps(m.m[3][1]), m32 = _mm_set1_ps(m.m[3][2]);
+
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(inX + i), y = _mm_loadu_ps(inY + i), z = _mm_loadu_ps(inZ + i);
+				_mm_storeu_ps(outX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_add_ps(_mm_mul_ps(z, m20), m30)));
+				_mm_storeu_ps(outY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_add_ps(_mm_mul_ps(z, m21), m31)));
+				_mm_storeu_ps(outZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_add_ps(_mm_mul_ps(z, m22), m32)));
+			}
+
+			TransformPointsScalar(m, inX, inY, inZ, outX, outY, outZ, i, count);
+		}
+
+		void TransformAABBsSSE(const HTMat4* matrices, const HTAABBSoA& in, const HTAABBSoA& out, uint32_t count)
+		{
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				//m[row][column], one element per box
+				__m128 m[4][4];
+				for (uint32_t row = 0; row < 4; row++)
+				{
+					for (uint32_t k = 0; k < 4; k++)
+						m[row][k] = _mm_load_ps(matrices[i + k].m[row]);
+
+					_MM_TRANSPOSE4_PS(m[row][0], m[row][1], m[row][2], m[row][3]);
+				}
+
+				__m128 minX = _mm_loadu_ps(in.MinX + i), minY = _mm_loadu_ps(in.MinY + i), minZ = _mm_loadu_ps(in.MinZ + i);
+				__m128 maxX = _mm_loadu_ps(in.MaxX + i), maxY = _mm_loadu_ps(in.MaxY + i), maxZ = _mm_loadu_ps(in.MaxZ + i);
+
+				__m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half), cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half), cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+				__m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half), ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half), ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+				__m128 center[3], extent[3];
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					center[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, m[0][c]), _mm_mul_ps(cy, m[1][c])), _mm_add_ps(_mm_mul_ps(cz, m[2][c]), m[3][c]));
+					extent[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_and_ps(m[0][c], absMask)), _mm_mul_ps(ey, _mm_and_ps(m[1][c], absMask))),
+						_mm_mul_ps(ez, _mm_and_ps(m[2][c], absMask)));
+				}
+
+				_mm_storeu_ps(out.MinX + i, _mm_sub_ps(center[0], extent[0])); _mm_storeu_ps(out.MaxX + i, _mm_add_ps(center[0], extent[0]));
+				_mm_storeu_ps(out.MinY + i, _mm_sub_ps(center[1], extent[1])); _mm_storeu_ps(out.MaxY + i, _mm_add_ps(center[1], extent[1]));
+				_mm_storeu_ps(out.MinZ + i, _mm_sub_ps(center[2], extent[2])); _mm_storeu_ps(out.MaxZ + i, _mm_add_ps(center[2], extent[2]));
+			}
+
+			TransformAABBsScalar(matrices, in, out, i, count);
+		}
+
+		// -------------- AVX2 + FMA, 8 elements at a time
+
+		//_MM_TRANSPOSE4_PS on each 128 bit half: the low half has elements 0-3, the high half elements 4-7
+		HT_AVX2_FUNCTION inline void TransposeHalves(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+			__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+			__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+			r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		HT_AVX2_FUNCTION void ComposeTransformsAVX2(const HTTransformSoA& t, HTMat4* out, uint32_t count)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 two = _mm256_set1_ps(2.0f);
+			const __m256 zero = _mm256_setzero_ps();
+
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 qx = _mm256_loadu_ps(t.RotationX + i), qy = _mm256_loadu_ps(t.RotationY + i), qz = _mm256_loadu_ps(t.RotationZ + i), qw = _mm256_loadu_ps(t.RotationW + i);
+				__m256 sx = _mm256_loadu_ps(t.ScaleX + i), sy = _mm256_loadu_ps(t.ScaleY + i), sz = _mm256_loadu_ps(t.ScaleZ + i);
+
+				__m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+				__m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+				__m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+
+				__m256 rows[4][4];
+				rows[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx);
+				rows[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+				rows[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+				rows[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+				rows[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy);
+				rows[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+				rows[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+				rows[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+				rows[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz);
+				rows[3][0] = _mm256_loadu_ps(t.PositionX + i);
+				rows[3][1] = _mm256_loadu_ps(t.PositionY + i);
+				rows[3][2] = _mm256_loadu_ps(t.PositionZ + i);
+				rows[0][3] = rows[1][3] = rows[2][3] = zero;
+				rows[3][3] = one;
+
+				for (uint32_t row = 0; row < 4; row++)
+				{
+					TransposeHalves(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+					for (uint32_t k = 0; k < 4; k++)
+					{
+						_mm_store_ps(out[i + k].m[row], _mm256_castps256_ps128(rows[row][k]));
+						_mm_store_ps(out[i + k + 4].m[row], _mm256_extractf128_ps(rows[row][k], 1));
+					}
+				}
+			}
+
+			ComposeTransformsScalar(t, out, i, count);
+		}
+
+		//Two rows per register: element k of each row is broadcast inside its half and multiplies row k of b, which is in both halves
+		HT_AVX2_FUNCTION inline void MultiplyAVX2(const HTMat4& a, __m256 b0, __m256 b1, __m256 b2, __m256 b3, HTMat4& out)
+		{
+			__m256 a01 = _mm256_loadu_ps(a.m[0]);
+			__m256 a23 = _mm256_loadu_ps(a.m[2]);
+
+			__m256 rows01 = _mm256_add_ps(_mm256_fmadd_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(1, 1, 1, 1)), b1, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(0, 0, 0, 0)), b0)),
+				_mm256_fmadd_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(3, 3, 3, 3)), b3, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(2, 2, 2, 2)), b2)));
+			__m256 rows23 = _mm256_add_ps(_mm256_fmadd_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(1, 1, 1, 1)), b1, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(0, 0, 0, 0)), b0)),
+				_mm256_fmadd_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(3, 3, 3, 3)), b3, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(2, 2, 2, 2)), b2)));
+
+			_mm256_storeu_ps(out.m[0], rows01);
+			_mm256_storeu_ps(out.m[2], rows23);
+		}
+
+		HT_AVX2_FUNCTION void MultiplyMatricesAVX2(const HTMat4* a, const HTMat4* b, HTMat4* out, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				MultiplyAVX2(a[i], _mm256_broadcast_ps((const __m128*)b[i].m[0]), _mm256_broadcast_ps((const __m128*)b[i].m[1]),
+					_mm256_broadcast_ps((const __m128*)b[i].m[2]), _mm256_broadcast_ps((const __m128*)b[i].m[3]), out[i]);
+			}
+		}
+
+		HT_AVX2_FUNCTION void MultiplyMatricesAVX2(const HTMat4* a, const HTMat4& b, HTMat4* out, uint32_t count)
+		{
+			__m256 b0 = _mm256_broadcast_ps((const __m128*)b.m[0]), b1 = _mm256_broadcast_ps((const __m128*)b.m[1]);
+			__m256 b2 = _mm256_broadcast_ps((const __m128*)b.m[2]), b3 = _mm256_broadcast_ps((const __m128*)b.m[3]);
+
+			for (uint32_t i = 0; i < count; i++)
+				MultiplyAVX2(a[i], b0, b1, b2, b3, out[i]);
+		}
+
+		HT_AVX2_FUNCTION void TransformPointsAVX2(const HTMat4& m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, uint32_t count)
+		{
+			__m256 m00 = _mm256_set1_ps(m.m[0][0]), m01 = _mm256_set1_ps(m.m[0][1]), m02 = _mm256_set1_ps(m.m[0][2]);
+			__m256 m10 = _mm256_set1_ps(m.m[1][0]), m11 = _mm256_set1_ps(m.m[1][1]), m12 = _mm256_set1_ps(m.m[1][2]);
+			__m256 m20 = _mm256_set1_ps(m.m[2][0]), m21 = _mm256_set1_ps(m.m[2][1]), m22 = _mm256_set1_ps(m.m[2][2]);
+			__m256 m30 = _mm256_set1_ps(m.m[3][0]), m31 = _mm256_set1_ps(m.m[3][1]), m32 = _mm256_set1_ps(m.m[3][2]);
+
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(inX + i), y = _mm256_loadu_ps(inY + i), z = _mm256_loadu_ps(inZ + i);
+				_mm256_storeu_ps(outX + i, _mm256_fmadd_ps(x, m00, _mm256_fmadd_ps(y, m10, _mm256_fmadd_ps(z, m20, m30))));
+				_mm256_storeu_ps(outY + i, _mm256_fmadd_ps(x, m01, _mm256_fmadd_ps(y, m11, _mm256_fmadd_ps(z, m21, m31))));
+				_mm256_storeu_ps(outZ + i, _mm256_fmadd_ps(x, m02, _mm256_fmadd_ps(y, m12, _mm256_fmadd_ps(z, m22, m32))));
+			}
+
+			TransformPointsScalar(m, inX, inY, inZ, outX, outY, outZ, i, count);
+		}
+
+		HT_AVX2_FUNCTION void TransformAABBsAVX2(const HTMat4* matrices, const HTAABBSoA& in, const HTAABBSoA& out, uint32_t count)
+		{
+			const __m256 half = _mm256_set1_ps(0.5f);
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				//Row r of boxes k and k + 4 in the halves of a register, the transpose gives element k of both halves to the same lane
+				__m256 m[4][4];
+				for (uint32_t row = 0; row < 4; row++)
+				{
+					for (uint32_t k = 0; k < 4; k++)
+						m[row][k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(matrices[i + k].m[row])), _mm_load_ps(matrices[i + k + 4].m[row]), 1);
+
+					TransposeHalves(m[row][0], m[row][1], m[row][2], m[row][3]);
+				}
+
+				__m256 minX = _mm256_loadu_ps(in.MinX + i), minY = _mm256_loadu_ps(in.MinY + i), minZ = _mm256_loadu_ps(in.MinZ + i);
+				__m256 maxX = _mm256_loadu_ps(in.MaxX + i), maxY = _mm256_loadu_ps(in.MaxY + i), maxZ = _mm256_loadu_ps(in.MaxZ + i);
+
+				__m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half), cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half), cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+				__m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half), ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half), ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+				__m256 center[3], extent[3];
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					center[c] = _mm256_fmadd_ps(cx, m[0][c], _mm256_fmadd_ps(cy, m[1][c], _mm256_fmadd_ps(cz, m[2][c], m[3][c])));
+					extent[c] = _mm256_fmadd_ps(ex, _mm256_and_ps(m[0][c], absMask), _mm256_fmadd_ps(ey, _mm256_and_ps(m[1][c], absMask), _mm256_mul_ps(ez, _mm256_and_ps(m[2][c], absMask))));
+				}
+
+				_mm256_storeu_ps(out.MinX + i, _mm256_sub_ps(center[0], extent[0])); _mm256_storeu_ps(out.MaxX + i, _mm256_add_ps(center[0], extent[0]));
+				_mm256_storeu_ps(out.MinY + i, _mm256_sub_ps(center[1], extent[1])); _mm256_storeu_ps(out.MaxY + i, _mm256_add_ps(center[1], extent[1]));
+				_mm256_storeu_ps(out.MinZ + i, _mm256_sub_ps(center[2], extent[2])); _mm256_storeu_ps(out.MaxZ + i, _mm256_add_ps(center[2], extent[2]));
+			}
+
+			TransformAABBsScalar(matrices, in, out, i, count);
+		}
+
+		//The OS must also save the upper halves of the registers (XGETBV), not just the CPU have the instructions
+		bool CPUHasAVX2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			__cpuid(info, 1);
+			bool fma = (info[2] & (1 << 12)) != 0;
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+		}
+#endif
+	}
+
+	const char* HTMathLevelName(HTMathLevel level)
+	{
+		switch (level)
+		{
+		case HTMathLevel::Scalar: return "scalar";
+		case HTMathLevel::SSE:    return "sse";
+		case HTMathLevel::AVX2:   return "avx2";
+		default:                  return "unknown";
+		}
+	}
+
+	bool HTIsMathLevelSupported(HTMathLevel level)
+	{
+#if HT_MATH_SIMD
+		static const bool avx2 = CPUHasAVX2();
+
+		switch (level)
+		{
+		case HTMathLevel::Scalar:
+		case HTMathLevel::SSE:  return true;
+		case HTMathLevel::AVX2: return avx2;
+		default:                return false;
+		}
+#else
+		return level == HTMathLevel::Scalar;
+#endif
+	}
+
+	HTMathLevel HTGetMathLevel()
+	{
+		static const HTMathLevel best = HTIsMathLevelSupported(HTMathLevel::AVX2) ? HTMathLevel::AVX2 :
+		                                HTIsMathLevelSupported(HTMathLevel::SSE)  ? HTMathLevel::SSE : HTMathLevel::Scalar;
+		return best;
+	}
+
+	void HTComposeTransforms(const HTTransformSoA& transforms, HTMat4* outMatrices, uint32_t count, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Math level not supported by this build or CPU!");
+
+#if HT_MATH_SIMD
+		if (level == HTMathLevel::AVX2)
+			return ComposeTransformsAVX2(transforms, outMatrices, count);
+		if (level == HTMathLevel::SSE)
+			return ComposeTransformsSSE(transforms, outMatrices, count);
+#endif
+		ComposeTransformsScalar(transforms, outMatrices, 0, count);
+	}
+
+	void HTMultiplyMatrices(const HTMat4* a, const HTMat4* b, HTMat4* outMatrices, uint32_t count, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Math level not supported by this build or CPU!");
+
+#if HT_MATH_SIMD
+		if (level == HTMathLevel::AVX2)
+			return MultiplyMatricesAVX2(a, b, outMatrices, count);
+		if (level == HTMathLevel::SSE)
+			return MultiplyMatricesSSE(a, b, outMatrices, count);
+#endif
+		for (uint32_t i = 0; i < count; i++)
+			MultiplyScalar(a[i], b[i], outMatrices[i]);
+	}
+
+	void HTMultiplyMatrices(const HTMat4* a, const HTMat4& b, HTMat4* outMatrices, uint32_t count, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Math level not supported by this build or CPU!");
+
+#if HT_MATH_SIMD
+		if (level == HTMathLevel::AVX2)
+			return MultiplyMatricesAVX2(a, b, outMatrices, count);
+		if (level == HTMathLevel::SSE)
+			return MultiplyMatricesSSE(a, b, outMatrices, count);
+#endif
+		for (uint32_t i = 0; i < count; i++)
+			MultiplyScalar(a[i], b, outMatrices[i]);
+	}
+
+	void HTTransformPoints(const HTMat4& matrix, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, uint32_t count, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Math level not supported by this build or CPU!");
+
+#if HT_MATH_SIMD
+		if (level == HTMathLevel::AVX2)
+			return TransformPointsAVX2(matrix, inX, inY, inZ, outX, outY, outZ, count);
+		if (level == HTMathLevel::SSE)
+			return TransformPointsSSE(matrix, inX, inY, inZ, outX, outY, outZ, count);
+#endif
+		TransformPointsScalar(matrix, inX, inY, inZ, outX, outY, outZ, 0, count);
+	}
+
+	void HTTransformAABBs(const HTMat4* matrices, const HTAABBSoA& boxes, const HTAABBSoA& outBoxes, uint32_t count, HTMathLevel level)
+	{
+		D3D_ASSERT(HTIsMathLevelSupported(level), "Math level not supported by this build or CPU!");
+
+#if HT_MATH_SIMD
+		if (level == HTMathLevel::AVX2)
+			return TransformAABBsAVX2(matrices, boxes, outBoxes, count);
+		if (level == HTMathLevel::SSE)
+			return TransformAABBsSSE(matrices, boxes, outBoxes, count);
+#endif
+		TransformAABBsScalar(matrices, boxes, outBoxes, 0, count);
+	}
+}
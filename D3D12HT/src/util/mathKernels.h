@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#include <util/vectorMath.h>
+
+//MSVC lets any function use the AVX2 intrinsics. GCC and Clang only inside functions built for it.
+//For the AVX2 versions of kernels outside of this file too (check HTIsMathLevelSupported before calling them).
+#if defined(_MSC_VER)
+	#define HT_AVX2_FUNCTION
+#else
+	#define HT_AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#endif
+
+//Math over thousands of elements per call. The inputs are structures of arrays where it matters (a lane of a SIMD register per element,
+//with no shuffles), the matrices stay as HTMat4 because that is what the constants of the draws need.
+//
+//Every kernel has a scalar, an SSE (4 elements per instruction) and an AVX2 + FMA (8 elements per instruction) version. By default the best one
+//the CPU can run is used (HTGetMathLevel), the level argument is there to compare them. The AVX2 code is built for that function only
+//(no /arch:AVX2 or -mavx2 for the whole program), so the executable still runs on a CPU without it.
+//With D3D12HT_MATH_SCALAR only the scalar versions exist.
+//
+//The FMA of the AVX2 versions rounds once instead of twice, so their results can differ from the others in the last bits.
+//The outputs can be the inputs (in place).
+namespace HTUtils
+{
+	enum class HTMathLevel : uint8_t
+	{
+		Scalar = 0,
+		SSE,
+		AVX2,
+
+		Count
+	};
+
+	const char* HTMathLevelName(HTMathLevel level);
+
+	//If this build has it and this CPU can run it
+	bool HTIsMathLevelSupported(HTMathLevel level);
+
+	//The best supported level, detected once
+	HTMathLevel HTGetMathLevel();
+
+	//Axis aligned boxes, one per index
+	struct HTAABBSoA
+	{
+		float* MinX; float* MinY; float* MinZ;
+		float* MaxX; float* MaxY; float* MaxZ;
+	};
+
+	//Object transforms (translation, rotation, scale), one per index. The quaternions must be normalized.
+	struct HTTransformSoA
+	{
+		const float* PositionX; const float* PositionY; const float* PositionZ;
+		const float* RotationX; const float* RotationY; const float* RotationZ; const float* RotationW;
+		const float* ScaleX;    const float* ScaleY;    const float* ScaleZ;
+	};
+
+	//out[i] = HTMat4FromTRS of transform i
+	void HTComposeTransforms(const HTTransformSoA& transforms, HTMat4* outMatrices, uint32_t count, HTMathLevel level = HTGetMathLevel());
+
+	//out[i] = a[i] * b[i]
+	void HTMultiplyMatrices(const HTMat4* a, const HTMat4* b, HTMat4* outMatrices, uint32_t count, HTMathLevel level = HTGetMathLevel());
+
+	//out[i] = a[i] * b (e.g. world * viewProjection of every draw)
+	void HTMultiplyMatrices(const HTMat4* a, const HTMat4& b, HTMat4* outMatrices, uint32_t count, HTMathLevel level = HTGetMathLevel());
+
+	//out[i] = HTMat4TransformPoint(in[i], matrix)
+	void HTTransformPoints(const HTMat4& matrix, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ,
+		uint32_t count, HTMathLevel level = HTGetMathLevel());
+
+	//out[i] = the box that holds box i transformed by matrices[i] (e.g. the local bounds of the objects to world space).
+	//Done with the center and the extents (|M| * extents): the same box as transforming the 8 corners, for the cost of 2 transforms.
+	void HTTransformAABBs(const HTMat4* matrices, const HTAABBSoA& boxes, const HTAABBSoA& outBoxes, uint32_t count, HTMathLevel level = HTGetMathLevel());
+}
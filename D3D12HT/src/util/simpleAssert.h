@@ -1,5 +1,15 @@
+#pragma once
+
 #include <iostream>
 
+//__debugbreak is a MSVC intrinsic. The renderer only runs on Windows, but a lot of our subsystems (frame stats, allocators, schedulers...) are
+//plain C++ and we also build them on Linux to test and benchmark them. So we pick the equivalent trap for each compiler.
+#if defined(_MSC_VER)
+	#define HT_DEBUG_BREAK() __debugbreak()
+#else
+	#define HT_DEBUG_BREAK() __builtin_trap()
+#endif
+
 //We will not worry about performance since it is just an assert and it is not meant to be called every frame or so. With this in mind, let's have some flexibility.
 #define D3D_ASSERT(Expr, Msg) \
     __M_Assert(Expr, __FILE__, __LINE__, Msg)
@@ -9,6 +19,6 @@ inline void __M_Assert(bool expr, const char* file, int line, const char* msg)
 	if (!expr)
 	{
 		std::cerr << "Assert failed:\t" << msg << "\n" << "Source:\t\t" << file << ", line " << line << "\n";
-		__debugbreak();
+		HT_DEBUG_BREAK();
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+namespace HTUtils
+{
+	//A monotonic timestamp in nanoseconds. We use the steady clock because the high resolution clock is allowed to be the system clock, 
+	//and the system clock can jump backwards (e.g: when the user changes the time), which would give us negative frame times.
+	//Only the difference between two timestamps is meaningful, the origin is whatever the OS decided.
+	inline uint64_t HTNowNanoseconds()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//The time stamp counter of the CPU, for timing very short things (a steady_clock read is a few times slower). It is not in nanoseconds, the rate
+	//is only known by measuring it against HTNowNanoseconds. On modern x64 CPUs it is invariant (the same rate on every core, whatever the frequency is).
+	//Without rdtsc it is HTNowNanoseconds itself.
+	inline uint64_t HTReadTimestampCounter()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return (uint64_t)__rdtsc();
+#else
+		return HTNowNanoseconds();
+#endif
+	}
+
+	inline double HTNanosecondsToMilliseconds(uint64_t nanoseconds)
+	{
+		return (double)nanoseconds * 1e-6;
+	}
+}
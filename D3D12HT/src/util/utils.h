@@ -1,3 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
 namespace HTUtils
 {
 	template<typename T>
@@ -6,4 +14,46 @@ namespace HTUtils
 		return (a < b) ? b : a;
 	}
 
-}
\ No newline at end of file
+	template<typename T>
+	inline T HTMin(T a, T b)
+	{
+		return (b < a) ? b : a;
+	}
+
+	//Rounds value up to the next multiple of alignment. The alignment must be a power of two (which is always the case for GPU alignments).
+	template<typename T>
+	inline T HTAlignUp(T value, T alignment)
+	{
+		return (value + (alignment - 1)) & ~(alignment - 1);
+	}
+
+	template<typename T>
+	inline bool HTIsPowerOfTwo(T value)
+	{
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+
+	//Index of the lowest/highest set bit. The value must not be 0. They are a single instruction on x64 (tzcnt/lzcnt or bsf/bsr).
+	inline uint32_t HTLowestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctzll(value);
+#endif
+	}
+
+	inline uint32_t HTHighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (uint32_t)index;
+#else
+		return 63u - (uint32_t)__builtin_clzll(value);
+#endif
+	}
+
+}
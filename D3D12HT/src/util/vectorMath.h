@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+//The vector math of the engine. Same conventions as DirectXMath (and HLSL with mul(v, M)): row vectors, v' = v * M, so the translation is in the
+//last row and A * B means "A, then B". The matrices of the constants are sent to the GPU as they are.
+//
+//On x64 the 4 wide operations use SSE (every x64 CPU has it). Define D3D12HT_MATH_SCALAR to build everything with plain floats instead,
+//to compare against it or for a platform without SSE. The batched kernels (SSE and AVX2) are in util/mathKernels.h.
+#if !defined(D3D12HT_MATH_SCALAR) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__))
+	#define HT_MATH_SIMD 1
+	#include <immintrin.h>
+#else
+	#define HT_MATH_SIMD 0
+#endif
+
+namespace HTUtils
+{
+	struct HTVec3
+	{
+		float x, y, z;
+	};
+
+	struct alignas(16) HTVec4
+	{
+		float x, y, z, w;
+	};
+
+	//A rotation. The identity is (0, 0, 0, 1).
+	struct alignas(16) HTQuat
+	{
+		float x, y, z, w;
+	};
+
+	//m[row][column]. The first three rows are the axes, the last one the translation.
+	struct alignas(16) HTMat4
+	{
+		float m[4][4];
+	};
+
+	// -------------- HTVec3
+
+	inline HTVec3 HTVec3Add(const HTVec3& a, const HTVec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline HTVec3 HTVec3Sub(const HTVec3& a, const HTVec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline HTVec3 HTVec3Scale(const HTVec3& v, float s)       { return { v.x * s, v.y * s, v.z * s }; }
+	inline float  HTVec3Dot(const HTVec3& a, const HTVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float  HTVec3Length(const HTVec3& v)               { return std::sqrt(HTVec3Dot(v, v)); }
+
+	inline HTVec3 HTVec3Cross(const HTVec3& a, const HTVec3& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	//A zero vector stays zero
+	inline HTVec3 HTVec3Normalize(const HTVec3& v)
+	{
+		float length = HTVec3Length(v);
+		return length > 0.0f ? HTVec3Scale(v, 1.0f / length) : v;
+	}
+
+	// -------------- HTVec4
+
+#if HT_MATH_SIMD
+	inline __m128 HTLoad(const HTVec4& v)         { return _mm_load_ps(&v.x); }
+	inline HTVec4 HTStoreVec4(__m128 v)           { HTVec4 result; _mm_store_ps(&result.x, v); return result; }
+#endif
+
+	inline HTVec4 HTVec4Add(const HTVec4& a, const HTVec4& b)
+	{
+#if HT_MATH_SIMD
+		return HTStoreVec4(_mm_add_ps(HTLoad(a), HTLoad(b)));
+#else
+		return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+#endif
+	}
+
+	inline HTVec4 HTVec4Sub(const HTVec4& a, const HTVec4& b)
+	{
+#if HT_MATH_SIMD
+		return HTStoreVec4(_mm_sub_ps(HTLoad(a), HTLoad(b)));
+#else
+		return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+#endif
+	}
+
+	inline HTVec4 HTVec4Mul(const HTVec4& a, const HTVec4& b)
+	{
+#if HT_MATH_SIMD
+		return HTStoreVec4(_mm_mul_ps(HTLoad(a), HTLoad(b)));
+#else
+		return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
+#endif
+	}
+
+	inline HTVec4 HTVec4Scale(const HTVec4& v, float s)
+	{
+#if HT_MATH_SIMD
+		return HTStoreVec4(_mm_mul_ps(HTLoad(v), _mm_set1_ps(s)));
+#else
+		return { v.x * s, v.y * s, v.z * s, v.w * s };
+#endif
+	}
+
+	inline float HTVec4Dot(const HTVec4& a, const HTVec4& b)
+	{
+		return (a.x * b.x + a.y * b.y) + (a.z * b.z + a.w * b.w);
+	}
+
+	// -------------- HTMat4
+
+	inline HTMat4 HTMat4Identity()
+	{
+		return { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	inline HTMat4 HTMat4Translation(const HTVec3& t)
+	{
+		return { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { t.x, t.y, t.z, 1.0f } } };
+	}
+
+	inline HTMat4 HTMat4Scaling(const HTVec3& s)
+	{
+		return { { { s.x, 0.0f, 0.0f, 0.0f }, { 0.0f, s.y, 0.0f, 0.0f }, { 0.0f, 0.0f, s.z, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	//Scale, then rotate, then translate (what an object transform is). The quaternion must be normalized.
+	inline HTMat4 HTMat4FromTRS(const HTVec3& t, const HTQuat& q, const HTVec3& s)
+	{
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		HTMat4 result;
+		result.m[0][0] = (1.0f - 2.0f * (yy + zz)) * s.x; result.m[0][1] = 2.0f * (xy + wz) * s.x;          result.m[0][2] = 2.0f * (xz - wy) * s.x;          result.m[0][3] = 0.0f;
+		result.m[1][0] = 2.0f * (xy - wz) * s.y;          result.m[1][1] = (1.0f - 2.0f * (xx + zz)) * s.y; result.m[1][2] = 2.0f * (yz + wx) * s.y;          result.m[1][3] = 0.0f;
+		result.m[2][0] = 2.0f * (xz + wy) * s.z;          result.m[2][1] = 2.0f * (yz - wx) * s.z;          result.m[2][2] = (1.0f - 2.0f * (xx + yy)) * s.z; result.m[2][3] = 0.0f;
+		result.m[3][0] = t.x;                             result.m[3][1] = t.y;                             result.m[3][2] = t.z;                             result.m[3][3] = 1.0f;
+		return result;
+	}
+
+	inline HTMat4 HTMat4FromQuat(const HTQuat& q)
+	{
+		return HTMat4FromTRS({ 0.0f, 0.0f, 0.0f }, q, { 1.0f, 1.0f, 1.0f });
+	}
+
+	//a, then b. Each row of the result is a row of a times b: a sum of the rows of b scaled by the elements of the row of a.
+	inline HTMat4 HTMat4Multiply(const HTMat4& a, const HTMat4& b)
+	{
+		HTMat4 result;
+#if HT_MATH_SIMD
+		__m128 b0 = _mm_load_ps(b.m[0]), b1 = _mm_load_ps(b.m[1]), b2 = _mm_load_ps(b.m[2]), b3 = _mm_load_ps(b.m[3]);
+
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			__m128 sum01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[row][0]), b0), _mm_mul_ps(_mm_set1_ps(a.m[row][1]), b1));
+			__m128 sum23 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[row][2]), b2), _mm_mul_ps(_mm_set1_ps(a.m[row][3]), b3));
+			_mm_store_ps(result.m[row], _mm_add_ps(sum01, sum23));
+		}
+#else
+		for (uint32_t row = 0; row < 4; row++)
+			for (uint32_t column = 0; column < 4; column++)
+				result.m[row][column] = (a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column]) + (a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column]);
+#endif
+		return result;
+	}
+
+	inline HTMat4 HTMat4Transpose(const HTMat4& matrix)
+	{
+		HTMat4 result;
+#if HT_MATH_SIMD
+		__m128 r0 = _mm_load_ps(matrix.m[0]), r1 = _mm_load_ps(matrix.m[1]), r2 = _mm_load_ps(matrix.m[2]), r3 = _mm_load_ps(matrix.m[3]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_store_ps(result.m[0], r0); _mm_store_ps(result.m[1], r1); _mm_store_ps(result.m[2], r2); _mm_store_ps(result.m[3], r3);
+#else
+		for (uint32_t row = 0; row < 4; row++)
+			for (uint32_t column = 0; column < 4; column++)
+				result.m[row][column] = matrix.m[column][row];
+#endif
+		return result;
+	}
+
+	inline HTVec4 HTMat4Transform(const HTVec4& v, const HTMat4& matrix)
+	{
+#if HT_MATH_SIMD
+		__m128 sum01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.x), _mm_load_ps(matrix.m[0])), _mm_mul_ps(_mm_set1_ps(v.y), _mm_load_ps(matrix.m[1])));
+		__m128 sum23 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.z), _mm_load_ps(matrix.m[2])), _mm_mul_ps(_mm_set1_ps(v.w), _mm_load_ps(matrix.m[3])));
+		return HTStoreVec4(_mm_add_ps(sum01, sum23));
+#else
+		HTVec4 result;
+		float* out = &result.x;
+		for (uint32_t column = 0; column < 4; column++)
+			out[column] = (v.x * matrix.m[0][column] + v.y * matrix.m[1][column]) + (v.z * matrix.m[2][column] + v.w * matrix.m[3][column]);
+		return result;
+#endif
+	}
+
+	//w = 1, no perspective divide
+	inline HTVec3 HTMat4TransformPoint(const HTVec3& p, const HTMat4& matrix)
+	{
+		HTVec4 result = HTMat4Transform({ p.x, p.y, p.z, 1.0f }, matrix);
+		return { result.x, result.y, result.z };
+	}
+
+	//w = 0, the translation is ignored
+	inline HTVec3 HTMat4TransformVector(const HTVec3& v, const HTMat4& matrix)
+	{
+		HTVec4 result = HTMat4Transform({ v.x, v.y, v.z, 0.0f }, matrix);
+		return { result.x, result.y, result.z };
+	}
+
+	//Inverse of a matrix whose last column is (0, 0, 0, 1): rotations, scales (even non uniform) and translations. Not projections.
+	inline HTMat4 HTMat4InverseAffine(const HTMat4& matrix)
+	{
+		const float (*m)[4] = matrix.m;
+
+		//Inverse of the 3x3 part with the cofactors
+		float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		float invDeterminant = 1.0f / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+		HTMat4 result;
+		result.m[0][0] = c00 * invDeterminant;
+		result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDeterminant;
+		result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDeterminant;
+		result.m[1][0] = c01 * invDeterminant;
+		result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDeterminant;
+		result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDeterminant;
+		result.m[2][0] = c02 * invDeterminant;
+		result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDeterminant;
+		result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDeterminant;
+		result.m[0][3] = result.m[1][3] = result.m[2][3] = 0.0f;
+
+		//The translation goes back through the inverse rotation/scale
+		for (uint32_t column = 0; column < 3; column++)
+			result.m[3][column] = -(m[3][0] * result.m[0][column] + m[3][1] * result.m[1][column] + m[3][2] * result.m[2][column]);
+		result.m[3][3] = 1.0f;
+
+		return result;
+	}
+
+	//Left handed, like XMMatrixLookAtLH. up can't be parallel to the direction.
+	inline HTMat4 HTMat4LookAtLH(const HTVec3& eye, const HTVec3& target, const HTVec3& up)
+	{
+		HTVec3 zAxis = HTVec3Normalize(HTVec3Sub(target, eye));
+		HTVec3 xAxis = HTVec3Normalize(HTVec3Cross(up, zAxis));
+		HTVec3 yAxis = HTVec3Cross(zAxis, xAxis);
+
+		return { { { xAxis.x, yAxis.x, zAxis.x, 0.0f },
+		           { xAxis.y, yAxis.y, zAxis.y, 0.0f },
+		           { xAxis.z, yAxis.z, zAxis.z, 0.0f },
+		           { -HTVec3Dot(xAxis, eye), -HTVec3Dot(yAxis, eye), -HTVec3Dot(zAxis, eye), 1.0f } } };
+	}
+
+	//Left handed with the depth from 0 (near) to 1 (far), like XMMatrixPerspectiveFovLH. fovY in radians.
+	inline HTMat4 HTMat4PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = 1.0f / std::tan(fovY * 0.5f);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+
+		return { { { width, 0.0f, 0.0f, 0.0f }, { 0.0f, height, 0.0f, 0.0f }, { 0.0f, 0.0f, range, 1.0f }, { 0.0f, 0.0f, -range * nearZ, 0.0f } } };
+	}
+
+	// -------------- HTQuat
+
+	inline HTQuat HTQuatIdentity() { return { 0.0f, 0.0f, 0.0f, 1.0f }; }
+
+	//The axis must be normalized
+	inline HTQuat HTQuatFromAxisAngle(const HTVec3& axis, float angle)
+	{
+		float s = std::sin(angle * 0.5f);
+		return { axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+	}
+
+	//a, then b (same order as the matrices, like XMQuaternionMultiply). It is the product b * a.
+	inline HTQuat HTQuatMultiply(const HTQuat& a, const HTQuat& b)
+	{
+		return { b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+		         b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+		         b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+		         b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z };
+	}
+
+	inline HTQuat HTQuatNormalize(const HTQuat& q)
+	{
+		float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+		return { q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength };
+	}
+
+	//Same result as HTMat4TransformVector(v, HTMat4FromQuat(q))
+	inline HTVec3 HTQuatRotate(const HTVec3& v, const HTQuat& q)
+	{
+		HTVec3 axis = { q.x, q.y, q.z };
+		HTVec3 t = HTVec3Scale(HTVec3Cross(axis, v), 2.0f);
+		return HTVec3Add(HTVec3Add(v, HTVec3Scale(t, q.w)), HTVec3Cross(axis, t));
+	}
+}
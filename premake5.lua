@@ -37,6 +37,8 @@ project "D3D12HT"
 	{
 		"d3d12.lib",
 		"DXGI.lib",
+		"d3dcompiler.lib",
+		"dxguid.lib",
 	}
 
 	includedirs
@@ -45,6 +47,15 @@ project "D3D12HT"
 		"%{prj.name}/vendor",
 	}
 
+	--The benchmarks, the fuzz tests and the unit tests have their own main
+	removefiles
+	{
+		"%{prj.name}/src/benchmark/**",
+		"%{prj.name}/src/fuzz/**",
+		"%{prj.name}/src/microbench/**",
+		"%{prj.name}/src/tests/**",
+	}
+
 	filter "system:windows"
 	systemversion "latest"
 
@@ -67,4 +78,295 @@ project "D3D12HT"
 	defines "D3D12HT_DIST"
 	runtime "Release"
 	symbols "Off"
-	optimize "Full"
\ No newline at end of file
+	optimize "Full"
+
+--The frame loop on the null backend, without a window or a GPU. Only the code that doesn't depend on Windows/D3D12, so it also builds on Linux.
+project "D3D12HTBenchmark"
+	location "D3D12HT"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir("bin/" .. outputdir .. "/%{prj.name}")
+	objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"D3D12HT/src/benchmark/**.h",
+		"D3D12HT/src/benchmark/**.cpp",
+		"D3D12HT/src/core/**.h",
+		"D3D12HT/src/core/**.cpp",
+		"D3D12HT/src/renderer/*.h",
+		"D3D12HT/src/renderer/*.cpp",
+		"D3D12HT/src/renderer/null/**.h",
+		"D3D12HT/src/renderer/null/**.cpp",
+		"D3D12HT/src/scene/**.h",
+		"D3D12HT/src/scene/**.cpp",
+		"D3D12HT/src/util/**.h",
+		"D3D12HT/src/util/mathKernels.cpp",
+	}
+
+	includedirs
+	{
+		"D3D12HT/src",
+	}
+
+	filter "system:windows"
+	systemversion "latest"
+
+	defines
+	{
+		"D3D12HT_PLATFORM_WINDOWS"
+	}
+
+	filter "system:linux"
+	links
+	{
+		"pthread",
+	}
+
+	filter "configurations:Debug"
+	defines "D3D12HT_DEBUG"
+	runtime "Debug"
+	symbols "on"
+
+	filter "configurations:Release"
+	defines "D3D12HT_RELEASE"
+	runtime "Release"
+	optimize "On"
+
+	filter "configurations:Dist"
+	defines "D3D12HT_DIST"
+	runtime "Release"
+	symbols "Off"
+	optimize "Full"
+
+--Millions of random Allocate/Free on the allocators of the GPU memory, checked against a shadow copy, and a benchmark of them.
+--They only work with offsets, so it also builds on Linux.
+project "D3D12HTAllocatorFuzz"
+	location "D3D12HT"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir("bin/" .. outputdir .. "/%{prj.name}")
+	objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"D3D12HT/src/fuzz/**.h",
+		"D3D12HT/src/fuzz/**.cpp",
+		"D3D12HT/src/renderer/tlsfAllocator.h",
+		"D3D12HT/src/renderer/tlsfAllocator.cpp",
+		"D3D12HT/src/renderer/gpuHeapAllocator.h",
+		"D3D12HT/src/renderer/gpuHeapAllocator.cpp",
+		"D3D12HT/src/renderer/residencyManager.h",
+		"D3D12HT/src/renderer/residencyManager.cpp",
+		"D3D12HT/src/renderer/cpuFence.h",
+		"D3D12HT/src/renderer/fence.h",
+		"D3D12HT/src/util/**.h",
+	}
+
+	includedirs
+	{
+		"D3D12HT/src",
+	}
+
+	filter "system:windows"
+	systemversion "latest"
+
+	defines
+	{
+		"D3D12HT_PLATFORM_WINDOWS"
+	}
+
+	filter "system:linux"
+	links
+	{
+		"pthread",
+	}
+
+	filter "configurations:Debug"
+	defines "D3D12HT_DEBUG"
+	runtime "Debug"
+	symbols "on"
+
+	filter "configurations:Release"
+	defines "D3D12HT_RELEASE"
+	runtime "Release"
+	optimize "On"
+
+	filter "configurations:Dist"
+	defines "D3D12HT_DIST"
+	runtime "Release"
+	symbols "Off"
+	optimize "Full"
+
+--The SIMD math kernels checked against their scalar versions, and their throughput at every level (scalar, SSE, AVX2) the CPU has.
+--The AVX2 code is built per function, so this is built like the rest (no -mavx2) and it also builds on Linux.
+project "D3D12HTMathBenchmark"
+	location "D3D12HT"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir("bin/" .. outputdir .. "/%{prj.name}")
+	objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"D3D12HT/src/microbench/mathBenchmark.cpp",
+		"D3D12HT/src/util/**.h",
+		"D3D12HT/src/util/mathKernels.cpp",
+	}
+
+	includedirs
+	{
+		"D3D12HT/src",
+	}
+
+	filter "system:windows"
+	systemversion "latest"
+
+	defines
+	{
+		"D3D12HT_PLATFORM_WINDOWS"
+	}
+
+	filter "configurations:Debug"
+	defines "D3D12HT_DEBUG"
+	runtime "Debug"
+	symbols "on"
+
+	filter "configurations:Release"
+	defines "D3D12HT_RELEASE"
+	runtime "Release"
+	optimize "On"
+
+	filter "configurations:Dist"
+	defines "D3D12HT_DIST"
+	runtime "Release"
+	symbols "Off"
+	optimize "Full"
+
+--What a scope of the CPU profiler costs, with and without a capture, on one thread and on several. The trace it writes is checked against what was recorded.
+--Plain C++, so it also builds on Linux.
+project "D3D12HTProfilerBenchmark"
+	location "D3D12HT"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir("bin/" .. outputdir .. "/%{prj.name}")
+	objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"D3D12HT/src/microbench/profilerBenchmark.cpp",
+		"D3D12HT/src/core/cpuProfiler.h",
+		"D3D12HT/src/core/cpuProfiler.cpp",
+		"D3D12HT/src/core/spscQueue.h",
+		"D3D12HT/src/util/**.h",
+	}
+
+	includedirs
+	{
+		"D3D12HT/src",
+	}
+
+	filter "system:windows"
+	systemversion "latest"
+
+	defines
+	{
+		"D3D12HT_PLATFORM_WINDOWS"
+	}
+
+	filter "system:linux"
+	links
+	{
+		"pthread",
+	}
+
+	filter "configurations:Debug"
+	defines "D3D12HT_DEBUG"
+	runtime "Debug"
+	symbols "on"
+
+	filter "configurations:Release"
+	defines "D3D12HT_RELEASE"
+	runtime "Release"
+	optimize "On"
+
+	filter "configurations:Dist"
+	defines "D3D12HT_DIST"
+	runtime "Release"
+	symbols "Off"
+	optimize "Full"
+
+--The unit tests of the subsystems that don't need a device (allocators, trackers, schedulers, caches...), driven by fake fences and the null/CPU backends.
+--Plain C++, so it also builds and runs on Linux. The exit code is 1 if a test failed.
+project "D3D12HTTests"
+	location "D3D12HT"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir("bin/" .. outputdir .. "/%{prj.name}")
+	objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"D3D12HT/src/tests/**.h",
+		"D3D12HT/src/tests/**.cpp",
+		"D3D12HT/src/core/**.h",
+		"D3D12HT/src/core/**.cpp",
+		"D3D12HT/src/renderer/*.h",
+		"D3D12HT/src/renderer/*.cpp",
+		"D3D12HT/src/renderer/null/**.h",
+		"D3D12HT/src/renderer/null/**.cpp",
+		"D3D12HT/src/scene/**.h",
+		"D3D12HT/src/scene/**.cpp",
+		"D3D12HT/src/util/**.h",
+		"D3D12HT/src/util/mathKernels.cpp",
+	}
+
+	includedirs
+	{
+		"D3D12HT/src",
+	}
+
+	filter "system:windows"
+	systemversion "latest"
+
+	defines
+	{
+		"D3D12HT_PLATFORM_WINDOWS"
+	}
+
+	filter "system:linux"
+	links
+	{
+		"pthread",
+	}
+
+	filter "configurations:Debug"
+	defines "D3D12HT_DEBUG"
+	runtime "Debug"
+	symbols "on"
+
+	filter "configurations:Release"
+	defines "D3D12HT_RELEASE"
+	runtime "Release"
+	optimize "On"
+
+	filter "configurations:Dist"
+	defines "D3D12HT_DIST"
+	runtime "Release"
+	symbols "Off"
+	optimize "Full"